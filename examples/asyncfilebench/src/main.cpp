@@ -0,0 +1,251 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#include "thekogans/util/Environment.h"
+#if !defined (TOOLCHAIN_OS_Windows)
+    #include <fcntl.h>
+    #include <stdlib.h>
+#endif // !defined (TOOLCHAIN_OS_Windows)
+#include <cstdio>
+#include <cstring>
+#include <atomic>
+#include <iostream>
+#include <vector>
+#include "thekogans/util/Types.h"
+#include "thekogans/util/CommandLineOptions.h"
+#include "thekogans/util/LoggerMgr.h"
+#include "thekogans/util/ConsoleLogger.h"
+#include "thekogans/util/Exception.h"
+#include "thekogans/util/StringUtils.h"
+#include "thekogans/util/RandomSource.h"
+#include "thekogans/util/HRTimer.h"
+#include "thekogans/util/Event.h"
+#include "thekogans/util/File.h"
+#include "thekogans/util/AsyncFile.h"
+
+using namespace thekogans;
+
+namespace {
+#if defined (TOOLCHAIN_OS_Linux)
+    const util::i32 DIRECT_FLAGS = O_DIRECT;
+#else // defined (TOOLCHAIN_OS_Linux)
+    const util::i32 DIRECT_FLAGS = 0;
+#endif // defined (TOOLCHAIN_OS_Linux)
+
+    struct Options : public util::CommandLineOptions {
+        util::ui32 queueDepth;
+        std::size_t blockSize;
+        std::size_t blockCount;
+        bool useIORing;
+        std::string path;
+
+        Options () :
+            queueDepth (32),
+            blockSize (4096),
+            blockCount (16384),
+            useIORing (true) {}
+
+        virtual void DoOption (
+                char option,
+                const std::string &value) override {
+            switch (option) {
+                case 'q':
+                    queueDepth = util::stringToui32 (value.c_str ());
+                    break;
+                case 'b':
+                    blockSize = util::stringToui32 (value.c_str ());
+                    break;
+                case 'c':
+                    blockCount = util::stringToui32 (value.c_str ());
+                    break;
+                case 't':
+                    useIORing = false;
+                    break;
+            }
+        }
+        virtual void DoPath (const std::string &value) override {
+            path = value;
+        }
+    };
+
+    void Report (
+            const char *name,
+            std::size_t blockSize,
+            std::size_t blockCount,
+            util::ui64 start,
+            util::ui64 end) {
+        util::f64 seconds = util::HRTimer::ToSeconds (
+            util::HRTimer::ComputeElapsedTime (start, end));
+        std::cout << name << ": " << blockCount / seconds << " IOPS, " <<
+            blockSize * blockCount / seconds / (1024.0 * 1024.0) << " MB/s" << std::endl;
+    }
+
+    // Keep queueDepth requests in flight until blockCount blocks have been
+    // transferred. Completions are delivered on the service thread which
+    // issues the replacement request.
+    struct Runner {
+        util::AsyncFile &file;
+        const std::vector<util::ui64> &offsets;
+        std::vector<util::ui8 *> &buffers;
+        std::size_t blockSize;
+        bool write;
+        std::atomic<std::size_t> next;
+        std::atomic<std::size_t> completed;
+        std::atomic<THEKOGANS_UTIL_ERROR_CODE> errorCode;
+        util::Event event;
+
+        Runner (
+            util::AsyncFile &file_,
+            const std::vector<util::ui64> &offsets_,
+            std::vector<util::ui8 *> &buffers_,
+            std::size_t blockSize_,
+            bool write_) :
+            file (file_),
+            offsets (offsets_),
+            buffers (buffers_),
+            blockSize (blockSize_),
+            write (write_),
+            next (0),
+            completed (0),
+            errorCode (0) {}
+
+        void Run () {
+            std::size_t count = buffers.size () < offsets.size () ?
+                buffers.size () : offsets.size ();
+            for (std::size_t i = 0; i < count; ++i) {
+                Issue (i, false);
+            }
+            file.Submit ();
+            event.Wait ();
+        }
+
+        void Issue (
+                std::size_t slot,
+                bool submit) {
+            std::size_t index = next++;
+            if (index < offsets.size ()) {
+                util::AsyncIOService::Callback callback =
+                    [this, slot] (
+                            THEKOGANS_UTIL_ERROR_CODE errorCode_,
+                            std::size_t /*count*/) {
+                        if (errorCode_ != 0) {
+                            errorCode = errorCode_;
+                        }
+                        if (++completed == offsets.size ()) {
+                            event.Signal ();
+                        }
+                        else {
+                            Issue (slot, true);
+                        }
+                    };
+                if (write) {
+                    file.AsyncWrite (offsets[index], buffers[slot],
+                        blockSize, callback, (util::ui32)slot, submit);
+                }
+                else {
+                    file.AsyncRead (offsets[index], buffers[slot],
+                        blockSize, callback, (util::ui32)slot, submit);
+                }
+            }
+        }
+    };
+}
+
+int main (
+        int argc,
+        const char *argv[]) {
+    Options options;
+    options.Parse (argc, argv, "qbct");
+    if (options.path.empty () || options.queueDepth == 0 ||
+            options.blockSize == 0 || options.blockCount == 0) {
+        std::cout << "usage: " << argv[0] <<
+            " [-q:queueDepth] [-b:blockSize] [-c:blockCount] [-t] path" << std::endl <<
+            "  -t use the thread pool even if io_uring is available." << std::endl;
+        return 1;
+    }
+    THEKOGANS_UTIL_LOG_INIT (
+        util::LoggerMgr::Debug,
+        util::LoggerMgr::All);
+    THEKOGANS_UTIL_LOG_ADD_LOGGER (util::Logger::SharedPtr (new util::ConsoleLogger));
+    THEKOGANS_UTIL_IMPLEMENT_LOG_FLUSHER;
+    THEKOGANS_UTIL_TRY {
+        // O_DIRECT needs block aligned buffers and offsets.
+        std::vector<util::ui8 *> buffers (options.queueDepth);
+        util::AsyncIOService::BufferList bufferList;
+        for (std::size_t i = 0; i < buffers.size (); ++i) {
+            void *buffer = nullptr;
+            if (posix_memalign (&buffer, 4096, options.blockSize) != 0) {
+                THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                    THEKOGANS_UTIL_OS_ERROR_CODE_ENOMEM);
+            }
+            memset (buffer, (int)i, options.blockSize);
+            buffers[i] = (util::ui8 *)buffer;
+            bufferList.push_back (std::make_pair (buffer, options.blockSize));
+        }
+        std::vector<util::ui64> offsets (options.blockCount);
+        for (std::size_t i = 0; i < offsets.size (); ++i) {
+            offsets[i] = (util::ui64)(util::RandomSource::Instance ()->Getui32 () %
+                options.blockCount) * options.blockSize;
+        }
+        {
+            util::File file (util::HostEndian, options.path,
+                O_RDWR | O_CREAT | O_TRUNC | DIRECT_FLAGS);
+            util::ui64 start = util::HRTimer::Click ();
+            for (std::size_t i = 0; i < offsets.size (); ++i) {
+                file.Seek (offsets[i], SEEK_SET);
+                file.Write (buffers[0], options.blockSize);
+            }
+            Report ("File::Write", options.blockSize, options.blockCount,
+                start, util::HRTimer::Click ());
+            // Make sure every block exists for the read passes.
+            file.SetSize (options.blockSize * options.blockCount);
+            start = util::HRTimer::Click ();
+            for (std::size_t i = 0; i < offsets.size (); ++i) {
+                file.Seek (offsets[i], SEEK_SET);
+                file.Read (buffers[0], options.blockSize);
+            }
+            Report ("File::Read", options.blockSize, options.blockCount,
+                start, util::HRTimer::Click ());
+        }
+        {
+            util::AsyncIOService::SharedPtr service = util::AsyncIOService::Create (
+                options.queueDepth,
+                options.queueDepth,
+                options.useIORing);
+            service->RegisterBuffers (bufferList);
+            util::AsyncFile file (service, nullptr, util::HostEndian,
+                options.path, O_RDWR | DIRECT_FLAGS);
+            std::cout << (service->IsIORing () ? "io_uring" : "thread pool") <<
+                ", queue depth " << options.queueDepth << std::endl;
+            for (int write = 1; write >= 0; --write) {
+                Runner runner (file, offsets, buffers, options.blockSize, write == 1);
+                util::ui64 start = util::HRTimer::Click ();
+                runner.Run ();
+                Report (write == 1 ? "AsyncFile::AsyncWrite" : "AsyncFile::AsyncRead",
+                    options.blockSize, options.blockCount, start, util::HRTimer::Click ());
+                if (runner.errorCode != 0) {
+                    THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (runner.errorCode);
+                }
+            }
+        }
+        for (std::size_t i = 0; i < buffers.size (); ++i) {
+            free (buffers[i]);
+        }
+    }
+    THEKOGANS_UTIL_CATCH_AND_LOG
+    return 0;
+}
@@ -0,0 +1,166 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <iostream>
+#include <vector>
+#include "thekogans/util/Types.h"
+#include "thekogans/util/CommandLineOptions.h"
+#include "thekogans/util/StringUtils.h"
+#include "thekogans/util/HRTimer.h"
+#include "thekogans/util/ByteSwap.h"
+#include "thekogans/util/Serializer.h"
+#include "thekogans/util/Buffer.h"
+
+using namespace thekogans;
+
+namespace {
+    struct Options : public util::CommandLineOptions {
+        // How much data to push through at each array size.
+        std::size_t totalMB;
+
+        Options () :
+            totalMB (1024) {}
+
+        virtual void DoOption (
+                char option,
+                const std::string &value) override {
+            switch (option) {
+                case 't':
+                    totalMB = util::stringToui32 (value.c_str ());
+                    break;
+            }
+        }
+    };
+
+    inline util::f64 Now () {
+        return util::HRTimer::ToSeconds (util::HRTimer::Click ());
+    }
+
+    // What serializing a std::vector<f64> used to do: one
+    // insertion (and one byte swap) per element.
+    void WriteElements (
+            util::Serializer &serializer,
+            const std::vector<util::f64> &values) {
+        serializer << util::SizeT (values.size ());
+        for (std::size_t i = 0, count = values.size (); i < count; ++i) {
+            serializer << values[i];
+        }
+    }
+
+    void ReadElements (
+            util::Serializer &serializer,
+            std::vector<util::f64> &values) {
+        util::SizeT count;
+        serializer >> count;
+        values.resize (count);
+        for (std::size_t i = 0; i < count; ++i) {
+            serializer >> values[i];
+        }
+    }
+
+    void Report (
+            const char *name,
+            std::size_t bytes,
+            util::f64 seconds) {
+        std::cout << "    " << name << ": " <<
+            bytes / seconds / (1024.0 * 1024.0 * 1024.0) << " GB/s" << std::endl;
+    }
+
+    void Benchmark (
+            std::size_t size,
+            const Options &options) {
+        std::size_t count = size / util::F64_SIZE;
+        std::size_t iterations = options.totalMB * 1024 * 1024 / size;
+        if (iterations == 0) {
+            iterations = 1;
+        }
+        std::size_t bytes = size * iterations;
+        std::vector<util::f64> values (count);
+        for (std::size_t i = 0; i < count; ++i) {
+            values[i] = i * 0.5;
+        }
+        std::vector<util::f64> swapped (count);
+        std::cout << (size < 1024 * 1024 ? size / 1024 : size / (1024 * 1024)) <<
+            (size < 1024 * 1024 ? " KB" : " MB") << " (" << iterations << " iterations):" << std::endl;
+        {
+            util::f64 start = Now ();
+            for (std::size_t j = 0; j < iterations; ++j) {
+                for (std::size_t i = 0; i < count; ++i) {
+                    swapped[i] = util::ByteSwap<util::LittleEndian, util::BigEndian> (values[i]);
+                }
+            }
+            Report ("scalar ByteSwap loop ", bytes, Now () - start);
+            start = Now ();
+            for (std::size_t j = 0; j < iterations; ++j) {
+                util::ByteSwapArray (values.data (), swapped.data (), util::F64_SIZE, count);
+            }
+            Report ("ByteSwapArray        ", bytes, Now () - start);
+        }
+        const util::Endianness endiannesses[] = {util::HostEndian, util::GuestEndian};
+        for (std::size_t e = 0; e < 2; ++e) {
+            util::Buffer buffer (endiannesses[e], size + util::SizeT::MAX_SIZE);
+            std::vector<util::f64> result;
+            for (int bulk = 0; bulk < 2; ++bulk) {
+                util::f64 writeSeconds = 0.0;
+                util::f64 readSeconds = 0.0;
+                for (std::size_t j = 0; j < iterations; ++j) {
+                    buffer.Rewind ();
+                    util::f64 start = Now ();
+                    if (bulk == 1) {
+                        buffer << values;
+                    }
+                    else {
+                        WriteElements (buffer, values);
+                    }
+                    util::f64 end = Now ();
+                    writeSeconds += end - start;
+                    if (bulk == 1) {
+                        buffer >> result;
+                    }
+                    else {
+                        ReadElements (buffer, result);
+                    }
+                    readSeconds += Now () - end;
+                }
+                std::string name = std::string (e == 0 ? "host  " : "guest ") +
+                    (bulk == 1 ? "vector bulk    " : "vector element ");
+                Report ((name + "write").c_str (), bytes, writeSeconds);
+                Report ((name + "read ").c_str (), bytes, readSeconds);
+                if (result != values) {
+                    std::cout << "    BROKEN" << std::endl;
+                }
+            }
+        }
+    }
+}
+
+int main (
+        int argc,
+        const char *argv[]) {
+    Options options;
+    options.Parse (argc, argv, "t");
+    if (options.totalMB == 0) {
+        std::cout << "usage: " << argv[0] << " [-t:MB per array size]" << std::endl;
+        return 1;
+    }
+    const std::size_t sizes[] = {1024, 1024 * 1024, 100 * 1024 * 1024};
+    for (std::size_t i = 0; i < sizeof (sizes) / sizeof (sizes[0]); ++i) {
+        Benchmark (sizes[i], options);
+    }
+    return 0;
+}
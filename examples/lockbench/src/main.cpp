@@ -0,0 +1,265 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#include "thekogans/util/Environment.h"
+#if !defined (TOOLCHAIN_OS_Windows)
+    #include <sys/resource.h>
+#endif // !defined (TOOLCHAIN_OS_Windows)
+#include <iostream>
+#include <memory>
+#include <vector>
+#include "thekogans/util/Types.h"
+#include "thekogans/util/CommandLineOptions.h"
+#include "thekogans/util/StringUtils.h"
+#include "thekogans/util/SystemInfo.h"
+#include "thekogans/util/HRTimer.h"
+#include "thekogans/util/Thread.h"
+#include "thekogans/util/SpinLock.h"
+#include "thekogans/util/Mutex.h"
+#include "thekogans/util/Condition.h"
+#include "thekogans/util/LockGuard.h"
+#if defined (TOOLCHAIN_OS_Linux)
+    #include "thekogans/util/os/linux/Futex.h"
+#endif // defined (TOOLCHAIN_OS_Linux)
+
+using namespace thekogans;
+
+namespace {
+    struct Options : public util::CommandLineOptions {
+        std::size_t threadCount;
+        std::size_t iterations;
+        std::size_t work;
+
+        Options () :
+            threadCount (util::SystemInfo::Instance ()->GetCPUCount () * 2),
+            iterations (200000),
+            work (16) {}
+
+        virtual void DoOption (
+                char option,
+                const std::string &value) override {
+            switch (option) {
+                case 't':
+                    threadCount = util::stringToui32 (value.c_str ());
+                    break;
+                case 'i':
+                    iterations = util::stringToui32 (value.c_str ());
+                    break;
+                case 'w':
+                    work = util::stringToui32 (value.c_str ());
+                    break;
+            }
+        }
+    };
+
+    // Process CPU time (user + system) in seconds. Spinning
+    // waiters show up here even when wall clock time doesn't.
+    util::f64 GetCPUTime () {
+    #if !defined (TOOLCHAIN_OS_Windows)
+        rusage usage;
+        getrusage (RUSAGE_SELF, &usage);
+        return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+            usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+    #else // !defined (TOOLCHAIN_OS_Windows)
+        return 0.0;
+    #endif // !defined (TOOLCHAIN_OS_Windows)
+    }
+
+    // Thread::Wait returns false if the thread hasn't had a chance
+    // to run yet (very likely when oversubscribed).
+    inline void Join (util::Thread &thread) {
+        while (!thread.Wait ()) {
+            util::Thread::YieldSlice ();
+        }
+    }
+
+    inline void Work (std::size_t work) {
+        for (std::size_t i = 0; i < work; ++i) {
+            util::Thread::Pause ();
+        }
+    }
+
+    template<typename Lock>
+    struct LockThread : public util::Thread {
+        Lock &lock;
+        std::size_t iterations;
+        std::size_t work;
+        util::ui64 &counter;
+
+        LockThread (
+            Lock &lock_,
+            std::size_t iterations_,
+            std::size_t work_,
+            util::ui64 &counter_) :
+            lock (lock_),
+            iterations (iterations_),
+            work (work_),
+            counter (counter_) {}
+
+        virtual void Run () noexcept override {
+            for (std::size_t i = 0; i < iterations; ++i) {
+                {
+                    util::LockGuard<Lock> guard (lock);
+                    ++counter;
+                    Work (work);
+                }
+                Work (work);
+            }
+        }
+    };
+
+    template<typename Lock>
+    void BenchmarkLock (
+            const char *name,
+            const Options &options) {
+        Lock lock;
+        util::ui64 counter = 0;
+        std::vector<std::unique_ptr<LockThread<Lock>>> threads;
+        for (std::size_t i = 0; i < options.threadCount; ++i) {
+            threads.emplace_back (
+                new LockThread<Lock> (lock, options.iterations, options.work, counter));
+        }
+        util::f64 cpuStart = GetCPUTime ();
+        util::ui64 start = util::HRTimer::Click ();
+        for (std::size_t i = 0; i < threads.size (); ++i) {
+            threads[i]->Create ();
+        }
+        for (std::size_t i = 0; i < threads.size (); ++i) {
+            Join (*threads[i]);
+        }
+        util::f64 seconds = util::HRTimer::ToSeconds (
+            util::HRTimer::ComputeElapsedTime (start, util::HRTimer::Click ()));
+        std::cout << name << ": " << seconds << "s wall, " <<
+            GetCPUTime () - cpuStart << "s cpu, " <<
+            counter / seconds << " acquisitions/s" <<
+            (counter == options.threadCount * options.iterations ? "" : " (BROKEN)") <<
+            std::endl;
+    }
+
+    // One producer hands counter values to threadCount consumers through
+    // a single slot guarded by Lock and Condition. Exercises Signal/SignalAll.
+    template<
+        typename Lock,
+        typename Condition>
+    struct Handoff {
+        Lock lock;
+        Condition notEmpty;
+        Condition notFull;
+        bool full;
+        bool done;
+        util::ui64 value;
+        util::ui64 sum;
+
+        Handoff () :
+            notEmpty (lock),
+            notFull (lock),
+            full (false),
+            done (false),
+            value (0),
+            sum (0) {}
+
+        struct Consumer : public util::Thread {
+            Handoff &handoff;
+
+            explicit Consumer (Handoff &handoff_) :
+                handoff (handoff_) {}
+
+            virtual void Run () noexcept override {
+                while (1) {
+                    util::LockGuard<Lock> guard (handoff.lock);
+                    while (!handoff.full && !handoff.done) {
+                        handoff.notEmpty.Wait ();
+                    }
+                    if (!handoff.full) {
+                        break;
+                    }
+                    handoff.sum += handoff.value;
+                    handoff.full = false;
+                    handoff.notFull.Signal ();
+                }
+            }
+        };
+
+        void Run (
+                const char *name,
+                const Options &options) {
+            std::vector<std::unique_ptr<Consumer>> consumers;
+            for (std::size_t i = 0; i < options.threadCount; ++i) {
+                consumers.emplace_back (new Consumer (*this));
+            }
+            util::f64 cpuStart = GetCPUTime ();
+            util::ui64 start = util::HRTimer::Click ();
+            for (std::size_t i = 0; i < consumers.size (); ++i) {
+                consumers[i]->Create ();
+            }
+            for (std::size_t i = 1; i <= options.iterations; ++i) {
+                util::LockGuard<Lock> guard (lock);
+                while (full) {
+                    notFull.Wait ();
+                }
+                value = i;
+                full = true;
+                notEmpty.Signal ();
+            }
+            {
+                util::LockGuard<Lock> guard (lock);
+                while (full) {
+                    notFull.Wait ();
+                }
+                done = true;
+                notEmpty.SignalAll ();
+            }
+            for (std::size_t i = 0; i < consumers.size (); ++i) {
+                Join (*consumers[i]);
+            }
+            util::f64 seconds = util::HRTimer::ToSeconds (
+                util::HRTimer::ComputeElapsedTime (start, util::HRTimer::Click ()));
+            util::ui64 expected = (util::ui64)options.iterations * (options.iterations + 1) / 2;
+            std::cout << name << ": " << seconds << "s wall, " <<
+                GetCPUTime () - cpuStart << "s cpu, " <<
+                options.iterations / seconds << " handoffs/s" <<
+                (sum == expected ? "" : " (BROKEN)") << std::endl;
+        }
+    };
+}
+
+int main (
+        int argc,
+        const char *argv[]) {
+    Options options;
+    options.Parse (argc, argv, "tiw");
+    if (options.threadCount == 0 || options.iterations == 0) {
+        std::cout << "usage: " << argv[0] <<
+            " [-t:threadCount (default 2 x cores)] [-i:iterations] [-w:work]" << std::endl;
+        return 1;
+    }
+    std::cout << options.threadCount << " threads on " <<
+        util::SystemInfo::Instance ()->GetCPUCount () << " cores, " <<
+        options.iterations << " iterations each" << std::endl;
+    BenchmarkLock<util::SpinLock> ("SpinLock", options);
+    BenchmarkLock<util::Mutex> ("Mutex", options);
+#if defined (TOOLCHAIN_OS_Linux)
+    BenchmarkLock<util::os::linux::FutexLock> ("FutexLock", options);
+#endif // defined (TOOLCHAIN_OS_Linux)
+    options.iterations /= 4;
+    Handoff<util::Mutex, util::Condition> ().Run ("Mutex/Condition", options);
+#if defined (TOOLCHAIN_OS_Linux)
+    Handoff<util::os::linux::FutexLock, util::os::linux::FutexCondition> ().Run (
+        "FutexLock/FutexCondition", options);
+#endif // defined (TOOLCHAIN_OS_Linux)
+    return 0;
+}
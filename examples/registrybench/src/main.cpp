@@ -0,0 +1,269 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <atomic>
+#include "thekogans/util/Types.h"
+#include "thekogans/util/Constants.h"
+#include "thekogans/util/CommandLineOptions.h"
+#include "thekogans/util/StringUtils.h"
+#include "thekogans/util/SystemInfo.h"
+#include "thekogans/util/HRTimer.h"
+#include "thekogans/util/Thread.h"
+#include "thekogans/util/Event.h"
+#include "thekogans/util/SpinLock.h"
+#include "thekogans/util/LockGuard.h"
+#include "thekogans/util/RefCounted.h"
+#include "thekogans/util/RefCountedRegistry.h"
+
+using namespace thekogans;
+
+namespace {
+    struct Options : public util::CommandLineOptions {
+        std::size_t iterations;
+        std::size_t objects;
+        std::size_t writes;
+
+        Options () :
+            iterations (1000000),
+            objects (256),
+            writes (5) {}
+
+        virtual void DoOption (
+                char option,
+                const std::string &value) override {
+            switch (option) {
+                case 'i':
+                    iterations = util::stringToui32 (value.c_str ());
+                    break;
+                case 'o':
+                    objects = util::stringToui32 (value.c_str ());
+                    break;
+                case 'w':
+                    writes = util::stringToui32 (value.c_str ());
+                    break;
+            }
+        }
+    };
+
+    // Thread::Wait returns false if the thread hasn't had a chance
+    // to run yet (very likely when oversubscribed).
+    inline void Join (util::Thread &thread) {
+        while (!thread.Wait ()) {
+            util::Thread::YieldSlice ();
+        }
+    }
+
+    struct Object : public util::RefCounted {
+        THEKOGANS_UTIL_DECLARE_REF_COUNTED_POINTERS (Object)
+
+        // The slot this object's token lives in.
+        const std::size_t slot;
+
+        explicit Object (std::size_t slot_) :
+            slot (slot_) {}
+    };
+
+    using Registry = util::RefCountedRegistry<Object>;
+    using Token = Registry::Token;
+
+    // The original registry: one SpinLock around a std::vector.
+    struct LockedRegistry {
+        struct Entry {
+            Object::WeakPtr object;
+            Token::CounterType counter;
+            Token::IndexType next;
+
+            Entry () :
+                counter (0),
+                next (util::NIDX32) {}
+        };
+        std::vector<Entry> entries;
+        Token::IndexType count;
+        Token::IndexType freeList;
+        util::SpinLock spinLock;
+
+        LockedRegistry () :
+            entries (Registry::DEFAULT_ENTRIES_SIZE),
+            count (0),
+            freeList (util::NIDX32) {}
+
+        Token::ValueType Add (Object *object) {
+            util::LockGuard<util::SpinLock> guard (spinLock);
+            Token::IndexType index;
+            if (freeList != util::NIDX32) {
+                index = freeList;
+                freeList = entries[index].next;
+            }
+            else {
+                index = count;
+                if (count == entries.size ()) {
+                    entries.resize (count * 2);
+                }
+            }
+            entries[index].object = Object::WeakPtr (object);
+            ++count;
+            return Token::MakeValue (index, entries[index].counter);
+        }
+
+        void Remove (Token::ValueType value) {
+            Token::IndexType index = Token::GetIndex (value);
+            util::LockGuard<util::SpinLock> guard (spinLock);
+            if (index < entries.size () && entries[index].counter == Token::GetCounter (value)) {
+                entries[index].object = Object::WeakPtr ();
+                ++entries[index].counter;
+                entries[index].next = freeList;
+                freeList = index;
+                --count;
+            }
+        }
+
+        Object::SharedPtr Get (Token::ValueType value) {
+            Token::IndexType index = Token::GetIndex (value);
+            util::LockGuard<util::SpinLock> guard (spinLock);
+            return index < entries.size () && entries[index].counter == Token::GetCounter (value) ?
+                entries[index].object.GetSharedPtr () : nullptr;
+        }
+    };
+
+    // Every thread owns objects objects (and their slots). It re-registers
+    // its own (Remove + Add) writes% of the time, and resolves a random
+    // token (anybody's) the rest.
+    template<typename RegistryType>
+    struct Worker : public util::Thread {
+        util::Event &start;
+        RegistryType &registry;
+        std::atomic<util::ui64> *slots;
+        std::size_t slotCount;
+        std::size_t thread;
+        const Options &options;
+        std::vector<Object::SharedPtr> objects;
+        std::size_t hits;
+        bool broken;
+
+        Worker (
+                util::Event &start_,
+                RegistryType &registry_,
+                std::atomic<util::ui64> *slots_,
+                std::size_t slotCount_,
+                std::size_t thread_,
+                const Options &options_) :
+                start (start_),
+                registry (registry_),
+                slots (slots_),
+                slotCount (slotCount_),
+                thread (thread_),
+                options (options_),
+                hits (0),
+                broken (false) {
+            for (std::size_t i = 0; i < options.objects; ++i) {
+                std::size_t slot = thread * options.objects + i;
+                objects.push_back (Object::SharedPtr (new Object (slot)));
+                slots[slot].store (registry.Add (objects.back ().Get ()));
+            }
+        }
+
+        virtual void Run () noexcept override {
+            start.Wait ();
+            // xorshift, good enough to scatter the Gets.
+            util::ui64 random = 88172645463325252ull + thread;
+            for (std::size_t i = 0; i < options.iterations; ++i) {
+                random ^= random << 13;
+                random ^= random >> 7;
+                random ^= random << 17;
+                if (random % 100 < options.writes) {
+                    std::size_t object = (std::size_t)(random >> 32) % objects.size ();
+                    std::atomic<util::ui64> &slot = slots[thread * options.objects + object];
+                    registry.Remove (slot.load (std::memory_order_relaxed));
+                    slot.store (registry.Add (objects[object].Get ()), std::memory_order_relaxed);
+                }
+                else {
+                    std::size_t slot = (std::size_t)(random >> 32) % slotCount;
+                    Object::SharedPtr object =
+                        registry.Get (slots[slot].load (std::memory_order_relaxed));
+                    if (object != nullptr) {
+                        if (object->slot != slot) {
+                            broken = true;
+                        }
+                        ++hits;
+                    }
+                }
+            }
+        }
+    };
+
+    template<typename RegistryType>
+    void Benchmark (
+            const char *name,
+            std::size_t threadCount,
+            const Options &options) {
+        // Hold the threads until they're all created so that they
+        // really do run concurrently.
+        util::Event start;
+        RegistryType registry;
+        std::size_t slotCount = threadCount * options.objects;
+        std::unique_ptr<std::atomic<util::ui64>[]> slots (
+            new std::atomic<util::ui64>[slotCount]);
+        std::vector<std::unique_ptr<Worker<RegistryType>>> workers;
+        for (std::size_t i = 0; i < threadCount; ++i) {
+            workers.emplace_back (
+                new Worker<RegistryType> (start, registry, slots.get (), slotCount, i, options));
+        }
+        for (std::size_t i = 0; i < workers.size (); ++i) {
+            workers[i]->Create ();
+        }
+        util::ui64 startTime = util::HRTimer::Click ();
+        start.Signal ();
+        std::size_t hits = 0;
+        bool broken = false;
+        for (std::size_t i = 0; i < workers.size (); ++i) {
+            Join (*workers[i]);
+            hits += workers[i]->hits;
+            broken = broken || workers[i]->broken;
+        }
+        util::f64 seconds = util::HRTimer::ToSeconds (
+            util::HRTimer::ComputeElapsedTime (startTime, util::HRTimer::Click ()));
+        std::cout << "  " << name << ": " <<
+            threadCount * options.iterations / seconds << " ops/s, " <<
+            hits << " hits" << (broken ? " (BROKEN)" : "") << std::endl;
+    }
+}
+
+int main (
+        int argc,
+        const char *argv[]) {
+    Options options;
+    options.Parse (argc, argv, "iow");
+    if (options.iterations == 0 || options.objects == 0 || options.writes > 100) {
+        std::cout << "usage: " << argv[0] <<
+            " [-i:iterations per thread] [-o:objects per thread] [-w:write percentage]" << std::endl;
+        return 1;
+    }
+    std::cout << util::SystemInfo::Instance ()->GetCPUCount () << " cores, " <<
+        options.iterations << " ops per thread, " << options.objects <<
+        " objects per thread, " << options.writes << "% Remove + Add" << std::endl;
+    const std::size_t threadCounts[] = {1, 2, 4, 8};
+    for (std::size_t i = 0; i < THEKOGANS_UTIL_ARRAY_SIZE (threadCounts); ++i) {
+        std::cout << threadCounts[i] << " thread(s):" << std::endl;
+        Benchmark<Registry> ("RefCountedRegistry", threadCounts[i], options);
+        Benchmark<LockedRegistry> ("SpinLock + std::vector", threadCounts[i], options);
+    }
+    return 0;
+}
@@ -0,0 +1,338 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include "thekogans/util/Types.h"
+#include "thekogans/util/CommandLineOptions.h"
+#include "thekogans/util/StringUtils.h"
+#include "thekogans/util/SystemInfo.h"
+#include "thekogans/util/HRTimer.h"
+#include "thekogans/util/Thread.h"
+#include "thekogans/util/Event.h"
+#include "thekogans/util/Mutex.h"
+#include "thekogans/util/Condition.h"
+#include "thekogans/util/LockGuard.h"
+#include "thekogans/util/SPSCRingQueue.h"
+#include "thekogans/util/MPSCRingQueue.h"
+#include "thekogans/util/IntrusiveMPSCQueue.h"
+#include "thekogans/util/BlockingRingQueue.h"
+
+using namespace thekogans;
+
+namespace {
+    struct Options : public util::CommandLineOptions {
+        std::size_t iterations;
+        std::size_t capacity;
+        std::size_t batchSize;
+
+        Options () :
+            iterations (250000),
+            capacity (1024),
+            batchSize (1) {}
+
+        virtual void DoOption (
+                char option,
+                const std::string &value) override {
+            switch (option) {
+                case 'i':
+                    iterations = util::stringToui32 (value.c_str ());
+                    break;
+                case 'c':
+                    capacity = util::stringToui32 (value.c_str ());
+                    break;
+                case 'b':
+                    batchSize = util::stringToui32 (value.c_str ());
+                    break;
+            }
+        }
+    };
+
+    // Thread::Wait returns false if the thread hasn't had a chance
+    // to run yet (very likely when oversubscribed).
+    inline void Join (util::Thread &thread) {
+        while (!thread.Wait ()) {
+            util::Thread::YieldSlice ();
+        }
+    }
+
+    // Every adapter exposes the same non-blocking (or blocking)
+    // batch interface. 0 == try again.
+    template<typename Queue>
+    struct RingQueueAdapter {
+        Queue queue;
+
+        RingQueueAdapter (
+            std::size_t capacity,
+            std::size_t /*producerCount*/,
+            std::size_t /*iterations*/) :
+            queue (capacity) {}
+
+        inline std::size_t Push (
+                std::size_t /*producer*/,
+                const util::ui64 *values,
+                std::size_t count) {
+            return count == 1 ? (queue.Push (values[0]) ? 1 : 0) :
+                queue.PushBatch (values, count);
+        }
+
+        inline std::size_t Pop (
+                util::ui64 *values,
+                std::size_t count) {
+            return count == 1 ? (queue.Pop (values[0]) ? 1 : 0) :
+                queue.PopBatch (values, count);
+        }
+    };
+
+    struct IntrusiveNode;
+    using IntrusiveQueue = util::IntrusiveMPSCQueue<IntrusiveNode>;
+
+    struct IntrusiveNode : public IntrusiveQueue::Node {
+        util::ui64 value;
+    };
+
+    // Nodes are preallocated so that we measure the queue, not the allocator.
+    struct IntrusiveAdapter {
+        IntrusiveQueue queue;
+        std::size_t iterations;
+        std::vector<IntrusiveNode> nodes;
+
+        IntrusiveAdapter (
+            std::size_t /*capacity*/,
+            std::size_t producerCount,
+            std::size_t iterations_) :
+            iterations (iterations_),
+            nodes (producerCount * iterations) {}
+
+        inline std::size_t Push (
+                std::size_t producer,
+                const util::ui64 *values,
+                std::size_t count) {
+            for (std::size_t i = 0; i < count; ++i) {
+                IntrusiveNode &node = nodes[producer * iterations + values[i] - 1];
+                node.value = values[i];
+                queue.Push (&node);
+            }
+            return count;
+        }
+
+        inline std::size_t Pop (
+                util::ui64 *values,
+                std::size_t count) {
+            std::size_t popped = 0;
+            for (; popped < count; ++popped) {
+                IntrusiveNode *node = queue.Pop ();
+                if (node == nullptr) {
+                    break;
+                }
+                values[popped] = node->value;
+            }
+            return popped;
+        }
+    };
+
+    // The classic bounded queue: a std::deque behind a mutex.
+    struct MutexAdapter {
+        util::Mutex mutex;
+        util::Condition notEmpty;
+        util::Condition notFull;
+        std::size_t capacity;
+        std::deque<util::ui64> queue;
+
+        MutexAdapter (
+            std::size_t capacity_,
+            std::size_t /*producerCount*/,
+            std::size_t /*iterations*/) :
+            notEmpty (mutex),
+            notFull (mutex),
+            capacity (capacity_) {}
+
+        inline std::size_t Push (
+                std::size_t /*producer*/,
+                const util::ui64 *values,
+                std::size_t count) {
+            util::LockGuard<util::Mutex> guard (mutex);
+            while (queue.size () == capacity) {
+                notFull.Wait ();
+            }
+            count = (std::min) (count, capacity - queue.size ());
+            queue.insert (queue.end (), values, values + count);
+            notEmpty.SignalAll ();
+            return count;
+        }
+
+        inline std::size_t Pop (
+                util::ui64 *values,
+                std::size_t count) {
+            util::LockGuard<util::Mutex> guard (mutex);
+            while (queue.empty ()) {
+                notEmpty.Wait ();
+            }
+            count = (std::min) (count, queue.size ());
+            std::copy (queue.begin (), queue.begin () + count, values);
+            queue.erase (queue.begin (), queue.begin () + count);
+            notFull.SignalAll ();
+            return count;
+        }
+    };
+
+    template<typename Adapter>
+    struct Producer : public util::Thread {
+        util::Event &start;
+        Adapter &adapter;
+        std::size_t producer;
+        const Options &options;
+
+        Producer (
+            util::Event &start_,
+            Adapter &adapter_,
+            std::size_t producer_,
+            const Options &options_) :
+            start (start_),
+            adapter (adapter_),
+            producer (producer_),
+            options (options_) {}
+
+        virtual void Run () noexcept override {
+            start.Wait ();
+            std::vector<util::ui64> values (options.batchSize);
+            for (util::ui64 value = 1; value <= options.iterations;) {
+                std::size_t count = (std::min) (
+                    (std::size_t)(options.iterations - value + 1), options.batchSize);
+                for (std::size_t i = 0; i < count; ++i) {
+                    values[i] = value + i;
+                }
+                for (std::size_t pushed = 0; pushed < count;) {
+                    std::size_t result =
+                        adapter.Push (producer, &values[pushed], count - pushed);
+                    if (result == 0) {
+                        util::Thread::YieldSlice ();
+                    }
+                    pushed += result;
+                }
+                value += count;
+            }
+        }
+    };
+
+    template<typename Adapter>
+    struct Consumer : public util::Thread {
+        util::Event &start;
+        Adapter &adapter;
+        std::size_t total;
+        const Options &options;
+        util::ui64 sum;
+
+        Consumer (
+            util::Event &start_,
+            Adapter &adapter_,
+            std::size_t total_,
+            const Options &options_) :
+            start (start_),
+            adapter (adapter_),
+            total (total_),
+            options (options_),
+            sum (0) {}
+
+        virtual void Run () noexcept override {
+            start.Wait ();
+            std::vector<util::ui64> values (options.batchSize);
+            for (std::size_t popped = 0; popped < total;) {
+                std::size_t count = adapter.Pop (&values[0],
+                    (std::min) (total - popped, options.batchSize));
+                if (count == 0) {
+                    util::Thread::YieldSlice ();
+                }
+                for (std::size_t i = 0; i < count; ++i) {
+                    sum += values[i];
+                }
+                popped += count;
+            }
+        }
+    };
+
+    template<typename Adapter>
+    void Benchmark (
+            const char *name,
+            std::size_t producerCount,
+            const Options &options) {
+        // Hold the threads until they're all created so that they
+        // really do run concurrently.
+        util::Event start;
+        Adapter adapter (options.capacity, producerCount, options.iterations);
+        std::vector<std::unique_ptr<Producer<Adapter>>> producers;
+        for (std::size_t i = 0; i < producerCount; ++i) {
+            producers.emplace_back (new Producer<Adapter> (start, adapter, i, options));
+        }
+        Consumer<Adapter> consumer (
+            start, adapter, producerCount * options.iterations, options);
+        for (std::size_t i = 0; i < producers.size (); ++i) {
+            producers[i]->Create ();
+        }
+        consumer.Create ();
+        util::ui64 startTime = util::HRTimer::Click ();
+        start.Signal ();
+        for (std::size_t i = 0; i < producers.size (); ++i) {
+            Join (*producers[i]);
+        }
+        Join (consumer);
+        util::f64 seconds = util::HRTimer::ToSeconds (
+            util::HRTimer::ComputeElapsedTime (startTime, util::HRTimer::Click ()));
+        util::ui64 expected = producerCount *
+            (util::ui64)options.iterations * (options.iterations + 1) / 2;
+        // Every producer/consumer pair moved iterations values.
+        std::cout << "  " << name << ": " <<
+            options.iterations / seconds << " ops/s per pair" <<
+            (consumer.sum == expected ? "" : " (BROKEN)") << std::endl;
+    }
+}
+
+int main (
+        int argc,
+        const char *argv[]) {
+    Options options;
+    options.Parse (argc, argv, "icb");
+    if (options.iterations == 0 || options.capacity == 0 || options.batchSize == 0) {
+        std::cout << "usage: " << argv[0] <<
+            " [-i:iterations per producer] [-c:capacity] [-b:batch size]" << std::endl;
+        return 1;
+    }
+    std::cout << util::SystemInfo::Instance ()->GetCPUCount () << " cores, " <<
+        options.iterations << " values per producer, capacity " <<
+        options.capacity << ", batch size " << options.batchSize << std::endl;
+    std::cout << "1 producer:" << std::endl;
+    Benchmark<RingQueueAdapter<util::SPSCRingQueue<util::ui64>>> (
+        "SPSCRingQueue", 1, options);
+    Benchmark<RingQueueAdapter<util::BlockingRingQueue<util::SPSCRingQueue<util::ui64>>>> (
+        "BlockingRingQueue<SPSCRingQueue>", 1, options);
+    const std::size_t producerCounts[] = {1, 4};
+    for (std::size_t i = 0; i < THEKOGANS_UTIL_ARRAY_SIZE (producerCounts); ++i) {
+        if (producerCounts[i] != 1) {
+            std::cout << producerCounts[i] << " producers:" << std::endl;
+        }
+        Benchmark<RingQueueAdapter<util::MPSCRingQueue<util::ui64>>> (
+            "MPSCRingQueue", producerCounts[i], options);
+        Benchmark<RingQueueAdapter<util::BlockingRingQueue<util::MPSCRingQueue<util::ui64>>>> (
+            "BlockingRingQueue<MPSCRingQueue>", producerCounts[i], options);
+        Benchmark<IntrusiveAdapter> ("IntrusiveMPSCQueue", producerCounts[i], options);
+        Benchmark<MutexAdapter> ("Mutex + std::deque", producerCounts[i], options);
+    }
+    return 0;
+}
@@ -0,0 +1,179 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#include <iostream>
+#include <memory>
+#include <vector>
+#include "thekogans/util/Types.h"
+#include "thekogans/util/CommandLineOptions.h"
+#include "thekogans/util/StringUtils.h"
+#include "thekogans/util/SystemInfo.h"
+#include "thekogans/util/HRTimer.h"
+#include "thekogans/util/Thread.h"
+#include "thekogans/util/Event.h"
+#include "thekogans/util/RWLock.h"
+#include "thekogans/util/SpinRWLock.h"
+#include "thekogans/util/DistributedSpinRWLock.h"
+#include "thekogans/util/RWLockGuard.h"
+
+using namespace thekogans;
+
+namespace {
+    struct Options : public util::CommandLineOptions {
+        std::size_t iterations;
+        std::size_t writeRatio;
+
+        Options () :
+            iterations (100000),
+            writeRatio (100) {}
+
+        virtual void DoOption (
+                char option,
+                const std::string &value) override {
+            switch (option) {
+                case 'i':
+                    iterations = util::stringToui32 (value.c_str ());
+                    break;
+                case 'w':
+                    writeRatio = util::stringToui32 (value.c_str ());
+                    break;
+            }
+        }
+    };
+
+    // Thread::Wait returns false if the thread hasn't had a chance
+    // to run yet (very likely when oversubscribed).
+    inline void Join (util::Thread &thread) {
+        while (!thread.Wait ()) {
+            util::Thread::YieldSlice ();
+        }
+    }
+
+    // The protected data. Writers keep all the values equal,
+    // so readers can tell if they ever see a torn update.
+    struct Data {
+        enum {
+            COUNT = 8
+        };
+        util::ui64 values[COUNT];
+
+        Data () {
+            for (std::size_t i = 0; i < COUNT; ++i) {
+                values[i] = 0;
+            }
+        }
+    };
+
+    template<typename Lock>
+    struct Worker : public util::Thread {
+        util::Event &start;
+        Lock &lock;
+        Data &data;
+        std::size_t iterations;
+        std::size_t writeRatio;
+        std::size_t torn;
+
+        Worker (
+            util::Event &start_,
+            Lock &lock_,
+            Data &data_,
+            std::size_t iterations_,
+            std::size_t writeRatio_) :
+            start (start_),
+            lock (lock_),
+            data (data_),
+            iterations (iterations_),
+            writeRatio (writeRatio_),
+            torn (0) {}
+
+        virtual void Run () noexcept override {
+            start.Wait ();
+            for (std::size_t i = 0; i < iterations; ++i) {
+                if (writeRatio != 0 && i % writeRatio == 0) {
+                    util::RWLockGuard<Lock> guard (lock, false);
+                    for (std::size_t j = 0; j < Data::COUNT; ++j) {
+                        ++data.values[j];
+                    }
+                }
+                else {
+                    util::RWLockGuard<Lock> guard (lock, true);
+                    for (std::size_t j = 1; j < Data::COUNT; ++j) {
+                        if (data.values[j] != data.values[0]) {
+                            ++torn;
+                        }
+                    }
+                }
+            }
+        }
+    };
+
+    template<typename Lock>
+    void Benchmark (
+            const char *name,
+            std::size_t threadCount,
+            const Options &options) {
+        // Hold the workers until they're all created so that they
+        // really do run concurrently.
+        util::Event start;
+        Lock lock;
+        Data data;
+        std::vector<std::unique_ptr<Worker<Lock>>> workers;
+        for (std::size_t i = 0; i < threadCount; ++i) {
+            workers.emplace_back (
+                new Worker<Lock> (start, lock, data, options.iterations, options.writeRatio));
+        }
+        for (std::size_t i = 0; i < workers.size (); ++i) {
+            workers[i]->Create ();
+        }
+        util::ui64 startTime = util::HRTimer::Click ();
+        start.Signal ();
+        std::size_t torn = 0;
+        for (std::size_t i = 0; i < workers.size (); ++i) {
+            Join (*workers[i]);
+            torn += workers[i]->torn;
+        }
+        util::f64 seconds = util::HRTimer::ToSeconds (
+            util::HRTimer::ComputeElapsedTime (startTime, util::HRTimer::Click ()));
+        std::cout << "  " << name << ": " <<
+            threadCount * options.iterations / seconds << " ops/s" <<
+            (torn == 0 ? "" : " (BROKEN)") << std::endl;
+    }
+}
+
+int main (
+        int argc,
+        const char *argv[]) {
+    Options options;
+    options.Parse (argc, argv, "iw");
+    if (options.iterations == 0) {
+        std::cout << "usage: " << argv[0] <<
+            " [-i:iterations] [-w:writeRatio (1 in N ops is a write, 0 = no writes)]" << std::endl;
+        return 1;
+    }
+    std::cout << util::SystemInfo::Instance ()->GetCPUCount () << " cores, " <<
+        options.iterations << " iterations per thread, 1 in " <<
+        options.writeRatio << " is a write" << std::endl;
+    const std::size_t threadCounts[] = {1, 8, 32, 64};
+    for (std::size_t i = 0; i < THEKOGANS_UTIL_ARRAY_SIZE (threadCounts); ++i) {
+        std::cout << threadCounts[i] << " threads:" << std::endl;
+        Benchmark<util::RWLock> ("RWLock", threadCounts[i], options);
+        Benchmark<util::SpinRWLock> ("SpinRWLock", threadCounts[i], options);
+        Benchmark<util::DistributedSpinRWLock> (
+            "DistributedSpinRWLock", threadCounts[i], options);
+    }
+    return 0;
+}
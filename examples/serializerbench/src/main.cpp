@@ -0,0 +1,234 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <iostream>
+#include "thekogans/util/Types.h"
+#include "thekogans/util/CommandLineOptions.h"
+#include "thekogans/util/StringUtils.h"
+#include "thekogans/util/HRTimer.h"
+#include "thekogans/util/Serializer.h"
+#include "thekogans/util/Buffer.h"
+#include "thekogans/util/Fraction.h"
+
+using namespace thekogans;
+
+namespace {
+    struct Options : public util::CommandLineOptions {
+        std::size_t count;
+
+        Options () :
+            count (1000000) {}
+
+        virtual void DoOption (
+                char option,
+                const std::string &value) override {
+            switch (option) {
+                case 'c':
+                    count = util::stringToui32 (value.c_str ());
+                    break;
+            }
+        }
+    };
+
+    // A typical 20 field record.
+    struct Record {
+        util::ui32 id;
+        util::ui32 flags;
+        util::ui32 a;
+        util::ui32 b;
+        util::ui32 c;
+        util::ui32 d;
+        util::ui64 created;
+        util::ui64 modified;
+        util::ui64 offset;
+        util::ui64 length;
+        util::i16 x;
+        util::i16 y;
+        util::i16 z;
+        util::i16 w;
+        util::f64 latitude;
+        util::f64 longitude;
+        util::f64 altitude;
+        bool visible;
+        bool locked;
+        bool dirty;
+
+        explicit Record (util::ui32 id_ = 0) :
+            id (id_), flags (id_ * 3), a (id_ + 1), b (id_ + 2), c (id_ + 3), d (id_ + 4),
+            created (id_ * 5ull), modified (id_ * 7ull), offset (id_ * 11ull), length (id_ * 13ull),
+            x ((util::i16)id_), y ((util::i16)(id_ >> 1)), z ((util::i16)(id_ >> 2)), w ((util::i16)(id_ >> 3)),
+            latitude (id_ * 0.5), longitude (id_ * 0.25), altitude (id_ * 0.125),
+            visible ((id_ & 1) != 0), locked ((id_ & 2) != 0), dirty ((id_ & 4) != 0) {}
+
+        static std::size_t Size () {
+            return
+                6 * util::UI32_SIZE +
+                4 * util::UI64_SIZE +
+                4 * util::I16_SIZE +
+                3 * util::F64_SIZE +
+                3 * util::BOOL_SIZE;
+        }
+
+        void Write (util::Serializer &serializer) const {
+            serializer << id << flags << a << b << c << d <<
+                created << modified << offset << length <<
+                x << y << z << w <<
+                latitude << longitude << altitude <<
+                visible << locked << dirty;
+        }
+
+        void Read (util::Serializer &serializer) {
+            serializer >> id >> flags >> a >> b >> c >> d >>
+                created >> modified >> offset >> length >>
+                x >> y >> z >> w >>
+                latitude >> longitude >> altitude >>
+                visible >> locked >> dirty;
+        }
+
+        inline util::ui64 Checksum () const {
+            return id + flags + a + b + c + d + created + modified + offset + length +
+                (util::ui64)(x + y + z + w) + (util::ui64)(latitude + longitude + altitude) +
+                visible + locked + dirty;
+        }
+    };
+
+    // What every primitive insertion/extraction used to cost: a virtual
+    // Read/Write per value. Forwards to a Buffer it doesn't let the
+    // Serializer know about.
+    struct VirtualSerializer : public util::Serializer {
+        util::Buffer &buffer;
+
+        explicit VirtualSerializer (util::Buffer &buffer_) :
+            Serializer (buffer_.endianness),
+            buffer (buffer_) {}
+
+        virtual const char *Type () const noexcept override {
+            return "VirtualSerializer";
+        }
+        virtual const char * const *Bases () const noexcept override {
+            static const char * const bases[] = {Serializer::TYPE, nullptr};
+            return bases;
+        }
+
+        virtual std::size_t Read (
+                void *data,
+                std::size_t count) override {
+            return buffer.Read (data, count);
+        }
+        virtual std::size_t Write (
+                const void *data,
+                std::size_t count) override {
+            return buffer.Write (data, count);
+        }
+    };
+
+    struct RecordTraits {
+        static const char *Name () {
+            return "20 field record";
+        }
+        static std::size_t Size () {
+            return Record::Size ();
+        }
+        static void Write (
+                util::Serializer &serializer,
+                std::size_t i) {
+            Record ((util::ui32)i).Write (serializer);
+        }
+        static util::ui64 Read (util::Serializer &serializer) {
+            Record record;
+            record.Read (serializer);
+            return record.Checksum ();
+        }
+        static util::ui64 Checksum (std::size_t i) {
+            return Record ((util::ui32)i).Checksum ();
+        }
+    };
+
+    // A real Serializable (header + 3 fields).
+    struct FractionTraits {
+        static const char *Name () {
+            return "Fraction (Serializable)";
+        }
+        static std::size_t Size () {
+            return util::Fraction::One.GetSize ();
+        }
+        static void Write (
+                util::Serializer &serializer,
+                std::size_t i) {
+            serializer << util::Fraction ((util::ui32)i, (util::ui32)i + 1);
+        }
+        static util::ui64 Read (util::Serializer &serializer) {
+            util::Fraction fraction;
+            serializer >> fraction;
+            return fraction.numerator + fraction.denominator;
+        }
+        static util::ui64 Checksum (std::size_t i) {
+            return 2 * (util::ui64)i + 1;
+        }
+    };
+
+    inline util::f64 Now () {
+        return util::HRTimer::ToSeconds (util::HRTimer::Click ());
+    }
+
+    template<typename Traits>
+    void Benchmark (const Options &options) {
+        util::Buffer buffer (util::NetworkEndian, options.count * Traits::Size ());
+        util::ui64 expected = 0;
+        for (std::size_t i = 0; i < options.count; ++i) {
+            expected += Traits::Checksum (i);
+        }
+        std::cout << Traits::Name () << " (" << Traits::Size () << " bytes):" << std::endl;
+        for (int pass = 0; pass < 2; ++pass) {
+            buffer.Rewind ();
+            VirtualSerializer virtualSerializer (buffer);
+            util::Serializer &serializer = pass == 0 ?
+                (util::Serializer &)virtualSerializer : (util::Serializer &)buffer;
+            util::f64 start = Now ();
+            for (std::size_t i = 0; i < options.count; ++i) {
+                Traits::Write (serializer, i);
+            }
+            util::f64 writeSeconds = Now () - start;
+            util::ui64 checksum = 0;
+            start = Now ();
+            for (std::size_t i = 0; i < options.count; ++i) {
+                checksum += Traits::Read (serializer);
+            }
+            util::f64 readSeconds = Now () - start;
+            std::cout << "  " << (pass == 0 ? "virtual Read/Write" : "Buffer fast path  ") <<
+                ": marshal " << writeSeconds * 1000.0 << " ms, unmarshal " <<
+                readSeconds * 1000.0 << " ms" <<
+                (checksum == expected && buffer.IsEmpty () ? "" : " (BROKEN)") << std::endl;
+        }
+    }
+}
+
+int main (
+        int argc,
+        const char *argv[]) {
+    Options options;
+    options.Parse (argc, argv, "c");
+    if (options.count == 0) {
+        std::cout << "usage: " << argv[0] << " [-c:object count]" << std::endl;
+        return 1;
+    }
+    std::cout << options.count << " objects" << std::endl;
+    Benchmark<RecordTraits> (options);
+    Benchmark<FractionTraits> (options);
+    return 0;
+}
@@ -0,0 +1,206 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <atomic>
+#include "thekogans/util/Types.h"
+#include "thekogans/util/CommandLineOptions.h"
+#include "thekogans/util/StringUtils.h"
+#include "thekogans/util/SystemInfo.h"
+#include "thekogans/util/HRTimer.h"
+#include "thekogans/util/TimeSpec.h"
+#include "thekogans/util/Thread.h"
+#include "thekogans/util/Barrier.h"
+#include "thekogans/util/SpinBarrier.h"
+#include "thekogans/util/Vectorizer.h"
+
+using namespace thekogans;
+
+namespace {
+    struct Options : public util::CommandLineOptions {
+        std::size_t iterations;
+
+        Options () :
+            iterations (10000) {}
+
+        virtual void DoOption (
+                char option,
+                const std::string &value) override {
+            switch (option) {
+                case 'i':
+                    iterations = util::stringToui32 (value.c_str ());
+                    break;
+            }
+        }
+    };
+
+    // Thread::Wait returns false if the thread hasn't had a chance
+    // to run yet (very likely when oversubscribed).
+    inline void Join (util::Thread &thread) {
+        while (!thread.Wait ()) {
+            util::Thread::YieldSlice ();
+        }
+    }
+
+    // Every worker bumps its own slot, so the job is as
+    // short as it gets and all we measure is the round trip.
+    struct Job : public util::Vectorizer::Job {
+        std::vector<util::ui64> slots;
+
+        explicit Job (std::size_t workerCount) :
+            slots (workerCount, 0) {}
+
+        virtual void Execute (
+                std::size_t startIndex,
+                std::size_t endIndex,
+                std::size_t /*rank*/) noexcept override {
+            for (; startIndex < endIndex; ++startIndex) {
+                ++slots[startIndex];
+            }
+        }
+
+        virtual std::size_t Size () const noexcept override {
+            return slots.size ();
+        }
+
+        bool Check (std::size_t iterations) const {
+            for (std::size_t i = 0, count = slots.size (); i < count; ++i) {
+                if (slots[i] != iterations) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    };
+
+    // Mirrors the Vectorizer fork-join protocol (two barrier
+    // crossings per Execute) so that barriers can be compared
+    // without the rest of the Vectorizer machinery.
+    template<typename BarrierType>
+    struct ForkJoin {
+        struct Worker : public util::Thread {
+            ForkJoin &forkJoin;
+            std::size_t rank;
+
+            Worker (
+                ForkJoin &forkJoin_,
+                std::size_t rank_) :
+                forkJoin (forkJoin_),
+                rank (rank_) {}
+
+            virtual void Run () noexcept override {
+                // NOTE: done is checked right after the first
+                // barrier (see Vectorizer::Worker::Run).
+                for (;;) {
+                    forkJoin.barrier.Wait ();
+                    if (forkJoin.done) {
+                        break;
+                    }
+                    forkJoin.job->Execute (rank, rank + 1, rank);
+                    forkJoin.barrier.Wait ();
+                }
+            }
+        };
+
+        std::atomic<bool> done;
+        BarrierType barrier;
+        Job *job;
+        std::vector<std::unique_ptr<Worker>> workers;
+
+        explicit ForkJoin (std::size_t workerCount) :
+                done (false),
+                barrier (workerCount),
+                job (nullptr) {
+            for (std::size_t i = 1; i < workerCount; ++i) {
+                workers.emplace_back (new Worker (*this, i));
+                workers.back ()->Create ();
+            }
+        }
+
+        ~ForkJoin () {
+            done = true;
+            barrier.Wait ();
+            for (std::size_t i = 0; i < workers.size (); ++i) {
+                Join (*workers[i]);
+            }
+        }
+
+        void Execute (Job &job_) {
+            job = &job_;
+            barrier.Wait ();
+            job->Execute (0, 1, 0);
+            barrier.Wait ();
+            job = nullptr;
+        }
+    };
+
+    template<typename Executor>
+    void Benchmark (
+            const char *name,
+            Executor &executor,
+            std::size_t workerCount,
+            const Options &options) {
+        Job job (workerCount);
+        util::ui64 startTime = util::HRTimer::Click ();
+        for (std::size_t i = 0; i < options.iterations; ++i) {
+            executor.Execute (job);
+        }
+        util::f64 seconds = util::HRTimer::ToSeconds (
+            util::HRTimer::ComputeElapsedTime (startTime, util::HRTimer::Click ()));
+        std::cout << "  " << name << ": " <<
+            seconds * 1000000 / options.iterations << " us/Execute" <<
+            (job.Check (options.iterations) ? "" : " (BROKEN)") << std::endl;
+    }
+}
+
+int main (
+        int argc,
+        const char *argv[]) {
+    Options options;
+    options.Parse (argc, argv, "i");
+    if (options.iterations == 0) {
+        std::cout << "usage: " << argv[0] << " [-i:iterations]" << std::endl;
+        return 1;
+    }
+    std::cout << util::SystemInfo::Instance ()->GetCPUCount () << " cores, " <<
+        options.iterations << " Execute round trips" << std::endl;
+    const std::size_t workerCounts[] = {4, 16, 64};
+    for (std::size_t i = 0; i < THEKOGANS_UTIL_ARRAY_SIZE (workerCounts); ++i) {
+        std::cout << workerCounts[i] << " workers:" << std::endl;
+        {
+            ForkJoin<util::Barrier> forkJoin (workerCounts[i]);
+            Benchmark ("Barrier", forkJoin, workerCounts[i], options);
+        }
+        {
+            ForkJoin<util::SpinBarrier> forkJoin (workerCounts[i]);
+            Benchmark ("SpinBarrier", forkJoin, workerCounts[i], options);
+        }
+        {
+            // Park right away (no spinning).
+            util::Vectorizer vectorizer (workerCounts[i],
+                THEKOGANS_UTIL_NORMAL_THREAD_PRIORITY, util::TimeSpec::Zero);
+            Benchmark ("Vectorizer (no spin)", vectorizer, workerCounts[i], options);
+        }
+        {
+            util::Vectorizer vectorizer (workerCounts[i]);
+            Benchmark ("Vectorizer", vectorizer, workerCounts[i], options);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,323 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_util_AsyncFile_h)
+#define __thekogans_util_AsyncFile_h
+
+#include "thekogans/util/Environment.h"
+#if !defined (TOOLCHAIN_OS_Windows)
+    #include <fcntl.h>
+    #include <sys/stat.h>
+#endif // !defined (TOOLCHAIN_OS_Windows)
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+#include <utility>
+#include "thekogans/util/Config.h"
+#include "thekogans/util/Types.h"
+#include "thekogans/util/Constants.h"
+#include "thekogans/util/RefCounted.h"
+#include "thekogans/util/RunLoop.h"
+#include "thekogans/util/File.h"
+
+namespace thekogans {
+    namespace util {
+
+        /// \struct AsyncIOService AsyncFile.h thekogans/util/AsyncFile.h
+        ///
+        /// \brief
+        /// AsyncIOService executes positional reads, writes and syncs off the calling
+        /// thread and delivers their completions on a \see{RunLoop} of your choosing.
+        /// Use AsyncIOService::Create to get an instance. On Linux (when the kernel
+        /// allows it) you get an io_uring backed service that batches requests in to
+        /// a single system call and supports registered (pinned) buffers. Everywhere
+        /// else (or when io_uring is unavailable) you get a \see{JobQueue} backed thread
+        /// pool that issues the same requests synchronously. Both honor the same contract
+        /// so code written against one will work with the other.
+
+        struct _LIB_THEKOGANS_UTIL_DECL AsyncIOService : public virtual RefCounted {
+            /// \brief
+            /// Declare \see{RefCounted} pointers.
+            THEKOGANS_UTIL_DECLARE_REF_COUNTED_POINTERS (AsyncIOService)
+
+            /// \brief
+            /// Alias for std::function<void (THEKOGANS_UTIL_ERROR_CODE /*errorCode*/,
+            /// std::size_t /*count*/)>.
+            /// \param[in] errorCode 0 == success, otherwise the OS error code.
+            /// \param[in] count Number of bytes transferred (0 for Flush).
+            using Callback = std::function<void (
+                THEKOGANS_UTIL_ERROR_CODE /*errorCode*/,
+                std::size_t /*count*/)>;
+            /// \brief
+            /// Alias for std::vector<std::pair<void *, std::size_t>>.
+            using BufferList = std::vector<std::pair<void *, std::size_t>>;
+
+            /// \brief
+            /// Default io_uring submission queue depth.
+            static const ui32 DEFAULT_QUEUE_DEPTH = 256;
+            /// \brief
+            /// Default number of fallback thread pool workers.
+            static const std::size_t DEFAULT_WORKER_COUNT = 4;
+
+            /// \brief
+            /// Create an AsyncIOService best suited for the platform.
+            /// \param[in] queueDepth io_uring submission queue depth.
+            /// \param[in] workerCount Fallback thread pool worker count.
+            /// \param[in] useIORing false == Always use the fallback thread pool.
+            /// \return AsyncIOService instance.
+            static SharedPtr Create (
+                ui32 queueDepth = DEFAULT_QUEUE_DEPTH,
+                std::size_t workerCount = DEFAULT_WORKER_COUNT,
+                bool useIORing = true);
+
+            /// \brief
+            /// dtor.
+            virtual ~AsyncIOService () {}
+
+            /// \brief
+            /// Return true if the service is io_uring backed.
+            /// \return true == io_uring, false == thread pool.
+            virtual bool IsIORing () const = 0;
+
+            /// \brief
+            /// Register (pin) buffers with the service. Pass the buffer's index in
+            /// to Read/Write to use it. The thread pool service ignores registration.
+            /// NOTE: Don't call this while there are requests in flight.
+            /// \param[in] buffers Buffers to register.
+            virtual void RegisterBuffers (const BufferList & /*buffers*/) = 0;
+
+            /// \brief
+            /// Read count bytes from handle at offset.
+            /// \param[in] handle File to read from.
+            /// \param[in] offset File offset to read from.
+            /// \param[out] buffer Where to place the bytes.
+            /// \param[in] count Number of bytes to read.
+            /// \param[in] bufferIndex If != NIDX32, buffer lies in the registered buffer at this index.
+            /// \param[in] runLoop \see{RunLoop} to deliver the completion on
+            /// (nullptr == deliver on the service thread).
+            /// \param[in] callback Completion callback.
+            /// \param[in] submit false == Batch the request until the next Submit.
+            virtual void Read (
+                THEKOGANS_UTIL_HANDLE handle,
+                ui64 offset,
+                void *buffer,
+                std::size_t count,
+                ui32 bufferIndex,
+                RunLoop::SharedPtr runLoop,
+                const Callback &callback,
+                bool submit = true) = 0;
+            /// \brief
+            /// Write count bytes to handle at offset.
+            /// \param[in] handle File to write to.
+            /// \param[in] offset File offset to write to.
+            /// \param[in] buffer Where the bytes come from.
+            /// \param[in] count Number of bytes to write.
+            /// \param[in] bufferIndex If != NIDX32, buffer lies in the registered buffer at this index.
+            /// \param[in] runLoop \see{RunLoop} to deliver the completion on
+            /// (nullptr == deliver on the service thread).
+            /// \param[in] callback Completion callback.
+            /// \param[in] submit false == Batch the request until the next Submit.
+            virtual void Write (
+                THEKOGANS_UTIL_HANDLE handle,
+                ui64 offset,
+                const void *buffer,
+                std::size_t count,
+                ui32 bufferIndex,
+                RunLoop::SharedPtr runLoop,
+                const Callback &callback,
+                bool submit = true) = 0;
+            /// \brief
+            /// Flush handle's pending writes to disk.
+            /// \param[in] handle File to flush.
+            /// \param[in] dataOnly true == Don't flush metadata (fdatasync).
+            /// \param[in] runLoop \see{RunLoop} to deliver the completion on
+            /// (nullptr == deliver on the service thread).
+            /// \param[in] callback Completion callback.
+            /// \param[in] submit false == Batch the request until the next Submit.
+            virtual void Flush (
+                THEKOGANS_UTIL_HANDLE handle,
+                bool dataOnly,
+                RunLoop::SharedPtr runLoop,
+                const Callback &callback,
+                bool submit = true) = 0;
+            /// \brief
+            /// Submit all batched requests.
+            virtual void Submit () = 0;
+        };
+
+        /// \struct AsyncFile AsyncFile.h thekogans/util/AsyncFile.h
+        ///
+        /// \brief
+        /// AsyncFile is a \see{File} that adds asynchronous, positional I/O through
+        /// an \see{AsyncIOService}. The synchronous \see{Serializer} interface remains
+        /// available. Completions are delivered on the \see{RunLoop} passed in to the
+        /// ctor. Ex:
+        ///
+        /// \code{.cpp}
+        /// using namespace thekogans;
+        ///
+        /// util::AsyncIOService::SharedPtr service = util::AsyncIOService::Create ();
+        /// util::AsyncFile file (service, runLoop, util::HostEndian, path, O_RDONLY);
+        /// file.AsyncRead (0, buffer, length,
+        ///     [] (THEKOGANS_UTIL_ERROR_CODE errorCode, std::size_t count) {
+        ///         // Executes on runLoop.
+        ///     });
+        /// \endcode
+        ///
+        /// IMPORTANT: The buffers, and the file itself must outlive the requests
+        /// issued against them. Don't close the file until all callbacks have fired.
+
+        struct _LIB_THEKOGANS_UTIL_DECL AsyncFile : public File {
+        protected:
+            /// \brief
+            /// Service executing the requests.
+            AsyncIOService::SharedPtr service;
+            /// \brief
+            /// \see{RunLoop} to deliver completions on.
+            RunLoop::SharedPtr runLoop;
+
+        public:
+            /// \brief
+            /// ctor.
+            /// \param[in] service_ Service executing the requests.
+            /// \param[in] runLoop_ \see{RunLoop} to deliver completions on
+            /// (nullptr == deliver on the service thread).
+            /// \param[in] endianness File endianness.
+            /// \param[in] handle OS file handle.
+            /// \param[in] path File path.
+            AsyncFile (
+                AsyncIOService::SharedPtr service_,
+                RunLoop::SharedPtr runLoop_ = nullptr,
+                Endianness endianness = HostEndian,
+                THEKOGANS_UTIL_HANDLE handle = THEKOGANS_UTIL_INVALID_HANDLE_VALUE,
+                const std::string &path = std::string ()) :
+                File (endianness, handle, path),
+                service (service_),
+                runLoop (runLoop_) {}
+            /// \brief
+            /// ctor. Open the file.
+            /// \param[in] service_ Service executing the requests.
+            /// \param[in] runLoop_ \see{RunLoop} to deliver completions on
+            /// (nullptr == deliver on the service thread).
+            /// \param[in] endianness File endianness.
+        #if defined (TOOLCHAIN_OS_Windows)
+            /// \param[in] path Path to file to open.
+            /// \param[in] dwDesiredAccess Windows CreateFile parameter.
+            /// \param[in] dwShareMode Windows CreateFile parameter.
+            /// \param[in] dwCreationDisposition Windows CreateFile parameter.
+            /// \param[in] dwFlagsAndAttributes Windows CreateFile parameter.
+        #else // defined (TOOLCHAIN_OS_Windows)
+            /// \param[in] path Path to file to open.
+            /// \param[in] flags POSIX open parameter (O_DIRECT is fine here).
+            /// \param[in] mode POSIX open parameter.
+        #endif // defined (TOOLCHAIN_OS_Windows)
+            AsyncFile (
+                AsyncIOService::SharedPtr service_,
+                RunLoop::SharedPtr runLoop_,
+                Endianness endianness,
+                const std::string &path,
+            #if defined (TOOLCHAIN_OS_Windows)
+                DWORD dwDesiredAccess = GENERIC_READ | GENERIC_WRITE,
+                DWORD dwShareMode = FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                DWORD dwCreationDisposition = OPEN_ALWAYS,
+                DWORD dwFlagsAndAttributes = FILE_ATTRIBUTE_NORMAL) :
+                File (endianness, path, dwDesiredAccess,
+                    dwShareMode, dwCreationDisposition, dwFlagsAndAttributes),
+            #else // defined (TOOLCHAIN_OS_Windows)
+                i32 flags = O_RDWR | O_CREAT,
+                i32 mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH) :
+                File (endianness, path, flags, mode),
+            #endif // defined (TOOLCHAIN_OS_Windows)
+                service (service_),
+                runLoop (runLoop_) {}
+
+            /// \brief
+            /// Return the service executing the requests.
+            /// \return Service executing the requests.
+            inline AsyncIOService::SharedPtr GetService () const {
+                return service;
+            }
+            /// \brief
+            /// Return the \see{RunLoop} completions are delivered on.
+            /// \return \see{RunLoop} completions are delivered on.
+            inline RunLoop::SharedPtr GetRunLoop () const {
+                return runLoop;
+            }
+
+            /// \brief
+            /// Read count bytes at offset.
+            /// \param[in] offset File offset to read from.
+            /// \param[out] buffer Where to place the bytes.
+            /// \param[in] count Number of bytes to read.
+            /// \param[in] callback Completion callback.
+            /// \param[in] bufferIndex If != NIDX32, buffer lies in the registered buffer at this index.
+            /// \param[in] submit false == Batch the request until the next Submit.
+            inline void AsyncRead (
+                    ui64 offset,
+                    void *buffer,
+                    std::size_t count,
+                    const AsyncIOService::Callback &callback,
+                    ui32 bufferIndex = NIDX32,
+                    bool submit = true) {
+                service->Read (handle, offset, buffer, count,
+                    bufferIndex, runLoop, callback, submit);
+            }
+            /// \brief
+            /// Write count bytes at offset.
+            /// \param[in] offset File offset to write to.
+            /// \param[in] buffer Where the bytes come from.
+            /// \param[in] count Number of bytes to write.
+            /// \param[in] callback Completion callback.
+            /// \param[in] bufferIndex If != NIDX32, buffer lies in the registered buffer at this index.
+            /// \param[in] submit false == Batch the request until the next Submit.
+            inline void AsyncWrite (
+                    ui64 offset,
+                    const void *buffer,
+                    std::size_t count,
+                    const AsyncIOService::Callback &callback,
+                    ui32 bufferIndex = NIDX32,
+                    bool submit = true) {
+                service->Write (handle, offset, buffer, count,
+                    bufferIndex, runLoop, callback, submit);
+            }
+            /// \brief
+            /// Flush pending writes to disk.
+            /// \param[in] callback Completion callback.
+            /// \param[in] dataOnly true == Don't flush metadata (fdatasync).
+            /// \param[in] submit false == Batch the request until the next Submit.
+            inline void AsyncFlush (
+                    const AsyncIOService::Callback &callback,
+                    bool dataOnly = false,
+                    bool submit = true) {
+                service->Flush (handle, dataOnly, runLoop, callback, submit);
+            }
+            /// \brief
+            /// Submit all batched requests.
+            inline void Submit () {
+                service->Submit ();
+            }
+
+            /// \brief
+            /// AsyncFile is neither copy constructable, nor assignable.
+            THEKOGANS_UTIL_DISALLOW_COPY_AND_ASSIGN (AsyncFile)
+        };
+
+    } // namespace util
+} // namespace thekogans
+
+#endif // !defined (__thekogans_util_AsyncFile_h)
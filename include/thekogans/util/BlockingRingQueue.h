@@ -0,0 +1,252 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_util_BlockingRingQueue_h)
+#define __thekogans_util_BlockingRingQueue_h
+
+#include <cstddef>
+#include <utility>
+#include "thekogans/util/Config.h"
+#include "thekogans/util/TimeSpec.h"
+#include "thekogans/util/Thread.h"
+#include "thekogans/util/EventCount.h"
+
+namespace thekogans {
+    namespace util {
+
+        /// \struct BlockingRingQueue BlockingRingQueue.h thekogans/util/BlockingRingQueue.h
+        ///
+        /// \brief
+        /// BlockingRingQueue adds blocking Push/Pop to \see{SPSCRingQueue} and
+        /// \see{MPSCRingQueue}. As long as the queue is neither empty nor full,
+        /// Push/Pop are the lock-free queue operations plus one fence and one
+        /// load (\see{EventCount::Notify}). A thread that finds the queue
+        /// empty (full) spins for a little while and then parks (on a futex
+        /// on Linux) until the other side makes progress.
+        ///
+        /// \code{.cpp}
+        /// using namespace thekogans;
+        ///
+        /// util::BlockingRingQueue<util::MPSCRingQueue<Message>> queue (1024);
+        /// \endcode
+        ///
+        /// IMPORTANT: BlockingRingQueue does not relax the thread restrictions
+        /// of the queue it wraps.
+
+        template<typename Queue>
+        struct BlockingRingQueue {
+            /// \brief
+            /// Alias for Queue::ValueType.
+            using ValueType = typename Queue::ValueType;
+
+            /// \brief
+            /// Default number of times to retry before parking.
+            static const std::size_t DEFAULT_SPIN_COUNT = 64;
+
+        private:
+            /// \brief
+            /// Wrapped queue.
+            Queue queue;
+            /// \brief
+            /// Number of times to retry before parking.
+            const std::size_t spinCount;
+            /// \brief
+            /// Consumers park here when the queue is empty.
+            EventCount notEmpty;
+            /// \brief
+            /// Producers park here when the queue is full.
+            EventCount notFull;
+
+        public:
+            /// \brief
+            /// ctor.
+            /// \param[in] capacity Max number of queued values (rounded up to a power of 2).
+            /// \param[in] spinCount_ Number of times to retry before parking.
+            explicit BlockingRingQueue (
+                std::size_t capacity,
+                std::size_t spinCount_ = DEFAULT_SPIN_COUNT) :
+                queue (capacity),
+                spinCount (spinCount_) {}
+
+            /// \brief
+            /// Return the wrapped queue.
+            /// \return The wrapped queue.
+            inline Queue &GetQueue () {
+                return queue;
+            }
+
+            /// \brief
+            /// Push a value, waiting for room if the queue is full.
+            /// \param[in] value Value to push.
+            /// \param[in] timeSpec How long to wait for room.
+            /// IMPORTANT: timeSpec is a relative value.
+            /// \return true == pushed, false == timed out.
+            bool Push (
+                    const ValueType &value,
+                    const TimeSpec &timeSpec = TimeSpec::Infinite) {
+                if (Wait (notFull, [&] () {return queue.Push (value);}, timeSpec)) {
+                    notEmpty.Notify ();
+                    return true;
+                }
+                return false;
+            }
+            /// \brief
+            /// Push a value without waiting.
+            /// \param[in] value Value to push.
+            /// \return true == pushed, false == the queue is full.
+            bool TryPush (const ValueType &value) {
+                if (queue.Push (value)) {
+                    notEmpty.Notify ();
+                    return true;
+                }
+                return false;
+            }
+            /// \brief
+            /// Push as many of the given values as will fit, waiting
+            /// for room for at least one of them.
+            /// \param[in] values Values to push.
+            /// \param[in] count Number of values.
+            /// \param[in] timeSpec How long to wait for room.
+            /// IMPORTANT: timeSpec is a relative value.
+            /// \return Number of values pushed (0 == timed out).
+            std::size_t PushBatch (
+                    const ValueType *values,
+                    std::size_t count,
+                    const TimeSpec &timeSpec = TimeSpec::Infinite) {
+                std::size_t pushed = 0;
+                if (count > 0 && Wait (notFull,
+                        [&] () {
+                            pushed = queue.PushBatch (values, count);
+                            return pushed > 0;
+                        },
+                        timeSpec)) {
+                    if (pushed > 1) {
+                        notEmpty.NotifyAll ();
+                    }
+                    else {
+                        notEmpty.Notify ();
+                    }
+                }
+                return pushed;
+            }
+
+            /// \brief
+            /// Pop a value, waiting for one if the queue is empty.
+            /// \param[out] value Where to put the popped value.
+            /// \param[in] timeSpec How long to wait for a value.
+            /// IMPORTANT: timeSpec is a relative value.
+            /// \return true == popped, false == timed out.
+            bool Pop (
+                    ValueType &value,
+                    const TimeSpec &timeSpec = TimeSpec::Infinite) {
+                if (Wait (notEmpty, [&] () {return queue.Pop (value);}, timeSpec)) {
+                    notFull.Notify ();
+                    return true;
+                }
+                return false;
+            }
+            /// \brief
+            /// Pop a value without waiting.
+            /// \param[out] value Where to put the popped value.
+            /// \return true == popped, false == the queue is empty.
+            bool TryPop (ValueType &value) {
+                if (queue.Pop (value)) {
+                    notFull.Notify ();
+                    return true;
+                }
+                return false;
+            }
+            /// \brief
+            /// Pop up to count values, waiting for at least one.
+            /// \param[out] values Where to put the popped values.
+            /// \param[in] count Max number of values to pop.
+            /// \param[in] timeSpec How long to wait for a value.
+            /// IMPORTANT: timeSpec is a relative value.
+            /// \return Number of values popped (0 == timed out).
+            std::size_t PopBatch (
+                    ValueType *values,
+                    std::size_t count,
+                    const TimeSpec &timeSpec = TimeSpec::Infinite) {
+                std::size_t popped = 0;
+                if (count > 0 && Wait (notEmpty,
+                        [&] () {
+                            popped = queue.PopBatch (values, count);
+                            return popped > 0;
+                        },
+                        timeSpec)) {
+                    if (popped > 1) {
+                        notFull.NotifyAll ();
+                    }
+                    else {
+                        notFull.Notify ();
+                    }
+                }
+                return popped;
+            }
+
+        private:
+            /// \brief
+            /// Call tryOp until it succeeds. Spin first, then park on eventCount.
+            /// \param[in] eventCount \see{EventCount} to park on.
+            /// \param[in] tryOp Non-blocking queue operation.
+            /// \param[in] timeSpec How long to wait.
+            /// \return true == tryOp succeeded, false == timed out.
+            template<typename TryOp>
+            bool Wait (
+                    EventCount &eventCount,
+                    TryOp tryOp,
+                    const TimeSpec &timeSpec) {
+                Thread::Backoff backoff;
+                for (std::size_t i = 0; i < spinCount; ++i) {
+                    if (tryOp ()) {
+                        return true;
+                    }
+                    backoff.Pause ();
+                }
+                if (timeSpec == TimeSpec::Zero) {
+                    return tryOp ();
+                }
+                TimeSpec deadline = timeSpec == TimeSpec::Infinite ?
+                    TimeSpec::Infinite : GetCurrentTime () + timeSpec;
+                for (;;) {
+                    ui32 key = eventCount.PrepareWait ();
+                    if (tryOp ()) {
+                        eventCount.CancelWait ();
+                        return true;
+                    }
+                    TimeSpec remaining = TimeSpec::Infinite;
+                    if (deadline != TimeSpec::Infinite) {
+                        TimeSpec now = GetCurrentTime ();
+                        if (now >= deadline) {
+                            eventCount.CancelWait ();
+                            return false;
+                        }
+                        remaining = deadline - now;
+                    }
+                    eventCount.Wait (key, remaining);
+                }
+            }
+
+            /// \brief
+            /// BlockingRingQueue is neither copy constructable, nor assignable.
+            THEKOGANS_UTIL_DISALLOW_COPY_AND_ASSIGN (BlockingRingQueue)
+        };
+
+    } // namespace util
+} // namespace thekogans
+
+#endif // !defined (__thekogans_util_BlockingRingQueue_h)
@@ -29,6 +29,7 @@
 #include "thekogans/util/Types.h"
 #include "thekogans/util/Constants.h"
 #include "thekogans/util/SizeT.h"
+#include "thekogans/util/ByteView.h"
 #include "thekogans/util/RefCounted.h"
 #include "thekogans/util/SpinLock.h"
 #include "thekogans/util/Exception.h"
@@ -42,6 +43,10 @@
 namespace thekogans {
     namespace util {
 
+        /// \brief
+        /// Forward declaration of \see{BufferChain}.
+        struct BufferChain;
+
         /// \struct Buffer Buffer.h thekogans/util/Buffer.h
         ///
         /// \brief
@@ -115,7 +120,7 @@ namespace thekogans {
             /// Move ctor.
             /// \param[in,out] other Buffer to move.
             Buffer (Buffer &&other) :
-                    Serializer (HostEndian),
+                    Serializer (HostEndian, this, this),
                     data (nullptr),
                     length (0),
                     readOffset (0),
@@ -138,7 +143,7 @@ namespace thekogans {
                 std::size_t readOffset_ = 0,
                 std::size_t writeOffset_ = 0,
                 Allocator::SharedPtr allocator_ = DefaultAllocator::Instance ()) :
-                Serializer (endianness),
+                Serializer (endianness, this, this),
                 data ((ui8 *)data_),
                 length (length_),
                 readOffset (readOffset_),
@@ -157,7 +162,7 @@ namespace thekogans {
                 std::size_t readOffset_ = 0,
                 std::size_t writeOffset_ = 0,
                 Allocator::SharedPtr allocator_ = DefaultAllocator::Instance ()) :
-                Serializer (endianness),
+                Serializer (endianness, this, this),
                 data ((ui8 *)allocator_->Alloc (length_)),
                 length (length_),
                 readOffset (readOffset_),
@@ -178,6 +183,35 @@ namespace thekogans {
                 std::size_t readOffset_ = 0,
                 std::size_t writeOffset_ = SIZE_T_MAX,
                 Allocator::SharedPtr allocator_ = DefaultAllocator::Instance ());
+
+        protected:
+            /// \brief
+            /// ctor for derivatives that override Write (\see{TenantReadBuffer}).
+            /// Same as the raw data pointer ctor above, except inserts
+            /// can be made to bypass the fixed size fast paths.
+            /// \param[in] endianness How multi-byte values are stored.
+            /// \param[in] data_ Pointer to wrap.
+            /// \param[in] length_ Length of data.
+            /// \param[in] readOffset_ Offset at which to read.
+            /// \param[in] writeOffset_ Offset at which to write.
+            /// \param[in] allocator_ \see{Allocator} used for memory management.
+            /// \param[in] writeMemory_ false == all inserts go through Write.
+            Buffer (
+                Endianness endianness,
+                void *data_,
+                std::size_t length_,
+                std::size_t readOffset_,
+                std::size_t writeOffset_,
+                Allocator::SharedPtr allocator_,
+                bool writeMemory_) :
+                Serializer (endianness, this, writeMemory_ ? this : nullptr),
+                data ((ui8 *)data_),
+                length (length_),
+                readOffset (readOffset_),
+                writeOffset (writeOffset_),
+                allocator (allocator_) {}
+
+        public:
             /// \brief
             /// dtor.
             virtual ~Buffer () {
@@ -242,6 +276,20 @@ namespace thekogans {
             virtual void Resize (
                 std::size_t length_,
                 Allocator::SharedPtr allocator_ = nullptr);
+            /// \brief
+            /// Release the buffer's own data and become a (read-only) tenant of
+            /// the given bytes (\see{NullAllocator}). Used by borrowing extraction
+            /// (see \see{Serializer::borrow}) to avoid copying.
+            /// NOTE: The buffer is only valid for as long as the bytes are.
+            /// \param[in] view Bytes to wrap.
+            void Wrap (const ByteView &view);
+            /// \brief
+            /// If the buffer is a tenant (\see{NullAllocator}, see \see{Wrap}),
+            /// forget the bytes (without touching them) and become an empty
+            /// buffer that owns its data. Used by copying extraction so that
+            /// it never writes in to bytes a previous borrowing extraction wrapped.
+            /// \param[in] allocator_ \see{Allocator} the buffer will own its data with.
+            void Unwrap (Allocator::SharedPtr allocator_ = DefaultAllocator::Instance ());
 
             /// \brief
             /// Clone the buffer.
@@ -340,6 +388,59 @@ namespace thekogans {
                 return GetWritePtr () + GetDataAvailableForWriting ();
             }
 
+            /// \brief
+            /// Return a view of the data available for reading.
+            /// NOTE: The view is only valid for as long as the buffer is
+            /// alive and unmodified.
+            /// \return \see{ByteView} of [GetReadPtr (), GetReadPtrEnd ()).
+            inline ByteView GetReadView () const {
+                return ByteView (GetReadPtr (), GetDataAvailableForReading ());
+            }
+            /// \brief
+            /// Zero-copy Read. Return a view of (up to) the next count bytes
+            /// and advance the readOffset past them.
+            /// NOTE: The view is only valid for as long as the buffer is
+            /// alive and unmodified.
+            /// \param[in] count Number of bytes to read.
+            /// \return \see{ByteView} of the bytes read (view.size () can
+            /// be less than count if the buffer runs out).
+            inline ByteView ReadView (std::size_t count) {
+                std::size_t availableForReading = GetDataAvailableForReading ();
+                if (count > availableForReading) {
+                    count = availableForReading;
+                }
+                ByteView view (GetReadPtr (), count);
+                readOffset += count;
+                return view;
+            }
+
+            /// \brief
+            /// Fast path for \see{Serializer} fixed size value insertion.
+            /// \param[in] value Value to write (already in serializer byte order).
+            /// \return true == written, false == not enough room (nothing written).
+            template<typename T>
+            inline bool WriteFixed (const T &value) {
+                if (GetDataAvailableForWriting () >= sizeof (T)) {
+                    memcpy (data + writeOffset.value, &value, sizeof (T));
+                    writeOffset.value += sizeof (T);
+                    return true;
+                }
+                return false;
+            }
+            /// \brief
+            /// Fast path for \see{Serializer} fixed size value extraction.
+            /// \param[out] value Where to place the value (in serializer byte order).
+            /// \return true == read, false == not enough data (nothing read).
+            template<typename T>
+            inline bool ReadFixed (T &value) {
+                if (GetDataAvailableForReading () >= sizeof (T)) {
+                    memcpy ((void *)&value, data + readOffset.value, sizeof (T));
+                    readOffset.value += sizeof (T);
+                    return true;
+                }
+                return false;
+            }
+
             /// \brief
             /// Advance the read offset taking care not to overflow.
             /// NOTE: If advance == 0, the call is a silent noop.
@@ -367,6 +468,24 @@ namespace thekogans {
             /// \return A buffer containing inflated data.
             virtual SharedPtr Inflate (
                 Allocator::SharedPtr allocator_ = nullptr) const;
+            /// \brief
+            /// Use zlib to compress the readable bytes of a \see{BufferChain}.
+            /// The segments are fed to zlib in order (no need to Coalesce first).
+            /// \param[in] chain \see{BufferChain} to compress.
+            /// \param[in] allocator \see{Allocator} for the returned buffer.
+            /// \return A buffer containing deflated data (nullptr if chain is empty).
+            static SharedPtr Deflate (
+                const BufferChain &chain,
+                Allocator::SharedPtr allocator = DefaultAllocator::Instance ());
+            /// \brief
+            /// Use zlib to decompress the readable bytes of a \see{BufferChain}.
+            /// The segments are fed to zlib in order (no need to Coalesce first).
+            /// \param[in] chain \see{BufferChain} to decompress.
+            /// \param[in] allocator \see{Allocator} for the returned buffer.
+            /// \return A buffer containing inflated data (nullptr if chain is empty).
+            static SharedPtr Inflate (
+                const BufferChain &chain,
+                Allocator::SharedPtr allocator = DefaultAllocator::Instance ());
 
             /// \brief
             /// Given a hex encoded string and length, convert to Buffer.
@@ -604,6 +723,8 @@ namespace thekogans {
         ///
         /// \brief
         /// TenantReadBuffer is used to wrap a raw byte stream for reading.
+        /// All inserts (including the fixed size ones) go through Write,
+        /// which throws.
 
         struct TenantReadBuffer : public Buffer {
             /// \brief
@@ -616,7 +737,8 @@ namespace thekogans {
                     buffer.length,
                     buffer.readOffset,
                     buffer.writeOffset,
-                    NullAllocator::Instance ()) {}
+                    NullAllocator::Instance (),
+                    false) {}
             /// \brief
             /// ctor for wrapping a raw data pointer.
             /// \param[in] endianness How multi-byte values are stored.
@@ -634,7 +756,26 @@ namespace thekogans {
                     length,
                     readOffset,
                     length,
-                    NullAllocator::Instance ()) {}
+                    NullAllocator::Instance (),
+                    false) {}
+            /// \brief
+            /// ctor for wrapping a \see{ByteView} (a slice of a \see{Buffer},
+            /// an \see{MMapFile} mapping...).
+            /// \param[in] endianness How multi-byte values are stored.
+            /// \param[in] view \see{ByteView} to wrap.
+            /// \param[in] readOffset Offset at which to read.
+            TenantReadBuffer (
+                Endianness endianness,
+                const ByteView &view,
+                std::size_t readOffset = 0) :
+                Buffer (
+                    endianness,
+                    const_cast<ui8 *> (view.data),
+                    view.length,
+                    readOffset,
+                    view.length,
+                    NullAllocator::Instance (),
+                    false) {}
 
             /// \brief
             /// Copy assignment operator.
@@ -0,0 +1,267 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_util_BufferChain_h)
+#define __thekogans_util_BufferChain_h
+
+#include <deque>
+#include <vector>
+#include "thekogans/util/Config.h"
+#include "thekogans/util/Types.h"
+#include "thekogans/util/ByteView.h"
+#include "thekogans/util/Allocator.h"
+#include "thekogans/util/DefaultAllocator.h"
+#include "thekogans/util/Serializer.h"
+#include "thekogans/util/Buffer.h"
+#include "thekogans/util/File.h"
+
+namespace thekogans {
+    namespace util {
+
+        /// \struct BufferChain BufferChain.h thekogans/util/BufferChain.h
+        ///
+        /// \brief
+        /// BufferChain is a rope of \see{Buffer} segments. It's a \see{Serializer}
+        /// whose reads and writes cross segment boundaries, so a message can be
+        /// assembled from a header \see{Buffer} and payload \see{Buffer}s without
+        /// copying them in to one contiguous \see{Buffer} first. Append and Prepend
+        /// link segments in (no copies). Split hands out the front of the chain as
+        /// a new chain (a segment straddling the split point is shared, not copied).
+        /// WriteTo gathers all segments in to a single writev (pwritev) and ReadFrom
+        /// scatters a single readv across the tail segments. \see{Buffer::Deflate}
+        /// and \see{Buffer::Inflate} accept a chain as input.
+        ///
+        /// Values inserted in to the chain land in segments the chain allocates
+        /// itself (segmentSize at a time). Appended (prepended) segments are never
+        /// written to.
+        /// IMPORTANT: Once linked in to a chain, a segment's read offset belongs to
+        /// the chain (reading from the chain consumes its segments). Don't read from
+        /// (or write to) a segment while it's in a chain.
+        ///
+        /// Example:
+        ///
+        /// \code{.cpp}
+        /// using namespace thekogans;
+        ///
+        /// util::BufferChain message (util::NetworkEndian);
+        /// message.Append (payload);
+        /// util::NetworkBuffer::SharedPtr header (
+        ///     new util::NetworkBuffer (HEADER_SIZE));
+        /// *header << MAGIC << (util::ui32)payload->GetDataAvailableForReading ();
+        /// message.Prepend (header);
+        /// message.WriteTo (file);
+        /// \endcode
+
+        struct _LIB_THEKOGANS_UTIL_DECL BufferChain : public Serializer {
+            /// \brief
+            /// BufferChain participates in the \see{DynamicCreatable}
+            /// dynamic discovery and creation.
+            THEKOGANS_UTIL_DECLARE_DYNAMIC_CREATABLE (BufferChain)
+
+            /// \brief
+            /// Default size of the segments the chain allocates for
+            /// inserted values (and ReadFrom).
+            static const std::size_t DEFAULT_SEGMENT_SIZE = 4096;
+
+        private:
+            /// \struct BufferChain::SliceBuffer BufferChain.h thekogans/util/BufferChain.h
+            ///
+            /// \brief
+            /// A read-only window in to another segment's bytes. Keeps the
+            /// owning \see{Buffer} alive. Used by Split and Coalesce.
+            struct SliceBuffer;
+
+            /// \brief
+            /// Chain segments.
+            std::deque<Buffer::SharedPtr> segments;
+            /// \brief
+            /// Size of the segments the chain allocates.
+            std::size_t segmentSize;
+            /// \brief
+            /// \see{Allocator} for the segments the chain allocates.
+            Allocator::SharedPtr allocator;
+            /// \brief
+            /// true == the last segment was allocated by the chain
+            /// (and can be written to).
+            bool ownTail;
+
+        public:
+            /// \brief
+            /// ctor.
+            /// \param[in] endianness Serializer endianness.
+            /// \param[in] segmentSize_ Size of the segments the chain allocates.
+            /// \param[in] allocator_ \see{Allocator} for the segments the chain allocates.
+            BufferChain (
+                Endianness endianness = HostEndian,
+                std::size_t segmentSize_ = DEFAULT_SEGMENT_SIZE,
+                Allocator::SharedPtr allocator_ = DefaultAllocator::Instance ());
+
+            /// \brief
+            /// Return the number of segments in the chain.
+            /// \return Number of segments in the chain.
+            inline std::size_t GetSegmentCount () const {
+                return segments.size ();
+            }
+            /// \brief
+            /// Return the segment at the given index.
+            /// \param[in] index Index of segment to return.
+            /// \return Segment at the given index.
+            inline Buffer::SharedPtr GetSegment (std::size_t index) const {
+                return segments[index];
+            }
+            /// \brief
+            /// Return the number of bytes left to read (across all segments).
+            /// \return Number of bytes left to read.
+            std::size_t GetDataAvailableForReading () const;
+            /// \brief
+            /// Return true if there's nothing left to read.
+            /// \return true if there's nothing left to read.
+            inline bool IsEmpty () const {
+                return GetDataAvailableForReading () == 0;
+            }
+            /// \brief
+            /// Return views of the readable bytes of every (non empty)
+            /// segment in chain order.
+            /// \return Views of the readable bytes of every segment.
+            std::vector<ByteView> GetViews () const;
+
+            /// \brief
+            /// Link a segment at the end of the chain (no copy).
+            /// \param[in] buffer Segment to append.
+            void Append (Buffer::SharedPtr buffer);
+            /// \brief
+            /// Move all segments of the given chain to the end
+            /// of this one (no copy). chain is left empty.
+            /// \param[in,out] chain Chain whose segments to append.
+            void Append (BufferChain &chain);
+            /// \brief
+            /// Link a segment at the front of the chain (no copy).
+            /// \param[in] buffer Segment to prepend.
+            void Prepend (Buffer::SharedPtr buffer);
+            /// \brief
+            /// Move all segments of the given chain to the front
+            /// of this one (no copy). chain is left empty.
+            /// \param[in,out] chain Chain whose segments to prepend.
+            void Prepend (BufferChain &chain);
+
+            /// \brief
+            /// Detach the first count readable bytes in to a new chain.
+            /// Whole segments are moved, a segment straddling the split
+            /// point is shared by both chains (no bytes are copied).
+            /// \param[in] count Number of bytes to split off the front.
+            /// \return A chain containing the first count bytes.
+            SharedPtr Split (std::size_t count);
+            /// \brief
+            /// Collapse the chain in to a single segment and return it.
+            /// If the chain is a single segment, or its segments are
+            /// contiguous pieces of the same \see{Buffer} (see Split),
+            /// no bytes are copied. Otherwise the readable bytes are
+            /// copied in to one new segment.
+            /// \return The single segment (nullptr if the chain is empty).
+            Buffer::SharedPtr Coalesce ();
+
+            /// \brief
+            /// Drop all segments.
+            void Clear ();
+
+            /// \brief
+            /// Gather write the chain to the given handle at its current
+            /// position (writev). The bytes written are consumed.
+            /// \param[in] handle OS handle to write to.
+            /// \return Number of bytes written.
+            std::size_t WriteTo (THEKOGANS_UTIL_HANDLE handle);
+            /// \brief
+            /// Gather write the chain to the given handle at the given
+            /// offset (pwritev). The handle position is not changed.
+            /// The bytes written are consumed.
+            /// \param[in] handle OS handle to write to.
+            /// \param[in] offset Offset at which to write.
+            /// \return Number of bytes written.
+            std::size_t WriteTo (
+                THEKOGANS_UTIL_HANDLE handle,
+                ui64 offset);
+            /// \brief
+            /// Gather write the chain to the given file at its current position.
+            /// \param[in] file \see{File} to write to.
+            /// \return Number of bytes written.
+            inline std::size_t WriteTo (File &file) {
+                return WriteTo (file.GetHandle ());
+            }
+            /// \brief
+            /// Gather write the chain to the given file at the given offset.
+            /// \param[in] file \see{File} to write to.
+            /// \param[in] offset Offset at which to write.
+            /// \return Number of bytes written.
+            inline std::size_t WriteTo (
+                    File &file,
+                    ui64 offset) {
+                return WriteTo (file.GetHandle (), offset);
+            }
+
+            /// \brief
+            /// Scatter read (readv) up to count bytes from the given handle
+            /// in to the chain's tail segments (allocated as needed).
+            /// \param[in] handle OS handle to read from.
+            /// \param[in] count Maximum number of bytes to read.
+            /// \return Number of bytes read (0 == end of file).
+            std::size_t ReadFrom (
+                THEKOGANS_UTIL_HANDLE handle,
+                std::size_t count);
+            /// \brief
+            /// Scatter read up to count bytes from the given file.
+            /// \param[in] file \see{File} to read from.
+            /// \param[in] count Maximum number of bytes to read.
+            /// \return Number of bytes read (0 == end of file).
+            inline std::size_t ReadFrom (
+                    File &file,
+                    std::size_t count) {
+                return ReadFrom (file.GetHandle (), count);
+            }
+
+            // Serializer
+            /// \brief
+            /// Read raw bytes (across segments). The bytes read are consumed.
+            /// \param[out] buffer Where to place the bytes.
+            /// \param[in] count Number of bytes to read.
+            /// \return Number of bytes actually read.
+            virtual std::size_t Read (
+                void *buffer,
+                std::size_t count) override;
+            /// \brief
+            /// Write raw bytes to the end of the chain.
+            /// \param[in] buffer Bytes to write.
+            /// \param[in] count Number of bytes to write.
+            /// \return Number of bytes actually written.
+            virtual std::size_t Write (
+                const void *buffer,
+                std::size_t count) override;
+
+        private:
+            /// \brief
+            /// Consume count bytes from the front of the chain.
+            /// \param[in] count Number of bytes to consume.
+            void Consume (std::size_t count);
+
+            /// \brief
+            /// BufferChain is neither copy constructable, nor assignable.
+            THEKOGANS_UTIL_DISALLOW_COPY_AND_ASSIGN (BufferChain)
+        };
+
+    } // namespace util
+} // namespace thekogans
+
+#endif // !defined (__thekogans_util_BufferChain_h)
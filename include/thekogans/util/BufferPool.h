@@ -0,0 +1,285 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_util_BufferPool_h)
+#define __thekogans_util_BufferPool_h
+
+#include <cstddef>
+#include <atomic>
+#include <vector>
+#include "thekogans/util/Config.h"
+#include "thekogans/util/Types.h"
+#include "thekogans/util/Allocator.h"
+#include "thekogans/util/DefaultAllocator.h"
+#include "thekogans/util/Buffer.h"
+#include "thekogans/util/SpinLock.h"
+#include "thekogans/util/Singleton.h"
+
+namespace thekogans {
+    namespace util {
+
+        /// \struct BufferPool BufferPool.h thekogans/util/BufferPool.h
+        ///
+        /// \brief
+        /// BufferPool recycles \see{Buffer}s to take the pressure off the
+        /// \see{Allocator} (and the page fault handler) in code paths that
+        /// allocate and free lots of short lived buffers. Buffer lengths are
+        /// rounded up to power of 2 size classes [minSize, maxSize] and
+        /// every size class has its own free list. Buffers return to the pool
+        /// on their final Release (see Harakiri below), so a pooled buffer is
+        /// used exactly like any other Buffer::SharedPtr. Requests larger than
+        /// maxSize get a plain (unpooled) \see{Buffer}.
+        ///
+        /// To keep threads from fighting over the free lists, the pool keeps
+        /// a small per thread cache (THEKOGANS_UTIL_BUFFER_POOL_CACHE_COUNT
+        /// cache line aligned shards, assigned to threads round robin) in front
+        /// of the shared free lists. Caches trade buffers with the shared lists
+        /// in batches. The total number of bytes idling in the pool is capped
+        /// (maxIdleBytes). Buffers released while the pool is full go back to
+        /// the \see{Allocator}.
+        ///
+        /// If the pool's buffers hold sensitive data, create it with
+        /// \see{SecureAllocator}::Instance () and zeroOnReturn = true. Buffers
+        /// will be zeroed before being put back on the free lists (and the
+        /// \see{SecureAllocator} zeroes them when they're finally freed).
+        ///
+        /// Example:
+        ///
+        /// \code{.cpp}
+        /// using namespace thekogans;
+        ///
+        /// util::Buffer::SharedPtr buffer =
+        ///     util::GlobalBufferPool::Instance ()->GetBuffer (
+        ///         util::NetworkEndian, length);
+        /// file.Read (buffer->GetWritePtr (), length);
+        /// buffer->AdvanceWriteOffset (length);
+        /// ...
+        /// // buffer returns to the pool when the last reference goes away.
+        /// \endcode
+        ///
+        /// IMPORTANT: Like \see{JobQueuePool}, the pool must outlive every buffer
+        /// it hands out. Pooled buffers get their full size class worth of
+        /// bytes (GetLength () >= requested length). A pooled buffer that's
+        /// resized (or wrapped) is no longer recycled, it's freed when released.
+        /// Don't hold \see{WeakPtr}s to pooled buffers, a recycled buffer
+        /// comes back to life.
+
+        struct _LIB_THEKOGANS_UTIL_DECL BufferPool {
+            /// \brief
+            /// Default smallest size class.
+            static const std::size_t DEFAULT_MIN_SIZE = 4096;
+            /// \brief
+            /// Default largest size class.
+            static const std::size_t DEFAULT_MAX_SIZE = 1024 * 1024;
+            /// \brief
+            /// Default maximum number of bytes idling in the pool.
+            static const std::size_t DEFAULT_MAX_IDLE_BYTES = 64 * 1024 * 1024;
+
+            /// \struct BufferPool::Stats BufferPool.h thekogans/util/BufferPool.h
+            ///
+            /// \brief
+            /// Pool usage stats.
+            struct _LIB_THEKOGANS_UTIL_DECL Stats {
+                /// \brief
+                /// Number of requests satisfied by a recycled buffer.
+                std::size_t hits;
+                /// \brief
+                /// Number of requests that had to allocate a new buffer.
+                std::size_t misses;
+                /// \brief
+                /// Number of requests larger than maxSize.
+                std::size_t oversized;
+                /// \brief
+                /// Number of released buffers freed instead of recycled
+                /// (pool full, or buffer resized).
+                std::size_t discarded;
+                /// \brief
+                /// Number of bytes idling in the pool.
+                std::size_t idleBytes;
+
+                /// \brief
+                /// ctor.
+                Stats () :
+                    hits (0),
+                    misses (0),
+                    oversized (0),
+                    discarded (0),
+                    idleBytes (0) {}
+            };
+
+        private:
+            /// \brief
+            /// Smallest size class.
+            const std::size_t minSize;
+            /// \brief
+            /// Largest size class.
+            const std::size_t maxSize;
+            /// \brief
+            /// Maximum number of bytes idling in the pool.
+            const std::size_t maxIdleBytes;
+            /// \brief
+            /// true == zero the buffers before recycling them.
+            const bool zeroOnReturn;
+            /// \brief
+            /// \see{Allocator} for buffer data.
+            Allocator::SharedPtr allocator;
+            /// \brief
+            /// Number of size classes.
+            std::size_t sizeClassCount;
+            /// \struct BufferPool::Buffer BufferPool.h thekogans/util/BufferPool.h
+            ///
+            /// \brief
+            /// Extends \see{Buffer} to enable returning self to the pool after use.
+            struct Buffer;
+            /// \brief
+            /// Alias for std::vector<Buffer *>.
+            using FreeList = std::vector<Buffer *>;
+            /// \struct BufferPool::Cache BufferPool.h thekogans/util/BufferPool.h
+            ///
+            /// \brief
+            /// Per thread free lists (one per size class).
+            struct Cache;
+            /// \brief
+            /// Per thread caches.
+            Cache *caches;
+            /// \brief
+            /// Shared free lists (one per size class).
+            std::vector<FreeList> freeLists;
+            /// \brief
+            /// Protects freeLists.
+            SpinLock spinLock;
+            /// \brief
+            /// Number of bytes idling in the pool.
+            std::atomic<std::size_t> idleBytes;
+            /// \brief
+            /// \see{Stats::hits}.
+            std::atomic<std::size_t> hits;
+            /// \brief
+            /// \see{Stats::misses}.
+            std::atomic<std::size_t> misses;
+            /// \brief
+            /// \see{Stats::oversized}.
+            std::atomic<std::size_t> oversized;
+            /// \brief
+            /// \see{Stats::discarded}.
+            std::atomic<std::size_t> discarded;
+
+        public:
+            /// \brief
+            /// ctor.
+            /// \param[in] minSize_ Smallest size class (rounded up to a power of 2).
+            /// \param[in] maxSize_ Largest size class (rounded up to a power of 2).
+            /// \param[in] maxIdleBytes_ Maximum number of bytes idling in the pool.
+            /// \param[in] zeroOnReturn_ true == zero the buffers before recycling them.
+            /// \param[in] allocator_ \see{Allocator} for buffer data.
+            BufferPool (
+                std::size_t minSize_ = DEFAULT_MIN_SIZE,
+                std::size_t maxSize_ = DEFAULT_MAX_SIZE,
+                std::size_t maxIdleBytes_ = DEFAULT_MAX_IDLE_BYTES,
+                bool zeroOnReturn_ = false,
+                Allocator::SharedPtr allocator_ = DefaultAllocator::Instance ());
+            /// \brief
+            /// dtor. Free the idle buffers.
+            virtual ~BufferPool ();
+
+            /// \brief
+            /// Return a buffer of at least the given length. The buffer is
+            /// empty (readOffset == writeOffset == 0). Unless zeroOnReturn
+            /// is true, its contents are whatever the last user left behind.
+            /// \param[in] endianness Buffer endianness.
+            /// \param[in] length Minimum buffer length.
+            /// \return A buffer of at least the given length.
+            util::Buffer::SharedPtr GetBuffer (
+                Endianness endianness,
+                std::size_t length);
+
+            /// \brief
+            /// Return the size class a buffer of the given length comes from.
+            /// \param[in] length Buffer length.
+            /// \return Size class length (0 if length > maxSize).
+            std::size_t GetSizeClassLength (std::size_t length) const;
+
+            /// \brief
+            /// Free all idle buffers.
+            void Flush ();
+
+            /// \brief
+            /// Return the pool usage stats.
+            /// \return Pool usage stats.
+            Stats GetStats () const;
+
+        private:
+            /// \brief
+            /// Return the index of the size class a buffer of the given length comes from.
+            /// \param[in] length Buffer length.
+            /// \return Size class index (sizeClassCount if length > maxSize).
+            std::size_t GetSizeClass (std::size_t length) const;
+            /// \brief
+            /// Called by Buffer::Harakiri to return the buffer to the pool.
+            /// \param[in] buffer Buffer to return to the pool.
+            void ReleaseBuffer (Buffer *buffer);
+            /// \brief
+            /// Atomically add length to idleBytes unless that would take it
+            /// past maxIdleBytes.
+            /// \param[in] length Number of bytes to reserve.
+            /// \return true == reserved, false == the pool is full.
+            bool ReserveIdleBytes (std::size_t length);
+            /// \brief
+            /// Free the buffers in the given free list and clear it.
+            /// \param[in,out] freeList Free list to clear.
+            void ClearFreeList (FreeList &freeList);
+
+            /// \brief
+            /// BufferPool is neither copy constructable, nor assignable.
+            THEKOGANS_UTIL_DISALLOW_COPY_AND_ASSIGN (BufferPool)
+        };
+
+        /// \struct GlobalBufferPool BufferPool.h thekogans/util/BufferPool.h
+        ///
+        /// \brief
+        /// A global \see{BufferPool} instance. If all you need is a pool with
+        /// the default size classes, GlobalBufferPool::Instance () will do the
+        /// trick. Use GlobalBufferPool::CreateInstance to customize it.
+
+        struct _LIB_THEKOGANS_UTIL_DECL GlobalBufferPool :
+                public BufferPool,
+                public Singleton<GlobalBufferPool> {
+            /// \brief
+            /// ctor.
+            /// \param[in] minSize Smallest size class.
+            /// \param[in] maxSize Largest size class.
+            /// \param[in] maxIdleBytes Maximum number of bytes idling in the pool.
+            /// \param[in] zeroOnReturn true == zero the buffers before recycling them.
+            /// \param[in] allocator \see{Allocator} for buffer data.
+            GlobalBufferPool (
+                std::size_t minSize = DEFAULT_MIN_SIZE,
+                std::size_t maxSize = DEFAULT_MAX_SIZE,
+                std::size_t maxIdleBytes = DEFAULT_MAX_IDLE_BYTES,
+                bool zeroOnReturn = false,
+                Allocator::SharedPtr allocator = DefaultAllocator::Instance ()) :
+                BufferPool (
+                    minSize,
+                    maxSize,
+                    maxIdleBytes,
+                    zeroOnReturn,
+                    allocator) {}
+        };
+
+    } // namespace util
+} // namespace thekogans
+
+#endif // !defined (__thekogans_util_BufferPool_h)
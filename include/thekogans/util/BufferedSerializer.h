@@ -0,0 +1,183 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+
+#if !defined (__thekogans_util_BufferedSerializer_h)
+#define __thekogans_util_BufferedSerializer_h
+
+#include "thekogans/util/Config.h"
+#include "thekogans/util/Types.h"
+#include "thekogans/util/Serializer.h"
+#include "thekogans/util/RandomSeekSerializer.h"
+#include "thekogans/util/Buffer.h"
+
+namespace thekogans {
+    namespace util {
+
+        /// \struct BufferedSerializer BufferedSerializer.h thekogans/util/BufferedSerializer.h
+        ///
+        /// \brief
+        /// BufferedSerializer wraps a syscall backed \see{Serializer} (\see{File}...)
+        /// and adds a read-ahead/write-behind buffer in front of it. Without it, every
+        /// value inserted in (extracted from) a \see{File} costs a system call. With
+        /// it, the wrapped serializer only sees buffer size chunks. The buffer is
+        /// either holding read-ahead or pending writes, never both. Switching
+        /// directions, Seek and Flush take care of keeping the wrapped serializer
+        /// position coherent with the logical position returned by Tell.
+        /// If the wrapped serializer is not a \see{RandomSeekSerializer}, Tell and
+        /// Seek throw, and switching from reading to writing with unread read-ahead
+        /// is an error (there's no way to give it back).
+        /// NOTE: BufferedSerializer has its own endianness (set in the ctor) which
+        /// governs all value insertion/extraction. The wrapped serializer only sees
+        /// raw bytes.
+        /// IMPORTANT: Pending writes are flushed in the dtor, but errors can't be
+        /// reported from there. Call Flush explicitly if you care about them.
+        ///
+        /// Example:
+        ///
+        /// \code{.cpp}
+        /// using namespace thekogans;
+        ///
+        /// util::SimpleFile file (util::HostEndian, path, util::SimpleFile::ReadWrite);
+        /// util::BufferedSerializer serializer (file, file.endianness);
+        /// serializer << header;
+        /// for (...) {
+        ///     serializer << record;
+        /// }
+        /// serializer.Flush ();
+        /// \endcode
+
+        struct _LIB_THEKOGANS_UTIL_DECL BufferedSerializer : public RandomSeekSerializer {
+            /// \brief
+            /// Declare the \see{DynamicCreatable} overrides.
+            THEKOGANS_UTIL_DECLARE_DYNAMIC_CREATABLE_OVERRIDE (BufferedSerializer)
+
+        private:
+            /// \brief
+            /// Serializer we're buffering.
+            Serializer &serializer;
+            /// \brief
+            /// If serializer is a \see{RandomSeekSerializer}, this is it.
+            RandomSeekSerializer *randomSeekSerializer;
+            /// \brief
+            /// Read-ahead/write-behind buffer.
+            Buffer buffer;
+            /// \brief
+            /// What buffer currently holds.
+            enum {
+                /// \brief
+                /// Nothing.
+                Empty,
+                /// \brief
+                /// Read-ahead in [buffer.readOffset, buffer.writeOffset).
+                Reading,
+                /// \brief
+                /// Pending writes in [0, buffer.writeOffset).
+                Writing
+            } state;
+
+        public:
+            /// \brief
+            /// Default buffer size.
+            static const std::size_t DEFAULT_BUFFER_SIZE = 64 * 1024;
+
+            /// \brief
+            /// ctor.
+            /// \param[in] serializer_ Serializer to buffer.
+            /// \param[in] endianness Serializer endianness.
+            /// \param[in] bufferSize Size of the read-ahead/write-behind buffer.
+            BufferedSerializer (
+                Serializer &serializer_,
+                Endianness endianness = HostEndian,
+                std::size_t bufferSize = DEFAULT_BUFFER_SIZE);
+            /// \brief
+            /// dtor. Flush pending writes.
+            virtual ~BufferedSerializer ();
+
+            /// \brief
+            /// Return the serializer we're buffering.
+            /// \return The serializer we're buffering.
+            inline Serializer &GetSerializer () const {
+                return serializer;
+            }
+            /// \brief
+            /// Return the buffer size.
+            /// \return The buffer size.
+            inline std::size_t GetBufferSize () const {
+                return buffer.GetLength ();
+            }
+
+            // Serializer
+            /// \brief
+            /// Read bytes. Small reads are satisfied from the read-ahead
+            /// buffer, large ones go straight to the wrapped serializer.
+            /// \param[out] data Where to place the bytes.
+            /// \param[in] count Number of bytes to read.
+            /// \return Number of bytes actually read.
+            virtual std::size_t Read (
+                void *data,
+                std::size_t count) override;
+            /// \brief
+            /// Write bytes. Small writes are accumulated in the write-behind
+            /// buffer, large ones go straight to the wrapped serializer.
+            /// \param[in] data Where the bytes come from.
+            /// \param[in] count Number of bytes to write.
+            /// \return Number of bytes actually written.
+            virtual std::size_t Write (
+                const void *data,
+                std::size_t count) override;
+
+            // RandomSeekSerializer
+            /// \brief
+            /// Return the logical position (accounting for the buffered bytes).
+            /// \return The logical position.
+            virtual i64 Tell () const override;
+            /// \brief
+            /// Reposition the logical pointer. Pending writes are flushed. If the
+            /// new position falls inside the read-ahead, the read-ahead is kept.
+            /// \param[in] offset Offset to move relative to fromWhere.
+            /// \param[in] fromWhere SEEK_SET, SEEK_CUR or SEEK_END.
+            /// \return The new logical position.
+            virtual i64 Seek (
+                i64 offset,
+                i32 fromWhere) override;
+            /// \brief
+            /// Flush pending writes and return the size of the wrapped serializer.
+            /// \return Size of the wrapped serializer.
+            virtual ui64 GetSize () override;
+
+            /// \brief
+            /// Write all pending bytes to the wrapped serializer. Unread read-ahead
+            /// is kept. NOTE: This does not flush the wrapped serializer's own
+            /// buffers (call \see{File::Flush} for that).
+            void Flush ();
+
+        private:
+            /// \brief
+            /// Drop the read-ahead, moving the wrapped serializer back
+            /// to the logical position.
+            void DiscardReadAhead ();
+
+            /// \brief
+            /// BufferedSerializer is neither copy constructable, nor assignable.
+            THEKOGANS_UTIL_DISALLOW_COPY_AND_ASSIGN (BufferedSerializer)
+        };
+
+    } // namespace util
+} // namespace thekogans
+
+#endif // !defined (__thekogans_util_BufferedSerializer_h)
@@ -24,9 +24,11 @@
 #endif // defined (TOOLCHAIN_OS_OSX)
 #include <cstddef>
 #include <cstdlib>
+#include <cstring>
 #include <stdexcept>
 #include <utility>
 #include <type_traits>
+#include "thekogans/util/Config.h"
 #include "thekogans/util/Types.h"
 #include "thekogans/util/Exception.h"
 
@@ -265,6 +267,50 @@ namespace thekogans {
             return detail::DoSwapBytes<from, to, T> () (value);
         }
 
+        /// \brief
+        /// Reverse the bytes of each of count size (1, 2, 4 or 8) byte values
+        /// copying them from src to dst. src and dst can be the same (in place
+        /// swap) but must not otherwise overlap. The whole array is done with
+        /// the widest byte shuffle the CPU supports (AVX2, SSSE3), picked once
+        /// at run time, and finished with scalar swaps.
+        /// \param[in] src Values to swap.
+        /// \param[out] dst Where to put the swapped values.
+        /// \param[in] size Size of each value.
+        /// \param[in] count Number of values.
+        _LIB_THEKOGANS_UTIL_DECL void _LIB_THEKOGANS_UTIL_API ByteSwapArray (
+            const void *src,
+            void *dst,
+            std::size_t size,
+            std::size_t count);
+
+        /// \brief
+        /// Convert an array of values from byte order to byte order.
+        /// \param[in] src Values to convert.
+        /// \param[out] dst Where to put the converted values (can be src).
+        /// \param[in] count Number of values.
+        template<
+            Endianness from,
+            Endianness to,
+            typename T>
+        inline void ByteSwap (
+                const T *src,
+                T *dst,
+                std::size_t count) {
+            static_assert (
+                sizeof (T) == UI8_SIZE || sizeof (T) == UI16_SIZE ||
+                sizeof (T) == UI32_SIZE || sizeof (T) == UI64_SIZE,
+                "Template parameter must be 1, 2, 4 or 8 bytes.");
+            static_assert (
+                std::is_arithmetic<T>::value,
+                "Template parameter must be an arithmetic type.");
+            if (from != to && sizeof (T) > UI8_SIZE) {
+                ByteSwapArray (src, dst, sizeof (T), count);
+            }
+            else if (src != dst && count > 0) {
+                memcpy (dst, src, count * sizeof (T));
+            }
+        }
+
     } // namespace util
 } // namespace thekogans
 
@@ -0,0 +1,125 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_util_ByteView_h)
+#define __thekogans_util_ByteView_h
+
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include "thekogans/util/Config.h"
+#include "thekogans/util/Types.h"
+
+namespace thekogans {
+    namespace util {
+
+        /// \struct ByteView ByteView.h thekogans/util/ByteView.h
+        ///
+        /// \brief
+        /// ByteView is a non-owning, read-only view of a range of bytes. It's what
+        /// \see{Buffer::ReadView} and \see{Serializer}::operator >> (ByteView &)
+        /// return instead of copying the bytes in to a std::vector<ui8>.
+        /// NOTE: ByteView does not keep the memory it points to alive. It's only
+        /// valid for as long as the \see{Buffer} it was read from is alive and
+        /// unmodified.
+
+        struct ByteView {
+            /// \brief
+            /// Start of the range.
+            const ui8 *data;
+            /// \brief
+            /// Number of bytes in the range.
+            std::size_t length;
+
+            /// \brief
+            /// ctor.
+            /// \param[in] data_ Start of the range.
+            /// \param[in] length_ Number of bytes in the range.
+            explicit ByteView (
+                const void *data_ = nullptr,
+                std::size_t length_ = 0) :
+                data ((const ui8 *)data_),
+                length (length_) {}
+
+            /// \brief
+            /// Return the number of bytes in the range.
+            /// \return Number of bytes in the range.
+            inline std::size_t size () const {
+                return length;
+            }
+            /// \brief
+            /// Return true if the range is empty.
+            /// \return true if the range is empty.
+            inline bool empty () const {
+                return length == 0;
+            }
+            /// \brief
+            /// Return the start of the range.
+            /// \return Start of the range.
+            inline const ui8 *begin () const {
+                return data;
+            }
+            /// \brief
+            /// Return just past the end of the range.
+            /// \return Just past the end of the range.
+            inline const ui8 *end () const {
+                return data + length;
+            }
+            /// \brief
+            /// Return the byte at the given index.
+            /// \param[in] index Index of byte to return.
+            /// \return Byte at the given index.
+            inline ui8 operator [] (std::size_t index) const {
+                return data[index];
+            }
+
+            /// \brief
+            /// Copy the range in to a std::vector<ui8> (for when the
+            /// bytes need to outlive the \see{Buffer} they came from).
+            /// \return std::vector<ui8> containing a copy of the range.
+            inline std::vector<ui8> Tovector () const {
+                return std::vector<ui8> (begin (), end ());
+            }
+        };
+
+        /// \brief
+        /// Compare two ByteViews for equality (by content).
+        /// \param[in] view1 First ByteView to compare.
+        /// \param[in] view2 Second ByteView to compare.
+        /// \return true == equal, false == not equal.
+        inline bool operator == (
+                const ByteView &view1,
+                const ByteView &view2) {
+            return view1.length == view2.length &&
+                (view1.length == 0 || memcmp (view1.data, view2.data, view1.length) == 0);
+        }
+
+        /// \brief
+        /// Compare two ByteViews for inequality (by content).
+        /// \param[in] view1 First ByteView to compare.
+        /// \param[in] view2 Second ByteView to compare.
+        /// \return true == not equal, false == equal.
+        inline bool operator != (
+                const ByteView &view1,
+                const ByteView &view2) {
+            return !(view1 == view2);
+        }
+
+    } // namespace util
+} // namespace thekogans
+
+#endif // !defined (__thekogans_util_ByteView_h)
@@ -36,7 +36,13 @@ namespace thekogans {
         /// DefaultAllocator is part of the \see{Allocator} framework.
         struct _LIB_THEKOGANS_UTIL_DECL DefaultAllocator :
                 public Allocator,
-                public RefCountedSingleton<DefaultAllocator> {
+                // Instance () is called on every (de)allocation from every
+                // thread. Keep the singleton's reference count off a shared
+                // cache line.
+                public RefCountedSingleton<
+                    DefaultAllocator,
+                    SpinLock,
+                    ShardedRefCountedInstanceCreator<DefaultAllocator>> {
             /// \brief
             /// DefaultAllocator participates in the \see{DynamicCreatable}
             /// dynamic discovery and creation.
@@ -0,0 +1,327 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_util_DeflateSerializer_h)
+#define __thekogans_util_DeflateSerializer_h
+
+#include <deque>
+#include "thekogans/util/Config.h"
+#include "thekogans/util/Types.h"
+#include "thekogans/util/Serializer.h"
+#include "thekogans/util/Buffer.h"
+#include "thekogans/util/JobQueue.h"
+
+namespace thekogans {
+    namespace util {
+
+        /// \struct DeflateSerializer DeflateSerializer.h thekogans/util/DeflateSerializer.h
+        ///
+        /// \brief
+        /// DeflateSerializer wraps a \see{Serializer} (\see{File}, \see{BufferedSerializer}...)
+        /// and compresses (zlib deflate) everything written to it on the way through.
+        /// Unlike \see{Buffer::Deflate}, the input never needs to be in memory all at
+        /// once; the wrapped serializer sees bufferSize chunks of compressed bytes.
+        /// Compression level, window size, strategy and stream format (zlib, gzip or
+        /// raw deflate) are all selectable. Use \see{InflateSerializer} to read the
+        /// stream back.
+        ///
+        /// Given a \see{JobQueue}, DeflateSerializer compresses blockSize chunks of
+        /// input in parallel (as many at a time as the queue has workers) in the
+        /// spirit of pigz. Every block is compressed independently (primed with the
+        /// tail of the previous block as a dictionary) and ends on a byte boundary,
+        /// so the blocks are simply concatenated (in order) between a header and a
+        /// trailer (whose checksum is combined from the blocks'). The result is one
+        /// ordinary deflate stream, readable by \see{InflateSerializer} (and any other
+        /// inflater). Parallel compression costs a few bytes per block.
+        ///
+        /// Example:
+        ///
+        /// \code{.cpp}
+        /// using namespace thekogans;
+        ///
+        /// util::SimpleFile file (
+        ///     util::HostEndian,
+        ///     path,
+        ///     util::SimpleFile::ReadWrite | util::SimpleFile::Create | util::SimpleFile::Truncate);
+        /// util::JobQueue::SharedPtr jobQueue (
+        ///     new util::JobQueue ("deflate", new util::RunLoop::FIFOJobExecutionPolicy,
+        ///         util::SystemInfo::Instance ()->GetCPUCount ()));
+        /// util::DeflateSerializer serializer (file, jobQueue);
+        /// for (...) {
+        ///     serializer << record;
+        /// }
+        /// serializer.Finish ();
+        /// \endcode
+        ///
+        /// NOTE: DeflateSerializer has its own endianness (set in the ctor) which
+        /// governs all value insertion. The wrapped serializer only sees raw bytes.
+        /// IMPORTANT: The stream is finished in the dtor, but errors can't be
+        /// reported from there. Call Finish explicitly if you care about them.
+
+        struct _LIB_THEKOGANS_UTIL_DECL DeflateSerializer : public Serializer {
+            /// \brief
+            /// Declare the \see{DynamicCreatable} overrides.
+            THEKOGANS_UTIL_DECLARE_DYNAMIC_CREATABLE_OVERRIDE (DeflateSerializer)
+
+            /// \enum
+            /// Stream formats.
+            enum Format {
+                /// \brief
+                /// zlib (RFC 1950) header and adler32 trailer
+                /// (same as \see{Buffer::Deflate}).
+                Zlib,
+                /// \brief
+                /// gzip (RFC 1952) header and crc32 trailer.
+                Gzip,
+                /// \brief
+                /// Raw deflate (RFC 1951). No header or trailer.
+                Raw
+            };
+
+            /// \enum
+            /// Compression strategies (same values as zlib's Z_*).
+            enum Strategy {
+                /// \brief
+                /// Z_DEFAULT_STRATEGY. Best for most data.
+                Default = 0,
+                /// \brief
+                /// Z_FILTERED. Data produced by a filter (predictor).
+                Filtered = 1,
+                /// \brief
+                /// Z_HUFFMAN_ONLY. No string matching.
+                HuffmanOnly = 2,
+                /// \brief
+                /// Z_RLE. Match distances of 1 only (run length encoding).
+                RLE = 3,
+                /// \brief
+                /// Z_FIXED. No dynamic Huffman codes.
+                Fixed = 4
+            };
+
+            /// \brief
+            /// Default compression level (zlib's Z_DEFAULT_COMPRESSION).
+            static const i32 DEFAULT_LEVEL = -1;
+            /// \brief
+            /// Default (and largest) window size (log2).
+            static const i32 DEFAULT_WINDOW_BITS = 15;
+            /// \brief
+            /// Default size of the compressed chunks written to the wrapped serializer.
+            static const std::size_t DEFAULT_BUFFER_SIZE = 64 * 1024;
+            /// \brief
+            /// Default size of the independently compressed blocks.
+            static const std::size_t DEFAULT_BLOCK_SIZE = 128 * 1024;
+            /// \brief
+            /// Default maximum number of blocks in flight.
+            static const std::size_t DEFAULT_MAX_PENDING_BLOCKS = 16;
+
+        private:
+            /// \brief
+            /// Serializer we're compressing to.
+            Serializer &serializer;
+            /// \brief
+            /// Compression level [0, 9] (or DEFAULT_LEVEL).
+            const i32 level;
+            /// \brief
+            /// Window size (log2) [9, 15].
+            const i32 windowBits;
+            /// \brief
+            /// Compression strategy.
+            const Strategy strategy;
+            /// \brief
+            /// Stream format.
+            const Format format;
+            /// \struct DeflateSerializer::Stream DeflateSerializer.h thekogans/util/DeflateSerializer.h
+            ///
+            /// \brief
+            /// Wraps the zlib stream used by serial compression.
+            struct Stream;
+            /// \brief
+            /// Serial compression stream (nullptr if parallel).
+            Stream *stream;
+            /// \brief
+            /// Serial compression output buffer.
+            Buffer buffer;
+            /// \struct DeflateSerializer::BlockJob DeflateSerializer.h thekogans/util/DeflateSerializer.h
+            ///
+            /// \brief
+            /// Compresses one block of input on the jobQueue.
+            struct BlockJob;
+            /// \brief
+            /// \see{JobQueue} compressing the blocks (nullptr if serial).
+            JobQueue::SharedPtr jobQueue;
+            /// \brief
+            /// Size of the independently compressed blocks.
+            const std::size_t blockSize;
+            /// \brief
+            /// Maximum number of blocks in flight.
+            const std::size_t maxPendingBlocks;
+            /// \brief
+            /// Block being filled.
+            Buffer::SharedPtr block;
+            /// \brief
+            /// Last submitted block (dictionary for the next one).
+            Buffer::SharedPtr previousBlock;
+            /// \brief
+            /// Blocks in flight (in stream order).
+            std::deque<RunLoop::Job::SharedPtr> pendingBlocks;
+            /// \brief
+            /// Running adler32 (Zlib) or crc32 (Gzip) of the uncompressed bytes.
+            ui32 check;
+            /// \brief
+            /// Number of uncompressed bytes written.
+            ui64 totalIn;
+            /// \brief
+            /// Number of compressed bytes written to the wrapped serializer.
+            ui64 totalOut;
+            /// \brief
+            /// true == Finish was called.
+            bool finished;
+
+        public:
+            /// \brief
+            /// ctor. Serial compression.
+            /// \param[in] serializer_ Serializer to compress to.
+            /// \param[in] endianness Serializer endianness.
+            /// \param[in] level_ Compression level [0, 9] (or DEFAULT_LEVEL).
+            /// \param[in] windowBits_ Window size (log2) [9, 15].
+            /// \param[in] strategy_ Compression strategy.
+            /// \param[in] format_ Stream format.
+            /// \param[in] bufferSize Size of the compressed chunks written to serializer_.
+            DeflateSerializer (
+                Serializer &serializer_,
+                Endianness endianness = HostEndian,
+                i32 level_ = DEFAULT_LEVEL,
+                i32 windowBits_ = DEFAULT_WINDOW_BITS,
+                Strategy strategy_ = Default,
+                Format format_ = Zlib,
+                std::size_t bufferSize = DEFAULT_BUFFER_SIZE);
+            /// \brief
+            /// ctor. Parallel block compression.
+            /// \param[in] serializer_ Serializer to compress to.
+            /// \param[in] jobQueue_ \see{JobQueue} to compress the blocks on.
+            /// \param[in] endianness Serializer endianness.
+            /// \param[in] level_ Compression level [0, 9] (or DEFAULT_LEVEL).
+            /// \param[in] windowBits_ Window size (log2) [9, 15].
+            /// \param[in] strategy_ Compression strategy.
+            /// \param[in] format_ Stream format.
+            /// \param[in] blockSize_ Size of the independently compressed blocks.
+            /// \param[in] maxPendingBlocks_ Maximum number of blocks in flight.
+            DeflateSerializer (
+                Serializer &serializer_,
+                JobQueue::SharedPtr jobQueue_,
+                Endianness endianness = HostEndian,
+                i32 level_ = DEFAULT_LEVEL,
+                i32 windowBits_ = DEFAULT_WINDOW_BITS,
+                Strategy strategy_ = Default,
+                Format format_ = Zlib,
+                std::size_t blockSize_ = DEFAULT_BLOCK_SIZE,
+                std::size_t maxPendingBlocks_ = DEFAULT_MAX_PENDING_BLOCKS);
+            /// \brief
+            /// dtor. Finish the stream.
+            virtual ~DeflateSerializer ();
+
+            /// \brief
+            /// Return the serializer we're compressing to.
+            /// \return The serializer we're compressing to.
+            inline Serializer &GetSerializer () const {
+                return serializer;
+            }
+            /// \brief
+            /// Return the number of uncompressed bytes written.
+            /// \return Number of uncompressed bytes written.
+            inline ui64 GetTotalIn () const {
+                return totalIn;
+            }
+            /// \brief
+            /// Return the number of compressed bytes written to the wrapped serializer.
+            /// \return Number of compressed bytes written to the wrapped serializer.
+            inline ui64 GetTotalOut () const {
+                return totalOut;
+            }
+            /// \brief
+            /// Return true if Finish was called.
+            /// \return true if Finish was called.
+            inline bool IsFinished () const {
+                return finished;
+            }
+
+            // Serializer
+            /// \brief
+            /// DeflateSerializer is write only. Throws.
+            /// \param[out] data Where to place the bytes.
+            /// \param[in] count Number of bytes to read.
+            /// \return Number of bytes actually read.
+            virtual std::size_t Read (
+                void *data,
+                std::size_t count) override;
+            /// \brief
+            /// Compress bytes.
+            /// \param[in] data Bytes to compress.
+            /// \param[in] count Number of bytes to compress.
+            /// \return Number of bytes actually written.
+            virtual std::size_t Write (
+                const void *data,
+                std::size_t count) override;
+
+            /// \brief
+            /// Write everything compressed so far to the wrapped serializer (ending
+            /// on a byte boundary) so that a reader can inflate all bytes written
+            /// up to this point. Flushing too often hurts compression.
+            /// NOTE: This does not flush the wrapped serializer's own buffers.
+            void Flush ();
+            /// \brief
+            /// Compress the remaining input and write the stream trailer.
+            /// Once finished, the stream can't be written to.
+            void Finish ();
+
+        private:
+            /// \brief
+            /// Write the stream header (parallel compression).
+            void WriteHeader ();
+            /// \brief
+            /// Write the stream trailer (parallel compression).
+            void WriteTrailer ();
+            /// \brief
+            /// Run the serial compression stream and write its output.
+            /// \param[in] flush zlib flush mode.
+            void Deflate (i32 flush);
+            /// \brief
+            /// Submit the block being filled to the jobQueue.
+            /// \param[in] last true == last block in the stream.
+            void SubmitBlock (bool last);
+            /// \brief
+            /// Write the compressed blocks to the wrapped serializer (in order).
+            /// \param[in] maxPending Wait for blocks until no more than
+            /// this many are in flight.
+            void WriteBlocks (std::size_t maxPending);
+            /// \brief
+            /// Write compressed bytes to the wrapped serializer.
+            /// \param[in] data Compressed bytes.
+            /// \param[in] count Number of compressed bytes.
+            void WriteOut (
+                const void *data,
+                std::size_t count);
+
+            /// \brief
+            /// DeflateSerializer is neither copy constructable, nor assignable.
+            THEKOGANS_UTIL_DISALLOW_COPY_AND_ASSIGN (DeflateSerializer)
+        };
+
+    } // namespace util
+} // namespace thekogans
+
+#endif // !defined (__thekogans_util_DeflateSerializer_h)
@@ -0,0 +1,130 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_util_DistributedSpinRWLock_h)
+#define __thekogans_util_DistributedSpinRWLock_h
+
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include "thekogans/util/Config.h"
+#include "thekogans/util/Types.h"
+
+namespace thekogans {
+    namespace util {
+
+        /// \struct DistributedSpinRWLock DistributedSpinRWLock.h thekogans/util/DistributedSpinRWLock.h
+        ///
+        /// \brief
+        /// DistributedSpinRWLock is a reader biased (big reader) spin lock. \see{SpinRWLock}
+        /// keeps the reader count in the same word as the writer flags. That means every
+        /// reader does an atomic RMW on one shared cache line, and read mostly structures
+        /// stop scaling after a few cores. DistributedSpinRWLock gives every thread a
+        /// reader slot (slots are padded to their own cache line). Readers only touch
+        /// their slot and read the (rarely written) writer flag. Writers set the writer
+        /// flag and then wait for every slot to drain. Readers are cheap and scale, but
+        /// writers are expensive: O(slot count). Use it where writes are rare.
+        ///
+        /// DistributedSpinRWLock has the same interface as \see{SpinRWLock} and
+        /// \see{RWLock}, so it works with \see{RWLockGuard}.
+        ///
+        /// IMPORTANT: Read acquisitions are not recursive. A thread that holds the
+        /// lock for reading and tries to acquire it for reading again will deadlock
+        /// if a writer shows up in between.
+
+        struct _LIB_THEKOGANS_UTIL_DECL DistributedSpinRWLock {
+            /// \brief
+            /// Default max pause iterations before giving up the time slice.
+            static const ui32 DEFAULT_MAX_PAUSE_BEFORE_YIELD = 16;
+            /// \brief
+            /// Size of the cache line the reader slots are padded to.
+            static const std::size_t CACHE_LINE_SIZE = 64;
+
+        private:
+            /// \struct DistributedSpinRWLock::Slot DistributedSpinRWLock.h
+            /// thekogans/util/DistributedSpinRWLock.h
+            ///
+            /// \brief
+            /// Per thread reader indicator. Aligned (and therefore padded)
+            /// so that neighboring slots don't share a cache line. The
+            /// slots array is allocated with (C++17) aligned new.
+            struct alignas (CACHE_LINE_SIZE) Slot {
+                /// \brief
+                /// Count of readers (using this slot) holding the lock.
+                std::atomic<ui32> readers;
+
+                /// \brief
+                /// ctor.
+                Slot () :
+                    readers (0) {}
+            };
+            /// \brief
+            /// Reader slots.
+            std::unique_ptr<Slot[]> slots;
+            /// \brief
+            /// Number of slots - 1 (slot count is a power of 2).
+            ui32 slotMask;
+            /// \brief
+            /// 1 == a writer holds (or is acquiring) the lock.
+            std::atomic<ui32> writer;
+            /// \brief
+            /// \see{Thread::Backoff} parameter.
+            ui32 maxPauseBeforeYield;
+
+        public:
+            /// \brief
+            /// ctor. Initialize to unlocked.
+            /// \param[in] slotCount Number of reader slots (rounded up to a power of 2).
+            /// 0 == use twice the number of cpus.
+            /// \param[in] maxPauseBeforeYield_ \see{Thread::Backoff} parameter.
+            explicit DistributedSpinRWLock (
+                ui32 slotCount = 0,
+                ui32 maxPauseBeforeYield_ = DEFAULT_MAX_PAUSE_BEFORE_YIELD);
+
+            /// \brief
+            /// Try to acquire the lock.
+            /// \param[in] read true = acquire for reading, false = acquire for writing.
+            /// \return true = acquired, false = failed to acquire.
+            bool TryAcquire (bool read);
+            /// \brief
+            /// Acquire the lock.
+            /// \param[in] read true = acquire for reading, false = acquire for writing.
+            void Acquire (bool read);
+            /// \brief
+            /// Release the lock.
+            /// \param[in] read true = release for reading, release for writing.
+            void Release (bool read);
+
+        private:
+            /// \brief
+            /// Return the calling thread's reader slot.
+            /// \return The calling thread's reader slot.
+            Slot &GetSlot () const;
+            /// \brief
+            /// Return true if no readers hold the lock.
+            /// \return true if no readers hold the lock.
+            bool IsDrained () const;
+
+            /// \brief
+            /// DistributedSpinRWLock is neither copy constructable, nor assignable.
+            THEKOGANS_UTIL_DISALLOW_COPY_AND_ASSIGN (DistributedSpinRWLock)
+        };
+
+    } // namespace util
+} // namespace thekogans
+
+#endif // !defined (__thekogans_util_DistributedSpinRWLock_h)
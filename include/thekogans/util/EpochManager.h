@@ -0,0 +1,252 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_util_EpochManager_h)
+#define __thekogans_util_EpochManager_h
+
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "thekogans/util/Config.h"
+#include "thekogans/util/Types.h"
+#include "thekogans/util/Constants.h"
+#include "thekogans/util/TimeSpec.h"
+#include "thekogans/util/SpinLock.h"
+#include "thekogans/util/Singleton.h"
+
+namespace thekogans {
+    namespace util {
+
+        /// \struct EpochManager EpochManager.h thekogans/util/EpochManager.h
+        ///
+        /// \brief
+        /// EpochManager implements epoch based memory reclamation (EBR). Lock-free
+        /// containers (\see{LockFreeStack}, \see{LockFreeQueue}) unlink nodes that
+        /// other threads might still be looking at. Instead of deleting them right
+        /// away, they Retire them. The nodes are deleted once every thread that could
+        /// have seen them has left its critical section. Readers pay for it with two
+        /// stores per critical section (no RMW, no per node reference counting).
+        ///
+        /// Use it like this:
+        ///
+        /// \code{.cpp}
+        /// {
+        ///     util::EpochManager::Guard guard;
+        ///     Node *node = head.load ();
+        ///     // node (and anything reachable from it) stays valid
+        ///     // until guard goes out of scope...
+        ///     if (head.compare_exchange_strong (node, node->next)) {
+        ///         // ...even though we retire it here.
+        ///         util::EpochManager::Instance ()->Retire (node);
+        ///     }
+        /// }
+        /// \endcode
+        ///
+        /// Every thread that enters a critical section gets a per thread record. The
+        /// record (and its retire list) is handed back when the thread exits. Whatever
+        /// the thread retired but could not yet delete is adopted by the manager and
+        /// deleted later by whichever thread reclaims next (or by the background
+        /// reclaimer, see StartReclaimer).
+        ///
+        /// IMPORTANT: Don't block (or stay for long) inside a critical section.
+        /// Nothing retired after you entered can be deleted until you leave.
+
+        struct _LIB_THEKOGANS_UTIL_DECL EpochManager : public Singleton<EpochManager> {
+            /// \brief
+            /// Retired object deleter.
+            using Deleter = void (*) (void * /*ptr*/);
+            /// \brief
+            /// Once a thread's retire list grows this long, Retire
+            /// will try to advance the epoch and reclaim.
+            static const std::size_t DEFAULT_RECLAIM_THRESHOLD = 64;
+
+            /// \struct EpochManager::Guard EpochManager.h thekogans/util/EpochManager.h
+            ///
+            /// \brief
+            /// Enter an epoch critical section in the ctor and leave it in the dtor.
+            /// Guards nest.
+            struct _LIB_THEKOGANS_UTIL_DECL Guard {
+                /// \brief
+                /// ctor. Enter the critical section.
+                Guard () {
+                    EpochManager::Instance ()->Enter ();
+                }
+                /// \brief
+                /// dtor. Leave the critical section.
+                ~Guard () {
+                    EpochManager::Instance ()->Leave ();
+                }
+
+                /// \brief
+                /// Guard is neither copy constructable, nor assignable.
+                THEKOGANS_UTIL_DISALLOW_COPY_AND_ASSIGN (Guard)
+            };
+
+            /// \struct EpochManager::Retired EpochManager.h thekogans/util/EpochManager.h
+            ///
+            /// \brief
+            /// An object waiting to be deleted.
+            struct Retired {
+                /// \brief
+                /// Object to delete.
+                void *ptr;
+                /// \brief
+                /// How to delete it.
+                Deleter deleter;
+                /// \brief
+                /// Global epoch at the time the object was retired.
+                ui64 epoch;
+            };
+            /// \brief
+            /// Alias for std::vector<Retired>.
+            using RetiredList = std::vector<Retired>;
+
+            /// \struct EpochManager::ThreadRecord EpochManager.h thekogans/util/EpochManager.h
+            ///
+            /// \brief
+            /// Per thread state.
+            struct ThreadRecord;
+
+        private:
+            /// \brief
+            /// Global epoch.
+            std::atomic<ui64> epoch;
+            /// \brief
+            /// List of all thread records (records are reused, never freed).
+            std::atomic<ThreadRecord *> records;
+            /// \brief
+            /// Retire lists left behind by exited threads.
+            RetiredList orphans;
+            /// \brief
+            /// Protects orphans.
+            SpinLock orphansSpinLock;
+            /// \brief
+            /// Retire list length that triggers a reclaim.
+            std::atomic<std::size_t> reclaimThreshold;
+            /// \struct EpochManager::Reclaimer EpochManager.h thekogans/util/EpochManager.h
+            ///
+            /// \brief
+            /// Background reclaimer thread.
+            struct Reclaimer;
+            /// \brief
+            /// Background reclaimer (if started).
+            std::unique_ptr<Reclaimer> reclaimer;
+            /// \brief
+            /// Protects reclaimer.
+            SpinLock reclaimerSpinLock;
+
+        public:
+            /// \brief
+            /// ctor.
+            EpochManager ();
+            /// \brief
+            /// dtor.
+            ~EpochManager ();
+
+            /// \brief
+            /// Return the global epoch.
+            /// \return The global epoch.
+            inline ui64 GetEpoch () const {
+                return epoch.load (std::memory_order_acquire);
+            }
+
+            /// \brief
+            /// Set the retire list length that triggers a reclaim.
+            /// \param[in] reclaimThreshold_ New reclaim threshold.
+            inline void SetReclaimThreshold (std::size_t reclaimThreshold_) {
+                reclaimThreshold.store (reclaimThreshold_, std::memory_order_relaxed);
+            }
+
+            /// \brief
+            /// Enter a critical section. Prefer \see{Guard}.
+            void Enter ();
+            /// \brief
+            /// Leave a critical section. Prefer \see{Guard}.
+            void Leave ();
+
+            /// \brief
+            /// Hand an unlinked object over to be deleted once no thread can see it.
+            /// \param[in] ptr Object to delete.
+            /// \param[in] deleter How to delete it.
+            void Retire (
+                void *ptr,
+                Deleter deleter);
+            /// \brief
+            /// Hand an unlinked object over to be deleted once no thread can see it.
+            /// \param[in] ptr Object to delete (using delete).
+            template<typename T>
+            void Retire (T *ptr) {
+                Retire (ptr, [] (void *ptr) {delete (T *)ptr;});
+            }
+
+            /// \brief
+            /// Advance the global epoch if every thread in a critical
+            /// section has caught up with it.
+            /// \return true == advanced.
+            bool TryAdvance ();
+            /// \brief
+            /// Try to advance the epoch and delete whatever (of the calling
+            /// thread's and orphaned objects) is safe to delete.
+            /// \return Number of objects deleted.
+            std::size_t Reclaim ();
+
+            /// \brief
+            /// Start a background thread that periodically advances the epoch
+            /// and deletes orphaned objects. Useful when threads retire objects
+            /// in bursts and then go quiet (or exit).
+            /// \param[in] period How often to reclaim.
+            void StartReclaimer (
+                const TimeSpec &period = TimeSpec::FromMilliseconds (100));
+            /// \brief
+            /// Stop the background reclaimer.
+            void StopReclaimer ();
+
+        private:
+            /// \brief
+            /// Return the calling thread's record (allocate one if needed).
+            /// \return The calling thread's record.
+            ThreadRecord *GetThreadRecord ();
+            /// \brief
+            /// Called when a thread exits to return its record.
+            /// \param[in] record Record to return.
+            void ReleaseThreadRecord (ThreadRecord *record);
+            /// \brief
+            /// Delete everything in retiredList that's safe to delete.
+            /// \param[in, out] retiredList List to reclaim.
+            /// \return Number of objects deleted.
+            std::size_t Reclaim (RetiredList &retiredList);
+            /// \brief
+            /// Delete whatever orphans are safe to delete.
+            /// \return Number of objects deleted.
+            std::size_t ReclaimOrphans ();
+
+            /// \struct EpochManager::ThreadRecordHolder EpochManager.h thekogans/util/EpochManager.h
+            ///
+            /// \brief
+            /// thread_local holder that returns the record when its thread exits.
+            struct ThreadRecordHolder;
+
+            /// \brief
+            /// EpochManager is neither copy constructable, nor assignable.
+            THEKOGANS_UTIL_DISALLOW_COPY_AND_ASSIGN (EpochManager)
+        };
+
+    } // namespace util
+} // namespace thekogans
+
+#endif // !defined (__thekogans_util_EpochManager_h)
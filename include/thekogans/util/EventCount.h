@@ -0,0 +1,121 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_util_EventCount_h)
+#define __thekogans_util_EventCount_h
+
+#include "thekogans/util/Environment.h"
+#include <atomic>
+#include "thekogans/util/Config.h"
+#include "thekogans/util/Types.h"
+#include "thekogans/util/TimeSpec.h"
+#if !defined (TOOLCHAIN_OS_Linux)
+    #include "thekogans/util/Mutex.h"
+    #include "thekogans/util/Condition.h"
+#endif // !defined (TOOLCHAIN_OS_Linux)
+
+namespace thekogans {
+    namespace util {
+
+        /// \struct EventCount EventCount.h thekogans/util/EventCount.h
+        ///
+        /// \brief
+        /// EventCount lets a thread block on a condition that is maintained by
+        /// lock-free code (see \see{BlockingRingQueue}) without putting a lock on
+        /// the fast path. The waiter announces itself, re-checks its condition,
+        /// and only then blocks:
+        ///
+        /// \code{.cpp}
+        /// while (!queue.Pop (value)) {
+        ///     ui32 key = notEmpty.PrepareWait ();
+        ///     if (queue.Pop (value)) {
+        ///         notEmpty.CancelWait ();
+        ///         break;
+        ///     }
+        ///     notEmpty.Wait (key);
+        /// }
+        /// \endcode
+        ///
+        /// The other side changes the condition and calls Notify/NotifyAll.
+        /// Those are a fence and a load unless somebody is actually waiting.
+        /// On Linux waiters block on a futex. Elsewhere they block on a
+        /// \see{Condition}.
+
+        struct _LIB_THEKOGANS_UTIL_DECL EventCount {
+        private:
+            /// \brief
+            /// Bumped by every Notify that finds waiters (futex word on Linux).
+            std::atomic<ui32> epoch;
+            /// \brief
+            /// Number of threads between PrepareWait and Wait/CancelWait.
+            std::atomic<ui32> waiters;
+        #if !defined (TOOLCHAIN_OS_Linux)
+            /// \brief
+            /// Synchronization mutex.
+            Mutex mutex;
+            /// \brief
+            /// Waiters block on this condition.
+            Condition condition;
+        #endif // !defined (TOOLCHAIN_OS_Linux)
+
+        public:
+            /// \brief
+            /// ctor.
+            EventCount ();
+
+            /// \brief
+            /// Announce the intention to wait. Must be followed by
+            /// either Wait or CancelWait.
+            /// \return Key to pass to Wait.
+            ui32 PrepareWait ();
+            /// \brief
+            /// The condition became true after PrepareWait. Don't wait.
+            void CancelWait ();
+            /// \brief
+            /// Block until Notify/NotifyAll is called after the PrepareWait
+            /// that returned the key. Like all condition waits, it can
+            /// return spuriously. Re-check the condition.
+            /// \param[in] key Value returned by PrepareWait.
+            /// \param[in] timeSpec How long to wait.
+            /// IMPORTANT: timeSpec is a relative value.
+            /// \return false == timed out.
+            bool Wait (
+                ui32 key,
+                const TimeSpec &timeSpec = TimeSpec::Infinite);
+
+            /// \brief
+            /// Wake up one waiter.
+            void Notify ();
+            /// \brief
+            /// Wake up all waiters.
+            void NotifyAll ();
+
+        private:
+            /// \brief
+            /// Wake up to count waiters.
+            /// \param[in] count Max number of waiters to wake up.
+            void Wake (ui32 count);
+
+            /// \brief
+            /// EventCount is neither copy constructable, nor assignable.
+            THEKOGANS_UTIL_DISALLOW_COPY_AND_ASSIGN (EventCount)
+        };
+
+    } // namespace util
+} // namespace thekogans
+
+#endif // !defined (__thekogans_util_EventCount_h)
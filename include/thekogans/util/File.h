@@ -231,6 +231,12 @@ namespace thekogans {
             inline const std::string &GetPath () const {
                 return path;
             }
+            /// \brief
+            /// Return the OS file handle.
+            /// \return OS file handle.
+            inline THEKOGANS_UTIL_HANDLE GetHandle () const {
+                return handle;
+            }
 
             /// \brief
             /// Return a unique identifier for this file.
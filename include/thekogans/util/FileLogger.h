@@ -18,10 +18,12 @@
 #if !defined (__thekogans_util_FileLogger_h)
 #define __thekogans_util_FileLogger_h
 
+#include <memory>
 #include <string>
 #include "thekogans/util/Config.h"
 #include "thekogans/util/Logger.h"
 #include "thekogans/util/File.h"
+#include "thekogans/util/BufferedSerializer.h"
 
 namespace thekogans {
     namespace util {
@@ -32,7 +34,12 @@ namespace thekogans {
         /// A pluggable Logger instance used to dump log entries to a
         /// file. If archive_ = true, the log file is rotated. Two
         /// backups are created (*.1, and *.2). Older archives will be
-        /// dropped.
+        /// dropped. By default every entry is written straight to the
+        /// file, so that nothing is lost if the process crashes. Busy
+        /// loggers can opt in to a write-behind buffer (bufferSize > 0,
+        /// \see{BufferedSerializer}). Entries are then written out when
+        /// it fills up, on Flush, or immediately if their level is
+        /// \see{LoggerMgr::Error}. Anything still buffered is lost on a crash.
 
         struct _LIB_THEKOGANS_UTIL_DECL FileLogger : public Logger {
             /// \brief
@@ -55,6 +62,9 @@ namespace thekogans {
             /// \brief
             /// File to log to.
             SimpleFile file;
+            /// \brief
+            /// Write-behind buffer in front of file (nullptr == write through).
+            std::unique_ptr<BufferedSerializer> serializer;
 
         public:
             /// \brief
@@ -63,6 +73,9 @@ namespace thekogans {
             /// \brief
             /// Default max log file size before archiving.
             static const std::size_t DEFAULT_MAX_LOG_FILE_SIZE = 2 * 1024 * 1024;
+            /// \brief
+            /// Default write-behind buffer size (0 == write through).
+            static const std::size_t DEFAULT_BUFFER_SIZE = 0;
 
             /// \brief
             /// ctor.
@@ -71,17 +84,21 @@ namespace thekogans {
             /// \param[in] archiveCount_ Number of archives before we start droping.
             /// \param[in] maxLogFileSize_ Max log file size before archiving.
             /// \param[in] level \see{LoggerMgr::level} this logger will log up to.
+            /// \param[in] bufferSize Write-behind buffer size (0 == write through).
             FileLogger (
                 const std::string &path_,
                 bool archive_ = true,
                 std::size_t archiveCount_ = DEFAULT_ARCHIVE_COUNT,
                 std::size_t maxLogFileSize_ = DEFAULT_MAX_LOG_FILE_SIZE,
-                ui32 level = MaxLevel) :
+                ui32 level = MaxLevel,
+                std::size_t bufferSize = DEFAULT_BUFFER_SIZE) :
                 Logger (level),
                 path (path_),
                 archive (archive_),
                 archiveCount (archiveCount_),
-                maxLogFileSize (maxLogFileSize_) {}
+                maxLogFileSize (maxLogFileSize_),
+                serializer (bufferSize > 0 ?
+                    new BufferedSerializer (file, HostEndian, bufferSize) : nullptr) {}
 
             // Logger
             /// \brief
@@ -102,6 +119,9 @@ namespace thekogans {
             /// IMPORTANT: timeSpec is a relative value.
             virtual void Flush (const TimeSpec & /*timeSpec*/ = TimeSpec::Infinite) override {
                 if (file.IsOpen ()) {
+                    if (serializer != nullptr) {
+                        serializer->Flush ();
+                    }
                     file.Flush ();
                 }
             }
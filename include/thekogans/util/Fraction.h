@@ -22,6 +22,7 @@
 #include "thekogans/util/Config.h"
 #include "thekogans/util/Types.h"
 #include "thekogans/util/Serializable.h"
+#include "thekogans/util/SerializableFields.h"
 
 namespace thekogans {
     namespace util {
@@ -150,39 +151,96 @@ namespace thekogans {
 
             // Serializable
             /// \brief
-            /// Read the key from the given serializer.
-            /// \param[in] header \see{SerializableHeader}.
-            /// \param[in] serializer \see{Serializer} to read the key from.
-            virtual void Read (
-                const SerializableHeader & /*header*/,
-                Serializer &serializer) override;
+            /// Fraction serializes its numerator, denominator and sign.
+            THEKOGANS_UTIL_DECLARE_SERIALIZABLE_FIELDS (
+                THEKOGANS_UTIL_SERIALIZABLE_FIELD (Fraction, numerator, "Numerator"),
+                THEKOGANS_UTIL_SERIALIZABLE_FIELD (Fraction, denominator, "Denominator"),
+                THEKOGANS_UTIL_SERIALIZABLE_FIELD (Fraction, sign, "Sign"))
+        };
+
+        /// \struct FieldTraits<Fraction::Sign> Fraction.h thekogans/util/Fraction.h
+        ///
+        /// \brief
+        /// FieldTraits for \see{Fraction::Sign}. Binary sign is a ui8,
+        /// XML and JSON use signTostring/stringTosign.
+        template<>
+        struct FieldTraits<Fraction::Sign> {
             /// \brief
-            /// Write the key to the given serializer.
-            /// \param[out] serializer \see{Serializer} to write the key to.
-            virtual void Write (Serializer &serializer) const override;
+            /// Fixed binary size.
+            static constexpr std::size_t SIZE = UI8_SIZE;
 
             /// \brief
-            /// Read the Serializable from an XML DOM.
-            /// \param[in] header \see{SerializableHeader}.
-            /// \param[in] node XML DOM representation of a Serializable.
-            virtual void ReadXML (
-                const SerializableHeader & /*header*/,
-                const pugi::xml_node &node) override;
+            /// Return the binary size of the given sign.
+            /// \return Binary size of the given sign.
+            static constexpr std::size_t Size (Fraction::Sign /*sign*/) {
+                return SIZE;
+            }
+            /// \brief
+            /// Read the sign from the given serializer.
+            /// \param[in] serializer \see{Serializer} to read the sign from.
+            /// \param[out] sign Sign to read.
+            static void Read (
+                    Serializer &serializer,
+                    Fraction::Sign &sign) {
+                ui8 value;
+                serializer >> value;
+                sign = (Fraction::Sign)value;
+            }
             /// \brief
-            /// Write the Serializable to the XML DOM.
-            /// \param[out] node Parent node.
-            virtual void WriteXML (pugi::xml_node &node) const override;
+            /// Write the sign to the given serializer.
+            /// \param[out] serializer \see{Serializer} to write the sign to.
+            /// \param[in] sign Sign to write.
+            static void Write (
+                    Serializer &serializer,
+                    Fraction::Sign sign) {
+                serializer << (ui8)sign;
+            }
 
             /// \brief
-            /// Read the Serializable from an JSON DOM.
-            /// \param[in] node JSON DOM representation of a Serializable.
-            virtual void ReadJSON (
-                const SerializableHeader & /*header*/,
-                const JSON::Object &object) override;
+            /// Read the sign from the given XML node attribute.
+            /// \param[in] node XML node to read the sign from.
+            /// \param[in] name Attribute name.
+            /// \param[out] sign Sign to read.
+            static void ReadXML (
+                    const pugi::xml_node &node,
+                    const char *name,
+                    Fraction::Sign &sign) {
+                sign = Fraction::stringTosign (node.attribute (name).value ());
+            }
+            /// \brief
+            /// Write the sign to the given XML node attribute.
+            /// \param[out] node XML node to write the sign to.
+            /// \param[in] name Attribute name.
+            /// \param[in] sign Sign to write.
+            static void WriteXML (
+                    pugi::xml_node &node,
+                    const char *name,
+                    Fraction::Sign sign) {
+                node.append_attribute (name).set_value (Fraction::signTostring (sign).c_str ());
+            }
+
             /// \brief
-            /// Write the Serializable to the JSON DOM.
-            /// \param[out] node Parent node.
-            virtual void WriteJSON (JSON::Object &object) const override;
+            /// Read the sign from the given JSON object.
+            /// \param[in] object JSON object to read the sign from.
+            /// \param[in] name Value name.
+            /// \param[out] sign Sign to read.
+            static void ReadJSON (
+                    const JSON::Object &object,
+                    const char *name,
+                    Fraction::Sign &sign) {
+                sign = Fraction::stringTosign (object.Get<JSON::String> (name)->value);
+            }
+            /// \brief
+            /// Write the sign to the given JSON object.
+            /// \param[out] object JSON object to write the sign to.
+            /// \param[in] name Value name.
+            /// \param[in] sign Sign to write.
+            static void WriteJSON (
+                    JSON::Object &object,
+                    const char *name,
+                    Fraction::Sign sign) {
+                object.Add<const std::string &> (name, Fraction::signTostring (sign));
+            }
         };
 
         /// \brief
@@ -22,6 +22,7 @@
 #include <cstring>
 #include <cassert>
 #include <memory>
+#include <atomic>
 #include <functional>
 #include <unordered_map>
 #include <iostream>
@@ -675,6 +676,27 @@ namespace thekogans {
             /// \brief
             /// Synchronization lock.
             Lock lock;
+            /// \struct Heap::Counts Heap.h thekogans/util/Heap.h
+            ///
+            /// \brief
+            /// Heap counters published for GetStats. Alloc/Free store them
+            /// (relaxed, under lock) and GetStats loads them (relaxed, without
+            /// the lock). That keeps the diagnostics off the allocation path
+            /// at the cost of GetStats possibly catching them mid update.
+            struct Counts {
+                /// \brief
+                /// Heap minimum items in page.
+                std::atomic<std::size_t> itemsInPage;
+                /// \brief
+                /// Current number of items on the heap.
+                std::atomic<std::size_t> itemCount;
+                /// \brief
+                /// Number of full pages on the heap.
+                std::atomic<std::size_t> fullPagesCount;
+                /// \brief
+                /// Number of partial pages on the heap.
+                std::atomic<std::size_t> partialPagesCount;
+            } counts;
 
         public:
             /// \brief
@@ -693,6 +715,7 @@ namespace thekogans {
                     allocator (allocator_) {
                 assert (itemsInPage > 0);
                 assert (allocator != nullptr);
+                PublishCounts ();
                 HeapRegistry::Instance ()->AddHeap (GetName (), this);
             }
             /// \brief
@@ -809,15 +832,14 @@ namespace thekogans {
             /// Return a snapshot of the heap state.
             /// \return A snapshot of the heap state.
             virtual HeapRegistry::Diagnostics::Stats::UniquePtr GetStats () override {
-                LockGuard<Lock> guard (lock);
                 return HeapRegistry::Diagnostics::Stats::UniquePtr (
                     new Stats (
                         GetName (),
                         sizeof (T),
-                        itemsInPage,
-                        itemCount,
-                        fullPages.count,
-                        partialPages.count));
+                        counts.itemsInPage.load (std::memory_order_relaxed),
+                        counts.itemCount.load (std::memory_order_relaxed),
+                        counts.fullPagesCount.load (std::memory_order_relaxed),
+                        counts.partialPagesCount.load (std::memory_order_relaxed)));
             }
 
             /// \brief
@@ -853,6 +875,7 @@ namespace thekogans {
                         fullPages.push_back (page);
                     }
                     ++itemCount;
+                    PublishCounts ();
                     return ptr;
                 }
                 HeapRegistry::Instance ()->CallHeapErrorCallback (
@@ -898,6 +921,7 @@ namespace thekogans {
                             allocator->Free (page, Page::Size (page->maxItems));
                             itemsInPage >>= 1;
                         }
+                        PublishCounts ();
                     }
                     else {
                         HeapRegistry::Instance ()->CallHeapErrorCallback (
@@ -913,6 +937,15 @@ namespace thekogans {
             }
 
         private:
+            /// \brief
+            /// Publish the current counts. Must be called with lock held.
+            inline void PublishCounts () {
+                counts.itemsInPage.store (itemsInPage, std::memory_order_relaxed);
+                counts.itemCount.store (itemCount, std::memory_order_relaxed);
+                counts.fullPagesCount.store (fullPages.count, std::memory_order_relaxed);
+                counts.partialPagesCount.store (partialPages.count, std::memory_order_relaxed);
+            }
+
             /// \brief
             /// Return first partially allocated page (presumably for allocation).
             /// If no partially allocated pages left, allocate a new one.
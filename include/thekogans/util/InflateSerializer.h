@@ -0,0 +1,197 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_util_InflateSerializer_h)
+#define __thekogans_util_InflateSerializer_h
+
+#include "thekogans/util/Config.h"
+#include "thekogans/util/Types.h"
+#include "thekogans/util/ByteView.h"
+#include "thekogans/util/Serializer.h"
+#include "thekogans/util/Buffer.h"
+
+namespace thekogans {
+    namespace util {
+
+        /// \struct InflateSerializer InflateSerializer.h thekogans/util/InflateSerializer.h
+        ///
+        /// \brief
+        /// InflateSerializer wraps a \see{Serializer} holding a deflate stream
+        /// (\see{DeflateSerializer}, \see{Buffer::Deflate}, gzip...) and decompresses
+        /// it on the way through. Compressed bytes are pulled from the wrapped
+        /// serializer bufferSize at a time, so neither the compressed nor the
+        /// decompressed stream ever needs to be in memory all at once. Streams
+        /// compressed in parallel (pigz style) by \see{DeflateSerializer} are
+        /// ordinary deflate streams and inflate the same way.
+        ///
+        /// Example:
+        ///
+        /// \code{.cpp}
+        /// using namespace thekogans;
+        ///
+        /// util::SimpleFile file (util::HostEndian, path, util::SimpleFile::ReadOnly);
+        /// util::InflateSerializer serializer (file);
+        /// while (!serializer.IsEndOfStream ()) {
+        ///     serializer >> record;
+        ///     ...
+        /// }
+        /// \endcode
+        ///
+        /// NOTE: InflateSerializer has its own endianness (set in the ctor) which
+        /// governs all value extraction. The wrapped serializer only sees raw bytes.
+        /// IMPORTANT: Read ahead can pull bytes past the end of the compressed stream
+        /// out of the wrapped serializer. Once IsEndOfStream, GetUnusedInput returns them.
+
+        struct _LIB_THEKOGANS_UTIL_DECL InflateSerializer : public Serializer {
+            /// \brief
+            /// Declare the \see{DynamicCreatable} overrides.
+            THEKOGANS_UTIL_DECLARE_DYNAMIC_CREATABLE_OVERRIDE (InflateSerializer)
+
+            /// \enum
+            /// Stream formats.
+            enum Format {
+                /// \brief
+                /// zlib (RFC 1950) header and adler32 trailer.
+                Zlib,
+                /// \brief
+                /// gzip (RFC 1952) header and crc32 trailer.
+                Gzip,
+                /// \brief
+                /// Raw deflate (RFC 1951). No header or trailer.
+                Raw,
+                /// \brief
+                /// Zlib or Gzip (detected from the header).
+                Auto
+            };
+
+            /// \brief
+            /// Default (and largest) window size (log2).
+            static const i32 DEFAULT_WINDOW_BITS = 15;
+            /// \brief
+            /// Default size of the compressed chunks read from the wrapped serializer.
+            static const std::size_t DEFAULT_BUFFER_SIZE = 64 * 1024;
+
+        private:
+            /// \brief
+            /// Serializer we're decompressing from.
+            Serializer &serializer;
+            /// \struct InflateSerializer::Stream InflateSerializer.h thekogans/util/InflateSerializer.h
+            ///
+            /// \brief
+            /// Wraps the zlib stream.
+            struct Stream;
+            /// \brief
+            /// Decompression stream.
+            Stream *stream;
+            /// \brief
+            /// Compressed bytes read ahead from the wrapped serializer.
+            Buffer buffer;
+            /// \brief
+            /// Number of decompressed bytes read.
+            ui64 totalOut;
+            /// \brief
+            /// true == the end of the compressed stream was reached.
+            bool endOfStream;
+            /// \brief
+            /// Decompressed byte read ahead by IsEndOfStream.
+            ui8 peek;
+            /// \brief
+            /// true == peek holds a byte.
+            bool peeked;
+
+        public:
+            /// \brief
+            /// ctor.
+            /// \param[in] serializer_ Serializer to decompress from.
+            /// \param[in] endianness Serializer endianness.
+            /// \param[in] format Stream format.
+            /// \param[in] windowBits Window size (log2) [9, 15]. Must be at
+            /// least as large as the one the stream was compressed with.
+            /// \param[in] bufferSize Size of the compressed chunks read from serializer_.
+            InflateSerializer (
+                Serializer &serializer_,
+                Endianness endianness = HostEndian,
+                Format format = Auto,
+                i32 windowBits = DEFAULT_WINDOW_BITS,
+                std::size_t bufferSize = DEFAULT_BUFFER_SIZE);
+            /// \brief
+            /// dtor.
+            virtual ~InflateSerializer ();
+
+            /// \brief
+            /// Return the serializer we're decompressing from.
+            /// \return The serializer we're decompressing from.
+            inline Serializer &GetSerializer () const {
+                return serializer;
+            }
+            /// \brief
+            /// Return the number of decompressed bytes read.
+            /// \return Number of decompressed bytes read.
+            inline ui64 GetTotalOut () const {
+                return totalOut;
+            }
+            /// \brief
+            /// Return true if there are no more bytes to read. Reads
+            /// ahead (one byte) if necessary to find out.
+            /// \return true if there are no more bytes to read.
+            bool IsEndOfStream ();
+            /// \brief
+            /// Return the bytes read from the wrapped serializer past
+            /// the end of the compressed stream.
+            /// \return Bytes read past the end of the compressed stream.
+            inline ByteView GetUnusedInput () const {
+                return endOfStream ? buffer.GetReadView () : ByteView ();
+            }
+
+            // Serializer
+            /// \brief
+            /// Decompress bytes.
+            /// \param[out] data Where to place the bytes.
+            /// \param[in] count Number of bytes to read.
+            /// \return Number of bytes actually read (less than
+            /// count only at the end of the stream).
+            virtual std::size_t Read (
+                void *data,
+                std::size_t count) override;
+            /// \brief
+            /// InflateSerializer is read only. Throws.
+            /// \param[in] data Where the bytes come from.
+            /// \param[in] count Number of bytes to write.
+            /// \return Number of bytes actually written.
+            virtual std::size_t Write (
+                const void *data,
+                std::size_t count) override;
+
+        private:
+            /// \brief
+            /// Decompress up to count bytes.
+            /// \param[out] data Where to place the bytes.
+            /// \param[in] count Number of bytes to read.
+            /// \return Number of bytes actually read.
+            std::size_t Inflate (
+                ui8 *data,
+                std::size_t count);
+
+            /// \brief
+            /// InflateSerializer is neither copy constructable, nor assignable.
+            THEKOGANS_UTIL_DISALLOW_COPY_AND_ASSIGN (InflateSerializer)
+        };
+
+    } // namespace util
+} // namespace thekogans
+
+#endif // !defined (__thekogans_util_InflateSerializer_h)
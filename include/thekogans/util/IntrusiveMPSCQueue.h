@@ -0,0 +1,181 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_util_IntrusiveMPSCQueue_h)
+#define __thekogans_util_IntrusiveMPSCQueue_h
+
+#include <cstddef>
+#include <atomic>
+#include "thekogans/util/Types.h"
+#include "thekogans/util/Config.h"
+
+namespace thekogans {
+    namespace util {
+
+        /// \struct IntrusiveMPSCQueue IntrusiveMPSCQueue.h thekogans/util/IntrusiveMPSCQueue.h
+        ///
+        /// \brief
+        /// An unbounded, lock-free, multiple producer/single consumer intrusive
+        /// queue. Like \see{IntrusiveList}, nodes derive from IntrusiveMPSCQueue::Node
+        /// (one per queue they can reside in, selected by ID) and the queue eschews
+        /// all ownership semantics. Push is wait-free (one exchange and one store).
+        /// Pop is lock-free and never allocates.
+        ///
+        /// \code{.cpp}
+        /// using namespace thekogans;
+        ///
+        /// struct Message;
+        /// using MessageQueue = util::IntrusiveMPSCQueue<Message>;
+        ///
+        /// struct Message : public MessageQueue::Node {
+        ///     ...
+        /// };
+        ///
+        /// MessageQueue queue;
+        ///
+        /// // Any thread.
+        /// queue.Push (new Message (...));
+        ///
+        /// // Consumer thread.
+        /// Message *message = queue.Pop ();
+        /// if (message != nullptr) {
+        ///     ...
+        ///     delete message;
+        /// }
+        /// \endcode
+        ///
+        /// IMPORTANT: Pop can return nullptr while a producer is in the middle
+        /// of a Push even though the queue is not empty. The node becomes
+        /// visible as soon as that Push completes. Consumers that block (see
+        /// \see{EventCount}) should treat nullptr as 'try again after waiting'.
+        ///
+        /// VERY IMPORTANT: Any number of threads may push, but only one thread
+        /// may pop. A node can only be in the queue once, and must stay alive
+        /// until it's popped.
+
+        template<
+            typename T,
+            i32 ID = 0>
+        struct IntrusiveMPSCQueue {
+            /// \struct IntrusiveMPSCQueue::Node IntrusiveMPSCQueue.h thekogans/util/IntrusiveMPSCQueue.h
+            ///
+            /// \brief
+            /// For every IntrusiveMPSCQueue an object will reside in,
+            /// it must derive from that IntrusiveMPSCQueue::Node.
+            struct Node {
+                /// \brief
+                /// Pointer to next node.
+                std::atomic<Node *> next;
+
+                /// \brief
+                /// ctor.
+                Node () :
+                    next (nullptr) {}
+                /// \brief
+                /// dtor.
+                virtual ~Node () {}
+            };
+
+            /// \brief
+            /// Size of the cache line the ends are padded to.
+            static const std::size_t CACHE_LINE_SIZE = 64;
+
+        private:
+            /// \brief
+            /// Last pushed node (shared by the producers).
+            alignas (CACHE_LINE_SIZE) std::atomic<Node *> tail;
+            /// \brief
+            /// Next node to pop (consumer only).
+            alignas (CACHE_LINE_SIZE) Node *head;
+            /// \brief
+            /// Placeholder that keeps the list from ever becoming
+            /// empty, so that producers never touch head.
+            Node stub;
+
+        public:
+            /// \brief
+            /// ctor.
+            IntrusiveMPSCQueue () :
+                tail (&stub),
+                head (&stub) {}
+
+            /// \brief
+            /// Return true if the queue is empty (consumer only).
+            /// \return true if the queue is empty.
+            inline bool IsEmpty () const {
+                return head == &stub &&
+                    stub.next.load (std::memory_order_acquire) == nullptr;
+            }
+
+            /// \brief
+            /// Push a node (any thread).
+            /// \param[in] node Node to push.
+            inline void Push (T *node) {
+                PushNode (node);
+            }
+
+            /// \brief
+            /// Pop a node (consumer only).
+            /// \return Popped node (nullptr == empty or a Push is in progress).
+            T *Pop () {
+                Node *first = head;
+                Node *next = first->next.load (std::memory_order_acquire);
+                if (first == &stub) {
+                    if (next == nullptr) {
+                        return nullptr;
+                    }
+                    head = first = next;
+                    next = next->next.load (std::memory_order_acquire);
+                }
+                if (next != nullptr) {
+                    head = next;
+                    return static_cast<T *> (first);
+                }
+                if (first != tail.load (std::memory_order_acquire)) {
+                    // A producer swapped the tail but hasn't linked it yet.
+                    return nullptr;
+                }
+                // first is the last node. Put the stub
+                // behind it so that it can be unlinked.
+                PushNode (&stub);
+                next = first->next.load (std::memory_order_acquire);
+                if (next != nullptr) {
+                    head = next;
+                    return static_cast<T *> (first);
+                }
+                return nullptr;
+            }
+
+        private:
+            /// \brief
+            /// Append a node.
+            /// \param[in] node Node to append.
+            inline void PushNode (Node *node) {
+                node->next.store (nullptr, std::memory_order_relaxed);
+                Node *prev = tail.exchange (node, std::memory_order_acq_rel);
+                prev->next.store (node, std::memory_order_release);
+            }
+
+            /// \brief
+            /// IntrusiveMPSCQueue is neither copy constructable, nor assignable.
+            THEKOGANS_UTIL_DISALLOW_COPY_AND_ASSIGN (IntrusiveMPSCQueue)
+        };
+
+    } // namespace util
+} // namespace thekogans
+
+#endif // !defined (__thekogans_util_IntrusiveMPSCQueue_h)
@@ -48,6 +48,98 @@ namespace thekogans {
             /// Declare \see{RefCounted} pointers.
             THEKOGANS_UTIL_DECLARE_REF_COUNTED_POINTERS (JobQueue)
 
+            /// \struct JobQueue::ElasticPolicy JobQueue.h thekogans/util/JobQueue.h
+            ///
+            /// \brief
+            /// By default a JobQueue runs a fixed number of workers. Give it an
+            /// ElasticPolicy with minWorkers < maxWorkers and the queue will grow
+            /// a worker (up to maxWorkers) every time the pending job count exceeds
+            /// maxPendingJobs, or a job waits in the queue longer than maxJobWaitTime.
+            /// Workers idle for longer than idleTimeout retire (down to minWorkers).
+            /// The workerCount passed to the JobQueue ctor becomes the initial worker
+            /// count (clamped to [minWorkers, maxWorkers]). Scaling decisions are
+            /// recorded in \see{WorkerStats}.
+            struct _LIB_THEKOGANS_UTIL_DECL ElasticPolicy {
+                /// \brief
+                /// Never retire below this many workers (must be > 0).
+                std::size_t minWorkers;
+                /// \brief
+                /// Never grow above this many workers.
+                std::size_t maxWorkers;
+                /// \brief
+                /// Grow when there are more than this many pending jobs (0 == ignore depth).
+                std::size_t maxPendingJobs;
+                /// \brief
+                /// Grow when a job waited longer than this to be picked
+                /// up (TimeSpec::Infinite == ignore wait time).
+                TimeSpec maxJobWaitTime;
+                /// \brief
+                /// Retire workers that have been idle this long
+                /// (TimeSpec::Infinite == never retire).
+                TimeSpec idleTimeout;
+
+                /// \brief
+                /// ctor.
+                /// \param[in] minWorkers_ Never retire below this many workers.
+                /// \param[in] maxWorkers_ Never grow above this many workers.
+                /// \param[in] maxPendingJobs_ Grow when there are more than this many pending jobs.
+                /// \param[in] maxJobWaitTime_ Grow when a job waited longer than this.
+                /// \param[in] idleTimeout_ Retire workers that have been idle this long.
+                ElasticPolicy (
+                    std::size_t minWorkers_ = 0,
+                    std::size_t maxWorkers_ = 0,
+                    std::size_t maxPendingJobs_ = 0,
+                    const TimeSpec &maxJobWaitTime_ = TimeSpec::Infinite,
+                    const TimeSpec &idleTimeout_ = TimeSpec::Infinite) :
+                    minWorkers (minWorkers_),
+                    maxWorkers (maxWorkers_),
+                    maxPendingJobs (maxPendingJobs_),
+                    maxJobWaitTime (maxJobWaitTime_),
+                    idleTimeout (idleTimeout_) {}
+
+                /// \brief
+                /// Return true if the worker count can change.
+                /// \return true if the worker count can change.
+                inline bool IsElastic () const {
+                    return minWorkers < maxWorkers;
+                }
+            };
+
+            /// \struct JobQueue::WorkerStats JobQueue.h thekogans/util/JobQueue.h
+            ///
+            /// \brief
+            /// Worker scaling decisions made by an elastic JobQueue.
+            struct _LIB_THEKOGANS_UTIL_DECL WorkerStats {
+                /// \brief
+                /// Current number of workers.
+                std::size_t workerCount;
+                /// \brief
+                /// Highest number of workers the queue ever had.
+                std::size_t peakWorkerCount;
+                /// \brief
+                /// Number of workers added because the queue got too deep.
+                std::size_t grownOnDepth;
+                /// \brief
+                /// Number of workers added because a job waited too long.
+                std::size_t grownOnWaitTime;
+                /// \brief
+                /// Number of times the queue wanted to grow but was at maxWorkers.
+                std::size_t capped;
+                /// \brief
+                /// Number of idle workers retired.
+                std::size_t retired;
+
+                /// \brief
+                /// ctor.
+                WorkerStats () :
+                    workerCount (0),
+                    peakWorkerCount (0),
+                    grownOnDepth (0),
+                    grownOnWaitTime (0),
+                    capped (0),
+                    retired (0) {}
+            };
+
             /// \struct JobQueue::State JobQueue.h thekogans/util/JobQueue.h
             ///
             /// \brief
@@ -64,7 +156,8 @@ namespace thekogans {
                 THEKOGANS_UTIL_DECLARE_STD_ALLOCATOR_FUNCTIONS
 
                 /// \brief
-                /// Number of workers servicing the queue.
+                /// Number of workers servicing the queue (initial
+                /// worker count if the queue is elastic).
                 const std::size_t workerCount;
                 /// \brief
                 /// \Worker thread priority.
@@ -119,6 +212,15 @@ namespace thekogans {
                 /// \brief
                 /// Synchronization mutex.
                 Mutex workersMutex;
+                /// \brief
+                /// Worker scaling policy.
+                const ElasticPolicy elasticPolicy;
+                /// \brief
+                /// elasticPolicy.maxJobWaitTime in \see{HRTimer} ticks.
+                const ui64 maxJobWaitTime;
+                /// \brief
+                /// Worker scaling stats (protected by workersMutex).
+                WorkerStats workerStats;
 
                 /// \brief
                 /// ctor.
@@ -131,18 +233,42 @@ namespace thekogans {
                 /// \param[in] workerAffinity_ Worker thread processor affinity.
                 /// \param[in] workerCallback_ Called to initialize/uninitialize
                 /// the worker thread.
+                /// \param[in] elasticPolicy_ Worker scaling policy.
                 State (
                     const std::string &name = std::string (),
                     JobExecutionPolicy::SharedPtr jobExecutionPolicy = new FIFOJobExecutionPolicy,
                     std::size_t workerCount_ = 1,
                     i32 workerPriority_ = THEKOGANS_UTIL_NORMAL_THREAD_PRIORITY,
                     ui32 workerAffinity_ = THEKOGANS_UTIL_MAX_THREAD_AFFINITY,
-                    WorkerCallback *workerCallback_ = nullptr) :
-                    RunLoop::State (name, jobExecutionPolicy),
-                    workerCount (workerCount_),
-                    workerPriority (workerPriority_),
-                    workerAffinity (workerAffinity_),
-                    workerCallback (workerCallback_) {}
+                    WorkerCallback *workerCallback_ = nullptr,
+                    const ElasticPolicy &elasticPolicy_ = ElasticPolicy ());
+
+                /// \brief
+                /// Create a new worker and add it to the list.
+                /// NOTE: Must be called with workersMutex held.
+                /// \param[in] index Worker index (used to name the worker thread).
+                void AddWorker (std::size_t index);
+                /// \brief
+                /// Called after a job is enqueued (elastic queues only).
+                /// Grow if the queue is too deep.
+                void JobEnqueued ();
+                /// \brief
+                /// Called by a worker after it dequeued a job (elastic queues only).
+                /// Grow if the job waited too long.
+                /// \param[in] job Job that was just dequeued.
+                void JobDequeued (const Job &job);
+                /// \brief
+                /// Called by an idle worker after elasticPolicy.idleTimeout.
+                /// \param[in] worker Worker that would like to retire.
+                /// \return true == worker was removed from the list and should exit.
+                bool RetireWorker (Worker *worker);
+
+            private:
+                /// \brief
+                /// Add a worker if we are below elasticPolicy.maxWorkers.
+                /// NOTE: Must be called with workersMutex held.
+                /// \param[in] grown Stat to bump if the worker was added.
+                void Grow (std::size_t &grown);
             };
 
         protected:
@@ -160,13 +286,15 @@ namespace thekogans {
             /// \param[in] workerPriority Worker thread priority.
             /// \param[in] workerAffinity Worker thread processor affinity.
             /// \param[in] workerCallback Called to initialize/uninitialize the worker thread(s).
+            /// \param[in] elasticPolicy Worker scaling policy (default: fixed workerCount).
             JobQueue (
                 const std::string &name = std::string (),
                 JobExecutionPolicy::SharedPtr jobExecutionPolicy = new FIFOJobExecutionPolicy,
                 std::size_t workerCount = 1,
                 i32 workerPriority = THEKOGANS_UTIL_NORMAL_THREAD_PRIORITY,
                 ui32 workerAffinity = THEKOGANS_UTIL_MAX_THREAD_AFFINITY,
-                WorkerCallback *workerCallback = nullptr);
+                WorkerCallback *workerCallback = nullptr,
+                const ElasticPolicy &elasticPolicy = ElasticPolicy ());
             /// \brief
             /// dtor. Stop the queue.
             virtual ~JobQueue () {
@@ -201,6 +329,41 @@ namespace thekogans {
             /// \return true is the run loop is running (Start was called).
             virtual bool IsRunning () override;
 
+            /// \brief
+            /// Need this to prevent hiding the overloads.
+            using RunLoop::EnqJob;
+            /// \brief
+            /// Enqueue a job and, if the queue is elastic, see if it needs another worker.
+            /// \param[in] job Job to enqueue.
+            /// \param[in] wait Wait for job to finish. Used for synchronous job execution.
+            /// \param[in] timeSpec How long to wait for the job to complete.
+            /// IMPORTANT: timeSpec is a relative value.
+            /// \return true == !wait || WaitForJob (...)
+            virtual bool EnqJob (
+                Job::SharedPtr job,
+                bool wait = false,
+                const TimeSpec &timeSpec = TimeSpec::Infinite) override;
+            /// \brief
+            /// Need this to prevent hiding the overloads.
+            using RunLoop::EnqJobFront;
+            /// \brief
+            /// Enqueue a job at the front and, if the queue is elastic,
+            /// see if it needs another worker.
+            /// \param[in] job Job to enqueue.
+            /// \param[in] wait Wait for job to finish. Used for synchronous job execution.
+            /// \param[in] timeSpec How long to wait for the job to complete.
+            /// IMPORTANT: timeSpec is a relative value.
+            /// \return true == !wait || WaitForJob (...)
+            virtual bool EnqJobFront (
+                Job::SharedPtr job,
+                bool wait = false,
+                const TimeSpec &timeSpec = TimeSpec::Infinite) override;
+
+            /// \brief
+            /// Return the worker scaling stats.
+            /// \return \see{WorkerStats}.
+            WorkerStats GetWorkerStats ();
+
         protected:
             /// \brief
             /// ctor.
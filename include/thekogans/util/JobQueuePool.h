@@ -75,6 +75,37 @@ namespace thekogans {
         /// as the Job goes out of scope (as Job will be the last reference).
 
         struct _LIB_THEKOGANS_UTIL_DECL JobQueuePool {
+            /// \struct JobQueuePool::Stats JobQueuePool.h thekogans/util/JobQueuePool.h
+            ///
+            /// \brief
+            /// Pool sizing decisions.
+            struct _LIB_THEKOGANS_UTIL_DECL Stats {
+                /// \brief
+                /// Current number of \see{JobQueue}s (available + borrowed).
+                std::size_t jobQueueCount;
+                /// \brief
+                /// Highest number of \see{JobQueue}s the pool ever had.
+                std::size_t peakJobQueueCount;
+                /// \brief
+                /// Number of \see{JobQueue}s created.
+                std::size_t created;
+                /// \brief
+                /// Number of \see{JobQueue}s deleted.
+                std::size_t retired;
+                /// \brief
+                /// Number of times GetJobQueue came back empty handed.
+                std::size_t exhausted;
+
+                /// \brief
+                /// ctor.
+                Stats () :
+                    jobQueueCount (0),
+                    peakJobQueueCount (0),
+                    created (0),
+                    retired (0),
+                    exhausted (0) {}
+            };
+
         private:
             /// \brief
             /// Minimum number of job queues to keep in the pool.
@@ -101,6 +132,13 @@ namespace thekogans {
             /// Called to initialize/uninitialize the \see{JobQueue} worker thread.
             RunLoop::WorkerCallback *workerCallback;
             /// \brief
+            /// \see{JobQueue} worker scaling policy.
+            const util::JobQueue::ElasticPolicy elasticPolicy;
+            /// \brief
+            /// Delete available \see{JobQueue}s (above minJobQueues)
+            /// that have not been borrowed for this long.
+            const TimeSpec jobQueueIdleTimeout;
+            /// \brief
             /// Forward declaration of JobQueue.
             struct JobQueue;
             /// \brief
@@ -126,6 +164,9 @@ namespace thekogans {
                 /// \brief
                 /// JobQueuePool from which this \see{JobQueue} came.
                 JobQueuePool &jobQueuePool;
+                /// \brief
+                /// When was this \see{JobQueue} last returned to the pool.
+                TimeSpec releaseTime;
 
             public:
                 /// \brief
@@ -137,6 +178,7 @@ namespace thekogans {
                 /// \param[in] workerAffinity \see{JobQueue} worker thread processor affinity.
                 /// \param[in] workerCallback Called to initialize/uninitialize the
                 /// \see{JobQueue} worker thread(s).
+                /// \param[in] elasticPolicy \see{JobQueue} worker scaling policy.
                 /// \param[in] jobQueuePool_ JobQueuePool to which this jobQueue belongs.
                 JobQueue (
                     const std::string &name,
@@ -145,6 +187,7 @@ namespace thekogans {
                     i32 workerPriority,
                     ui32 workerAffinity,
                     WorkerCallback *workerCallback,
+                    const ElasticPolicy &elasticPolicy,
                     JobQueuePool &jobQueuePool_) :
                     util::JobQueue (
                         name,
@@ -152,8 +195,10 @@ namespace thekogans {
                         workerCount,
                         workerPriority,
                         workerAffinity,
-                        workerCallback),
-                    jobQueuePool (jobQueuePool_) {}
+                        workerCallback,
+                        elasticPolicy),
+                    jobQueuePool (jobQueuePool_),
+                    releaseTime (GetCurrentTime ()) {}
 
             protected:
                 // RefCounted
@@ -164,6 +209,10 @@ namespace thekogans {
                     jobQueuePool.ReleaseJobQueue (this);
                 }
 
+                /// \brief
+                /// JobQueuePool needs access to releaseTime.
+                friend struct JobQueuePool;
+
                 /// \brief
                 /// JobQueue is neither copy constructable, nor assignable.
                 THEKOGANS_UTIL_DISALLOW_COPY_AND_ASSIGN (JobQueue)
@@ -189,6 +238,12 @@ namespace thekogans {
             /// \brief
             /// Synchronization condition variable.
             Condition idle;
+            /// \brief
+            /// Signaled when a \see{JobQueue} is returned to the pool.
+            Condition available;
+            /// \brief
+            /// Pool sizing stats (protected by mutex).
+            Stats stats;
 
         public:
             /// \brief
@@ -202,6 +257,10 @@ namespace thekogans {
             /// \param[in] workerAffinity_ \see{JobQueue} worker thread processor affinity.
             /// \param[in] workerCallback_ Called to initialize/uninitialize the \see{JobQueue}
             /// worker thread.
+            /// \param[in] elasticPolicy_ \see{JobQueue} worker scaling policy.
+            /// \param[in] jobQueueIdleTimeout_ Delete available \see{JobQueue}s (above
+            /// minJobQueues_) that have not been borrowed for this long. By default,
+            /// excess queues are only deleted when the whole pool goes idle.
             JobQueuePool (
                 std::size_t minJobQueues_,
                 std::size_t maxJobQueues_,
@@ -211,7 +270,10 @@ namespace thekogans {
                 std::size_t workerCount_ = 1,
                 i32 workerPriority_ = THEKOGANS_UTIL_NORMAL_THREAD_PRIORITY,
                 ui32 workerAffinity_ = THEKOGANS_UTIL_MAX_THREAD_AFFINITY,
-                RunLoop::WorkerCallback *workerCallback_ = nullptr);
+                RunLoop::WorkerCallback *workerCallback_ = nullptr,
+                const util::JobQueue::ElasticPolicy &elasticPolicy_ =
+                    util::JobQueue::ElasticPolicy (),
+                const TimeSpec &jobQueueIdleTimeout_ = TimeSpec::Infinite);
             /// \brief
             /// dtor.
             virtual ~JobQueuePool ();
@@ -220,7 +282,8 @@ namespace thekogans {
             /// Acquire a \see{JobQueue} from the pool.
             /// \param[in] retries Number of times to retry if a \see{JobQueue} is not
             /// immediately available.
-            /// \param[in] timeSpec How long to wait between retries.
+            /// \param[in] timeSpec How long to wait (for a \see{JobQueue} to be
+            /// returned to the pool) between retries.
             /// IMPORTANT: timeSpec is a relative value.
             /// \return A \see{JobQueue} from the pool (nullptr if pool is exhausted).
             util::JobQueue::SharedPtr GetJobQueue (
@@ -291,9 +354,25 @@ namespace thekogans {
             /// \return true == this pool has no outstanding \see{JobQueue}s.
             bool IsIdle ();
 
+            /// \brief
+            /// Return the pool sizing stats.
+            /// \return \see{Stats}.
+            Stats GetStats ();
+
         private:
+            /// \brief
+            /// Create a new \see{JobQueue}.
+            /// NOTE: Must be called with mutex held.
+            /// \return \see{JobQueue} pointer.
+            JobQueue *CreateJobQueue ();
+            /// \brief
+            /// Delete a \see{JobQueue}.
+            /// NOTE: Must be called with mutex held.
+            /// \param[in] jobQueue \see{JobQueue} to delete.
+            void DeleteJobQueue (JobQueue *jobQueue);
             /// \brief
             /// Used by \see{GetJobQueue} to acquire a \see{JobQueue} from the pool.
+            /// NOTE: Must be called with mutex held.
             /// \return \see{JobQueue} pointer.
             JobQueue *AcquireJobQueue ();
             /// \brief
@@ -337,6 +416,9 @@ namespace thekogans {
             /// \param[in] workerAffinity \see{JobQueue} worker thread processor affinity.
             /// \param[in] workerCallback Called to initialize/uninitialize the \see{JobQueue}
             /// thread.
+            /// \param[in] elasticPolicy \see{JobQueue} worker scaling policy.
+            /// \param[in] jobQueueIdleTimeout Delete available \see{JobQueue}s (above
+            /// minJobQueues) that have not been borrowed for this long.
             GlobalJobQueuePool (
                 std::size_t minJobQueues = 0,
                 std::size_t maxJobQueues = 0,
@@ -346,7 +428,10 @@ namespace thekogans {
                 std::size_t workerCount = 1,
                 i32 workerPriority = THEKOGANS_UTIL_NORMAL_THREAD_PRIORITY,
                 ui32 workerAffinity = THEKOGANS_UTIL_MAX_THREAD_AFFINITY,
-                RunLoop::WorkerCallback *workerCallback = nullptr) :
+                RunLoop::WorkerCallback *workerCallback = nullptr,
+                const util::JobQueue::ElasticPolicy &elasticPolicy =
+                    util::JobQueue::ElasticPolicy (),
+                const TimeSpec &jobQueueIdleTimeout = TimeSpec::Infinite) :
                 JobQueuePool (
                     minJobQueues,
                     maxJobQueues,
@@ -355,7 +440,9 @@ namespace thekogans {
                     workerCount,
                     workerPriority,
                     workerAffinity,
-                    workerCallback) {}
+                    workerCallback,
+                    elasticPolicy,
+                    jobQueueIdleTimeout) {}
         };
 
     } // namespace util
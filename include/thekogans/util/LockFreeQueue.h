@@ -0,0 +1,183 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_util_LockFreeQueue_h)
+#define __thekogans_util_LockFreeQueue_h
+
+#include <atomic>
+#include <utility>
+#include "thekogans/util/Config.h"
+#include "thekogans/util/EpochManager.h"
+
+namespace thekogans {
+    namespace util {
+
+        /// \struct LockFreeQueue LockFreeQueue.h thekogans/util/LockFreeQueue.h
+        ///
+        /// \brief
+        /// LockFreeQueue is a Michael-Scott queue. Any number of threads can Enq
+        /// and Deq concurrently. Dequeued nodes are handed to the \see{EpochManager}
+        /// so that they're not freed while other threads are still looking at them.
+        /// The queue always contains a dummy node, so T must be default constructible.
+
+        template<typename T>
+        struct LockFreeQueue {
+        private:
+            /// \struct LockFreeQueue::Node LockFreeQueue.h thekogans/util/LockFreeQueue.h
+            ///
+            /// \brief
+            /// Queue node.
+            struct Node {
+                /// \brief
+                /// Node value.
+                T value;
+                /// \brief
+                /// Next node.
+                std::atomic<Node *> next;
+
+                /// \brief
+                /// ctor. Used for the dummy node.
+                Node () :
+                    next (nullptr) {}
+                /// \brief
+                /// ctor.
+                /// \param[in] value_ Node value.
+                explicit Node (const T &value_) :
+                    value (value_),
+                    next (nullptr) {}
+                /// \brief
+                /// ctor.
+                /// \param[in] value_ Node value.
+                explicit Node (T &&value_) :
+                    value (std::move (value_)),
+                    next (nullptr) {}
+            };
+            /// \brief
+            /// Queue head (always the dummy node).
+            std::atomic<Node *> head;
+            /// \brief
+            /// Queue tail (can lag behind by one node).
+            std::atomic<Node *> tail;
+
+        public:
+            /// \brief
+            /// ctor.
+            LockFreeQueue () {
+                Node *dummy = new Node;
+                head.store (dummy, std::memory_order_relaxed);
+                tail.store (dummy, std::memory_order_relaxed);
+            }
+            /// \brief
+            /// dtor. No other thread can be using the queue at this point.
+            ~LockFreeQueue () {
+                Node *node = head.load (std::memory_order_acquire);
+                while (node != nullptr) {
+                    Node *next = node->next.load (std::memory_order_relaxed);
+                    delete node;
+                    node = next;
+                }
+            }
+
+            /// \brief
+            /// Return true if the queue is empty.
+            /// \return true if the queue is empty.
+            bool IsEmpty () const {
+                EpochManager::Guard guard;
+                return head.load (std::memory_order_acquire)->next.load (
+                    std::memory_order_acquire) == nullptr;
+            }
+
+            /// \brief
+            /// Add a value to the tail of the queue.
+            /// \param[in] value Value to add.
+            void Enq (const T &value) {
+                EnqNode (new Node (value));
+            }
+            /// \brief
+            /// Add a value to the tail of the queue.
+            /// \param[in] value Value to add.
+            void Enq (T &&value) {
+                EnqNode (new Node (std::move (value)));
+            }
+
+            /// \brief
+            /// Remove a value from the head of the queue.
+            /// \param[out] value Where to put the removed value.
+            /// \return true == removed, false == queue was empty.
+            bool Deq (T &value) {
+                EpochManager::Guard guard;
+                while (1) {
+                    Node *first = head.load (std::memory_order_acquire);
+                    Node *last = tail.load (std::memory_order_acquire);
+                    Node *next = first->next.load (std::memory_order_acquire);
+                    if (first == head.load (std::memory_order_acquire)) {
+                        if (next == nullptr) {
+                            return false;
+                        }
+                        if (first == last) {
+                            // Tail is lagging. Help it along before
+                            // we unlink the node it points to.
+                            tail.compare_exchange_strong (last, next,
+                                std::memory_order_release, std::memory_order_relaxed);
+                        }
+                        else if (head.compare_exchange_strong (first, next,
+                                std::memory_order_acquire, std::memory_order_relaxed)) {
+                            // next is the new dummy. Only the thread that
+                            // won the race above gets to take its value.
+                            value = std::move (next->value);
+                            EpochManager::Instance ()->Retire (first);
+                            return true;
+                        }
+                    }
+                }
+            }
+
+        private:
+            /// \brief
+            /// Add a node to the tail of the queue.
+            /// \param[in] node Node to add.
+            void EnqNode (Node *node) {
+                EpochManager::Guard guard;
+                while (1) {
+                    Node *last = tail.load (std::memory_order_acquire);
+                    Node *next = last->next.load (std::memory_order_acquire);
+                    if (last == tail.load (std::memory_order_acquire)) {
+                        if (next == nullptr) {
+                            if (last->next.compare_exchange_weak (next, node,
+                                    std::memory_order_release, std::memory_order_relaxed)) {
+                                tail.compare_exchange_strong (last, node,
+                                    std::memory_order_release, std::memory_order_relaxed);
+                                return;
+                            }
+                        }
+                        else {
+                            tail.compare_exchange_strong (last, next,
+                                std::memory_order_release, std::memory_order_relaxed);
+                        }
+                    }
+                }
+            }
+
+            /// \brief
+            /// LockFreeQueue is neither copy constructable, nor assignable.
+            THEKOGANS_UTIL_DISALLOW_COPY_AND_ASSIGN (LockFreeQueue)
+        };
+
+    } // namespace util
+} // namespace thekogans
+
+#endif // !defined (__thekogans_util_LockFreeQueue_h)
@@ -0,0 +1,145 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_util_LockFreeStack_h)
+#define __thekogans_util_LockFreeStack_h
+
+#include <atomic>
+#include <utility>
+#include "thekogans/util/Config.h"
+#include "thekogans/util/EpochManager.h"
+
+namespace thekogans {
+    namespace util {
+
+        /// \struct LockFreeStack LockFreeStack.h thekogans/util/LockFreeStack.h
+        ///
+        /// \brief
+        /// LockFreeStack is a Treiber stack. Any number of threads can Push and
+        /// Pop concurrently. Popped nodes are handed to the \see{EpochManager},
+        /// so a node can't be freed (or reused, which is what causes ABA) while
+        /// another thread is still looking at it.
+
+        template<typename T>
+        struct LockFreeStack {
+        private:
+            /// \struct LockFreeStack::Node LockFreeStack.h thekogans/util/LockFreeStack.h
+            ///
+            /// \brief
+            /// Stack node.
+            struct Node {
+                /// \brief
+                /// Node value.
+                T value;
+                /// \brief
+                /// Next node.
+                Node *next;
+
+                /// \brief
+                /// ctor.
+                /// \param[in] value_ Node value.
+                explicit Node (const T &value_) :
+                    value (value_),
+                    next (nullptr) {}
+                /// \brief
+                /// ctor.
+                /// \param[in] value_ Node value.
+                explicit Node (T &&value_) :
+                    value (std::move (value_)),
+                    next (nullptr) {}
+            };
+            /// \brief
+            /// Top of the stack.
+            std::atomic<Node *> head;
+
+        public:
+            /// \brief
+            /// ctor.
+            LockFreeStack () :
+                head (nullptr) {}
+            /// \brief
+            /// dtor. No other thread can be using the stack at this point.
+            ~LockFreeStack () {
+                Node *node = head.load (std::memory_order_acquire);
+                while (node != nullptr) {
+                    Node *next = node->next;
+                    delete node;
+                    node = next;
+                }
+            }
+
+            /// \brief
+            /// Return true if the stack is empty.
+            /// \return true if the stack is empty.
+            inline bool IsEmpty () const {
+                return head.load (std::memory_order_acquire) == nullptr;
+            }
+
+            /// \brief
+            /// Push a value on to the stack.
+            /// \param[in] value Value to push.
+            void Push (const T &value) {
+                PushNode (new Node (value));
+            }
+            /// \brief
+            /// Push a value on to the stack.
+            /// \param[in] value Value to push.
+            void Push (T &&value) {
+                PushNode (new Node (std::move (value)));
+            }
+
+            /// \brief
+            /// Pop a value off the stack.
+            /// \param[out] value Where to put the popped value.
+            /// \return true == popped, false == stack was empty.
+            bool Pop (T &value) {
+                EpochManager::Guard guard;
+                Node *node = head.load (std::memory_order_acquire);
+                // Reading node->next is safe even if another thread pops node
+                // first. It can't be freed until we leave the critical section.
+                while (node != nullptr &&
+                    !head.compare_exchange_weak (node, node->next,
+                        std::memory_order_acquire, std::memory_order_acquire));
+                if (node != nullptr) {
+                    value = std::move (node->value);
+                    EpochManager::Instance ()->Retire (node);
+                    return true;
+                }
+                return false;
+            }
+
+        private:
+            /// \brief
+            /// Push a node on to the stack.
+            /// \param[in] node Node to push.
+            void PushNode (Node *node) {
+                // Push doesn't dereference anything shared,
+                // so it doesn't need a critical section.
+                node->next = head.load (std::memory_order_relaxed);
+                while (!head.compare_exchange_weak (node->next, node,
+                    std::memory_order_release, std::memory_order_relaxed));
+            }
+
+            /// \brief
+            /// LockFreeStack is neither copy constructable, nor assignable.
+            THEKOGANS_UTIL_DISALLOW_COPY_AND_ASSIGN (LockFreeStack)
+        };
+
+    } // namespace util
+} // namespace thekogans
+
+#endif // !defined (__thekogans_util_LockFreeStack_h)
@@ -0,0 +1,175 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_util_LockProbe_h)
+#define __thekogans_util_LockProbe_h
+
+#if defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+
+#include <atomic>
+#include <string>
+#include "thekogans/util/Config.h"
+#include "thekogans/util/Types.h"
+
+namespace thekogans {
+    namespace util {
+
+        /// \struct LockProbe LockProbe.h thekogans/util/LockProbe.h
+        ///
+        /// \brief
+        /// LockProbe is embedded in \see{Mutex}, \see{SpinLock}, \see{SpinRWLock}
+        /// and \see{RWLock} when the library is built with THEKOGANS_UTIL_USE_LOCK_PROFILER.
+        /// It feeds the \see{LockProfiler}. Only named locks (see SetProfilerName) are
+        /// profiled, and only while the profiler is enabled. Everything else pays
+        /// for one well predicted branch.
+        ///
+        /// NOTE: This header is included by the locks themselves, so it can't
+        /// include anything that (directly or indirectly) needs a lock.
+
+        struct _LIB_THEKOGANS_UTIL_DECL LockProbe {
+            /// \struct LockProbe::Site LockProbe.h thekogans/util/LockProbe.h
+            ///
+            /// \brief
+            /// Named lock instance (defined and owned by the \see{LockProfiler}).
+            struct Site;
+
+        private:
+            /// \brief
+            /// Our site (nullptr == not profiled).
+            Site *site;
+            /// \brief
+            /// When the current exclusive owner acquired the lock (0 == unknown).
+            ui64 acquiredAt;
+            /// \brief
+            /// true == \see{LockProfiler} is enabled.
+            static std::atomic<bool> enabled;
+
+        public:
+            /// \brief
+            /// ctor.
+            LockProbe () :
+                site (nullptr),
+                acquiredAt (0) {}
+            /// \brief
+            /// dtor. Removes our site (if any) from the \see{LockProfiler}
+            /// so that dead locks don't linger in its reports.
+            ~LockProbe ();
+
+            /// \brief
+            /// Name the lock so that it shows up in \see{LockProfiler} reports.
+            /// Renaming a lock replaces its site (and starts its counters over).
+            /// \param[in] type Lock type (Mutex, SpinLock...).
+            /// \param[in] name Lock name.
+            void SetName (
+                const char *type,
+                const std::string &name);
+
+            /// \brief
+            /// Return true if this acquisition should be recorded.
+            /// \return true if this acquisition should be recorded.
+            inline bool IsActive () const {
+                return site != nullptr && enabled.load (std::memory_order_relaxed);
+            }
+
+            /// \brief
+            /// Acquire the lock on behalf of the owner. Try first so
+            /// that contended acquisitions can be told apart and timed.
+            /// \param[in] tryAcquire Owner's non-blocking acquire.
+            /// \param[in] acquire Owner's blocking acquire.
+            /// \param[in] shared true == shared (read) acquisition.
+            template<
+                typename TryAcquireFunc,
+                typename AcquireFunc>
+            inline void Acquire (
+                    TryAcquireFunc tryAcquire,
+                    AcquireFunc acquire,
+                    bool shared = false) {
+                if (IsActive ()) {
+                    ui64 waitTime = 0;
+                    bool contended = !tryAcquire ();
+                    if (contended) {
+                        ui64 start = Now ();
+                        acquire ();
+                        waitTime = Now () - start;
+                    }
+                    Acquired (shared, contended, waitTime);
+                }
+                else {
+                    acquire ();
+                }
+            }
+            /// \brief
+            /// Called by the owner after a successful TryAcquire.
+            /// \param[in] shared true == shared (read) acquisition.
+            inline void TryAcquired (bool shared = false) {
+                if (IsActive ()) {
+                    Acquired (shared, false, 0);
+                }
+            }
+            /// \brief
+            /// Called by the owner when it gets the lock back without having
+            /// asked for it (\see{Condition::Wait}). It's not a new acquisition,
+            /// so only the hold time is restarted.
+            inline void Reacquired () {
+                if (IsActive ()) {
+                    acquiredAt = Now ();
+                }
+            }
+            /// \brief
+            /// Called by the owner right before it releases the lock.
+            /// Hold time is only tracked for exclusive acquisitions.
+            /// \param[in] shared true == shared (read) release.
+            inline void Release (bool shared = false) {
+                if (!shared && acquiredAt != 0) {
+                    Released ();
+                }
+            }
+
+            /// \brief
+            /// Return the current time in \see{HRTimer} ticks.
+            /// \return The current time in \see{HRTimer} ticks.
+            static ui64 Now ();
+
+        private:
+            /// \brief
+            /// Record an acquisition in the calling thread's buffer.
+            /// \param[in] shared true == shared (read) acquisition.
+            /// \param[in] contended true == the lock was not immediately available.
+            /// \param[in] waitTime How long we waited for it.
+            void Acquired (
+                bool shared,
+                bool contended,
+                ui64 waitTime);
+            /// \brief
+            /// Record the hold time in the calling thread's buffer.
+            void Released ();
+
+            /// \brief
+            /// LockProfiler flips enabled.
+            friend struct LockProfiler;
+
+            /// \brief
+            /// LockProbe is neither copy constructable, nor assignable.
+            THEKOGANS_UTIL_DISALLOW_COPY_AND_ASSIGN (LockProbe)
+        };
+
+    } // namespace util
+} // namespace thekogans
+
+#endif // defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+
+#endif // !defined (__thekogans_util_LockProbe_h)
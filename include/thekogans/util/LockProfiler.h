@@ -0,0 +1,381 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_util_LockProfiler_h)
+#define __thekogans_util_LockProfiler_h
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <iostream>
+#include "thekogans/util/Config.h"
+#include "thekogans/util/Types.h"
+#include "thekogans/util/Serializable.h"
+#include "thekogans/util/SpinLock.h"
+#include "thekogans/util/Singleton.h"
+#include "thekogans/util/LockProbe.h"
+
+namespace thekogans {
+    namespace util {
+
+        /// \struct LockProfiler LockProfiler.h thekogans/util/LockProfiler.h
+        ///
+        /// \brief
+        /// LockProfiler answers the question "which lock is hot?". When the library
+        /// is built with THEKOGANS_UTIL_USE_LOCK_PROFILER, \see{Mutex}, \see{SpinLock},
+        /// \see{SpinRWLock} and \see{RWLock} carry a \see{LockProbe}. Name the locks
+        /// you care about (RunLoop and Pipeline name their job queue mutexes), enable
+        /// the profiler, and dump the report:
+        ///
+        /// \code{.cpp}
+        /// util::Mutex mutex;
+        /// mutex.SetProfilerName ("Cache::mutex");
+        /// ...
+        /// util::LockProfiler::Instance ()->Enable ();
+        /// ...
+        /// util::LockProfiler::Instance ()->DumpLocks ("Lock contention");
+        /// \endcode
+        ///
+        /// Every thread records in to its own buffer, so profiling doesn't add
+        /// contention of its own. Buffers are merged only when a report is requested.
+        /// All times are in \see{HRTimer} ticks (Report::frequency ticks per second).
+        /// Without THEKOGANS_UTIL_USE_LOCK_PROFILER the reports are empty.
+
+        struct _LIB_THEKOGANS_UTIL_DECL LockProfiler : public Singleton<LockProfiler> {
+            /// \struct LockProfiler::Stats LockProfiler.h thekogans/util/LockProfiler.h
+            ///
+            /// \brief
+            /// Stats for one named lock instance.
+            struct _LIB_THEKOGANS_UTIL_DECL Stats : public Serializable {
+                /// \brief
+                /// LockProfiler::Stats is a \see{Serializable}.
+                THEKOGANS_UTIL_DECLARE_SERIALIZABLE (Stats)
+
+                /// \brief
+                /// Lock type (Mutex, SpinLock, SpinRWLock or RWLock).
+                std::string type;
+                /// \brief
+                /// Lock name.
+                std::string name;
+                /// \brief
+                /// Number of acquisitions (shared and exclusive).
+                ui64 acquisitions;
+                /// \brief
+                /// Number of acquisitions that had to wait.
+                ui64 contentions;
+                /// \brief
+                /// Total time spent waiting for the lock.
+                ui64 totalWaitTime;
+                /// \brief
+                /// Longest wait for the lock.
+                ui64 maxWaitTime;
+                /// \brief
+                /// Total time the lock was held (exclusive acquisitions only).
+                ui64 totalHoldTime;
+                /// \brief
+                /// Longest time the lock was held (exclusive acquisitions only).
+                ui64 maxHoldTime;
+
+                /// \brief
+                /// ctor.
+                /// \param[in] type_ Lock type.
+                /// \param[in] name_ Lock name.
+                Stats (
+                    const std::string &type_ = std::string (),
+                    const std::string &name_ = std::string ()) :
+                    type (type_),
+                    name (name_),
+                    acquisitions (0),
+                    contentions (0),
+                    totalWaitTime (0),
+                    maxWaitTime (0),
+                    totalHoldTime (0),
+                    maxHoldTime (0) {}
+                /// \brief
+                /// ctor.
+                /// \param[in] stats Stats to copy.
+                Stats (const Stats &stats) :
+                    type (stats.type),
+                    name (stats.name),
+                    acquisitions (stats.acquisitions),
+                    contentions (stats.contentions),
+                    totalWaitTime (stats.totalWaitTime),
+                    maxWaitTime (stats.maxWaitTime),
+                    totalHoldTime (stats.totalHoldTime),
+                    maxHoldTime (stats.maxHoldTime) {}
+
+                /// \brief
+                /// Assignment operator.
+                /// \param[in] stats Stats to assign.
+                /// \return *this.
+                Stats &operator = (const Stats &stats);
+
+                // Serializable
+                /// \brief
+                /// Return the serialized stats size.
+                /// \return Serialized stats size.
+                virtual std::size_t Size () const noexcept override;
+
+                /// \brief
+                /// Read the stats from the given serializer.
+                /// \param[in] header \see{SerializableHeader}.
+                /// \param[in] serializer \see{Serializer} to read the stats from.
+                virtual void Read (
+                    const SerializableHeader & /*header*/,
+                    Serializer &serializer) override;
+                /// \brief
+                /// Write the stats to the given serializer.
+                /// \param[out] serializer \see{Serializer} to write the stats to.
+                virtual void Write (Serializer &serializer) const override;
+
+                /// \brief
+                /// Read the Serializable from an XML DOM.
+                /// \param[in] header \see{SerializableHeader}.
+                /// \param[in] node XML DOM representation of a Serializable.
+                virtual void ReadXML (
+                    const SerializableHeader & /*header*/,
+                    const pugi::xml_node &node) override;
+                /// \brief
+                /// Write the Serializable to the XML DOM.
+                /// \param[out] node Parent node.
+                virtual void WriteXML (pugi::xml_node &node) const override;
+
+                /// \brief
+                /// Read the Serializable from an JSON DOM.
+                /// \param[in] header \see{SerializableHeader}.
+                /// \param[in] object JSON DOM representation of a Serializable.
+                virtual void ReadJSON (
+                    const SerializableHeader & /*header*/,
+                    const JSON::Object &object) override;
+                /// \brief
+                /// Write the Serializable to the JSON DOM.
+                /// \param[out] object Parent node.
+                virtual void WriteJSON (JSON::Object &object) const override;
+            };
+
+            /// \struct LockProfiler::Report LockProfiler.h thekogans/util/LockProfiler.h
+            ///
+            /// \brief
+            /// Snapshot of all named locks, hottest (most time spent waiting) first.
+            struct _LIB_THEKOGANS_UTIL_DECL Report : public Serializable {
+                /// \brief
+                /// LockProfiler::Report is a \see{Serializable}.
+                THEKOGANS_UTIL_DECLARE_SERIALIZABLE (Report)
+
+                /// \brief
+                /// \see{HRTimer} ticks per second.
+                ui64 frequency;
+                /// \brief
+                /// Per lock stats.
+                std::vector<Stats> locks;
+
+                /// \brief
+                /// ctor.
+                Report () :
+                    frequency (0) {}
+                /// \brief
+                /// ctor.
+                /// \param[in] report Report to copy.
+                Report (const Report &report) :
+                    frequency (report.frequency),
+                    locks (report.locks) {}
+
+                /// \brief
+                /// Assignment operator.
+                /// \param[in] report Report to assign.
+                /// \return *this.
+                Report &operator = (const Report &report);
+
+                // Serializable
+                /// \brief
+                /// Return the serialized report size.
+                /// \return Serialized report size.
+                virtual std::size_t Size () const noexcept override;
+
+                /// \brief
+                /// Read the report from the given serializer.
+                /// \param[in] header \see{SerializableHeader}.
+                /// \param[in] serializer \see{Serializer} to read the report from.
+                virtual void Read (
+                    const SerializableHeader & /*header*/,
+                    Serializer &serializer) override;
+                /// \brief
+                /// Write the report to the given serializer.
+                /// \param[out] serializer \see{Serializer} to write the report to.
+                virtual void Write (Serializer &serializer) const override;
+
+                /// \brief
+                /// Read the Serializable from an XML DOM.
+                /// \param[in] header \see{SerializableHeader}.
+                /// \param[in] node XML DOM representation of a Serializable.
+                virtual void ReadXML (
+                    const SerializableHeader & /*header*/,
+                    const pugi::xml_node &node) override;
+                /// \brief
+                /// Write the Serializable to the XML DOM.
+                /// \param[out] node Parent node.
+                virtual void WriteXML (pugi::xml_node &node) const override;
+
+                /// \brief
+                /// Read the Serializable from an JSON DOM.
+                /// \param[in] header \see{SerializableHeader}.
+                /// \param[in] object JSON DOM representation of a Serializable.
+                virtual void ReadJSON (
+                    const SerializableHeader & /*header*/,
+                    const JSON::Object &object) override;
+                /// \brief
+                /// Write the Serializable to the JSON DOM.
+                /// \param[out] object Parent node.
+                virtual void WriteJSON (JSON::Object &object) const override;
+            };
+
+        private:
+        #if defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+            /// \struct LockProfiler::Counters LockProfiler.h thekogans/util/LockProfiler.h
+            ///
+            /// \brief
+            /// Per thread, per lock counters.
+            struct Counters;
+            /// \struct LockProfiler::ThreadBuffer LockProfiler.h thekogans/util/LockProfiler.h
+            ///
+            /// \brief
+            /// Per thread counters for all the locks the thread touched.
+            struct ThreadBuffer;
+            /// \struct LockProfiler::ThreadBufferHolder LockProfiler.h thekogans/util/LockProfiler.h
+            ///
+            /// \brief
+            /// thread_local holder that merges the buffer when its thread exits.
+            struct ThreadBufferHolder;
+            /// \brief
+            /// Named locks (deleted by their probes' dtors).
+            std::vector<std::unique_ptr<LockProbe::Site>> sites;
+            /// \brief
+            /// Live threads' buffers.
+            std::vector<ThreadBuffer *> buffers;
+            /// \brief
+            /// Counters merged from exited threads.
+            std::unique_ptr<ThreadBuffer> exited;
+            /// \brief
+            /// Protects sites, buffers and exited.
+            SpinLock spinLock;
+        #endif // defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+
+        public:
+            /// \brief
+            /// ctor.
+            LockProfiler ();
+            /// \brief
+            /// dtor.
+            ~LockProfiler ();
+
+            /// \brief
+            /// Start recording.
+            void Enable ();
+            /// \brief
+            /// Stop recording (the counters are kept).
+            void Disable ();
+            /// \brief
+            /// Return true if recording.
+            /// \return true if recording.
+            bool IsEnabled () const;
+
+            /// \brief
+            /// Return a snapshot of all named locks.
+            /// \return A snapshot of all named locks.
+            Report GetReport ();
+            /// \brief
+            /// Zero all counters.
+            void Reset ();
+
+            /// \brief
+            /// Use this method to dump the state of all
+            /// named locks in the system.
+            /// \param[in] header Label the dump with an optional header.
+            /// \param[in] stream std::ostream stream to dump to.
+            void DumpLocks (
+                const std::string &header = std::string (),
+                std::ostream &stream = std::cout);
+
+        private:
+        #if defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+            /// \brief
+            /// Create a new named lock.
+            /// \param[in] type Lock type.
+            /// \param[in] name Lock name.
+            /// \return New named lock.
+            LockProbe::Site *CreateSite (
+                const char *type,
+                const std::string &name);
+            /// \brief
+            /// Delete a named lock along with all its counters.
+            /// \param[in] site Named lock to delete.
+            void DestroySite (LockProbe::Site *site);
+            /// \brief
+            /// Return the calling thread's buffer (nullptr if the thread is exiting).
+            /// \return The calling thread's buffer.
+            ThreadBuffer *GetThreadBuffer ();
+            /// \brief
+            /// Merge the exiting thread's buffer in to exited.
+            /// \param[in] buffer Buffer to merge.
+            void ReleaseThreadBuffer (ThreadBuffer *buffer);
+            /// \brief
+            /// Record an acquisition.
+            /// \param[in] site Named lock.
+            /// \param[in] contended true == the lock was not immediately available.
+            /// \param[in] waitTime How long we waited for it.
+            void RecordAcquire (
+                const LockProbe::Site *site,
+                bool contended,
+                ui64 waitTime);
+            /// \brief
+            /// Record a release.
+            /// \param[in] site Named lock.
+            /// \param[in] holdTime How long the lock was held.
+            void RecordRelease (
+                const LockProbe::Site *site,
+                ui64 holdTime);
+
+            /// \brief
+            /// LockProbe feeds us.
+            friend struct LockProbe;
+        #endif // defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+
+            /// \brief
+            /// LockProfiler is neither copy constructable, nor assignable.
+            THEKOGANS_UTIL_DISALLOW_COPY_AND_ASSIGN (LockProfiler)
+        };
+
+        /// \brief
+        /// Implement LockProfiler::Stats extraction operators.
+        THEKOGANS_UTIL_IMPLEMENT_SERIALIZABLE_EXTRACTION_OPERATORS (LockProfiler::Stats)
+
+        /// \brief
+        /// Implement LockProfiler::Stats value parser.
+        THEKOGANS_UTIL_IMPLEMENT_SERIALIZABLE_VALUE_PARSER (LockProfiler::Stats)
+
+        /// \brief
+        /// Implement LockProfiler::Report extraction operators.
+        THEKOGANS_UTIL_IMPLEMENT_SERIALIZABLE_EXTRACTION_OPERATORS (LockProfiler::Report)
+
+        /// \brief
+        /// Implement LockProfiler::Report value parser.
+        THEKOGANS_UTIL_IMPLEMENT_SERIALIZABLE_VALUE_PARSER (LockProfiler::Report)
+
+    } // namespace util
+} // namespace thekogans
+
+#endif // !defined (__thekogans_util_LockProfiler_h)
@@ -0,0 +1,277 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_util_MMapFile_h)
+#define __thekogans_util_MMapFile_h
+
+#include "thekogans/util/Environment.h"
+
+#if defined (TOOLCHAIN_OS_Windows) || defined (THEKOGANS_UTIL_HAVE_MMAP)
+
+#if defined (TOOLCHAIN_OS_Windows)
+    #include "thekogans/util/os/windows/WindowsHeader.h"
+#endif // defined (TOOLCHAIN_OS_Windows)
+#include <string>
+#include "thekogans/util/Config.h"
+#include "thekogans/util/Types.h"
+#include "thekogans/util/ByteView.h"
+#include "thekogans/util/Serializer.h"
+#include "thekogans/util/RandomSeekSerializer.h"
+#include "thekogans/util/Buffer.h"
+#include "thekogans/util/File.h"
+
+namespace thekogans {
+    namespace util {
+
+        /// \struct MMapFile MMapFile.h thekogans/util/MMapFile.h
+        ///
+        /// \brief
+        /// MMapFile maps a file in to the address space and serializes straight
+        /// in to (out of) the mapping. Unlike \see{File}, reads and writes don't
+        /// go through the kernel one system call (and one copy) at a time.
+        ///
+        /// Read only mappings are memory backed (like \see{Buffer}). Fixed size
+        /// values, arrays and compact integers are extracted directly from the
+        /// mapped pages, and with \see{Serializer::borrow} set, strings, \see{Buffer}s
+        /// and \see{Blob}s are views in to the mapping (no copies at all). Use
+        /// GetView and \see{TenantReadBuffer} to hand out regions of the mapping.
+        ///
+        /// Read-write mappings grow on demand (the file is extended and remapped)
+        /// and are trimmed back to their logical size (the furthest byte written)
+        /// on Close. Call Flush to msync the mapping to disk.
+        ///
+        /// IMPORTANT: Views (and anything borrowed from the mapping) are only valid
+        /// until the mapping changes (growth, Close). Read-write mappings can move
+        /// when they grow.
+        ///
+        /// Example:
+        ///
+        /// \code{.cpp}
+        /// using namespace thekogans;
+        ///
+        /// util::MMapFile archive (util::NetworkEndian, path);
+        /// archive.Advise (util::MMapFile::Sequential);
+        /// archive.borrow = true;
+        /// while (archive.Tell () < (util::i64)archive.GetSize ()) {
+        ///     util::Serializable::SharedPtr serializable;
+        ///     archive >> serializable;
+        ///     ...
+        /// }
+        /// \endcode
+
+        struct _LIB_THEKOGANS_UTIL_DECL MMapFile : public RandomSeekSerializer {
+            /// \brief
+            /// Declare the \see{DynamicCreatable} overrides.
+            THEKOGANS_UTIL_DECLARE_DYNAMIC_CREATABLE_OVERRIDE (MMapFile)
+
+            /// \enum
+            /// Mapping mode.
+            enum Mode {
+                /// \brief
+                /// Map an existing file for reading.
+                ReadOnly,
+                /// \brief
+                /// Map (create if it doesn't exist) a file for reading and writing.
+                ReadWrite
+            };
+
+            /// \enum
+            /// Access pattern hints (see Advise).
+            enum Advice {
+                /// \brief
+                /// No special treatment.
+                Normal,
+                /// \brief
+                /// Pages will be accessed in order (read ahead aggressively).
+                Sequential,
+                /// \brief
+                /// Pages will be accessed in random order (don't read ahead).
+                Random,
+                /// \brief
+                /// Pages will be needed soon (start reading them in).
+                WillNeed,
+                /// \brief
+                /// Pages won't be needed soon (let them go).
+                DontNeed
+            };
+
+            /// \brief
+            /// Minimum amount by which a read-write mapping grows.
+            static const std::size_t MIN_GROWTH = 1024 * 1024;
+
+        private:
+            /// \brief
+            /// Mapped file.
+            SimpleFile file;
+            /// \brief
+            /// Mapping mode.
+            Mode mode;
+        #if defined (TOOLCHAIN_OS_Windows)
+            /// \brief
+            /// File mapping object.
+            HANDLE mapping;
+        #endif // defined (TOOLCHAIN_OS_Windows)
+            /// \brief
+            /// The mapping. data and length are the mapped pages, readOffset is
+            /// the serializer position and writeOffset is the logical file size.
+            Buffer region;
+
+        public:
+            /// \brief
+            /// ctor.
+            /// \param[in] endianness Serializer endianness.
+            /// \param[in] path Path of the file to map.
+            /// \param[in] mode_ ReadOnly or ReadWrite.
+            /// \param[in] capacity ReadWrite only. Initial mapping size (the
+            /// logical size is still the size of the file).
+            MMapFile (
+                Endianness endianness,
+                const std::string &path,
+                Mode mode_ = ReadOnly,
+                ui64 capacity = 0);
+            /// \brief
+            /// dtor. Close the mapping.
+            virtual ~MMapFile ();
+
+            /// \brief
+            /// Return true if the file is mapped.
+            /// \return true if the file is mapped.
+            inline bool IsOpen () const {
+                return file.IsOpen ();
+            }
+            /// \brief
+            /// Return the mapped file path.
+            /// \return Mapped file path.
+            inline const std::string &GetPath () const {
+                return file.GetPath ();
+            }
+            /// \brief
+            /// Return the mapping mode.
+            /// \return ReadOnly or ReadWrite.
+            inline Mode GetMode () const {
+                return mode;
+            }
+            /// \brief
+            /// Return the number of bytes currently mapped (>= GetSize ()).
+            /// \return Number of bytes currently mapped.
+            inline ui64 GetCapacity () const {
+                return region.length;
+            }
+
+            /// \brief
+            /// Return a view of the whole (logical) file.
+            /// \return \see{ByteView} of [0, GetSize ()).
+            inline ByteView GetView () const {
+                return ByteView (region.data, region.writeOffset);
+            }
+            /// \brief
+            /// Return a view of the given range. Throws if the range
+            /// is not inside [0, GetSize ()).
+            /// \param[in] offset Offset of the first byte.
+            /// \param[in] length Number of bytes.
+            /// \return \see{ByteView} of [offset, offset + length).
+            ByteView GetView (
+                ui64 offset,
+                std::size_t length) const;
+
+            /// \brief
+            /// Tell the OS how the given range is going to be accessed.
+            /// \param[in] advice One of Normal, Sequential, Random, WillNeed or DontNeed.
+            /// \param[in] offset Offset of the first byte.
+            /// \param[in] length Number of bytes (0 == to the end of the mapping).
+            void Advise (
+                Advice advice,
+                ui64 offset = 0,
+                ui64 length = 0);
+
+            /// \brief
+            /// ReadWrite only. Make sure at least capacity bytes are mapped
+            /// so that writes up to it don't have to remap.
+            /// \param[in] capacity Minimum number of bytes to map.
+            void Reserve (ui64 capacity);
+
+            /// \brief
+            /// Unmap and close the file. ReadWrite files are trimmed
+            /// to their logical size.
+            void Close ();
+
+            // Serializer
+            /// \brief
+            /// Read bytes from the mapping.
+            /// \param[out] data Where to place the bytes.
+            /// \param[in] count Number of bytes to read.
+            /// \return Number of bytes actually read.
+            virtual std::size_t Read (
+                void *data,
+                std::size_t count) override;
+            /// \brief
+            /// Write bytes to the mapping, growing it if needed.
+            /// Throws if the mapping is ReadOnly.
+            /// \param[in] data Where the bytes come from.
+            /// \param[in] count Number of bytes to write.
+            /// \return Number of bytes actually written.
+            virtual std::size_t Write (
+                const void *data,
+                std::size_t count) override;
+
+            // RandomSeekSerializer
+            /// \brief
+            /// Return the serializer position.
+            /// \return The serializer position.
+            virtual i64 Tell () const override;
+            /// \brief
+            /// Reposition the serializer. ReadWrite files can seek
+            /// past the end (the gap is zero filled by the next write).
+            /// \param[in] offset Offset to move relative to fromWhere.
+            /// \param[in] fromWhere SEEK_SET, SEEK_CUR or SEEK_END.
+            /// \return The new serializer position.
+            virtual i64 Seek (
+                i64 offset,
+                i32 fromWhere) override;
+            /// \brief
+            /// Return the logical file size.
+            /// \return Logical file size.
+            virtual ui64 GetSize () override;
+
+            /// \brief
+            /// Write the dirty pages to disk (msync/FlushViewOfFile).
+            void Flush ();
+
+        private:
+            /// \brief
+            /// Map the first length bytes of the file.
+            /// \param[in] length Number of bytes to map.
+            void Map (std::size_t length);
+            /// \brief
+            /// Unmap the file.
+            void Unmap ();
+            /// \brief
+            /// Grow (extend the file and remap) to at least the given capacity.
+            /// \param[in] capacity Minimum number of bytes to map.
+            void Grow (std::size_t capacity);
+
+            /// \brief
+            /// MMapFile is neither copy constructable, nor assignable.
+            THEKOGANS_UTIL_DISALLOW_COPY_AND_ASSIGN (MMapFile)
+        };
+
+    } // namespace util
+} // namespace thekogans
+
+#endif // defined (TOOLCHAIN_OS_Windows) || defined (THEKOGANS_UTIL_HAVE_MMAP)
+
+#endif // !defined (__thekogans_util_MMapFile_h)
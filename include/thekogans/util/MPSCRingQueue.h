@@ -0,0 +1,269 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_util_MPSCRingQueue_h)
+#define __thekogans_util_MPSCRingQueue_h
+
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <utility>
+#include "thekogans/util/Config.h"
+#include "thekogans/util/Exception.h"
+
+namespace thekogans {
+    namespace util {
+
+        /// \struct MPSCRingQueue MPSCRingQueue.h thekogans/util/MPSCRingQueue.h
+        ///
+        /// \brief
+        /// MPSCRingQueue is a bounded, lock-free, multiple producer/single consumer
+        /// ring buffer. Every slot carries a sequence number that tells producers
+        /// when it's free and the consumer when it's full, so producers only
+        /// contend on the CAS that claims a slot (or a run of slots in PushBatch),
+        /// and never on the consumer's index.
+        ///
+        /// T must be default constructable and move assignable.
+        ///
+        /// VERY IMPORTANT: Any number of threads may push, but only one thread
+        /// may pop. Wrap it in \see{BlockingRingQueue} if the threads need to
+        /// block when the queue is empty/full.
+
+        template<typename T>
+        struct MPSCRingQueue {
+            /// \brief
+            /// Alias for T.
+            using ValueType = T;
+
+            /// \brief
+            /// Size of the cache line the indices are padded to.
+            static const std::size_t CACHE_LINE_SIZE = 64;
+
+        private:
+            /// \struct MPSCRingQueue::Slot MPSCRingQueue.h thekogans/util/MPSCRingQueue.h
+            ///
+            /// \brief
+            /// A value and its sequence number.
+            struct Slot {
+                /// \brief
+                /// == position: free for the producer at position.
+                /// == position + 1: full, waiting for the consumer.
+                std::atomic<std::size_t> sequence;
+                /// \brief
+                /// Slot value.
+                T value;
+            };
+            /// \brief
+            /// Number of slots (a power of 2).
+            const std::size_t capacity;
+            /// \brief
+            /// capacity - 1.
+            const std::size_t mask;
+            /// \brief
+            /// Slots.
+            std::unique_ptr<Slot[]> slots;
+            /// \brief
+            /// Next position to claim (shared by the producers).
+            alignas (CACHE_LINE_SIZE) std::atomic<std::size_t> tail;
+            /// \brief
+            /// Next position to pop (consumer only).
+            alignas (CACHE_LINE_SIZE) std::size_t head;
+
+        public:
+            /// \brief
+            /// ctor.
+            /// \param[in] capacity_ Max number of queued values (rounded up to a power of 2).
+            explicit MPSCRingQueue (std::size_t capacity_) :
+                    capacity (RoundUp (capacity_)),
+                    mask (capacity - 1),
+                    slots (new Slot[capacity]),
+                    tail (0),
+                    head (0) {
+                if (capacity_ == 0) {
+                    THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                        THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+                }
+                for (std::size_t i = 0; i < capacity; ++i) {
+                    slots[i].sequence.store (i, std::memory_order_relaxed);
+                }
+            }
+
+            /// \brief
+            /// Return the number of slots.
+            /// \return Number of slots.
+            inline std::size_t GetCapacity () const {
+                return capacity;
+            }
+            /// \brief
+            /// Return true if the queue is empty (consumer only).
+            /// \return true if the queue is empty.
+            inline bool IsEmpty () const {
+                return slots[head & mask].sequence.load (
+                    std::memory_order_acquire) != head + 1;
+            }
+
+            /// \brief
+            /// Push a value (any thread).
+            /// \param[in] value Value to push.
+            /// \return true == pushed, false == the queue is full.
+            inline bool Push (const T &value) {
+                Slot *slot = Claim ();
+                if (slot != nullptr) {
+                    slot->value = value;
+                    slot->sequence.store (
+                        slot->sequence.load (std::memory_order_relaxed) + 1,
+                        std::memory_order_release);
+                    return true;
+                }
+                return false;
+            }
+            /// \brief
+            /// Push a value (any thread).
+            /// \param[in] value Value to push.
+            /// \return true == pushed, false == the queue is full (value is left alone).
+            inline bool Push (T &&value) {
+                Slot *slot = Claim ();
+                if (slot != nullptr) {
+                    slot->value = std::move (value);
+                    slot->sequence.store (
+                        slot->sequence.load (std::memory_order_relaxed) + 1,
+                        std::memory_order_release);
+                    return true;
+                }
+                return false;
+            }
+            /// \brief
+            /// Push as many of the given values as will fit (any thread).
+            /// Claims a run of free slots with a single CAS. If the whole
+            /// run isn't free, tries half as many.
+            /// \param[in] values Values to push.
+            /// \param[in] count Number of values.
+            /// \return Number of values pushed.
+            std::size_t PushBatch (
+                    const T *values,
+                    std::size_t count) {
+                if (count > capacity) {
+                    count = capacity;
+                }
+                std::size_t position = tail.load (std::memory_order_relaxed);
+                while (count > 0) {
+                    // The run is free if its last slot is free
+                    // (slots are released to producers in order).
+                    Slot &last = slots[(position + count - 1) & mask];
+                    std::ptrdiff_t diff =
+                        (std::ptrdiff_t)last.sequence.load (std::memory_order_acquire) -
+                        (std::ptrdiff_t)(position + count - 1);
+                    if (diff == 0) {
+                        if (tail.compare_exchange_weak (position, position + count,
+                                std::memory_order_relaxed)) {
+                            for (std::size_t i = 0; i < count; ++i) {
+                                Slot &slot = slots[(position + i) & mask];
+                                slot.value = values[i];
+                                slot.sequence.store (position + i + 1,
+                                    std::memory_order_release);
+                            }
+                            return count;
+                        }
+                    }
+                    else if (diff < 0) {
+                        count >>= 1;
+                        position = tail.load (std::memory_order_relaxed);
+                    }
+                    else {
+                        position = tail.load (std::memory_order_relaxed);
+                    }
+                }
+                return 0;
+            }
+
+            /// \brief
+            /// Pop a value (consumer only).
+            /// \param[out] value Where to put the popped value.
+            /// \return true == popped, false == the queue is empty.
+            inline bool Pop (T &value) {
+                Slot &slot = slots[head & mask];
+                if (slot.sequence.load (std::memory_order_acquire) == head + 1) {
+                    value = std::move (slot.value);
+                    slot.sequence.store (head + capacity, std::memory_order_release);
+                    ++head;
+                    return true;
+                }
+                return false;
+            }
+            /// \brief
+            /// Pop up to count values (consumer only). Stops at the first
+            /// slot that's still being filled.
+            /// \param[out] values Where to put the popped values.
+            /// \param[in] count Max number of values to pop.
+            /// \return Number of values popped.
+            std::size_t PopBatch (
+                    T *values,
+                    std::size_t count) {
+                std::size_t popped = 0;
+                while (popped < count && Pop (values[popped])) {
+                    ++popped;
+                }
+                return popped;
+            }
+
+        private:
+            /// \brief
+            /// Round the given capacity up to the next power of 2.
+            /// \param[in] capacity Capacity to round up.
+            /// \return Capacity rounded up to the next power of 2.
+            static std::size_t RoundUp (std::size_t capacity) {
+                std::size_t result = 1;
+                while (result < capacity) {
+                    result <<= 1;
+                }
+                return result;
+            }
+
+            /// \brief
+            /// Claim the next free slot.
+            /// \return The claimed slot (nullptr == the queue is full).
+            inline Slot *Claim () {
+                std::size_t position = tail.load (std::memory_order_relaxed);
+                for (;;) {
+                    Slot &slot = slots[position & mask];
+                    std::ptrdiff_t diff =
+                        (std::ptrdiff_t)slot.sequence.load (std::memory_order_acquire) -
+                        (std::ptrdiff_t)position;
+                    if (diff == 0) {
+                        if (tail.compare_exchange_weak (position, position + 1,
+                                std::memory_order_relaxed)) {
+                            return &slot;
+                        }
+                    }
+                    else if (diff < 0) {
+                        return nullptr;
+                    }
+                    else {
+                        position = tail.load (std::memory_order_relaxed);
+                    }
+                }
+            }
+
+            /// \brief
+            /// MPSCRingQueue is neither copy constructable, nor assignable.
+            THEKOGANS_UTIL_DISALLOW_COPY_AND_ASSIGN (MPSCRingQueue)
+        };
+
+    } // namespace util
+} // namespace thekogans
+
+#endif // !defined (__thekogans_util_MPSCRingQueue_h)
@@ -24,7 +24,9 @@
 #else // defined (TOOLCHAIN_OS_Windows)
     #include <pthread.h>
 #endif // defined (TOOLCHAIN_OS_Windows)
+#include <string>
 #include "thekogans/util/Config.h"
+#include "thekogans/util/LockProbe.h"
 
 namespace thekogans {
     namespace util {
@@ -77,6 +79,11 @@ namespace thekogans {
             /// POSIX mutex.
             pthread_mutex_t mutex;
         #endif // defined (TOOLCHAIN_OS_Windows)
+        #if defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+            /// \brief
+            /// \see{LockProfiler} probe.
+            LockProbe probe;
+        #endif // defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
 
             /// \brief
             /// Condition needs access to cs/mutex.
@@ -103,8 +110,31 @@ namespace thekogans {
             /// Release the mutex.
             void Release ();
 
-    #if !defined (TOOLCHAIN_OS_Windows)
+            /// \brief
+            /// Name the mutex so that it shows up in \see{LockProfiler} reports.
+            /// A no-op unless built with THEKOGANS_UTIL_USE_LOCK_PROFILER.
+            /// \param[in] name Mutex name.
+        #if defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+            inline void SetProfilerName (const std::string &name) {
+                probe.SetName ("Mutex", name);
+            }
+        #else // defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+            inline void SetProfilerName (const std::string & /*name*/) {}
+        #endif // defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+
         private:
+            /// \brief
+            /// Try to lock the mutex without blocking (unprofiled).
+            /// \return true = locked, false = failed to lock
+            bool TryLock ();
+            /// \brief
+            /// Lock the mutex (unprofiled).
+            void Lock ();
+            /// \brief
+            /// Unlock the mutex (unprofiled).
+            void Unlock ();
+
+    #if !defined (TOOLCHAIN_OS_Windows)
             /// \brief
             /// ctor.
             /// \param[in] shared For pthread_mutex_t. Initialize with
@@ -31,6 +31,7 @@
 #include "thekogans/util/TimeSpec.h"
 #include "thekogans/util/Thread.h"
 #include "thekogans/util/Mutex.h"
+#include "thekogans/util/SeqLock.h"
 #include "thekogans/util/Condition.h"
 #include "thekogans/util/Event.h"
 #include "thekogans/util/JobQueue.h"
@@ -417,6 +418,10 @@ namespace thekogans {
                 /// Pipeline stats.
                 RunLoop::Stats stats;
                 /// \brief
+                /// stats image (published by FinishedJob, see \see{RunLoop::Stats::Counters})
+                /// for lock free GetStats.
+                SeqLock<RunLoop::Stats::Counters> statsCounters;
+                /// \brief
                 /// Synchronization mutex.
                 Mutex jobsMutex;
                 /// \brief
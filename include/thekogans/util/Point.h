@@ -29,6 +29,7 @@
 #include "thekogans/util/Types.h"
 #include "thekogans/util/Constants.h"
 #include "thekogans/util/Serializer.h"
+#include "thekogans/util/SerializableFields.h"
 
 namespace thekogans {
     namespace util {
@@ -84,6 +85,12 @@ namespace thekogans {
                 return SIZE;
             }
 
+            /// \brief
+            /// Point serializes its x and y coordinates.
+            THEKOGANS_UTIL_DECLARE_FIELDS (
+                THEKOGANS_UTIL_SERIALIZABLE_FIELD (Point, x, "X"),
+                THEKOGANS_UTIL_SERIALIZABLE_FIELD (Point, y, "Y"))
+
             /// \brief
             /// Unary minus operator.
             /// \return Negated point.
@@ -151,6 +158,9 @@ namespace thekogans {
         #endif // defined (TOOLCHAIN_OS_Windows)
         };
 
+        static_assert (SerializableFields<Point>::SIZE == Point::SIZE,
+            "Point::SIZE is out of sync with Point::Fields.");
+
         /// \brief
         /// Check two points for equality.
         /// \param[in] point1 First point to check.
@@ -216,7 +226,7 @@ namespace thekogans {
         inline Serializer & _LIB_THEKOGANS_UTIL_API operator << (
                 Serializer &serializer,
                 const Point &point) {
-            serializer << point.x << point.y;
+            SerializableFields<Point>::Write (serializer, point);
             return serializer;
         }
         /// \brief
@@ -227,7 +237,7 @@ namespace thekogans {
         inline Serializer & _LIB_THEKOGANS_UTIL_API operator >> (
                 Serializer &serializer,
                 Point &point) {
-            serializer >> point.x >> point.y;
+            SerializableFields<Point>::Read (serializer, point);
             return serializer;
         }
 
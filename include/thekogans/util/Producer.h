@@ -20,10 +20,14 @@
 
 #include <functional>
 #include <vector>
-#include <unordered_map>
+#include <atomic>
+#include <utility>
+#include "thekogans/util/Types.h"
+#include "thekogans/util/Constants.h"
 #include "thekogans/util/RefCounted.h"
 #include "thekogans/util/SpinLock.h"
 #include "thekogans/util/LockGuard.h"
+#include "thekogans/util/Thread.h"
 #include "thekogans/util/RunLoop.h"
 #include "thekogans/util/JobQueue.h"
 
@@ -101,7 +105,9 @@ namespace thekogans {
                 /// \brief
                 /// Alias for std::function<void (T *)>.
                 using Event = std::function<void (T *)>;
-
+                /// \brief
+                /// Alias for std::vector<Event>.
+                using Events = std::vector<Event>;
 
                 /// \brief
                 /// Must be overridden by concrete classes to deliver events using whatever
@@ -111,6 +117,18 @@ namespace thekogans {
                 virtual void DeliverEvent (
                     const Event &event,
                     typename Subscriber<T>::SharedPtr subscriber) = 0;
+                /// \brief
+                /// Deliver a batch of events to the subscriber. The default implementation
+                /// delivers them one at a time. Override it if your policy can do better.
+                /// \param[in] events Events to deliver (in order).
+                /// \param[in] subscriber \see{Subscriber} to whom to deliver the events.
+                virtual void DeliverEvents (
+                        const Events &events,
+                        typename Subscriber<T>::SharedPtr subscriber) {
+                    for (std::size_t i = 0, count = events.size (); i < count; ++i) {
+                        DeliverEvent (events[i], subscriber);
+                    }
+                }
             };
 
             /// \struct Producer::ImmediateEventDeliveryPolicy Producer.h thekogans/util/Producer.h
@@ -164,6 +182,25 @@ namespace thekogans {
                         }
                     );
                 }
+                /// \brief
+                /// Deliver the given events to the given subscriber using a single
+                /// job queued on the contained \see{RunLoop}.
+                /// \param[in] events Events to deliver (in order).
+                /// \param[in] subscriber \see{Subscriber} to whom to deliver the events.
+                virtual void DeliverEvents (
+                        const typename EventDeliveryPolicy::Events &events,
+                        typename Subscriber<T>::SharedPtr subscriber) override {
+                    runLoop->EnqJob (
+                        [events, subscriber] (
+                                const RunLoop::LambdaJob &job,
+                                const std::atomic<bool> &done) {
+                            for (std::size_t i = 0, count = events.size ();
+                                    i < count && job.IsRunning (done); ++i) {
+                                events[i] (subscriber.Get ());
+                            }
+                        }
+                    );
+                }
             };
 
             /// \struct Producer::JobQueueEventDeliveryPolicy Producer.h thekogans/util/Producer.h
@@ -208,19 +245,67 @@ namespace thekogans {
                 typename Subscriber<T>::WeakPtr,
                 typename EventDeliveryPolicy::SharedPtr>;
             /// \brief
-            /// Alias for std::unordered_map<Subscriber<T> *, SubscriberInfo>.
-            using Subscribers = std::unordered_map<Subscriber<T> *, SubscriberInfo>;
+            /// Alias for std::vector<std::pair<Subscriber<T> *, SubscriberInfo>>.
+            using Subscribers = std::vector<std::pair<Subscriber<T> *, SubscriberInfo>>;
+            /// \struct Producer::Snapshot Producer.h thekogans/util/Producer.h
+            ///
             /// \brief
-            /// Map of registered subscribers.
-            Subscribers subscribers;
+            /// An immutable list of registered subscribers. Subscribe and Unsubscribe
+            /// never modify a published snapshot. They build a new one and swap it in
+            /// (RCU style). Produce takes a reference on the current snapshot without
+            /// taking a lock or allocating memory.
+            struct Snapshot : public RefCounted {
+                /// \brief
+                /// Declare \see{RefCounted} pointers.
+                THEKOGANS_UTIL_DECLARE_REF_COUNTED_POINTERS (Snapshot)
+
+                /// \brief
+                /// Registered subscribers.
+                Subscribers subscribers;
+
+                /// \brief
+                /// ctor.
+                /// \param[in] subscribers_ Registered subscribers.
+                explicit Snapshot (const Subscribers &subscribers_ = Subscribers ()) :
+                    subscribers (subscribers_) {}
+
+                /// \brief
+                /// Return the index of the given subscriber.
+                /// \param[in] subscriber \see{Subscriber} to look for.
+                /// \return Index of the given subscriber (NIDX if not found).
+                std::size_t Find (Subscriber<T> *subscriber) const {
+                    for (std::size_t i = 0, count = subscribers.size (); i < count; ++i) {
+                        if (subscribers[i].first == subscriber) {
+                            return i;
+                        }
+                    }
+                    return NIDX;
+                }
+            };
+            /// \brief
+            /// Current subscribers snapshot (nullptr == no subscribers).
+            /// The producer holds a reference on it.
+            std::atomic<Snapshot *> snapshot;
+            /// \brief
+            /// Incremented every time a new snapshot is published.
+            std::atomic<ui32> epoch;
+            /// \brief
+            /// Count of readers taking out a reference on the snapshot
+            /// (indexed by the low bit of epoch).
+            std::atomic<ui32> readers[2];
             /// \brief
-            /// Synchronization lock.
+            /// Serializes snapshot writers (readers never take it).
             SpinLock spinLock;
 
         public:
             /// \brief
             /// default ctor.
-            Producer () {}
+            Producer () :
+                    snapshot (nullptr),
+                    epoch (0) {
+                readers[0] = 0;
+                readers[1] = 0;
+            }
             /// \brief
             /// dtor.
             virtual ~Producer () {
@@ -233,43 +318,68 @@ namespace thekogans {
             /// \param[in] subscriber \see{Subscriber} to check.
             /// \return true == the given subscriber is subscribed to our events.
             inline bool IsSubscribed (Subscriber<T> &subscriber) {
-                LockGuard<SpinLock> guard (spinLock);
-                return subscribers.find (&subscriber) != subscribers.end ();
+                typename Snapshot::SharedPtr snapshot_ = GetSnapshot ();
+                return snapshot_ != nullptr && snapshot_->Find (&subscriber) != NIDX;
             }
 
             /// \brief
-            /// Called by \see{Subscriber} to add itself to the subscribers map.
-            /// \param[in] subscriber \see{Subscriber} to add to the subscribers map.
+            /// Called by \see{Subscriber} to add itself to the subscribers list.
+            /// \param[in] subscriber \see{Subscriber} to add to the subscribers list.
             /// \param[in] eventDeliveryPolicy \see{EventDeliveryPolicy} by which
             /// events are delivered.
             /// \return true == subscribed, false == already subscribed.
-            inline bool Subscribe (
+            bool Subscribe (
                     Subscriber<T> &subscriber,
                     typename EventDeliveryPolicy::SharedPtr eventDeliveryPolicy =
                         new ImmediateEventDeliveryPolicy) {
                 LockGuard<SpinLock> guard (spinLock);
-                return subscribers.insert (
-                    typename Subscribers::value_type (
-                        &subscriber,
-                        SubscriberInfo (
-                            typename Subscriber<T>::WeakPtr (&subscriber),
-                            eventDeliveryPolicy))).second;
+                Snapshot *current = snapshot;
+                if (current == nullptr || current->Find (&subscriber) == NIDX) {
+                    Snapshot *newSnapshot = new Snapshot;
+                    if (current != nullptr) {
+                        newSnapshot->subscribers.reserve (current->subscribers.size () + 1);
+                        CopyLiveSubscribers (current->subscribers, newSnapshot->subscribers);
+                    }
+                    newSnapshot->subscribers.push_back (
+                        typename Subscribers::value_type (
+                            &subscriber,
+                            SubscriberInfo (
+                                typename Subscriber<T>::WeakPtr (&subscriber),
+                                eventDeliveryPolicy)));
+                    Publish (newSnapshot);
+                    return true;
+                }
+                return false;
             }
 
             /// \brief
-            /// Called by \see{Subscriber} to remove itself from the subscribers map.
-            /// \param[in] subscriber \see{Subscriber} to remove from the subscribers map.
+            /// Called by \see{Subscriber} to remove itself from the subscribers list.
+            /// \param[in] subscriber \see{Subscriber} to remove from the subscribers list.
             /// \return true == unsubscribed, false == was not subscribed.
-            inline bool Unsubscribe (Subscriber<T> &subscriber) {
+            bool Unsubscribe (Subscriber<T> &subscriber) {
                 LockGuard<SpinLock> guard (spinLock);
-                return subscribers.erase (&subscriber) == 1;
+                Snapshot *current = snapshot;
+                std::size_t index = current != nullptr ? current->Find (&subscriber) : NIDX;
+                if (index != NIDX) {
+                    Subscribers subscribers;
+                    subscribers.reserve (current->subscribers.size () - 1);
+                    subscribers.insert (subscribers.end (),
+                        current->subscribers.begin (),
+                        current->subscribers.begin () + index);
+                    subscribers.insert (subscribers.end (),
+                        current->subscribers.begin () + index + 1,
+                        current->subscribers.end ());
+                    Publish (!subscribers.empty () ? new Snapshot (subscribers) : nullptr);
+                    return true;
+                }
+                return false;
             }
 
             /// \brief
             /// Unsubscribe all subscribers.
             inline void Unsubscribe () {
                 LockGuard<SpinLock> guard (spinLock);
-                subscribers.clear ();
+                Publish (nullptr);
             }
 
             /// \brief
@@ -286,42 +396,83 @@ namespace thekogans {
             void GetSubscribers (
                     std::vector<SharedSubscriberInfo> &subscribers_,
                     bool unsubscribe = false) {
-                LockGuard<SpinLock> guard (spinLock);
-                if (!subscribers.empty ()) {
-                    subscribers_.reserve (subscribers.size ());
-                    for (typename Subscribers::iterator
-                            it = subscribers.begin (),
-                            end = subscribers.end (); it != end;) {
-                        typename Subscriber<T>::SharedPtr subscriber =
-                            it->second.first.GetSharedPtr ();
+                typename Snapshot::SharedPtr snapshot_ =
+                    unsubscribe ? Detach () : GetSnapshot ();
+                if (snapshot_ != nullptr) {
+                    bool expired = false;
+                    subscribers_.reserve (snapshot_->subscribers.size ());
+                    for (std::size_t i = 0, count = snapshot_->subscribers.size (); i < count; ++i) {
+                        const SubscriberInfo &info = snapshot_->subscribers[i].second;
+                        typename Subscriber<T>::SharedPtr subscriber = info.first.GetSharedPtr ();
                         if (subscriber != nullptr) {
-                            subscribers_.push_back (
-                                SharedSubscriberInfo (subscriber, it->second.second));
-                            ++it;
+                            subscribers_.push_back (SharedSubscriberInfo (subscriber, info.second));
                         }
-                        else if (!unsubscribe) {
-                            // Expired subscriber. If we're not asked to unsubscribe,
-                            // remove it here. Otherwise it will be removed by clear
-                            // below.
-                            it = subscribers.erase (it);
+                        else {
+                            expired = true;
                         }
                     }
-                    if (unsubscribe) {
-                        subscribers.clear ();
+                    if (expired && !unsubscribe) {
+                        RemoveExpiredSubscribers ();
                     }
                 }
             }
 
             /// \brief
             /// Produce an event for subscribers to consume.
+            /// NOTE: In the steady state (no subscribers coming or going) Produce
+            /// neither locks nor allocates (other than what the subscriber's
+            /// \see{EventDeliveryPolicy} might do).
             /// \param[in] event Event to deliver to all registered subscribers.
+            /// \param[in] unsubscribe true == unsubscribe all subscribers after delivering the event.
             void Produce (
                     const typename EventDeliveryPolicy::Event &event,
                     bool unsubscribe = false) {
-                std::vector<SharedSubscriberInfo> subscribers;
-                GetSubscribers (subscribers, unsubscribe);
-                for (std::size_t i = 0, count = subscribers.size (); i < count; ++i) {
-                    subscribers[i].second->DeliverEvent (event, subscribers[i].first);
+                typename Snapshot::SharedPtr snapshot_ =
+                    unsubscribe ? Detach () : GetSnapshot ();
+                if (snapshot_ != nullptr) {
+                    bool expired = false;
+                    for (std::size_t i = 0, count = snapshot_->subscribers.size (); i < count; ++i) {
+                        const SubscriberInfo &info = snapshot_->subscribers[i].second;
+                        typename Subscriber<T>::SharedPtr subscriber = info.first.GetSharedPtr ();
+                        if (subscriber != nullptr) {
+                            info.second->DeliverEvent (event, subscriber);
+                        }
+                        else {
+                            expired = true;
+                        }
+                    }
+                    if (expired && !unsubscribe) {
+                        RemoveExpiredSubscribers ();
+                    }
+                }
+            }
+
+            /// \brief
+            /// Produce a batch of events for subscribers to consume. Each subscriber's
+            /// \see{EventDeliveryPolicy} gets all the events in one call (for
+            /// \see{RunLoopEventDeliveryPolicy} that's a single job per subscriber).
+            /// \param[in] events Events to deliver (in order) to all registered subscribers.
+            /// \param[in] unsubscribe true == unsubscribe all subscribers after delivering the events.
+            void Produce (
+                    const typename EventDeliveryPolicy::Events &events,
+                    bool unsubscribe = false) {
+                typename Snapshot::SharedPtr snapshot_ =
+                    unsubscribe ? Detach () : GetSnapshot ();
+                if (snapshot_ != nullptr && !events.empty ()) {
+                    bool expired = false;
+                    for (std::size_t i = 0, count = snapshot_->subscribers.size (); i < count; ++i) {
+                        const SubscriberInfo &info = snapshot_->subscribers[i].second;
+                        typename Subscriber<T>::SharedPtr subscriber = info.first.GetSharedPtr ();
+                        if (subscriber != nullptr) {
+                            info.second->DeliverEvents (events, subscriber);
+                        }
+                        else {
+                            expired = true;
+                        }
+                    }
+                    if (expired && !unsubscribe) {
+                        RemoveExpiredSubscribers ();
+                    }
                 }
             }
 
@@ -329,8 +480,101 @@ namespace thekogans {
             /// Return the count of registered subscribers.
             /// \return The count of registered subscribers.
             inline std::size_t GetSubscriberCount () {
+                typename Snapshot::SharedPtr snapshot_ = GetSnapshot ();
+                return snapshot_ != nullptr ? snapshot_->subscribers.size () : 0;
+            }
+
+        private:
+            /// \brief
+            /// Take out a reference on the current snapshot. This is the read side
+            /// of the RCU scheme. It's lock-free; all it does is announce itself in
+            /// the readers counter for the current epoch while it bumps the snapshot
+            /// reference count, so that Publish doesn't drop the last reference out
+            /// from under it.
+            /// \return Current snapshot.
+            typename Snapshot::SharedPtr GetSnapshot () {
+                ui32 readerEpoch;
+                while (1) {
+                    readerEpoch = epoch;
+                    ++readers[readerEpoch & 1];
+                    if (readerEpoch == epoch) {
+                        break;
+                    }
+                    // A writer flipped the epoch under us. Try again on the new one.
+                    --readers[readerEpoch & 1];
+                }
+                typename Snapshot::SharedPtr snapshot_ (snapshot.load ());
+                --readers[readerEpoch & 1];
+                return snapshot_;
+            }
+
+            /// \brief
+            /// Replace the current snapshot with the given one and wait for readers
+            /// still taking out a reference on the old one to finish.
+            /// NOTE: spinLock must be held.
+            /// \param[in] newSnapshot New snapshot (nullptr == no subscribers).
+            /// \return Old snapshot.
+            typename Snapshot::SharedPtr Swap (Snapshot *newSnapshot) {
+                Snapshot *oldSnapshot = snapshot.exchange (newSnapshot);
+                // Readers arriving from here on will see the new snapshot and
+                // count themselves on the other side. Wait for the ones that
+                // might have seen the old snapshot to take out their reference.
+                ui32 oldEpoch = epoch++;
+                Thread::Backoff backoff;
+                while (readers[oldEpoch & 1] != 0) {
+                    backoff.Pause ();
+                }
+                // Adopt the reference the producer held.
+                return typename Snapshot::SharedPtr (oldSnapshot, false);
+            }
+
+            /// \brief
+            /// Publish a new snapshot and drop the old one.
+            /// NOTE: spinLock must be held.
+            /// \param[in] newSnapshot New snapshot (nullptr == no subscribers).
+            inline void Publish (Snapshot *newSnapshot) {
+                if (newSnapshot != nullptr) {
+                    newSnapshot->AddRef ();
+                }
+                Swap (newSnapshot);
+            }
+
+            /// \brief
+            /// Unsubscribe all subscribers and return the old snapshot.
+            /// \return Old snapshot.
+            typename Snapshot::SharedPtr Detach () {
+                LockGuard<SpinLock> guard (spinLock);
+                return Swap (nullptr);
+            }
+
+            /// \brief
+            /// Copy subscribers that are still alive.
+            /// \param[in] from Subscribers to copy.
+            /// \param[out] to Where to copy the live subscribers.
+            static void CopyLiveSubscribers (
+                    const Subscribers &from,
+                    Subscribers &to) {
+                for (std::size_t i = 0, count = from.size (); i < count; ++i) {
+                    if (from[i].second.first.GetSharedPtr () != nullptr) {
+                        to.push_back (from[i]);
+                    }
+                }
+            }
+
+            /// \brief
+            /// Called by Produce when it encounters subscribers that went out of
+            /// scope without unsubscribing. Publish a snapshot without them.
+            void RemoveExpiredSubscribers () {
                 LockGuard<SpinLock> guard (spinLock);
-                return subscribers.size ();
+                Snapshot *current = snapshot;
+                if (current != nullptr) {
+                    Subscribers subscribers;
+                    subscribers.reserve (current->subscribers.size ());
+                    CopyLiveSubscribers (current->subscribers, subscribers);
+                    if (subscribers.size () != current->subscribers.size ()) {
+                        Publish (!subscribers.empty () ? new Snapshot (subscribers) : nullptr);
+                    }
+                }
             }
 
             /// \brief
@@ -25,7 +25,9 @@
 #else // defined (TOOLCHAIN_OS_Windows)
     #include <pthread.h>
 #endif // defined (TOOLCHAIN_OS_Windows)
+#include <string>
 #include "thekogans/util/Config.h"
+#include "thekogans/util/LockProbe.h"
 
 namespace thekogans {
     namespace util {
@@ -48,6 +50,11 @@ namespace thekogans {
             /// POSIX read/write lock.
             pthread_rwlock_t rwlock;
         #endif // defined (TOOLCHAIN_OS_Windows)
+        #if defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+            /// \brief
+            /// \see{LockProfiler} probe.
+            LockProbe probe;
+        #endif // defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
 
         public:
             /// \brief
@@ -73,6 +80,33 @@ namespace thekogans {
             /// \param[in] read true = release for reading, release for writing.
             void Release (bool read);
 
+            /// \brief
+            /// Name the lock so that it shows up in \see{LockProfiler} reports.
+            /// A no-op unless built with THEKOGANS_UTIL_USE_LOCK_PROFILER.
+            /// \param[in] name Lock name.
+        #if defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+            inline void SetProfilerName (const std::string &name) {
+                probe.SetName ("RWLock", name);
+            }
+        #else // defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+            inline void SetProfilerName (const std::string & /*name*/) {}
+        #endif // defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+
+        private:
+            /// \brief
+            /// Try to lock without blocking (unprofiled).
+            /// \param[in] read true = lock for reading, false = lock for writing.
+            /// \return true = locked, false = failed to lock.
+            bool TryLock (bool read);
+            /// \brief
+            /// Lock (unprofiled).
+            /// \param[in] read true = lock for reading, false = lock for writing.
+            void Lock (bool read);
+            /// \brief
+            /// Unlock (unprofiled).
+            /// \param[in] read true = unlock for reading, false = unlock for writing.
+            void Unlock (bool read);
+
             /// \brief
             /// RWLock is neither copy constructable, nor assignable.
             THEKOGANS_UTIL_DISALLOW_COPY_AND_ASSIGN (RWLock)
@@ -29,6 +29,7 @@
 #include "thekogans/util/Constants.h"
 #include "thekogans/util/Point.h"
 #include "thekogans/util/Serializer.h"
+#include "thekogans/util/SerializableFields.h"
 
 namespace thekogans {
     namespace util {
@@ -96,6 +97,12 @@ namespace thekogans {
                 inline ui32 GetArea () const {
                     return width * height;
                 }
+
+                /// \brief
+                /// Extents serialize their width and height.
+                THEKOGANS_UTIL_DECLARE_FIELDS (
+                    THEKOGANS_UTIL_SERIALIZABLE_FIELD (Extents, width, "Width"),
+                    THEKOGANS_UTIL_SERIALIZABLE_FIELD (Extents, height, "Height"))
             } extents;
 
             /// \brief
@@ -147,6 +154,12 @@ namespace thekogans {
                 return SIZE;
             }
 
+            /// \brief
+            /// Rectangle serializes its origin and extents.
+            THEKOGANS_UTIL_DECLARE_FIELDS (
+                THEKOGANS_UTIL_SERIALIZABLE_FIELD (Rectangle, origin, "Origin"),
+                THEKOGANS_UTIL_SERIALIZABLE_FIELD (Rectangle, extents, "Extents"))
+
             /// \brief
             /// Return true if rectangle has zero area.
             /// \return true if rectangle has zero area.
@@ -251,6 +264,11 @@ namespace thekogans {
         #endif // defined (TOOLCHAIN_OS_Windows)
         };
 
+        static_assert (SerializableFields<Rectangle::Extents>::SIZE == Rectangle::Extents::SIZE,
+            "Rectangle::Extents::SIZE is out of sync with Rectangle::Extents::Fields.");
+        static_assert (SerializableFields<Rectangle>::SIZE == Rectangle::SIZE,
+            "Rectangle::SIZE is out of sync with Rectangle::Fields.");
+
         /// \brief
         /// Compare rectangle extents for equality.
         /// \param[in] extents1 First extents to compare.
@@ -375,7 +393,7 @@ namespace thekogans {
         inline Serializer & _LIB_THEKOGANS_UTIL_API operator << (
                 Serializer &serializer,
                 const Rectangle::Extents &extents) {
-            serializer << extents.width << extents.height;
+            SerializableFields<Rectangle::Extents>::Write (serializer, extents);
             return serializer;
         }
         /// \brief
@@ -386,7 +404,7 @@ namespace thekogans {
         inline Serializer & _LIB_THEKOGANS_UTIL_API operator >> (
                 Serializer &serializer,
                 Rectangle::Extents &extents) {
-            serializer >> extents.width >> extents.height;
+            SerializableFields<Rectangle::Extents>::Read (serializer, extents);
             return serializer;
         }
 
@@ -398,7 +416,7 @@ namespace thekogans {
         inline Serializer & _LIB_THEKOGANS_UTIL_API operator << (
                 Serializer &serializer,
                 const Rectangle &rectangle) {
-            serializer << rectangle.origin << rectangle.extents;
+            SerializableFields<Rectangle>::Write (serializer, rectangle);
             return serializer;
         }
         /// \brief
@@ -409,7 +427,7 @@ namespace thekogans {
         inline Serializer & _LIB_THEKOGANS_UTIL_API operator >> (
                 Serializer &serializer,
                 Rectangle &rectangle) {
-            serializer >> rectangle.origin >> rectangle.extents;
+            SerializableFields<Rectangle>::Read (serializer, rectangle);
             return serializer;
         }
 
@@ -19,6 +19,7 @@
 #define __thekogans_util_RefCounted_h
 
 #include <memory>
+#include <atomic>
 #include "thekogans/util/Config.h"
 #include "thekogans/util/Types.h"
 #include "thekogans/util/Constants.h"
@@ -84,6 +85,12 @@ namespace thekogans {
                 /// \param[in] ptr Raw block of memory to deallocate.
                 static void operator delete (void *ptr);
 
+                /// \struct RefCounted::References::Shards RefCounted.h thekogans/util/RefCounted.h
+                ///
+                /// \brief
+                /// Cache line padded, per thread shared counters (see EnableShardedRefCount).
+                struct Shards;
+
             private:
                 /// \brief
                 /// Count of weak references.
@@ -91,13 +98,20 @@ namespace thekogans {
                 /// \brief
                 /// Count of shared references.
                 ui32 shared;
+                /// \brief
+                /// Sharded shared counters (nullptr == not sharded).
+                std::atomic<Shards *> shards;
 
             public:
                 /// \brief
                 /// ctor.
                 References () :
                     weak (1),
-                    shared (0) {}
+                    shared (0),
+                    shards (nullptr) {}
+                /// \brief
+                /// dtor.
+                ~References ();
 
                 /// \brief
                 /// Increment the weak reference count.
@@ -114,17 +128,28 @@ namespace thekogans {
 
                 /// \brief
                 /// Increment the shared reference count.
-                /// \return Incremented shared reference count.
+                /// \return Incremented shared reference count (when sharded,
+                /// only guaranteed to be != 0).
                 ui32 AddSharedRef ();
                 /// \brief
                 /// Decrement the shared reference count, and if 0, call object->Harakiri ().
-                /// \return Decremented shared reference count.
+                /// \return Decremented shared reference count (when sharded,
+                /// only guaranteed to be != 0).
                 ui32 ReleaseSharedRef (RefCounted *object);
                 /// \brief
                 /// Return the count of shared references held.
                 /// \return Count of shared references held.
                 ui32 GetSharedCount () const;
 
+                /// \brief
+                /// Switch the shared count to per thread shards.
+                /// \return true == switched, false == already (or previously) sharded.
+                bool EnableShards ();
+                /// \brief
+                /// Fold the shards back in to the shared count.
+                /// \param[in] object Object to Harakiri if that was the last reference.
+                void DisableShards (RefCounted *object);
+
                 /// \brief
                 /// Used by \see{WeakPtr<T>::GetSharedPtr} below to atomically
                 /// take out a shared reference on a weak pointer.
@@ -167,6 +192,34 @@ namespace thekogans {
                 return references->GetSharedCount ();
             }
 
+            /// \brief
+            /// Switch this object to sharded reference counting. Every thread
+            /// then adds and releases its references on its own cache line
+            /// instead of all of them fighting over one counter. Use it for
+            /// long lived objects whose SharedPtrs are copied from many threads
+            /// at once (\see{DefaultAllocator}::Instance () is called on every
+            /// allocation). SharedPtr/WeakPtr semantics are unchanged and a
+            /// reference taken on one thread can be released on another.
+            /// While sharded, the object takes out a reference on itself (counted
+            /// by GetRefCount), so it can't Harakiri. Call DisableShardedRefCount
+            /// to let it go.
+            /// Sharding is a one shot affair. Once disabled, it can't be
+            /// re-enabled.
+            /// NOTE: Costs an extra cache line per thread shard.
+            /// \return true == switched, false == already (or previously) sharded.
+            inline bool EnableShardedRefCount () {
+                return references->EnableShards ();
+            }
+            /// \brief
+            /// Fold the shards back in to a single counter and release the
+            /// reference taken by EnableShardedRefCount. If that was the last
+            /// one, the object will Harakiri. Safe to call from any thread
+            /// (and more than once) as long as the caller knows the object
+            /// is still alive.
+            inline void DisableShardedRefCount () {
+                references->DisableShards (this);
+            }
+
             /// \brief
             /// This function template allows you to coexist with libraries that use
             /// std::shared_ptr.
@@ -21,14 +21,13 @@
 #include <utility>
 #include <memory>
 #include <typeinfo>
-#include <vector>
+#include <atomic>
 #include "thekogans/util/Config.h"
 #include "thekogans/util/Types.h"
 #include "thekogans/util/Constants.h"
 #include "thekogans/util/Singleton.h"
-#include "thekogans/util/SpinLock.h"
-#include "thekogans/util/LockGuard.h"
 #include "thekogans/util/RefCounted.h"
+#include "thekogans/util/Thread.h"
 
 namespace thekogans {
     namespace util {
@@ -209,72 +208,123 @@ namespace thekogans {
             };
 
         private:
-        #if defined (THEKOGANS_UTIL_REF_COUNTED_REGISTRY_TOKEN_COUNTER_UI16)
             /// \brief
-            /// Bad index value.
-            static const typename Token::IndexType BAD_INDEX = (NIDX64 >> 16) & 0x0000ffffffffffff;
-        #elif defined (THEKOGANS_UTIL_REF_COUNTED_REGISTRY_TOKEN_COUNTER_UI8)
-            /// \brief
-            /// Bad index value.
-            static const typename Token::IndexType BAD_INDEX = (NIDX64 >> 8) & 0x00ffffffffffffff;
-        #else // defined (THEKOGANS_UTIL_REF_COUNTED_REGISTRY_TOKEN_COUNTER_UI8)
-            /// \brief
-            /// Bad index value.
-            static const typename Token::IndexType BAD_INDEX = NIDX32;
-        #endif // defined (THEKOGANS_UTIL_REF_COUNTED_REGISTRY_TOKEN_COUNTER_UI16)
+            /// Max number of entry segments. Every segment (after the first)
+            /// doubles the capacity, so we'll run out of index bits first.
+            static const std::size_t MAX_SEGMENTS = 64;
 
-            /// \struct RefCountedRegistry::Entry RefCounted.h thekogans/util/RefCounted.h
+            /// \struct RefCountedRegistry::Entry RefCountedRegistry.h thekogans/util/RefCountedRegistry.h
             ///
             /// \brief
             /// RefCountedRegistry entry keeps track of registered objects.
+            /// Entry::state packs {counter, LIVE, readers} in to one word
+            /// so that an entry can be checked, pinned and retired with a
+            /// single atomic operation.
             struct Entry {
                 /// \brief
-                /// Weak pointer to registered object.
+                /// Readers (\see{Get}) currently using object.
+                static const ui64 READERS_MASK = 0x000000007fffffff;
+                /// \brief
+                /// Set when the entry holds a registered object.
+                static const ui64 LIVE = 0x0000000080000000;
+                /// \brief
+                /// The counter lives in the top 32 bits.
+                static const ui32 COUNTER_SHIFT = 32;
+
+                /// \brief
+                /// Weak pointer to registered object. Only written by \see{Add}
+                /// (before the entry goes LIVE) and \see{Remove} (after all
+                /// readers are gone).
                 typename RefCounted::WeakPtr<T> object;
                 /// \brief
-                /// Counter to disambiguate entry objects.
-                typename Token::CounterType counter;
+                /// {counter, LIVE, readers}.
+                std::atomic<ui64> state;
                 /// \brief
-                /// Next index in free list.
-                typename Token::IndexType next;
+                /// Next entry (token value) in the free stack.
+                std::atomic<typename Token::ValueType> next;
 
                 /// \brief
                 /// ctor.
-                /// \param[in] object_ Entry object.
-                /// \param[in] counter_ Object counter.
-                /// \param[in] next_ Next index in free list.
-                Entry (
-                    typename RefCounted::WeakPtr<T> object_ = nullptr,
-                    typename Token::CounterType counter_ = 0,
-                    typename Token::IndexType next_ = BAD_INDEX) :
-                    object (object_),
-                    counter (counter_),
-                    next (next_) {}
+                Entry () :
+                    state (0),
+                    next (INVALID_TOKEN) {}
+
+                /// \brief
+                /// Extract the counter from the given state.
+                /// \param[in] state Entry state.
+                /// \return Entry counter.
+                static inline typename Token::CounterType GetCounter (ui64 state) {
+                    return (typename Token::CounterType)(state >> COUNTER_SHIFT);
+                }
+                /// \brief
+                /// Make a state from the given counter and flags.
+                /// \param[in] counter Entry counter.
+                /// \param[in] flags LIVE and/or readers.
+                /// \return Entry state.
+                static inline ui64 MakeState (
+                        typename Token::CounterType counter,
+                        ui64 flags) {
+                    return ((ui64)counter << COUNTER_SHIFT) | flags;
+                }
+                /// \brief
+                /// Return true if the given state describes a LIVE entry
+                /// registered with the given counter.
+                /// \param[in] state Entry state.
+                /// \param[in] counter Token counter.
+                /// \return true == the token is still good.
+                static inline bool IsLive (
+                        ui64 state,
+                        typename Token::CounterType counter) {
+                    return (state & LIVE) != 0 && GetCounter (state) == counter;
+                }
+
+                /// \brief
+                /// Entry is neither copy constructable, nor assignable.
+                THEKOGANS_UTIL_DISALLOW_COPY_AND_ASSIGN (Entry)
             };
             /// \brief
-            /// The list of registered objects.
-            std::vector<Entry> entries;
+            /// Size of the first segment (power of 2). Segment k > 0 holds
+            /// indices [firstSegmentSize << (k - 1), firstSegmentSize << k).
+            const ui64 firstSegmentSize;
             /// \brief
-            /// Count of registered objects.
-            typename Token::IndexType count;
+            /// Entry segments. Segments are allocated on demand and never
+            /// move or go away (until the registry does). That's what lets
+            /// \see{Get} find an entry without taking a lock.
+            std::atomic<Entry *> segments[MAX_SEGMENTS];
             /// \brief
-            /// Index of last freed object.
-            typename Token::IndexType freeList;
+            /// Count of entries ever handed out (free or not).
+            std::atomic<typename Token::IndexType> size;
             /// \brief
-            /// Synchronization lock.
-            SpinLock spinLock;
+            /// Top of the free entry stack (INVALID_TOKEN == empty).
+            /// Pushed entries are recorded as {index, counter} token
+            /// values. Since \see{Remove} bumps the counter before pushing,
+            /// the same entry comes back as a different value which keeps
+            /// the stack safe from ABA.
+            std::atomic<typename Token::ValueType> freeStack;
 
         public:
             /// \brief
             /// ctor.
-            /// \param[in] entriesSize Initial entry list size.
-            /// NOTE: The resizing algorithm used below doubles this
-            /// starting seed every time it needs to add room for a
+            /// \param[in] entriesSize Initial entry list size (rounded up to a power of 2).
+            /// NOTE: The resizing algorithm used below doubles the
+            /// capacity every time it needs to add room for a
             /// new entry. This is why the check for 0 is done below.
             RefCountedRegistry (std::size_t entriesSize = DEFAULT_ENTRIES_SIZE) :
-                entries (entriesSize == 0 ? 1 : entriesSize),
-                count (0),
-                freeList (BAD_INDEX) {}
+                    firstSegmentSize (RoundUpToPowerOf2 (entriesSize == 0 ? 1 : entriesSize)),
+                    size (0),
+                    freeStack (INVALID_TOKEN) {
+                segments[0].store (new Entry[firstSegmentSize], std::memory_order_relaxed);
+                for (std::size_t i = 1; i < MAX_SEGMENTS; ++i) {
+                    segments[i].store (nullptr, std::memory_order_relaxed);
+                }
+            }
+            /// \brief
+            /// dtor.
+            ~RefCountedRegistry () {
+                for (std::size_t i = 0; i < MAX_SEGMENTS; ++i) {
+                    delete [] segments[i].load (std::memory_order_relaxed);
+                }
+            }
 
             /// \brief
             /// Add an object to the registry.
@@ -288,43 +338,32 @@ namespace thekogans {
                 typename Token::ValueType value = INVALID_TOKEN;
                 if (t != nullptr) {
                     typename Token::IndexType index;
-                    typename Token::CounterType counter;
-                    {
-                        LockGuard<SpinLock> guard (spinLock);
-                        if (freeList != BAD_INDEX) {
-                            // Reuse a free entry.
-                            index = freeList;
-                            counter = entries[index].counter;
-                            freeList = entries[index].next;
-                        }
-                        else {
-                            index = count;
-                            // This is the first time we're using this slot.
-                            counter = 0;
-                            if (count == entries.size ()) {
-                                // Here we implement a simple exponential
-                                // array grow algorithm. Every time we
-                                // need to grow the array, we double its
-                                // size. This scheme has two advantages:
-                                // 1. Keep the registry small for types with few instances.
-                                // 2. Less grow copy overhead for types with many instances.
-                                // A byproduct of this approach is that every
-                                // index allocated and returned by the registry
-                                // is valid in perpetuity. This is exactly the
-                                // reason counter is used in the token to disambiguate
-                                // object lifetimes. When an object leaves the registry,
-                                // \see{Remove} will bump up the counter so that any
-                                // leftover token copies will now point to an earlier,
-                                // possibly deleted object.
-                                entries.resize (count * 2);
-                            }
-                        }
-                        entries[index] = Entry (
-                            typename RefCounted::WeakPtr<T> (t), counter, BAD_INDEX);
-                        ++count;
+                    // Reuse a free entry.
+                    Entry *entry = PopFreeEntry (index);
+                    if (entry == nullptr) {
+                        // Here we implement a simple exponential
+                        // array grow algorithm. Every time we
+                        // run out of room, we add a segment as
+                        // big as all the ones before it. This scheme
+                        // has two advantages:
+                        // 1. Keep the registry small for types with few instances.
+                        // 2. No grow copy overhead for types with many instances.
+                        // A byproduct of this approach is that every
+                        // index allocated and returned by the registry
+                        // is valid in perpetuity. This is exactly the
+                        // reason counter is used in the token to disambiguate
+                        // object lifetimes. When an object leaves the registry,
+                        // \see{Remove} will bump up the counter so that any
+                        // leftover token copies will now point to an earlier,
+                        // possibly deleted object.
+                        index = size.fetch_add (1, std::memory_order_relaxed);
+                        entry = GetEntry (index, true);
                     }
+                    // Nobody looks at object until the entry goes LIVE.
+                    entry->object = typename RefCounted::WeakPtr<T> (t);
+                    ui64 state = entry->state.fetch_or (Entry::LIVE, std::memory_order_release);
                     // Pack index and counter describing this entry in to a token value.
-                    value = Token::MakeValue (index, counter);
+                    value = Token::MakeValue (index, Entry::GetCounter (state));
                 }
                 return value;
             }
@@ -336,37 +375,166 @@ namespace thekogans {
                 // Unpack the token to get index and counter.
                 typename Token::IndexType index = Token::GetIndex (value);
                 typename Token::CounterType counter = Token::GetCounter (value);
-                LockGuard<SpinLock> guard (spinLock);
-                // Check the counter to make sure this token
-                // still has access to this slot.
-                if (index < entries.size () && entries[index].counter == counter) {
-                    // Incrementing the counter prevents double Remove and Get after Remove.
-                    // NOTE: Because of WeakPtr<T> () in Entry below, Get after Remove is
-                    // harmless, though it's still semantically wrong. Double Remove on the
-                    // other hand would lead to freeList corruption.
-                    entries[index] = Entry (nullptr, ++counter, freeList);
-                    freeList = index;
-                    --count;
+                Entry *entry = GetEntry (index, false);
+                if (entry != nullptr) {
+                    ui64 state = entry->state.load (std::memory_order_relaxed);
+                    // Check the counter to make sure this token
+                    // still has access to this slot.
+                    while (Entry::IsLive (state, counter)) {
+                        // Incrementing the counter prevents double Remove and Get after Remove.
+                        // Double Remove would lead to free stack corruption.
+                        typename Token::CounterType nextCounter =
+                            (typename Token::CounterType)(counter + 1);
+                        if (entry->state.compare_exchange_weak (
+                                state,
+                                Entry::MakeState (nextCounter, state & Entry::READERS_MASK),
+                                std::memory_order_acq_rel,
+                                std::memory_order_relaxed)) {
+                            // New readers will see the new counter and leave the
+                            // object alone. Wait for the ones that got in before
+                            // us to finish with it.
+                            Thread::Backoff backoff;
+                            while ((entry->state.load (
+                                    std::memory_order_acquire) & Entry::READERS_MASK) != 0) {
+                                backoff.Pause ();
+                            }
+                            entry->object = typename RefCounted::WeakPtr<T> ();
+                            PushFreeEntry (entry, Token::MakeValue (index, nextCounter));
+                            break;
+                        }
+                    }
                 }
             }
 
             /// \brief
             /// Given a token, retrieve the object at the entry.
+            /// Lock-free. Concurrent Gets of different objects
+            /// don't touch any shared state.
             /// \param[in] value Token describing the object entry to retrieve.
             /// \return SharedPtr<T>.
             typename RefCounted::SharedPtr<T> Get (typename Token::ValueType value) {
+                typename RefCounted::SharedPtr<T> object;
                 // Unpack the token to get index and counter.
                 typename Token::IndexType index = Token::GetIndex (value);
                 typename Token::CounterType counter = Token::GetCounter (value);
-                LockGuard<SpinLock> guard (spinLock);
+                Entry *entry = GetEntry (index, false);
                 // Check the counter to make sure this token
-                // still references the current object.
-                return index < entries.size () && entries[index].counter == counter ?
-                    // Yes? Ask the WeakPtr<T> registered to return a SharedPtr<T>.
-                    entries[index].object.GetSharedPtr () :
-                    // No? Return NULL pointer.
-                    nullptr;
+                // still references the current object. Stale
+                // tokens are turned away without a write.
+                if (entry != nullptr &&
+                        Entry::IsLive (entry->state.load (std::memory_order_acquire), counter)) {
+                    // Pin the entry so that Remove can't pull the object
+                    // out from under us, and check again.
+                    if (Entry::IsLive (entry->state.fetch_add (1, std::memory_order_acquire), counter)) {
+                        // Yes? Ask the WeakPtr<T> registered to return a SharedPtr<T>.
+                        object = entry->object.GetSharedPtr ();
+                    }
+                    entry->state.fetch_sub (1, std::memory_order_release);
+                }
+                return object;
+            }
+
+        private:
+            /// \brief
+            /// Round the given value up to the next power of 2.
+            /// \param[in] value Value to round up.
+            /// \return Smallest power of 2 >= value.
+            static ui64 RoundUpToPowerOf2 (std::size_t value) {
+                ui64 powerOf2 = 1;
+                while (powerOf2 < value) {
+                    powerOf2 <<= 1;
+                }
+                return powerOf2;
             }
+
+            /// \brief
+            /// Return the entry at the given index.
+            /// \param[in] index Entry index.
+            /// \param[in] allocate true == allocate the segment if it's not there yet.
+            /// \return Entry at the given index (nullptr if index is out of range).
+            Entry *GetEntry (
+                    typename Token::IndexType index,
+                    bool allocate) {
+                if (!allocate && index >= size.load (std::memory_order_acquire)) {
+                    return nullptr;
+                }
+                std::size_t segment = 0;
+                ui64 base = 0;
+                ui64 segmentSize = firstSegmentSize;
+                if (index >= firstSegmentSize) {
+                    segment = 1;
+                    base = firstSegmentSize;
+                    while (index >= base << 1) {
+                        base <<= 1;
+                        ++segment;
+                    }
+                    segmentSize = base;
+                }
+                Entry *entries = segments[segment].load (std::memory_order_acquire);
+                if (entries == nullptr) {
+                    if (!allocate) {
+                        // Index was handed out, but its
+                        // segment is still being allocated.
+                        return nullptr;
+                    }
+                    Entry *newEntries = new Entry[segmentSize];
+                    if (segments[segment].compare_exchange_strong (
+                            entries,
+                            newEntries,
+                            std::memory_order_acq_rel,
+                            std::memory_order_acquire)) {
+                        entries = newEntries;
+                    }
+                    else {
+                        // Somebody beat us to it.
+                        delete [] newEntries;
+                    }
+                }
+                return &entries[index - base];
+            }
+
+            /// \brief
+            /// Pop an entry off the free stack.
+            /// \param[out] index Popped entry index.
+            /// \return Popped entry (nullptr if the stack is empty).
+            Entry *PopFreeEntry (typename Token::IndexType &index) {
+                typename Token::ValueType head = freeStack.load (std::memory_order_acquire);
+                while (head != INVALID_TOKEN) {
+                    index = Token::GetIndex (head);
+                    Entry *entry = GetEntry (index, false);
+                    // If entry was popped (and reused) since we read head, next
+                    // is garbage, but then head has changed too and the CAS fails.
+                    if (freeStack.compare_exchange_weak (
+                            head,
+                            entry->next.load (std::memory_order_relaxed),
+                            std::memory_order_acquire,
+                            std::memory_order_acquire)) {
+                        return entry;
+                    }
+                }
+                return nullptr;
+            }
+
+            /// \brief
+            /// Push the given entry on to the free stack.
+            /// \param[in] entry Entry to push.
+            /// \param[in] value {index, counter} describing the entry.
+            void PushFreeEntry (
+                    Entry *entry,
+                    typename Token::ValueType value) {
+                typename Token::ValueType head = freeStack.load (std::memory_order_relaxed);
+                do {
+                    entry->next.store (head, std::memory_order_relaxed);
+                } while (!freeStack.compare_exchange_weak (
+                    head,
+                    value,
+                    std::memory_order_release,
+                    std::memory_order_relaxed));
+            }
+
+            /// \brief
+            /// RefCountedRegistry is neither copy constructable, nor assignable.
+            THEKOGANS_UTIL_DISALLOW_COPY_AND_ASSIGN (RefCountedRegistry)
         };
 
     } // namespace util
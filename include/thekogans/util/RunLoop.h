@@ -35,18 +35,29 @@
 #include "thekogans/util/Types.h"
 #include "thekogans/util/SizeT.h"
 #include "thekogans/util/Serializable.h"
+#include "thekogans/util/SerializableFields.h"
 #include "thekogans/util/RefCounted.h"
 #include "thekogans/util/IntrusiveList.h"
 #include "thekogans/util/GUID.h"
 #include "thekogans/util/TimeSpec.h"
 #include "thekogans/util/Exception.h"
 #include "thekogans/util/Mutex.h"
+#include "thekogans/util/SpinLock.h"
+#include "thekogans/util/SeqLock.h"
 #include "thekogans/util/Condition.h"
 #include "thekogans/util/Event.h"
 
 namespace thekogans {
     namespace util {
 
+    #if defined (TOOLCHAIN_OS_Linux)
+        namespace os {
+            namespace linux {
+                struct EpollRunLoop;
+            } // namespace linux
+        } // namespace os
+    #endif // defined (TOOLCHAIN_OS_Linux)
+
         /// \struct RunLoop RunLoop.h thekogans/util/RunLoop.h
         ///
         /// \brief
@@ -143,6 +154,10 @@ namespace thekogans {
                 /// \brief
                 /// Set when job completes execution.
                 Event completed;
+                /// \brief
+                /// When the job was last enqueued (\see{HRTimer} ticks).
+                /// Used by elastic \see{JobQueue}s to measure queue wait time.
+                ui64 enqueueTime;
 
             public:
                 /// \brief
@@ -152,7 +167,8 @@ namespace thekogans {
                     id (id_),
                     state (Completed),
                     disposition (Unknown),
-                    sleeping (false) {}
+                    sleeping (false),
+                    enqueueTime (0) {}
 
                 /// \brief
                 /// Return the job id.
@@ -313,6 +329,11 @@ namespace thekogans {
                 /// \brief
                 /// Scheduler needs acces to protected members.
                 friend struct Scheduler;
+            #if defined (TOOLCHAIN_OS_Linux)
+                /// \brief
+                /// EpollRunLoop needs acces to protected members.
+                friend struct os::linux::EpollRunLoop;
+            #endif // defined (TOOLCHAIN_OS_Linux)
             };
         #if defined (TOOLCHAIN_COMPILER_cl)
             #pragma warning (pop)
@@ -422,6 +443,18 @@ namespace thekogans {
                 /// \param[in] runLoop RunLoop from which to dequeue the next job.
                 /// \return The next job to execute (0 if no more pending jobs).
                 virtual Job *DeqJob (State &state) = 0;
+                /// \brief
+                /// Return how long the run loop has to wait before it can dequeue
+                /// the next job. Called with the run loop jobsMutex held and only
+                /// when there are pending jobs. Workers that get a non zero delay
+                /// wait on jobsNotEmpty for that long before asking again. Only
+                /// throttling policies (see \see{RateLimitedJobExecutionPolicy})
+                /// need to override this.
+                /// \param[in] state RunLoop about to dequeue a job.
+                /// \return How long to wait (TimeSpec::Zero == dequeue now).
+                virtual TimeSpec GetDeqJobDelay (State & /*state*/) {
+                    return TimeSpec::Zero;
+                }
             };
 
             /// \struct RunLoop::FIFOJobExecutionPolicy RunLoop.h thekogans/util/RunLoop.h
@@ -492,6 +525,108 @@ namespace thekogans {
                 virtual Job *DeqJob (State &state) override;
             };
 
+            /// \struct RunLoop::RateLimitedJobExecutionPolicy RunLoop.h thekogans/util/RunLoop.h
+            ///
+            /// \brief
+            /// Throttles any other \see{JobExecutionPolicy} with a token bucket.
+            /// The bucket holds up to burst tokens and refills at rate tokens per
+            /// second. Every dequeued job takes a token. When the bucket is empty,
+            /// workers wait on the run loop condition until the next token is due
+            /// instead of sleeping inside Job::Execute. Use it to protect downstream
+            /// disks and services:
+            ///
+            /// \code{.cpp}
+            /// using namespace thekogans;
+            ///
+            /// // At most 100 writes per second, in bursts of up to 10.
+            /// util::JobQueue jobQueue (
+            ///     "Writer",
+            ///     new util::RunLoop::RateLimitedJobExecutionPolicy (
+            ///         new util::RunLoop::FIFOJobExecutionPolicy, 100.0, 10));
+            /// \endcode
+            ///
+            /// It works with run loops that wait in RunLoop::State::DeqJob (\see{JobQueue},
+            /// \see{Pipeline} stages, \see{ThreadRunLoop} and \see{Scheduler::JobQueue}) and with
+            /// \see{os::linux::EpollRunLoop} (which uses RunLoop::State::GetDeqJobDelay
+            /// as its epoll_wait timeout). \see{SystemRunLoop} (and therefore
+            /// \see{MainRunLoop}) can't wait for a token and rejects it. Sharing one
+            /// instance between several run loops (\see{JobQueuePool} does that)
+            /// puts them all under the same limit.
+            struct _LIB_THEKOGANS_UTIL_DECL RateLimitedJobExecutionPolicy : public JobExecutionPolicy {
+                /// \brief
+                /// Declare \see{RefCounted} pointers.
+                THEKOGANS_UTIL_DECLARE_REF_COUNTED_POINTERS (RateLimitedJobExecutionPolicy)
+
+            private:
+                /// \brief
+                /// Policy that orders the jobs.
+                JobExecutionPolicy::SharedPtr jobExecutionPolicy;
+                /// \brief
+                /// Tokens per second.
+                const f64 rate;
+                /// \brief
+                /// Bucket capacity.
+                const f64 burst;
+                /// \brief
+                /// Available tokens (negative == borrowed by
+                /// run loops that share this policy).
+                f64 tokens;
+                /// \brief
+                /// When tokens was last refilled (\see{HRTimer} ticks).
+                ui64 lastRefill;
+                /// \brief
+                /// The bucket can be shared between run loops,
+                /// so it can't rely on their jobsMutex.
+                SpinLock spinLock;
+
+            public:
+                /// \brief
+                /// ctor.
+                /// \param[in] jobExecutionPolicy_ Policy that orders the jobs.
+                /// \param[in] rate_ Jobs per second.
+                /// \param[in] burst_ Max jobs to release back to back after an idle period.
+                RateLimitedJobExecutionPolicy (
+                    JobExecutionPolicy::SharedPtr jobExecutionPolicy_,
+                    f64 rate_,
+                    std::size_t burst_ = 1);
+
+                /// \brief
+                /// Enqueue a job on the given RunLoops pendingJobs to be performed
+                /// on the run loop thread.
+                /// \param[in] runLoop RunLoop on which to enqueue the given job.
+                /// \param[in] job Job to enqueue.
+                virtual void EnqJob (
+                    State &state,
+                    Job *job) override;
+                /// \brief
+                /// Enqueue a job on the given RunLoops pendingJobs to be performed
+                /// next on the run loop thread.
+                /// \param[in] runLoop RunLoop on which to enqueue the given job.
+                /// \param[in] job Job to enqueue.
+                virtual void EnqJobFront (
+                    State &state,
+                    Job *job) override;
+                /// \brief
+                /// Take a token and dequeue the next job to be executed on the run loop thread.
+                /// \param[in] runLoop RunLoop from which to dequeue the next job.
+                /// \return The next job to execute (0 if no more pending jobs).
+                virtual Job *DeqJob (State &state) override;
+                /// \brief
+                /// Return how long until the next token is due.
+                /// \param[in] state RunLoop about to dequeue a job.
+                /// \return How long to wait (TimeSpec::Zero == dequeue now).
+                virtual TimeSpec GetDeqJobDelay (State &state) override;
+
+            private:
+                /// \brief
+                /// Add the tokens that accrued since lastRefill.
+                void Refill ();
+
+                /// \brief
+                /// RateLimitedJobExecutionPolicy is neither copy constructable, nor assignable.
+                THEKOGANS_UTIL_DISALLOW_COPY_AND_ASSIGN (RateLimitedJobExecutionPolicy)
+            };
+
             /// \brief
             /// Alias for std::list<Job::SharedPtr>.
             using UserJobList = std::list<Job::SharedPtr>;
@@ -586,45 +721,12 @@ namespace thekogans {
 
                     // Serializable
                     /// \brief
-                    /// Return the serialized job size.
-                    /// \return Serialized job size.
-                    virtual std::size_t Size () const noexcept override;
-
-                    /// \brief
-                    /// Read the key from the given serializer.
-                    /// \param[in] header \see{Serializable::Header}.
-                    /// \param[in] serializer \see{Serializer} to read the key from.
-                    virtual void Read (
-                        const SerializableHeader & /*header*/,
-                        Serializer &serializer) override;
-                    /// \brief
-                    /// Write the key to the given serializer.
-                    /// \param[out] serializer \see{Serializer} to write the key to.
-                    virtual void Write (Serializer &serializer) const override;
-
-                    /// \brief
-                    /// Read the Serializable from an XML DOM.
-                    /// \param[in] header \see{SerializableHeader}.
-                    /// \param[in] node XML DOM representation of a Serializable.
-                    virtual void ReadXML (
-                        const SerializableHeader & /*header*/,
-                        const pugi::xml_node &node) override;
-                    /// \brief
-                    /// Write the Serializable to the XML DOM.
-                    /// \param[out] node Parent node.
-                    virtual void WriteXML (pugi::xml_node &node) const override;
-
-                    /// \brief
-                    /// Read the Serializable from an JSON DOM.
-                    /// \param[in] header \see{SerializableHeader}.
-                    /// \param[in] object JSON DOM representation of a Serializable.
-                    virtual void ReadJSON (
-                        const SerializableHeader & /*header*/,
-                        const JSON::Object &object) override;
-                    /// \brief
-                    /// Write the Serializable to the JSON DOM.
-                    /// \param[out] object Parent node.
-                    virtual void WriteJSON (JSON::Object &object) const override;
+                    /// Job stats serialize their id and times.
+                    THEKOGANS_UTIL_DECLARE_SERIALIZABLE_FIELDS (
+                        THEKOGANS_UTIL_SERIALIZABLE_FIELD (Job, id, "Id"),
+                        THEKOGANS_UTIL_SERIALIZABLE_FIELD (Job, startTime, "StartTime"),
+                        THEKOGANS_UTIL_SERIALIZABLE_FIELD (Job, endTime, "EndTime"),
+                        THEKOGANS_UTIL_SERIALIZABLE_FIELD (Job, totalTime, "TotalTime"))
                 };
                 /// \brief
                 /// Last job stats.
@@ -669,47 +771,87 @@ namespace thekogans {
                 /// Reset the RunLoop stats.
                 void Reset ();
 
-                // Serializable
-                /// \brief
-                /// Return the serialized key size.
-                /// \return Serialized key size.
-                virtual std::size_t Size () const noexcept override;
-
-                /// \brief
-                /// Read the key from the given serializer.
-                /// \param[in] header \see{SerializableHeader}.
-                /// \param[in] serializer \see{Serializer} to read the key from.
-                virtual void Read (
-                    const SerializableHeader & /*header*/,
-                    Serializer &serializer) override;
+                /// \struct RunLoop::Stats::Counters RunLoop.h thekogans/util/RunLoop.h
+                ///
                 /// \brief
-                /// Write the key to the given serializer.
-                /// \param[out] serializer \see{Serializer} to write the key to.
-                virtual void Write (Serializer &serializer) const override;
+                /// Trivially copyable image of everything in Stats but id and name.
+                /// Run loops publish it through a \see{SeqLock} so that GetStats
+                /// doesn't contend with the workers for the jobs mutex. To keep
+                /// the copy off the per job path, it's published every
+                /// PUBLISH_INTERVAL jobs and whenever the run loop goes idle.
+                /// While busy, GetStats can therefore lag by up to
+                /// PUBLISH_INTERVAL - 1 jobs.
+                struct Counters {
+                    /// \brief
+                    /// Longest job id that fits in the image.
+                    static const std::size_t MAX_JOB_ID_LENGTH = 64;
+                    /// \brief
+                    /// Publish the image every this many jobs.
+                    static const ui64 PUBLISH_INTERVAL = 64;
+                    /// \struct RunLoop::Stats::Counters::Job RunLoop.h thekogans/util/RunLoop.h
+                    ///
+                    /// \brief
+                    /// Trivially copyable image of \see{Stats::Job}.
+                    struct Job {
+                        /// \brief
+                        /// Job id.
+                        char id[MAX_JOB_ID_LENGTH];
+                        /// \brief
+                        /// Job id length.
+                        std::size_t idLength;
+                        /// \brief
+                        /// Job start time.
+                        ui64 startTime;
+                        /// \brief
+                        /// Job end time.
+                        ui64 endTime;
+                        /// \brief
+                        /// Job total execution time.
+                        ui64 totalTime;
+                    };
+                    /// \brief
+                    /// Total jobs processed.
+                    ui64 totalJobs;
+                    /// \brief
+                    /// Total time taken to process totalJobs.
+                    ui64 totalJobTime;
+                    /// \brief
+                    /// Last job stats.
+                    Job lastJob;
+                    /// \brief
+                    /// Minimum job stats.
+                    Job minJob;
+                    /// \brief
+                    /// Maximum job stats.
+                    Job maxJob;
+                    /// \brief
+                    /// false == one of the job ids was too long to fit. The
+                    /// reader has to get the stats the slow way (under the lock).
+                    bool complete;
+                };
 
                 /// \brief
-                /// Read the Serializable from an XML DOM.
-                /// \param[in] header \see{SerializableHeader}.
-                /// \param[in] node XML DOM representation of a Serializable.
-                virtual void ReadXML (
-                    const SerializableHeader & /*header*/,
-                    const pugi::xml_node &node) override;
+                /// Return the trivially copyable image of these stats.
+                /// \return Trivially copyable image of these stats.
+                Counters GetCounters () const;
                 /// \brief
-                /// Write the Serializable to the XML DOM.
-                /// \param[out] node Parent node.
-                virtual void WriteXML (pugi::xml_node &node) const override;
+                /// Set these stats from the given image.
+                /// \param[in] counters Image to set the stats from.
+                void SetCounters (const Counters &counters);
 
+                // Serializable
                 /// \brief
-                /// Read the Serializable from an JSON DOM.
-                /// \param[in] header \see{SerializableHeader}.
-                /// \param[in] object JSON DOM representation of a Serializable.
-                virtual void ReadJSON (
-                    const SerializableHeader & /*header*/,
-                    const JSON::Object &object) override;
-                /// \brief
-                /// Write the Serializable to the JSON DOM.
-                /// \param[out] object Parent node.
-                virtual void WriteJSON (JSON::Object &object) const override;
+                /// Stats serialize everything but the counters image. The
+                /// (free form) name is URI encoded in XML.
+                THEKOGANS_UTIL_DECLARE_SERIALIZABLE_FIELDS (
+                    THEKOGANS_UTIL_SERIALIZABLE_FIELD (Stats, id, "Id"),
+                    THEKOGANS_UTIL_SERIALIZABLE_FIELD_EX (Stats, name, "Name",
+                        EncodedStringFieldTraits),
+                    THEKOGANS_UTIL_SERIALIZABLE_FIELD (Stats, totalJobs, "TotalJobs"),
+                    THEKOGANS_UTIL_SERIALIZABLE_FIELD (Stats, totalJobTime, "TotalJobTime"),
+                    THEKOGANS_UTIL_SERIALIZABLE_FIELD (Stats, lastJob, "LastJob"),
+                    THEKOGANS_UTIL_SERIALIZABLE_FIELD (Stats, minJob, "MinJob"),
+                    THEKOGANS_UTIL_SERIALIZABLE_FIELD (Stats, maxJob, "MaxJob"))
 
             private:
                 /// \brief
@@ -877,6 +1019,10 @@ namespace thekogans {
                 /// RunLoop stats.
                 Stats stats;
                 /// \brief
+                /// stats image (published by FinishedJob, see \see{Stats::Counters})
+                /// for lock free GetStats.
+                SeqLock<Stats::Counters> statsCounters;
+                /// \brief
                 /// Synchronization mutex.
                 Mutex jobsMutex;
                 /// \brief
@@ -906,8 +1052,17 @@ namespace thekogans {
                 /// \brief
                 /// Used internally by worker(s) to get the next job.
                 /// \param[in] wait true == Wait until a job becomes available.
-                /// \return The next job to execute.
-                Job *DeqJob (bool wait = true);
+                /// \param[in] timeSpec If wait == true, how long to wait for a job.
+                /// IMPORTANT: timeSpec is a relative value.
+                /// \return The next job to execute (nullptr if timed out).
+                Job *DeqJob (
+                    bool wait = true,
+                    const TimeSpec &timeSpec = TimeSpec::Infinite);
+                /// \brief
+                /// Return how long a worker has to wait before DeqJob will
+                /// release the next pending job (see \see{RateLimitedJobExecutionPolicy}).
+                /// \return How long to wait (TimeSpec::Zero == no pending jobs or not throttled).
+                TimeSpec GetDeqJobDelay ();
                 /// \brief
                 /// Called by worker(s) after each job is completed.
                 /// Used to update state and \see{RunLoop::Stats}.
@@ -18,7 +18,8 @@
 #if !defined (__thekogans_util_RunLoopScheduler_h)
 #define __thekogans_util_RunLoopScheduler_h
 
-#include <queue>
+#include <vector>
+#include <unordered_map>
 #include "thekogans/util/Config.h"
 #include "thekogans/util/Types.h"
 #include "thekogans/util/RefCounted.h"
@@ -41,6 +42,20 @@ namespace thekogans {
         /// to be executed in the future.
 
         struct _LIB_THEKOGANS_UTIL_DECL RunLoopScheduler : public Subscriber<TimerEvents> {
+            /// \enum
+            /// Periodic job schedules.
+            enum Schedule {
+                /// \brief
+                /// Deadlines are anchored to the first deadline (deadline + n * period).
+                /// The schedule does not drift with timer latency or job execution
+                /// time. If the scheduler falls behind (or the previous instance is
+                /// still running) the missed periods are skipped, not bunched up.
+                FixedRate,
+                /// \brief
+                /// The next deadline is period after the job was last enqueued.
+                FixedDelay
+            };
+
         private:
             /// \brief
             /// \see{Timer} used to schedule future jobs.
@@ -61,33 +76,45 @@ namespace thekogans {
                 /// \brief
                 /// Absolute time when the job will be scheduled.
                 TimeSpec deadline;
+                /// \brief
+                /// If != TimeSpec::Zero, the job is periodic and will be
+                /// rescheduled every period.
+                TimeSpec period;
+                /// \brief
+                /// Periodic job schedule (see \see{Schedule}).
+                Schedule schedule;
+                /// \brief
+                /// Position of this JobInfo in the \see{Queue} heap.
+                /// Maintained by the \see{Queue} to make cancellation O(log n).
+                std::size_t index;
 
                 /// \brief
                 /// ctor.
                 /// \param[in] job_ \see{RunLoop::Job} or \see{Pipeline::Job} that will be scheduled.
                 /// \param[in] deadline_ Absolute time when the job will be scheduled.
+                /// \param[in] period_ If != TimeSpec::Zero, reschedule the job every period.
+                /// \param[in] schedule_ Periodic job schedule.
                 JobInfo (
                     RunLoop::Job::SharedPtr job_,
-                    const TimeSpec &deadline_) :
+                    const TimeSpec &deadline_,
+                    const TimeSpec &period_ = TimeSpec::Zero,
+                    Schedule schedule_ = FixedRate) :
                     job (job_),
-                    deadline (deadline_) {}
-
-                /// \struct RunLoopScheduler::JobInfo::Compare RunLoopScheduler.h thekogans/util/RunLoopScheduler.h
-                ///
-                /// \brief
-                /// Used by the std::priority_queue to sort the jobs.
-                struct Compare {
-                    /// \brief
-                    /// JobInfo comparison operator.
-                    /// \param[in] jobInfo1 First JobInfo to compare.
-                    /// \param[in] jobInfo2 Second JobInfo to compare.
-                    /// \return true if jobInfo1 should come before jobInfo2.
-                    inline bool operator () (
-                            const JobInfo::SharedPtr &jobInfo1,
-                            const JobInfo::SharedPtr &jobInfo2) {
-                        return jobInfo1->deadline > jobInfo2->deadline;
-                    }
-                } static compare;
+                    deadline (deadline_),
+                    period (period_),
+                    schedule (schedule_),
+                    index (NIDX) {}
+
+                /// \brief
+                /// Return true if the job is periodic.
+                /// \return true if the job is periodic.
+                inline bool IsPeriodic () const {
+                    return period != TimeSpec::Zero;
+                }
+                /// \brief
+                /// Compute the next deadline of a periodic job.
+                /// \param[in] now Current time.
+                void Reschedule (const TimeSpec &now);
 
                 /// \brief
                 /// Return the id associated with this \see{RunLoop} or \see{Pipeline}.
@@ -117,11 +144,15 @@ namespace thekogans {
                 /// \param[in] job \see{RunLoop::Job} that will be scheduled.
                 /// \param[in] deadline Absolute time when the job will be scheduled.
                 /// \param[in] runLoop_ \see{RunLoop} the job will be scheduled on.
+                /// \param[in] period If != TimeSpec::Zero, reschedule the job every period.
+                /// \param[in] schedule Periodic job schedule.
                 RunLoopJobInfo (
                     RunLoop::Job::SharedPtr job,
                     const TimeSpec &deadline,
-                    RunLoop::SharedPtr runLoop_) :
-                    JobInfo (job, deadline),
+                    RunLoop::SharedPtr runLoop_,
+                    const TimeSpec &period = TimeSpec::Zero,
+                    Schedule schedule = FixedRate) :
+                    JobInfo (job, deadline, period, schedule),
                     runLoop (runLoop_) {}
 
                 /// \brief
@@ -160,11 +191,15 @@ namespace thekogans {
                 /// \param[in] job \see{Pipeline::Job} that will be scheduled.
                 /// \param[in] deadline Absolute time when the job will be scheduled.
                 /// \param[in] pipeline_ \see{Pipeline} the job will be scheduled on.
+                /// \param[in] period If != TimeSpec::Zero, reschedule the job every period.
+                /// \param[in] schedule Periodic job schedule.
                 PipelineJobInfo (
                     Pipeline::Job::SharedPtr job,
                     const TimeSpec &deadline,
-                    Pipeline::SharedPtr pipeline_) :
-                    JobInfo (job, deadline),
+                    Pipeline::SharedPtr pipeline_,
+                    const TimeSpec &period = TimeSpec::Zero,
+                    Schedule schedule = FixedRate) :
+                    JobInfo (job, deadline, period, schedule),
                     pipeline (pipeline_) {}
 
                 /// \brief
@@ -184,22 +219,51 @@ namespace thekogans {
                 /// PipelineJobInfo is neither copy constructable, nor assignable.
                 THEKOGANS_UTIL_DISALLOW_COPY_AND_ASSIGN (PipelineJobInfo)
             };
-            /// \brief
-            /// Alias for std::priority_queue<JobInfo::SharedPtr,
-            /// std::vector<JobInfo::SharedPtr>, JobInfo::Compare>.
-            using QueueType = std::priority_queue<
-                JobInfo::SharedPtr,
-                std::vector<JobInfo::SharedPtr>,
-                JobInfo::Compare>;
             /// \struct RunLoopScheduler::Queue RunLoopScheduler.h thekogans/util/RunLoopScheduler.h
             ///
             /// \brief
-            /// Priority queue used for job scheduling.
-            struct Queue : public QueueType {
+            /// Indexed binary min-heap (ordered by deadline) used for job scheduling.
+            /// Every JobInfo knows its position in the heap, and the heap maintains a
+            /// job id -> JobInfo map. Together they make cancelling a job O(log n).
+            /// This matters because most timeouts are cancelled long before they fire.
+            struct Queue {
+            private:
                 /// \brief
-                /// ctor.
-                Queue () :
-                    QueueType (JobInfo::compare) {}
+                /// Heap ordered by JobInfo::deadline.
+                std::vector<JobInfo::SharedPtr> heap;
+                /// \brief
+                /// Alias for std::unordered_map<RunLoop::Job::Id, JobInfo *>.
+                using Map = std::unordered_map<RunLoop::Job::Id, JobInfo *>;
+                /// \brief
+                /// Map of job ids to their JobInfo.
+                Map map;
+
+            public:
+                /// \brief
+                /// Return true if there are no pending jobs.
+                /// \return true if there are no pending jobs.
+                inline bool empty () const {
+                    return heap.empty ();
+                }
+                /// \brief
+                /// Return the job with the earliest deadline.
+                /// \return JobInfo with the earliest deadline.
+                inline const JobInfo::SharedPtr &top () const {
+                    return heap.front ();
+                }
+
+                /// \brief
+                /// Add a job to the queue. If a job with the same id
+                /// is already scheduled, it's replaced.
+                /// \param[in] jobInfo JobInfo to add.
+                void push (JobInfo::SharedPtr jobInfo);
+                /// \brief
+                /// Remove and return the job with the earliest deadline.
+                /// \return JobInfo with the earliest deadline.
+                JobInfo::SharedPtr pop ();
+                /// \brief
+                /// Remove all jobs.
+                void clear ();
 
                 /// \brief
                 /// Cancel the job associated with the given job id.
@@ -209,6 +273,31 @@ namespace thekogans {
                 /// Cancel all pending jobs associated with the given \see{RunLoop}.
                 /// \param[in] runLoop \see{RunLoop} whose jobs to cancel.
                 void CancelJobs (const RunLoop::Id &runLoopId);
+
+            private:
+                /// \brief
+                /// Remove the JobInfo at the given heap position.
+                /// \param[in] index Heap position of the JobInfo to remove.
+                /// \return Removed JobInfo.
+                JobInfo::SharedPtr Remove (std::size_t index);
+                /// \brief
+                /// Put the given JobInfo at the given heap position.
+                /// \param[in] index Heap position.
+                /// \param[in] jobInfo JobInfo to put there.
+                inline void Place (
+                        std::size_t index,
+                        JobInfo::SharedPtr jobInfo) {
+                    jobInfo->index = index;
+                    heap[index] = jobInfo;
+                }
+                /// \brief
+                /// Move the JobInfo at the given heap position toward the root.
+                /// \param[in] index Heap position of the JobInfo to move.
+                void SiftUp (std::size_t index);
+                /// \brief
+                /// Move the JobInfo at the given heap position toward the leaves.
+                /// \param[in] index Heap position of the JobInfo to move.
+                void SiftDown (std::size_t index);
             } queue;
             /// \brief
             /// Synchronization lock.
@@ -288,8 +377,66 @@ namespace thekogans {
                     pipeline);
             }
 
+            /// \brief
+            /// Schedule a job to be performed periodically.
+            /// NOTE: If the previous instance of the job is still pending
+            /// or running when the next one is due, that period is skipped.
+            /// \param[in] job \see{RunLoop::Job} to execute periodically.
+            /// \param[in] timeSpec When in the future to execute the first instance.
+            /// IMPORTANT: timeSpec is a relative value.
+            /// \param[in] period How often to execute the job after the first instance.
+            /// \param[in] schedule FixedRate or FixedDelay.
+            /// \param[in] runLoop \see{RunLoop} that will execute the job.
+            /// \return RunLoop::Job::Id which can be used in a call to CancelJob.
+            RunLoop::Job::Id SchedulePeriodicRunLoopJob (
+                RunLoop::Job::SharedPtr job,
+                const TimeSpec &timeSpec,
+                const TimeSpec &period,
+                Schedule schedule = FixedRate,
+                RunLoop::SharedPtr runLoop = MainRunLoop::Instance ());
+            /// \brief
+            /// Schedule a lambda (function) to be performed periodically.
+            /// \param[in] function Lambda to execute periodically.
+            /// \param[in] timeSpec When in the future to execute the first instance.
+            /// IMPORTANT: timeSpec is a relative value.
+            /// \param[in] period How often to execute the lambda after the first instance.
+            /// \param[in] schedule FixedRate or FixedDelay.
+            /// \param[in] runLoop \see{RunLoop} that will execute the job.
+            /// \return RunLoop::Job::Id which can be used in a call to CancelJob.
+            inline RunLoop::Job::Id SchedulePeriodicRunLoopJob (
+                    const RunLoop::LambdaJob::Function &function,
+                    const TimeSpec &timeSpec,
+                    const TimeSpec &period,
+                    Schedule schedule = FixedRate,
+                    RunLoop::SharedPtr runLoop = MainRunLoop::Instance ()) {
+                return SchedulePeriodicRunLoopJob (
+                    new RunLoop::LambdaJob (function),
+                    timeSpec,
+                    period,
+                    schedule,
+                    runLoop);
+            }
+            /// \brief
+            /// Schedule a job to be performed periodically.
+            /// NOTE: If the previous instance of the job is still pending
+            /// or running when the next one is due, that period is skipped.
+            /// \param[in] job \see{Pipeline::Job} to execute periodically.
+            /// \param[in] timeSpec When in the future to execute the first instance.
+            /// IMPORTANT: timeSpec is a relative value.
+            /// \param[in] period How often to execute the job after the first instance.
+            /// \param[in] schedule FixedRate or FixedDelay.
+            /// \param[in] pipeline \see{Pipeline} that will execute the job.
+            /// \return Pipeline::Job::Id which can be used in a call to CancelJob.
+            Pipeline::Job::Id SchedulePeriodicPipelineJob (
+                Pipeline::Job::SharedPtr job,
+                const TimeSpec &timeSpec,
+                const TimeSpec &period,
+                Schedule schedule = FixedRate,
+                Pipeline::SharedPtr pipeline = GlobalPipeline::Instance ());
+
             /// \brief
             /// Cancel the job associated with the given job id.
+            /// Periodic jobs are cancelled by the same id.
             /// \param[in] id Job id to cancel.
             void CancelJob (const RunLoop::Job::Id &id);
             /// \brief
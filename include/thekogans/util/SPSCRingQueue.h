@@ -0,0 +1,258 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_util_SPSCRingQueue_h)
+#define __thekogans_util_SPSCRingQueue_h
+
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <utility>
+#include "thekogans/util/Config.h"
+#include "thekogans/util/Exception.h"
+
+namespace thekogans {
+    namespace util {
+
+        /// \struct SPSCRingQueue SPSCRingQueue.h thekogans/util/SPSCRingQueue.h
+        ///
+        /// \brief
+        /// SPSCRingQueue is a bounded, lock-free, single producer/single consumer
+        /// ring buffer. Use it to hand data between exactly two threads. The
+        /// producer owns tail and the consumer owns head. Each keeps a cached copy
+        /// of the other's index (on its own cache line) and only reloads it when
+        /// the queue looks full (empty). Most Push/Pop calls therefore touch no
+        /// shared cache line other than the slot itself. The batch versions
+        /// publish a whole run of slots with one store.
+        ///
+        /// T must be default constructable and move assignable. Popped slots keep
+        /// their (moved from) values until they're overwritten.
+        ///
+        /// VERY IMPORTANT: Exactly one thread may push, and exactly one thread
+        /// may pop. Wrap it in \see{BlockingRingQueue} if the threads need to
+        /// block when the queue is empty/full.
+
+        template<typename T>
+        struct SPSCRingQueue {
+            /// \brief
+            /// Alias for T.
+            using ValueType = T;
+
+            /// \brief
+            /// Size of the cache line the indices are padded to.
+            static const std::size_t CACHE_LINE_SIZE = 64;
+
+        private:
+            /// \brief
+            /// Number of slots (a power of 2).
+            const std::size_t capacity;
+            /// \brief
+            /// capacity - 1.
+            const std::size_t mask;
+            /// \brief
+            /// Slots.
+            std::unique_ptr<T[]> slots;
+            /// \brief
+            /// Next slot to pop (written by the consumer).
+            alignas (CACHE_LINE_SIZE) std::atomic<std::size_t> head;
+            /// \brief
+            /// Consumer's copy of tail.
+            std::size_t cachedTail;
+            /// \brief
+            /// Next slot to push (written by the producer).
+            alignas (CACHE_LINE_SIZE) std::atomic<std::size_t> tail;
+            /// \brief
+            /// Producer's copy of head.
+            std::size_t cachedHead;
+
+        public:
+            /// \brief
+            /// ctor.
+            /// \param[in] capacity_ Max number of queued values (rounded up to a power of 2).
+            explicit SPSCRingQueue (std::size_t capacity_) :
+                    capacity (RoundUp (capacity_)),
+                    mask (capacity - 1),
+                    slots (new T[capacity]),
+                    head (0),
+                    cachedTail (0),
+                    tail (0),
+                    cachedHead (0) {
+                if (capacity_ == 0) {
+                    THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                        THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+                }
+            }
+
+            /// \brief
+            /// Return the number of slots.
+            /// \return Number of slots.
+            inline std::size_t GetCapacity () const {
+                return capacity;
+            }
+            /// \brief
+            /// Return the number of queued values. Only exact
+            /// when called from the producer or the consumer.
+            /// \return Number of queued values.
+            inline std::size_t GetSize () const {
+                return tail.load (std::memory_order_acquire) -
+                    head.load (std::memory_order_acquire);
+            }
+            /// \brief
+            /// Return true if the queue is empty.
+            /// \return true if the queue is empty.
+            inline bool IsEmpty () const {
+                return GetSize () == 0;
+            }
+
+            /// \brief
+            /// Push a value (producer only).
+            /// \param[in] value Value to push.
+            /// \return true == pushed, false == the queue is full.
+            inline bool Push (const T &value) {
+                std::size_t tail_ = tail.load (std::memory_order_relaxed);
+                if (!HasRoom (tail_, 1)) {
+                    return false;
+                }
+                slots[tail_ & mask] = value;
+                tail.store (tail_ + 1, std::memory_order_release);
+                return true;
+            }
+            /// \brief
+            /// Push a value (producer only).
+            /// \param[in] value Value to push.
+            /// \return true == pushed, false == the queue is full (value is left alone).
+            inline bool Push (T &&value) {
+                std::size_t tail_ = tail.load (std::memory_order_relaxed);
+                if (!HasRoom (tail_, 1)) {
+                    return false;
+                }
+                slots[tail_ & mask] = std::move (value);
+                tail.store (tail_ + 1, std::memory_order_release);
+                return true;
+            }
+            /// \brief
+            /// Push as many of the given values as will fit (producer only).
+            /// \param[in] values Values to push.
+            /// \param[in] count Number of values.
+            /// \return Number of values pushed.
+            std::size_t PushBatch (
+                    const T *values,
+                    std::size_t count) {
+                std::size_t tail_ = tail.load (std::memory_order_relaxed);
+                if (!HasRoom (tail_, 1)) {
+                    return 0;
+                }
+                std::size_t room = capacity - (tail_ - cachedHead);
+                if (count > room) {
+                    count = room;
+                }
+                for (std::size_t i = 0; i < count; ++i) {
+                    slots[(tail_ + i) & mask] = values[i];
+                }
+                tail.store (tail_ + count, std::memory_order_release);
+                return count;
+            }
+
+            /// \brief
+            /// Pop a value (consumer only).
+            /// \param[out] value Where to put the popped value.
+            /// \return true == popped, false == the queue is empty.
+            inline bool Pop (T &value) {
+                std::size_t head_ = head.load (std::memory_order_relaxed);
+                if (!HasData (head_, 1)) {
+                    return false;
+                }
+                value = std::move (slots[head_ & mask]);
+                head.store (head_ + 1, std::memory_order_release);
+                return true;
+            }
+            /// \brief
+            /// Pop up to count values (consumer only).
+            /// \param[out] values Where to put the popped values.
+            /// \param[in] count Max number of values to pop.
+            /// \return Number of values popped.
+            std::size_t PopBatch (
+                    T *values,
+                    std::size_t count) {
+                std::size_t head_ = head.load (std::memory_order_relaxed);
+                if (!HasData (head_, 1)) {
+                    return 0;
+                }
+                std::size_t available = cachedTail - head_;
+                if (count > available) {
+                    count = available;
+                }
+                for (std::size_t i = 0; i < count; ++i) {
+                    values[i] = std::move (slots[(head_ + i) & mask]);
+                }
+                head.store (head_ + count, std::memory_order_release);
+                return count;
+            }
+
+        private:
+            /// \brief
+            /// Round the given capacity up to the next power of 2.
+            /// \param[in] capacity Capacity to round up.
+            /// \return Capacity rounded up to the next power of 2.
+            static std::size_t RoundUp (std::size_t capacity) {
+                std::size_t result = 1;
+                while (result < capacity) {
+                    result <<= 1;
+                }
+                return result;
+            }
+
+            /// \brief
+            /// Return true if there's room for count more values.
+            /// Only reloads head if the cached copy says there isn't.
+            /// \param[in] tail_ Current tail.
+            /// \param[in] count Number of values.
+            /// \return true if there's room for count more values.
+            inline bool HasRoom (
+                    std::size_t tail_,
+                    std::size_t count) {
+                if (tail_ - cachedHead + count > capacity) {
+                    cachedHead = head.load (std::memory_order_acquire);
+                    return tail_ - cachedHead + count <= capacity;
+                }
+                return true;
+            }
+            /// \brief
+            /// Return true if there are at least count values to pop.
+            /// Only reloads tail if the cached copy says there aren't.
+            /// \param[in] head_ Current head.
+            /// \param[in] count Number of values.
+            /// \return true if there are at least count values to pop.
+            inline bool HasData (
+                    std::size_t head_,
+                    std::size_t count) {
+                if (cachedTail - head_ < count) {
+                    cachedTail = tail.load (std::memory_order_acquire);
+                    return cachedTail - head_ >= count;
+                }
+                return true;
+            }
+
+            /// \brief
+            /// SPSCRingQueue is neither copy constructable, nor assignable.
+            THEKOGANS_UTIL_DISALLOW_COPY_AND_ASSIGN (SPSCRingQueue)
+        };
+
+    } // namespace util
+} // namespace thekogans
+
+#endif // !defined (__thekogans_util_SPSCRingQueue_h)
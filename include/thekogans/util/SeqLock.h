@@ -0,0 +1,192 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_util_SeqLock_h)
+#define __thekogans_util_SeqLock_h
+
+#include <cstddef>
+#include <cstring>
+#include <atomic>
+#include <type_traits>
+#include "thekogans/util/Config.h"
+#include "thekogans/util/Types.h"
+#include "thekogans/util/SpinLock.h"
+#include "thekogans/util/LockGuard.h"
+
+namespace thekogans {
+    namespace util {
+
+        /// \struct SeqLock SeqLock.h thekogans/util/SeqLock.h
+        ///
+        /// \brief
+        /// SeqLock (sequence lock) publishes small, trivially copyable values (stats,
+        /// counters, config) to readers that must never block or slow down the writers.
+        /// Readers don't write to shared memory at all. They copy the value and retry
+        /// if a write happened while they were copying. Writers bump the sequence
+        /// (odd == write in progress), store the value, and bump it again.
+        ///
+        /// Use it like this:
+        ///
+        /// \code{.cpp}
+        /// struct Counters {
+        ///     ui64 hits;
+        ///     ui64 misses;
+        /// };
+        /// util::SeqLock<Counters> counters;
+        ///
+        /// // writer
+        /// counters.Update (
+        ///     [] (Counters &counters) {
+        ///         ++counters.hits;
+        ///     });
+        ///
+        /// // reader (any thread)
+        /// Counters snapshot = counters.Read ();
+        /// \endcode
+        ///
+        /// The value is stored as an array of relaxed atomic words, so concurrent
+        /// copies are well defined (no data races). Keep T small. Readers retry
+        /// for as long as writers keep writing.
+
+        template<typename T>
+        struct SeqLock {
+            static_assert (std::is_trivially_copyable<T>::value,
+                "SeqLock value must be trivially copyable.");
+
+        private:
+            /// \brief
+            /// Alias for the word used to store the value.
+            using Word = ui64;
+            /// \brief
+            /// Number of words needed to store the value.
+            static const std::size_t WORD_COUNT = (sizeof (T) + sizeof (Word) - 1) / sizeof (Word);
+
+            /// \brief
+            /// Even == stable, odd == write in progress.
+            std::atomic<ui32> sequence;
+            /// \brief
+            /// The value.
+            std::atomic<Word> words[WORD_COUNT];
+            /// \brief
+            /// Serializes concurrent writers.
+            SpinLock spinLock;
+
+        public:
+            /// \brief
+            /// ctor.
+            /// \param[in] value Initial value.
+            explicit SeqLock (const T &value = T ()) :
+                    sequence (0) {
+                Store (value);
+            }
+
+            /// \brief
+            /// Return a consistent copy of the value. Never blocks the writers.
+            /// \return A consistent copy of the value.
+            T Read () const {
+                T value;
+                while (!TryRead (value)) {
+                }
+                return value;
+            }
+
+            /// \brief
+            /// Try once to copy the value.
+            /// \param[out] value Where to put the copy.
+            /// \return true == value is consistent, false == raced with a writer.
+            bool TryRead (T &value) const {
+                ui32 start = sequence.load (std::memory_order_acquire);
+                if ((start & 1) == 0) {
+                    Word buffer[WORD_COUNT];
+                    for (std::size_t i = 0; i < WORD_COUNT; ++i) {
+                        buffer[i] = words[i].load (std::memory_order_relaxed);
+                    }
+                    // Order the loads above before the sequence check below.
+                    std::atomic_thread_fence (std::memory_order_acquire);
+                    if (sequence.load (std::memory_order_relaxed) == start) {
+                        memcpy (&value, buffer, sizeof (T));
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            /// \brief
+            /// Publish a new value. Safe to call from multiple threads.
+            /// \param[in] value Value to publish.
+            void Write (const T &value) {
+                LockGuard<SpinLock> guard (spinLock);
+                ExclusiveWrite (value);
+            }
+
+            /// \brief
+            /// Modify the value in place. Safe to call from multiple threads.
+            /// \param[in] update Called with the current value to modify.
+            template<typename Func>
+            void Update (Func update) {
+                LockGuard<SpinLock> guard (spinLock);
+                T value;
+                Load (value);
+                update (value);
+                ExclusiveWrite (value);
+            }
+
+            /// \brief
+            /// Publish a new value. Use this when the writers are already serialized
+            /// by an external lock. It saves the (redundant) internal lock round trip.
+            /// \param[in] value Value to publish.
+            void ExclusiveWrite (const T &value) {
+                ui32 start = sequence.load (std::memory_order_relaxed);
+                sequence.store (start + 1, std::memory_order_relaxed);
+                // Order the sequence store above before the value stores below.
+                std::atomic_thread_fence (std::memory_order_release);
+                Store (value);
+                sequence.store (start + 2, std::memory_order_release);
+            }
+
+        private:
+            /// \brief
+            /// Store the value in to words.
+            /// \param[in] value Value to store.
+            void Store (const T &value) {
+                Word buffer[WORD_COUNT] = {0};
+                memcpy (buffer, &value, sizeof (T));
+                for (std::size_t i = 0; i < WORD_COUNT; ++i) {
+                    words[i].store (buffer[i], std::memory_order_relaxed);
+                }
+            }
+            /// \brief
+            /// Load the value from words. Only the writer can
+            /// call this (it doesn't check the sequence).
+            /// \param[out] value Where to put the value.
+            void Load (T &value) const {
+                Word buffer[WORD_COUNT];
+                for (std::size_t i = 0; i < WORD_COUNT; ++i) {
+                    buffer[i] = words[i].load (std::memory_order_relaxed);
+                }
+                memcpy (&value, buffer, sizeof (T));
+            }
+
+            /// \brief
+            /// SeqLock is neither copy constructable, nor assignable.
+            THEKOGANS_UTIL_DISALLOW_COPY_AND_ASSIGN (SeqLock)
+        };
+
+    } // namespace util
+} // namespace thekogans
+
+#endif // !defined (__thekogans_util_SeqLock_h)
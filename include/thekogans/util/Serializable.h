@@ -46,6 +46,23 @@ namespace thekogans {
         /// to register themselves for dynamic discovery, creation and serializable insertion and
         /// extraction. (For a good real world example have a look at \see{crypto::Serializable}
         /// and it's derivatives.)
+        ///
+        /// Read-only message processing can be done without copying. Give the
+        /// serializable std::string_view and \see{ByteView} members, set
+        /// \see{Serializer::borrow} on the \see{Buffer} being read, and in Read do:
+        ///
+        /// \code{.cpp}
+        /// if (serializer.IsBorrowing ()) {
+        ///     serializer >> nameView >> payloadView;
+        /// }
+        /// else {
+        ///     serializer >> name >> payload;
+        ///     nameView = name;
+        ///     payloadView = thekogans::util::ByteView (payload.data (), payload.size ());
+        /// }
+        /// \endcode
+        ///
+        /// The views are valid for as long as the \see{Buffer} is.
         struct _LIB_THEKOGANS_UTIL_DECL Serializable : public DynamicCreatable {
             /// \brief
             /// Serializable is a \see{DynamicCreatable} abstract base.
@@ -327,6 +344,8 @@ namespace thekogans {
         /// to put the bits back exactly as it found them. The limitation is that if
         /// you made a binary blob, you cannot store it as an XML or JSON blob. That
         /// kind of conversion requires knowledge of the underlying type.
+        /// When read from a borrowing serializer (\see{Serializer::borrow}), the
+        /// binary blob wraps the serializer's memory instead of copying it.
         struct _LIB_THEKOGANS_UTIL_DECL Blob : public Serializable {
             /// \brief
             /// Declare \see{RefCounted} pointers.
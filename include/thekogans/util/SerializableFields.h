@@ -0,0 +1,918 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_util_SerializableFields_h)
+#define __thekogans_util_SerializableFields_h
+
+#include <cstddef>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <type_traits>
+#include "pugixml/pugixml.hpp"
+#include "thekogans/util/Config.h"
+#include "thekogans/util/Types.h"
+#include "thekogans/util/SizeT.h"
+#include "thekogans/util/Serializer.h"
+#include "thekogans/util/JSON.h"
+#include "thekogans/util/StringUtils.h"
+#include "thekogans/util/XMLUtils.h"
+
+namespace thekogans {
+    namespace util {
+
+        /// \brief
+        /// Forward declaration of \see{Serializable}.
+        struct Serializable;
+
+        /// \brief
+        /// Forward declaration of SerializableFields.
+        template<typename T>
+        struct SerializableFields;
+
+        /// \struct FieldTraits SerializableFields.h thekogans/util/SerializableFields.h
+        ///
+        /// \brief
+        /// FieldTraits tell \see{SerializableFields} how to size, read and write
+        /// a field of a given type in all three (binary, XML and JSON) formats.
+        /// Out of the box, arithmetic types, std::string, \see{SizeT}, nested
+        /// \see{Serializable}s and nested types with their own field descriptors
+        /// are supported. Specialize FieldTraits for anything else (see
+        /// \see{Fraction::Sign} for an example). Every specialization provides:
+        ///
+        /// \code{.cpp}
+        /// // Fixed binary size of the field (0 == variable size).
+        /// static const std::size_t SIZE;
+        /// static std::size_t Size (const T &value);
+        /// static void Read (Serializer &serializer, T &value);
+        /// static void Write (Serializer &serializer, const T &value);
+        /// static void ReadXML (const pugi::xml_node &node, const char *name, T &value);
+        /// static void WriteXML (pugi::xml_node &node, const char *name, const T &value);
+        /// static void ReadJSON (const JSON::Object &object, const char *name, T &value);
+        /// static void WriteJSON (JSON::Object &object, const char *name, const T &value);
+        /// \endcode
+        template<
+            typename T,
+            typename Enabled = void>
+        struct FieldTraits;
+
+        /// \struct SerializableField SerializableFields.h thekogans/util/SerializableFields.h
+        ///
+        /// \brief
+        /// Describes one field (member) of T. Use
+        /// THEKOGANS_UTIL_SERIALIZABLE_FIELD (or THEKOGANS_UTIL_SERIALIZABLE_FIELD_EX
+        /// if the field needs traits other than FieldTraits<M>) to create them.
+        template<
+            typename T,
+            typename M,
+            typename Traits_ = FieldTraits<M>>
+        struct SerializableField {
+            /// \brief
+            /// Field type.
+            using Type = M;
+            /// \brief
+            /// Field traits (FieldTraits<M> by default).
+            using Traits = Traits_;
+
+            /// \brief
+            /// Field name (XML attribute/child and JSON member name).
+            const char *name;
+            /// \brief
+            /// Pointer to the described member.
+            M T::*member;
+
+            /// \brief
+            /// Return the binary size of the field.
+            /// \param[in] object Object whose field to size.
+            /// \return Binary size of the field.
+            inline std::size_t Size (const T &object) const {
+                return Traits::Size (object.*member);
+            }
+            /// \brief
+            /// Read the field from the given serializer.
+            /// \param[in] serializer \see{Serializer} to read the field from.
+            /// \param[out] object Object whose field to read.
+            inline void Read (
+                    Serializer &serializer,
+                    T &object) const {
+                Traits::Read (serializer, object.*member);
+            }
+            /// \brief
+            /// Write the field to the given serializer.
+            /// \param[out] serializer \see{Serializer} to write the field to.
+            /// \param[in] object Object whose field to write.
+            inline void Write (
+                    Serializer &serializer,
+                    const T &object) const {
+                Traits::Write (serializer, object.*member);
+            }
+            /// \brief
+            /// Read the field from the given XML node.
+            /// \param[in] node XML node to read the field from.
+            /// \param[out] object Object whose field to read.
+            inline void ReadXML (
+                    const pugi::xml_node &node,
+                    T &object) const {
+                Traits::ReadXML (node, name, object.*member);
+            }
+            /// \brief
+            /// Write the field to the given XML node.
+            /// \param[out] node XML node to write the field to.
+            /// \param[in] object Object whose field to write.
+            inline void WriteXML (
+                    pugi::xml_node &node,
+                    const T &object) const {
+                Traits::WriteXML (node, name, object.*member);
+            }
+            /// \brief
+            /// Read the field from the given JSON object.
+            /// \param[in] object_ JSON object to read the field from.
+            /// \param[out] object Object whose field to read.
+            inline void ReadJSON (
+                    const JSON::Object &object_,
+                    T &object) const {
+                Traits::ReadJSON (object_, name, object.*member);
+            }
+            /// \brief
+            /// Write the field to the given JSON object.
+            /// \param[out] object_ JSON object to write the field to.
+            /// \param[in] object Object whose field to write.
+            inline void WriteJSON (
+                    JSON::Object &object_,
+                    const T &object) const {
+                Traits::WriteJSON (object_, name, object.*member);
+            }
+        };
+
+        /// \def THEKOGANS_UTIL_SERIALIZABLE_FIELD(_T, member, name)
+        /// Describe _T::member as a field called name.
+        #define THEKOGANS_UTIL_SERIALIZABLE_FIELD(_T, member, name)\
+            thekogans::util::SerializableField<_T, decltype (_T::member)> {name, &_T::member}
+
+        /// \def THEKOGANS_UTIL_SERIALIZABLE_FIELD_EX(_T, member, name, traits)
+        /// Describe _T::member as a field called name, sized, read and
+        /// written by the given traits (\see{EncodedStringFieldTraits}...).
+        #define THEKOGANS_UTIL_SERIALIZABLE_FIELD_EX(_T, member, name, traits)\
+            thekogans::util::SerializableField<_T, decltype (_T::member), traits> {name, &_T::member}
+
+        /// \def THEKOGANS_UTIL_DECLARE_FIELDS(...)
+        /// Declare the (public) field descriptors of a type. The fields are
+        /// serialized in the order given. Use it to give plain structs (\see{Point},
+        /// \see{Rectangle}...) \see{SerializableFields} support.
+        #define THEKOGANS_UTIL_DECLARE_FIELDS(...)\
+            static constexpr auto Fields () {\
+                return std::make_tuple (__VA_ARGS__);\
+            }
+
+        /// \def THEKOGANS_UTIL_DECLARE_SERIALIZABLE_FIELDS(...)
+        /// Declare the field descriptors of a \see{Serializable} along with
+        /// the methods (Size, Read, Write, SizeXML, ReadXML, WriteXML, SizeJSON,
+        /// ReadJSON and WriteJSON) that THEKOGANS_UTIL_IMPLEMENT_SERIALIZABLE_FIELDS
+        /// will generate from them. Must appear in a public section. Ex:
+        ///
+        /// \code{.cpp}
+        /// struct _LIB_THEKOGANS_UTIL_DECL TimeSpec : public Serializable {
+        ///     THEKOGANS_UTIL_DECLARE_SERIALIZABLE (TimeSpec)
+        ///
+        ///     i64 seconds;
+        ///     i32 nanoseconds;
+        ///     ...
+        ///     THEKOGANS_UTIL_DECLARE_SERIALIZABLE_FIELDS (
+        ///         THEKOGANS_UTIL_SERIALIZABLE_FIELD (TimeSpec, seconds, "Seconds"),
+        ///         THEKOGANS_UTIL_SERIALIZABLE_FIELD (TimeSpec, nanoseconds, "Nanoseconds"))
+        /// };
+        /// \endcode
+        ///
+        /// NOTE: The generated Read ignores the \see{SerializableHeader}. If you
+        /// need version dependent reads, write them by hand. SizeXML and SizeJSON
+        /// return the binary size (Size) so that all three headers agree.
+        #define THEKOGANS_UTIL_DECLARE_SERIALIZABLE_FIELDS(...)\
+            THEKOGANS_UTIL_DECLARE_FIELDS (__VA_ARGS__)\
+            virtual std::size_t Size () const noexcept override;\
+            virtual void Read (\
+                const thekogans::util::SerializableHeader &header,\
+                thekogans::util::Serializer &serializer) override;\
+            virtual void Write (thekogans::util::Serializer &serializer) const override;\
+            virtual std::size_t SizeXML () const noexcept override;\
+            virtual void ReadXML (\
+                const thekogans::util::SerializableHeader &header,\
+                const pugi::xml_node &node) override;\
+            virtual void WriteXML (pugi::xml_node &node) const override;\
+            virtual std::size_t SizeJSON () const noexcept override;\
+            virtual void ReadJSON (\
+                const thekogans::util::SerializableHeader &header,\
+                const thekogans::util::JSON::Object &object) override;\
+            virtual void WriteJSON (thekogans::util::JSON::Object &object) const override;
+
+        /// \def THEKOGANS_UTIL_IMPLEMENT_SERIALIZABLE_FIELDS(_T)
+        /// Generate the methods declared by THEKOGANS_UTIL_DECLARE_SERIALIZABLE_FIELDS.
+        /// Instantiate one of these in your class cpp (next to
+        /// THEKOGANS_UTIL_IMPLEMENT_SERIALIZABLE).
+        #define THEKOGANS_UTIL_IMPLEMENT_SERIALIZABLE_FIELDS(_T)\
+            std::size_t _T::Size () const noexcept {\
+                return thekogans::util::SerializableFields<_T>::Size (*this);\
+            }\
+            void _T::Read (\
+                    const thekogans::util::SerializableHeader & /*header*/,\
+                    thekogans::util::Serializer &serializer) {\
+                thekogans::util::SerializableFields<_T>::Read (serializer, *this);\
+            }\
+            void _T::Write (thekogans::util::Serializer &serializer) const {\
+                thekogans::util::SerializableFields<_T>::Write (serializer, *this);\
+            }\
+            std::size_t _T::SizeXML () const noexcept {\
+                return Size ();\
+            }\
+            void _T::ReadXML (\
+                    const thekogans::util::SerializableHeader & /*header*/,\
+                    const pugi::xml_node &node) {\
+                thekogans::util::SerializableFields<_T>::ReadXML (node, *this);\
+            }\
+            void _T::WriteXML (pugi::xml_node &node) const {\
+                thekogans::util::SerializableFields<_T>::WriteXML (node, *this);\
+            }\
+            std::size_t _T::SizeJSON () const noexcept {\
+                return Size ();\
+            }\
+            void _T::ReadJSON (\
+                    const thekogans::util::SerializableHeader & /*header*/,\
+                    const thekogans::util::JSON::Object &object) {\
+                thekogans::util::SerializableFields<_T>::ReadJSON (object, *this);\
+            }\
+            void _T::WriteJSON (thekogans::util::JSON::Object &object) const {\
+                thekogans::util::SerializableFields<_T>::WriteJSON (object, *this);\
+            }
+
+        namespace detail {
+            /// \brief
+            /// true if T declares its fields (THEKOGANS_UTIL_DECLARE_FIELDS).
+            template<
+                typename T,
+                typename = void>
+            struct HasFields : public std::false_type {};
+
+            /// \brief
+            /// HasFields specialization for types that declare their fields.
+            template<typename T>
+            struct HasFields<T, std::void_t<decltype (T::Fields ())>> :
+                public std::true_type {};
+
+            /// \brief
+            /// Return the sum of the fixed field sizes, or 0 if any
+            /// of the fields is variable size.
+            /// \return Fixed binary size of the fields (0 == variable size).
+            template<typename... Fields>
+            constexpr std::size_t FixedSize (const std::tuple<Fields...> &) {
+                return ((Fields::Traits::SIZE != 0) && ...) ?
+                    (std::size_t (0) + ... + Fields::Traits::SIZE) : 0;
+            }
+        }
+
+        /// \struct SerializableFields SerializableFields.h thekogans/util/SerializableFields.h
+        ///
+        /// \brief
+        /// SerializableFields walks the (compile time) field descriptors
+        /// declared with THEKOGANS_UTIL_DECLARE_FIELDS to size, read and
+        /// write T. If all fields are fixed size, SIZE is computed at compile
+        /// time and Size never looks at the object. Read and Write are a single
+        /// pass over the fields with no intermediate buffers or virtual calls
+        /// (beyond the ones the \see{Serializer} makes).
+        template<typename T>
+        struct SerializableFields {
+            /// \brief
+            /// Fixed binary size of T (0 == variable size).
+            static constexpr std::size_t SIZE = detail::FixedSize (T::Fields ());
+
+            /// \brief
+            /// Return the binary size of the given object.
+            /// \param[in] object Object whose size to return.
+            /// \return Binary size of the given object.
+            static std::size_t Size (const T &object) {
+                if constexpr (SIZE != 0) {
+                    return SIZE;
+                }
+                else {
+                    return std::apply (
+                        [&object] (const auto &...fields) {
+                            return (std::size_t (0) + ... + fields.Size (object));
+                        },
+                        T::Fields ());
+                }
+            }
+
+            /// \brief
+            /// Read the given object from the given serializer.
+            /// \param[in] serializer \see{Serializer} to read the object from.
+            /// \param[out] object Object to read.
+            static void Read (
+                    Serializer &serializer,
+                    T &object) {
+                std::apply (
+                    [&serializer, &object] (const auto &...fields) {
+                        (fields.Read (serializer, object), ...);
+                    },
+                    T::Fields ());
+            }
+            /// \brief
+            /// Write the given object to the given serializer.
+            /// \param[out] serializer \see{Serializer} to write the object to.
+            /// \param[in] object Object to write.
+            static void Write (
+                    Serializer &serializer,
+                    const T &object) {
+                std::apply (
+                    [&serializer, &object] (const auto &...fields) {
+                        (fields.Write (serializer, object), ...);
+                    },
+                    T::Fields ());
+            }
+
+            /// \brief
+            /// Read the given object from the given XML node.
+            /// \param[in] node XML node to read the object from.
+            /// \param[out] object Object to read.
+            static void ReadXML (
+                    const pugi::xml_node &node,
+                    T &object) {
+                std::apply (
+                    [&node, &object] (const auto &...fields) {
+                        (fields.ReadXML (node, object), ...);
+                    },
+                    T::Fields ());
+            }
+            /// \brief
+            /// Write the given object to the given XML node.
+            /// \param[out] node XML node to write the object to.
+            /// \param[in] object Object to write.
+            static void WriteXML (
+                    pugi::xml_node &node,
+                    const T &object) {
+                std::apply (
+                    [&node, &object] (const auto &...fields) {
+                        (fields.WriteXML (node, object), ...);
+                    },
+                    T::Fields ());
+            }
+
+            /// \brief
+            /// Read the given object from the given JSON object.
+            /// \param[in] object_ JSON object to read the object from.
+            /// \param[out] object Object to read.
+            static void ReadJSON (
+                    const JSON::Object &object_,
+                    T &object) {
+                std::apply (
+                    [&object_, &object] (const auto &...fields) {
+                        (fields.ReadJSON (object_, object), ...);
+                    },
+                    T::Fields ());
+            }
+            /// \brief
+            /// Write the given object to the given JSON object.
+            /// \param[out] object_ JSON object to write the object to.
+            /// \param[in] object Object to write.
+            static void WriteJSON (
+                    JSON::Object &object_,
+                    const T &object) {
+                std::apply (
+                    [&object_, &object] (const auto &...fields) {
+                        (fields.WriteJSON (object_, object), ...);
+                    },
+                    T::Fields ());
+            }
+        };
+
+        /// \struct FieldTraits<T, std::enable_if_t<std::is_arithmetic<T>::value>>
+        ///     SerializableFields.h thekogans/util/SerializableFields.h
+        ///
+        /// \brief
+        /// FieldTraits for bool, integral and floating point fields.
+        /// XML stores them as attributes, JSON as numbers (or bools).
+        template<typename T>
+        struct FieldTraits<T, std::enable_if_t<std::is_arithmetic<T>::value>> {
+            /// \brief
+            /// Fixed binary size.
+            static constexpr std::size_t SIZE = Serializer::Size (T ());
+
+            /// \brief
+            /// Return the binary size of the given value.
+            /// \return Binary size of the given value.
+            static constexpr std::size_t Size (T /*value*/) {
+                return SIZE;
+            }
+            /// \brief
+            /// Read the value from the given serializer.
+            /// \param[in] serializer \see{Serializer} to read the value from.
+            /// \param[out] value Value to read.
+            static void Read (
+                    Serializer &serializer,
+                    T &value) {
+                serializer >> value;
+            }
+            /// \brief
+            /// Write the value to the given serializer.
+            /// \param[out] serializer \see{Serializer} to write the value to.
+            /// \param[in] value Value to write.
+            static void Write (
+                    Serializer &serializer,
+                    T value) {
+                serializer << value;
+            }
+
+            /// \brief
+            /// Read the value from the given XML node attribute.
+            /// \param[in] node XML node to read the value from.
+            /// \param[in] name Attribute name.
+            /// \param[out] value Value to read.
+            static void ReadXML (
+                    const pugi::xml_node &node,
+                    const char *name,
+                    T &value) {
+                value = FromString (node.attribute (name).value ());
+            }
+            /// \brief
+            /// Write the value to the given XML node attribute.
+            /// \param[out] node XML node to write the value to.
+            /// \param[in] name Attribute name.
+            /// \param[in] value Value to write.
+            static void WriteXML (
+                    pugi::xml_node &node,
+                    const char *name,
+                    T value) {
+                node.append_attribute (name).set_value (ToString (value).c_str ());
+            }
+
+            /// \brief
+            /// Read the value from the given JSON object.
+            /// \param[in] object JSON object to read the value from.
+            /// \param[in] name Value name.
+            /// \param[out] value Value to read.
+            static void ReadJSON (
+                    const JSON::Object &object,
+                    const char *name,
+                    T &value) {
+                if constexpr (std::is_same<T, bool>::value) {
+                    value = object.Get<JSON::Bool> (name)->value;
+                }
+                else {
+                    value = object.Get<JSON::Number> (name)->To<T> ();
+                }
+            }
+            /// \brief
+            /// Write the value to the given JSON object.
+            /// \param[out] object JSON object to write the value to.
+            /// \param[in] name Value name.
+            /// \param[in] value Value to write.
+            static void WriteJSON (
+                    JSON::Object &object,
+                    const char *name,
+                    T value) {
+                object.Add (name, value);
+            }
+
+        private:
+            /// \brief
+            /// Format the given value using the StringUtils formatters.
+            /// \param[in] value Value to format.
+            /// \return Formatted value.
+            static std::string ToString (T value) {
+                if constexpr (std::is_same<T, bool>::value) {
+                    return boolTostring (value);
+                }
+                else if constexpr (std::is_floating_point<T>::value) {
+                    return sizeof (T) == F32_SIZE ? f32Tostring ((f32)value) : f64Tostring ((f64)value);
+                }
+                else if constexpr (std::is_signed<T>::value) {
+                    return sizeof (T) <= I32_SIZE ? i32Tostring ((i32)value) : i64Tostring ((i64)value);
+                }
+                else {
+                    return sizeof (T) <= UI32_SIZE ? ui32Tostring ((ui32)value) : ui64Tostring ((ui64)value);
+                }
+            }
+            /// \brief
+            /// Parse the given value using the StringUtils parsers.
+            /// \param[in] value Value to parse.
+            /// \return Parsed value.
+            static T FromString (const char *value) {
+                if constexpr (std::is_same<T, bool>::value) {
+                    return stringTobool (value);
+                }
+                else if constexpr (std::is_floating_point<T>::value) {
+                    return sizeof (T) == F32_SIZE ? (T)stringTof32 (value) : (T)stringTof64 (value);
+                }
+                else if constexpr (std::is_signed<T>::value) {
+                    return sizeof (T) <= I32_SIZE ? (T)stringToi32 (value) : (T)stringToi64 (value);
+                }
+                else {
+                    return sizeof (T) <= UI32_SIZE ? (T)stringToui32 (value) : (T)stringToui64 (value);
+                }
+            }
+        };
+
+        /// \struct FieldTraits<std::string> SerializableFields.h thekogans/util/SerializableFields.h
+        ///
+        /// \brief
+        /// FieldTraits for std::string fields.
+        /// XML stores them as attributes, JSON as strings.
+        template<>
+        struct FieldTraits<std::string> {
+            /// \brief
+            /// Variable binary size.
+            static constexpr std::size_t SIZE = 0;
+
+            /// \brief
+            /// Return the binary size of the given value.
+            /// \return Binary size of the given value.
+            static std::size_t Size (const std::string &value) {
+                return Serializer::Size (value);
+            }
+            /// \brief
+            /// Read the value from the given serializer.
+            /// \param[in] serializer \see{Serializer} to read the value from.
+            /// \param[out] value Value to read.
+            static void Read (
+                    Serializer &serializer,
+                    std::string &value) {
+                serializer >> value;
+            }
+            /// \brief
+            /// Write the value to the given serializer.
+            /// \param[out] serializer \see{Serializer} to write the value to.
+            /// \param[in] value Value to write.
+            static void Write (
+                    Serializer &serializer,
+                    const std::string &value) {
+                serializer << value;
+            }
+
+            /// \brief
+            /// Read the value from the given XML node attribute.
+            /// \param[in] node XML node to read the value from.
+            /// \param[in] name Attribute name.
+            /// \param[out] value Value to read.
+            static void ReadXML (
+                    const pugi::xml_node &node,
+                    const char *name,
+                    std::string &value) {
+                value = node.attribute (name).value ();
+            }
+            /// \brief
+            /// Write the value to the given XML node attribute.
+            /// \param[out] node XML node to write the value to.
+            /// \param[in] name Attribute name.
+            /// \param[in] value Value to write.
+            static void WriteXML (
+                    pugi::xml_node &node,
+                    const char *name,
+                    const std::string &value) {
+                node.append_attribute (name).set_value (value.c_str ());
+            }
+
+            /// \brief
+            /// Read the value from the given JSON object.
+            /// \param[in] object JSON object to read the value from.
+            /// \param[in] name Value name.
+            /// \param[out] value Value to read.
+            static void ReadJSON (
+                    const JSON::Object &object,
+                    const char *name,
+                    std::string &value) {
+                value = object.Get<JSON::String> (name)->value;
+            }
+            /// \brief
+            /// Write the value to the given JSON object.
+            /// \param[out] object JSON object to write the value to.
+            /// \param[in] name Value name.
+            /// \param[in] value Value to write.
+            static void WriteJSON (
+                    JSON::Object &object,
+                    const char *name,
+                    const std::string &value) {
+                object.Add<const std::string &> (name, value);
+            }
+        };
+
+        /// \struct EncodedStringFieldTraits SerializableFields.h thekogans/util/SerializableFields.h
+        ///
+        /// \brief
+        /// Traits for free form std::string fields (names, descriptions...).
+        /// Same as FieldTraits<std::string>, except XML attributes are stored
+        /// URI encoded (\see{Encodestring}/\see{Decodestring}).
+        struct EncodedStringFieldTraits : public FieldTraits<std::string> {
+            /// \brief
+            /// Read and decode the value from the given XML node attribute.
+            /// \param[in] node XML node to read the value from.
+            /// \param[in] name Attribute name.
+            /// \param[out] value Value to read.
+            static void ReadXML (
+                    const pugi::xml_node &node,
+                    const char *name,
+                    std::string &value) {
+                value = Decodestring (node.attribute (name).value ());
+            }
+            /// \brief
+            /// Encode and write the value to the given XML node attribute.
+            /// \param[out] node XML node to write the value to.
+            /// \param[in] name Attribute name.
+            /// \param[in] value Value to write.
+            static void WriteXML (
+                    pugi::xml_node &node,
+                    const char *name,
+                    const std::string &value) {
+                node.append_attribute (name).set_value (Encodestring (value).c_str ());
+            }
+        };
+
+        /// \struct FieldTraits<SizeT> SerializableFields.h thekogans/util/SerializableFields.h
+        ///
+        /// \brief
+        /// FieldTraits for \see{SizeT} fields.
+        /// XML stores them as attributes, JSON as numbers.
+        template<>
+        struct FieldTraits<SizeT> {
+            /// \brief
+            /// Variable binary size.
+            static constexpr std::size_t SIZE = 0;
+
+            /// \brief
+            /// Return the binary size of the given value.
+            /// \return Binary size of the given value.
+            static std::size_t Size (const SizeT &value) {
+                return value.Size ();
+            }
+            /// \brief
+            /// Read the value from the given serializer.
+            /// \param[in] serializer \see{Serializer} to read the value from.
+            /// \param[out] value Value to read.
+            static void Read (
+                    Serializer &serializer,
+                    SizeT &value) {
+                serializer >> value;
+            }
+            /// \brief
+            /// Write the value to the given serializer.
+            /// \param[out] serializer \see{Serializer} to write the value to.
+            /// \param[in] value Value to write.
+            static void Write (
+                    Serializer &serializer,
+                    const SizeT &value) {
+                serializer << value;
+            }
+
+            /// \brief
+            /// Read the value from the given XML node attribute.
+            /// \param[in] node XML node to read the value from.
+            /// \param[in] name Attribute name.
+            /// \param[out] value Value to read.
+            static void ReadXML (
+                    const pugi::xml_node &node,
+                    const char *name,
+                    SizeT &value) {
+                value = stringTosize_t (node.attribute (name).value ());
+            }
+            /// \brief
+            /// Write the value to the given XML node attribute.
+            /// \param[out] node XML node to write the value to.
+            /// \param[in] name Attribute name.
+            /// \param[in] value Value to write.
+            static void WriteXML (
+                    pugi::xml_node &node,
+                    const char *name,
+                    const SizeT &value) {
+                node.append_attribute (name).set_value (size_tTostring (value).c_str ());
+            }
+
+            /// \brief
+            /// Read the value from the given JSON object.
+            /// \param[in] object JSON object to read the value from.
+            /// \param[in] name Value name.
+            /// \param[out] value Value to read.
+            static void ReadJSON (
+                    const JSON::Object &object,
+                    const char *name,
+                    SizeT &value) {
+                value = object.Get<JSON::Number> (name)->To<SizeT> ();
+            }
+            /// \brief
+            /// Write the value to the given JSON object.
+            /// \param[out] object JSON object to write the value to.
+            /// \param[in] name Value name.
+            /// \param[in] value Value to write.
+            static void WriteJSON (
+                    JSON::Object &object,
+                    const char *name,
+                    const SizeT &value) {
+                object.Add<const SizeT &> (name, value);
+            }
+        };
+
+        /// \struct FieldTraits<T, std::enable_if_t<std::is_base_of<Serializable, T>::value>>
+        ///     SerializableFields.h thekogans/util/SerializableFields.h
+        ///
+        /// \brief
+        /// FieldTraits for nested \see{Serializable} fields. They are written
+        /// (header and all) using the \see{Serializable} insertion operators.
+        /// XML stores them as child elements, JSON as objects. Both are
+        /// optional on read.
+        template<typename T>
+        struct FieldTraits<T, std::enable_if_t<std::is_base_of<Serializable, T>::value>> {
+            /// \brief
+            /// Variable binary size (the header is variable size).
+            static constexpr std::size_t SIZE = 0;
+
+            /// \brief
+            /// Return the binary size of the given value (including the header).
+            /// \return Binary size of the given value.
+            static std::size_t Size (const T &value) {
+                return value.GetSize ();
+            }
+            /// \brief
+            /// Read the value from the given serializer.
+            /// \param[in] serializer \see{Serializer} to read the value from.
+            /// \param[out] value Value to read.
+            static void Read (
+                    Serializer &serializer,
+                    T &value) {
+                serializer >> value;
+            }
+            /// \brief
+            /// Write the value to the given serializer.
+            /// \param[out] serializer \see{Serializer} to write the value to.
+            /// \param[in] value Value to write.
+            static void Write (
+                    Serializer &serializer,
+                    const T &value) {
+                serializer << value;
+            }
+
+            /// \brief
+            /// Read the value from the given XML node child.
+            /// \param[in] node XML node to read the value from.
+            /// \param[in] name Child name.
+            /// \param[out] value Value to read.
+            static void ReadXML (
+                    const pugi::xml_node &node,
+                    const char *name,
+                    T &value) {
+                pugi::xml_node child = node.child (name);
+                if (!child.empty ()) {
+                    child >> value;
+                }
+            }
+            /// \brief
+            /// Write the value to the given XML node child.
+            /// \param[out] node XML node to write the value to.
+            /// \param[in] name Child name.
+            /// \param[in] value Value to write.
+            static void WriteXML (
+                    pugi::xml_node &node,
+                    const char *name,
+                    const T &value) {
+                pugi::xml_node child = node.append_child (name);
+                child << value;
+            }
+
+            /// \brief
+            /// Read the value from the given JSON object.
+            /// \param[in] object JSON object to read the value from.
+            /// \param[in] name Value name.
+            /// \param[out] value Value to read.
+            static void ReadJSON (
+                    const JSON::Object &object,
+                    const char *name,
+                    T &value) {
+                if (object.Contains (name)) {
+                    *object.Get<JSON::Object> (name) >> value;
+                }
+            }
+            /// \brief
+            /// Write the value to the given JSON object.
+            /// \param[out] object JSON object to write the value to.
+            /// \param[in] name Value name.
+            /// \param[in] value Value to write.
+            static void WriteJSON (
+                    JSON::Object &object,
+                    const char *name,
+                    const T &value) {
+                JSON::Object::SharedPtr child (new JSON::Object);
+                *child << value;
+                object.Add (name, child);
+            }
+        };
+
+        /// \struct FieldTraits<T, std::enable_if_t<detail::HasFields<T>::value &&
+        ///     !std::is_base_of<Serializable, T>::value>>
+        ///     SerializableFields.h thekogans/util/SerializableFields.h
+        ///
+        /// \brief
+        /// FieldTraits for nested (non \see{Serializable}) types with
+        /// their own field descriptors (\see{Rectangle::origin}...).
+        /// Binary is the nested fields, back to back. XML stores them
+        /// as child elements, JSON as objects. Both are optional on read.
+        template<typename T>
+        struct FieldTraits<
+                T,
+                std::enable_if_t<detail::HasFields<T>::value &&
+                    !std::is_base_of<Serializable, T>::value>> {
+            /// \brief
+            /// Fixed binary size (0 == variable size).
+            static constexpr std::size_t SIZE = SerializableFields<T>::SIZE;
+
+            /// \brief
+            /// Return the binary size of the given value.
+            /// \return Binary size of the given value.
+            static std::size_t Size (const T &value) {
+                return SerializableFields<T>::Size (value);
+            }
+            /// \brief
+            /// Read the value from the given serializer.
+            /// \param[in] serializer \see{Serializer} to read the value from.
+            /// \param[out] value Value to read.
+            static void Read (
+                    Serializer &serializer,
+                    T &value) {
+                SerializableFields<T>::Read (serializer, value);
+            }
+            /// \brief
+            /// Write the value to the given serializer.
+            /// \param[out] serializer \see{Serializer} to write the value to.
+            /// \param[in] value Value to write.
+            static void Write (
+                    Serializer &serializer,
+                    const T &value) {
+                SerializableFields<T>::Write (serializer, value);
+            }
+
+            /// \brief
+            /// Read the value from the given XML node child.
+            /// \param[in] node XML node to read the value from.
+            /// \param[in] name Child name.
+            /// \param[out] value Value to read.
+            static void ReadXML (
+                    const pugi::xml_node &node,
+                    const char *name,
+                    T &value) {
+                pugi::xml_node child = node.child (name);
+                if (!child.empty ()) {
+                    SerializableFields<T>::ReadXML (child, value);
+                }
+            }
+            /// \brief
+            /// Write the value to the given XML node child.
+            /// \param[out] node XML node to write the value to.
+            /// \param[in] name Child name.
+            /// \param[in] value Value to write.
+            static void WriteXML (
+                    pugi::xml_node &node,
+                    const char *name,
+                    const T &value) {
+                pugi::xml_node child = node.append_child (name);
+                SerializableFields<T>::WriteXML (child, value);
+            }
+
+            /// \brief
+            /// Read the value from the given JSON object.
+            /// \param[in] object JSON object to read the value from.
+            /// \param[in] name Value name.
+            /// \param[out] value Value to read.
+            static void ReadJSON (
+                    const JSON::Object &object,
+                    const char *name,
+                    T &value) {
+                if (object.Contains (name)) {
+                    SerializableFields<T>::ReadJSON (*object.Get<JSON::Object> (name), value);
+                }
+            }
+            /// \brief
+            /// Write the value to the given JSON object.
+            /// \param[out] object JSON object to write the value to.
+            /// \param[in] name Value name.
+            /// \param[in] value Value to write.
+            static void WriteJSON (
+                    JSON::Object &object,
+                    const char *name,
+                    const T &value) {
+                JSON::Object::SharedPtr child (new JSON::Object);
+                SerializableFields<T>::WriteJSON (*child, value);
+                object.Add (name, child);
+            }
+        };
+
+    } // namespace util
+} // namespace thekogans
+
+#endif // !defined (__thekogans_util_SerializableFields_h)
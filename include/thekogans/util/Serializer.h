@@ -20,12 +20,15 @@
 
 #include <cstring>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <list>
 #include <map>
+#include <type_traits>
 #include "thekogans/util/Config.h"
 #include "thekogans/util/Types.h"
 #include "thekogans/util/ByteSwap.h"
+#include "thekogans/util/ByteView.h"
 #include "thekogans/util/SizeT.h"
 #include "thekogans/util/DynamicCreatable.h"
 #include "thekogans/util/SerializableHeader.h"
@@ -38,6 +41,9 @@ namespace thekogans {
         /// \brief
         /// Forward declaration of \see{Serializable}.
         struct Serializable;
+        /// \brief
+        /// Forward declaration of \see{Buffer}.
+        struct Buffer;
 
         /// \struct Serializer Serializer.h thekogans/util/Serializer.h
         ///
@@ -74,6 +80,14 @@ namespace thekogans {
         ///         path.c_str ());
         /// }
         /// \endcode
+        ///
+        /// Serializer has an opt-in compact mode (see compact below) that trades
+        /// a little CPU for a lot less bandwidth when most integers are small.
+        ///
+        /// Memory backed serializers (\see{Buffer}) can also hand out views
+        /// (std::string_view, \see{ByteView}) in to their memory instead of
+        /// copying (see borrow below). Large read-only payloads can then be
+        /// parsed without copying a single byte.
         struct _LIB_THEKOGANS_UTIL_DECL Serializer : public DynamicCreatable {
             /// \brief
             /// Serializer is a \see{util::DynamicCreatable} abstract base.
@@ -93,6 +107,22 @@ namespace thekogans {
             /// Serializer endianness (LittleEndian or BigEndian).
             Endianness endianness;
             /// \brief
+            /// true == 16, 32 and 64 bit integers are written as variable length
+            /// integers (\see{SizeT} encoding, zigzag encoded if signed) instead
+            /// of at full width. Both ends must agree. Off by default.
+            /// NOTE: The static Size functions below always return the full
+            /// width sizes. When inserting a \see{Serializable} in compact mode,
+            /// its size (\see{SerializableHeader::size}) is measured instead.
+            bool compact;
+            /// \brief
+            /// true == when extracting from a memory backed serializer (\see{Buffer}),
+            /// \see{Buffer}s and \see{Blob}s wrap the serializer's memory instead of
+            /// copying it. \see{Serializable}s with view members (std::string_view,
+            /// \see{ByteView}) should check it to decide whether to borrow or to own.
+            /// Off by default, as the extracted values are only valid for as long as
+            /// the serializer's memory is.
+            bool borrow;
+            /// \brief
             /// Current governing \see{SerializableHeader} for
             /// \see{Serializable} insertion/extraction.
             SerializableHeader context;
@@ -149,11 +179,50 @@ namespace thekogans {
                 }
             };
 
+        protected:
+            /// \brief
+            /// If not nullptr, the \see{Buffer} holding this serializer's data
+            /// (set by \see{Buffer} itself). Fixed size values (bool, integers,
+            /// floats...) are then copied straight out of its memory instead of
+            /// going through the virtual Read, and extracted views borrow from it.
+            /// Derivatives of \see{Buffer} that override Read must set it to nullptr.
+            Buffer *readMemory;
+            /// \brief
+            /// Same as readMemory, but for insertion (bypasses the virtual Write).
+            /// Derivatives of \see{Buffer} that override Write must set it to
+            /// nullptr (\see{TenantReadBuffer} does).
+            Buffer *writeMemory;
+
+        public:
             /// \brief
             /// ctor.
             /// \param[in] endianness Serializer endianness.
             Serializer (Endianness endianness_ = HostEndian) :
-                endianness (endianness_) {}
+                endianness (endianness_),
+                compact (false),
+                borrow (false),
+                readMemory (nullptr),
+                writeMemory (nullptr) {}
+
+        protected:
+            /// \brief
+            /// ctor for memory backed serializers.
+            /// \param[in] endianness Serializer endianness.
+            /// \param[in] readMemory_ \see{Buffer} holding the serializer's data
+            /// (nullptr == extract through Read).
+            /// \param[in] writeMemory_ \see{Buffer} holding the serializer's data
+            /// (nullptr == insert through Write).
+            Serializer (
+                Endianness endianness_,
+                Buffer *readMemory_,
+                Buffer *writeMemory_) :
+                endianness (endianness_),
+                compact (false),
+                borrow (false),
+                readMemory (readMemory_),
+                writeMemory (writeMemory_) {}
+
+        public:
 
             /// \brief
             /// Read raw bytes.
@@ -179,11 +248,62 @@ namespace thekogans {
                 return ENDIANNESS_SIZE;
             }
 
+            /// \brief
+            /// Return the number of bytes that can be written before a memory
+            /// backed serializer (\see{Buffer}) runs out of room. Used to check
+            /// a \see{Serializable} once instead of failing half way through it.
+            /// \return Number of bytes that can be written (SIZE_T_MAX if
+            /// the serializer is not memory backed).
+            std::size_t GetWriteCapacity () const;
+
+            /// \brief
+            /// Return true if extracted values should borrow (point in to)
+            /// the serializer's memory instead of copying it (see borrow above).
+            /// \return true == borrow is set and the serializer is memory backed.
+            inline bool IsBorrowing () const {
+                return borrow && readMemory != nullptr;
+            }
+            /// \brief
+            /// Borrow the next count bytes from a memory backed serializer
+            /// (\see{Buffer}) and advance past them. No bytes are copied.
+            /// Throws if the serializer is not memory backed or is short.
+            /// \param[in] count Number of bytes to borrow.
+            /// \return \see{ByteView} of the borrowed bytes.
+            ByteView Borrow (std::size_t count);
+
+            /// \brief
+            /// Return true if values of type T are written as variable
+            /// length integers in compact mode.
+            /// \return true if values of type T are written as variable
+            /// length integers in compact mode.
+            template<typename T>
+            static constexpr bool IsCompactType () {
+                return std::is_integral<T>::value &&
+                    !std::is_same<T, bool>::value &&
+                    !std::is_same<T, wchar_t>::value &&
+                    sizeof (T) >= I16_SIZE && sizeof (T) <= I64_SIZE;
+            }
+            /// \brief
+            /// Return true if arrays of type T can be written (read) with
+            /// a single Write (Read), byte swapping the whole array in one
+            /// go (\see{ByteSwapArray}) if the endianness calls for it.
+            /// \return true if arrays of type T can be written (read) in bulk.
+            template<typename T>
+            static constexpr bool IsBulkType () {
+                return std::is_arithmetic<T>::value &&
+                    !std::is_same<T, bool>::value &&
+                    !std::is_same<T, wchar_t>::value &&
+                    (sizeof (T) == UI8_SIZE || sizeof (T) == UI16_SIZE ||
+                        sizeof (T) == UI32_SIZE || sizeof (T) == UI64_SIZE);
+            }
+
             /// \brief
             /// std::swap for Serializer.
             /// \param[in,out] other Serializer to swap.
             inline void swap (Serializer &other) {
                 std::swap (endianness, other.endianness);
+                std::swap (compact, other.compact);
+                std::swap (borrow, other.borrow);
             }
 
             // Binary Insertion/Extraction API.
@@ -319,6 +439,52 @@ namespace thekogans {
             /// \return *this.
             Serializer &operator >> (std::string &value);
 
+            /// \brief
+            /// Return serialized size of std::string_view.
+            /// \param[in] value std::string_view whose size to return.
+            /// \return Serialized size of std::string_view.
+            static std::size_t Size (std::string_view value) {
+                return SizeT (value.size ()).Size () + value.size ();
+            }
+
+            /// \brief
+            /// Serialize a std::string_view (same wire format as std::string).
+            /// \param[in] value Value to serialize.
+            /// \return *this.
+            Serializer &operator << (std::string_view value);
+            /// \brief
+            /// Extract a std::string (serialized as above) as a std::string_view
+            /// pointing in to the serializer's memory. No bytes are copied.
+            /// NOTE: Only memory backed serializers (\see{Buffer}) can do this.
+            /// The view is valid for as long as the \see{Buffer} is alive and
+            /// unmodified.
+            /// \param[out] value Where to place the extracted std::string_view.
+            /// \return *this.
+            Serializer &operator >> (std::string_view &value);
+
+            /// \brief
+            /// Return serialized size of \see{ByteView}.
+            /// \param[in] value \see{ByteView} whose size to return.
+            /// \return Serialized size of \see{ByteView}.
+            static std::size_t Size (const ByteView &value) {
+                return SizeT (value.size ()).Size () + value.size ();
+            }
+
+            /// \brief
+            /// Serialize a \see{ByteView} (same wire format as std::vector<ui8>).
+            /// \param[in] value Value to serialize.
+            /// \return *this.
+            Serializer &operator << (const ByteView &value);
+            /// \brief
+            /// Extract a std::vector<ui8> (serialized as above) as a \see{ByteView}
+            /// pointing in to the serializer's memory. No bytes are copied.
+            /// NOTE: Only memory backed serializers (\see{Buffer}) can do this.
+            /// The view is valid for as long as the \see{Buffer} is alive and
+            /// unmodified.
+            /// \param[out] value Where to place the extracted \see{ByteView}.
+            /// \return *this.
+            Serializer &operator >> (ByteView &value);
+
             /// \brief
             /// Return serialized size of wide c-string.
             /// \param[in] value Wide c-string whose size to return.
@@ -626,6 +792,9 @@ namespace thekogans {
             template<typename T>
             static std::size_t Size (const std::vector<T> &value) {
                 std::size_t size = SizeT (value.size ()).Size ();
+                if constexpr (IsBulkType<T> ()) {
+                    return size + value.size () * sizeof (T);
+                }
                 for (std::size_t i = 0, count = value.size (); i < count; ++i) {
                     size += Size (value[i]);
                 }
@@ -634,12 +803,19 @@ namespace thekogans {
 
             /// \brief
             /// Serialize a const std::vector<T>. endianness is used to properly
-            /// convert between serializer and host byte order.
+            /// convert between serializer and host byte order. Vectors of
+            /// arithmetic types (\see{IsBulkType}) are written in bulk.
             /// \param[in] value Value to serialize.
             /// \return *this.
             template<typename T>
             inline Serializer &operator << (const std::vector<T> &value) {
                 *this << SizeT (value.size ());
+                if constexpr (IsBulkType<T> ()) {
+                    if (!compact || !IsCompactType<T> ()) {
+                        WriteArray (value.data (), sizeof (T), value.size ());
+                        return *this;
+                    }
+                }
                 for (std::size_t i = 0, count = value.size (); i < count; ++i) {
                     *this << value[i];
                 }
@@ -647,7 +823,8 @@ namespace thekogans {
             }
             /// \brief
             /// Extract a std::vector<T>. endianness is used to properly
-            /// convert between serializer and host byte order.
+            /// convert between serializer and host byte order. Vectors of
+            /// arithmetic types (\see{IsBulkType}) are read in bulk.
             /// \param[out] value Where to place the extracted value.
             /// \return *this.
             template<typename T>
@@ -655,6 +832,13 @@ namespace thekogans {
                 SizeT count;
                 *this >> count;
                 std::vector<T> temp (count);
+                if constexpr (IsBulkType<T> ()) {
+                    if (!compact || !IsCompactType<T> ()) {
+                        ReadArray (temp.data (), sizeof (T), count);
+                        value.swap (temp);
+                        return *this;
+                    }
+                }
                 for (std::size_t i = 0; i < count; ++i) {
                     *this >> temp[i];
                 }
@@ -772,12 +956,83 @@ namespace thekogans {
                 return *this;
             }
 
+            /// \brief
+            /// NOTE: The following overloads (16, 32 and 64 bit integers) are
+            /// also for performance. In compact mode, memory backed serializers
+            /// (\see{Buffer}) encode (decode) the whole vector in one tight loop
+            /// straight in to (out of) their memory. Outside of compact mode
+            /// they are written (read) in bulk, like the templates above.
+
+            /// \brief
+            /// Serialize a const std::vector<i16>.
+            /// \param[in] value Value to serialize.
+            /// \return *this.
+            Serializer &operator << (const std::vector<i16> &value);
+            /// \brief
+            /// Extract a std::vector<i16>.
+            /// \param[out] value Where to place the extracted value.
+            /// \return *this.
+            Serializer &operator >> (std::vector<i16> &value);
+            /// \brief
+            /// Serialize a const std::vector<ui16>.
+            /// \param[in] value Value to serialize.
+            /// \return *this.
+            Serializer &operator << (const std::vector<ui16> &value);
+            /// \brief
+            /// Extract a std::vector<ui16>.
+            /// \param[out] value Where to place the extracted value.
+            /// \return *this.
+            Serializer &operator >> (std::vector<ui16> &value);
+            /// \brief
+            /// Serialize a const std::vector<i32>.
+            /// \param[in] value Value to serialize.
+            /// \return *this.
+            Serializer &operator << (const std::vector<i32> &value);
+            /// \brief
+            /// Extract a std::vector<i32>.
+            /// \param[out] value Where to place the extracted value.
+            /// \return *this.
+            Serializer &operator >> (std::vector<i32> &value);
+            /// \brief
+            /// Serialize a const std::vector<ui32>.
+            /// \param[in] value Value to serialize.
+            /// \return *this.
+            Serializer &operator << (const std::vector<ui32> &value);
+            /// \brief
+            /// Extract a std::vector<ui32>.
+            /// \param[out] value Where to place the extracted value.
+            /// \return *this.
+            Serializer &operator >> (std::vector<ui32> &value);
+            /// \brief
+            /// Serialize a const std::vector<i64>.
+            /// \param[in] value Value to serialize.
+            /// \return *this.
+            Serializer &operator << (const std::vector<i64> &value);
+            /// \brief
+            /// Extract a std::vector<i64>.
+            /// \param[out] value Where to place the extracted value.
+            /// \return *this.
+            Serializer &operator >> (std::vector<i64> &value);
+            /// \brief
+            /// Serialize a const std::vector<ui64>.
+            /// \param[in] value Value to serialize.
+            /// \return *this.
+            Serializer &operator << (const std::vector<ui64> &value);
+            /// \brief
+            /// Extract a std::vector<ui64>.
+            /// \param[out] value Where to place the extracted value.
+            /// \return *this.
+            Serializer &operator >> (std::vector<ui64> &value);
+
             /// \brief
             /// Return serialized size of const \see{SecureVector}<T> &.
             /// \return Serialized size of const \see{SecureVector}<T> &.
             template<typename T>
             static std::size_t Size (const SecureVector<T> &value) {
                 std::size_t size = SizeT (value.size ()).Size ();
+                if constexpr (IsBulkType<T> ()) {
+                    return size + value.size () * sizeof (T);
+                }
                 for (std::size_t i = 0, count = value.size (); i < count; ++i) {
                     size += Size (value[i]);
                 }
@@ -786,12 +1041,19 @@ namespace thekogans {
 
             /// \brief
             /// Serialize a const \see{SecureVector}<T>. endianness is used to properly
-            /// convert between serializer and host byte order.
+            /// convert between serializer and host byte order. Vectors of
+            /// arithmetic types (\see{IsBulkType}) are written in bulk.
             /// \param[in] value Value to serialize.
             /// \return *this.
             template<typename T>
             inline Serializer &operator << (const SecureVector<T> &value) {
                 *this << SizeT (value.size ());
+                if constexpr (IsBulkType<T> ()) {
+                    if (!compact || !IsCompactType<T> ()) {
+                        WriteArray (value.data (), sizeof (T), value.size ());
+                        return *this;
+                    }
+                }
                 for (std::size_t i = 0, count = value.size (); i < count; ++i) {
                     *this << value[i];
                 }
@@ -799,7 +1061,8 @@ namespace thekogans {
             }
             /// \brief
             /// Extract a \see{SecureVector}<T>. endianness is used to properly
-            /// convert between serializer and host byte order.
+            /// convert between serializer and host byte order. Vectors of
+            /// arithmetic types (\see{IsBulkType}) are read in bulk.
             /// \param[out] value Where to place the extracted value.
             /// \return *this.
             template<typename T>
@@ -807,6 +1070,13 @@ namespace thekogans {
                 SizeT count;
                 *this >> count;
                 SecureVector<T> temp (count);
+                if constexpr (IsBulkType<T> ()) {
+                    if (!compact || !IsCompactType<T> ()) {
+                        ReadArray (temp.data (), sizeof (T), count);
+                        value.swap (temp);
+                        return *this;
+                    }
+                }
                 for (std::size_t i = 0; i < count; ++i) {
                     *this >> temp[i];
                 }
@@ -1026,6 +1296,66 @@ namespace thekogans {
                 value.swap (temp);
                 return *this;
             }
+
+        private:
+            /// \brief
+            /// Write a fixed size value (already in serializer byte order).
+            /// Memory backed serializers skip the virtual Write.
+            /// \param[in] value Value to write.
+            template<typename T>
+            void WriteFixedValue (const T &value);
+            /// \brief
+            /// Read a fixed size value (in serializer byte order).
+            /// Memory backed serializers skip the virtual Read.
+            /// \param[out] value Where to place the value.
+            template<typename T>
+            void ReadFixedValue (T &value);
+            /// \brief
+            /// Write a compact mode (\see{SizeT} encoded) value.
+            /// \param[in] value Value to write.
+            void WriteCompactValue (ui64 value);
+            /// \brief
+            /// Read a compact mode (\see{SizeT} encoded) value.
+            /// \param[in] maxValue Largest value the destination can hold.
+            /// \return The value.
+            ui64 ReadCompactValue (ui64 maxValue);
+            /// \brief
+            /// Write an array of count size byte values with a single Write.
+            /// Byte swaps the whole array if the endianness calls for it
+            /// (straight in to a memory backed serializer's memory if it fits).
+            /// \param[in] values Values to write.
+            /// \param[in] size Size of each value (1, 2, 4 or 8).
+            /// \param[in] count Number of values to write.
+            void WriteArray (
+                const void *values,
+                std::size_t size,
+                std::size_t count);
+            /// \brief
+            /// Read an array of count size byte values with a single Read.
+            /// Byte swaps the whole array if the endianness calls for it.
+            /// \param[out] values Where to place the values.
+            /// \param[in] size Size of each value (1, 2, 4 or 8).
+            /// \param[in] count Number of values to read.
+            void ReadArray (
+                void *values,
+                std::size_t size,
+                std::size_t count);
+            /// \brief
+            /// Write an array of 16, 32 or 64 bit integers.
+            /// \param[in] values Values to write.
+            /// \param[in] count Number of values to write.
+            template<typename T>
+            void WriteIntegers (
+                const T *values,
+                std::size_t count);
+            /// \brief
+            /// Read an array of 16, 32 or 64 bit integers.
+            /// \param[out] values Where to place the values.
+            /// \param[in] count Number of values to read.
+            template<typename T>
+            void ReadIntegers (
+                T *values,
+                std::size_t count);
         };
 
     } // namespace util
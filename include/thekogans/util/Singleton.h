@@ -258,6 +258,44 @@ namespace thekogans {
             }
         };
 
+        /// \struct ShardedRefCountedInstanceCreator Singleton.h thekogans/util/Singleton.h
+        ///
+        /// \brief
+        /// Creates a \see{RefCounted} singleton instance and switches it to sharded
+        /// reference counting (\see{RefCounted::EnableShardedRefCount}). Use it for
+        /// singletons whose Instance () is called from many threads at once. Only
+        /// the singleton instance is sharded, other instances of the same class
+        /// are reference counted (and destroyed) as usual. The reference the
+        /// instance holds on itself is released by \see{RefCountedInstanceDestroyer}.
+        ///
+        /// \code{.cpp}
+        /// struct _LIB_THEKOGANS_STREAM_DECL DefaultAllocator :
+        ///         public Allocator,
+        ///         public RefCountedSingleton<
+        ///             DefaultAllocator,
+        ///             SpinLock,
+        ///             ShardedRefCountedInstanceCreator<DefaultAllocator>> {
+        ///     ...
+        /// };
+        /// \endcode
+        template<typename T>
+        struct ShardedRefCountedInstanceCreator {
+            /// \brief
+            /// Returns RefCounted::SharedPtr<T> to instance.
+            using ReturnType = RefCounted::SharedPtr<T>;
+
+            /// \brief
+            /// Create the instance using the supplied ctor arguments.
+            /// \param[in] args List of arguments to the instance ctor.
+            /// \return Singleton instance.
+            template<typename... Args>
+            inline ReturnType operator () (Args... args) {
+                ReturnType instance (new T (std::forward<Args> (args)...));
+                instance->EnableShardedRefCount ();
+                return instance;
+            }
+        };
+
         /// \struct RefCountedInstanceDestroyer Singleton.h thekogans/util/Singleton.h
         ///
         /// \brief
@@ -275,8 +313,13 @@ namespace thekogans {
             /// \brief
             /// Destroy the singleton instance.
             /// \param[in] instance Singleton instance to destroy.
-            inline void operator () (typename RefCountedInstanceCreator<T>::ReturnType /*instance*/) {
-                // Nothing to do.
+            inline void operator () (typename RefCountedInstanceCreator<T>::ReturnType instance) {
+                // Sharded instances hold a reference on themselves
+                // (see RefCounted::EnableShardedRefCount). Let it go
+                // so that the instance can be destroyed.
+                if (instance != nullptr) {
+                    instance->DisableShardedRefCount ();
+                }
             }
         };
 
@@ -286,12 +329,13 @@ namespace thekogans {
         /// Convenience template for \see{RefCounted} singletons.
         template<
             typename T,
-            typename Lock = SpinLock>
+            typename Lock = SpinLock,
+            typename InstanceCreator = RefCountedInstanceCreator<T>>
         struct RefCountedSingleton :
             public Singleton<
                 T,
                 Lock,
-                RefCountedInstanceCreator<T>,
+                InstanceCreator,
                 RefCountedInstanceDestroyer<T>> {
         protected:
             /// \brief
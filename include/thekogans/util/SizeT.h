@@ -18,6 +18,7 @@
 #if !defined (__thekogans_util_SizeT_h)
 #define __thekogans_util_SizeT_h
 
+#include <cstring>
 #include <functional>
 #include "thekogans/util/Environment.h"
 #if defined (TOOLCHAIN_OS_Windows)
@@ -25,6 +26,7 @@
 #endif // defined (TOOLCHAIN_OS_Windows)
 #include "thekogans/util/Config.h"
 #include "thekogans/util/Types.h"
+#include "thekogans/util/ByteSwap.h"
 #include "thekogans/util/SpinLock.h"
 
 namespace thekogans {
@@ -67,7 +69,10 @@ namespace thekogans {
             /// Return the serialized size of the current value.
             /// \return Serialized size of the current value.
             inline std::size_t Size () const {
-                return (63 - __builtin_clzll (value | 1)) / 7 + 1;
+                // Values with the top bit set would come out as 10.
+                // They're stored as a 0 byte followed by a full ui64.
+                std::size_t size = (63 - __builtin_clzll (value | 1)) / 7 + 1;
+                return size < MAX_SIZE ? size : MAX_SIZE;
             }
 
             /// \brief
@@ -79,6 +84,63 @@ namespace thekogans {
                 return __builtin_ctz (firstByte | 0x100) + 1;
             }
 
+            /// \brief
+            /// Encode the given value. The first byte carries the total size
+            /// (number of trailing zero bits + 1). Values that need all 64 bits
+            /// are written as a 0 byte followed by the value in the given byte order.
+            /// \param[in] value Value to encode.
+            /// \param[out] bytes Where to place the encoded value (must have
+            /// room for at least MAX_SIZE bytes).
+            /// \param[in] endianness Byte order of the MAX_SIZE encoding.
+            /// \return Number of bytes used.
+            static inline std::size_t Encode (
+                    ui64 value,
+                    ui8 *bytes,
+                    Endianness endianness) {
+                std::size_t size = SizeT (value).Size ();
+                if (size < MAX_SIZE) {
+                    ui64 encoded = ((value << 1) | 1) << (size - 1);
+                    for (std::size_t i = 0; i < size; ++i) {
+                        bytes[i] = (ui8)(encoded & 0xff);
+                        encoded >>= 8;
+                    }
+                }
+                else {
+                    bytes[0] = 0;
+                    if (endianness == GuestEndian) {
+                        value = ByteSwap<HostEndian, GuestEndian> (value);
+                    }
+                    memcpy (bytes + 1, &value, UI64_SIZE);
+                }
+                return size;
+            }
+            /// \brief
+            /// Decode a value encoded with Encode.
+            /// \param[in] bytes Encoded value (must hold Size (bytes[0]) bytes).
+            /// \param[out] value Where to place the decoded value.
+            /// \param[in] endianness Byte order of the MAX_SIZE encoding.
+            /// \return Number of bytes consumed.
+            static inline std::size_t Decode (
+                    const ui8 *bytes,
+                    ui64 &value,
+                    Endianness endianness) {
+                std::size_t size = Size (bytes[0]);
+                if (size < MAX_SIZE) {
+                    ui64 encoded = 0;
+                    for (std::size_t i = size; i-- > 0;) {
+                        encoded = (encoded << 8) | bytes[i];
+                    }
+                    value = encoded >> size;
+                }
+                else {
+                    memcpy (&value, bytes + 1, UI64_SIZE);
+                    if (endianness == GuestEndian) {
+                        value = ByteSwap<GuestEndian, HostEndian> (value);
+                    }
+                }
+                return size;
+            }
+
             /// \brief
             /// Implicit typecast operator.
             /// WARNING: On some systems (notably i386), std::size_t == ui32. Casting
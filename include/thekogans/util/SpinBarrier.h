@@ -0,0 +1,112 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_util_SpinBarrier_h)
+#define __thekogans_util_SpinBarrier_h
+
+#include "thekogans/util/Environment.h"
+#include <cstddef>
+#include <atomic>
+#include "thekogans/util/Config.h"
+#include "thekogans/util/Types.h"
+#include "thekogans/util/TimeSpec.h"
+#if !defined (TOOLCHAIN_OS_Linux)
+    #include "thekogans/util/Mutex.h"
+    #include "thekogans/util/Condition.h"
+#endif // !defined (TOOLCHAIN_OS_Linux)
+
+namespace thekogans {
+    namespace util {
+
+        /// \struct SpinBarrier SpinBarrier.h thekogans/util/SpinBarrier.h
+        ///
+        /// \brief
+        /// SpinBarrier is a sense reversing barrier for fine grained fork-join
+        /// (see \see{Vectorizer}). \see{Barrier} always goes through the kernel,
+        /// and when the work between two crossings is only a few microseconds,
+        /// the barrier costs more than the work. SpinBarrier counts arrivals
+        /// with one atomic decrement. The last thread to arrive resets the count
+        /// and flips the generation (the sense). Everyone else spins (with
+        /// \see{Thread::Backoff}) for at most maxSpinTime waiting for the flip,
+        /// and then parks. On Linux waiters park on a futex (the generation
+        /// word). Elsewhere they park on a \see{Condition}. The last thread
+        /// only makes a system call if somebody actually parked.
+
+        struct _LIB_THEKOGANS_UTIL_DECL SpinBarrier {
+            /// \brief
+            /// Default time to spin before parking (in microseconds).
+            static const i64 DEFAULT_MAX_SPIN_TIME = 50;
+
+        private:
+            /// \brief
+            /// Number of threads to wait for.
+            const ui32 count;
+            /// \brief
+            /// How long to spin before parking (in \see{HRTimer} ticks).
+            const ui64 maxSpinTime;
+            /// \brief
+            /// Number of threads that have yet to arrive in the current generation.
+            std::atomic<ui32> remaining;
+            /// \brief
+            /// Barrier generation (the sense). Incremented by the
+            /// last thread to arrive. On Linux it's also the futex word.
+            std::atomic<ui32> generation;
+            /// \brief
+            /// Number of threads parked (or about to park).
+            std::atomic<ui32> sleepers;
+        #if !defined (TOOLCHAIN_OS_Linux)
+            /// \brief
+            /// Synchronization mutex.
+            Mutex mutex;
+            /// \brief
+            /// Parked threads wait on this condition.
+            Condition condition;
+        #endif // !defined (TOOLCHAIN_OS_Linux)
+
+        public:
+            /// \brief
+            /// ctor.
+            /// \param[in] count_ Number of threads to synchronize.
+            /// \param[in] maxSpinTime_ How long to spin before parking.
+            explicit SpinBarrier (
+                std::size_t count_,
+                const TimeSpec &maxSpinTime_ =
+                    TimeSpec::FromMicroseconds (DEFAULT_MAX_SPIN_TIME));
+
+            /// \brief
+            /// Wait for all threads to enter the barrier.
+            /// \return true = last (signaling) thread, false = waiting thread.
+            bool Wait ();
+
+        private:
+            /// \brief
+            /// Park the calling thread until the generation moves past the given one.
+            /// \param[in] currGeneration Generation the calling thread arrived in.
+            void Park (ui32 currGeneration);
+            /// \brief
+            /// Wake up all parked threads.
+            void WakeAll ();
+
+            /// \brief
+            /// SpinBarrier is neither copy constructable, nor assignable.
+            THEKOGANS_UTIL_DISALLOW_COPY_AND_ASSIGN (SpinBarrier)
+        };
+
+    } // namespace util
+} // namespace thekogans
+
+#endif // !defined (__thekogans_util_SpinBarrier_h)
@@ -18,8 +18,10 @@
 #if !defined (__thekogans_util_SpinLock_h)
 #define __thekogans_util_SpinLock_h
 
+#include <string>
 #include "thekogans/util/Config.h"
 #include "thekogans/util/Types.h"
+#include "thekogans/util/LockProbe.h"
 
 namespace thekogans {
     namespace util {
@@ -29,6 +31,8 @@ namespace thekogans {
         /// \brief
         /// StorageSpinLock wraps a provided ui32 & so that it can be used
         /// with the rest of the util synchronization machinery.
+        /// On Linux, once spinning stops being cheap (see \see{Thread::Backoff})
+        /// waiters park on a futex instead of yielding their time slice in a loop.
         ///
         /// This implementation was adapted from:
         /// http://www.boost.org/doc/libs/1_53_0/doc/html/atomic/usage_examples.html
@@ -43,6 +47,9 @@ namespace thekogans {
             /// Locked.
             static const ui32 Locked = 1;
             /// \brief
+            /// Locked, and there might be threads parked on it (Linux only).
+            static const ui32 Contended = 2;
+            /// \brief
             /// Default max pause iterations before giving up the time slice.
             static const ui32 DEFAULT_MAX_PAUSE_BEFORE_YIELD = 16;
 
@@ -104,6 +111,11 @@ namespace thekogans {
             /// \brief
             /// SpinLock state.
             ui32 state;
+        #if defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+            /// \brief
+            /// \see{LockProfiler} probe.
+            LockProbe probe;
+        #endif // defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
 
         public:
             /// \brief
@@ -123,21 +135,54 @@ namespace thekogans {
             /// Try to acquire the lock.
             /// \return true = acquired, false = failed to acquire
             inline bool TryAcquire () {
+            #if defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+                if (StorageSpinLock::TryAcquire ()) {
+                    probe.TryAcquired ();
+                    return true;
+                }
+                return false;
+            #else // defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
                 return StorageSpinLock::TryAcquire ();
+            #endif // defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
             }
 
             /// \brief
             /// Acquire the lock.
             inline void Acquire () {
+            #if defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+                probe.Acquire (
+                    [this] () -> bool {
+                        return StorageSpinLock::TryAcquire ();
+                    },
+                    [this] () {
+                        StorageSpinLock::Acquire ();
+                    });
+            #else // defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
                 StorageSpinLock::Acquire ();
+            #endif // defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
             }
 
             /// \brief
             /// Release the lock.
             inline void Release () {
+            #if defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+                probe.Release ();
+            #endif // defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
                 StorageSpinLock::Release ();
             }
 
+            /// \brief
+            /// Name the lock so that it shows up in \see{LockProfiler} reports.
+            /// A no-op unless built with THEKOGANS_UTIL_USE_LOCK_PROFILER.
+            /// \param[in] name Lock name.
+        #if defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+            inline void SetProfilerName (const std::string &name) {
+                probe.SetName ("SpinLock", name);
+            }
+        #else // defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+            inline void SetProfilerName (const std::string & /*name*/) {}
+        #endif // defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+
             /// \brief
             /// SpinLock is neither copy constructable, nor assignable.
             THEKOGANS_UTIL_DISALLOW_COPY_AND_ASSIGN (SpinLock)
@@ -18,8 +18,10 @@
 #if !defined (__thekogans_util_SpinRWLock_h)
 #define __thekogans_util_SpinRWLock_h
 
+#include <string>
 #include "thekogans/util/Config.h"
 #include "thekogans/util/Types.h"
+#include "thekogans/util/LockProbe.h"
 
 namespace thekogans {
     namespace util {
@@ -105,6 +107,11 @@ namespace thekogans {
         private:
             /// Lock state.
             ui32 state;
+        #if defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+            /// \brief
+            /// \see{LockProfiler} probe.
+            LockProbe probe;
+        #endif // defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
 
         public:
             /// \brief
@@ -118,21 +125,55 @@ namespace thekogans {
             /// \param[in] read true = acqure for reading, acquire for writing.
             /// \return true = acquierd, false = failed to acquire.
             inline bool TryAcquire (bool read) {
+            #if defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+                if (StorageSpinRWLock::TryAcquire (read)) {
+                    probe.TryAcquired (read);
+                    return true;
+                }
+                return false;
+            #else // defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
                 return StorageSpinRWLock::TryAcquire (read);
+            #endif // defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
             }
             /// \brief
             /// Acquire the lock.
             /// \param[in] read true = acqure for reading, acquire for writing.
             inline void Acquire (bool read) {
+            #if defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+                probe.Acquire (
+                    [this, read] () -> bool {
+                        return StorageSpinRWLock::TryAcquire (read);
+                    },
+                    [this, read] () {
+                        StorageSpinRWLock::Acquire (read);
+                    },
+                    read);
+            #else // defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
                 StorageSpinRWLock::Acquire (read);
+            #endif // defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
             }
             /// \brief
             /// Release the lock.
             /// \param[in] read true = release for reading, release for writing.
             inline void Release (bool read) {
+            #if defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+                probe.Release (read);
+            #endif // defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
                 StorageSpinRWLock::Release (read);
             }
 
+            /// \brief
+            /// Name the lock so that it shows up in \see{LockProfiler} reports.
+            /// A no-op unless built with THEKOGANS_UTIL_USE_LOCK_PROFILER.
+            /// \param[in] name Lock name.
+        #if defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+            inline void SetProfilerName (const std::string &name) {
+                probe.SetName ("SpinRWLock", name);
+            }
+        #else // defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+            inline void SetProfilerName (const std::string & /*name*/) {}
+        #endif // defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+
             /// \brief
             /// SpinRWLock is neither copy constructable, nor assignable.
             THEKOGANS_UTIL_DISALLOW_COPY_AND_ASSIGN (SpinRWLock)
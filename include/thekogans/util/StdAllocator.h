@@ -33,7 +33,13 @@ namespace thekogans {
         /// StdAllocator is part of the \see{Allocator} framework.
         struct _LIB_THEKOGANS_UTIL_DECL StdAllocator :
                 public Allocator,
-                public RefCountedSingleton<StdAllocator> {
+                // Instance () is called on every (de)allocation from every
+                // thread. Keep the singleton's reference count off a shared
+                // cache line.
+                public RefCountedSingleton<
+                    StdAllocator,
+                    SpinLock,
+                    ShardedRefCountedInstanceCreator<StdAllocator>> {
             /// \brief
             /// StdAllocator participates in the \see{DynamicCreatable}
             /// dynamic discovery and creation.
@@ -60,6 +60,10 @@ namespace thekogans {
         /// is used by \see{MainRunLoop} to make sure the main thread is
         /// responsible for UI updates and other system notifications. But you
         /// can use SystemRunLoop in any thread that requires those facilities.
+        ///
+        /// NOTE: The os run loops only wake up when a job is enqueued, so they have
+        /// no way to come back for a throttled job. SystemRunLoop does not accept
+        /// a \see{RunLoop::RateLimitedJobExecutionPolicy}.
 
         template<typename OSRunLoopType = OSThreadRunLoopType>
         struct SystemRunLoop :
@@ -68,11 +72,17 @@ namespace thekogans {
             /// \brief
             /// ctor.
             /// \param[in] name \see{RunLoop} name.
-            /// \param[in] jobExecutionPolicy \see{RunLoop::JobExecutionPolicy}.
+            /// \param[in] jobExecutionPolicy \see{RunLoop::JobExecutionPolicy}
+            /// (anything but \see{RunLoop::RateLimitedJobExecutionPolicy}).
             SystemRunLoop (
-                const std::string &name = std::string (),
-                JobExecutionPolicy::SharedPtr jobExecutionPolicy = new FIFOJobExecutionPolicy) :
-                util::RunLoop (name, jobExecutionPolicy) {}
+                    const std::string &name = std::string (),
+                    JobExecutionPolicy::SharedPtr jobExecutionPolicy = new FIFOJobExecutionPolicy) :
+                    util::RunLoop (name, jobExecutionPolicy) {
+                if (RateLimitedJobExecutionPolicy::SharedPtr (jobExecutionPolicy) != nullptr) {
+                    THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                        THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+                }
+            }
             /// \brief
             /// dtor.
             virtual ~SystemRunLoop () {
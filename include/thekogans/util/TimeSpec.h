@@ -31,6 +31,7 @@
 #include "thekogans/util/Types.h"
 #include "thekogans/util/Constants.h"
 #include "thekogans/util/Serializable.h"
+#include "thekogans/util/SerializableFields.h"
 #include "thekogans/util/Exception.h"
 #if defined (TOOLCHAIN_OS_Windows)
     #include "thekogans/util/os/windows/WindowsUtils.h"
@@ -345,40 +346,10 @@ namespace thekogans {
 
             // Serializable
             /// \brief
-            /// Read the key from the given serializer.
-            /// \param[in] header \see{SerializableHeader}.
-            /// \param[in] serializer \see{Serializer} to read the key from.
-            virtual void Read (
-                const SerializableHeader & /*header*/,
-                Serializer &serializer) override;
-            /// \brief
-            /// Write the key to the given serializer.
-            /// \param[out] serializer \see{Serializer} to write the key to.
-            virtual void Write (Serializer &serializer) const override;
-
-            /// \brief
-            /// Read the Serializable from an XML DOM.
-            /// \param[in] header \see{SerializableHeader}.
-            /// \param[in] node XML DOM representation of a \see{Serializable}.
-            virtual void ReadXML (
-                const SerializableHeader & /*header*/,
-                const pugi::xml_node &node) override;
-            /// \brief
-            /// Write the Serializable to the XML DOM.
-            /// \param[out] node Parent node.
-            virtual void WriteXML (pugi::xml_node &node) const override;
-
-            /// \brief
-            /// Read the Serializable from an JSON DOM.
-            /// \param[in] header \see{SerializableHeader}.
-            /// \param[in] object JSON DOM representation of a \see{Serializable}.
-            virtual void ReadJSON (
-                const SerializableHeader & /*header*/,
-                const JSON::Object &object) override;
-            /// \brief
-            /// Write the Serializable to the JSON DOM.
-            /// \param[out] node Parent node.
-            virtual void WriteJSON (JSON::Object &object) const override;
+            /// TimeSpec serializes its seconds and nanoseconds.
+            THEKOGANS_UTIL_DECLARE_SERIALIZABLE_FIELDS (
+                THEKOGANS_UTIL_SERIALIZABLE_FIELD (TimeSpec, seconds, "Seconds"),
+                THEKOGANS_UTIL_SERIALIZABLE_FIELD (TimeSpec, nanoseconds, "Nanoseconds"))
         };
 
         /// \brief
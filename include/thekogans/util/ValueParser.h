@@ -31,7 +31,8 @@ namespace thekogans {
         ///
         /// \brief
         /// ValueParser is a template used to incrementally assemble values from stream
-        /// like \see{Serializer}s.
+        /// like \see{Serializer}s. Integers are parsed according to the serializer
+        /// mode (see \see{Serializer::compact}).
 
         template<typename T>
         struct ValueParser {
@@ -43,8 +44,8 @@ namespace thekogans {
             /// Offset in to valueBuffer.
             std::size_t offset;
             /// \brief
-            /// Partial value.
-            ui8 valueBuffer[sizeof (T)];
+            /// Partial value (big enough for a compact (\see{SizeT} encoded) integer).
+            ui8 valueBuffer[sizeof (T) > SizeT::MAX_SIZE ? sizeof (T) : SizeT::MAX_SIZE];
 
         public:
             /// \brief
@@ -66,14 +67,26 @@ namespace thekogans {
             /// \return true == Value was successfully parsed,
             /// false == call back with more data.
             bool ParseValue (Serializer &serializer) {
+                std::size_t size = sizeof (T);
+                if (Serializer::IsCompactType<T> () && serializer.compact) {
+                    // The first byte tells us how many more to expect.
+                    if (offset == 0 && serializer.Read (valueBuffer, 1) == 1) {
+                        ++offset;
+                    }
+                    if (offset == 0) {
+                        return false;
+                    }
+                    size = SizeT::Size (valueBuffer[0]);
+                }
                 offset += serializer.Read (
                     valueBuffer + offset,
-                    sizeof (T) - offset);
-                if (offset == sizeof (T)) {
+                    size - offset);
+                if (offset == size) {
                     TenantReadBuffer buffer (
                         serializer.endianness,
                         valueBuffer,
-                        sizeof (T));
+                        size);
+                    buffer.compact = serializer.compact;
                     buffer >> value;
                     Reset ();
                     return true;
@@ -28,7 +28,8 @@
 #include "thekogans/util/Singleton.h"
 #include "thekogans/util/Thread.h"
 #include "thekogans/util/Mutex.h"
-#include "thekogans/util/Barrier.h"
+#include "thekogans/util/TimeSpec.h"
+#include "thekogans/util/SpinBarrier.h"
 
 namespace thekogans {
     namespace util {
@@ -144,9 +145,14 @@ namespace thekogans {
             /// ctor. Initialize the workers array, and start waiting for jobs.
             /// \param[in] workerCount_ The width of the vector.
             /// \param[in] workerPriority Worker thread priority.
+            /// \param[in] maxSpinTime How long the workers spin at the barrier
+            /// before parking. Spinning lets short parallel regions run back to
+            /// back without a round trip through the kernel.
             Vectorizer (
                 std::size_t workerCount_ = SystemInfo::Instance ()->GetCPUCount (),
-                i32 workerPriority = THEKOGANS_UTIL_NORMAL_THREAD_PRIORITY);
+                i32 workerPriority = THEKOGANS_UTIL_NORMAL_THREAD_PRIORITY,
+                const TimeSpec &maxSpinTime =
+                    TimeSpec::FromMicroseconds (SpinBarrier::DEFAULT_MAX_SPIN_TIME));
             /// \brief
             /// dtor.
             virtual ~Vectorizer ();
@@ -173,7 +179,7 @@ namespace thekogans {
             Mutex mutex;
             /// \brief
             /// Used to synchronize vectorizer workers.
-            Barrier barrier;
+            SpinBarrier barrier;
             /// \struct vectorizer::Worker Vectorizer.h thekogans/util/Vectorizer.h
             ///
             /// \brief
@@ -206,7 +212,8 @@ namespace thekogans {
                         Thread (name),
                         vectorizer (vectorizer_),
                         rank (rank_) {
-                    Create (priority, (ui32)rank);
+                    // Wrap around if the vector is wider than the machine.
+                    Create (priority, (ui32)(rank % SystemInfo::Instance ()->GetCPUCount ()));
                 }
 
             protected:
@@ -0,0 +1,307 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_util_os_linux_EpollRunLoop_h)
+#define __thekogans_util_os_linux_EpollRunLoop_h
+
+#include "thekogans/util/Environment.h"
+
+#if defined (TOOLCHAIN_OS_Linux)
+
+#include <string>
+#include <map>
+#include <unordered_map>
+#include "thekogans/util/Config.h"
+#include "thekogans/util/Types.h"
+#include "thekogans/util/RefCounted.h"
+#include "thekogans/util/TimeSpec.h"
+#include "thekogans/util/SpinLock.h"
+#include "thekogans/util/ThreadRunLoop.h"
+
+namespace thekogans {
+    namespace util {
+        namespace os {
+            namespace linux {
+
+                /// \struct EpollRunLoop EpollRunLoop.h thekogans/util/os/linux/EpollRunLoop.h
+                ///
+                /// \brief
+                /// EpollRunLoop is a \see{ThreadRunLoop} that multiplexes file descriptor
+                /// readiness with job execution. A single thread can serve thousands of
+                /// pipes, sockets (or any other pollable handle, like inotify) along with
+                /// its queued and scheduled jobs. Cross-thread EnqJob wake-ups go through
+                /// an eventfd (instead of a \see{Condition}), and scheduled jobs are driven
+                /// by a timerfd. Use it exactly like a \see{ThreadRunLoop}; call Start from
+                /// the thread that will serve the loop.
+                ///
+                /// Here is how you would move Directory::Watcher style inotify processing
+                /// on to an EpollRunLoop:
+                ///
+                /// \code{.cpp}
+                /// using namespace thekogans;
+                ///
+                /// struct INotifyEventSink : public util::os::linux::EpollRunLoop::EventSink {
+                ///     virtual void HandleReadable (THEKOGANS_UTIL_HANDLE handle) noexcept override {
+                ///         // read (handle, ...) and dispatch inotify_event(s).
+                ///     }
+                /// };
+                ///
+                /// runLoop->AddHandle (
+                ///     inotify_init1 (IN_NONBLOCK),
+                ///     util::os::linux::EpollRunLoop::EventReadable,
+                ///     new INotifyEventSink);
+                /// \endcode
+
+                struct _LIB_THEKOGANS_UTIL_DECL EpollRunLoop : public ThreadRunLoop {
+                    /// \brief
+                    /// Declare \see{RefCounted} pointers.
+                    THEKOGANS_UTIL_DECLARE_REF_COUNTED_POINTERS (EpollRunLoop)
+
+                    enum {
+                        /// \brief
+                        /// Interested in handle becoming readable.
+                        EventReadable = 1,
+                        /// \brief
+                        /// Interested in handle becoming writable.
+                        EventWritable = 2,
+                        /// \brief
+                        /// Use edge triggered notifications (level triggered is the default).
+                        EventEdgeTriggered = 4
+                    };
+
+                    /// \struct EpollRunLoop::EventSink EpollRunLoop.h thekogans/util/os/linux/EpollRunLoop.h
+                    ///
+                    /// \brief
+                    /// EventSink specifies the interface used by the EpollRunLoop
+                    /// to deliver handle readiness notifications. All notifications
+                    /// are delivered on the thread that called Start.
+                    struct _LIB_THEKOGANS_UTIL_DECL EventSink : public virtual RefCounted {
+                        /// \brief
+                        /// Declare \see{RefCounted} pointers.
+                        THEKOGANS_UTIL_DECLARE_REF_COUNTED_POINTERS (EventSink)
+
+                        /// \brief
+                        /// Called when the handle is ready for reading.
+                        /// \param[in] handle Handle that became readable.
+                        virtual void HandleReadable (THEKOGANS_UTIL_HANDLE /*handle*/) noexcept {}
+                        /// \brief
+                        /// Called when the handle is ready for writing.
+                        /// \param[in] handle Handle that became writable.
+                        virtual void HandleWritable (THEKOGANS_UTIL_HANDLE /*handle*/) noexcept {}
+                        /// \brief
+                        /// Called when the handle was hung up or is in error.
+                        /// NOTE: The handle is not removed from the run loop. Call
+                        /// RemoveHandle if you're not interested in it any more.
+                        /// \param[in] handle Handle that was hung up or is in error.
+                        /// \param[in] events epoll events (EPOLLERR, EPOLLHUP, EPOLLRDHUP).
+                        virtual void HandleError (
+                            THEKOGANS_UTIL_HANDLE /*handle*/,
+                            ui32 /*events*/) noexcept {}
+                    };
+
+                    /// \brief
+                    /// Max number of epoll events collected per epoll_wait.
+                    static const std::size_t DEFAULT_MAX_EVENTS = 256;
+                    /// \brief
+                    /// Max number of jobs to execute before polling handles again.
+                    static const std::size_t DEFAULT_MAX_JOBS_PER_ITERATION = 64;
+
+                private:
+                    /// \brief
+                    /// epoll handle.
+                    THEKOGANS_UTIL_HANDLE epollHandle;
+                    /// \brief
+                    /// eventfd used to wake up the loop when a job is enqueued.
+                    THEKOGANS_UTIL_HANDLE eventHandle;
+                    /// \brief
+                    /// timerfd used to drive scheduled jobs.
+                    THEKOGANS_UTIL_HANDLE timerHandle;
+                    /// \brief
+                    /// Max number of epoll events collected per epoll_wait.
+                    const std::size_t maxEvents;
+                    /// \brief
+                    /// Max number of jobs to execute before polling handles again.
+                    const std::size_t maxJobsPerIteration;
+                    /// \brief
+                    /// Alias for std::unordered_map<THEKOGANS_UTIL_HANDLE, EventSink::SharedPtr>.
+                    using EventSinkMap = std::unordered_map<THEKOGANS_UTIL_HANDLE, EventSink::SharedPtr>;
+                    /// \brief
+                    /// Registered handles.
+                    EventSinkMap eventSinks;
+                    /// \brief
+                    /// Alias for std::multimap<TimeSpec, Job::SharedPtr>.
+                    using ScheduledJobs = std::multimap<TimeSpec, Job::SharedPtr>;
+                    /// \brief
+                    /// Jobs waiting for their deadline.
+                    ScheduledJobs scheduledJobs;
+                    /// \brief
+                    /// Synchronization lock for eventSinks and scheduledJobs.
+                    SpinLock spinLock;
+
+                public:
+                    /// \brief
+                    /// ctor.
+                    /// \param[in] name RunLoop name.
+                    /// \param[in] jobExecutionPolicy \see{RunLoop::JobExecutionPolicy}.
+                    /// \param[in] maxEvents_ Max number of epoll events collected per epoll_wait.
+                    /// \param[in] maxJobsPerIteration_ Max number of jobs to execute before
+                    /// polling handles again. Keeps a busy job queue from starving I/O.
+                    EpollRunLoop (
+                        const std::string &name = std::string (),
+                        JobExecutionPolicy::SharedPtr jobExecutionPolicy = new FIFOJobExecutionPolicy,
+                        std::size_t maxEvents_ = DEFAULT_MAX_EVENTS,
+                        std::size_t maxJobsPerIteration_ = DEFAULT_MAX_JOBS_PER_ITERATION);
+                    /// \brief
+                    /// dtor.
+                    virtual ~EpollRunLoop ();
+
+                    /// \brief
+                    /// Register a handle with the run loop.
+                    /// \param[in] handle Handle to register (pipe, socket, inotify...).
+                    /// \param[in] events Combination of EventReadable, EventWritable
+                    /// and EventEdgeTriggered.
+                    /// \param[in] eventSink EventSink that will receive notifications.
+                    void AddHandle (
+                        THEKOGANS_UTIL_HANDLE handle,
+                        ui32 events,
+                        EventSink::SharedPtr eventSink);
+                    /// \brief
+                    /// Change the events a registered handle is interested in.
+                    /// \param[in] handle Previously registered handle.
+                    /// \param[in] events Combination of EventReadable, EventWritable
+                    /// and EventEdgeTriggered.
+                    void ModifyHandle (
+                        THEKOGANS_UTIL_HANDLE handle,
+                        ui32 events);
+                    /// \brief
+                    /// Unregister a previously registered handle.
+                    /// NOTE: The handle is not closed.
+                    /// \param[in] handle Handle to unregister.
+                    void RemoveHandle (THEKOGANS_UTIL_HANDLE handle);
+
+                    /// \brief
+                    /// Schedule a job to be executed on this run loop in the future.
+                    /// \param[in] job Job to execute.
+                    /// \param[in] timeSpec When in the future to execute the job.
+                    /// IMPORTANT: timeSpec is a relative value.
+                    /// \return Job id that can be used in a call to CancelScheduledJob.
+                    Job::Id ScheduleJob (
+                        Job::SharedPtr job,
+                        const TimeSpec &timeSpec);
+                    /// \brief
+                    /// Schedule a lambda (function) to be executed on this run loop in the future.
+                    /// \param[in] function Lambda to execute.
+                    /// \param[in] timeSpec When in the future to execute the lambda.
+                    /// IMPORTANT: timeSpec is a relative value.
+                    /// \return Job id that can be used in a call to CancelScheduledJob.
+                    inline Job::Id ScheduleJob (
+                            const LambdaJob::Function &function,
+                            const TimeSpec &timeSpec) {
+                        return ScheduleJob (new LambdaJob (function), timeSpec);
+                    }
+                    /// \brief
+                    /// Cancel a job scheduled with ScheduleJob that has not fired yet.
+                    /// \param[in] jobId Id of job to cancel.
+                    /// \return true if the job was found and cancelled.
+                    bool CancelScheduledJob (const Job::Id &jobId);
+
+                    // RunLoop
+                    /// \brief
+                    /// Bring the lambda overloads in to scope.
+                    using RunLoop::EnqJob;
+                    using RunLoop::EnqJobFront;
+
+                    /// \brief
+                    /// Start the run loop. This is a blocking call and will
+                    /// only complete when Stop is called.
+                    virtual void Start () override;
+                    /// \brief
+                    /// Stop the run loop. Calling this function will cause the Start call
+                    /// to return. Jobs scheduled with ScheduleJob that have not fired yet
+                    /// are dropped.
+                    /// \param[in] cancelRunningJobs true = Cancel all running jobs.
+                    /// \param[in] cancelPendingJobs true = Cancel all pending jobs.
+                    virtual void Stop (
+                        bool cancelRunningJobs = true,
+                        bool cancelPendingJobs = true) override;
+                    /// \brief
+                    /// Continue the run loop execution. If the run loop is not paused, noop.
+                    /// Wakes up epoll_wait so that jobs queued while paused get executed.
+                    virtual void Continue () override;
+
+                    /// \brief
+                    /// Enqueue a job to be performed on the run loop thread.
+                    /// \param[in] job Job to enqueue.
+                    /// \param[in] wait Wait for job to finish.
+                    /// \param[in] timeSpec How long to wait for the job to complete.
+                    /// IMPORTANT: timeSpec is a relative value.
+                    /// \return true == !wait || WaitForJob (...)
+                    virtual bool EnqJob (
+                        Job::SharedPtr job,
+                        bool wait = false,
+                        const TimeSpec &timeSpec = TimeSpec::Infinite) override;
+                    /// \brief
+                    /// Enqueue a job to be performed next on the run loop thread.
+                    /// \param[in] job Job to enqueue.
+                    /// \param[in] wait Wait for job to finish.
+                    /// \param[in] timeSpec How long to wait for the job to complete.
+                    /// IMPORTANT: timeSpec is a relative value.
+                    /// \return true == !wait || WaitForJob (...)
+                    virtual bool EnqJobFront (
+                        Job::SharedPtr job,
+                        bool wait = false,
+                        const TimeSpec &timeSpec = TimeSpec::Infinite) override;
+
+                private:
+                    /// \brief
+                    /// Write to the eventfd to wake up epoll_wait.
+                    void WakeUp ();
+                    /// \brief
+                    /// Execute up to maxJobsPerIteration pending jobs.
+                    /// \return How long epoll_wait can block before there's another job
+                    /// to execute (TimeSpec::Zero == more jobs are waiting, TimeSpec::Infinite
+                    /// == no more jobs, anything in between == the jobs are being throttled).
+                    TimeSpec ExecuteJobs ();
+                    /// \brief
+                    /// Move jobs whose deadline has passed to the pending queue
+                    /// and rearm the timer for the next deadline.
+                    void EnqDueJobs ();
+                    /// \brief
+                    /// Arm the timerfd to fire at the earliest scheduled deadline.
+                    /// NOTE: Assumes spinLock is held.
+                    void ArmTimer ();
+                    /// \brief
+                    /// Deliver epoll events to the handle's EventSink.
+                    /// \param[in] handle Handle that has events pending.
+                    /// \param[in] events epoll events.
+                    void DispatchEvents (
+                        THEKOGANS_UTIL_HANDLE handle,
+                        ui32 events);
+
+                    /// \brief
+                    /// EpollRunLoop is neither copy constructable, nor assignable.
+                    THEKOGANS_UTIL_DISALLOW_COPY_AND_ASSIGN (EpollRunLoop)
+                };
+
+            } // namespace linux
+        } // namespace os
+    } // namespace util
+} // namespace thekogans
+
+#endif // defined (TOOLCHAIN_OS_Linux)
+
+#endif // !defined (__thekogans_util_os_linux_EpollRunLoop_h)
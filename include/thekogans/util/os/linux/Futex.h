@@ -0,0 +1,263 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_util_os_linux_Futex_h)
+#define __thekogans_util_os_linux_Futex_h
+
+#include "thekogans/util/Environment.h"
+
+#if defined (TOOLCHAIN_OS_Linux)
+
+#include <atomic>
+#include "thekogans/util/Config.h"
+#include "thekogans/util/Types.h"
+#include "thekogans/util/TimeSpec.h"
+
+namespace thekogans {
+    namespace util {
+        namespace os {
+            namespace linux {
+
+                /// \brief
+                /// Block the calling thread while *address == expected.
+                /// \param[in] address Futex word.
+                /// \param[in] expected Value *address must have for the thread to block.
+                /// \param[in] timeSpec How long to wait.
+                /// IMPORTANT: timeSpec is a relative value.
+                /// \param[in] shared true == The futex word lives in memory shared between processes.
+                /// \return true == woken up (or *address != expected), false == timed out.
+                _LIB_THEKOGANS_UTIL_DECL bool _LIB_THEKOGANS_UTIL_API FutexWait (
+                    volatile ui32 *address,
+                    ui32 expected,
+                    const TimeSpec &timeSpec = TimeSpec::Infinite,
+                    bool shared = false);
+                /// \brief
+                /// Wake up to count threads blocked on address.
+                /// \param[in] address Futex word.
+                /// \param[in] count Max number of threads to wake up.
+                /// \param[in] shared true == The futex word lives in memory shared between processes.
+                /// \return Number of threads woken up.
+                _LIB_THEKOGANS_UTIL_DECL ui32 _LIB_THEKOGANS_UTIL_API FutexWake (
+                    volatile ui32 *address,
+                    ui32 count,
+                    bool shared = false);
+                /// \brief
+                /// If *address == expected, wake up to wakeCount threads blocked on
+                /// address and move the rest of them to wait on target.
+                /// \param[in] address Futex word.
+                /// \param[in] expected Value *address must have for the requeue to proceed.
+                /// \param[in] wakeCount Max number of threads to wake up.
+                /// \param[in] target Futex word to move the remaining waiters to.
+                /// \param[in] shared true == The futex words live in memory shared between processes.
+                /// \return true == requeued, false == *address != expected (try again).
+                _LIB_THEKOGANS_UTIL_DECL bool _LIB_THEKOGANS_UTIL_API FutexRequeue (
+                    volatile ui32 *address,
+                    ui32 expected,
+                    ui32 wakeCount,
+                    volatile ui32 *target,
+                    bool shared = false);
+
+                /// \struct FutexLock Futex.h thekogans/util/os/linux/Futex.h
+                ///
+                /// \brief
+                /// FutexLock is an adaptive lock. It spins for a short while hoping the
+                /// owner will release it soon, and then parks the thread in the kernel
+                /// until it does. Uncontended Acquire/Release never leave user space.
+                /// Use it anywhere you would use a \see{SpinLock} or a \see{Mutex}
+                /// (it works with \see{LockGuard}).
+
+                struct _LIB_THEKOGANS_UTIL_DECL FutexLock {
+                    /// \brief
+                    /// Lock is free.
+                    static const ui32 Unlocked = 0;
+                    /// \brief
+                    /// Lock is held and nobody is waiting.
+                    static const ui32 Locked = 1;
+                    /// \brief
+                    /// Lock is held and there might be threads parked on it.
+                    static const ui32 Contended = 2;
+                    /// \brief
+                    /// Default number of spin iterations before parking.
+                    static const ui32 DEFAULT_MAX_SPIN_COUNT = 64;
+
+                private:
+                    /// \brief
+                    /// Lock state (and futex word).
+                    std::atomic<ui32> state;
+                    /// \brief
+                    /// Number of spin iterations before parking.
+                    ui32 maxSpinCount;
+
+                public:
+                    /// \brief
+                    /// ctor.
+                    /// \param[in] maxSpinCount_ Number of spin iterations before parking.
+                    explicit FutexLock (ui32 maxSpinCount_ = DEFAULT_MAX_SPIN_COUNT) :
+                        state (Unlocked),
+                        maxSpinCount (maxSpinCount_) {}
+
+                    /// \brief
+                    /// Return true if locked.
+                    /// \return true if locked.
+                    inline bool IsLocked () const {
+                        return state.load (std::memory_order_relaxed) != Unlocked;
+                    }
+
+                    /// \brief
+                    /// Try to acquire the lock.
+                    /// \return true = acquired, false = failed to acquire
+                    inline bool TryAcquire () {
+                        ui32 expected = Unlocked;
+                        return state.compare_exchange_strong (
+                            expected, Locked, std::memory_order_acquire);
+                    }
+
+                    /// \brief
+                    /// Acquire the lock.
+                    void Acquire ();
+
+                    /// \brief
+                    /// Release the lock.
+                    void Release ();
+
+                private:
+                    /// \brief
+                    /// Acquire the lock leaving it in Contended state. Used by
+                    /// \see{FutexCondition} whose waiters might have been requeued
+                    /// on to our futex word.
+                    void AcquireContended ();
+
+                    /// \brief
+                    /// FutexCondition needs access to state.
+                    friend struct FutexCondition;
+
+                    /// \brief
+                    /// FutexLock is neither copy constructable, nor assignable.
+                    THEKOGANS_UTIL_DISALLOW_COPY_AND_ASSIGN (FutexLock)
+                };
+
+                /// \struct FutexCondition Futex.h thekogans/util/os/linux/Futex.h
+                ///
+                /// \brief
+                /// A condition variable paired with a \see{FutexLock}. SignalAll
+                /// wakes up one waiter and requeues the rest on to the lock's futex
+                /// word. That way they're woken up one at a time as the lock becomes
+                /// available instead of stampeding for it. As with \see{Condition},
+                /// use a predicate loop around Wait.
+
+                struct _LIB_THEKOGANS_UTIL_DECL FutexCondition {
+                private:
+                    /// \brief
+                    /// The lock this condition variable is paired with.
+                    FutexLock &lock;
+                    /// \brief
+                    /// Bumped by every Signal[All] (and futex word).
+                    std::atomic<ui32> sequence;
+
+                public:
+                    /// \brief
+                    /// ctor.
+                    /// \param[in] lock_ The lock to pair this condition variable with.
+                    explicit FutexCondition (FutexLock &lock_) :
+                        lock (lock_),
+                        sequence (0) {}
+
+                    /// \brief
+                    /// Wait for condition. The lock must be held by the caller.
+                    /// \param[in] timeSpec How long to wait.
+                    /// IMPORTANT: timeSpec is a relative value.
+                    /// \return true = succeeded, false = timed out
+                    bool Wait (const TimeSpec &timeSpec = TimeSpec::Infinite);
+
+                    /// \brief
+                    /// Wake up one waiting thread.
+                    void Signal ();
+
+                    /// \brief
+                    /// Wake up all waiting threads.
+                    void SignalAll ();
+
+                    /// \brief
+                    /// FutexCondition is neither copy constructable, nor assignable.
+                    THEKOGANS_UTIL_DISALLOW_COPY_AND_ASSIGN (FutexCondition)
+                };
+
+                /// \struct FutexEvent Futex.h thekogans/util/os/linux/Futex.h
+                ///
+                /// \brief
+                /// A lightweight (process private) \see{Event}. Signal only enters
+                /// the kernel if there are threads waiting on the event, and Wait
+                /// only does if the event is not signalled.
+
+                struct _LIB_THEKOGANS_UTIL_DECL FutexEvent {
+                private:
+                    /// \brief
+                    /// true == manual reset, false == auto reset.
+                    bool manualReset;
+                    /// \brief
+                    /// 0 == not signalled, 1 == signalled (and futex word).
+                    std::atomic<ui32> state;
+                    /// \brief
+                    /// Count of threads blocked in Wait.
+                    std::atomic<ui32> waiters;
+
+                public:
+                    /// \brief
+                    /// ctor.
+                    /// \param[in] manualReset_ true == event is to be manually reset after
+                    /// entering signalled state, false == event is reset after the first
+                    /// waiting thread is woken up.
+                    /// \param[in] signalled true == create the event signalled.
+                    explicit FutexEvent (
+                        bool manualReset_ = true,
+                        bool signalled = false) :
+                        manualReset (manualReset_),
+                        state (signalled ? 1 : 0),
+                        waiters (0) {}
+
+                    /// \brief
+                    /// Put the event in to signalled state. Wakes up all
+                    /// waiters (manual reset) or one (auto reset).
+                    void Signal ();
+                    /// \brief
+                    /// Put the event in to signalled state, and wake up all waiters.
+                    void SignalAll ();
+                    /// \brief
+                    /// Put the event in to not signalled state.
+                    inline void Reset () {
+                        state.store (0, std::memory_order_release);
+                    }
+                    /// \brief
+                    /// Wait for event to become signalled.
+                    /// \param[in] timeSpec How long to wait.
+                    /// IMPORTANT: timeSpec is a relative value.
+                    /// \return true == signalled, false == timed out.
+                    bool Wait (const TimeSpec &timeSpec = TimeSpec::Infinite);
+
+                    /// \brief
+                    /// FutexEvent is neither copy constructable, nor assignable.
+                    THEKOGANS_UTIL_DISALLOW_COPY_AND_ASSIGN (FutexEvent)
+                };
+
+            } // namespace linux
+        } // namespace os
+    } // namespace util
+} // namespace thekogans
+
+#endif // defined (TOOLCHAIN_OS_Linux)
+
+#endif // !defined (__thekogans_util_os_linux_Futex_h)
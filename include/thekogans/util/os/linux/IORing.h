@@ -0,0 +1,257 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_util_os_linux_IORing_h)
+#define __thekogans_util_os_linux_IORing_h
+
+#include "thekogans/util/Environment.h"
+
+#if defined (TOOLCHAIN_OS_Linux)
+
+#include <sys/uio.h>
+#include <cstddef>
+#include "thekogans/util/Config.h"
+#include "thekogans/util/Types.h"
+#include "thekogans/util/Constants.h"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace thekogans {
+    namespace util {
+        namespace os {
+            namespace linux {
+
+                /// \struct IORing IORing.h thekogans/util/os/linux/IORing.h
+                ///
+                /// \brief
+                /// IORing is a thin wrapper around a Linux io_uring instance. It talks
+                /// to the kernel directly (io_uring_setup/io_uring_enter/io_uring_register)
+                /// so that there's no dependency on liburing. Requests are prepared in
+                /// to the submission queue (batched) and handed to the kernel with a
+                /// single Submit. Completions are reaped with ReapCompletions and
+                /// delivered to the \see{Request} that was passed in when the request
+                /// was prepared.
+                /// IMPORTANT: IORing does not do its own locking. The submission side
+                /// (Prep* and Submit) must be serialized by the caller, and completions
+                /// must be reaped from a single thread. The two sides can run concurrently.
+
+                struct _LIB_THEKOGANS_UTIL_DECL IORing {
+                    /// \struct IORing::Request IORing.h thekogans/util/os/linux/IORing.h
+                    ///
+                    /// \brief
+                    /// Request is the completion interface for prepared requests.
+                    struct _LIB_THEKOGANS_UTIL_DECL Request {
+                        /// \brief
+                        /// dtor.
+                        virtual ~Request () {}
+
+                        /// \brief
+                        /// Called by ReapCompletions when the request completes.
+                        /// \param[in] result >= 0 byte count (0 for Fsync), < 0 -errno.
+                        virtual void Complete (i32 result) noexcept = 0;
+                    };
+
+                    /// \brief
+                    /// Default submission queue depth.
+                    static const ui32 DEFAULT_ENTRIES = 256;
+
+                private:
+                    /// \brief
+                    /// io_uring file descriptor.
+                    THEKOGANS_UTIL_HANDLE handle;
+                    /// \brief
+                    /// Number of submission queue entries.
+                    ui32 entries;
+                    /// \brief
+                    /// Submission queue ring mapping.
+                    void *sqRing;
+                    /// \brief
+                    /// Submission queue ring mapping length.
+                    std::size_t sqRingLength;
+                    /// \brief
+                    /// Completion queue ring mapping (can be the same as sqRing).
+                    void *cqRing;
+                    /// \brief
+                    /// Completion queue ring mapping length.
+                    std::size_t cqRingLength;
+                    /// \brief
+                    /// Submission queue entries mapping.
+                    io_uring_sqe *sqes;
+                    /// \brief
+                    /// Kernel's submission queue head.
+                    ui32 *sqHead;
+                    /// \brief
+                    /// Our submission queue tail.
+                    ui32 *sqTail;
+                    /// \brief
+                    /// Submission queue ring mask.
+                    ui32 sqMask;
+                    /// \brief
+                    /// Submission queue index array.
+                    ui32 *sqArray;
+                    /// \brief
+                    /// Our completion queue head.
+                    ui32 *cqHead;
+                    /// \brief
+                    /// Kernel's completion queue tail.
+                    ui32 *cqTail;
+                    /// \brief
+                    /// Completion queue ring mask.
+                    ui32 cqMask;
+                    /// \brief
+                    /// Completion queue entries.
+                    io_uring_cqe *cqes;
+                    /// \brief
+                    /// Number of prepared but not yet submitted requests.
+                    ui32 pending;
+                    /// \brief
+                    /// Number of registered buffers.
+                    ui32 registeredBufferCount;
+
+                public:
+                    /// \brief
+                    /// ctor.
+                    /// \param[in] entries_ Submission queue depth (rounded up to power of 2 by the kernel).
+                    explicit IORing (ui32 entries_ = DEFAULT_ENTRIES);
+                    /// \brief
+                    /// dtor.
+                    ~IORing ();
+
+                    /// \brief
+                    /// Return true if the running kernel (and its seccomp policy) allow io_uring.
+                    /// \return true == io_uring is available.
+                    static bool IsSupported ();
+
+                    /// \brief
+                    /// Return the io_uring file descriptor.
+                    /// \return io_uring file descriptor.
+                    inline THEKOGANS_UTIL_HANDLE GetHandle () const {
+                        return handle;
+                    }
+                    /// \brief
+                    /// Return the submission queue depth.
+                    /// \return Submission queue depth.
+                    inline ui32 GetEntries () const {
+                        return entries;
+                    }
+
+                    /// \brief
+                    /// Register (pin) buffers with the kernel. Registered buffers are
+                    /// used with Prep[Read | Write] by passing their index. This saves
+                    /// the kernel from having to map/unmap the pages on every request.
+                    /// NOTE: Any previously registered buffers are unregistered first.
+                    /// Don't call this while there are fixed buffer requests in flight.
+                    /// \param[in] buffers Buffers to register.
+                    /// \param[in] count Number of buffers.
+                    void RegisterBuffers (
+                        const iovec *buffers,
+                        ui32 count);
+                    /// \brief
+                    /// Unregister previously registered buffers.
+                    void UnregisterBuffers ();
+                    /// \brief
+                    /// Return the number of registered buffers.
+                    /// \return Number of registered buffers.
+                    inline ui32 GetRegisteredBufferCount () const {
+                        return registeredBufferCount;
+                    }
+
+                    /// \brief
+                    /// Prepare a positional read.
+                    /// \param[in] fd File to read from.
+                    /// \param[out] buffer Where to place the bytes.
+                    /// \param[in] count Number of bytes to read.
+                    /// \param[in] offset File offset to read from.
+                    /// \param[in] bufferIndex If != NIDX32, buffer lies in the registered buffer at this index.
+                    /// \param[in] request Completion callback.
+                    void PrepRead (
+                        THEKOGANS_UTIL_HANDLE fd,
+                        void *buffer,
+                        ui32 count,
+                        ui64 offset,
+                        ui32 bufferIndex,
+                        Request *request);
+                    /// \brief
+                    /// Prepare a positional write.
+                    /// \param[in] fd File to write to.
+                    /// \param[in] buffer Where the bytes come from.
+                    /// \param[in] count Number of bytes to write.
+                    /// \param[in] offset File offset to write to.
+                    /// \param[in] bufferIndex If != NIDX32, buffer lies in the registered buffer at this index.
+                    /// \param[in] request Completion callback.
+                    void PrepWrite (
+                        THEKOGANS_UTIL_HANDLE fd,
+                        const void *buffer,
+                        ui32 count,
+                        ui64 offset,
+                        ui32 bufferIndex,
+                        Request *request);
+                    /// \brief
+                    /// Prepare an fsync.
+                    /// \param[in] fd File to sync.
+                    /// \param[in] dataOnly true == fdatasync semantics.
+                    /// \param[in] request Completion callback.
+                    void PrepFsync (
+                        THEKOGANS_UTIL_HANDLE fd,
+                        bool dataOnly,
+                        Request *request);
+                    /// \brief
+                    /// Prepare a no-op. Usefull to wake up the thread blocked in ReapCompletions.
+                    /// \param[in] request Completion callback (can be nullptr).
+                    void PrepNop (Request *request);
+
+                    /// \brief
+                    /// Return the number of prepared but not yet submitted requests.
+                    /// \return Number of prepared but not yet submitted requests.
+                    inline ui32 GetPendingCount () const {
+                        return pending;
+                    }
+                    /// \brief
+                    /// Hand all prepared requests to the kernel in one system call.
+                    /// \return Number of requests submitted.
+                    ui32 Submit ();
+
+                    /// \brief
+                    /// Reap completed requests and call their Request::Complete.
+                    /// \param[in] wait true == block until at least one request completes.
+                    /// \return Number of requests reaped.
+                    std::size_t ReapCompletions (bool wait = true);
+
+                private:
+                    /// \brief
+                    /// Return the next free submission queue entry, submitting
+                    /// pending requests if the queue is full.
+                    /// \return Next free submission queue entry.
+                    io_uring_sqe *GetSqe ();
+                    /// \brief
+                    /// Make the entry returned by GetSqe visible to the kernel.
+                    void CommitSqe ();
+
+                    /// \brief
+                    /// IORing is neither copy constructable, nor assignable.
+                    THEKOGANS_UTIL_DISALLOW_COPY_AND_ASSIGN (IORing)
+                };
+
+            } // namespace linux
+        } // namespace os
+    } // namespace util
+} // namespace thekogans
+
+#endif // defined (TOOLCHAIN_OS_Linux)
+
+#endif // !defined (__thekogans_util_os_linux_IORing_h)
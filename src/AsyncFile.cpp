@@ -0,0 +1,431 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#include "thekogans/util/Environment.h"
+#if !defined (TOOLCHAIN_OS_Windows)
+    #include <unistd.h>
+    #include <errno.h>
+#endif // !defined (TOOLCHAIN_OS_Windows)
+#include <atomic>
+#include <memory>
+#include "thekogans/util/Exception.h"
+#include "thekogans/util/LoggerMgr.h"
+#include "thekogans/util/JobQueue.h"
+#if defined (TOOLCHAIN_OS_Linux)
+    #include <sys/uio.h>
+    #include "thekogans/util/Thread.h"
+    #include "thekogans/util/Mutex.h"
+    #include "thekogans/util/LockGuard.h"
+    #include "thekogans/util/os/linux/IORing.h"
+#endif // defined (TOOLCHAIN_OS_Linux)
+#include "thekogans/util/AsyncFile.h"
+
+namespace thekogans {
+    namespace util {
+
+        namespace {
+            void InvokeCallback (
+                    const AsyncIOService::Callback &callback,
+                    THEKOGANS_UTIL_ERROR_CODE errorCode,
+                    std::size_t count) {
+                THEKOGANS_UTIL_TRY {
+                    callback (errorCode, count);
+                }
+                THEKOGANS_UTIL_CATCH_AND_LOG_SUBSYSTEM (THEKOGANS_UTIL)
+            }
+
+            // Deliver the completion on the requested run loop
+            // (or right here if none was given).
+            void DispatchCallback (
+                    RunLoop::SharedPtr runLoop,
+                    const AsyncIOService::Callback &callback,
+                    THEKOGANS_UTIL_ERROR_CODE errorCode,
+                    std::size_t count) {
+                if (callback != nullptr) {
+                    if (runLoop != nullptr) {
+                        THEKOGANS_UTIL_TRY {
+                            runLoop->EnqJob (
+                                [callback, errorCode, count] (
+                                        const RunLoop::LambdaJob & /*job*/,
+                                        const std::atomic<bool> & /*done*/) {
+                                    InvokeCallback (callback, errorCode, count);
+                                });
+                        }
+                        THEKOGANS_UTIL_CATCH_AND_LOG_SUBSYSTEM (THEKOGANS_UTIL)
+                    }
+                    else {
+                        InvokeCallback (callback, errorCode, count);
+                    }
+                }
+            }
+
+            // Synchronous positional I/O used by the thread pool service.
+            THEKOGANS_UTIL_ERROR_CODE PositionalRead (
+                    THEKOGANS_UTIL_HANDLE handle,
+                    ui64 offset,
+                    void *buffer,
+                    std::size_t count,
+                    std::size_t &countRead) {
+            #if defined (TOOLCHAIN_OS_Windows)
+                OVERLAPPED overlapped = {0};
+                overlapped.Offset = (DWORD)offset;
+                overlapped.OffsetHigh = (DWORD)(offset >> 32);
+                DWORD bytesRead = 0;
+                if (!ReadFile (handle, buffer, (DWORD)count, &bytesRead, &overlapped)) {
+                    THEKOGANS_UTIL_ERROR_CODE errorCode = THEKOGANS_UTIL_OS_ERROR_CODE;
+                    if (errorCode != ERROR_HANDLE_EOF) {
+                        return errorCode;
+                    }
+                }
+                countRead = bytesRead;
+                return 0;
+            #else // defined (TOOLCHAIN_OS_Windows)
+                ssize_t rc;
+                do {
+                    rc = pread (handle, buffer, count, (off_t)offset);
+                } while (rc < 0 && THEKOGANS_UTIL_OS_ERROR_CODE == EINTR);
+                if (rc < 0) {
+                    return THEKOGANS_UTIL_OS_ERROR_CODE;
+                }
+                countRead = (std::size_t)rc;
+                return 0;
+            #endif // defined (TOOLCHAIN_OS_Windows)
+            }
+
+            THEKOGANS_UTIL_ERROR_CODE PositionalWrite (
+                    THEKOGANS_UTIL_HANDLE handle,
+                    ui64 offset,
+                    const void *buffer,
+                    std::size_t count,
+                    std::size_t &countWritten) {
+            #if defined (TOOLCHAIN_OS_Windows)
+                OVERLAPPED overlapped = {0};
+                overlapped.Offset = (DWORD)offset;
+                overlapped.OffsetHigh = (DWORD)(offset >> 32);
+                DWORD bytesWritten = 0;
+                if (!WriteFile (handle, buffer, (DWORD)count, &bytesWritten, &overlapped)) {
+                    return THEKOGANS_UTIL_OS_ERROR_CODE;
+                }
+                countWritten = bytesWritten;
+                return 0;
+            #else // defined (TOOLCHAIN_OS_Windows)
+                ssize_t rc;
+                do {
+                    rc = pwrite (handle, buffer, count, (off_t)offset);
+                } while (rc < 0 && THEKOGANS_UTIL_OS_ERROR_CODE == EINTR);
+                if (rc < 0) {
+                    return THEKOGANS_UTIL_OS_ERROR_CODE;
+                }
+                countWritten = (std::size_t)rc;
+                return 0;
+            #endif // defined (TOOLCHAIN_OS_Windows)
+            }
+
+            THEKOGANS_UTIL_ERROR_CODE Sync (
+                    THEKOGANS_UTIL_HANDLE handle,
+                    bool dataOnly) {
+            #if defined (TOOLCHAIN_OS_Windows)
+                (void)dataOnly;
+                return FlushFileBuffers (handle) ? 0 : THEKOGANS_UTIL_OS_ERROR_CODE;
+            #else // defined (TOOLCHAIN_OS_Windows)
+                int rc;
+                do {
+                #if defined (TOOLCHAIN_OS_Linux)
+                    rc = dataOnly ? fdatasync (handle) : fsync (handle);
+                #else // defined (TOOLCHAIN_OS_Linux)
+                    (void)dataOnly;
+                    rc = fsync (handle);
+                #endif // defined (TOOLCHAIN_OS_Linux)
+                } while (rc < 0 && THEKOGANS_UTIL_OS_ERROR_CODE == EINTR);
+                return rc < 0 ? THEKOGANS_UTIL_OS_ERROR_CODE : 0;
+            #endif // defined (TOOLCHAIN_OS_Windows)
+            }
+
+            struct JobQueueAsyncIOService : public AsyncIOService {
+                JobQueue jobQueue;
+
+                explicit JobQueueAsyncIOService (std::size_t workerCount) :
+                    jobQueue (
+                        "AsyncIOService",
+                        new RunLoop::FIFOJobExecutionPolicy,
+                        workerCount) {}
+
+                virtual bool IsIORing () const override {
+                    return false;
+                }
+
+                virtual void RegisterBuffers (const BufferList & /*buffers*/) override {}
+
+                virtual void Read (
+                        THEKOGANS_UTIL_HANDLE handle,
+                        ui64 offset,
+                        void *buffer,
+                        std::size_t count,
+                        ui32 /*bufferIndex*/,
+                        RunLoop::SharedPtr runLoop,
+                        const Callback &callback,
+                        bool /*submit*/) override {
+                    if (handle != THEKOGANS_UTIL_INVALID_HANDLE_VALUE &&
+                            buffer != nullptr && count > 0) {
+                        jobQueue.EnqJob (
+                            [handle, offset, buffer, count, runLoop, callback] (
+                                    const RunLoop::LambdaJob & /*job*/,
+                                    const std::atomic<bool> & /*done*/) {
+                                std::size_t countRead = 0;
+                                THEKOGANS_UTIL_ERROR_CODE errorCode =
+                                    PositionalRead (handle, offset, buffer, count, countRead);
+                                DispatchCallback (runLoop, callback, errorCode, countRead);
+                            });
+                    }
+                    else {
+                        THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                            THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+                    }
+                }
+
+                virtual void Write (
+                        THEKOGANS_UTIL_HANDLE handle,
+                        ui64 offset,
+                        const void *buffer,
+                        std::size_t count,
+                        ui32 /*bufferIndex*/,
+                        RunLoop::SharedPtr runLoop,
+                        const Callback &callback,
+                        bool /*submit*/) override {
+                    if (handle != THEKOGANS_UTIL_INVALID_HANDLE_VALUE &&
+                            buffer != nullptr && count > 0) {
+                        jobQueue.EnqJob (
+                            [handle, offset, buffer, count, runLoop, callback] (
+                                    const RunLoop::LambdaJob & /*job*/,
+                                    const std::atomic<bool> & /*done*/) {
+                                std::size_t countWritten = 0;
+                                THEKOGANS_UTIL_ERROR_CODE errorCode =
+                                    PositionalWrite (handle, offset, buffer, count, countWritten);
+                                DispatchCallback (runLoop, callback, errorCode, countWritten);
+                            });
+                    }
+                    else {
+                        THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                            THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+                    }
+                }
+
+                virtual void Flush (
+                        THEKOGANS_UTIL_HANDLE handle,
+                        bool dataOnly,
+                        RunLoop::SharedPtr runLoop,
+                        const Callback &callback,
+                        bool /*submit*/) override {
+                    if (handle != THEKOGANS_UTIL_INVALID_HANDLE_VALUE) {
+                        jobQueue.EnqJob (
+                            [handle, dataOnly, runLoop, callback] (
+                                    const RunLoop::LambdaJob & /*job*/,
+                                    const std::atomic<bool> & /*done*/) {
+                                DispatchCallback (runLoop, callback, Sync (handle, dataOnly), 0);
+                            });
+                    }
+                    else {
+                        THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                            THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+                    }
+                }
+
+                // Requests are handed to the workers as soon as they arrive.
+                virtual void Submit () override {}
+            };
+
+        #if defined (TOOLCHAIN_OS_Linux)
+            struct IORingAsyncIOService :
+                    public AsyncIOService,
+                    public Thread {
+                os::linux::IORing ring;
+                // Serializes the submission side of the ring.
+                Mutex mutex;
+                std::atomic<bool> done;
+                std::atomic<std::size_t> inFlight;
+
+                struct Request : public os::linux::IORing::Request {
+                    IORingAsyncIOService &service;
+                    RunLoop::SharedPtr runLoop;
+                    Callback callback;
+
+                    Request (
+                        IORingAsyncIOService &service_,
+                        RunLoop::SharedPtr runLoop_,
+                        const Callback &callback_) :
+                        service (service_),
+                        runLoop (runLoop_),
+                        callback (callback_) {}
+
+                    virtual void Complete (i32 result) noexcept override {
+                        DispatchCallback (runLoop, callback,
+                            result < 0 ? (THEKOGANS_UTIL_ERROR_CODE)-result : 0,
+                            result < 0 ? 0 : (std::size_t)result);
+                        --service.inFlight;
+                        delete this;
+                    }
+                };
+
+                explicit IORingAsyncIOService (ui32 queueDepth) :
+                        Thread ("AsyncIOService"),
+                        ring (queueDepth),
+                        done (false),
+                        inFlight (0) {
+                    Thread::Create ();
+                }
+                virtual ~IORingAsyncIOService () {
+                    done = true;
+                    {
+                        LockGuard<Mutex> guard (mutex);
+                        ring.PrepNop (nullptr);
+                        ring.Submit ();
+                    }
+                    Wait ();
+                }
+
+                virtual bool IsIORing () const override {
+                    return true;
+                }
+
+                virtual void RegisterBuffers (const BufferList &buffers) override {
+                    std::vector<iovec> iovecs (buffers.size ());
+                    for (std::size_t i = 0, count = buffers.size (); i < count; ++i) {
+                        iovecs[i].iov_base = buffers[i].first;
+                        iovecs[i].iov_len = buffers[i].second;
+                    }
+                    LockGuard<Mutex> guard (mutex);
+                    if (!iovecs.empty ()) {
+                        ring.RegisterBuffers (iovecs.data (), (ui32)iovecs.size ());
+                    }
+                    else {
+                        ring.UnregisterBuffers ();
+                    }
+                }
+
+                virtual void Read (
+                        THEKOGANS_UTIL_HANDLE handle,
+                        ui64 offset,
+                        void *buffer,
+                        std::size_t count,
+                        ui32 bufferIndex,
+                        RunLoop::SharedPtr runLoop,
+                        const Callback &callback,
+                        bool submit) override {
+                    if (handle != THEKOGANS_UTIL_INVALID_HANDLE_VALUE &&
+                            buffer != nullptr && count > 0 && count <= UI32_MAX) {
+                        std::unique_ptr<Request> request (new Request (*this, runLoop, callback));
+                        LockGuard<Mutex> guard (mutex);
+                        ring.PrepRead (handle, buffer, (ui32)count,
+                            offset, bufferIndex, request.get ());
+                        ++inFlight;
+                        request.release ();
+                        if (submit) {
+                            ring.Submit ();
+                        }
+                    }
+                    else {
+                        THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                            THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+                    }
+                }
+
+                virtual void Write (
+                        THEKOGANS_UTIL_HANDLE handle,
+                        ui64 offset,
+                        const void *buffer,
+                        std::size_t count,
+                        ui32 bufferIndex,
+                        RunLoop::SharedPtr runLoop,
+                        const Callback &callback,
+                        bool submit) override {
+                    if (handle != THEKOGANS_UTIL_INVALID_HANDLE_VALUE &&
+                            buffer != nullptr && count > 0 && count <= UI32_MAX) {
+                        std::unique_ptr<Request> request (new Request (*this, runLoop, callback));
+                        LockGuard<Mutex> guard (mutex);
+                        ring.PrepWrite (handle, buffer, (ui32)count,
+                            offset, bufferIndex, request.get ());
+                        ++inFlight;
+                        request.release ();
+                        if (submit) {
+                            ring.Submit ();
+                        }
+                    }
+                    else {
+                        THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                            THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+                    }
+                }
+
+                virtual void Flush (
+                        THEKOGANS_UTIL_HANDLE handle,
+                        bool dataOnly,
+                        RunLoop::SharedPtr runLoop,
+                        const Callback &callback,
+                        bool submit) override {
+                    if (handle != THEKOGANS_UTIL_INVALID_HANDLE_VALUE) {
+                        std::unique_ptr<Request> request (new Request (*this, runLoop, callback));
+                        LockGuard<Mutex> guard (mutex);
+                        ring.PrepFsync (handle, dataOnly, request.get ());
+                        ++inFlight;
+                        request.release ();
+                        if (submit) {
+                            ring.Submit ();
+                        }
+                    }
+                    else {
+                        THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                            THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+                    }
+                }
+
+                virtual void Submit () override {
+                    LockGuard<Mutex> guard (mutex);
+                    ring.Submit ();
+                }
+
+                // Thread
+                virtual void Run () noexcept override {
+                    // Drain requests still in flight before exiting
+                    // so that every callback gets called exactly once.
+                    while (!done || inFlight > 0) {
+                        THEKOGANS_UTIL_TRY {
+                            ring.ReapCompletions ();
+                        }
+                        THEKOGANS_UTIL_CATCH_AND_LOG_SUBSYSTEM (THEKOGANS_UTIL)
+                    }
+                }
+            };
+        #endif // defined (TOOLCHAIN_OS_Linux)
+        }
+
+        AsyncIOService::SharedPtr AsyncIOService::Create (
+                ui32 queueDepth,
+                std::size_t workerCount,
+                bool useIORing) {
+        #if defined (TOOLCHAIN_OS_Linux)
+            if (useIORing && os::linux::IORing::IsSupported ()) {
+                return SharedPtr (new IORingAsyncIOService (queueDepth));
+            }
+        #else // defined (TOOLCHAIN_OS_Linux)
+            (void)queueDepth;
+            (void)useIORing;
+        #endif // defined (TOOLCHAIN_OS_Linux)
+            return SharedPtr (new JobQueueAsyncIOService (workerCount));
+        }
+
+    } // namespace util
+} // namespace thekogans
@@ -28,6 +28,7 @@
 #include "thekogans/util/XMLUtils.h"
 #include "thekogans/util/Base64.h"
 #include "thekogans/util/Buffer.h"
+#include "thekogans/util/BufferChain.h"
 
 namespace thekogans {
     namespace util {
@@ -44,7 +45,7 @@ namespace thekogans {
             SecureAllocator::Instance ())
 
         Buffer::Buffer (const Buffer &other) :
-                Serializer (other.endianness),
+                Serializer (other.endianness, this, this),
                 data ((ui8 *)other.allocator->Alloc (other.length)),
                 length (other.length),
                 readOffset (other.readOffset),
@@ -62,7 +63,7 @@ namespace thekogans {
                 std::size_t readOffset_,
                 std::size_t writeOffset_,
                 Allocator::SharedPtr allocator_) :
-                Serializer (endianness),
+                Serializer (endianness, this, this),
                 data ((ui8 *)allocator_->Alloc ((const ui8 *)end - (const ui8 *)begin)),
                 length ((const ui8 *)end - (const ui8 *)begin),
                 readOffset (readOffset_),
@@ -191,6 +192,25 @@ namespace thekogans {
             }
         }
 
+        void Buffer::Wrap (const ByteView &view) {
+            Resize (0);
+            data = const_cast<ui8 *> (view.data);
+            length = view.size ();
+            readOffset = 0;
+            writeOffset = length;
+            allocator = NullAllocator::Instance ();
+        }
+
+        void Buffer::Unwrap (Allocator::SharedPtr allocator_) {
+            if (dynamic_cast<NullAllocator *> (allocator.Get ()) != nullptr) {
+                data = nullptr;
+                length = 0;
+                readOffset = 0;
+                writeOffset = 0;
+                allocator = allocator_;
+            }
+        }
+
         Buffer::SharedPtr Buffer::Clone (Allocator::SharedPtr allocator_) const {
             return SharedPtr (
                 new Buffer (
@@ -258,61 +278,101 @@ namespace thekogans {
         }
 
         namespace {
+            // Size of the intermediate zlib output chunks.
+            const std::size_t ZLIB_CHUNK_SIZE = 64 * 1024;
+
             struct OutBuffer {
                 Allocator::SharedPtr allocator;
                 ui8 *data;
                 std::size_t length;
+                std::size_t capacity;
 
                 explicit OutBuffer (Allocator::SharedPtr allocator_) :
                     allocator (allocator_),
                     data (nullptr),
-                    length (0) {}
+                    length (0),
+                    capacity (0) {}
 
                 void Write (
                         const ui8 *data_,
                         std::size_t length_) {
                     if (data_ != nullptr && length_ > 0) {
-                        ui8 *newData = (ui8 *)allocator->Alloc (length + length_);
-                        memcpy (newData, data, length);
-                        memcpy (newData + length, data_, length_);
-                        allocator->Free (data, length);
-                        data = newData;
+                        if (length + length_ > capacity) {
+                            // Grow geometrically to keep the copying linear.
+                            Reallocate ((std::max) (length + length_, capacity * 2));
+                        }
+                        memcpy (data + length, data_, length_);
                         length += length_;
                     }
                 }
+
+                // The Buffer taking over data frees length bytes.
+                void Shrink () {
+                    if (capacity != length) {
+                        Reallocate (length);
+                    }
+                }
+
+                void Reallocate (std::size_t capacity_) {
+                    ui8 *newData = (ui8 *)allocator->Alloc (capacity_);
+                    if (length > 0) {
+                        memcpy (newData, data, length);
+                    }
+                    allocator->Free (data, capacity);
+                    data = newData;
+                    capacity = capacity_;
+                }
             };
 
+            // Deflate/Inflate gather their input from a list of views. A
+            // plain Buffer is a list of one, a \see{BufferChain} is a list
+            // of its segments.
+
+            std::size_t GetViewsLength (
+                    const ByteView *views,
+                    std::size_t viewCount) {
+                std::size_t length = 0;
+                for (std::size_t i = 0; i < viewCount; ++i) {
+                    length += views[i].length;
+                }
+                return length;
+            }
+
             void DeflateHelper (
-                    const ui8 *data,
-                    std::size_t length,
+                    const ByteView *views,
+                    std::size_t viewCount,
                     OutBuffer &outBuffer) {
+                std::size_t length =
+                    (std::min) (GetViewsLength (views, viewCount), ZLIB_CHUNK_SIZE);
                 std::vector<ui8> tmpOutBuffer (length);
                 z_stream zStream;
                 zStream.zalloc = 0;
                 zStream.zfree = 0;
                 zStream.opaque = 0;
-                zStream.next_in = (Bytef *)data;
-                zStream.avail_in = (uInt)length;
                 zStream.next_out = tmpOutBuffer.data ();
                 zStream.avail_out = (uInt)length;
                 deflateInit (&zStream, Z_BEST_COMPRESSION);
-                while (zStream.avail_in != 0) {
-                    int result = deflate (&zStream, Z_NO_FLUSH);
-                    if (result != Z_OK) {
-                        if (zStream.msg != 0) {
-                            THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
-                                zStream.msg);
+                for (std::size_t i = 0; i < viewCount; ++i) {
+                    zStream.next_in = (Bytef *)views[i].data;
+                    zStream.avail_in = (uInt)views[i].length;
+                    while (zStream.avail_in != 0) {
+                        int result = deflate (&zStream, Z_NO_FLUSH);
+                        if (result != Z_OK) {
+                            if (zStream.msg != 0) {
+                                THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                                    zStream.msg);
+                            }
+                            else {
+                                THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                                    "%d", result);
+                            }
                         }
-                        else {
-                            THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
-                                "%d", result);
+                        if (zStream.avail_out == 0) {
+                            outBuffer.Write (tmpOutBuffer.data (), length);
+                            zStream.next_out = tmpOutBuffer.data ();
+                            zStream.avail_out = (uInt)length;
                         }
                     }
-                    if (zStream.avail_out == 0) {
-                        outBuffer.Write (tmpOutBuffer.data (), length);
-                        zStream.next_out = tmpOutBuffer.data ();
-                        zStream.avail_out = (uInt)length;
-                    }
                 }
                 int result = Z_OK;
                 while (result == Z_OK) {
@@ -325,20 +385,22 @@ namespace thekogans {
                 }
                 assert (result == Z_STREAM_END);
                 outBuffer.Write (tmpOutBuffer.data (), length - zStream.avail_out);
+                outBuffer.Shrink ();
                 deflateEnd (&zStream);
             }
 
             void InflateHelper (
-                    const ui8 *data,
-                    std::size_t length,
+                    const ByteView *views,
+                    std::size_t viewCount,
                     OutBuffer &outBuffer) {
-                std::vector<ui8> tmpOutBuffer (length * 2);
+                std::vector<ui8> tmpOutBuffer (
+                    (std::min) (GetViewsLength (views, viewCount) * 2, ZLIB_CHUNK_SIZE));
                 z_stream zStream;
                 zStream.zalloc = 0;
                 zStream.zfree = 0;
                 zStream.opaque = 0;
-                zStream.next_in = (Bytef *)data;
-                zStream.avail_in = (uInt)tmpOutBuffer.size ();
+                zStream.next_in = 0;
+                zStream.avail_in = 0;
                 int result = inflateInit (&zStream);
                 if (result != Z_OK) {
                     if (zStream.msg != 0) {
@@ -350,15 +412,33 @@ namespace thekogans {
                             "%d", result);
                     }
                 }
-                do {
-                    zStream.next_out = tmpOutBuffer.data ();
-                    zStream.avail_out = (uInt)tmpOutBuffer.size ();
-                    result = inflate (&zStream, Z_NO_FLUSH);
-                    assert (result != Z_STREAM_ERROR);
-                    outBuffer.Write (
-                        tmpOutBuffer.data (),
-                        tmpOutBuffer.size () - zStream.avail_out);
-                } while (zStream.avail_out == 0);
+                for (std::size_t i = 0; i < viewCount && result != Z_STREAM_END; ++i) {
+                    zStream.next_in = (Bytef *)views[i].data;
+                    zStream.avail_in = (uInt)views[i].length;
+                    do {
+                        zStream.next_out = tmpOutBuffer.data ();
+                        zStream.avail_out = (uInt)tmpOutBuffer.size ();
+                        result = inflate (&zStream, Z_NO_FLUSH);
+                        // Z_BUF_ERROR only means no progress was possible
+                        // (this view is exhausted). Move on to the next.
+                        if (result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR) {
+                            std::string message = zStream.msg != 0 ?
+                                std::string (zStream.msg) : FormatString ("%d", result);
+                            inflateEnd (&zStream);
+                            THEKOGANS_UTIL_THROW_STRING_EXCEPTION ("%s", message.c_str ());
+                        }
+                        outBuffer.Write (
+                            tmpOutBuffer.data (),
+                            tmpOutBuffer.size () - zStream.avail_out);
+                    } while (zStream.avail_out == 0 && result != Z_STREAM_END);
+                }
+                // Ran out of views before the end of the stream.
+                if (result != Z_STREAM_END) {
+                    inflateEnd (&zStream);
+                    THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                        "Truncated deflate stream.");
+                }
+                outBuffer.Shrink ();
                 result = inflateEnd (&zStream);
                 assert (result == Z_OK);
             }
@@ -370,10 +450,8 @@ namespace thekogans {
                     allocator_ = allocator;
                 }
                 OutBuffer outBuffer (allocator_);
-                DeflateHelper (
-                    GetReadPtr (),
-                    GetDataAvailableForReading (),
-                    outBuffer);
+                ByteView view = GetReadView ();
+                DeflateHelper (&view, 1, outBuffer);
                 return SharedPtr (
                     new Buffer (
                         endianness,
@@ -392,10 +470,8 @@ namespace thekogans {
                     allocator_ = allocator;
                 }
                 OutBuffer outBuffer (allocator_);
-                InflateHelper (
-                    GetReadPtr (),
-                    GetDataAvailableForReading (),
-                    outBuffer);
+                ByteView view = GetReadView ();
+                InflateHelper (&view, 1, outBuffer);
                 return SharedPtr (
                     new Buffer (
                         endianness,
@@ -408,6 +484,44 @@ namespace thekogans {
             return nullptr;
         }
 
+        Buffer::SharedPtr Buffer::Deflate (
+                const BufferChain &chain,
+                Allocator::SharedPtr allocator) {
+            if (chain.GetDataAvailableForReading () != 0) {
+                std::vector<ByteView> views = chain.GetViews ();
+                OutBuffer outBuffer (allocator);
+                DeflateHelper (views.data (), views.size (), outBuffer);
+                return SharedPtr (
+                    new Buffer (
+                        chain.endianness,
+                        outBuffer.data,
+                        outBuffer.length,
+                        0,
+                        outBuffer.length,
+                        allocator));
+            }
+            return nullptr;
+        }
+
+        Buffer::SharedPtr Buffer::Inflate (
+                const BufferChain &chain,
+                Allocator::SharedPtr allocator) {
+            if (chain.GetDataAvailableForReading () != 0) {
+                std::vector<ByteView> views = chain.GetViews ();
+                OutBuffer outBuffer (allocator);
+                InflateHelper (views.data (), views.size (), outBuffer);
+                return SharedPtr (
+                    new Buffer (
+                        chain.endianness,
+                        outBuffer.data,
+                        outBuffer.length,
+                        0,
+                        outBuffer.length,
+                        allocator));
+            }
+            return nullptr;
+        }
+
         Buffer::SharedPtr Buffer::FromHexBuffer (
                 Endianness endianness,
                 const char *hexBuffer,
@@ -502,10 +616,8 @@ namespace thekogans {
         Buffer::SharedPtr SecureBuffer::Deflate (Allocator::SharedPtr /*allocator*/) const {
             if (GetDataAvailableForReading () != 0) {
                 OutBuffer outBuffer (SecureAllocator::Instance ());
-                DeflateHelper (
-                    GetReadPtr (),
-                    GetDataAvailableForReading (),
-                    outBuffer);
+                ByteView view = GetReadView ();
+                DeflateHelper (&view, 1, outBuffer);
                 return SharedPtr (
                     new SecureBuffer (
                         endianness,
@@ -520,7 +632,8 @@ namespace thekogans {
         Buffer::SharedPtr SecureBuffer::Inflate (Allocator::SharedPtr /*allocator*/) const {
             if (GetDataAvailableForReading () != 0) {
                 OutBuffer outBuffer (SecureAllocator::Instance ());
-                InflateHelper (GetReadPtr (), GetDataAvailableForReading (), outBuffer);
+                ByteView view = GetReadView ();
+                InflateHelper (&view, 1, outBuffer);
                 return SharedPtr (
                     new SecureBuffer (
                         endianness,
@@ -567,15 +680,21 @@ namespace thekogans {
             if (allocator == nullptr) {
                 allocator = DefaultAllocator::Instance ();
             }
-            buffer.Resize (length, allocator);
-            if (length > 0) {
-                std::size_t bytesRead = serializer.Read (buffer.data, length);
-                if (length != bytesRead) {
-                    THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
-                        "serializer.Read (buffer.data, "
-                        THEKOGANS_UTIL_SIZE_T_FORMAT ") == " THEKOGANS_UTIL_SIZE_T_FORMAT,
-                        length,
-                        bytesRead);
+            if (serializer.IsBorrowing ()) {
+                buffer.Wrap (serializer.Borrow (length));
+            }
+            else {
+                buffer.Unwrap (allocator);
+                buffer.Resize (length, allocator);
+                if (length > 0) {
+                    std::size_t bytesRead = serializer.Read (buffer.data, length);
+                    if (length != bytesRead) {
+                        THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                            "serializer.Read (buffer.data, "
+                            THEKOGANS_UTIL_SIZE_T_FORMAT ") == " THEKOGANS_UTIL_SIZE_T_FORMAT,
+                            length,
+                            bytesRead);
+                    }
                 }
             }
             buffer.endianness = endianness;
@@ -0,0 +1,510 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#include "thekogans/util/Environment.h"
+#if defined (TOOLCHAIN_OS_Windows)
+    #include "thekogans/util/os/windows/WindowsHeader.h"
+#else // defined (TOOLCHAIN_OS_Windows)
+    #include <sys/uio.h>
+    #include <unistd.h>
+    #include <climits>
+    #include <cerrno>
+#endif // defined (TOOLCHAIN_OS_Windows)
+#include <cstring>
+#include <algorithm>
+#include "thekogans/util/Heap.h"
+#include "thekogans/util/SpinLock.h"
+#include "thekogans/util/NullAllocator.h"
+#include "thekogans/util/Exception.h"
+#include "thekogans/util/BufferChain.h"
+
+namespace thekogans {
+    namespace util {
+
+        THEKOGANS_UTIL_IMPLEMENT_DYNAMIC_CREATABLE (
+            thekogans::util::BufferChain,
+            Serializer::TYPE)
+
+        struct BufferChain::SliceBuffer : public Buffer {
+            /// \brief
+            /// SliceBuffer has a private heap to help with memory
+            /// management, performance, and global heap fragmentation.
+            THEKOGANS_UTIL_DECLARE_STD_ALLOCATOR_FUNCTIONS
+
+            /// \brief
+            /// The \see{Buffer} that owns the bytes (never another slice).
+            Buffer::SharedPtr owner;
+
+            /// \brief
+            /// ctor.
+            /// \param[in] owner_ The \see{Buffer} that owns the bytes.
+            /// \param[in] data_ Start of the window.
+            /// \param[in] length_ Window length.
+            SliceBuffer (
+                Buffer::SharedPtr owner_,
+                const ui8 *data_,
+                std::size_t length_) :
+                Buffer (
+                    owner_->endianness,
+                    const_cast<ui8 *> (data_),
+                    length_,
+                    0,
+                    length_,
+                    NullAllocator::Instance ()),
+                owner (owner_) {}
+
+            /// \brief
+            /// Return the \see{Buffer} that owns the given segment's bytes.
+            /// \param[in] segment Segment whose owner to return.
+            /// \return The \see{Buffer} that owns the given segment's bytes.
+            static Buffer::SharedPtr GetOwner (Buffer::SharedPtr segment) {
+                SliceBuffer *slice = dynamic_cast<SliceBuffer *> (segment.Get ());
+                return slice != nullptr ? slice->owner : segment;
+            }
+
+            /// \brief
+            /// Return a window in to the given segment's bytes.
+            /// \param[in] segment Segment to slice.
+            /// \param[in] data Start of the window.
+            /// \param[in] length Window length.
+            /// \return A window in to the given segment's bytes.
+            static Buffer::SharedPtr Slice (
+                    Buffer::SharedPtr segment,
+                    const ui8 *data,
+                    std::size_t length) {
+                return Buffer::SharedPtr (new SliceBuffer (GetOwner (segment), data, length));
+            }
+        };
+
+        THEKOGANS_UTIL_IMPLEMENT_HEAP_FUNCTIONS (BufferChain::SliceBuffer)
+
+        BufferChain::BufferChain (
+                Endianness endianness,
+                std::size_t segmentSize_,
+                Allocator::SharedPtr allocator_) :
+                Serializer (endianness),
+                segmentSize (segmentSize_),
+                allocator (allocator_),
+                ownTail (false) {
+            if (segmentSize == 0 || allocator == nullptr) {
+                THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                    THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+            }
+        }
+
+        std::size_t BufferChain::GetDataAvailableForReading () const {
+            std::size_t count = 0;
+            for (std::size_t i = 0, segmentCount = segments.size (); i < segmentCount; ++i) {
+                count += segments[i]->GetDataAvailableForReading ();
+            }
+            return count;
+        }
+
+        std::vector<ByteView> BufferChain::GetViews () const {
+            std::vector<ByteView> views;
+            views.reserve (segments.size ());
+            for (std::size_t i = 0, segmentCount = segments.size (); i < segmentCount; ++i) {
+                if (segments[i]->GetDataAvailableForReading () > 0) {
+                    views.push_back (segments[i]->GetReadView ());
+                }
+            }
+            return views;
+        }
+
+        void BufferChain::Append (Buffer::SharedPtr buffer) {
+            if (buffer != nullptr) {
+                segments.push_back (buffer);
+                ownTail = false;
+            }
+            else {
+                THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                    THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+            }
+        }
+
+        void BufferChain::Append (BufferChain &chain) {
+            if (&chain != this) {
+                if (!chain.segments.empty ()) {
+                    segments.insert (
+                        segments.end (),
+                        chain.segments.begin (),
+                        chain.segments.end ());
+                    ownTail = chain.ownTail;
+                    chain.Clear ();
+                }
+            }
+            else {
+                THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                    THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+            }
+        }
+
+        void BufferChain::Prepend (Buffer::SharedPtr buffer) {
+            if (buffer != nullptr) {
+                if (segments.empty ()) {
+                    ownTail = false;
+                }
+                segments.push_front (buffer);
+            }
+            else {
+                THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                    THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+            }
+        }
+
+        void BufferChain::Prepend (BufferChain &chain) {
+            if (&chain != this) {
+                if (!chain.segments.empty ()) {
+                    if (segments.empty ()) {
+                        ownTail = chain.ownTail;
+                    }
+                    segments.insert (
+                        segments.begin (),
+                        chain.segments.begin (),
+                        chain.segments.end ());
+                    chain.Clear ();
+                }
+            }
+            else {
+                THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                    THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+            }
+        }
+
+        BufferChain::SharedPtr BufferChain::Split (std::size_t count) {
+            if (count > GetDataAvailableForReading ()) {
+                THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                    THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+            }
+            SharedPtr chain (new BufferChain (endianness, segmentSize, allocator));
+            while (count > 0) {
+                Buffer::SharedPtr segment = segments.front ();
+                std::size_t availableForReading = segment->GetDataAvailableForReading ();
+                if (availableForReading <= count) {
+                    chain->segments.push_back (segment);
+                    segments.pop_front ();
+                    if (segments.empty ()) {
+                        ownTail = false;
+                    }
+                    count -= availableForReading;
+                }
+                else {
+                    // Both chains share the straddling segment's bytes.
+                    chain->segments.push_back (SliceBuffer::Slice (segment, segment->GetReadPtr (), count));
+                    segment->AdvanceReadOffset (count);
+                    count = 0;
+                }
+            }
+            return chain;
+        }
+
+        Buffer::SharedPtr BufferChain::Coalesce () {
+            std::vector<ByteView> views = GetViews ();
+            if (views.empty ()) {
+                Clear ();
+                return nullptr;
+            }
+            Buffer::SharedPtr buffer;
+            if (views.size () == 1) {
+                for (std::size_t i = 0, segmentCount = segments.size (); i < segmentCount; ++i) {
+                    if (segments[i]->GetDataAvailableForReading () > 0) {
+                        buffer = segments[i];
+                        break;
+                    }
+                }
+            }
+            else {
+                // If all the segments are back to back pieces of the same
+                // Buffer (what Split leaves behind), stitch them back together.
+                Buffer::SharedPtr owner;
+                bool contiguous = true;
+                for (std::size_t i = 0, segmentCount = segments.size (); i < segmentCount; ++i) {
+                    if (segments[i]->GetDataAvailableForReading () > 0) {
+                        if (owner == nullptr) {
+                            owner = SliceBuffer::GetOwner (segments[i]);
+                        }
+                        else if (owner != SliceBuffer::GetOwner (segments[i])) {
+                            contiguous = false;
+                            break;
+                        }
+                    }
+                }
+                std::size_t length = views[0].length;
+                for (std::size_t i = 1, viewCount = views.size (); i < viewCount; ++i) {
+                    if (views[i - 1].end () != views[i].begin ()) {
+                        contiguous = false;
+                    }
+                    length += views[i].length;
+                }
+                if (contiguous) {
+                    buffer = SliceBuffer::Slice (owner, views[0].data, length);
+                }
+                else {
+                    buffer.Reset (new Buffer (endianness, length, 0, 0, allocator));
+                    for (std::size_t i = 0, viewCount = views.size (); i < viewCount; ++i) {
+                        buffer->Write (views[i].data, views[i].length);
+                    }
+                }
+            }
+            segments.clear ();
+            segments.push_back (buffer);
+            ownTail = false;
+            return buffer;
+        }
+
+        void BufferChain::Clear () {
+            segments.clear ();
+            ownTail = false;
+        }
+
+        namespace {
+        #if !defined (TOOLCHAIN_OS_Windows)
+        #if defined (IOV_MAX)
+            const std::size_t MAX_IOVECS = IOV_MAX;
+        #else // defined (IOV_MAX)
+            const std::size_t MAX_IOVECS = 1024;
+        #endif // defined (IOV_MAX)
+
+            // Build (at most MAX_IOVECS) iovecs out of the chain's readable bytes.
+            std::vector<iovec> GetIOVecs (const std::vector<ByteView> &views) {
+                std::vector<iovec> iovecs ((std::min) (views.size (), MAX_IOVECS));
+                for (std::size_t i = 0, count = iovecs.size (); i < count; ++i) {
+                    iovecs[i].iov_base = const_cast<ui8 *> (views[i].data);
+                    iovecs[i].iov_len = views[i].length;
+                }
+                return iovecs;
+            }
+        #endif // !defined (TOOLCHAIN_OS_Windows)
+        }
+
+        std::size_t BufferChain::WriteTo (THEKOGANS_UTIL_HANDLE handle) {
+            std::size_t countWritten = 0;
+            for (std::vector<ByteView> views = GetViews ();
+                    !views.empty (); views = GetViews ()) {
+            #if defined (TOOLCHAIN_OS_Windows)
+                DWORD count = 0;
+                if (!WriteFile (handle, views[0].data, (DWORD)views[0].length, &count, 0)) {
+                    THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                        THEKOGANS_UTIL_OS_ERROR_CODE);
+                }
+            #else // defined (TOOLCHAIN_OS_Windows)
+                std::vector<iovec> iovecs = GetIOVecs (views);
+                ssize_t count;
+                do {
+                    count = writev (handle, iovecs.data (), (int)iovecs.size ());
+                } while (count < 0 && THEKOGANS_UTIL_OS_ERROR_CODE == EINTR);
+                if (count < 0) {
+                    THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                        THEKOGANS_UTIL_OS_ERROR_CODE);
+                }
+            #endif // defined (TOOLCHAIN_OS_Windows)
+                if (count == 0) {
+                    break;
+                }
+                Consume ((std::size_t)count);
+                countWritten += (std::size_t)count;
+            }
+            return countWritten;
+        }
+
+        std::size_t BufferChain::WriteTo (
+                THEKOGANS_UTIL_HANDLE handle,
+                ui64 offset) {
+            std::size_t countWritten = 0;
+            for (std::vector<ByteView> views = GetViews ();
+                    !views.empty (); views = GetViews ()) {
+            #if defined (TOOLCHAIN_OS_Windows)
+                ui64 position = offset + countWritten;
+                OVERLAPPED overlapped;
+                memset (&overlapped, 0, sizeof (overlapped));
+                overlapped.Offset = (DWORD)position;
+                overlapped.OffsetHigh = (DWORD)(position >> 32);
+                DWORD count = 0;
+                if (!WriteFile (handle, views[0].data, (DWORD)views[0].length, &count, &overlapped)) {
+                    THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                        THEKOGANS_UTIL_OS_ERROR_CODE);
+                }
+            #else // defined (TOOLCHAIN_OS_Windows)
+                ssize_t count;
+            #if defined (TOOLCHAIN_OS_Linux)
+                std::vector<iovec> iovecs = GetIOVecs (views);
+                do {
+                    count = pwritev (handle, iovecs.data (), (int)iovecs.size (),
+                        (off_t)(offset + countWritten));
+                } while (count < 0 && THEKOGANS_UTIL_OS_ERROR_CODE == EINTR);
+            #else // defined (TOOLCHAIN_OS_Linux)
+                // pwritev is not available everywhere.
+                do {
+                    count = pwrite (handle, views[0].data, views[0].length,
+                        (off_t)(offset + countWritten));
+                } while (count < 0 && THEKOGANS_UTIL_OS_ERROR_CODE == EINTR);
+            #endif // defined (TOOLCHAIN_OS_Linux)
+                if (count < 0) {
+                    THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                        THEKOGANS_UTIL_OS_ERROR_CODE);
+                }
+            #endif // defined (TOOLCHAIN_OS_Windows)
+                if (count == 0) {
+                    break;
+                }
+                Consume ((std::size_t)count);
+                countWritten += (std::size_t)count;
+            }
+            return countWritten;
+        }
+
+        std::size_t BufferChain::ReadFrom (
+                THEKOGANS_UTIL_HANDLE handle,
+                std::size_t count) {
+            if (count == 0) {
+                return 0;
+            }
+            // Scatter in to what's left of our own tail segment,
+            // and a new segment for the rest.
+            Buffer::SharedPtr tail;
+            std::size_t tailCount = 0;
+            if (ownTail) {
+                tail = segments.back ();
+                tailCount = (std::min) (count, tail->GetDataAvailableForWriting ());
+            }
+            Buffer::SharedPtr segment;
+            if (tailCount < count) {
+                segment.Reset (
+                    new Buffer (
+                        endianness,
+                        (std::max) (segmentSize, count - tailCount),
+                        0,
+                        0,
+                        allocator));
+            }
+        #if defined (TOOLCHAIN_OS_Windows)
+            std::size_t countRead = 0;
+            if (tailCount > 0) {
+                DWORD result = 0;
+                if (!ReadFile (handle, tail->GetWritePtr (), (DWORD)tailCount, &result, 0)) {
+                    THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                        THEKOGANS_UTIL_OS_ERROR_CODE);
+                }
+                countRead = result;
+            }
+            if (segment != nullptr && countRead == tailCount) {
+                DWORD result = 0;
+                if (!ReadFile (handle, segment->GetWritePtr (),
+                        (DWORD)(count - tailCount), &result, 0)) {
+                    THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                        THEKOGANS_UTIL_OS_ERROR_CODE);
+                }
+                countRead += result;
+            }
+        #else // defined (TOOLCHAIN_OS_Windows)
+            iovec iovecs[2];
+            int iovecCount = 0;
+            if (tailCount > 0) {
+                iovecs[iovecCount].iov_base = tail->GetWritePtr ();
+                iovecs[iovecCount++].iov_len = tailCount;
+            }
+            if (segment != nullptr) {
+                iovecs[iovecCount].iov_base = segment->GetWritePtr ();
+                iovecs[iovecCount++].iov_len = count - tailCount;
+            }
+            ssize_t result;
+            do {
+                result = readv (handle, iovecs, iovecCount);
+            } while (result < 0 && THEKOGANS_UTIL_OS_ERROR_CODE == EINTR);
+            if (result < 0) {
+                THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                    THEKOGANS_UTIL_OS_ERROR_CODE);
+            }
+            std::size_t countRead = (std::size_t)result;
+        #endif // defined (TOOLCHAIN_OS_Windows)
+            if (tailCount > 0) {
+                tail->AdvanceWriteOffset ((std::min) (countRead, tailCount));
+            }
+            if (segment != nullptr && countRead > tailCount) {
+                segment->AdvanceWriteOffset (countRead - tailCount);
+                segments.push_back (segment);
+                ownTail = true;
+            }
+            return countRead;
+        }
+
+        std::size_t BufferChain::Read (
+                void *buffer,
+                std::size_t count) {
+            if (buffer != nullptr && count > 0) {
+                ui8 *ptr = (ui8 *)buffer;
+                std::size_t countRead = 0;
+                while (countRead < count && !segments.empty ()) {
+                    countRead += segments.front ()->Read (ptr + countRead, count - countRead);
+                    if (segments.front ()->GetDataAvailableForReading () == 0) {
+                        segments.pop_front ();
+                        if (segments.empty ()) {
+                            ownTail = false;
+                        }
+                    }
+                }
+                return countRead;
+            }
+            else {
+                THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                    THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+            }
+        }
+
+        std::size_t BufferChain::Write (
+                const void *buffer,
+                std::size_t count) {
+            if (buffer != nullptr && count > 0) {
+                const ui8 *ptr = (const ui8 *)buffer;
+                std::size_t countWritten = 0;
+                while (countWritten < count) {
+                    if (!ownTail || segments.back ()->GetDataAvailableForWriting () == 0) {
+                        segments.push_back (
+                            Buffer::SharedPtr (
+                                new Buffer (
+                                    endianness,
+                                    (std::max) (segmentSize, count - countWritten),
+                                    0,
+                                    0,
+                                    allocator)));
+                        ownTail = true;
+                    }
+                    countWritten += segments.back ()->Write (
+                        ptr + countWritten, count - countWritten);
+                }
+                return countWritten;
+            }
+            else {
+                THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                    THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+            }
+        }
+
+        void BufferChain::Consume (std::size_t count) {
+            while (count > 0 && !segments.empty ()) {
+                count -= segments.front ()->AdvanceReadOffset (count);
+                if (segments.front ()->GetDataAvailableForReading () == 0) {
+                    segments.pop_front ();
+                    if (segments.empty ()) {
+                        ownTail = false;
+                    }
+                }
+            }
+        }
+
+    } // namespace util
+} // namespace thekogans
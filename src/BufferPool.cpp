@@ -0,0 +1,296 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include "thekogans/util/Heap.h"
+#include "thekogans/util/LockGuard.h"
+#include "thekogans/util/SecureAllocator.h"
+#include "thekogans/util/Exception.h"
+#include "thekogans/util/BufferPool.h"
+
+namespace thekogans {
+    namespace util {
+
+    #if !defined (THEKOGANS_UTIL_BUFFER_POOL_CACHE_COUNT)
+        #define THEKOGANS_UTIL_BUFFER_POOL_CACHE_COUNT 16
+    #endif // !defined (THEKOGANS_UTIL_BUFFER_POOL_CACHE_COUNT)
+
+    #if !defined (THEKOGANS_UTIL_BUFFER_POOL_CACHE_DEPTH)
+        #define THEKOGANS_UTIL_BUFFER_POOL_CACHE_DEPTH 8
+    #endif // !defined (THEKOGANS_UTIL_BUFFER_POOL_CACHE_DEPTH)
+
+        struct BufferPool::Buffer : public util::Buffer {
+            /// \brief
+            /// Buffer has a private heap to help with memory
+            /// management, performance, and global heap fragmentation.
+            THEKOGANS_UTIL_DECLARE_STD_ALLOCATOR_FUNCTIONS
+
+            /// \brief
+            /// BufferPool from which this buffer came.
+            BufferPool &bufferPool;
+            /// \brief
+            /// Index of the size class this buffer belongs to.
+            const std::size_t sizeClass;
+
+            /// \brief
+            /// ctor.
+            /// \param[in] bufferPool_ BufferPool from which this buffer came.
+            /// \param[in] sizeClass_ Index of the size class this buffer belongs to.
+            /// \param[in] endianness Buffer endianness.
+            /// \param[in] length Size class length.
+            Buffer (
+                BufferPool &bufferPool_,
+                std::size_t sizeClass_,
+                Endianness endianness,
+                std::size_t length) :
+                util::Buffer (endianness, length, 0, 0, bufferPool_.allocator),
+                bufferPool (bufferPool_),
+                sizeClass (sizeClass_) {}
+
+        protected:
+            // RefCounted
+            /// \brief
+            /// If there are no more references to this buffer,
+            /// release it back to the pool.
+            virtual void Harakiri () override {
+                bufferPool.ReleaseBuffer (this);
+            }
+
+            /// \brief
+            /// Buffer is neither copy constructable, nor assignable.
+            THEKOGANS_UTIL_DISALLOW_COPY_AND_ASSIGN (Buffer)
+        };
+
+        THEKOGANS_UTIL_IMPLEMENT_HEAP_FUNCTIONS (BufferPool::Buffer)
+
+        // Every thread adds and removes buffers from its own cache. The
+        // caches are cache line aligned so that threads don't false share.
+        // More threads than caches simply means some threads share a cache
+        // (the lock is there for that case, and for the odd buffer released
+        // on a thread other than the one it was acquired on).
+        struct BufferPool::Cache {
+            enum {
+                COUNT = THEKOGANS_UTIL_BUFFER_POOL_CACHE_COUNT,
+                DEPTH = THEKOGANS_UTIL_BUFFER_POOL_CACHE_DEPTH,
+                CACHE_LINE_SIZE = 64
+            };
+
+            struct alignas (CACHE_LINE_SIZE) Shard {
+                SpinLock spinLock;
+                std::vector<FreeList> freeLists;
+            } shards[COUNT];
+
+            explicit Cache (std::size_t sizeClassCount) {
+                for (std::size_t i = 0; i < COUNT; ++i) {
+                    shards[i].freeLists.resize (sizeClassCount);
+                }
+            }
+
+            // Threads are assigned shards round robin on first use.
+            inline Shard &GetShard () {
+                static std::atomic<std::size_t> next (0);
+                static thread_local std::size_t index =
+                    next.fetch_add (1, std::memory_order_relaxed) % COUNT;
+                return shards[index];
+            }
+        };
+
+        namespace {
+            std::size_t RoundUpToPowerOf2 (std::size_t value) {
+                std::size_t powerOf2 = 1;
+                while (powerOf2 < value) {
+                    powerOf2 <<= 1;
+                }
+                return powerOf2;
+            }
+        }
+
+        BufferPool::BufferPool (
+                std::size_t minSize_,
+                std::size_t maxSize_,
+                std::size_t maxIdleBytes_,
+                bool zeroOnReturn_,
+                Allocator::SharedPtr allocator_) :
+                minSize (RoundUpToPowerOf2 (minSize_)),
+                maxSize (RoundUpToPowerOf2 (maxSize_)),
+                maxIdleBytes (maxIdleBytes_),
+                zeroOnReturn (zeroOnReturn_),
+                allocator (allocator_),
+                sizeClassCount (0),
+                caches (nullptr),
+                idleBytes (0),
+                hits (0),
+                misses (0),
+                oversized (0),
+                discarded (0) {
+            if (minSize_ > 0 && minSize_ <= maxSize_ &&
+                    maxSize_ <= SIZE_T_MAX / 2 && allocator != nullptr) {
+                for (std::size_t size = minSize; size <= maxSize; size <<= 1) {
+                    ++sizeClassCount;
+                }
+                caches = new Cache (sizeClassCount);
+                freeLists.resize (sizeClassCount);
+            }
+            else {
+                THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                    THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+            }
+        }
+
+        BufferPool::~BufferPool () {
+            Flush ();
+            delete caches;
+        }
+
+        util::Buffer::SharedPtr BufferPool::GetBuffer (
+                Endianness endianness,
+                std::size_t length) {
+            std::size_t sizeClass = GetSizeClass (length);
+            if (sizeClass == sizeClassCount) {
+                ++oversized;
+                return util::Buffer::SharedPtr (
+                    new util::Buffer (endianness, length, 0, 0, allocator));
+            }
+            Buffer *buffer = nullptr;
+            {
+                Cache::Shard &shard = caches->GetShard ();
+                LockGuard<SpinLock> guard (shard.spinLock);
+                FreeList &freeList = shard.freeLists[sizeClass];
+                if (freeList.empty ()) {
+                    // Refill the cache with half a cache worth of buffers.
+                    LockGuard<SpinLock> guard (spinLock);
+                    FreeList &sharedFreeList = freeLists[sizeClass];
+                    std::size_t count =
+                        (std::min) (sharedFreeList.size (), (std::size_t)Cache::DEPTH / 2);
+                    freeList.insert (
+                        freeList.end (),
+                        sharedFreeList.end () - count,
+                        sharedFreeList.end ());
+                    sharedFreeList.resize (sharedFreeList.size () - count);
+                }
+                if (!freeList.empty ()) {
+                    buffer = freeList.back ();
+                    freeList.pop_back ();
+                }
+            }
+            if (buffer != nullptr) {
+                idleBytes -= buffer->length;
+                ++hits;
+                buffer->endianness = endianness;
+            }
+            else {
+                ++misses;
+                buffer = new Buffer (*this, sizeClass, endianness, minSize << sizeClass);
+            }
+            return util::Buffer::SharedPtr (buffer);
+        }
+
+        std::size_t BufferPool::GetSizeClassLength (std::size_t length) const {
+            std::size_t sizeClass = GetSizeClass (length);
+            return sizeClass < sizeClassCount ? minSize << sizeClass : 0;
+        }
+
+        void BufferPool::Flush () {
+            for (std::size_t i = 0; i < Cache::COUNT; ++i) {
+                Cache::Shard &shard = caches->shards[i];
+                LockGuard<SpinLock> guard (shard.spinLock);
+                for (std::size_t j = 0; j < sizeClassCount; ++j) {
+                    ClearFreeList (shard.freeLists[j]);
+                }
+            }
+            LockGuard<SpinLock> guard (spinLock);
+            for (std::size_t i = 0; i < sizeClassCount; ++i) {
+                ClearFreeList (freeLists[i]);
+            }
+        }
+
+        BufferPool::Stats BufferPool::GetStats () const {
+            Stats stats;
+            stats.hits = hits;
+            stats.misses = misses;
+            stats.oversized = oversized;
+            stats.discarded = discarded;
+            stats.idleBytes = idleBytes;
+            return stats;
+        }
+
+        std::size_t BufferPool::GetSizeClass (std::size_t length) const {
+            std::size_t sizeClass = 0;
+            for (std::size_t size = minSize; size < length; size <<= 1) {
+                if (++sizeClass == sizeClassCount) {
+                    break;
+                }
+            }
+            return sizeClass;
+        }
+
+        void BufferPool::ReleaseBuffer (Buffer *buffer) {
+            std::size_t length = minSize << buffer->sizeClass;
+            // A buffer that was resized (or wrapped) no longer
+            // fits its size class. Same goes for a full pool.
+            if (buffer->length != length ||
+                    buffer->allocator.Get () != allocator.Get () ||
+                    !ReserveIdleBytes (length)) {
+                ++discarded;
+                delete buffer;
+                return;
+            }
+            if (zeroOnReturn) {
+                SecureZeroMemory (buffer->data, buffer->length);
+            }
+            buffer->readOffset = buffer->writeOffset = 0;
+            buffer->compact = buffer->borrow = false;
+            Cache::Shard &shard = caches->GetShard ();
+            LockGuard<SpinLock> guard (shard.spinLock);
+            FreeList &freeList = shard.freeLists[buffer->sizeClass];
+            freeList.push_back (buffer);
+            if (freeList.size () > Cache::DEPTH) {
+                // Spill half the cache to the shared free list.
+                LockGuard<SpinLock> guard (spinLock);
+                std::size_t count = freeList.size () / 2;
+                FreeList &sharedFreeList = freeLists[buffer->sizeClass];
+                sharedFreeList.insert (
+                    sharedFreeList.end (),
+                    freeList.begin (),
+                    freeList.begin () + count);
+                freeList.erase (freeList.begin (), freeList.begin () + count);
+            }
+        }
+
+        bool BufferPool::ReserveIdleBytes (std::size_t length) {
+            // Check and add in one step. Otherwise concurrent
+            // releases could all pass the check and together
+            // take the pool past maxIdleBytes.
+            std::size_t current = idleBytes.load (std::memory_order_relaxed);
+            do {
+                if (current + length > maxIdleBytes) {
+                    return false;
+                }
+            } while (!idleBytes.compare_exchange_weak (current, current + length));
+            return true;
+        }
+
+        void BufferPool::ClearFreeList (FreeList &freeList) {
+            for (std::size_t i = 0, count = freeList.size (); i < count; ++i) {
+                idleBytes -= freeList[i]->length;
+                delete freeList[i];
+            }
+            freeList.clear ();
+        }
+
+    } // namespace util
+} // namespace thekogans
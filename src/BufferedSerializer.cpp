@@ -0,0 +1,241 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <cstring>
+#include <algorithm>
+#include "thekogans/util/Exception.h"
+#include "thekogans/util/LoggerMgr.h"
+#include "thekogans/util/BufferedSerializer.h"
+
+namespace thekogans {
+    namespace util {
+
+        THEKOGANS_UTIL_IMPLEMENT_DYNAMIC_CREATABLE_OVERRIDE (
+            thekogans::util::BufferedSerializer,
+            Serializer::TYPE, RandomSeekSerializer::TYPE)
+
+        BufferedSerializer::BufferedSerializer (
+                Serializer &serializer_,
+                Endianness endianness,
+                std::size_t bufferSize) :
+                RandomSeekSerializer (endianness),
+                serializer (serializer_),
+                randomSeekSerializer (dynamic_cast<RandomSeekSerializer *> (&serializer_)),
+                buffer (HostEndian, bufferSize),
+                state (Empty) {
+            if (bufferSize == 0) {
+                THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                    THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+            }
+        }
+
+        BufferedSerializer::~BufferedSerializer () {
+            THEKOGANS_UTIL_TRY {
+                Flush ();
+            }
+            THEKOGANS_UTIL_CATCH_AND_LOG_SUBSYSTEM (THEKOGANS_UTIL)
+        }
+
+        std::size_t BufferedSerializer::Read (
+                void *data,
+                std::size_t count) {
+            if (data != nullptr && count > 0) {
+                if (state == Writing) {
+                    Flush ();
+                }
+                ui8 *ptr = (ui8 *)data;
+                std::size_t countRead = 0;
+                while (count > 0) {
+                    std::size_t chunk = buffer.GetDataAvailableForReading ();
+                    if (chunk > 0) {
+                        chunk = (std::min) (chunk, count);
+                        memcpy (ptr, buffer.GetReadPtr (), chunk);
+                        buffer.AdvanceReadOffset (chunk);
+                    }
+                    else {
+                        buffer.Rewind ();
+                        state = Empty;
+                        if (count >= buffer.GetLength ()) {
+                            // Don't bother copying large reads twice.
+                            chunk = serializer.Read (ptr, count);
+                        }
+                        else {
+                            std::size_t countBuffered =
+                                serializer.Read (buffer.data, buffer.GetLength ());
+                            if (countBuffered == 0) {
+                                break;
+                            }
+                            buffer.AdvanceWriteOffset (countBuffered);
+                            state = Reading;
+                            continue;
+                        }
+                        if (chunk == 0) {
+                            break;
+                        }
+                    }
+                    ptr += chunk;
+                    count -= chunk;
+                    countRead += chunk;
+                }
+                return countRead;
+            }
+            else {
+                THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                    THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+            }
+        }
+
+        std::size_t BufferedSerializer::Write (
+                const void *data,
+                std::size_t count) {
+            if (data != nullptr && count > 0) {
+                if (state == Reading) {
+                    DiscardReadAhead ();
+                }
+                if (count >= buffer.GetLength ()) {
+                    // Don't bother copying large writes twice.
+                    Flush ();
+                    return serializer.Write (data, count);
+                }
+                const ui8 *ptr = (const ui8 *)data;
+                std::size_t countWritten = 0;
+                while (count > 0) {
+                    std::size_t chunk =
+                        (std::min) (buffer.GetDataAvailableForWriting (), count);
+                    memcpy (buffer.GetWritePtr (), ptr, chunk);
+                    buffer.AdvanceWriteOffset (chunk);
+                    state = Writing;
+                    ptr += chunk;
+                    count -= chunk;
+                    countWritten += chunk;
+                    if (buffer.GetDataAvailableForWriting () == 0) {
+                        Flush ();
+                    }
+                }
+                return countWritten;
+            }
+            else {
+                THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                    THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+            }
+        }
+
+        i64 BufferedSerializer::Tell () const {
+            if (randomSeekSerializer != nullptr) {
+                i64 position = randomSeekSerializer->Tell ();
+                // In both states the bytes in [readOffset, writeOffset)
+                // are the ones the wrapped serializer has not caught up with.
+                i64 buffered = (i64)buffer.GetDataAvailableForReading ();
+                return state == Reading ? position - buffered :
+                    state == Writing ? position + buffered : position;
+            }
+            else {
+                THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                    "%s is not a RandomSeekSerializer.",
+                    serializer.Type ());
+            }
+        }
+
+        i64 BufferedSerializer::Seek (
+                i64 offset,
+                i32 fromWhere) {
+            if (randomSeekSerializer != nullptr) {
+                if (state == Writing) {
+                    Flush ();
+                }
+                else if (state == Reading) {
+                    if (fromWhere == SEEK_SET || fromWhere == SEEK_CUR) {
+                        // If the new position is inside the read-ahead,
+                        // keep it.
+                        i64 end = randomSeekSerializer->Tell ();
+                        i64 start = end - (i64)buffer.writeOffset.value;
+                        if (fromWhere == SEEK_CUR) {
+                            offset += end - (i64)buffer.GetDataAvailableForReading ();
+                            fromWhere = SEEK_SET;
+                        }
+                        if (offset >= start && offset <= end) {
+                            buffer.readOffset = (ui64)(offset - start);
+                            return offset;
+                        }
+                    }
+                    buffer.Rewind ();
+                    state = Empty;
+                }
+                return randomSeekSerializer->Seek (offset, fromWhere);
+            }
+            else {
+                THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                    "%s is not a RandomSeekSerializer.",
+                    serializer.Type ());
+            }
+        }
+
+        ui64 BufferedSerializer::GetSize () {
+            if (randomSeekSerializer != nullptr) {
+                Flush ();
+                return randomSeekSerializer->GetSize ();
+            }
+            else {
+                THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                    "%s is not a RandomSeekSerializer.",
+                    serializer.Type ());
+            }
+        }
+
+        void BufferedSerializer::Flush () {
+            if (state == Writing) {
+                // readOffset tracks how much has been written so far. That
+                // way, if the wrapped serializer throws, Tell stays correct
+                // and the next Flush picks up where this one left off.
+                while (buffer.GetDataAvailableForReading () > 0) {
+                    std::size_t countWritten = serializer.Write (
+                        buffer.GetReadPtr (),
+                        buffer.GetDataAvailableForReading ());
+                    if (countWritten == 0) {
+                        THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                            "Unable to flush " THEKOGANS_UTIL_SIZE_T_FORMAT " bytes to %s.",
+                            buffer.GetDataAvailableForReading (),
+                            serializer.Type ());
+                    }
+                    buffer.AdvanceReadOffset (countWritten);
+                }
+                buffer.Rewind ();
+                state = Empty;
+            }
+        }
+
+        void BufferedSerializer::DiscardReadAhead () {
+            std::size_t available = buffer.GetDataAvailableForReading ();
+            if (available > 0) {
+                if (randomSeekSerializer != nullptr) {
+                    randomSeekSerializer->Seek (-(i64)available, SEEK_CUR);
+                }
+                else {
+                    THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                        "Unable to discard " THEKOGANS_UTIL_SIZE_T_FORMAT
+                        " bytes of read-ahead, %s is not a RandomSeekSerializer.",
+                        available,
+                        serializer.Type ());
+                }
+            }
+            buffer.Rewind ();
+            state = Empty;
+        }
+
+    } // namespace util
+} // namespace thekogans
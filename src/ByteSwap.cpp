@@ -0,0 +1,190 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#include "thekogans/util/Environment.h"
+#if defined (TOOLCHAIN_ARCH_i386) || defined (TOOLCHAIN_ARCH_x86_64)
+    #if defined (TOOLCHAIN_OS_Windows)
+        #include <intrin.h>
+    #endif // defined (TOOLCHAIN_OS_Windows)
+    #include <immintrin.h>
+#endif // defined (TOOLCHAIN_ARCH_i386) || defined (TOOLCHAIN_ARCH_x86_64)
+#include <cstring>
+#include "thekogans/util/Exception.h"
+#include "thekogans/util/CPU.h"
+#include "thekogans/util/ByteSwap.h"
+
+namespace thekogans {
+    namespace util {
+
+        namespace {
+            template<typename T>
+            void ByteSwapScalar (
+                    const ui8 *src,
+                    ui8 *dst,
+                    std::size_t count) {
+                // memcpy keeps unaligned arrays legal (and compiles
+                // down to plain loads and stores).
+                for (std::size_t i = 0; i < count; ++i, src += sizeof (T), dst += sizeof (T)) {
+                    T value;
+                    memcpy (&value, src, sizeof (T));
+                    value = detail::SwapBytes<T, sizeof (T)> () (value);
+                    memcpy (dst, &value, sizeof (T));
+                }
+            }
+
+            void ByteSwapScalar (
+                    const ui8 *src,
+                    ui8 *dst,
+                    std::size_t size,
+                    std::size_t count) {
+                switch (size) {
+                    case UI16_SIZE:
+                        ByteSwapScalar<ui16> (src, dst, count);
+                        break;
+                    case UI32_SIZE:
+                        ByteSwapScalar<ui32> (src, dst, count);
+                        break;
+                    case UI64_SIZE:
+                        ByteSwapScalar<ui64> (src, dst, count);
+                        break;
+                }
+            }
+
+            typedef void (*ByteSwapArrayFunc) (
+                const ui8 *src,
+                ui8 *dst,
+                std::size_t size,
+                std::size_t count);
+
+        #if defined (TOOLCHAIN_ARCH_i386) || defined (TOOLCHAIN_ARCH_x86_64)
+            // The library is not built with -mssse3/-mavx2 (it has to run
+            // everywhere). Let the compiler emit them for these kernels only,
+            // they are only called after the CPU said it's safe.
+            #if defined (TOOLCHAIN_COMPILER_cl)
+                #define THEKOGANS_UTIL_BYTE_SWAP_TARGET(isa)
+            #else // defined (TOOLCHAIN_COMPILER_cl)
+                #define THEKOGANS_UTIL_BYTE_SWAP_TARGET(isa) __attribute__ ((target (isa)))
+            #endif // defined (TOOLCHAIN_COMPILER_cl)
+
+            // pshufb masks reversing each 2, 4 and 8 byte lane.
+            const ui8 SHUFFLE_MASK_16[16] = {
+                1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14
+            };
+            const ui8 SHUFFLE_MASK_32[16] = {
+                3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12
+            };
+            const ui8 SHUFFLE_MASK_64[16] = {
+                7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8
+            };
+
+            inline const ui8 *GetShuffleMask (std::size_t size) {
+                return size == UI16_SIZE ? SHUFFLE_MASK_16 :
+                    size == UI32_SIZE ? SHUFFLE_MASK_32 : SHUFFLE_MASK_64;
+            }
+
+            THEKOGANS_UTIL_BYTE_SWAP_TARGET ("ssse3")
+            void ByteSwapSSSE3 (
+                    const ui8 *src,
+                    ui8 *dst,
+                    std::size_t size,
+                    std::size_t count) {
+                const __m128i mask = _mm_loadu_si128 ((const __m128i *)GetShuffleMask (size));
+                // 16 is a multiple of every size so lanes never straddle values.
+                std::size_t bytes = size * count;
+                std::size_t i = 0;
+                for (; i + 16 <= bytes; i += 16) {
+                    _mm_storeu_si128 ((__m128i *)(dst + i),
+                        _mm_shuffle_epi8 (_mm_loadu_si128 ((const __m128i *)(src + i)), mask));
+                }
+                ByteSwapScalar (src + i, dst + i, size, (bytes - i) / size);
+            }
+
+            THEKOGANS_UTIL_BYTE_SWAP_TARGET ("avx2")
+            void ByteSwapAVX2 (
+                    const ui8 *src,
+                    ui8 *dst,
+                    std::size_t size,
+                    std::size_t count) {
+                const __m128i mask = _mm_loadu_si128 ((const __m128i *)GetShuffleMask (size));
+                // vpshufb shuffles within 128 bit lanes, so the same mask twice.
+                const __m256i mask2 = _mm256_broadcastsi128_si256 (mask);
+                std::size_t bytes = size * count;
+                std::size_t i = 0;
+                for (; i + 64 <= bytes; i += 64) {
+                    __m256i a = _mm256_loadu_si256 ((const __m256i *)(src + i));
+                    __m256i b = _mm256_loadu_si256 ((const __m256i *)(src + i + 32));
+                    _mm256_storeu_si256 ((__m256i *)(dst + i), _mm256_shuffle_epi8 (a, mask2));
+                    _mm256_storeu_si256 ((__m256i *)(dst + i + 32), _mm256_shuffle_epi8 (b, mask2));
+                }
+                for (; i + 16 <= bytes; i += 16) {
+                    _mm_storeu_si128 ((__m128i *)(dst + i),
+                        _mm_shuffle_epi8 (_mm_loadu_si128 ((const __m128i *)(src + i)), mask));
+                }
+                ByteSwapScalar (src + i, dst + i, size, (bytes - i) / size);
+            }
+
+            // AVX2 also needs the OS to save the ymm registers.
+            bool IsYMMStateEnabled () {
+                if (CPU::Instance ()->OSXSAVE ()) {
+                #if defined (TOOLCHAIN_COMPILER_cl)
+                    return (_xgetbv (0) & 6) == 6;
+                #else // defined (TOOLCHAIN_COMPILER_cl)
+                    ui32 eax;
+                    ui32 edx;
+                    __asm__ __volatile__ ("xgetbv" : "=a" (eax), "=d" (edx) : "c" (0));
+                    return (eax & 6) == 6;
+                #endif // defined (TOOLCHAIN_COMPILER_cl)
+                }
+                return false;
+            }
+        #endif // defined (TOOLCHAIN_ARCH_i386) || defined (TOOLCHAIN_ARCH_x86_64)
+
+            ByteSwapArrayFunc GetByteSwapArrayFunc () {
+            #if defined (TOOLCHAIN_ARCH_i386) || defined (TOOLCHAIN_ARCH_x86_64)
+                if (CPU::Instance ()->AVX2 () && IsYMMStateEnabled ()) {
+                    return ByteSwapAVX2;
+                }
+                if (CPU::Instance ()->SSSE3 ()) {
+                    return ByteSwapSSSE3;
+                }
+            #endif // defined (TOOLCHAIN_ARCH_i386) || defined (TOOLCHAIN_ARCH_x86_64)
+                return ByteSwapScalar;
+            }
+        }
+
+        _LIB_THEKOGANS_UTIL_DECL void _LIB_THEKOGANS_UTIL_API ByteSwapArray (
+                const void *src,
+                void *dst,
+                std::size_t size,
+                std::size_t count) {
+            if (size == UI8_SIZE) {
+                if (src != dst && count > 0) {
+                    memcpy (dst, src, count);
+                }
+            }
+            else if (size == UI16_SIZE || size == UI32_SIZE || size == UI64_SIZE) {
+                static const ByteSwapArrayFunc byteSwapArray = GetByteSwapArrayFunc ();
+                byteSwapArray ((const ui8 *)src, (ui8 *)dst, size, count);
+            }
+            else {
+                THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                    THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+            }
+        }
+
+    } // namespace util
+} // namespace thekogans
@@ -39,7 +39,29 @@ namespace thekogans {
         #endif // defined (TOOLCHAIN_OS_Windows)
         }
 
+    #if defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+        namespace {
+            // The mutex is released while we wait. Don't count
+            // the wait against the mutex hold time, and don't
+            // count getting it back as another acquisition.
+            struct ProbeWaiter {
+                LockProbe &probe;
+
+                explicit ProbeWaiter (LockProbe &probe_) :
+                        probe (probe_) {
+                    probe.Release ();
+                }
+                ~ProbeWaiter () {
+                    probe.Reacquired ();
+                }
+            };
+        }
+    #endif // defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+
         bool Condition::Wait (const TimeSpec &timeSpec) {
+        #if defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+            ProbeWaiter probeWaiter (mutex.probe);
+        #endif // defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
         #if defined (TOOLCHAIN_OS_Windows)
             if (timeSpec == TimeSpec::Infinite) {
                 if (!SleepConditionVariableCS (&cv, &mutex.cs, INFINITE)) {
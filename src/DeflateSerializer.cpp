@@ -0,0 +1,521 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#include <climits>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <zlib.h>
+#include "thekogans/util/Exception.h"
+#include "thekogans/util/LoggerMgr.h"
+#include "thekogans/util/StringUtils.h"
+#include "thekogans/util/BufferPool.h"
+#include "thekogans/util/DeflateSerializer.h"
+
+namespace thekogans {
+    namespace util {
+
+        THEKOGANS_UTIL_IMPLEMENT_DYNAMIC_CREATABLE_OVERRIDE (
+            thekogans::util::DeflateSerializer,
+            Serializer::TYPE)
+
+        static_assert (
+            DeflateSerializer::DEFAULT_LEVEL == Z_DEFAULT_COMPRESSION &&
+            DeflateSerializer::Default == Z_DEFAULT_STRATEGY &&
+            DeflateSerializer::Filtered == Z_FILTERED &&
+            DeflateSerializer::HuffmanOnly == Z_HUFFMAN_ONLY &&
+            DeflateSerializer::RLE == Z_RLE &&
+            DeflateSerializer::Fixed == Z_FIXED,
+            "DeflateSerializer constants are out of sync with zlib.");
+
+        namespace {
+            std::string GetZlibError (
+                    const z_stream &zStream,
+                    int result) {
+                return zStream.msg != 0 ?
+                    std::string (zStream.msg) : FormatString ("zlib error: %d", result);
+            }
+        }
+
+        struct DeflateSerializer::Stream {
+            /// \brief
+            /// zlib stream.
+            z_stream zStream;
+
+            /// \brief
+            /// ctor.
+            /// \param[in] level Compression level.
+            /// \param[in] windowBits zlib windowBits (including the format bias).
+            /// \param[in] strategy Compression strategy.
+            Stream (
+                    i32 level,
+                    i32 windowBits,
+                    i32 strategy) {
+                memset (&zStream, 0, sizeof (zStream));
+                int result = deflateInit2 (
+                    &zStream, level, Z_DEFLATED, windowBits, 8, strategy);
+                if (result != Z_OK) {
+                    THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                        "%s", GetZlibError (zStream, result).c_str ());
+                }
+            }
+            /// \brief
+            /// dtor.
+            ~Stream () {
+                deflateEnd (&zStream);
+            }
+        };
+
+        struct DeflateSerializer::BlockJob : public RunLoop::Job {
+            /// \brief
+            /// Declare \see{RefCounted} pointers.
+            THEKOGANS_UTIL_DECLARE_REF_COUNTED_POINTERS (BlockJob)
+
+            /// \brief
+            /// Uncompressed block.
+            Buffer::SharedPtr block;
+            /// \brief
+            /// Uncompressed block length.
+            const std::size_t length;
+            /// \brief
+            /// Previous uncompressed block (primes the window).
+            Buffer::SharedPtr dictionary;
+            /// \brief
+            /// Compression level.
+            const i32 level;
+            /// \brief
+            /// Window size (log2).
+            const i32 windowBits;
+            /// \brief
+            /// Compression strategy.
+            const i32 strategy;
+            /// \brief
+            /// Stream format (decides the checksum).
+            const Format format;
+            /// \brief
+            /// true == last block in the stream.
+            const bool last;
+            /// \brief
+            /// Compressed block.
+            Buffer::SharedPtr output;
+            /// \brief
+            /// adler32 (Zlib) or crc32 (Gzip) of the uncompressed block.
+            ui32 check;
+            /// \brief
+            /// Compression error (empty == success).
+            std::string error;
+
+            /// \brief
+            /// ctor.
+            /// \param[in] block_ Uncompressed block.
+            /// \param[in] dictionary_ Previous uncompressed block (nullptr if first).
+            /// \param[in] level_ Compression level.
+            /// \param[in] windowBits_ Window size (log2).
+            /// \param[in] strategy_ Compression strategy.
+            /// \param[in] format_ Stream format.
+            /// \param[in] last_ true == last block in the stream.
+            BlockJob (
+                Buffer::SharedPtr block_,
+                Buffer::SharedPtr dictionary_,
+                i32 level_,
+                i32 windowBits_,
+                i32 strategy_,
+                Format format_,
+                bool last_) :
+                block (block_),
+                length (block_->GetDataAvailableForReading ()),
+                dictionary (dictionary_),
+                level (level_),
+                windowBits (windowBits_),
+                strategy (strategy_),
+                format (format_),
+                last (last_),
+                check (0) {}
+
+            // RunLoop::Job
+            /// \brief
+            /// Compress the block as raw deflate, ending on a byte boundary
+            /// (Z_SYNC_FLUSH), or with the final deflate block if last.
+            /// \param[in] done If true, this flag indicates that
+            /// the job should stop what it's doing, and exit.
+            virtual void Execute (const std::atomic<bool> &done) noexcept override {
+                if (ShouldStop (done)) {
+                    error = "Block compression was cancelled.";
+                    return;
+                }
+                const Bytef *in = block->GetReadPtr ();
+                if (format == Zlib) {
+                    check = (ui32)adler32 (adler32 (0, Z_NULL, 0), in, (uInt)length);
+                }
+                else if (format == Gzip) {
+                    check = (ui32)crc32 (crc32 (0, Z_NULL, 0), in, (uInt)length);
+                }
+                z_stream zStream;
+                memset (&zStream, 0, sizeof (zStream));
+                int result = deflateInit2 (
+                    &zStream, level, Z_DEFLATED, -windowBits, 8, strategy);
+                if (result == Z_OK) {
+                    if (dictionary != nullptr) {
+                        std::size_t dictionaryLength = (std::min) (
+                            dictionary->GetDataAvailableForReading (),
+                            (std::size_t)1 << windowBits);
+                        result = deflateSetDictionary (
+                            &zStream,
+                            dictionary->GetReadPtrEnd () - dictionaryLength,
+                            (uInt)dictionaryLength);
+                        // The bytes are no longer needed.
+                        dictionary.Reset ();
+                    }
+                    if (result == Z_OK) {
+                        THEKOGANS_UTIL_TRY {
+                            // deflateBound covers Z_FINISH. Z_SYNC_FLUSH
+                            // can add an empty stored block (5 bytes).
+                            output = GlobalBufferPool::Instance ()->GetBuffer (
+                                HostEndian, deflateBound (&zStream, (uLong)length) + 16);
+                            zStream.next_in = (Bytef *)in;
+                            zStream.avail_in = (uInt)length;
+                            zStream.next_out = output->GetWritePtr ();
+                            zStream.avail_out = (uInt)output->GetDataAvailableForWriting ();
+                            result = deflate (&zStream, last ? Z_FINISH : Z_SYNC_FLUSH);
+                            if (result == (last ? Z_STREAM_END : Z_OK) &&
+                                    zStream.avail_in == 0 && zStream.avail_out != 0) {
+                                output->AdvanceWriteOffset (
+                                    output->GetDataAvailableForWriting () - zStream.avail_out);
+                                result = Z_OK;
+                            }
+                            else if (result == Z_OK || result == Z_STREAM_END) {
+                                result = Z_BUF_ERROR;
+                            }
+                        }
+                        THEKOGANS_UTIL_CATCH (Exception) {
+                            error = exception.Report ();
+                        }
+                    }
+                    if (result != Z_OK && error.empty ()) {
+                        error = GetZlibError (zStream, result);
+                    }
+                    deflateEnd (&zStream);
+                }
+                else {
+                    error = GetZlibError (zStream, result);
+                }
+                // Return the block to the pool as soon as possible.
+                block.Reset ();
+            }
+        };
+
+        DeflateSerializer::DeflateSerializer (
+                Serializer &serializer_,
+                Endianness endianness,
+                i32 level_,
+                i32 windowBits_,
+                Strategy strategy_,
+                Format format_,
+                std::size_t bufferSize) :
+                Serializer (endianness),
+                serializer (serializer_),
+                level (level_),
+                windowBits (windowBits_),
+                strategy (strategy_),
+                format (format_),
+                stream (nullptr),
+                buffer (HostEndian, bufferSize),
+                blockSize (0),
+                maxPendingBlocks (0),
+                check (0),
+                totalIn (0),
+                totalOut (0),
+                finished (false) {
+            if (level >= Z_DEFAULT_COMPRESSION && level <= Z_BEST_COMPRESSION &&
+                    windowBits >= 9 && windowBits <= MAX_WBITS && bufferSize > 0) {
+                stream = new Stream (
+                    level,
+                    format == Zlib ? windowBits :
+                        format == Gzip ? windowBits + 16 : -windowBits,
+                    strategy);
+            }
+            else {
+                THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                    THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+            }
+        }
+
+        DeflateSerializer::DeflateSerializer (
+                Serializer &serializer_,
+                JobQueue::SharedPtr jobQueue_,
+                Endianness endianness,
+                i32 level_,
+                i32 windowBits_,
+                Strategy strategy_,
+                Format format_,
+                std::size_t blockSize_,
+                std::size_t maxPendingBlocks_) :
+                Serializer (endianness),
+                serializer (serializer_),
+                level (level_),
+                windowBits (windowBits_),
+                strategy (strategy_),
+                format (format_),
+                stream (nullptr),
+                jobQueue (jobQueue_),
+                blockSize (blockSize_),
+                maxPendingBlocks (maxPendingBlocks_),
+                check (format == Zlib ? (ui32)adler32 (0, Z_NULL, 0) : 0),
+                totalIn (0),
+                totalOut (0),
+                finished (false) {
+            if (jobQueue == nullptr ||
+                    level < Z_DEFAULT_COMPRESSION || level > Z_BEST_COMPRESSION ||
+                    windowBits < 9 || windowBits > MAX_WBITS ||
+                    blockSize == 0 || blockSize > UINT_MAX / 2 ||
+                    maxPendingBlocks == 0) {
+                THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                    THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+            }
+        }
+
+        DeflateSerializer::~DeflateSerializer () {
+            THEKOGANS_UTIL_TRY {
+                Finish ();
+            }
+            THEKOGANS_UTIL_CATCH_AND_LOG_SUBSYSTEM (THEKOGANS_UTIL)
+            // If Finish failed, don't leave jobs
+            // referencing us running on the queue.
+            while (!pendingBlocks.empty ()) {
+                pendingBlocks.front ()->Wait ();
+                pendingBlocks.pop_front ();
+            }
+            delete stream;
+        }
+
+        std::size_t DeflateSerializer::Read (
+                void * /*data*/,
+                std::size_t /*count*/) {
+            THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                "%s", "DeflateSerializer is write only.");
+        }
+
+        std::size_t DeflateSerializer::Write (
+                const void *data,
+                std::size_t count) {
+            if (data != nullptr && count > 0) {
+                if (finished) {
+                    THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                        "%s", "DeflateSerializer is finished.");
+                }
+                const ui8 *ptr = (const ui8 *)data;
+                std::size_t remaining = count;
+                if (stream != nullptr) {
+                    while (remaining > 0) {
+                        uInt chunk = (uInt)(std::min) (remaining, (std::size_t)UINT_MAX);
+                        stream->zStream.next_in = (Bytef *)ptr;
+                        stream->zStream.avail_in = chunk;
+                        Deflate (Z_NO_FLUSH);
+                        ptr += chunk;
+                        remaining -= chunk;
+                    }
+                }
+                else {
+                    while (remaining > 0) {
+                        if (block == nullptr) {
+                            block = GlobalBufferPool::Instance ()->GetBuffer (
+                                HostEndian, blockSize);
+                        }
+                        std::size_t chunk = (std::min) (
+                            remaining, blockSize - block->GetDataAvailableForReading ());
+                        block->Write (ptr, chunk);
+                        ptr += chunk;
+                        remaining -= chunk;
+                        if (block->GetDataAvailableForReading () == blockSize) {
+                            SubmitBlock (false);
+                            WriteBlocks (maxPendingBlocks);
+                        }
+                    }
+                }
+                totalIn += count;
+                return count;
+            }
+            else {
+                THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                    THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+            }
+        }
+
+        void DeflateSerializer::Flush () {
+            if (!finished) {
+                if (stream != nullptr) {
+                    Deflate (Z_SYNC_FLUSH);
+                }
+                else {
+                    if (block != nullptr && block->GetDataAvailableForReading () > 0) {
+                        SubmitBlock (false);
+                    }
+                    WriteBlocks (0);
+                }
+            }
+        }
+
+        void DeflateSerializer::Finish () {
+            if (!finished) {
+                // Whatever happens below, the stream
+                // can't be finished more than once.
+                finished = true;
+                if (stream != nullptr) {
+                    Deflate (Z_FINISH);
+                }
+                else {
+                    SubmitBlock (true);
+                    WriteBlocks (0);
+                    WriteTrailer ();
+                }
+            }
+        }
+
+        void DeflateSerializer::WriteHeader () {
+            if (format == Zlib) {
+                // RFC 1950: CMF (method and window size),
+                // FLG (level hint and header check bits).
+                ui8 header[2];
+                header[0] = (ui8)(((windowBits - 8) << 4) | Z_DEFLATED);
+                header[1] = (ui8)((level == Z_DEFAULT_COMPRESSION ? 2 :
+                    level < 2 ? 0 : level < 6 ? 1 : level == 6 ? 2 : 3) << 6);
+                header[1] += (ui8)(31 - ((header[0] << 8) + header[1]) % 31);
+                WriteOut (header, sizeof (header));
+            }
+            else if (format == Gzip) {
+                // RFC 1952: magic, method, no flags, no mtime,
+                // extra flags (level hint), OS unknown.
+                ui8 header[10] = {
+                    0x1f, 0x8b, Z_DEFLATED, 0, 0, 0, 0, 0,
+                    (ui8)(level == Z_BEST_COMPRESSION ? 2 : level == Z_BEST_SPEED ? 4 : 0),
+                    0xff
+                };
+                WriteOut (header, sizeof (header));
+            }
+        }
+
+        void DeflateSerializer::WriteTrailer () {
+            if (format == Zlib) {
+                // adler32, big endian.
+                ui8 trailer[4] = {
+                    (ui8)(check >> 24), (ui8)(check >> 16), (ui8)(check >> 8), (ui8)check
+                };
+                WriteOut (trailer, sizeof (trailer));
+            }
+            else if (format == Gzip) {
+                // crc32 and uncompressed length (mod 2^32), little endian.
+                ui32 length = (ui32)totalIn;
+                ui8 trailer[8] = {
+                    (ui8)check, (ui8)(check >> 8), (ui8)(check >> 16), (ui8)(check >> 24),
+                    (ui8)length, (ui8)(length >> 8), (ui8)(length >> 16), (ui8)(length >> 24)
+                };
+                WriteOut (trailer, sizeof (trailer));
+            }
+        }
+
+        void DeflateSerializer::Deflate (i32 flush) {
+            z_stream &zStream = stream->zStream;
+            for (;;) {
+                std::size_t available = buffer.GetDataAvailableForWriting ();
+                zStream.next_out = buffer.GetWritePtr ();
+                zStream.avail_out = (uInt)available;
+                int result = deflate (&zStream, flush);
+                // Z_BUF_ERROR only means no progress was possible.
+                if (result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR) {
+                    THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                        "%s", GetZlibError (zStream, result).c_str ());
+                }
+                buffer.AdvanceWriteOffset (available - zStream.avail_out);
+                bool full = zStream.avail_out == 0;
+                if (full || flush != Z_NO_FLUSH) {
+                    WriteOut (buffer.GetReadPtr (), buffer.GetDataAvailableForReading ());
+                    buffer.Rewind ();
+                }
+                if (flush == Z_FINISH ?
+                        result == Z_STREAM_END : !full && zStream.avail_in == 0) {
+                    break;
+                }
+            }
+        }
+
+        void DeflateSerializer::SubmitBlock (bool last) {
+            if (block == nullptr) {
+                // The last block can be empty.
+                block = GlobalBufferPool::Instance ()->GetBuffer (HostEndian, 0);
+            }
+            if (previousBlock == nullptr) {
+                WriteHeader ();
+            }
+            RunLoop::Job::SharedPtr job (
+                new BlockJob (
+                    block,
+                    previousBlock,
+                    level,
+                    windowBits,
+                    strategy,
+                    format,
+                    last));
+            jobQueue->EnqJob (job);
+            pendingBlocks.push_back (job);
+            previousBlock = block;
+            block.Reset ();
+        }
+
+        void DeflateSerializer::WriteBlocks (std::size_t maxPending) {
+            while (!pendingBlocks.empty ()) {
+                BlockJob *job = static_cast<BlockJob *> (pendingBlocks.front ().Get ());
+                if (pendingBlocks.size () <= maxPending && !job->IsCompleted ()) {
+                    break;
+                }
+                job->Wait ();
+                if (!job->error.empty () || job->output == nullptr) {
+                    THEKOGANS_UTIL_THROW_STRING_EXCEPTION ("%s",
+                        !job->error.empty () ? job->error.c_str () :
+                            "Block compression was cancelled.");
+                }
+                if (format == Zlib) {
+                    check = (ui32)adler32_combine (check, job->check, (z_off_t)job->length);
+                }
+                else if (format == Gzip) {
+                    check = (ui32)crc32_combine (check, job->check, (z_off_t)job->length);
+                }
+                WriteOut (
+                    job->output->GetReadPtr (),
+                    job->output->GetDataAvailableForReading ());
+                pendingBlocks.pop_front ();
+            }
+        }
+
+        void DeflateSerializer::WriteOut (
+                const void *data,
+                std::size_t count) {
+            const ui8 *ptr = (const ui8 *)data;
+            while (count > 0) {
+                std::size_t countWritten = serializer.Write (ptr, count);
+                if (countWritten == 0) {
+                    THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                        "Unable to write " THEKOGANS_UTIL_SIZE_T_FORMAT " compressed bytes.",
+                        count);
+                }
+                ptr += countWritten;
+                count -= countWritten;
+                totalOut += countWritten;
+            }
+        }
+
+    } // namespace util
+} // namespace thekogans
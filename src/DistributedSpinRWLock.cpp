@@ -0,0 +1,145 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#include "thekogans/util/SystemInfo.h"
+#include "thekogans/util/Thread.h"
+#include "thekogans/util/DistributedSpinRWLock.h"
+
+namespace thekogans {
+    namespace util {
+
+        namespace {
+            // Threads are handed out slots round robin the first time they
+            // touch any DistributedSpinRWLock. That spreads them evenly across
+            // the slots (hashing thread ids tends to cluster).
+            std::atomic<ui32> nextSlot (0);
+
+            inline ui32 GetThreadSlot () {
+                static thread_local ui32 slot = nextSlot.fetch_add (1, std::memory_order_relaxed);
+                return slot;
+            }
+
+            inline ui32 RoundUpToPowerOf2 (ui32 value) {
+                ui32 powerOf2 = 1;
+                while (powerOf2 < value) {
+                    powerOf2 <<= 1;
+                }
+                return powerOf2;
+            }
+        }
+
+        DistributedSpinRWLock::DistributedSpinRWLock (
+                ui32 slotCount,
+                ui32 maxPauseBeforeYield_) :
+                slotMask (0),
+                writer (0),
+                maxPauseBeforeYield (maxPauseBeforeYield_) {
+            if (slotCount == 0) {
+                slotCount = (ui32)SystemInfo::Instance ()->GetCPUCount () * 2;
+            }
+            slotCount = RoundUpToPowerOf2 (slotCount);
+            static_assert (sizeof (Slot) == CACHE_LINE_SIZE,
+                "Slot must fill exactly one cache line.");
+            slots.reset (new Slot[slotCount]);
+            slotMask = slotCount - 1;
+        }
+
+        bool DistributedSpinRWLock::TryAcquire (bool read) {
+            if (read) {
+                if (writer.load (std::memory_order_acquire) == 0) {
+                    Slot &slot = GetSlot ();
+                    // Announce ourselves first and then check for a writer.
+                    // The writer does the opposite (see Acquire). Because
+                    // both are seq_cst at least one of us will see the other.
+                    slot.readers.fetch_add (1, std::memory_order_seq_cst);
+                    if (writer.load (std::memory_order_seq_cst) == 0) {
+                        return true;
+                    }
+                    slot.readers.fetch_sub (1, std::memory_order_release);
+                }
+            }
+            else {
+                ui32 expected = 0;
+                if (writer.compare_exchange_strong (expected, 1, std::memory_order_seq_cst)) {
+                    if (IsDrained ()) {
+                        return true;
+                    }
+                    writer.store (0, std::memory_order_release);
+                }
+            }
+            return false;
+        }
+
+        void DistributedSpinRWLock::Acquire (bool read) {
+            if (read) {
+                Slot &slot = GetSlot ();
+                for (Thread::Backoff backoff (maxPauseBeforeYield);; backoff.Pause ()) {
+                    // Don't touch our slot while a writer is around. That
+                    // would only make it wait for us to back off again.
+                    if (writer.load (std::memory_order_acquire) == 0) {
+                        slot.readers.fetch_add (1, std::memory_order_seq_cst);
+                        if (writer.load (std::memory_order_seq_cst) == 0) {
+                            break;
+                        }
+                        slot.readers.fetch_sub (1, std::memory_order_release);
+                    }
+                }
+            }
+            else {
+                // Claim the lock (this also keeps new readers out)...
+                for (Thread::Backoff backoff (maxPauseBeforeYield);; backoff.Pause ()) {
+                    ui32 expected = 0;
+                    if (writer.load (std::memory_order_relaxed) == 0 &&
+                            writer.compare_exchange_weak (
+                                expected, 1, std::memory_order_seq_cst)) {
+                        break;
+                    }
+                }
+                // ...and wait for the readers already inside to leave.
+                for (Thread::Backoff backoff (maxPauseBeforeYield); !IsDrained (); backoff.Pause ());
+            }
+        }
+
+        void DistributedSpinRWLock::Release (bool read) {
+            if (read) {
+                Slot &slot = GetSlot ();
+                THEKOGANS_UTIL_ASSERT (slot.readers.load (std::memory_order_relaxed) != 0,
+                    "Invalid state of a DistributedSpinRWLock: no readers.");
+                slot.readers.fetch_sub (1, std::memory_order_release);
+            }
+            else {
+                THEKOGANS_UTIL_ASSERT (writer.load (std::memory_order_relaxed) == 1,
+                    "Invalid state of a DistributedSpinRWLock: no writer.");
+                writer.store (0, std::memory_order_release);
+            }
+        }
+
+        DistributedSpinRWLock::Slot &DistributedSpinRWLock::GetSlot () const {
+            return slots[GetThreadSlot () & slotMask];
+        }
+
+        bool DistributedSpinRWLock::IsDrained () const {
+            for (ui32 i = 0; i <= slotMask; ++i) {
+                if (slots[i].readers.load (std::memory_order_seq_cst) != 0) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+    } // namespace util
+} // namespace thekogans
@@ -0,0 +1,296 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#include <cassert>
+#include "thekogans/util/LockGuard.h"
+#include "thekogans/util/Thread.h"
+#include "thekogans/util/Event.h"
+#include "thekogans/util/Exception.h"
+#include "thekogans/util/LoggerMgr.h"
+#include "thekogans/util/EpochManager.h"
+
+namespace thekogans {
+    namespace util {
+
+        struct EpochManager::ThreadRecord {
+            /// \brief
+            /// localEpoch value when the thread is not in a critical section.
+            static const ui64 QUIESCENT = UI64_MAX;
+
+            /// \brief
+            /// Global epoch observed on entering the critical section
+            /// (QUIESCENT when not in one).
+            std::atomic<ui64> localEpoch;
+            /// \brief
+            /// Critical section nesting level (only touched by the owner).
+            ui32 nesting;
+            /// \brief
+            /// true == record is owned by a thread.
+            std::atomic<bool> inUse;
+            /// \brief
+            /// Objects retired by the owner (only touched by the owner).
+            RetiredList retiredList;
+            /// \brief
+            /// Next record in EpochManager::records.
+            ThreadRecord *next;
+
+            /// \brief
+            /// ctor.
+            ThreadRecord () :
+                localEpoch (QUIESCENT),
+                nesting (0),
+                inUse (true),
+                next (nullptr) {}
+        };
+
+        struct EpochManager::ThreadRecordHolder {
+            /// \brief
+            /// The calling thread's record.
+            ThreadRecord *record;
+
+            /// \brief
+            /// ctor.
+            ThreadRecordHolder () :
+                record (nullptr) {}
+            /// \brief
+            /// dtor. Runs when the owning thread exits.
+            ~ThreadRecordHolder () {
+                if (record != nullptr && EpochManager::IsInstanceCreated ()) {
+                    EpochManager::Instance ()->ReleaseThreadRecord (record);
+                }
+            }
+        };
+
+        struct EpochManager::Reclaimer : public Thread {
+            /// \brief
+            /// The manager we reclaim for.
+            EpochManager &epochManager;
+            /// \brief
+            /// How often to reclaim.
+            const TimeSpec period;
+            /// \brief
+            /// Signalled to stop the thread.
+            Event stop;
+
+            /// \brief
+            /// ctor.
+            /// \param[in] epochManager_ The manager we reclaim for.
+            /// \param[in] period_ How often to reclaim.
+            Reclaimer (
+                EpochManager &epochManager_,
+                const TimeSpec &period_) :
+                Thread ("EpochManager::Reclaimer"),
+                epochManager (epochManager_),
+                period (period_) {}
+
+            // Thread
+            /// \brief
+            /// Periodically advance the epoch and delete orphans.
+            virtual void Run () noexcept override {
+                while (!stop.Wait (period)) {
+                    THEKOGANS_UTIL_TRY {
+                        // Orphans need the epoch to advance twice
+                        // past the one they were retired in.
+                        epochManager.TryAdvance ();
+                        epochManager.ReclaimOrphans ();
+                    }
+                    THEKOGANS_UTIL_CATCH_AND_LOG_SUBSYSTEM (THEKOGANS_UTIL)
+                }
+            }
+        };
+
+        EpochManager::EpochManager () :
+            epoch (0),
+            records (nullptr),
+            reclaimThreshold (DEFAULT_RECLAIM_THRESHOLD) {}
+
+        EpochManager::~EpochManager () {
+            StopReclaimer ();
+            // We're going away, so nobody can be looking
+            // at the retired objects any more.
+            for (ThreadRecord *record = records.load (); record != nullptr;) {
+                ThreadRecord *next = record->next;
+                orphans.insert (orphans.end (),
+                    record->retiredList.begin (), record->retiredList.end ());
+                delete record;
+                record = next;
+            }
+            for (std::size_t i = 0, count = orphans.size (); i < count; ++i) {
+                orphans[i].deleter (orphans[i].ptr);
+            }
+        }
+
+        void EpochManager::Enter () {
+            ThreadRecord *record = GetThreadRecord ();
+            if (record->nesting++ == 0) {
+                record->localEpoch.store (
+                    epoch.load (std::memory_order_relaxed), std::memory_order_relaxed);
+                // Make sure TryAdvance sees us before we
+                // start reading the shared structure.
+                std::atomic_thread_fence (std::memory_order_seq_cst);
+            }
+        }
+
+        void EpochManager::Leave () {
+            ThreadRecord *record = GetThreadRecord ();
+            assert (record->nesting > 0);
+            if (--record->nesting == 0) {
+                record->localEpoch.store (ThreadRecord::QUIESCENT, std::memory_order_release);
+            }
+        }
+
+        void EpochManager::Retire (
+                void *ptr,
+                Deleter deleter) {
+            if (ptr != nullptr && deleter != nullptr) {
+                ThreadRecord *record = GetThreadRecord ();
+                Retired retired = {ptr, deleter, epoch.load (std::memory_order_seq_cst)};
+                record->retiredList.push_back (retired);
+                if (record->retiredList.size () >=
+                        reclaimThreshold.load (std::memory_order_relaxed)) {
+                    Reclaim ();
+                }
+            }
+        }
+
+        bool EpochManager::TryAdvance () {
+            ui64 current = epoch.load (std::memory_order_seq_cst);
+            for (ThreadRecord *record = records.load (std::memory_order_acquire);
+                    record != nullptr; record = record->next) {
+                if (record->inUse.load (std::memory_order_acquire)) {
+                    ui64 localEpoch = record->localEpoch.load (std::memory_order_seq_cst);
+                    if (localEpoch != ThreadRecord::QUIESCENT && localEpoch != current) {
+                        return false;
+                    }
+                }
+            }
+            // If we lose the race, someone else advanced it for us.
+            epoch.compare_exchange_strong (current, current + 1, std::memory_order_seq_cst);
+            return true;
+        }
+
+        std::size_t EpochManager::Reclaim () {
+            TryAdvance ();
+            return Reclaim (GetThreadRecord ()->retiredList) + ReclaimOrphans ();
+        }
+
+        void EpochManager::StartReclaimer (const TimeSpec &period) {
+            LockGuard<SpinLock> guard (reclaimerSpinLock);
+            if (reclaimer == nullptr) {
+                reclaimer.reset (new Reclaimer (*this, period));
+                reclaimer->Create ();
+            }
+        }
+
+        void EpochManager::StopReclaimer () {
+            LockGuard<SpinLock> guard (reclaimerSpinLock);
+            if (reclaimer != nullptr) {
+                reclaimer->stop.Signal ();
+                reclaimer->Wait ();
+                reclaimer.reset ();
+            }
+        }
+
+        EpochManager::ThreadRecord *EpochManager::GetThreadRecord () {
+            static thread_local ThreadRecordHolder holder;
+            if (holder.record == nullptr) {
+                // Reuse a record left behind by an exited thread...
+                for (ThreadRecord *record = records.load (std::memory_order_acquire);
+                        record != nullptr; record = record->next) {
+                    bool inUse = false;
+                    if (!record->inUse.load (std::memory_order_relaxed) &&
+                            record->inUse.compare_exchange_strong (
+                                inUse, true, std::memory_order_acquire)) {
+                        holder.record = record;
+                        break;
+                    }
+                }
+                // ...or add a new one.
+                if (holder.record == nullptr) {
+                    ThreadRecord *record = new ThreadRecord;
+                    record->next = records.load (std::memory_order_relaxed);
+                    while (!records.compare_exchange_weak (record->next, record,
+                        std::memory_order_release, std::memory_order_relaxed));
+                    holder.record = record;
+                }
+            }
+            return holder.record;
+        }
+
+        void EpochManager::ReleaseThreadRecord (ThreadRecord *record) {
+            if (!record->retiredList.empty ()) {
+                LockGuard<SpinLock> guard (orphansSpinLock);
+                orphans.insert (orphans.end (),
+                    record->retiredList.begin (), record->retiredList.end ());
+            }
+            record->retiredList.clear ();
+            record->nesting = 0;
+            record->localEpoch.store (ThreadRecord::QUIESCENT, std::memory_order_release);
+            record->inUse.store (false, std::memory_order_release);
+        }
+
+        namespace {
+            // Move the objects that are safe to delete from retiredList to ready.
+            void Partition (
+                    EpochManager::RetiredList &retiredList,
+                    ui64 epoch,
+                    EpochManager::RetiredList &ready) {
+                std::size_t j = 0;
+                for (std::size_t i = 0, count = retiredList.size (); i < count; ++i) {
+                    // Every thread that could have seen the object was in a critical
+                    // section that started at or before the epoch it was retired in.
+                    // Two advances later they have all left.
+                    if (retiredList[i].epoch + 2 <= epoch) {
+                        ready.push_back (retiredList[i]);
+                    }
+                    else {
+                        retiredList[j++] = retiredList[i];
+                    }
+                }
+                retiredList.resize (j);
+            }
+
+            std::size_t Delete (const EpochManager::RetiredList &ready) {
+                for (std::size_t i = 0, count = ready.size (); i < count; ++i) {
+                    ready[i].deleter (ready[i].ptr);
+                }
+                return ready.size ();
+            }
+        }
+
+        std::size_t EpochManager::Reclaim (RetiredList &retiredList) {
+            // Deleters are allowed to Retire (nested structures),
+            // so don't call them while iterating retiredList.
+            RetiredList ready;
+            Partition (retiredList, epoch.load (std::memory_order_acquire), ready);
+            return Delete (ready);
+        }
+
+        std::size_t EpochManager::ReclaimOrphans () {
+            RetiredList ready;
+            {
+                LockGuard<SpinLock> guard (orphansSpinLock);
+                if (orphans.empty ()) {
+                    return 0;
+                }
+                Partition (orphans, epoch.load (std::memory_order_acquire), ready);
+            }
+            return Delete (ready);
+        }
+
+    } // namespace util
+} // namespace thekogans
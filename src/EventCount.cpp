@@ -0,0 +1,109 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#include "thekogans/util/Environment.h"
+#include <climits>
+#if defined (TOOLCHAIN_OS_Linux)
+    #include "thekogans/util/os/linux/Futex.h"
+#else // defined (TOOLCHAIN_OS_Linux)
+    #include "thekogans/util/LockGuard.h"
+#endif // defined (TOOLCHAIN_OS_Linux)
+#include "thekogans/util/EventCount.h"
+
+namespace thekogans {
+    namespace util {
+
+        EventCount::EventCount () :
+                epoch (0),
+                waiters (0)
+            #if !defined (TOOLCHAIN_OS_Linux)
+                , condition (mutex)
+            #endif // !defined (TOOLCHAIN_OS_Linux)
+                {}
+
+        ui32 EventCount::PrepareWait () {
+            waiters.fetch_add (1, std::memory_order_seq_cst);
+            // Pairs with the fence in Notify. Either the notifier sees
+            // our waiters increment, or we see its change to the
+            // condition when we re-check it.
+            std::atomic_thread_fence (std::memory_order_seq_cst);
+            return epoch.load (std::memory_order_acquire);
+        }
+
+        void EventCount::CancelWait () {
+            waiters.fetch_sub (1, std::memory_order_relaxed);
+        }
+
+    #if defined (TOOLCHAIN_OS_Linux)
+        bool EventCount::Wait (
+                ui32 key,
+                const TimeSpec &timeSpec) {
+            // Returns right away if a Notify slipped in after PrepareWait.
+            bool result = os::linux::FutexWait ((volatile ui32 *)&epoch, key, timeSpec);
+            waiters.fetch_sub (1, std::memory_order_relaxed);
+            return result;
+        }
+
+        void EventCount::Wake (ui32 count) {
+            os::linux::FutexWake ((volatile ui32 *)&epoch, count);
+        }
+    #else // defined (TOOLCHAIN_OS_Linux)
+        bool EventCount::Wait (
+                ui32 key,
+                const TimeSpec &timeSpec) {
+            bool result = true;
+            {
+                LockGuard<Mutex> guard (mutex);
+                if (epoch.load (std::memory_order_acquire) == key) {
+                    result = condition.Wait (timeSpec);
+                }
+            }
+            waiters.fetch_sub (1, std::memory_order_relaxed);
+            return result;
+        }
+
+        void EventCount::Wake (ui32 count) {
+            // Taking the mutex guarantees that a waiter that saw
+            // the old epoch is already waiting on the condition.
+            LockGuard<Mutex> guard (mutex);
+            if (count == 1) {
+                condition.Signal ();
+            }
+            else {
+                condition.SignalAll ();
+            }
+        }
+    #endif // defined (TOOLCHAIN_OS_Linux)
+
+        void EventCount::Notify () {
+            std::atomic_thread_fence (std::memory_order_seq_cst);
+            if (waiters.load (std::memory_order_relaxed) != 0) {
+                epoch.fetch_add (1, std::memory_order_release);
+                Wake (1);
+            }
+        }
+
+        void EventCount::NotifyAll () {
+            std::atomic_thread_fence (std::memory_order_seq_cst);
+            if (waiters.load (std::memory_order_relaxed) != 0) {
+                epoch.fetch_add (1, std::memory_order_release);
+                Wake (UINT_MAX);
+            }
+        }
+
+    } // namespace util
+} // namespace thekogans
@@ -23,6 +23,7 @@
 #include "thekogans/util/Exception.h"
 #include "thekogans/util/Console.h"
 #include "thekogans/util/StringUtils.h"
+#include "thekogans/util/LoggerMgr.h"
 #include "thekogans/util/FileLogger.h"
 
 namespace thekogans {
@@ -41,12 +42,17 @@ namespace thekogans {
                 THEKOGANS_UTIL_TRY {
                     ArchiveLog ();
                     OpenFile ();
-                    file.Seek (0, SEEK_END);
+                    // The file is opened with Append, so no need to seek.
+                    Serializer *out = serializer != nullptr ?
+                        (Serializer *)serializer.get () : &file;
                     if (!header.empty ()) {
-                        file.Write (header.c_str (), header.size ());
+                        out->Write (header.c_str (), header.size ());
                     }
                     if (!message.empty ()) {
-                        file.Write (message.c_str (), message.size ());
+                        out->Write (message.c_str (), message.size ());
+                    }
+                    if (serializer != nullptr && level <= LoggerMgr::Error) {
+                        serializer->Flush ();
                     }
                 }
                 THEKOGANS_UTIL_CATCH (std::exception) {
@@ -69,6 +75,10 @@ namespace thekogans {
             if (archive && archiveCount > 0 && Path (path).Exists ()) {
                 Directory::Entry entry (path);
                 if (entry.size > maxLogFileSize) {
+                    // Pending entries belong in the log being archived.
+                    if (serializer != nullptr) {
+                        serializer->Flush ();
+                    }
                     file.Close ();
                     std::size_t archiveNumber = archiveCount;
                     std::string archivePath =
@@ -102,19 +112,20 @@ namespace thekogans {
                         THEKOGANS_UTIL_THROW_POSIX_ERROR_CODE_EXCEPTION (
                             THEKOGANS_UTIL_POSIX_OS_ERROR_CODE);
                     }
-                    file.Open (path, SimpleFile::ReadWrite | SimpleFile::Create);
+                    file.SimpleOpen (path, SimpleFile::ReadWrite | SimpleFile::Create | SimpleFile::Append);
                 }
             }
         }
 
         void FileLogger::OpenFile () {
             // Deal with our log file being moved in the middle of execution.
+            // Pending entries (if any) will go to the new file.
             if (!Path (path).Exists ()) {
                 file.Close ();
                 Directory::Create (Path (path).GetDirectory ());
             }
             if (!file.IsOpen ()) {
-                file.Open (path, SimpleFile::ReadWrite | SimpleFile::Create | SimpleFile::Append);
+                file.SimpleOpen (path, SimpleFile::ReadWrite | SimpleFile::Create | SimpleFile::Append);
             }
         }
 
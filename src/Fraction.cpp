@@ -25,7 +25,7 @@ namespace thekogans {
     namespace util {
 
         THEKOGANS_UTIL_IMPLEMENT_SERIALIZABLE (
-            thekogans::util::Fraction, 1, UI32_SIZE + UI32_SIZE + UI8_SIZE)
+            thekogans::util::Fraction, 1, SerializableFields<Fraction>::SIZE)
 
         const Fraction Fraction::Zero (0, 1);
         const Fraction Fraction::One (1, 1);
@@ -154,49 +154,7 @@ namespace thekogans {
             denominator /= gcd;
         }
 
-        void Fraction::Read (
-                const SerializableHeader & /*header*/,
-                Serializer &serializer) {
-            serializer >> numerator >> denominator >> (ui8 &)sign;
-        }
-
-        void Fraction::Write (Serializer &serializer) const {
-            serializer << numerator << denominator << (ui8)sign;
-        }
-
-        namespace {
-            const char * const ATTR_NUMERATOR = "Numerator";
-            const char * const ATTR_DENOMINATOR = "Denominator";
-            const char * const ATTR_SIGN = "Sign";
-        }
-
-        void Fraction::ReadXML (
-                const SerializableHeader & /*header*/,
-                const pugi::xml_node &node) {
-            numerator = stringToui32 (node.attribute (ATTR_NUMERATOR).value ());
-            denominator = stringToui32 (node.attribute (ATTR_DENOMINATOR).value ());
-            sign = stringTosign (node.attribute (ATTR_SIGN).value ());
-        }
-
-        void Fraction::WriteXML (pugi::xml_node &node) const {
-            node.append_attribute (ATTR_NUMERATOR).set_value (ui32Tostring (numerator).c_str ());
-            node.append_attribute (ATTR_DENOMINATOR).set_value (ui32Tostring (denominator).c_str ());
-            node.append_attribute (ATTR_SIGN).set_value (signTostring (sign).c_str ());
-        }
-
-        void Fraction::ReadJSON (
-                const SerializableHeader & /*header*/,
-                const JSON::Object &object) {
-            numerator = object.Get<JSON::Number> (ATTR_NUMERATOR)->To<ui32> ();
-            denominator = object.Get<JSON::Number> (ATTR_DENOMINATOR)->To<ui32> ();
-            sign = stringTosign (object.Get<JSON::String> (ATTR_SIGN)->value);
-        }
-
-        void Fraction::WriteJSON (JSON::Object &object) const {
-            object.Add (ATTR_NUMERATOR, numerator);
-            object.Add (ATTR_DENOMINATOR, denominator);
-            object.Add<const std::string &> (ATTR_SIGN, signTostring (sign));
-        }
+        THEKOGANS_UTIL_IMPLEMENT_SERIALIZABLE_FIELDS (Fraction)
 
         _LIB_THEKOGANS_UTIL_DECL Fraction _LIB_THEKOGANS_UTIL_API operator + (
                 const Fraction &fraction1,
@@ -0,0 +1,172 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#include <climits>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <zlib.h>
+#include "thekogans/util/Exception.h"
+#include "thekogans/util/StringUtils.h"
+#include "thekogans/util/InflateSerializer.h"
+
+namespace thekogans {
+    namespace util {
+
+        THEKOGANS_UTIL_IMPLEMENT_DYNAMIC_CREATABLE_OVERRIDE (
+            thekogans::util::InflateSerializer,
+            Serializer::TYPE)
+
+        namespace {
+            std::string GetZlibError (
+                    const z_stream &zStream,
+                    int result) {
+                return zStream.msg != 0 ?
+                    std::string (zStream.msg) : FormatString ("zlib error: %d", result);
+            }
+        }
+
+        struct InflateSerializer::Stream {
+            /// \brief
+            /// zlib stream.
+            z_stream zStream;
+
+            /// \brief
+            /// ctor.
+            /// \param[in] windowBits zlib windowBits (including the format bias).
+            explicit Stream (i32 windowBits) {
+                memset (&zStream, 0, sizeof (zStream));
+                int result = inflateInit2 (&zStream, windowBits);
+                if (result != Z_OK) {
+                    THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                        "%s", GetZlibError (zStream, result).c_str ());
+                }
+            }
+            /// \brief
+            /// dtor.
+            ~Stream () {
+                inflateEnd (&zStream);
+            }
+        };
+
+        InflateSerializer::InflateSerializer (
+                Serializer &serializer_,
+                Endianness endianness,
+                Format format,
+                i32 windowBits,
+                std::size_t bufferSize) :
+                Serializer (endianness),
+                serializer (serializer_),
+                stream (nullptr),
+                buffer (HostEndian, bufferSize),
+                totalOut (0),
+                endOfStream (false),
+                peek (0),
+                peeked (false) {
+            if (windowBits >= 9 && windowBits <= MAX_WBITS &&
+                    bufferSize > 0 && bufferSize <= UINT_MAX) {
+                stream = new Stream (
+                    format == Zlib ? windowBits :
+                        format == Gzip ? windowBits + 16 :
+                            format == Raw ? -windowBits : windowBits + 32);
+            }
+            else {
+                THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                    THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+            }
+        }
+
+        InflateSerializer::~InflateSerializer () {
+            delete stream;
+        }
+
+        bool InflateSerializer::IsEndOfStream () {
+            if (!peeked && !endOfStream) {
+                peeked = Inflate (&peek, 1) == 1;
+            }
+            return !peeked;
+        }
+
+        std::size_t InflateSerializer::Read (
+                void *data,
+                std::size_t count) {
+            if (data != nullptr && count > 0) {
+                ui8 *ptr = (ui8 *)data;
+                std::size_t countRead = 0;
+                if (peeked) {
+                    *ptr++ = peek;
+                    peeked = false;
+                    ++countRead;
+                }
+                countRead += Inflate (ptr, count - countRead);
+                totalOut += countRead;
+                return countRead;
+            }
+            else {
+                THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                    THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+            }
+        }
+
+        std::size_t InflateSerializer::Write (
+                const void * /*data*/,
+                std::size_t /*count*/) {
+            THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                "%s", "InflateSerializer is read only.");
+        }
+
+        std::size_t InflateSerializer::Inflate (
+                ui8 *data,
+                std::size_t count) {
+            z_stream &zStream = stream->zStream;
+            std::size_t countRead = 0;
+            while (countRead < count && !endOfStream) {
+                if (buffer.GetDataAvailableForReading () == 0) {
+                    buffer.Rewind ();
+                    std::size_t countBuffered = serializer.Read (
+                        buffer.GetWritePtr (),
+                        buffer.GetDataAvailableForWriting ());
+                    if (countBuffered == 0) {
+                        THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                            "%s", "Unexpected end of compressed stream.");
+                    }
+                    buffer.AdvanceWriteOffset (countBuffered);
+                }
+                std::size_t availableIn = buffer.GetDataAvailableForReading ();
+                std::size_t availableOut =
+                    (std::min) (count - countRead, (std::size_t)UINT_MAX);
+                zStream.next_in = (Bytef *)buffer.GetReadPtr ();
+                zStream.avail_in = (uInt)availableIn;
+                zStream.next_out = data + countRead;
+                zStream.avail_out = (uInt)availableOut;
+                int result = inflate (&zStream, Z_NO_FLUSH);
+                buffer.AdvanceReadOffset (availableIn - zStream.avail_in);
+                countRead += availableOut - zStream.avail_out;
+                if (result == Z_STREAM_END) {
+                    endOfStream = true;
+                }
+                // Z_BUF_ERROR only means no progress was possible.
+                else if (result != Z_OK && result != Z_BUF_ERROR) {
+                    THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                        "%s", GetZlibError (zStream, result).c_str ());
+                }
+            }
+            return countRead;
+        }
+
+    } // namespace util
+} // namespace thekogans
@@ -15,6 +15,7 @@
 // You should have received a copy of the GNU General Public License
 // along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
 
+#include <algorithm>
 #include "thekogans/util/Heap.h"
 #include "thekogans/util/LockGuard.h"
 #include "thekogans/util/HRTimer.h"
@@ -28,9 +29,20 @@ namespace thekogans {
 
         void JobQueue::State::Worker::Run () noexcept {
             RunLoop::WorkerInitializer workerInitializer (state->workerCallback);
+            bool elastic = state->elasticPolicy.IsElastic ();
             while (!state->done) {
-                Job *job = state->DeqJob ();
-                if (job != nullptr) {
+                Job *job = state->DeqJob (true,
+                    elastic ? state->elasticPolicy.idleTimeout : TimeSpec::Infinite);
+                if (job == nullptr) {
+                    // Timed out waiting for work. See if we're still needed.
+                    if (elastic && !state->done && state->RetireWorker (this)) {
+                        break;
+                    }
+                }
+                else {
+                    if (elastic) {
+                        state->JobDequeued (*job);
+                    }
                     ui64 start = 0;
                     ui64 end = 0;
                     // Short circuit cancelled pending jobs.
@@ -51,13 +63,128 @@ namespace thekogans {
 
         THEKOGANS_UTIL_IMPLEMENT_HEAP_FUNCTIONS (JobQueue::State)
 
+        namespace {
+            std::size_t GetInitialWorkerCount (
+                    std::size_t workerCount,
+                    const JobQueue::ElasticPolicy &elasticPolicy) {
+                return elasticPolicy.IsElastic () ?
+                    std::min (
+                        std::max (workerCount, elasticPolicy.minWorkers),
+                        elasticPolicy.maxWorkers) :
+                    workerCount;
+            }
+
+            ui64 ToHRTimerTicks (const TimeSpec &timeSpec) {
+                return timeSpec == TimeSpec::Infinite ? UI64_MAX :
+                    HRTimer::GetFrequency () * timeSpec.ToMicroseconds () / 1000000;
+            }
+        }
+
+        JobQueue::State::State (
+                const std::string &name,
+                JobExecutionPolicy::SharedPtr jobExecutionPolicy,
+                std::size_t workerCount_,
+                i32 workerPriority_,
+                ui32 workerAffinity_,
+                WorkerCallback *workerCallback_,
+                const ElasticPolicy &elasticPolicy_) :
+                RunLoop::State (name, jobExecutionPolicy),
+                workerCount (GetInitialWorkerCount (workerCount_, elasticPolicy_)),
+                workerPriority (workerPriority_),
+                workerAffinity (workerAffinity_),
+                workerCallback (workerCallback_),
+                elasticPolicy (elasticPolicy_),
+                maxJobWaitTime (ToHRTimerTicks (elasticPolicy.maxJobWaitTime)) {
+            // An elastic queue must always have at least one worker.
+            if (elasticPolicy.IsElastic () && elasticPolicy.minWorkers == 0) {
+                THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                    THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+            }
+        }
+
+        void JobQueue::State::AddWorker (std::size_t index) {
+            std::string workerName;
+            if (!name.empty ()) {
+                if (workerCount > 1 || elasticPolicy.IsElastic ()) {
+                    workerName = FormatString (
+                        "%s-" THEKOGANS_UTIL_SIZE_T_FORMAT, name.c_str (), index);
+                }
+                else {
+                    workerName = name;
+                }
+            }
+            workers.push_back (new Worker (SharedPtr (this), workerName));
+            workerStats.workerCount = workers.size ();
+            if (workerStats.peakWorkerCount < workerStats.workerCount) {
+                workerStats.peakWorkerCount = workerStats.workerCount;
+            }
+        }
+
+        void JobQueue::State::JobEnqueued () {
+            if (elasticPolicy.maxPendingJobs != 0) {
+                LockGuard<Mutex> workersGuard (workersMutex);
+                std::size_t pendingJobCount;
+                {
+                    LockGuard<Mutex> jobsGuard (jobsMutex);
+                    pendingJobCount = pendingJobs.size ();
+                }
+                if (pendingJobCount > elasticPolicy.maxPendingJobs) {
+                    Grow (workerStats.grownOnDepth);
+                }
+            }
+        }
+
+        void JobQueue::State::JobDequeued (const Job &job) {
+            if (maxJobWaitTime != UI64_MAX &&
+                    HRTimer::ComputeElapsedTime (job.enqueueTime, HRTimer::Click ()) > maxJobWaitTime) {
+                LockGuard<Mutex> guard (workersMutex);
+                Grow (workerStats.grownOnWaitTime);
+            }
+        }
+
+        bool JobQueue::State::RetireWorker (Worker *worker) {
+            LockGuard<Mutex> workersGuard (workersMutex);
+            // Stop clears the list. Don't retire workers it
+            // already let go of (they're on their way out).
+            if (!done && workers.contains (worker) &&
+                    workers.size () > elasticPolicy.minWorkers) {
+                {
+                    // Work might have shown up while we were
+                    // waiting for the lock.
+                    LockGuard<Mutex> jobsGuard (jobsMutex);
+                    if (!pendingJobs.empty ()) {
+                        return false;
+                    }
+                }
+                workers.erase (worker);
+                workerStats.workerCount = workers.size ();
+                ++workerStats.retired;
+                return true;
+            }
+            return false;
+        }
+
+        void JobQueue::State::Grow (std::size_t &grown) {
+            // Empty list == the queue is stopped.
+            if (!done && !workers.empty ()) {
+                if (workers.size () < elasticPolicy.maxWorkers) {
+                    AddWorker (workers.size ());
+                    ++grown;
+                }
+                else {
+                    ++workerStats.capped;
+                }
+            }
+        }
+
         JobQueue::JobQueue (
                 const std::string &name,
                 JobExecutionPolicy::SharedPtr jobExecutionPolicy,
                 std::size_t workerCount,
                 i32 workerPriority,
                 ui32 workerAffinity,
-                WorkerCallback *workerCallback) :
+                WorkerCallback *workerCallback,
+                const ElasticPolicy &elasticPolicy) :
                 RunLoop (
                     RunLoop::State::SharedPtr (
                         new State (
@@ -66,7 +193,8 @@ namespace thekogans {
                             workerCount,
                             workerPriority,
                             workerAffinity,
-                            workerCallback))),
+                            workerCallback,
+                            elasticPolicy))),
                 state (dynamic_refcounted_sharedptr_cast<State> (RunLoop::state)) {
             if (workerCount > 0) {
                 Start ();
@@ -81,17 +209,7 @@ namespace thekogans {
             LockGuard<Mutex> guard (state->workersMutex);
             state->done = false;
             for (std::size_t i = state->workers.size (); i < state->workerCount; ++i) {
-                std::string workerName;
-                if (!state->name.empty ()) {
-                    if (state->workerCount > 1) {
-                        workerName = FormatString (
-                            "%s-" THEKOGANS_UTIL_SIZE_T_FORMAT, state->name.c_str (), i);
-                    }
-                    else {
-                        workerName = state->name;
-                    }
-                }
-                state->workers.push_back (new State::Worker (state, workerName));
+                state->AddWorker (i);
             }
         }
 
@@ -105,6 +223,7 @@ namespace thekogans {
             // below in case workers exit before we can clear the
             // list so as not to have a race leading to a crash.
             state->workers.clear ();
+            state->workerStats.workerCount = 0;
             // Preclude workers from dequeuing any more pending jobs.
             state->done = true;
             // Wake up sleeping workers to allow them to exit.
@@ -134,6 +253,33 @@ namespace thekogans {
             return !state->workers.empty ();
         }
 
+        bool JobQueue::EnqJob (
+                Job::SharedPtr job,
+                bool wait,
+                const TimeSpec &timeSpec) {
+            RunLoop::EnqJob (job, false);
+            if (state->elasticPolicy.IsElastic ()) {
+                state->JobEnqueued ();
+            }
+            return !wait || WaitForJob (job, timeSpec);
+        }
+
+        bool JobQueue::EnqJobFront (
+                Job::SharedPtr job,
+                bool wait,
+                const TimeSpec &timeSpec) {
+            RunLoop::EnqJobFront (job, false);
+            if (state->elasticPolicy.IsElastic ()) {
+                state->JobEnqueued ();
+            }
+            return !wait || WaitForJob (job, timeSpec);
+        }
+
+        JobQueue::WorkerStats JobQueue::GetWorkerStats () {
+            LockGuard<Mutex> guard (state->workersMutex);
+            return state->workerStats;
+        }
+
         JobQueue::JobQueue (State::SharedPtr state_) :
                 RunLoop (state_),
                 state (state_) {
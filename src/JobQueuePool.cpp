@@ -35,7 +35,9 @@ namespace thekogans {
                 std::size_t workerCount_,
                 i32 workerPriority_,
                 ui32 workerAffinity_,
-                RunLoop::WorkerCallback *workerCallback_) :
+                RunLoop::WorkerCallback *workerCallback_,
+                const util::JobQueue::ElasticPolicy &elasticPolicy_,
+                const TimeSpec &jobQueueIdleTimeout_) :
                 minJobQueues (minJobQueues_),
                 maxJobQueues (maxJobQueues_),
                 name (name_),
@@ -44,30 +46,19 @@ namespace thekogans {
                 workerPriority (workerPriority_),
                 workerAffinity (workerAffinity_),
                 workerCallback (workerCallback_),
+                elasticPolicy (elasticPolicy_),
+                jobQueueIdleTimeout (jobQueueIdleTimeout_),
                 idPool (0),
-                idle (mutex) {
+                idle (mutex),
+                available (mutex) {
             // By requiring at least one JobQueue in reserve coupled
             // with the logic in ReleaseJobQueue below, we guarantee
             // that we avoid the deadlock associated with trying to
             // delete the JobQueue being released.
             if (0 < minJobQueues && minJobQueues <= maxJobQueues) {
+                LockGuard<Mutex> guard (mutex);
                 for (std::size_t i = 0; i < minJobQueues; ++i) {
-                    std::string jobQueueName;
-                    if (!name.empty ()) {
-                        jobQueueName = FormatString (
-                            "%s-" THEKOGANS_UTIL_SIZE_T_FORMAT,
-                            name.c_str (),
-                            ++idPool);
-                    }
-                    availableJobQueues.push_back (
-                        new JobQueue (
-                            jobQueueName,
-                            jobExecutionPolicy,
-                            workerCount,
-                            workerPriority,
-                            workerAffinity,
-                            workerCallback,
-                            *this));
+                    availableJobQueues.push_back (CreateJobQueue ());
                 }
             }
             else {
@@ -80,10 +71,11 @@ namespace thekogans {
             // Wait for all borrowed queues to be returned.
             WaitForIdle ();
             assert (borrowedJobQueues.empty ());
+            LockGuard<Mutex> guard (mutex);
             availableJobQueues.clear (
-                [] (JobQueueList::Callback::argument_type jobQueue) ->
+                [this] (JobQueueList::Callback::argument_type jobQueue) ->
                         JobQueueList::Callback::result_type {
-                    delete jobQueue;
+                    DeleteJobQueue (jobQueue);
                     return true;
                 }
             );
@@ -92,10 +84,19 @@ namespace thekogans {
         JobQueue::SharedPtr JobQueuePool::GetJobQueue (
                 std::size_t retries,
                 const TimeSpec &timeSpec) {
-            JobQueue *jobQueue = AcquireJobQueue ();
-            while (jobQueue == nullptr && retries-- > 0) {
-                Sleep (timeSpec);
+            JobQueue *jobQueue = nullptr;
+            {
+                LockGuard<Mutex> guard (mutex);
                 jobQueue = AcquireJobQueue ();
+                while (jobQueue == nullptr && retries-- > 0) {
+                    // Rather than sleeping blindly, wake up
+                    // as soon as a queue is returned.
+                    available.Wait (timeSpec);
+                    jobQueue = AcquireJobQueue ();
+                }
+                if (jobQueue == nullptr) {
+                    ++stats.exhausted;
+                }
             }
             return util::JobQueue::SharedPtr (jobQueue);
         }
@@ -155,37 +156,56 @@ namespace thekogans {
             return borrowedJobQueues.empty ();
         }
 
+        JobQueuePool::Stats JobQueuePool::GetStats () {
+            LockGuard<Mutex> guard (mutex);
+            return stats;
+        }
+
+        JobQueuePool::JobQueue *JobQueuePool::CreateJobQueue () {
+            std::string jobQueueName;
+            if (!name.empty ()) {
+                jobQueueName = FormatString (
+                    "%s-" THEKOGANS_UTIL_SIZE_T_FORMAT,
+                    name.c_str (),
+                    ++idPool);
+            }
+            JobQueue *jobQueue = new JobQueue (
+                jobQueueName,
+                jobExecutionPolicy,
+                workerCount,
+                workerPriority,
+                workerAffinity,
+                workerCallback,
+                elasticPolicy,
+                *this);
+            ++stats.created;
+            ++stats.jobQueueCount;
+            if (stats.peakJobQueueCount < stats.jobQueueCount) {
+                stats.peakJobQueueCount = stats.jobQueueCount;
+            }
+            return jobQueue;
+        }
+
+        void JobQueuePool::DeleteJobQueue (JobQueue *jobQueue) {
+            delete jobQueue;
+            ++stats.retired;
+            --stats.jobQueueCount;
+        }
+
         JobQueuePool::JobQueue *JobQueuePool::AcquireJobQueue () {
             JobQueue *jobQueue = nullptr;
-            {
-                LockGuard<Mutex> guard (mutex);
-                if (!availableJobQueues.empty ()) {
-                    // Borrow a job queue from the front of the pool.
-                    // This combined with ReleaseJobQueue putting
-                    // returned job queue at the front should
-                    // guarantee the best cache utilization.
-                    jobQueue = availableJobQueues.pop_front ();
-                }
-                else if (availableJobQueues.size () + borrowedJobQueues.size () < maxJobQueues) {
-                    std::string jobQueueName;
-                    if (!name.empty ()) {
-                        jobQueueName = FormatString (
-                            "%s-" THEKOGANS_UTIL_SIZE_T_FORMAT,
-                            name.c_str (),
-                            ++idPool);
-                    }
-                    jobQueue = new JobQueue (
-                        jobQueueName,
-                        jobExecutionPolicy,
-                        workerCount,
-                        workerPriority,
-                        workerAffinity,
-                        workerCallback,
-                        *this);
-                }
-                if (jobQueue != nullptr) {
-                    borrowedJobQueues.push_back (jobQueue);
-                }
+            if (!availableJobQueues.empty ()) {
+                // Borrow a job queue from the front of the pool.
+                // This combined with ReleaseJobQueue putting
+                // returned job queue at the front should
+                // guarantee the best cache utilization.
+                jobQueue = availableJobQueues.pop_front ();
+            }
+            else if (availableJobQueues.size () + borrowedJobQueues.size () < maxJobQueues) {
+                jobQueue = CreateJobQueue ();
+            }
+            if (jobQueue != nullptr) {
+                borrowedJobQueues.push_back (jobQueue);
             }
             return jobQueue;
         }
@@ -199,16 +219,31 @@ namespace thekogans {
                 // is borrowed from this pool, it will be the last
                 // one used, and it's cache will be nice and warm.
                 availableJobQueues.push_front (jobQueue);
+                jobQueue->releaseTime = GetCurrentTime ();
+                available.Signal ();
                 // If the pool is idle, see if we need to remove excess job queues.
                 if (borrowedJobQueues.empty ()) {
                     while (availableJobQueues.size () > minJobQueues) {
                         // Delete the least recently used queues. This logic
                         // guarantees that we avoid the deadlock associated
                         // with deleating the passed in jobQueue.
-                        delete availableJobQueues.pop_back ();
+                        DeleteJobQueue (availableJobQueues.pop_back ());
                     }
                     idle.SignalAll ();
                 }
+                else if (jobQueueIdleTimeout != TimeSpec::Infinite) {
+                    // Under steady load the pool is never idle. Retire
+                    // the queues that have not been borrowed in a while.
+                    // availableJobQueues is in release order so the
+                    // stale ones are at the back (and the one we just
+                    // released is at the front).
+                    TimeSpec deadline = jobQueue->releaseTime - jobQueueIdleTimeout;
+                    while (availableJobQueues.size () + borrowedJobQueues.size () > minJobQueues &&
+                            availableJobQueues.back () != jobQueue &&
+                            availableJobQueues.back ()->releaseTime < deadline) {
+                        DeleteJobQueue (availableJobQueues.pop_back ());
+                    }
+                }
             }
             else {
                 THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
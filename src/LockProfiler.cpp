@@ -0,0 +1,556 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#if defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+    #include <unordered_map>
+#endif // defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+#include "thekogans/util/LockGuard.h"
+#include "thekogans/util/HRTimer.h"
+#include "thekogans/util/XMLUtils.h"
+#include "thekogans/util/StringUtils.h"
+#include "thekogans/util/LockProfiler.h"
+
+namespace thekogans {
+    namespace util {
+
+        THEKOGANS_UTIL_IMPLEMENT_SERIALIZABLE (thekogans::util::LockProfiler::Stats, 1, 0)
+
+        LockProfiler::Stats &LockProfiler::Stats::operator = (const Stats &stats) {
+            if (&stats != this) {
+                type = stats.type;
+                name = stats.name;
+                acquisitions = stats.acquisitions;
+                contentions = stats.contentions;
+                totalWaitTime = stats.totalWaitTime;
+                maxWaitTime = stats.maxWaitTime;
+                totalHoldTime = stats.totalHoldTime;
+                maxHoldTime = stats.maxHoldTime;
+            }
+            return *this;
+        }
+
+        std::size_t LockProfiler::Stats::Size () const noexcept {
+            return Serializer::Size (type) +
+                Serializer::Size (name) +
+                Serializer::Size (acquisitions) +
+                Serializer::Size (contentions) +
+                Serializer::Size (totalWaitTime) +
+                Serializer::Size (maxWaitTime) +
+                Serializer::Size (totalHoldTime) +
+                Serializer::Size (maxHoldTime);
+        }
+
+        void LockProfiler::Stats::Read (
+                const SerializableHeader & /*header*/,
+                Serializer &serializer) {
+            serializer >> type >> name >> acquisitions >> contentions >>
+                totalWaitTime >> maxWaitTime >> totalHoldTime >> maxHoldTime;
+        }
+
+        void LockProfiler::Stats::Write (Serializer &serializer) const {
+            serializer << type << name << acquisitions << contentions <<
+                totalWaitTime << maxWaitTime << totalHoldTime << maxHoldTime;
+        }
+
+        namespace {
+            const char * const ATTR_TYPE = "Type";
+            const char * const ATTR_NAME = "Name";
+            const char * const ATTR_ACQUISITIONS = "Acquisitions";
+            const char * const ATTR_CONTENTIONS = "Contentions";
+            const char * const ATTR_TOTAL_WAIT_TIME = "TotalWaitTime";
+            const char * const ATTR_MAX_WAIT_TIME = "MaxWaitTime";
+            const char * const ATTR_TOTAL_HOLD_TIME = "TotalHoldTime";
+            const char * const ATTR_MAX_HOLD_TIME = "MaxHoldTime";
+            const char * const ATTR_FREQUENCY = "Frequency";
+            const char * const TAG_LOCKS = "Locks";
+            const char * const TAG_LOCK = "Lock";
+        }
+
+        void LockProfiler::Stats::ReadXML (
+                const SerializableHeader & /*header*/,
+                const pugi::xml_node &node) {
+            type = node.attribute (ATTR_TYPE).value ();
+            name = Decodestring (node.attribute (ATTR_NAME).value ());
+            acquisitions = stringToui64 (node.attribute (ATTR_ACQUISITIONS).value ());
+            contentions = stringToui64 (node.attribute (ATTR_CONTENTIONS).value ());
+            totalWaitTime = stringToui64 (node.attribute (ATTR_TOTAL_WAIT_TIME).value ());
+            maxWaitTime = stringToui64 (node.attribute (ATTR_MAX_WAIT_TIME).value ());
+            totalHoldTime = stringToui64 (node.attribute (ATTR_TOTAL_HOLD_TIME).value ());
+            maxHoldTime = stringToui64 (node.attribute (ATTR_MAX_HOLD_TIME).value ());
+        }
+
+        void LockProfiler::Stats::WriteXML (pugi::xml_node &node) const {
+            node.append_attribute (ATTR_TYPE).set_value (type.c_str ());
+            node.append_attribute (ATTR_NAME).set_value (Encodestring (name).c_str ());
+            node.append_attribute (ATTR_ACQUISITIONS).set_value (ui64Tostring (acquisitions).c_str ());
+            node.append_attribute (ATTR_CONTENTIONS).set_value (ui64Tostring (contentions).c_str ());
+            node.append_attribute (ATTR_TOTAL_WAIT_TIME).set_value (ui64Tostring (totalWaitTime).c_str ());
+            node.append_attribute (ATTR_MAX_WAIT_TIME).set_value (ui64Tostring (maxWaitTime).c_str ());
+            node.append_attribute (ATTR_TOTAL_HOLD_TIME).set_value (ui64Tostring (totalHoldTime).c_str ());
+            node.append_attribute (ATTR_MAX_HOLD_TIME).set_value (ui64Tostring (maxHoldTime).c_str ());
+        }
+
+        void LockProfiler::Stats::ReadJSON (
+                const SerializableHeader & /*header*/,
+                const JSON::Object &object) {
+            type = object.Get<JSON::String> (ATTR_TYPE)->value;
+            name = object.Get<JSON::String> (ATTR_NAME)->value;
+            acquisitions = object.Get<JSON::Number> (ATTR_ACQUISITIONS)->To<ui64> ();
+            contentions = object.Get<JSON::Number> (ATTR_CONTENTIONS)->To<ui64> ();
+            totalWaitTime = object.Get<JSON::Number> (ATTR_TOTAL_WAIT_TIME)->To<ui64> ();
+            maxWaitTime = object.Get<JSON::Number> (ATTR_MAX_WAIT_TIME)->To<ui64> ();
+            totalHoldTime = object.Get<JSON::Number> (ATTR_TOTAL_HOLD_TIME)->To<ui64> ();
+            maxHoldTime = object.Get<JSON::Number> (ATTR_MAX_HOLD_TIME)->To<ui64> ();
+        }
+
+        void LockProfiler::Stats::WriteJSON (JSON::Object &object) const {
+            object.Add<const std::string &> (ATTR_TYPE, type);
+            object.Add<const std::string &> (ATTR_NAME, name);
+            object.Add (ATTR_ACQUISITIONS, acquisitions);
+            object.Add (ATTR_CONTENTIONS, contentions);
+            object.Add (ATTR_TOTAL_WAIT_TIME, totalWaitTime);
+            object.Add (ATTR_MAX_WAIT_TIME, maxWaitTime);
+            object.Add (ATTR_TOTAL_HOLD_TIME, totalHoldTime);
+            object.Add (ATTR_MAX_HOLD_TIME, maxHoldTime);
+        }
+
+        THEKOGANS_UTIL_IMPLEMENT_SERIALIZABLE (thekogans::util::LockProfiler::Report, 1, 0)
+
+        LockProfiler::Report &LockProfiler::Report::operator = (const Report &report) {
+            if (&report != this) {
+                frequency = report.frequency;
+                locks = report.locks;
+            }
+            return *this;
+        }
+
+        std::size_t LockProfiler::Report::Size () const noexcept {
+            std::size_t size =
+                Serializer::Size (frequency) +
+                SizeT (locks.size ()).Size ();
+            for (std::size_t i = 0, count = locks.size (); i < count; ++i) {
+                size += locks[i].GetSize ();
+            }
+            return size;
+        }
+
+        void LockProfiler::Report::Read (
+                const SerializableHeader & /*header*/,
+                Serializer &serializer) {
+            serializer >> frequency >> locks;
+        }
+
+        void LockProfiler::Report::Write (Serializer &serializer) const {
+            serializer << frequency << locks;
+        }
+
+        void LockProfiler::Report::ReadXML (
+                const SerializableHeader & /*header*/,
+                const pugi::xml_node &node) {
+            frequency = stringToui64 (node.attribute (ATTR_FREQUENCY).value ());
+            locks.clear ();
+            pugi::xml_node locksNode = node.child (TAG_LOCKS);
+            for (pugi::xml_node child = locksNode.first_child ();
+                    !child.empty (); child = child.next_sibling ()) {
+                if (child.type () == pugi::node_element &&
+                        std::string (child.name ()) == TAG_LOCK) {
+                    Stats stats;
+                    child >> stats;
+                    locks.push_back (stats);
+                }
+            }
+        }
+
+        void LockProfiler::Report::WriteXML (pugi::xml_node &node) const {
+            node.append_attribute (ATTR_FREQUENCY).set_value (ui64Tostring (frequency).c_str ());
+            pugi::xml_node locksNode = node.append_child (TAG_LOCKS);
+            for (std::size_t i = 0, count = locks.size (); i < count; ++i) {
+                pugi::xml_node child = locksNode.append_child (TAG_LOCK);
+                child << locks[i];
+            }
+        }
+
+        void LockProfiler::Report::ReadJSON (
+                const SerializableHeader & /*header*/,
+                const JSON::Object &object) {
+            frequency = object.Get<JSON::Number> (ATTR_FREQUENCY)->To<ui64> ();
+            locks.clear ();
+            JSON::Array::SharedPtr locksArray = object.Get<JSON::Array> (TAG_LOCKS);
+            if (locksArray != nullptr) {
+                for (std::size_t i = 0, count = locksArray->GetValueCount (); i < count; ++i) {
+                    JSON::Object::SharedPtr child = locksArray->Get<JSON::Object> (i);
+                    if (child != nullptr) {
+                        Stats stats;
+                        *child >> stats;
+                        locks.push_back (stats);
+                    }
+                }
+            }
+        }
+
+        void LockProfiler::Report::WriteJSON (JSON::Object &object) const {
+            object.Add (ATTR_FREQUENCY, frequency);
+            JSON::Array::SharedPtr locksArray (new JSON::Array);
+            for (std::size_t i = 0, count = locks.size (); i < count; ++i) {
+                JSON::Object::SharedPtr child (new JSON::Object);
+                *child << locks[i];
+                locksArray->Add (child);
+            }
+            object.Add (TAG_LOCKS, locksArray);
+        }
+
+    #if defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+        struct LockProbe::Site {
+            /// \brief
+            /// Lock type.
+            const char *type;
+            /// \brief
+            /// Lock name.
+            std::string name;
+
+            /// \brief
+            /// ctor.
+            /// \param[in] type_ Lock type.
+            /// \param[in] name_ Lock name.
+            Site (
+                const char *type_,
+                const std::string &name_) :
+                type (type_),
+                name (name_) {}
+        };
+
+        std::atomic<bool> LockProbe::enabled (false);
+
+        LockProbe::~LockProbe () {
+            if (site != nullptr) {
+                LockProfiler::Instance ()->DestroySite (site);
+            }
+        }
+
+        void LockProbe::SetName (
+                const char *type,
+                const std::string &name) {
+            if (site != nullptr) {
+                LockProfiler::Instance ()->DestroySite (site);
+                site = nullptr;
+            }
+            site = LockProfiler::Instance ()->CreateSite (type, name);
+        }
+
+        ui64 LockProbe::Now () {
+            return HRTimer::Click ();
+        }
+
+        void LockProbe::Acquired (
+                bool shared,
+                bool contended,
+                ui64 waitTime) {
+            LockProfiler::Instance ()->RecordAcquire (site, contended, waitTime);
+            if (!shared) {
+                acquiredAt = Now ();
+            }
+        }
+
+        void LockProbe::Released () {
+            ui64 holdTime = Now () - acquiredAt;
+            acquiredAt = 0;
+            LockProfiler::Instance ()->RecordRelease (site, holdTime);
+        }
+
+        struct LockProfiler::Counters {
+            /// \brief
+            /// Number of acquisitions.
+            ui64 acquisitions;
+            /// \brief
+            /// Number of acquisitions that had to wait.
+            ui64 contentions;
+            /// \brief
+            /// Total time spent waiting.
+            ui64 totalWaitTime;
+            /// \brief
+            /// Longest wait.
+            ui64 maxWaitTime;
+            /// \brief
+            /// Total hold time.
+            ui64 totalHoldTime;
+            /// \brief
+            /// Longest hold time.
+            ui64 maxHoldTime;
+
+            /// \brief
+            /// ctor.
+            Counters () :
+                acquisitions (0),
+                contentions (0),
+                totalWaitTime (0),
+                maxWaitTime (0),
+                totalHoldTime (0),
+                maxHoldTime (0) {}
+
+            /// \brief
+            /// Add the given counters to ours.
+            /// \param[in] counters Counters to add.
+            void Merge (const Counters &counters) {
+                acquisitions += counters.acquisitions;
+                contentions += counters.contentions;
+                totalWaitTime += counters.totalWaitTime;
+                maxWaitTime = std::max (maxWaitTime, counters.maxWaitTime);
+                totalHoldTime += counters.totalHoldTime;
+                maxHoldTime = std::max (maxHoldTime, counters.maxHoldTime);
+            }
+        };
+
+        struct LockProfiler::ThreadBuffer {
+            /// \brief
+            /// Alias for std::unordered_map<const LockProbe::Site *, Counters>.
+            using Map = std::unordered_map<const LockProbe::Site *, Counters>;
+            /// \brief
+            /// Per lock counters.
+            Map map;
+            /// \brief
+            /// Only ever contended by GetReport and Reset.
+            SpinLock spinLock;
+
+            /// \brief
+            /// Add the given buffer's counters to ours.
+            /// \param[in] buffer Buffer to merge.
+            void Merge (ThreadBuffer &buffer) {
+                LockGuard<SpinLock> guard (buffer.spinLock);
+                for (Map::const_iterator it = buffer.map.begin (),
+                        end = buffer.map.end (); it != end; ++it) {
+                    map[it->first].Merge (it->second);
+                }
+            }
+        };
+
+        namespace {
+            // Set once the calling thread's ThreadBufferHolder is gone. Locks
+            // used by other thread_local dtors can't record any more.
+            // NOTE: bool is trivially destructible, so it's safe to look at
+            // for the entire life of the thread.
+            thread_local bool threadBufferReleased = false;
+        }
+
+        struct LockProfiler::ThreadBufferHolder {
+            /// \brief
+            /// The calling thread's buffer.
+            ThreadBuffer *buffer;
+
+            /// \brief
+            /// ctor.
+            ThreadBufferHolder () :
+                buffer (nullptr) {}
+            /// \brief
+            /// dtor. Runs when the owning thread exits.
+            ~ThreadBufferHolder () {
+                threadBufferReleased = true;
+                if (buffer != nullptr) {
+                    LockProfiler::Instance ()->ReleaseThreadBuffer (buffer);
+                }
+            }
+        };
+
+        LockProfiler::LockProfiler () :
+            exited (new ThreadBuffer) {}
+
+        LockProfiler::~LockProfiler () {
+            for (std::size_t i = 0, count = buffers.size (); i < count; ++i) {
+                delete buffers[i];
+            }
+        }
+
+        void LockProfiler::Enable () {
+            LockProbe::enabled.store (true, std::memory_order_relaxed);
+        }
+
+        void LockProfiler::Disable () {
+            LockProbe::enabled.store (false, std::memory_order_relaxed);
+        }
+
+        bool LockProfiler::IsEnabled () const {
+            return LockProbe::enabled.load (std::memory_order_relaxed);
+        }
+
+        LockProfiler::Report LockProfiler::GetReport () {
+            Report report;
+            report.frequency = HRTimer::GetFrequency ();
+            LockGuard<SpinLock> guard (spinLock);
+            ThreadBuffer total;
+            total.Merge (*exited);
+            for (std::size_t i = 0, count = buffers.size (); i < count; ++i) {
+                total.Merge (*buffers[i]);
+            }
+            for (std::size_t i = 0, count = sites.size (); i < count; ++i) {
+                Stats stats (sites[i]->type, sites[i]->name);
+                ThreadBuffer::Map::const_iterator it = total.map.find (sites[i].get ());
+                if (it != total.map.end ()) {
+                    stats.acquisitions = it->second.acquisitions;
+                    stats.contentions = it->second.contentions;
+                    stats.totalWaitTime = it->second.totalWaitTime;
+                    stats.maxWaitTime = it->second.maxWaitTime;
+                    stats.totalHoldTime = it->second.totalHoldTime;
+                    stats.maxHoldTime = it->second.maxHoldTime;
+                }
+                report.locks.push_back (stats);
+            }
+            std::stable_sort (report.locks.begin (), report.locks.end (),
+                [] (const Stats &stats1, const Stats &stats2) -> bool {
+                    return stats1.totalWaitTime > stats2.totalWaitTime;
+                });
+            return report;
+        }
+
+        void LockProfiler::Reset () {
+            LockGuard<SpinLock> guard (spinLock);
+            exited->map.clear ();
+            for (std::size_t i = 0, count = buffers.size (); i < count; ++i) {
+                LockGuard<SpinLock> guard (buffers[i]->spinLock);
+                buffers[i]->map.clear ();
+            }
+        }
+
+        LockProbe::Site *LockProfiler::CreateSite (
+                const char *type,
+                const std::string &name) {
+            LockGuard<SpinLock> guard (spinLock);
+            sites.emplace_back (new LockProbe::Site (type, name));
+            return sites.back ().get ();
+        }
+
+        void LockProfiler::DestroySite (LockProbe::Site *site) {
+            LockGuard<SpinLock> guard (spinLock);
+            // Scrub the counters so that a new site that
+            // happens to get the same address starts fresh.
+            exited->map.erase (site);
+            for (std::size_t i = 0, count = buffers.size (); i < count; ++i) {
+                LockGuard<SpinLock> guard (buffers[i]->spinLock);
+                buffers[i]->map.erase (site);
+            }
+            for (std::size_t i = 0, count = sites.size (); i < count; ++i) {
+                if (sites[i].get () == site) {
+                    sites.erase (sites.begin () + i);
+                    break;
+                }
+            }
+        }
+
+        LockProfiler::ThreadBuffer *LockProfiler::GetThreadBuffer () {
+            if (threadBufferReleased) {
+                return nullptr;
+            }
+            static thread_local ThreadBufferHolder holder;
+            if (holder.buffer == nullptr) {
+                holder.buffer = new ThreadBuffer;
+                LockGuard<SpinLock> guard (spinLock);
+                buffers.push_back (holder.buffer);
+            }
+            return holder.buffer;
+        }
+
+        void LockProfiler::ReleaseThreadBuffer (ThreadBuffer *buffer) {
+            {
+                LockGuard<SpinLock> guard (spinLock);
+                exited->Merge (*buffer);
+                buffers.erase (std::find (buffers.begin (), buffers.end (), buffer));
+            }
+            delete buffer;
+        }
+
+        void LockProfiler::RecordAcquire (
+                const LockProbe::Site *site,
+                bool contended,
+                ui64 waitTime) {
+            ThreadBuffer *buffer = GetThreadBuffer ();
+            if (buffer != nullptr) {
+                LockGuard<SpinLock> guard (buffer->spinLock);
+                Counters &counters = buffer->map[site];
+                ++counters.acquisitions;
+                if (contended) {
+                    ++counters.contentions;
+                    counters.totalWaitTime += waitTime;
+                    if (counters.maxWaitTime < waitTime) {
+                        counters.maxWaitTime = waitTime;
+                    }
+                }
+            }
+        }
+
+        void LockProfiler::RecordRelease (
+                const LockProbe::Site *site,
+                ui64 holdTime) {
+            ThreadBuffer *buffer = GetThreadBuffer ();
+            if (buffer != nullptr) {
+                LockGuard<SpinLock> guard (buffer->spinLock);
+                Counters &counters = buffer->map[site];
+                counters.totalHoldTime += holdTime;
+                if (counters.maxHoldTime < holdTime) {
+                    counters.maxHoldTime = holdTime;
+                }
+            }
+        }
+    #else // defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+        LockProfiler::LockProfiler () {}
+
+        LockProfiler::~LockProfiler () {}
+
+        void LockProfiler::Enable () {}
+
+        void LockProfiler::Disable () {}
+
+        bool LockProfiler::IsEnabled () const {
+            return false;
+        }
+
+        LockProfiler::Report LockProfiler::GetReport () {
+            Report report;
+            report.frequency = HRTimer::GetFrequency ();
+            return report;
+        }
+
+        void LockProfiler::Reset () {}
+    #endif // defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+
+        void LockProfiler::DumpLocks (
+                const std::string &header,
+                std::ostream &stream) {
+            Report report = GetReport ();
+            if (!header.empty ()) {
+                stream << header << std::endl;
+            }
+            for (std::size_t i = 0, count = report.locks.size (); i < count; ++i) {
+                const Stats &stats = report.locks[i];
+                Attributes attributes;
+                attributes.push_back (Attribute ("type", stats.type));
+                attributes.push_back (Attribute ("name", Encodestring (stats.name)));
+                attributes.push_back (Attribute ("acquisitions", ui64Tostring (stats.acquisitions)));
+                attributes.push_back (Attribute ("contentions", ui64Tostring (stats.contentions)));
+                attributes.push_back (Attribute ("totalWaitTime",
+                    f64Tostring (HRTimer::ToSeconds (stats.totalWaitTime))));
+                attributes.push_back (Attribute ("maxWaitTime",
+                    f64Tostring (HRTimer::ToSeconds (stats.maxWaitTime))));
+                attributes.push_back (Attribute ("totalHoldTime",
+                    f64Tostring (HRTimer::ToSeconds (stats.totalHoldTime))));
+                attributes.push_back (Attribute ("maxHoldTime",
+                    f64Tostring (HRTimer::ToSeconds (stats.maxHoldTime))));
+                stream << OpenTag (0, "Lock", attributes, true, true);
+            }
+            stream.flush ();
+        }
+
+    } // namespace util
+} // namespace thekogans
@@ -0,0 +1,339 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#include "thekogans/util/Environment.h"
+
+#if defined (TOOLCHAIN_OS_Windows) || defined (THEKOGANS_UTIL_HAVE_MMAP)
+
+#if defined (TOOLCHAIN_OS_Windows)
+    #include "thekogans/util/os/windows/WindowsHeader.h"
+#else // defined (TOOLCHAIN_OS_Windows)
+    #include <sys/mman.h>
+#endif // defined (TOOLCHAIN_OS_Windows)
+#include <cstring>
+#include <algorithm>
+#include "thekogans/util/Exception.h"
+#include "thekogans/util/LoggerMgr.h"
+#include "thekogans/util/NullAllocator.h"
+#include "thekogans/util/SystemInfo.h"
+#include "thekogans/util/MMapFile.h"
+
+namespace thekogans {
+    namespace util {
+
+        THEKOGANS_UTIL_IMPLEMENT_DYNAMIC_CREATABLE_OVERRIDE (
+            thekogans::util::MMapFile,
+            Serializer::TYPE, RandomSeekSerializer::TYPE)
+
+        MMapFile::MMapFile (
+                Endianness endianness,
+                const std::string &path,
+                Mode mode_,
+                ui64 capacity) :
+                RandomSeekSerializer (endianness),
+                file (
+                    HostEndian,
+                    path,
+                    mode_ == ReadOnly ?
+                        SimpleFile::ReadOnly :
+                        SimpleFile::ReadWrite | SimpleFile::Create),
+                mode (mode_),
+            #if defined (TOOLCHAIN_OS_Windows)
+                mapping (0),
+            #endif // defined (TOOLCHAIN_OS_Windows)
+                region (HostEndian, (void *)0, 0, 0, 0, NullAllocator::Instance ()) {
+            ui64 size = file.GetSize ();
+            if (mode == ReadOnly) {
+                Map ((std::size_t)size);
+                region.writeOffset = (std::size_t)size;
+                // Read only mappings are memory backed for reading. The fixed
+                // size fast paths and borrowing go straight to the mapped pages.
+                // All writes land in Write below (which throws).
+                readMemory = &region;
+            }
+            else {
+                region.writeOffset = (std::size_t)size;
+                capacity = (std::max) (capacity, size);
+                if (capacity > size) {
+                    file.SetSize (capacity);
+                }
+                Map ((std::size_t)capacity);
+            }
+        }
+
+        MMapFile::~MMapFile () {
+            THEKOGANS_UTIL_TRY {
+                Close ();
+            }
+            THEKOGANS_UTIL_CATCH_AND_LOG_SUBSYSTEM (THEKOGANS_UTIL)
+        }
+
+        ByteView MMapFile::GetView (
+                ui64 offset,
+                std::size_t length) const {
+            if (offset <= region.writeOffset && length <= region.writeOffset - offset) {
+                return ByteView (region.data + offset, length);
+            }
+            else {
+                THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                    THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+            }
+        }
+
+        void MMapFile::Advise (
+                Advice advice,
+                ui64 offset,
+                ui64 length) {
+            if (offset > region.length) {
+                THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                    THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+            }
+            if (length == 0 || length > region.length - offset) {
+                length = region.length - offset;
+            }
+            if (length > 0) {
+            #if defined (TOOLCHAIN_OS_Windows)
+                // Windows only has a prefetch hint (Windows 8 and up).
+                if (advice == WillNeed) {
+                #if _WIN32_WINNT >= 0x0602
+                    WIN32_MEMORY_RANGE_ENTRY entry;
+                    entry.VirtualAddress = region.data + offset;
+                    entry.NumberOfBytes = (SIZE_T)length;
+                    if (!PrefetchVirtualMemory (GetCurrentProcess (), 1, &entry, 0)) {
+                        THEKOGANS_UTIL_THROW_ERROR_CODE_AND_MESSAGE_EXCEPTION (
+                            THEKOGANS_UTIL_OS_ERROR_CODE, " (%s)", GetPath ().c_str ());
+                    }
+                #endif // _WIN32_WINNT >= 0x0602
+                }
+            #else // defined (TOOLCHAIN_OS_Windows)
+                static const int advices[] = {
+                    MADV_NORMAL,
+                    MADV_SEQUENTIAL,
+                    MADV_RANDOM,
+                    MADV_WILLNEED,
+                    MADV_DONTNEED
+                };
+                // madvise wants a page aligned address.
+                ui64 pageOffset = offset % SystemInfo::Instance ()->GetPageSize ();
+                if (madvise (region.data + offset - pageOffset,
+                        (std::size_t)(length + pageOffset), advices[advice]) != 0) {
+                    THEKOGANS_UTIL_THROW_ERROR_CODE_AND_MESSAGE_EXCEPTION (
+                        THEKOGANS_UTIL_OS_ERROR_CODE, " (%s)", GetPath ().c_str ());
+                }
+            #endif // defined (TOOLCHAIN_OS_Windows)
+            }
+        }
+
+        void MMapFile::Reserve (ui64 capacity) {
+            if (mode == ReadOnly) {
+                THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                    "%s is mapped read only.", GetPath ().c_str ());
+            }
+            if (capacity > region.length) {
+                Grow ((std::size_t)capacity);
+            }
+        }
+
+        void MMapFile::Close () {
+            if (IsOpen ()) {
+                Unmap ();
+                if (mode == ReadWrite) {
+                    file.SetSize (region.writeOffset);
+                }
+                file.Close ();
+                region.readOffset = 0;
+                region.writeOffset = 0;
+            }
+        }
+
+        std::size_t MMapFile::Read (
+                void *data,
+                std::size_t count) {
+            std::size_t countRead = 0;
+            if (data != nullptr && count > 0) {
+                countRead = (std::min) (count, region.GetDataAvailableForReading ());
+                if (countRead > 0) {
+                    memcpy (data, region.GetReadPtr (), countRead);
+                    region.readOffset += countRead;
+                }
+            }
+            return countRead;
+        }
+
+        std::size_t MMapFile::Write (
+                const void *data,
+                std::size_t count) {
+            if (mode == ReadOnly) {
+                THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                    "%s is mapped read only.", GetPath ().c_str ());
+            }
+            if (data != nullptr && count > 0) {
+                std::size_t end = region.readOffset + count;
+                if (end > region.length) {
+                    // Double the mapping to amortize the cost of remapping.
+                    Grow ((std::max) ({end, region.length * 2, MIN_GROWTH}));
+                }
+                memcpy (region.data + region.readOffset, data, count);
+                region.readOffset = end;
+                if (region.writeOffset < end) {
+                    region.writeOffset = end;
+                }
+                return count;
+            }
+            return 0;
+        }
+
+        i64 MMapFile::Tell () const {
+            return region.readOffset;
+        }
+
+        i64 MMapFile::Seek (
+                i64 offset,
+                i32 fromWhere) {
+            i64 position;
+            switch (fromWhere) {
+                case SEEK_SET:
+                    position = offset;
+                    break;
+                case SEEK_CUR:
+                    position = (i64)region.readOffset + offset;
+                    break;
+                case SEEK_END:
+                    position = (i64)region.writeOffset + offset;
+                    break;
+                default:
+                    THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                        THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+            }
+            if (position < 0 || (mode == ReadOnly && (ui64)position > region.writeOffset)) {
+                THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                    THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+            }
+            // NOTE: In read-write mode, seeking past the end does not
+            // change the logical size. The next write will. The gap
+            // is zero filled as the file is extended before mapping.
+            region.readOffset = (std::size_t)position;
+            return position;
+        }
+
+        ui64 MMapFile::GetSize () {
+            return region.writeOffset;
+        }
+
+        void MMapFile::Flush () {
+            if (region.data != nullptr && mode == ReadWrite) {
+            #if defined (TOOLCHAIN_OS_Windows)
+                if (!FlushViewOfFile (region.data, region.writeOffset)) {
+                    THEKOGANS_UTIL_THROW_ERROR_CODE_AND_MESSAGE_EXCEPTION (
+                        THEKOGANS_UTIL_OS_ERROR_CODE, " (%s)", GetPath ().c_str ());
+                }
+                // FlushViewOfFile does not flush the file metadata.
+                file.Flush ();
+            #else // defined (TOOLCHAIN_OS_Windows)
+                if (msync (region.data, region.length, MS_SYNC) != 0) {
+                    THEKOGANS_UTIL_THROW_ERROR_CODE_AND_MESSAGE_EXCEPTION (
+                        THEKOGANS_UTIL_OS_ERROR_CODE, " (%s)", GetPath ().c_str ());
+                }
+            #endif // defined (TOOLCHAIN_OS_Windows)
+            }
+        }
+
+        void MMapFile::Map (std::size_t length) {
+            // Zero length mappings are not allowed.
+            if (length > 0) {
+            #if defined (TOOLCHAIN_OS_Windows)
+                // NOTE: If the file is shorter than length,
+                // CreateFileMapping will extend it.
+                mapping = CreateFileMappingW (
+                    file.GetHandle (),
+                    0,
+                    mode == ReadOnly ? PAGE_READONLY : PAGE_READWRITE,
+                    (DWORD)((ui64)length >> 32),
+                    (DWORD)length,
+                    0);
+                if (mapping == 0) {
+                    THEKOGANS_UTIL_THROW_ERROR_CODE_AND_MESSAGE_EXCEPTION (
+                        THEKOGANS_UTIL_OS_ERROR_CODE, " (%s)", GetPath ().c_str ());
+                }
+                void *data = MapViewOfFile (
+                    mapping,
+                    mode == ReadOnly ? FILE_MAP_READ : FILE_MAP_READ | FILE_MAP_WRITE,
+                    0, 0, length);
+                if (data == 0) {
+                    // Grab the error code in case CloseHandle clears it.
+                    THEKOGANS_UTIL_ERROR_CODE errorCode = THEKOGANS_UTIL_OS_ERROR_CODE;
+                    CloseHandle (mapping);
+                    mapping = 0;
+                    THEKOGANS_UTIL_THROW_ERROR_CODE_AND_MESSAGE_EXCEPTION (
+                        errorCode, " (%s)", GetPath ().c_str ());
+                }
+            #else // defined (TOOLCHAIN_OS_Windows)
+                void *data = mmap (
+                    0,
+                    length,
+                    mode == ReadOnly ? PROT_READ : PROT_READ | PROT_WRITE,
+                    MAP_SHARED,
+                    file.GetHandle (),
+                    0);
+                if (data == MAP_FAILED) {
+                    THEKOGANS_UTIL_THROW_ERROR_CODE_AND_MESSAGE_EXCEPTION (
+                        THEKOGANS_UTIL_OS_ERROR_CODE, " (%s)", GetPath ().c_str ());
+                }
+            #endif // defined (TOOLCHAIN_OS_Windows)
+                region.data = (ui8 *)data;
+                region.length = length;
+            }
+        }
+
+        void MMapFile::Unmap () {
+            if (region.data != nullptr) {
+            #if defined (TOOLCHAIN_OS_Windows)
+                UnmapViewOfFile (region.data);
+                CloseHandle (mapping);
+                mapping = 0;
+            #else // defined (TOOLCHAIN_OS_Windows)
+                munmap (region.data, region.length);
+            #endif // defined (TOOLCHAIN_OS_Windows)
+                region.data = nullptr;
+                region.length = 0;
+            }
+        }
+
+        void MMapFile::Grow (std::size_t capacity) {
+            file.SetSize (capacity);
+        #if defined (TOOLCHAIN_OS_Linux)
+            if (region.data != nullptr) {
+                // Linux can grow the mapping in place (or move it)
+                // without tearing it down.
+                void *data = mremap (region.data, region.length, capacity, MREMAP_MAYMOVE);
+                if (data == MAP_FAILED) {
+                    THEKOGANS_UTIL_THROW_ERROR_CODE_AND_MESSAGE_EXCEPTION (
+                        THEKOGANS_UTIL_OS_ERROR_CODE, " (%s)", GetPath ().c_str ());
+                }
+                region.data = (ui8 *)data;
+                region.length = capacity;
+                return;
+            }
+        #endif // defined (TOOLCHAIN_OS_Linux)
+            Unmap ();
+            Map (capacity);
+        }
+
+    } // namespace util
+} // namespace thekogans
+
+#endif // defined (TOOLCHAIN_OS_Windows) || defined (THEKOGANS_UTIL_HAVE_MMAP)
@@ -39,6 +39,39 @@ namespace thekogans {
         }
 
         bool Mutex::TryAcquire () {
+        #if defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+            if (TryLock ()) {
+                probe.TryAcquired ();
+                return true;
+            }
+            return false;
+        #else // defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+            return TryLock ();
+        #endif // defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+        }
+
+        void Mutex::Acquire () {
+        #if defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+            probe.Acquire (
+                [this] () -> bool {
+                    return TryLock ();
+                },
+                [this] () {
+                    Lock ();
+                });
+        #else // defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+            Lock ();
+        #endif // defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+        }
+
+        void Mutex::Release () {
+        #if defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+            probe.Release ();
+        #endif // defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+            Unlock ();
+        }
+
+        bool Mutex::TryLock () {
         #if defined (TOOLCHAIN_OS_Windows)
             return TryEnterCriticalSection (&cs) == TRUE;
         #else // defined (TOOLCHAIN_OS_Windows)
@@ -46,7 +79,7 @@ namespace thekogans {
         #endif // defined (TOOLCHAIN_OS_Windows)
         }
 
-        void Mutex::Acquire () {
+        void Mutex::Lock () {
         #if defined (TOOLCHAIN_OS_Windows)
             EnterCriticalSection (&cs);
         #else // defined (TOOLCHAIN_OS_Windows)
@@ -58,7 +91,7 @@ namespace thekogans {
         #endif // defined (TOOLCHAIN_OS_Windows)
         }
 
-        void Mutex::Release () {
+        void Mutex::Unlock () {
         #if defined (TOOLCHAIN_OS_Windows)
             LeaveCriticalSection (&cs);
         #else // defined (TOOLCHAIN_OS_Windows)
@@ -99,7 +132,36 @@ namespace thekogans {
                 errorCode = pthread_mutex_init (&mutex, &attribute.attribute);
             }
             else {
+            #if defined (TOOLCHAIN_OS_Linux) && defined (__GLIBC__) && defined (__USE_GNU)
+                // glibc adaptive mutexes spin for a bit before parking on a futex.
+                // That's just what we want for the short critical sections
+                // (RunLoop job queues, etc.) Mutex usually guards.
+                struct Attribute {
+                    pthread_mutexattr_t attribute;
+                    Attribute () {
+                        {
+                            THEKOGANS_UTIL_ERROR_CODE errorCode =
+                                pthread_mutexattr_init (&attribute);
+                            if (errorCode != 0) {
+                                THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (errorCode);
+                            }
+                        }
+                        {
+                            THEKOGANS_UTIL_ERROR_CODE errorCode =
+                                pthread_mutexattr_settype (&attribute, PTHREAD_MUTEX_ADAPTIVE_NP);
+                            if (errorCode != 0) {
+                                THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (errorCode);
+                            }
+                        }
+                    }
+                    ~Attribute () {
+                        pthread_mutexattr_destroy (&attribute);
+                    }
+                } attribute;
+                errorCode = pthread_mutex_init (&mutex, &attribute.attribute);
+            #else // defined (TOOLCHAIN_OS_Linux) && defined (__GLIBC__) && defined (__USE_GNU)
                 errorCode = pthread_mutex_init (&mutex, 0);
+            #endif // defined (TOOLCHAIN_OS_Linux) && defined (__GLIBC__) && defined (__USE_GNU)
             }
             if (errorCode != 0) {
                 THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (errorCode);
@@ -177,6 +177,7 @@ namespace thekogans {
                 jobExecutionPolicy (jobExecutionPolicy_),
                 done (false),
                 stats (id, name),
+                statsCounters (stats.GetCounters ()),
                 jobsNotEmpty (jobsMutex),
                 idle (jobsMutex),
                 paused (false),
@@ -185,6 +186,8 @@ namespace thekogans {
                 workerPriority (workerPriority_),
                 workerAffinity (workerAffinity_),
                 workerCallback (workerCallback_) {
+            jobsMutex.SetProfilerName (
+                (!name.empty () ? name : id) + "::jobsMutex");
             if (begin != nullptr &&
                     end != nullptr &&
                     jobExecutionPolicy != nullptr &&
@@ -244,11 +247,20 @@ namespace thekogans {
             {
                 // Acquire the lock to perform housekeeping chores.
                 LockGuard<Mutex> guard (jobsMutex);
-                stats.Update (job, start, end);
+                if (job->IsSucceeded ()) {
+                    stats.Update (job, start, end);
+                }
                 runningJobs.erase (job);
                 if (pendingJobs.empty () && runningJobs.empty ()) {
+                    // Publish on the way to idle so that GetStats is
+                    // exact whenever there's nothing left to do.
+                    statsCounters.ExclusiveWrite (stats.GetCounters ());
                     idle.SignalAll ();
                 }
+                else if (job->IsSucceeded () &&
+                        stats.totalJobs % RunLoop::Stats::Counters::PUBLISH_INTERVAL == 0) {
+                    statsCounters.ExclusiveWrite (stats.GetCounters ());
+                }
             }
             // Release the lock here in case the job needs to call
             // back in to the Pipeline to prevent deadlocks.
@@ -671,6 +683,12 @@ namespace thekogans {
         }
 
         RunLoop::Stats Pipeline::GetStats () {
+            RunLoop::Stats::Counters counters = state->statsCounters.Read ();
+            if (counters.complete) {
+                RunLoop::Stats stats (state->id, state->name);
+                stats.SetCounters (counters);
+                return stats;
+            }
             LockGuard<Mutex> guard (state->jobsMutex);
             return state->stats;
         }
@@ -679,6 +697,7 @@ namespace thekogans {
             {
                 LockGuard<Mutex> guard (state->jobsMutex);
                 state->stats.Reset ();
+                state->statsCounters.ExclusiveWrite (state->stats.GetCounters ());
             }
             for (std::size_t i = 0, count = state->stages.size (); i < count; ++i) {
                 state->stages[i]->ResetStats ();
@@ -41,6 +41,40 @@ namespace thekogans {
         }
 
         bool RWLock::TryAcquire (bool read) {
+        #if defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+            if (TryLock (read)) {
+                probe.TryAcquired (read);
+                return true;
+            }
+            return false;
+        #else // defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+            return TryLock (read);
+        #endif // defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+        }
+
+        void RWLock::Acquire (bool read) {
+        #if defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+            probe.Acquire (
+                [this, read] () -> bool {
+                    return TryLock (read);
+                },
+                [this, read] () {
+                    Lock (read);
+                },
+                read);
+        #else // defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+            Lock (read);
+        #endif // defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+        }
+
+        void RWLock::Release (bool read) {
+        #if defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+            probe.Release (read);
+        #endif // defined (THEKOGANS_UTIL_USE_LOCK_PROFILER)
+            Unlock (read);
+        }
+
+        bool RWLock::TryLock (bool read) {
         #if defined (TOOLCHAIN_OS_Windows)
             return (read ?
                 TryAcquireSRWLockShared (&rwlock) :
@@ -51,7 +85,7 @@ namespace thekogans {
         #endif // defined (TOOLCHAIN_OS_Windows)
         }
 
-        void RWLock::Acquire (bool read) {
+        void RWLock::Lock (bool read) {
         #if defined (TOOLCHAIN_OS_Windows)
             if (read) {
                 AcquireSRWLockShared (&rwlock);
@@ -77,7 +111,7 @@ namespace thekogans {
         #endif // defined (TOOLCHAIN_OS_Windows)
         }
 
-        void RWLock::Release (bool read) {
+        void RWLock::Unlock (bool read) {
         #if defined (TOOLCHAIN_OS_Windows)
             if (read) {
                 ReleaseSRWLockShared (&rwlock);
@@ -16,6 +16,7 @@
 // along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
 
 #include <functional>
+#include <atomic>
 #include <boost/atomic/detail/config.hpp>
 #include <boost/atomic/detail/operations_lockfree.hpp>
 #include <boost/memory_order.hpp>
@@ -166,15 +167,21 @@ namespace thekogans {
             // have various alignment requirements. In order to guarntee
             // that we satisfy these requirements we allocate pages with
             // AlignedAllocator. The alignement used is UI32_SIZE which
-            // happens to be the type of the above mentioned counters.
+            // happens to be the type of the above mentioned counters
+            // (or the shards pointer, whichever is bigger).
             struct AlignedAllocator {
+                enum {
+                    ALIGNMENT = alignof (RefCounted::References) > UI32_SIZE ?
+                        alignof (RefCounted::References) : UI32_SIZE
+                };
+
                 void *Alloc (std::size_t size) {
-                    std::size_t rawSize = UI32_SIZE + size + sizeof (ui8 *);
+                    std::size_t rawSize = ALIGNMENT + size + sizeof (ui8 *);
                     ui8 *rawPtr = new ui8[rawSize];
                     ui8 *ptr = rawPtr;
-                    std::size_t amountMisaligned = (std::size_t)ptr & (UI32_SIZE - 1);
+                    std::size_t amountMisaligned = (std::size_t)ptr & (ALIGNMENT - 1);
                     if (amountMisaligned > 0) {
-                        ptr += UI32_SIZE - amountMisaligned;
+                        ptr += ALIGNMENT - amountMisaligned;
                     }
                     *(ui8 **)((std::size_t)ptr + size) = rawPtr;
                     return ptr;
@@ -270,6 +277,91 @@ namespace thekogans {
             }
         };
 
+    #if !defined (THEKOGANS_UTIL_REF_COUNTED_SHARD_COUNT)
+        #define THEKOGANS_UTIL_REF_COUNTED_SHARD_COUNT 16
+    #endif // !defined (THEKOGANS_UTIL_REF_COUNTED_SHARD_COUNT)
+
+        // Every shard holds the net count of references added (and released)
+        // by the threads that map to it. Individual shards can go negative
+        // (a reference added on one thread and released on another), only
+        // their sum is meaningful. While sharded, the object holds a reference
+        // on itself (in shared), so the sum can never make it Harakiri.
+        // Closing a shard sets CLOSED in the same word the threads update, so
+        // every update either lands before the close (and is folded in to
+        // shared) or sees CLOSED, backs out and goes to shared directly.
+        struct RefCounted::References::Shards {
+            enum {
+                COUNT = THEKOGANS_UTIL_REF_COUNTED_SHARD_COUNT,
+                CACHE_LINE_SIZE = 64
+            };
+            // Counts are stored offset by ZERO so that
+            // negative counts don't run in to CLOSED.
+            static const i64 ZERO = 1LL << 40;
+            static const i64 CLOSED = 1LL << 62;
+
+            struct alignas (CACHE_LINE_SIZE) Shard {
+                std::atomic<i64> value;
+
+                Shard () :
+                    value (ZERO) {}
+            } shards[COUNT];
+            // Elects the one thread that gets to fold the shards.
+            std::atomic<bool> closed;
+
+            Shards () :
+                closed (false) {}
+
+            inline bool AddRef () {
+                Shard &shard = shards[GetIndex ()];
+                if ((shard.value.fetch_add (1, std::memory_order_release) & CLOSED) != 0) {
+                    shard.value.fetch_sub (1, std::memory_order_relaxed);
+                    return false;
+                }
+                return true;
+            }
+
+            inline bool Release () {
+                Shard &shard = shards[GetIndex ()];
+                if ((shard.value.fetch_sub (1, std::memory_order_release) & CLOSED) != 0) {
+                    shard.value.fetch_add (1, std::memory_order_relaxed);
+                    return false;
+                }
+                return true;
+            }
+
+            // Close all shards and return the sum of their counts.
+            i64 Close () {
+                i64 sum = 0;
+                for (std::size_t i = 0; i < COUNT; ++i) {
+                    sum += shards[i].value.fetch_or (CLOSED, std::memory_order_acq_rel) - ZERO;
+                }
+                return sum;
+            }
+
+            // Racy snapshot (like every other count).
+            i64 GetCount () const {
+                i64 sum = 0;
+                if (!closed.load (std::memory_order_relaxed)) {
+                    for (std::size_t i = 0; i < COUNT; ++i) {
+                        sum += (shards[i].value.load (std::memory_order_relaxed) & ~CLOSED) - ZERO;
+                    }
+                }
+                return sum;
+            }
+
+            // Threads are assigned shards round robin on first use.
+            static std::size_t GetIndex () {
+                static std::atomic<std::size_t> next (0);
+                static thread_local std::size_t index =
+                    next.fetch_add (1, std::memory_order_relaxed) % COUNT;
+                return index;
+            }
+        };
+
+        RefCounted::References::~References () {
+            delete shards.load (std::memory_order_relaxed);
+        }
+
         void *RefCounted::References::operator new (std::size_t) {
             return Heap::Instance ()->Alloc ();
         }
@@ -299,10 +391,19 @@ namespace thekogans {
         }
 
         ui32 RefCounted::References::AddSharedRef () {
+            Shards *shards_ = shards.load (std::memory_order_acquire);
+            if (shards_ != nullptr && shards_->AddRef ()) {
+                // Our own reference keeps shared above 0.
+                return operations::load (shared, boost::memory_order_relaxed);
+            }
             return operations::fetch_add (shared, 1, boost::memory_order_release) + 1;
         }
 
         ui32 RefCounted::References::ReleaseSharedRef (RefCounted *object) {
+            Shards *shards_ = shards.load (std::memory_order_acquire);
+            if (shards_ != nullptr && shards_->Release ()) {
+                return operations::load (shared, boost::memory_order_relaxed);
+            }
             ui32 newShared = operations::fetch_sub (shared, 1, boost::memory_order_release) - 1;
             if (newShared == 0) {
                 object->Harakiri ();
@@ -311,7 +412,43 @@ namespace thekogans {
         }
 
         ui32 RefCounted::References::GetSharedCount () const {
-            return operations::load (shared, boost::memory_order_relaxed);
+            ui32 count = operations::load (shared, boost::memory_order_relaxed);
+            Shards *shards_ = shards.load (std::memory_order_acquire);
+            if (shards_ != nullptr) {
+                // Our own reference is already in shared.
+                count += (ui32)shards_->GetCount ();
+            }
+            return count;
+        }
+
+        bool RefCounted::References::EnableShards () {
+            Shards *shards_ = new Shards;
+            Shards *expected = nullptr;
+            // Take our own reference before publishing the shards.
+            // Released by DisableShards.
+            operations::fetch_add (shared, 1, boost::memory_order_release);
+            if (!shards.compare_exchange_strong (expected, shards_, std::memory_order_acq_rel)) {
+                operations::fetch_sub (shared, 1, boost::memory_order_release);
+                delete shards_;
+                return false;
+            }
+            return true;
+        }
+
+        void RefCounted::References::DisableShards (RefCounted *object) {
+            Shards *shards_ = shards.load (std::memory_order_acquire);
+            if (shards_ != nullptr && !shards_->closed.exchange (true, std::memory_order_acq_rel)) {
+                // While we fold, threads whose shards are already closed go
+                // straight to shared. Their releases could take it to 0 before
+                // we add in the (positive) counts from the rest of the shards.
+                // Keep it up while we work.
+                const ui32 FOLD_BIAS = 1u << 30;
+                operations::fetch_add (shared, FOLD_BIAS, boost::memory_order_release);
+                ui32 sum = (ui32)shards_->Close ();
+                operations::fetch_add (shared, sum - FOLD_BIAS, boost::memory_order_release);
+                // Release the reference taken by EnableShards.
+                ReleaseSharedRef (object);
+            }
         }
 
         bool RefCounted::References::LockObject () {
@@ -16,6 +16,7 @@
 // along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
 
 #include <cassert>
+#include <cstring>
 #include "thekogans/util/Environment.h"
 #include "thekogans/util/Heap.h"
 #include "thekogans/util/Event.h"
@@ -168,6 +169,72 @@ namespace thekogans {
             return !state.pendingJobs.empty () ? state.pendingJobs.pop_front () : nullptr;
         }
 
+        RunLoop::RateLimitedJobExecutionPolicy::RateLimitedJobExecutionPolicy (
+                JobExecutionPolicy::SharedPtr jobExecutionPolicy_,
+                f64 rate_,
+                std::size_t burst_) :
+                JobExecutionPolicy (
+                    jobExecutionPolicy_ != nullptr ? jobExecutionPolicy_->maxJobs : SIZE_T_MAX),
+                jobExecutionPolicy (jobExecutionPolicy_),
+                rate (rate_),
+                burst ((f64)burst_),
+                tokens ((f64)burst_),
+                lastRefill (HRTimer::Click ()) {
+            if (jobExecutionPolicy == nullptr || rate <= 0.0 || burst_ == 0) {
+                THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                    THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+            }
+        }
+
+        void RunLoop::RateLimitedJobExecutionPolicy::EnqJob (
+                State &state,
+                Job *job) {
+            jobExecutionPolicy->EnqJob (state, job);
+        }
+
+        void RunLoop::RateLimitedJobExecutionPolicy::EnqJobFront (
+                State &state,
+                Job *job) {
+            jobExecutionPolicy->EnqJobFront (state, job);
+        }
+
+        RunLoop::Job *RunLoop::RateLimitedJobExecutionPolicy::DeqJob (State &state) {
+            Job *job = jobExecutionPolicy->DeqJob (state);
+            if (job != nullptr) {
+                LockGuard<SpinLock> guard (spinLock);
+                Refill ();
+                // Run loops that share us can both see the last token
+                // before either takes it. Let the bucket go negative
+                // so that the next delay pays the debt back.
+                tokens -= 1.0;
+            }
+            return job;
+        }
+
+        TimeSpec RunLoop::RateLimitedJobExecutionPolicy::GetDeqJobDelay (State &state) {
+            TimeSpec delay = jobExecutionPolicy->GetDeqJobDelay (state);
+            if (delay == TimeSpec::Zero) {
+                LockGuard<SpinLock> guard (spinLock);
+                Refill ();
+                if (tokens < 1.0) {
+                    // Round up so that the token is there when we wake up.
+                    delay = TimeSpec::FromMicroseconds (
+                        (i64)((1.0 - tokens) * 1000000.0 / rate) + 1);
+                }
+            }
+            return delay;
+        }
+
+        void RunLoop::RateLimitedJobExecutionPolicy::Refill () {
+            ui64 now = HRTimer::Click ();
+            tokens += HRTimer::ToSeconds (
+                HRTimer::ComputeElapsedTime (lastRefill, now)) * rate;
+            if (tokens > burst) {
+                tokens = burst;
+            }
+            lastRefill = now;
+        }
+
         THEKOGANS_UTIL_IMPLEMENT_SERIALIZABLE (thekogans::util::RunLoop::Stats::Job, 1, 0)
 
         RunLoop::Stats::Job &RunLoop::Stats::Job::operator = (const Job &job) {
@@ -187,61 +254,7 @@ namespace thekogans {
             totalTime = 0;
         }
 
-        std::size_t RunLoop::Stats::Job::Size () const noexcept {
-            return Serializer::Size (id) +
-                Serializer::Size (startTime) +
-                Serializer::Size (endTime) +
-                Serializer::Size (totalTime);
-        }
-
-        void RunLoop::Stats::Job::Read (
-                const SerializableHeader & /*header*/,
-                Serializer &serializer) {
-            serializer >> id >> startTime >> endTime >> totalTime;
-        }
-
-        void RunLoop::Stats::Job::Write (Serializer &serializer) const {
-            serializer << id << startTime << endTime << totalTime;
-        }
-
-        namespace {
-            const char * const ATTR_ID = "Id";
-            const char * const ATTR_START_TIME = "StartTime";
-            const char * const ATTR_END_TIME = "EndTime";
-            const char * const ATTR_TOTAL_TIME = "TotalTime";
-        }
-
-        void RunLoop::Stats::Job::ReadXML (
-                const SerializableHeader & /*header*/,
-                const pugi::xml_node &node) {
-            id = node.attribute (ATTR_ID).value ();
-            startTime = stringToui64 (node.attribute (ATTR_START_TIME).value ());
-            endTime = stringToui64 (node.attribute (ATTR_END_TIME).value ());
-            totalTime = stringToui64 (node.attribute (ATTR_TOTAL_TIME).value ());
-        }
-
-        void RunLoop::Stats::Job::WriteXML (pugi::xml_node &node) const {
-            node.append_attribute (ATTR_ID).set_value (id.c_str ());
-            node.append_attribute (ATTR_START_TIME).set_value (ui64Tostring (startTime).c_str ());
-            node.append_attribute (ATTR_END_TIME).set_value (ui64Tostring (endTime).c_str ());
-            node.append_attribute (ATTR_TOTAL_TIME).set_value (ui64Tostring (totalTime).c_str ());
-        }
-
-        void RunLoop::Stats::Job::ReadJSON (
-                const SerializableHeader & /*header*/,
-                const JSON::Object &object) {
-            id = object.Get<JSON::String> (ATTR_ID)->value;
-            startTime = object.Get<JSON::Number> (ATTR_START_TIME)->To<ui64> ();
-            endTime = object.Get<JSON::Number> (ATTR_END_TIME)->To<ui64> ();
-            totalTime = object.Get<JSON::Number> (ATTR_TOTAL_TIME)->To<ui64> ();
-        }
-
-        void RunLoop::Stats::Job::WriteJSON (JSON::Object &object) const {
-            object.Add<const std::string &> (ATTR_ID, id);
-            object.Add (ATTR_START_TIME, startTime);
-            object.Add (ATTR_END_TIME, endTime);
-            object.Add (ATTR_TOTAL_TIME, totalTime);
-        }
+        THEKOGANS_UTIL_IMPLEMENT_SERIALIZABLE_FIELDS (RunLoop::Stats::Job)
 
         THEKOGANS_UTIL_IMPLEMENT_SERIALIZABLE (thekogans::util::RunLoop::Stats, 1, 0)
 
@@ -266,94 +279,54 @@ namespace thekogans {
             maxJob.Reset ();
         }
 
-        std::size_t RunLoop::Stats::Size () const noexcept {
-            return Serializer::Size (id) +
-                Serializer::Size (name) +
-                Serializer::Size (totalJobs) +
-                Serializer::Size (totalJobTime) +
-                lastJob.Size () +
-                minJob.Size () +
-                maxJob.Size ();
-        }
-
-        void RunLoop::Stats::Read (
-                const SerializableHeader & /*header*/,
-                Serializer &serializer) {
-            serializer >> id >> name >> totalJobs >> totalJobTime >> lastJob >> minJob >> maxJob;
-        }
-
-        void RunLoop::Stats::Write (Serializer &serializer) const {
-            serializer << id << name << totalJobs << totalJobTime << lastJob << minJob << maxJob;
-        }
-
         namespace {
-            const char * const ATTR_NAME = "Name";
-            const char * const ATTR_TOTAL_JOBS = "TotalJobs";
-            const char * const ATTR_TOTAL_JOB_TIME = "TotalJobTime";
-            const char * const TAG_LAST_JOB = "LastJob";
-            const char * const TAG_MIN_JOB = "MinJob";
-            const char * const TAG_MAX_JOB = "MaxJob";
-        }
-
-        void RunLoop::Stats::ReadXML (
-                const SerializableHeader & /*header*/,
-                const pugi::xml_node &node) {
-            id = node.attribute (ATTR_ID).value ();
-            name = Decodestring (node.attribute (ATTR_NAME).value ());
-            totalJobs = stringTosize_t (node.attribute (ATTR_TOTAL_JOBS).value ());
-            totalJobTime = stringToui64 (node.attribute (ATTR_TOTAL_JOB_TIME).value ());
-            for (pugi::xml_node child = node.first_child ();
-                    !child.empty (); child = child.next_sibling ()) {
-                if (child.type () == pugi::node_element) {
-                    std::string childName = child.name ();
-                    if (childName == TAG_LAST_JOB) {
-                        child >> lastJob;
-                    }
-                    else if (childName == TAG_MIN_JOB) {
-                        child >> minJob;
-                    }
-                    else if (childName == TAG_MAX_JOB) {
-                        child >> maxJob;
-                    }
+            bool JobToCounters (
+                    const RunLoop::Stats::Job &job,
+                    RunLoop::Stats::Counters::Job &counters) {
+                counters.startTime = job.startTime;
+                counters.endTime = job.endTime;
+                counters.totalTime = job.totalTime;
+                if (job.id.size () <= RunLoop::Stats::Counters::MAX_JOB_ID_LENGTH) {
+                    counters.idLength = job.id.size ();
+                    memcpy (counters.id, job.id.data (), counters.idLength);
+                    return true;
                 }
+                counters.idLength = 0;
+                return false;
             }
-        }
 
-        void RunLoop::Stats::WriteXML (pugi::xml_node &node) const {
-            node.append_attribute (ATTR_ID).set_value (id.c_str ());
-            node.append_attribute (ATTR_NAME).set_value (Encodestring (name).c_str ());
-            node.append_attribute (ATTR_TOTAL_JOBS).set_value (size_tTostring (totalJobs).c_str ());
-            node.append_attribute (ATTR_TOTAL_JOB_TIME).set_value (ui64Tostring (totalJobTime).c_str ());
-            {
-                pugi::xml_node child = node.append_child (TAG_LAST_JOB);
-                child << lastJob;
-            }
-            {
-                pugi::xml_node child = node.append_child (TAG_MIN_JOB);
-                child << minJob;
-            }
-            {
-                pugi::xml_node child = node.append_child (TAG_MAX_JOB);
-                child << maxJob;
+            void CountersToJob (
+                    const RunLoop::Stats::Counters::Job &counters,
+                    RunLoop::Stats::Job &job) {
+                job.id.assign (counters.id, counters.idLength);
+                job.startTime = counters.startTime;
+                job.endTime = counters.endTime;
+                job.totalTime = counters.totalTime;
             }
         }
 
-        void RunLoop::Stats::ReadJSON (
-                const SerializableHeader & /*header*/,
-                const JSON::Object &object) {
-            id = object.Get<JSON::String> (ATTR_ID)->value;
-            name = object.Get<JSON::String> (ATTR_NAME)->value;
-            totalJobs = object.Get<JSON::Number> (ATTR_TOTAL_JOBS)->To<SizeT> ();
-            totalJobTime = object.Get<JSON::Number> (ATTR_TOTAL_JOB_TIME)->To<ui64> ();
+        RunLoop::Stats::Counters RunLoop::Stats::GetCounters () const {
+            Counters counters;
+            counters.totalJobs = totalJobs;
+            counters.totalJobTime = totalJobTime;
+            // NOTE: Not using && on purpose. All three need to be copied.
+            counters.complete =
+                JobToCounters (lastJob, counters.lastJob) &
+                JobToCounters (minJob, counters.minJob) &
+                JobToCounters (maxJob, counters.maxJob);
+            return counters;
         }
 
-        void RunLoop::Stats::WriteJSON (JSON::Object &object) const {
-            object.Add<const std::string &> (ATTR_ID, id);
-            object.Add<const std::string &> (ATTR_NAME, name);
-            object.Add<const SizeT &> (ATTR_TOTAL_JOBS, totalJobs);
-            object.Add (ATTR_TOTAL_JOB_TIME, totalJobTime);
+        void RunLoop::Stats::SetCounters (const Counters &counters) {
+            totalJobs = counters.totalJobs;
+            totalJobTime = counters.totalJobTime;
+            CountersToJob (counters.lastJob, lastJob);
+            CountersToJob (counters.minJob, minJob);
+            CountersToJob (counters.maxJob, maxJob);
         }
 
+        THEKOGANS_UTIL_IMPLEMENT_SERIALIZABLE_FIELDS (RunLoop::Stats)
+
         void RunLoop::Stats::Update (
                 RunLoop::Job *job,
                 ui64 start,
@@ -386,6 +359,7 @@ namespace thekogans {
                 jobExecutionPolicy (jobExecutionPolicy_),
                 done (false),
                 stats (id, name),
+                statsCounters (stats.GetCounters ()),
                 jobsNotEmpty (jobsMutex),
                 idle (jobsMutex),
                 paused (false),
@@ -394,6 +368,8 @@ namespace thekogans {
                 THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
                     THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
             }
+            jobsMutex.SetProfilerName (
+                (!name.empty () ? name : id) + "::jobsMutex");
         }
 
         RunLoop::State::~State () {
@@ -409,20 +385,59 @@ namespace thekogans {
             }
         }
 
-        RunLoop::Job *RunLoop::State::DeqJob (bool wait) {
+        RunLoop::Job *RunLoop::State::DeqJob (
+                bool wait,
+                const TimeSpec &timeSpec) {
             LockGuard<Mutex> guard (jobsMutex);
-            while (!done && paused && wait) {
-                notPaused.Wait ();
-            }
-            while (!done && pendingJobs.empty () && wait) {
-                jobsNotEmpty.Wait ();
-            }
-            Job *job = nullptr;
-            if (!done && !paused && !pendingJobs.empty ()) {
-                job = jobExecutionPolicy->DeqJob (*this);
-                runningJobs.push_back (job);
+            TimeSpec deadline = wait && timeSpec != TimeSpec::Infinite ?
+                GetCurrentTime () + timeSpec : TimeSpec::Infinite;
+            for (;;) {
+                if (deadline == TimeSpec::Infinite) {
+                    while (!done && paused && wait) {
+                        notPaused.Wait ();
+                    }
+                    while (!done && pendingJobs.empty () && wait) {
+                        jobsNotEmpty.Wait ();
+                    }
+                }
+                else {
+                    TimeSpec now = GetCurrentTime ();
+                    while (!done && (paused || pendingJobs.empty ()) && deadline > now) {
+                        (paused ? notPaused : jobsNotEmpty).Wait (deadline - now);
+                        now = GetCurrentTime ();
+                    }
+                }
+                if (done || paused || pendingJobs.empty ()) {
+                    return nullptr;
+                }
+                TimeSpec delay = jobExecutionPolicy->GetDeqJobDelay (*this);
+                if (delay == TimeSpec::Zero) {
+                    Job *job = jobExecutionPolicy->DeqJob (*this);
+                    runningJobs.push_back (job);
+                    return job;
+                }
+                if (!wait) {
+                    return nullptr;
+                }
+                // Throttled. Wait for the next token (or a state
+                // change) on the condition instead of spinning.
+                if (deadline != TimeSpec::Infinite) {
+                    TimeSpec now = GetCurrentTime ();
+                    if (deadline <= now) {
+                        return nullptr;
+                    }
+                    if (deadline - now < delay) {
+                        delay = deadline - now;
+                    }
+                }
+                jobsNotEmpty.Wait (delay);
             }
-            return job;
+        }
+
+        TimeSpec RunLoop::State::GetDeqJobDelay () {
+            LockGuard<Mutex> guard (jobsMutex);
+            return !done && !paused && !pendingJobs.empty () ?
+                jobExecutionPolicy->GetDeqJobDelay (*this) : TimeSpec::Zero;
         }
 
         void RunLoop::State::FinishedJob (
@@ -433,11 +448,20 @@ namespace thekogans {
             {
                 // Acquire the lock to perform housekeeping chores.
                 LockGuard<Mutex> guard (jobsMutex);
-                stats.Update (job, start, end);
+                if (job->IsSucceeded ()) {
+                    stats.Update (job, start, end);
+                }
                 runningJobs.erase (job);
                 if (pendingJobs.empty () && runningJobs.empty ()) {
+                    // Publish on the way to idle so that GetStats is
+                    // exact whenever there's nothing left to do.
+                    statsCounters.ExclusiveWrite (stats.GetCounters ());
                     idle.SignalAll ();
                 }
+                else if (job->IsSucceeded () &&
+                        stats.totalJobs % Stats::Counters::PUBLISH_INTERVAL == 0) {
+                    statsCounters.ExclusiveWrite (stats.GetCounters ());
+                }
             }
             // Release the lock here in case the job needs to call
             // back in to the RunLoop to prevent deadlocks.
@@ -501,6 +525,7 @@ namespace thekogans {
                     LockGuard<Mutex> guard (state->jobsMutex);
                     state->jobExecutionPolicy->EnqJob (*state, job.Get ());
                     job->Reset (state->id);
+                    job->enqueueTime = HRTimer::Click ();
                     job->AddRef ();
                     state->jobsNotEmpty.Signal ();
                 }
@@ -531,6 +556,7 @@ namespace thekogans {
                     LockGuard<Mutex> guard (state->jobsMutex);
                     state->jobExecutionPolicy->EnqJobFront (*state, job.Get ());
                     job->Reset (state->id);
+                    job->enqueueTime = HRTimer::Click ();
                     job->AddRef ();
                     state->jobsNotEmpty.Signal ();
                 }
@@ -790,6 +816,12 @@ namespace thekogans {
         }
 
         RunLoop::Stats RunLoop::GetStats () {
+            Stats::Counters counters = state->statsCounters.Read ();
+            if (counters.complete) {
+                Stats stats (state->id, state->name);
+                stats.SetCounters (counters);
+                return stats;
+            }
             LockGuard<Mutex> guard (state->jobsMutex);
             return state->stats;
         }
@@ -797,6 +829,7 @@ namespace thekogans {
         void RunLoop::ResetStats () {
             LockGuard<Mutex> guard (state->jobsMutex);
             state->stats.Reset ();
+            state->statsCounters.ExclusiveWrite (state->stats.GetCounters ());
         }
 
         bool RunLoop::IsIdle () {
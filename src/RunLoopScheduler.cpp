@@ -22,26 +22,121 @@
 namespace thekogans {
     namespace util {
 
-        RunLoopScheduler::JobInfo::Compare RunLoopScheduler::JobInfo::compare;
-
         THEKOGANS_UTIL_IMPLEMENT_HEAP_FUNCTIONS (RunLoopScheduler::RunLoopJobInfo)
         THEKOGANS_UTIL_IMPLEMENT_HEAP_FUNCTIONS (RunLoopScheduler::PipelineJobInfo)
 
+        void RunLoopScheduler::JobInfo::Reschedule (const TimeSpec &now) {
+            if (schedule == FixedRate) {
+                // Stay on the original grid (deadline + n * period) so
+                // that timer latency doesn't accumulate. If we fell behind,
+                // skip the missed periods instead of firing them back to back.
+                deadline += period;
+                if (deadline <= now) {
+                    i64 periodNanoseconds = period.ToNanoseconds ();
+                    i64 missedPeriods = (now - deadline).ToNanoseconds () / periodNanoseconds + 1;
+                    deadline += TimeSpec::FromNanoseconds (missedPeriods * periodNanoseconds);
+                }
+            }
+            else {
+                deadline = now + period;
+            }
+        }
+
+        void RunLoopScheduler::Queue::push (JobInfo::SharedPtr jobInfo) {
+            Map::iterator it = map.find (jobInfo->job->GetId ());
+            if (it != map.end ()) {
+                Remove (it->second->index);
+            }
+            map.insert (Map::value_type (jobInfo->job->GetId (), jobInfo.Get ()));
+            heap.push_back (jobInfo);
+            jobInfo->index = heap.size () - 1;
+            SiftUp (jobInfo->index);
+        }
+
+        RunLoopScheduler::JobInfo::SharedPtr RunLoopScheduler::Queue::pop () {
+            return Remove (0);
+        }
+
+        void RunLoopScheduler::Queue::clear () {
+            map.clear ();
+            heap.clear ();
+        }
+
         void RunLoopScheduler::Queue::CancelJob (const RunLoop::Job::Id &id) {
-            for (std::size_t i = c.size (); i-- > 0;) {
-                if (c[i]->job->GetId () == id) {
-                    c.erase (c.begin () + i);
+            Map::iterator it = map.find (id);
+            if (it != map.end ()) {
+                Remove (it->second->index);
+            }
+        }
+
+        void RunLoopScheduler::Queue::CancelJobs (const RunLoop::Id &runLoopId) {
+            // Removing jobs one at a time would cost O(k log n) and sifting
+            // would shuffle entries we haven't visited yet. Compact the
+            // survivors instead and rebuild the heap in O(n).
+            std::size_t count = 0;
+            for (std::size_t i = 0, size = heap.size (); i < size; ++i) {
+                if (heap[i]->GetRunLoopId () == runLoopId) {
+                    map.erase (heap[i]->job->GetId ());
+                    heap[i]->index = NIDX;
+                }
+                else {
+                    Place (count++, heap[i]);
+                }
+            }
+            heap.resize (count);
+            for (std::size_t i = count / 2; i-- > 0;) {
+                SiftDown (i);
+            }
+        }
+
+        RunLoopScheduler::JobInfo::SharedPtr RunLoopScheduler::Queue::Remove (std::size_t index) {
+            JobInfo::SharedPtr jobInfo = heap[index];
+            std::size_t last = heap.size () - 1;
+            if (index != last) {
+                Place (index, heap[last]);
+                heap.pop_back ();
+                SiftDown (index);
+                SiftUp (index);
+            }
+            else {
+                heap.pop_back ();
+            }
+            map.erase (jobInfo->job->GetId ());
+            jobInfo->index = NIDX;
+            return jobInfo;
+        }
+
+        void RunLoopScheduler::Queue::SiftUp (std::size_t index) {
+            JobInfo::SharedPtr jobInfo = heap[index];
+            while (index > 0) {
+                std::size_t parent = (index - 1) / 2;
+                if (heap[parent]->deadline <= jobInfo->deadline) {
                     break;
                 }
+                Place (index, heap[parent]);
+                index = parent;
             }
+            Place (index, jobInfo);
         }
 
-        void RunLoopScheduler::Queue::CancelJobs (const RunLoop::Id &runLoopId) {
-            for (std::size_t i = c.size (); i-- > 0;) {
-                if (c[i]->GetRunLoopId () == runLoopId) {
-                    c.erase (c.begin () + i);
+        void RunLoopScheduler::Queue::SiftDown (std::size_t index) {
+            JobInfo::SharedPtr jobInfo = heap[index];
+            std::size_t size = heap.size ();
+            while (true) {
+                std::size_t child = 2 * index + 1;
+                if (child >= size) {
+                    break;
+                }
+                if (child + 1 < size && heap[child + 1]->deadline < heap[child]->deadline) {
+                    ++child;
+                }
+                if (jobInfo->deadline <= heap[child]->deadline) {
+                    break;
                 }
+                Place (index, heap[child]);
+                index = child;
             }
+            Place (index, jobInfo);
         }
 
         RunLoop::Job::Id RunLoopScheduler::ScheduleRunLoopJob (
@@ -82,6 +177,54 @@ namespace thekogans {
             }
         }
 
+        RunLoop::Job::Id RunLoopScheduler::SchedulePeriodicRunLoopJob (
+                RunLoop::Job::SharedPtr job,
+                const TimeSpec &timeSpec,
+                const TimeSpec &period,
+                Schedule schedule,
+                RunLoop::SharedPtr runLoop) {
+            if (job != nullptr && timeSpec != TimeSpec::Infinite &&
+                    period > TimeSpec::Zero && period != TimeSpec::Infinite) {
+                return ScheduleJobInfo (
+                    JobInfo::SharedPtr (
+                        new RunLoopJobInfo (
+                            job,
+                            GetCurrentTime () + timeSpec,
+                            runLoop,
+                            period,
+                            schedule)),
+                    timeSpec);
+            }
+            else {
+                THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                    THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+            }
+        }
+
+        Pipeline::Job::Id RunLoopScheduler::SchedulePeriodicPipelineJob (
+                Pipeline::Job::SharedPtr job,
+                const TimeSpec &timeSpec,
+                const TimeSpec &period,
+                Schedule schedule,
+                Pipeline::SharedPtr pipeline) {
+            if (job != nullptr && timeSpec != TimeSpec::Infinite &&
+                    period > TimeSpec::Zero && period != TimeSpec::Infinite) {
+                return ScheduleJobInfo (
+                    JobInfo::SharedPtr (
+                        new PipelineJobInfo (
+                            job,
+                            GetCurrentTime () + timeSpec,
+                            pipeline,
+                            period,
+                            schedule)),
+                    timeSpec);
+            }
+            else {
+                THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                    THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+            }
+        }
+
         void RunLoopScheduler::CancelJob (const RunLoop::Job::Id &id) {
             LockGuard<SpinLock> guard (spinLock);
             if (!queue.empty ()) {
@@ -107,16 +250,26 @@ namespace thekogans {
         void RunLoopScheduler::CancelAllJobs () {
             LockGuard<SpinLock> guard (spinLock);
             timer->Stop ();
-            Queue empty;
-            queue.swap (empty);
+            queue.clear ();
         }
 
         void RunLoopScheduler::OnTimerAlarm (Timer::SharedPtr /*timer*/) noexcept {
             LockGuard<SpinLock> guard (spinLock);
             TimeSpec now = GetCurrentTime ();
             while (!queue.empty () && queue.top ()->deadline <= now) {
-                queue.top ()->EnqJob ();
-                queue.pop ();
+                JobInfo::SharedPtr jobInfo = queue.pop ();
+                if (!jobInfo->IsPeriodic ()) {
+                    jobInfo->EnqJob ();
+                }
+                else {
+                    // If the previous instance is still pending or
+                    // running, skip this period rather than pile up.
+                    if (jobInfo->job->IsCompleted ()) {
+                        jobInfo->EnqJob ();
+                    }
+                    jobInfo->Reschedule (now);
+                    queue.push (jobInfo);
+                }
             }
             if (!queue.empty ()) {
                 timer->Start (queue.top ()->deadline - now);
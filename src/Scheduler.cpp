@@ -152,6 +152,15 @@ namespace thekogans {
                                 // Skip over cancelled jobs.
                                 do {
                                     job = jobQueue->state->DeqJob (false);
+                                    if (job == nullptr) {
+                                        // A rate limited queue (see RunLoop::RateLimitedJobExecutionPolicy)
+                                        // has jobs, but no tokens. Wait for the next one here
+                                        // instead of cycling the queue through the scheduler.
+                                        TimeSpec delay = jobQueue->state->GetDeqJobDelay ();
+                                        if (delay != TimeSpec::Zero) {
+                                            job = jobQueue->state->DeqJob (true, delay);
+                                        }
+                                    }
                                     if (job != nullptr) {
                                         ui64 start = 0;
                                         ui64 end = 0;
@@ -94,12 +94,18 @@ namespace thekogans {
                 const SerializableHeader &header_,
                 Serializer &serializer) {
             header = header_;
-            buffer.Resize (header.size);
-            buffer.Rewind ();
-            buffer.AdvanceWriteOffset (
-                serializer.Read (
-                    buffer.GetWritePtr (),
-                    buffer.GetDataAvailableForWriting ()));
+            if (serializer.IsBorrowing ()) {
+                buffer.Wrap (serializer.Borrow (header.size));
+            }
+            else {
+                buffer.Unwrap ();
+                buffer.Resize (header.size);
+                buffer.Rewind ();
+                buffer.AdvanceWriteOffset (
+                    serializer.Read (
+                        buffer.GetWritePtr (),
+                        buffer.GetDataAvailableForWriting ()));
+            }
         }
 
         void Blob::Write (Serializer &serializer) const {
@@ -152,10 +158,84 @@ namespace thekogans {
             object_ = object;
         }
 
+        namespace {
+            // In compact mode, the serialized size of integers depends on
+            // their values. SizeSerializer is used to measure it.
+            struct SizeSerializer : public Serializer {
+                THEKOGANS_UTIL_DECLARE_DYNAMIC_CREATABLE_OVERRIDE (SizeSerializer)
+
+                std::size_t size;
+
+                explicit SizeSerializer (const Serializer &serializer) :
+                        Serializer (serializer.endianness),
+                        size (0) {
+                    compact = serializer.compact;
+                    context = serializer.context;
+                    factory = serializer.factory;
+                    parameters = serializer.parameters;
+                }
+
+                virtual std::size_t Read (
+                        void * /*buffer*/,
+                        std::size_t /*count*/) override {
+                    THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                        THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+                }
+                virtual std::size_t Write (
+                        const void * /*buffer*/,
+                        std::size_t count) override {
+                    size += count;
+                    return count;
+                }
+            };
+
+            THEKOGANS_UTIL_IMPLEMENT_DYNAMIC_CREATABLE_OVERRIDE (
+                SizeSerializer,
+                Serializer::TYPE)
+        }
+
         _LIB_THEKOGANS_UTIL_DECL Serializer & _LIB_THEKOGANS_UTIL_API operator << (
                 Serializer &serializer,
                 const Serializable &serializable) {
-            serializer << serializable.GetHeader (serializer.context);
+            SerializableHeader header = serializable.GetHeader (serializer.context);
+            // Check a memory backed serializer once for the whole
+            // serializable instead of failing half way through it.
+            if (serializer.context.NeedSize ()) {
+                std::size_t size;
+                if (serializer.compact) {
+                    // ClassSize assumes full width integers. Measure
+                    // the real thing so that readers (Blob...) can
+                    // rely on header.size.
+                    SizeSerializer sizeSerializer (serializer);
+                    serializable.Write (sizeSerializer);
+                    header.size = sizeSerializer.size;
+                    SizeSerializer *measuring =
+                        dynamic_cast<SizeSerializer *> (&serializer);
+                    if (measuring != nullptr) {
+                        // We're nested in a serializable that's being
+                        // measured. The body was just measured, don't
+                        // measure it again (that would double the work
+                        // at every level of nesting).
+                        *measuring << header;
+                        measuring->size += header.size;
+                        return serializer;
+                    }
+                    sizeSerializer << header;
+                    size = sizeSerializer.size;
+                }
+                else {
+                    size = header.Size () + header.size;
+                }
+                std::size_t capacity = serializer.GetWriteCapacity ();
+                if (size > capacity) {
+                    THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                        "Serializable size (" THEKOGANS_UTIL_SIZE_T_FORMAT
+                        ") is greater than serializer capacity (" THEKOGANS_UTIL_SIZE_T_FORMAT ").",
+                        size,
+                        capacity);
+                }
+            }
+            serializer << header;
             serializable.Write (serializer);
             return serializer;
         }
@@ -16,10 +16,12 @@
 // along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
 
 #include <cassert>
+#include <algorithm>
 #include <cwchar>
 #include "thekogans/util/Exception.h"
+#include "thekogans/util/Buffer.h"
 #if defined (THEKOGANS_UTIL_TYPE_Static)
-    #include "thekogans/util/Buffer.h"
+    #include "thekogans/util/BufferChain.h"
     #include "thekogans/util/RandomSeekSerializer.h"
 #endif // defined (THEKOGANS_UTIL_TYPE_Static)
 #include "thekogans/util/Serializable.h"
@@ -33,6 +35,7 @@ namespace thekogans {
     #if defined (THEKOGANS_UTIL_TYPE_Static)
         void Serializer::StaticInit () {
             Buffer::StaticInit ();
+            BufferChain::StaticInit ();
             RandomSeekSerializer::StaticInit ();
         }
     #endif // defined (THEKOGANS_UTIL_TYPE_Static)
@@ -49,6 +52,117 @@ namespace thekogans {
             return value->GetSize (context);
         }
 
+        std::size_t Serializer::GetWriteCapacity () const {
+            return writeMemory != nullptr ? writeMemory->GetDataAvailableForWriting () : SIZE_T_MAX;
+        }
+
+        ByteView Serializer::Borrow (std::size_t count) {
+            if (readMemory == nullptr) {
+                THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                    "%s is not memory backed, it can't lend its bytes.",
+                    Type ());
+            }
+            ByteView view = readMemory->ReadView (count);
+            if (view.size () != count) {
+                THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                    "ReadView (" THEKOGANS_UTIL_SIZE_T_FORMAT ") != " THEKOGANS_UTIL_SIZE_T_FORMAT,
+                    count,
+                    view.size ());
+            }
+            return view;
+        }
+
+        template<typename T>
+        inline void Serializer::WriteFixedValue (const T &value) {
+            if (writeMemory == nullptr || !writeMemory->WriteFixed (value)) {
+                if (Write (&value, sizeof (T)) != sizeof (T)) {
+                    THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                        "Write (&value, "
+                        THEKOGANS_UTIL_SIZE_T_FORMAT ") != " THEKOGANS_UTIL_SIZE_T_FORMAT,
+                        sizeof (T),
+                        sizeof (T));
+                }
+            }
+        }
+
+        template<typename T>
+        inline void Serializer::ReadFixedValue (T &value) {
+            if (readMemory == nullptr || !readMemory->ReadFixed (value)) {
+                if (Read (&value, sizeof (T)) != sizeof (T)) {
+                    THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                        "Read (&value, "
+                        THEKOGANS_UTIL_SIZE_T_FORMAT ") != " THEKOGANS_UTIL_SIZE_T_FORMAT,
+                        sizeof (T),
+                        sizeof (T));
+                }
+            }
+        }
+
+        namespace {
+            // Zigzag encoding maps small magnitude signed values
+            // (-1, 1, -2...) to small unsigned ones (1, 2, 3...).
+            inline ui64 ZigZagEncode (i64 value) {
+                return ((ui64)value << 1) ^ (ui64)(value >> 63);
+            }
+
+            inline i64 ZigZagDecode (ui64 value) {
+                return (i64)(value >> 1) ^ -(i64)(value & 1);
+            }
+
+            template<typename T>
+            inline ui64 ToCompact (T value) {
+                return std::is_signed<T>::value ? ZigZagEncode ((i64)value) : (ui64)value;
+            }
+
+            template<typename T>
+            inline T FromCompact (ui64 value) {
+                return std::is_signed<T>::value ? (T)ZigZagDecode (value) : (T)value;
+            }
+
+            template<typename T>
+            inline ui64 GetCompactMaxValue () {
+                return sizeof (T) == UI64_SIZE ? UI64_MAX : ((ui64)1 << (sizeof (T) << 3)) - 1;
+            }
+
+            void ThrowCompactValueOverflow (
+                    ui64 value,
+                    ui64 maxValue) {
+                THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                    "Compact value (" THEKOGANS_UTIL_UI64_FORMAT
+                    ") is greater than " THEKOGANS_UTIL_UI64_FORMAT ".",
+                    value,
+                    maxValue);
+            }
+        }
+
+        void Serializer::WriteCompactValue (ui64 value) {
+            if (writeMemory != nullptr && writeMemory->GetDataAvailableForWriting () >= SizeT::MAX_SIZE) {
+                writeMemory->writeOffset +=
+                    SizeT::Encode (value, writeMemory->GetWritePtr (), endianness);
+            }
+            else {
+                *this << SizeT (value);
+            }
+        }
+
+        ui64 Serializer::ReadCompactValue (ui64 maxValue) {
+            ui64 value;
+            if (readMemory != nullptr && readMemory->GetDataAvailableForReading () > 0 &&
+                    readMemory->GetDataAvailableForReading () >= SizeT::Size (*readMemory->GetReadPtr ())) {
+                readMemory->readOffset +=
+                    SizeT::Decode (readMemory->GetReadPtr (), value, endianness);
+            }
+            else {
+                SizeT sizeT;
+                *this >> sizeT;
+                value = sizeT.value;
+            }
+            if (value > maxValue) {
+                ThrowCompactValueOverflow (value, maxValue);
+            }
+            return value;
+        }
+
         Serializer &Serializer::operator << (Endianness value) {
             if (Write (&value, ENDIANNESS_SIZE) != ENDIANNESS_SIZE) {
                 THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
@@ -73,25 +187,13 @@ namespace thekogans {
 
         Serializer &Serializer::operator << (bool value) {
             ui8 b = value ? 1 : 0;
-            if (Write (&b, BOOL_SIZE) != BOOL_SIZE) {
-                THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
-                    "Write (&b, "
-                    THEKOGANS_UTIL_SIZE_T_FORMAT ") != " THEKOGANS_UTIL_SIZE_T_FORMAT,
-                    BOOL_SIZE,
-                    BOOL_SIZE);
-            }
+            WriteFixedValue (b);
             return *this;
         }
 
         Serializer &Serializer::operator >> (bool &value) {
             ui8 b;
-            if (Read (&b, BOOL_SIZE) != BOOL_SIZE) {
-                THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
-                    "Read (&b, "
-                    THEKOGANS_UTIL_SIZE_T_FORMAT ") != " THEKOGANS_UTIL_SIZE_T_FORMAT,
-                    BOOL_SIZE,
-                    BOOL_SIZE);
-            }
+            ReadFixedValue (b);
             value = b == 1;
             return *this;
         }
@@ -101,24 +203,12 @@ namespace thekogans {
             if (endianness == GuestEndian) {
                 value = ByteSwap<HostEndian, GuestEndian> (value);
             }
-            if (Write (&value, WCHAR_T_SIZE) != WCHAR_T_SIZE) {
-                THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
-                    "Write (&value, "
-                    THEKOGANS_UTIL_SIZE_T_FORMAT ") != " THEKOGANS_UTIL_SIZE_T_FORMAT,
-                    WCHAR_T_SIZE,
-                    WCHAR_T_SIZE);
-            }
+            WriteFixedValue (value);
             return *this;
         }
 
         Serializer &Serializer::operator >> (wchar_t &value) {
-            if (Read (&value, WCHAR_T_SIZE) != WCHAR_T_SIZE) {
-                THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
-                    "Read (&value, "
-                    THEKOGANS_UTIL_SIZE_T_FORMAT ") != " THEKOGANS_UTIL_SIZE_T_FORMAT,
-                    WCHAR_T_SIZE,
-                    WCHAR_T_SIZE);
-            }
+            ReadFixedValue (value);
             if (endianness == GuestEndian) {
                 value = ByteSwap<GuestEndian, HostEndian> (value);
             }
@@ -190,6 +280,49 @@ namespace thekogans {
             return *this;
         }
 
+        Serializer &Serializer::operator << (std::string_view value) {
+            *this << SizeT (value.size ());
+            if (value.size () > 0) {
+                if (Write (value.data (), value.size ()) != value.size ()) {
+                    THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                        "Write (value.data (), "
+                        THEKOGANS_UTIL_SIZE_T_FORMAT ") != " THEKOGANS_UTIL_SIZE_T_FORMAT,
+                        value.size (),
+                        value.size ());
+                }
+            }
+            return *this;
+        }
+
+        Serializer &Serializer::operator >> (std::string_view &value) {
+            SizeT length;
+            *this >> length;
+            ByteView view = Borrow (length);
+            value = std::string_view ((const char *)view.data, view.size ());
+            return *this;
+        }
+
+        Serializer &Serializer::operator << (const ByteView &value) {
+            *this << SizeT (value.size ());
+            if (value.size () > 0) {
+                if (Write (value.data, value.size ()) != value.size ()) {
+                    THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                        "Write (value.data, "
+                        THEKOGANS_UTIL_SIZE_T_FORMAT ") != " THEKOGANS_UTIL_SIZE_T_FORMAT,
+                        value.size (),
+                        value.size ());
+                }
+            }
+            return *this;
+        }
+
+        Serializer &Serializer::operator >> (ByteView &value) {
+            SizeT length;
+            *this >> length;
+            value = Borrow (length);
+            return *this;
+        }
+
         Serializer &Serializer::operator >> (std::string &value) {
             SizeT length;
             *this >> length;
@@ -257,13 +390,7 @@ namespace thekogans {
                 if (endianness == GuestEndian) {
                     ch = ByteSwap<HostEndian, GuestEndian> (ch);
                 }
-                if (Write (&ch, WCHAR_T_SIZE) != WCHAR_T_SIZE) {
-                    THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
-                        "Write (&ch, "
-                        THEKOGANS_UTIL_SIZE_T_FORMAT ") != " THEKOGANS_UTIL_SIZE_T_FORMAT,
-                        WCHAR_T_SIZE,
-                        WCHAR_T_SIZE);
-                }
+                WriteFixedValue (ch);
             }
             return *this;
         }
@@ -275,13 +402,7 @@ namespace thekogans {
                 std::wstring temp (length, 0);
                 for (std::size_t i = 0; i < length; ++i) {
                     wchar_t ch;
-                    if (Read (&ch, WCHAR_T_SIZE) != WCHAR_T_SIZE) {
-                        THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
-                            "Read (&ch, "
-                            THEKOGANS_UTIL_SIZE_T_FORMAT ") != " THEKOGANS_UTIL_SIZE_T_FORMAT,
-                            WCHAR_T_SIZE,
-                            WCHAR_T_SIZE);
-                    }
+                    ReadFixedValue (ch);
                     if (endianness == GuestEndian) {
                         ch = ByteSwap<GuestEndian, HostEndian> (ch);
                     }
@@ -330,213 +451,177 @@ namespace thekogans {
         }
 
         Serializer &Serializer::operator << (i8 value) {
-            if (Write (&value, I8_SIZE) != I8_SIZE) {
-                THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
-                    "Write (&value, "
-                    THEKOGANS_UTIL_SIZE_T_FORMAT ") != " THEKOGANS_UTIL_SIZE_T_FORMAT,
-                    I8_SIZE,
-                    I8_SIZE);
-            }
+            WriteFixedValue (value);
             return *this;
         }
 
         Serializer &Serializer::operator >> (i8 &value) {
-            if (Read (&value, I8_SIZE) != I8_SIZE) {
-                THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
-                    "Read (&value, "
-                    THEKOGANS_UTIL_SIZE_T_FORMAT ") != " THEKOGANS_UTIL_SIZE_T_FORMAT,
-                    I8_SIZE,
-                    I8_SIZE);
-            }
+            ReadFixedValue (value);
             return *this;
         }
 
         Serializer &Serializer::operator << (ui8 value) {
-            if (Write (&value, UI8_SIZE) != UI8_SIZE) {
-                THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
-                    "Write (&value, "
-                    THEKOGANS_UTIL_SIZE_T_FORMAT ") != " THEKOGANS_UTIL_SIZE_T_FORMAT,
-                    UI8_SIZE,
-                    UI8_SIZE);
-            }
+            WriteFixedValue (value);
             return *this;
         }
 
         Serializer &Serializer::operator >> (ui8 &value) {
-            if (Read (&value, UI8_SIZE) != UI8_SIZE) {
-                THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
-                    "Read (&value, "
-                    THEKOGANS_UTIL_SIZE_T_FORMAT ") != " THEKOGANS_UTIL_SIZE_T_FORMAT,
-                    UI8_SIZE,
-                    UI8_SIZE);
-            }
+            ReadFixedValue (value);
             return *this;
         }
 
         Serializer &Serializer::operator << (i16 value) {
-            if (endianness == GuestEndian) {
-                value = ByteSwap<HostEndian, GuestEndian> (value);
+            if (compact) {
+                WriteCompactValue (ZigZagEncode (value));
             }
-            if (Write (&value, I16_SIZE) != I16_SIZE) {
-                THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
-                    "Write (&value, "
-                    THEKOGANS_UTIL_SIZE_T_FORMAT ") != " THEKOGANS_UTIL_SIZE_T_FORMAT,
-                    I16_SIZE,
-                    I16_SIZE);
+            else {
+                if (endianness == GuestEndian) {
+                    value = ByteSwap<HostEndian, GuestEndian> (value);
+                }
+                WriteFixedValue (value);
             }
             return *this;
         }
 
         Serializer &Serializer::operator >> (i16 &value) {
-            if (Read (&value, I16_SIZE) != I16_SIZE) {
-                THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
-                    "Read (&value, "
-                    THEKOGANS_UTIL_SIZE_T_FORMAT ") != " THEKOGANS_UTIL_SIZE_T_FORMAT,
-                    I16_SIZE,
-                    I16_SIZE);
+            if (compact) {
+                value = (i16)ZigZagDecode (ReadCompactValue (UI16_MAX));
             }
-            if (endianness == GuestEndian) {
-                value = ByteSwap<GuestEndian, HostEndian> (value);
+            else {
+                ReadFixedValue (value);
+                if (endianness == GuestEndian) {
+                    value = ByteSwap<GuestEndian, HostEndian> (value);
+                }
             }
             return *this;
         }
 
         Serializer &Serializer::operator << (ui16 value) {
-            if (endianness == GuestEndian) {
-                value = ByteSwap<HostEndian, GuestEndian> (value);
+            if (compact) {
+                WriteCompactValue (value);
             }
-            if (Write (&value, UI16_SIZE) != UI16_SIZE) {
-                THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
-                    "Write (&value, "
-                    THEKOGANS_UTIL_SIZE_T_FORMAT ") != " THEKOGANS_UTIL_SIZE_T_FORMAT,
-                    UI16_SIZE,
-                    UI16_SIZE);
+            else {
+                if (endianness == GuestEndian) {
+                    value = ByteSwap<HostEndian, GuestEndian> (value);
+                }
+                WriteFixedValue (value);
             }
             return *this;
         }
 
         Serializer &Serializer::operator >> (ui16 &value) {
-            if (Read (&value, UI16_SIZE) != UI16_SIZE) {
-                THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
-                    "Read (&value, "
-                    THEKOGANS_UTIL_SIZE_T_FORMAT ") != " THEKOGANS_UTIL_SIZE_T_FORMAT,
-                    UI16_SIZE,
-                    UI16_SIZE);
+            if (compact) {
+                value = (ui16)ReadCompactValue (UI16_MAX);
             }
-            if (endianness == GuestEndian) {
-                value = ByteSwap<GuestEndian, HostEndian> (value);
+            else {
+                ReadFixedValue (value);
+                if (endianness == GuestEndian) {
+                    value = ByteSwap<GuestEndian, HostEndian> (value);
+                }
             }
             return *this;
         }
 
         Serializer &Serializer::operator << (i32 value) {
-            if (endianness == GuestEndian) {
-                value = ByteSwap<HostEndian, GuestEndian> (value);
+            if (compact) {
+                WriteCompactValue (ZigZagEncode (value));
             }
-            if (Write (&value, I32_SIZE) != I32_SIZE) {
-                THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
-                    "Write (&value, "
-                    THEKOGANS_UTIL_SIZE_T_FORMAT ") != " THEKOGANS_UTIL_SIZE_T_FORMAT,
-                    I32_SIZE,
-                    I32_SIZE);
+            else {
+                if (endianness == GuestEndian) {
+                    value = ByteSwap<HostEndian, GuestEndian> (value);
+                }
+                WriteFixedValue (value);
             }
             return *this;
         }
 
         Serializer &Serializer::operator >> (i32 &value) {
-            if (Read (&value, I32_SIZE) != I32_SIZE) {
-                THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
-                    "Read (&value, "
-                    THEKOGANS_UTIL_SIZE_T_FORMAT ") != " THEKOGANS_UTIL_SIZE_T_FORMAT,
-                    I32_SIZE,
-                    I32_SIZE);
+            if (compact) {
+                value = (i32)ZigZagDecode (ReadCompactValue (UI32_MAX));
             }
-            if (endianness == GuestEndian) {
-                value = ByteSwap<GuestEndian, HostEndian> (value);
+            else {
+                ReadFixedValue (value);
+                if (endianness == GuestEndian) {
+                    value = ByteSwap<GuestEndian, HostEndian> (value);
+                }
             }
             return *this;
         }
 
         Serializer &Serializer::operator << (ui32 value) {
-            if (endianness == GuestEndian) {
-                value = ByteSwap<HostEndian, GuestEndian> (value);
+            if (compact) {
+                WriteCompactValue (value);
             }
-            if (Write (&value, UI32_SIZE) != UI32_SIZE) {
-                THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
-                    "Write (&value, "
-                    THEKOGANS_UTIL_SIZE_T_FORMAT ") != " THEKOGANS_UTIL_SIZE_T_FORMAT,
-                    UI32_SIZE,
-                    UI32_SIZE);
+            else {
+                if (endianness == GuestEndian) {
+                    value = ByteSwap<HostEndian, GuestEndian> (value);
+                }
+                WriteFixedValue (value);
             }
             return *this;
         }
 
         Serializer &Serializer::operator >> (ui32 &value) {
-            if (Read (&value, UI32_SIZE) != UI32_SIZE) {
-                THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
-                    "Read (&value, "
-                    THEKOGANS_UTIL_SIZE_T_FORMAT ") != " THEKOGANS_UTIL_SIZE_T_FORMAT,
-                    UI32_SIZE,
-                    UI32_SIZE);
+            if (compact) {
+                value = (ui32)ReadCompactValue (UI32_MAX);
             }
-            if (endianness == GuestEndian) {
-                value = ByteSwap<GuestEndian, HostEndian> (value);
+            else {
+                ReadFixedValue (value);
+                if (endianness == GuestEndian) {
+                    value = ByteSwap<GuestEndian, HostEndian> (value);
+                }
             }
             return *this;
         }
 
         Serializer &Serializer::operator << (i64 value) {
-            if (endianness == GuestEndian) {
-                value = ByteSwap<HostEndian, GuestEndian> (value);
+            if (compact) {
+                WriteCompactValue (ZigZagEncode (value));
             }
-            if (Write (&value, I64_SIZE) != I64_SIZE) {
-                THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
-                    "Write (&value, "
-                    THEKOGANS_UTIL_SIZE_T_FORMAT ") != " THEKOGANS_UTIL_SIZE_T_FORMAT,
-                    I64_SIZE,
-                    I64_SIZE);
+            else {
+                if (endianness == GuestEndian) {
+                    value = ByteSwap<HostEndian, GuestEndian> (value);
+                }
+                WriteFixedValue (value);
             }
             return *this;
         }
 
         Serializer &Serializer::operator >> (i64 &value) {
-            if (Read (&value, I64_SIZE) != I64_SIZE) {
-                THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
-                    "Read (&value, "
-                    THEKOGANS_UTIL_SIZE_T_FORMAT ") != " THEKOGANS_UTIL_SIZE_T_FORMAT,
-                    I64_SIZE,
-                    I64_SIZE);
+            if (compact) {
+                value = (i64)ZigZagDecode (ReadCompactValue (UI64_MAX));
             }
-            if (endianness == GuestEndian) {
-                value = ByteSwap<GuestEndian, HostEndian> (value);
+            else {
+                ReadFixedValue (value);
+                if (endianness == GuestEndian) {
+                    value = ByteSwap<GuestEndian, HostEndian> (value);
+                }
             }
             return *this;
         }
 
         Serializer &Serializer::operator << (ui64 value) {
-            if (endianness == GuestEndian) {
-                value = ByteSwap<HostEndian, GuestEndian> (value);
+            if (compact) {
+                WriteCompactValue (value);
             }
-            if (Write (&value, UI64_SIZE) != UI64_SIZE) {
-                THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
-                    "Write (&value, "
-                    THEKOGANS_UTIL_SIZE_T_FORMAT ") != " THEKOGANS_UTIL_SIZE_T_FORMAT,
-                    UI64_SIZE,
-                    UI64_SIZE);
+            else {
+                if (endianness == GuestEndian) {
+                    value = ByteSwap<HostEndian, GuestEndian> (value);
+                }
+                WriteFixedValue (value);
             }
             return *this;
         }
 
         Serializer &Serializer::operator >> (ui64 &value) {
-            if (Read (&value, UI64_SIZE) != UI64_SIZE) {
-                THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
-                    "Read (&value, "
-                    THEKOGANS_UTIL_SIZE_T_FORMAT ") != " THEKOGANS_UTIL_SIZE_T_FORMAT,
-                    UI64_SIZE,
-                    UI64_SIZE);
+            if (compact) {
+                value = (ui64)ReadCompactValue (UI64_MAX);
             }
-            if (endianness == GuestEndian) {
-                value = ByteSwap<GuestEndian, HostEndian> (value);
+            else {
+                ReadFixedValue (value);
+                if (endianness == GuestEndian) {
+                    value = ByteSwap<GuestEndian, HostEndian> (value);
+                }
             }
             return *this;
         }
@@ -545,24 +630,12 @@ namespace thekogans {
             if (endianness == GuestEndian) {
                 value = ByteSwap<HostEndian, GuestEndian> (value);
             }
-            if (Write (&value, UI128_SIZE) != UI128_SIZE) {
-                THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
-                    "Write (&value, "
-                    THEKOGANS_UTIL_SIZE_T_FORMAT ") != " THEKOGANS_UTIL_SIZE_T_FORMAT,
-                    UI128_SIZE,
-                    UI128_SIZE);
-            }
+            WriteFixedValue (value);
             return *this;
         }
 
         Serializer &Serializer::operator >> (ui128 &value) {
-            if (Read (&value, UI128_SIZE) != UI128_SIZE) {
-                THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
-                    "Read (&value, "
-                    THEKOGANS_UTIL_SIZE_T_FORMAT ") != " THEKOGANS_UTIL_SIZE_T_FORMAT,
-                    UI128_SIZE,
-                    UI128_SIZE);
-            }
+            ReadFixedValue (value);
             if (endianness == GuestEndian) {
                 value = ByteSwap<GuestEndian, HostEndian> (value);
             }
@@ -573,24 +646,12 @@ namespace thekogans {
             if (endianness == GuestEndian) {
                 value = ByteSwap<HostEndian, GuestEndian> (value);
             }
-            if (Write (&value, F32_SIZE) != F32_SIZE) {
-                THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
-                    "Write (&value, "
-                    THEKOGANS_UTIL_SIZE_T_FORMAT ") != " THEKOGANS_UTIL_SIZE_T_FORMAT,
-                    F32_SIZE,
-                    F32_SIZE);
-            }
+            WriteFixedValue (value);
             return *this;
         }
 
         Serializer &Serializer::operator >> (f32 &value) {
-            if (Read (&value, F32_SIZE) != F32_SIZE) {
-                THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
-                    "Read (&value, "
-                    THEKOGANS_UTIL_SIZE_T_FORMAT ") != " THEKOGANS_UTIL_SIZE_T_FORMAT,
-                    F32_SIZE,
-                    F32_SIZE);
-            }
+            ReadFixedValue (value);
             if (endianness == GuestEndian) {
                 value = ByteSwap<GuestEndian, HostEndian> (value);
             }
@@ -601,24 +662,12 @@ namespace thekogans {
             if (endianness == GuestEndian) {
                 value = ByteSwap<HostEndian, GuestEndian> (value);
             }
-            if (Write (&value, F64_SIZE) != F64_SIZE) {
-                THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
-                    "Write (&value, "
-                    THEKOGANS_UTIL_SIZE_T_FORMAT ") != " THEKOGANS_UTIL_SIZE_T_FORMAT,
-                    F64_SIZE,
-                    F64_SIZE);
-            }
+            WriteFixedValue (value);
             return *this;
         }
 
         Serializer &Serializer::operator >> (f64 &value) {
-            if (Read (&value, F64_SIZE) != F64_SIZE) {
-                THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
-                    "Read (&value, "
-                    THEKOGANS_UTIL_SIZE_T_FORMAT ") != " THEKOGANS_UTIL_SIZE_T_FORMAT,
-                    F64_SIZE,
-                    F64_SIZE);
-            }
+            ReadFixedValue (value);
             if (endianness == GuestEndian) {
                 value = ByteSwap<GuestEndian, HostEndian> (value);
             }
@@ -635,5 +684,262 @@ namespace thekogans {
             return *this;
         }
 
+        void Serializer::WriteArray (
+                const void *values,
+                std::size_t size,
+                std::size_t count) {
+            std::size_t length = size * count;
+            if (length == 0) {
+                return;
+            }
+            if (endianness == HostEndian || size == UI8_SIZE) {
+                if (Write (values, length) != length) {
+                    THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                        "Write (values, "
+                        THEKOGANS_UTIL_SIZE_T_FORMAT ") != " THEKOGANS_UTIL_SIZE_T_FORMAT,
+                        length,
+                        length);
+                }
+            }
+            else if (writeMemory != nullptr && writeMemory->GetDataAvailableForWriting () >= length) {
+                ByteSwapArray (values, writeMemory->GetWritePtr (), size, count);
+                writeMemory->writeOffset += length;
+            }
+            else {
+                // Swap a chunk at a time in to a scratch buffer
+                // and hand each one to Write.
+                const std::size_t CHUNK_SIZE = 4096;
+                ui8 chunk[CHUNK_SIZE];
+                const ui8 *ptr = (const ui8 *)values;
+                while (count > 0) {
+                    std::size_t chunkCount = std::min (count, CHUNK_SIZE / size);
+                    std::size_t chunkLength = chunkCount * size;
+                    ByteSwapArray (ptr, chunk, size, chunkCount);
+                    if (Write (chunk, chunkLength) != chunkLength) {
+                        THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                            "Write (chunk, "
+                            THEKOGANS_UTIL_SIZE_T_FORMAT ") != " THEKOGANS_UTIL_SIZE_T_FORMAT,
+                            chunkLength,
+                            chunkLength);
+                    }
+                    ptr += chunkLength;
+                    count -= chunkCount;
+                }
+            }
+        }
+
+        void Serializer::ReadArray (
+                void *values,
+                std::size_t size,
+                std::size_t count) {
+            std::size_t length = size * count;
+            if (length == 0) {
+                return;
+            }
+            if (endianness != HostEndian && size != UI8_SIZE &&
+                    readMemory != nullptr && readMemory->GetDataAvailableForReading () >= length) {
+                // Swap straight out of the buffer (one pass instead of two).
+                ByteSwapArray (readMemory->GetReadPtr (), values, size, count);
+                readMemory->readOffset += length;
+            }
+            else {
+                if (Read (values, length) != length) {
+                    THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                        "Read (values, "
+                        THEKOGANS_UTIL_SIZE_T_FORMAT ") != " THEKOGANS_UTIL_SIZE_T_FORMAT,
+                        length,
+                        length);
+                }
+                if (endianness != HostEndian && size != UI8_SIZE) {
+                    ByteSwapArray (values, values, size, count);
+                }
+            }
+        }
+
+        template<typename T>
+        void Serializer::WriteIntegers (
+                const T *values,
+                std::size_t count) {
+            if (!compact) {
+                WriteArray (values, sizeof (T), count);
+            }
+            else if (writeMemory != nullptr) {
+                std::size_t i = 0;
+                while (i < count) {
+                    ui8 *ptr = writeMemory->GetWritePtr ();
+                    ui8 *end = writeMemory->GetWritePtrEnd ();
+                    // As long as there's room for the largest encoding,
+                    // encode straight in to the buffer. Values shorter than
+                    // SizeT::MAX_SIZE are stored with a single 8 byte write.
+                    for (; i < count && end - ptr >= (std::ptrdiff_t)SizeT::MAX_SIZE; ++i) {
+                        ui64 value = ToCompact (values[i]);
+                        std::size_t size = SizeT (value).Size ();
+                        if (size < SizeT::MAX_SIZE) {
+                            ui64 word = ByteSwap<HostEndian, LittleEndian> (
+                                ((value << 1) | 1) << (size - 1));
+                            memcpy (ptr, &word, UI64_SIZE);
+                            ptr += size;
+                        }
+                        else {
+                            ptr += SizeT::Encode (value, ptr, endianness);
+                        }
+                    }
+                    writeMemory->writeOffset += ptr - writeMemory->GetWritePtr ();
+                    // Close to the end of the buffer. Let the
+                    // regular path deal with (the lack of) room.
+                    if (i < count) {
+                        *this << values[i++];
+                    }
+                }
+            }
+            else {
+                for (std::size_t i = 0; i < count; ++i) {
+                    *this << values[i];
+                }
+            }
+        }
+
+        template<typename T>
+        void Serializer::ReadIntegers (
+                T *values,
+                std::size_t count) {
+            if (!compact) {
+                ReadArray (values, sizeof (T), count);
+            }
+            else if (readMemory != nullptr) {
+                const ui64 maxValue = GetCompactMaxValue<T> ();
+                std::size_t i = 0;
+                while (i < count) {
+                    const ui8 *ptr = readMemory->GetReadPtr ();
+                    const ui8 *end = readMemory->GetReadPtrEnd ();
+                    // The first byte carries the length. As long as there
+                    // are 8 bytes to spare, decode each value with a single
+                    // unaligned load, a mask and a shift (no per byte loop).
+                    for (; i < count && end - ptr >= (std::ptrdiff_t)UI64_SIZE; ++i) {
+                        ui64 word;
+                        memcpy (&word, ptr, UI64_SIZE);
+                        word = ByteSwap<LittleEndian, HostEndian> (word);
+                        std::size_t size = SizeT::Size ((ui32)(word & 0xff));
+                        ui64 value;
+                        if (size < UI64_SIZE) {
+                            value = (word & (((ui64)1 << (size << 3)) - 1)) >> size;
+                        }
+                        else if (size == UI64_SIZE) {
+                            value = word >> UI64_SIZE;
+                        }
+                        else {
+                            break;
+                        }
+                        if (value > maxValue) {
+                            ThrowCompactValueOverflow (value, maxValue);
+                        }
+                        values[i] = FromCompact<T> (value);
+                        ptr += size;
+                    }
+                    readMemory->readOffset += ptr - readMemory->GetReadPtr ();
+                    // Close to the end of the buffer (or a SizeT::MAX_SIZE
+                    // value). Let the regular path deal with it.
+                    if (i < count) {
+                        *this >> values[i++];
+                    }
+                }
+            }
+            else {
+                for (std::size_t i = 0; i < count; ++i) {
+                    *this >> values[i];
+                }
+            }
+        }
+
+        Serializer &Serializer::operator << (const std::vector<i16> &value) {
+            *this << SizeT (value.size ());
+            WriteIntegers (value.data (), value.size ());
+            return *this;
+        }
+
+        Serializer &Serializer::operator >> (std::vector<i16> &value) {
+            SizeT count;
+            *this >> count;
+            std::vector<i16> temp (count);
+            ReadIntegers (temp.data (), count);
+            value.swap (temp);
+            return *this;
+        }
+
+        Serializer &Serializer::operator << (const std::vector<ui16> &value) {
+            *this << SizeT (value.size ());
+            WriteIntegers (value.data (), value.size ());
+            return *this;
+        }
+
+        Serializer &Serializer::operator >> (std::vector<ui16> &value) {
+            SizeT count;
+            *this >> count;
+            std::vector<ui16> temp (count);
+            ReadIntegers (temp.data (), count);
+            value.swap (temp);
+            return *this;
+        }
+
+        Serializer &Serializer::operator << (const std::vector<i32> &value) {
+            *this << SizeT (value.size ());
+            WriteIntegers (value.data (), value.size ());
+            return *this;
+        }
+
+        Serializer &Serializer::operator >> (std::vector<i32> &value) {
+            SizeT count;
+            *this >> count;
+            std::vector<i32> temp (count);
+            ReadIntegers (temp.data (), count);
+            value.swap (temp);
+            return *this;
+        }
+
+        Serializer &Serializer::operator << (const std::vector<ui32> &value) {
+            *this << SizeT (value.size ());
+            WriteIntegers (value.data (), value.size ());
+            return *this;
+        }
+
+        Serializer &Serializer::operator >> (std::vector<ui32> &value) {
+            SizeT count;
+            *this >> count;
+            std::vector<ui32> temp (count);
+            ReadIntegers (temp.data (), count);
+            value.swap (temp);
+            return *this;
+        }
+
+        Serializer &Serializer::operator << (const std::vector<i64> &value) {
+            *this << SizeT (value.size ());
+            WriteIntegers (value.data (), value.size ());
+            return *this;
+        }
+
+        Serializer &Serializer::operator >> (std::vector<i64> &value) {
+            SizeT count;
+            *this >> count;
+            std::vector<i64> temp (count);
+            ReadIntegers (temp.data (), count);
+            value.swap (temp);
+            return *this;
+        }
+
+        Serializer &Serializer::operator << (const std::vector<ui64> &value) {
+            *this << SizeT (value.size ());
+            WriteIntegers (value.data (), value.size ());
+            return *this;
+        }
+
+        Serializer &Serializer::operator >> (std::vector<ui64> &value) {
+            SizeT count;
+            *this >> count;
+            std::vector<ui64> temp (count);
+            ReadIntegers (temp.data (), count);
+            value.swap (temp);
+            return *this;
+        }
+
     } //namespace util
 } // namespace thekogans
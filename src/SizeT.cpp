@@ -16,6 +16,7 @@
 // along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
 
 #include "thekogans/util/Heap.h"
+#include "thekogans/util/Exception.h"
 #include "thekogans/util/Serializer.h"
 #include "thekogans/util/SizeT.h"
 
@@ -30,16 +31,16 @@ namespace thekogans {
         _LIB_THEKOGANS_UTIL_DECL Serializer & _LIB_THEKOGANS_UTIL_API operator << (
                 Serializer &serializer,
                 const SizeT &sizeT) {
-            std::size_t bytes = sizeT.Size ();
-            if (bytes < SizeT::MAX_SIZE) {
-                ui64 value = ((sizeT.value << 1) | 1) << (bytes - 1);
-                for (std::size_t i = 0; i < bytes; ++i) {
-                    serializer << (ui8)(value & 0xff);
-                    value >>= 8;
-                }
-            }
-            else {
-                serializer << (ui8)0 << sizeT.value;
+            // NOTE: Don't be tempted to write the MAX_SIZE value using
+            // serializer << ui64. In compact mode that's a SizeT.
+            ui8 bytes[SizeT::MAX_SIZE];
+            std::size_t size = SizeT::Encode (sizeT.value, bytes, serializer.endianness);
+            if (serializer.Write (bytes, size) != size) {
+                THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                    "Write (bytes, "
+                    THEKOGANS_UTIL_SIZE_T_FORMAT ") != " THEKOGANS_UTIL_SIZE_T_FORMAT,
+                    size,
+                    size);
             }
             return serializer;
         }
@@ -47,20 +48,17 @@ namespace thekogans {
         _LIB_THEKOGANS_UTIL_DECL Serializer & _LIB_THEKOGANS_UTIL_API operator >> (
                 Serializer &serializer,
                 SizeT &sizeT) {
-            ui8 value;
-            serializer >> value;
-            std::size_t bytes = SizeT::Size (value);
-            if (bytes < SizeT::MAX_SIZE) {
-                sizeT.value = value;
-                for (std::size_t i = 1; i < bytes; ++i) {
-                    serializer >> value;
-                    sizeT.value |= (ui64)value << (i << 3);
-                }
-                sizeT.value >>= bytes;
-            }
-            else {
-                serializer >> sizeT.value;
+            ui8 bytes[SizeT::MAX_SIZE];
+            serializer >> bytes[0];
+            std::size_t size = SizeT::Size (bytes[0]);
+            if (size > 1 && serializer.Read (bytes + 1, size - 1) != size - 1) {
+                THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                    "Read (bytes + 1, "
+                    THEKOGANS_UTIL_SIZE_T_FORMAT ") != " THEKOGANS_UTIL_SIZE_T_FORMAT,
+                    size - 1,
+                    size - 1);
             }
+            SizeT::Decode (bytes, sizeT.value, serializer.endianness);
             return serializer;
         }
 
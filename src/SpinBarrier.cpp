@@ -0,0 +1,112 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#include "thekogans/util/Environment.h"
+#include "thekogans/util/Exception.h"
+#include "thekogans/util/HRTimer.h"
+#include "thekogans/util/Thread.h"
+#if defined (TOOLCHAIN_OS_Linux)
+    #include "thekogans/util/os/linux/Futex.h"
+#else // defined (TOOLCHAIN_OS_Linux)
+    #include "thekogans/util/LockGuard.h"
+#endif // defined (TOOLCHAIN_OS_Linux)
+#include "thekogans/util/SpinBarrier.h"
+
+namespace thekogans {
+    namespace util {
+
+        SpinBarrier::SpinBarrier (
+                std::size_t count_,
+                const TimeSpec &maxSpinTime_) :
+                count ((ui32)count_),
+                maxSpinTime (HRTimer::GetFrequency () * maxSpinTime_.ToMicroseconds () / 1000000),
+                remaining ((ui32)count_),
+                generation (0),
+                sleepers (0)
+            #if !defined (TOOLCHAIN_OS_Linux)
+                , condition (mutex)
+            #endif // !defined (TOOLCHAIN_OS_Linux)
+                {
+            if (count == 0) {
+                THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                    THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+            }
+        }
+
+        bool SpinBarrier::Wait () {
+            ui32 currGeneration = generation.load (std::memory_order_acquire);
+            if (remaining.fetch_sub (1, std::memory_order_acq_rel) == 1) {
+                // Last one in. Nobody else can touch remaining until
+                // they see the new generation, so it's safe to reset
+                // it before releasing them.
+                remaining.store (count, std::memory_order_relaxed);
+                // NOTE: seq_cst pairs with the sleepers increment in
+                // Park. Either we see the sleeper, or it sees the flip.
+                generation.fetch_add (1, std::memory_order_seq_cst);
+                if (sleepers.load (std::memory_order_seq_cst) != 0) {
+                    WakeAll ();
+                }
+                return true;
+            }
+            // Spin while it's still cheap...
+            Thread::Backoff backoff;
+            ui64 start = HRTimer::Click ();
+            while (generation.load (std::memory_order_acquire) == currGeneration) {
+                if (HRTimer::Click () - start > maxSpinTime) {
+                    // ...and then park.
+                    Park (currGeneration);
+                    break;
+                }
+                backoff.Pause ();
+            }
+            return false;
+        }
+
+    #if defined (TOOLCHAIN_OS_Linux)
+        void SpinBarrier::Park (ui32 currGeneration) {
+            sleepers.fetch_add (1, std::memory_order_seq_cst);
+            // FutexWait returns right away if the generation has
+            // already moved on.
+            while (generation.load (std::memory_order_seq_cst) == currGeneration) {
+                os::linux::FutexWait ((volatile ui32 *)&generation, currGeneration);
+            }
+            sleepers.fetch_sub (1, std::memory_order_relaxed);
+        }
+
+        void SpinBarrier::WakeAll () {
+            os::linux::FutexWake ((volatile ui32 *)&generation, count);
+        }
+    #else // defined (TOOLCHAIN_OS_Linux)
+        void SpinBarrier::Park (ui32 currGeneration) {
+            LockGuard<Mutex> guard (mutex);
+            sleepers.fetch_add (1, std::memory_order_seq_cst);
+            while (generation.load (std::memory_order_seq_cst) == currGeneration) {
+                condition.Wait ();
+            }
+            sleepers.fetch_sub (1, std::memory_order_relaxed);
+        }
+
+        void SpinBarrier::WakeAll () {
+            // Taking the mutex guarantees that a thread that saw the
+            // old generation in Park is already waiting on the condition.
+            LockGuard<Mutex> guard (mutex);
+            condition.SignalAll ();
+        }
+    #endif // defined (TOOLCHAIN_OS_Linux)
+
+    } // namespace util
+} // namespace thekogans
@@ -19,6 +19,9 @@
 #include <boost/atomic/detail/operations_lockfree.hpp>
 #include <boost/memory_order.hpp>
 #include "thekogans/util/Thread.h"
+#if defined (TOOLCHAIN_OS_Linux)
+    #include "thekogans/util/os/linux/Futex.h"
+#endif // defined (TOOLCHAIN_OS_Linux)
 #include "thekogans/util/SpinLock.h"
 
 namespace thekogans {
@@ -28,6 +31,51 @@ namespace thekogans {
             using operations = boost::atomics::detail::operations<4u, false>;
         }
 
+    #if defined (TOOLCHAIN_OS_Linux)
+        bool StorageSpinLock::IsLocked () const {
+            return operations::load (state, boost::memory_order_relaxed) != Unlocked;
+        }
+
+        bool StorageSpinLock::TryAcquire () {
+            // NOTE: Can't use exchange here as it would clobber Contended
+            // and the parked threads would never be woken up.
+            ui32 expected = Unlocked;
+            return operations::compare_exchange_strong (
+                state, expected, Locked,
+                boost::memory_order_acquire,
+                boost::memory_order_relaxed);
+        }
+
+        void StorageSpinLock::Acquire () {
+            if (!TryAcquire ()) {
+                // Spin with exponential back-off while it's still cheap...
+                Thread::Backoff backoff (maxPauseBeforeYield);
+                while (backoff.count <= backoff.maxPauseBeforeYield) {
+                    backoff.Pause ();
+                    if (operations::load (state, boost::memory_order_relaxed) == Unlocked &&
+                            TryAcquire ()) {
+                        return;
+                    }
+                }
+                // ...and then park the thread until the owner releases the lock
+                // (instead of yielding forever and burning the core).
+                // We can't tell if anyone else is parked, so mark the lock
+                // Contended. Worst case Release makes a redundant system call.
+                // state can live in memory shared between processes
+                // (that's what StorageSpinLock is for), so use shared futexes.
+                while (operations::exchange (
+                        state, Contended, boost::memory_order_acquire) != Unlocked) {
+                    os::linux::FutexWait (&state, Contended, TimeSpec::Infinite, true);
+                }
+            }
+        }
+
+        void StorageSpinLock::Release () {
+            if (operations::exchange (state, Unlocked, boost::memory_order_release) == Contended) {
+                os::linux::FutexWake (&state, 1, true);
+            }
+        }
+    #else // defined (TOOLCHAIN_OS_Linux)
         bool StorageSpinLock::IsLocked () const {
             return operations::load (state, boost::memory_order_relaxed) == Locked;
         }
@@ -53,6 +101,7 @@ namespace thekogans {
         void StorageSpinLock::Release () {
             operations::store (state, Unlocked, boost::memory_order_release);
         }
+    #endif // defined (TOOLCHAIN_OS_Linux)
 
     } // namespace util
 } // namespace thekogans
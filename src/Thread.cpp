@@ -197,11 +197,19 @@ namespace thekogans {
                     }
                 }
                 else {
+                    // Set before the thread gets a chance to run so that
+                    // the dtor (or a recycling Create) doesn't reap it
+                    // while it's still starting up.
+                    exited = false;
                     THEKOGANS_UTIL_ERROR_CODE errorCode =
                         pthread_create (&thread, 0, ThreadProc, this);
                     if (errorCode != 0) {
                         THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (errorCode);
                     }
+                    // Set here, not in ThreadProc. Otherwise a Wait
+                    // called before the thread gets a chance to run
+                    // returns false without joining it.
+                    joined = false;
                 }
             }
         #endif // defined (TOOLCHAIN_OS_Windows)
@@ -444,9 +452,6 @@ namespace thekogans {
                 pthread_setname_np (thread->thread, name);
             #endif // defined (TOOLCHAIN_OS_Windows)
             }
-        #if !defined (TOOLCHAIN_OS_Windows)
-            thread->joined = false;
-        #endif // !defined (TOOLCHAIN_OS_Windows)
             thread->exited = false;
             thread->Run ();
             AtExit (thread->GetThreadHandle ());
@@ -154,44 +154,10 @@ namespace thekogans {
             return *this + FromNanoseconds (nanoseconds);
         }
 
-        void TimeSpec::Read (
-                const SerializableHeader & /*header*/,
-                Serializer &serializer) {
-            serializer >> seconds >> nanoseconds;
-        }
-
-        void TimeSpec::Write (Serializer &serializer) const {
-            serializer << seconds << nanoseconds;
-        }
+        static_assert (SerializableFields<TimeSpec>::SIZE == TimeSpec::SIZE,
+            "TimeSpec::SIZE is out of sync with TimeSpec::Fields.");
 
-        namespace {
-            const char * const ATTR_SECONDS = "Seconds";
-            const char * const ATTR_NANOSECONDS = "Nanoseconds";
-        }
-
-        void TimeSpec::ReadXML (
-                const SerializableHeader & /*header*/,
-                const pugi::xml_node &node) {
-            seconds = stringToui64 (node.attribute (ATTR_SECONDS).value ());
-            nanoseconds = stringToi32 (node.attribute (ATTR_NANOSECONDS).value ());
-        }
-
-        void TimeSpec::WriteXML (pugi::xml_node &node) const {
-            node.append_attribute (ATTR_SECONDS).set_value (i64Tostring (seconds).c_str ());
-            node.append_attribute (ATTR_NANOSECONDS).set_value (i32Tostring (nanoseconds).c_str ());
-        }
-
-        void TimeSpec::ReadJSON (
-                const SerializableHeader & /*header*/,
-                const JSON::Object &object) {
-            seconds = object.Get<JSON::Number> (ATTR_SECONDS)->To<i64> ();
-            nanoseconds = object.Get<JSON::Number> (ATTR_NANOSECONDS)->To<i32> ();
-        }
-
-        void TimeSpec::WriteJSON (JSON::Object &object) const {
-            object.Add (ATTR_SECONDS, seconds);
-            object.Add (ATTR_NANOSECONDS, nanoseconds);
-        }
+        THEKOGANS_UTIL_IMPLEMENT_SERIALIZABLE_FIELDS (TimeSpec)
 
     #if defined (THEKOGANS_UTIL_CONFIG_Debug)
         namespace {
@@ -33,6 +33,7 @@
 #include "thekogans/util/LoggerMgr.h"
 #include "thekogans/util/Constants.h"
 #include "thekogans/util/AlignedAllocator.h"
+#include "thekogans/util/BufferedSerializer.h"
 #include "thekogans/util/TransactedFileBTreeAllocator.h"
 #include "thekogans/util/TransactedFileBTreeRegistry.h"
 #include "thekogans/util/TransactedFile.h"
@@ -366,7 +367,10 @@ namespace thekogans {
             if (Path (path).Exists () && Path (logPath).Exists ()) {
                 {
                     SimpleFile file (HostEndian, path, SimpleFile::ReadWrite);
-                    ReadOnlyFile log (HostEndian, logPath);
+                    ReadOnlyFile logFile (HostEndian, logPath);
+                    // Without buffering, every header field and page offset
+                    // would cost a system call.
+                    BufferedSerializer log (logFile, HostEndian);
                     // Magic serves two purposes. Firstly it gives us a quick
                     // check to make sure we're dealing with a log file and second,
                     // it allows us to move logs from little to big endian (and
@@ -411,15 +415,19 @@ namespace thekogans {
             if (IsOpen ()) {
                 std::string logPath = GetLogPath (path);
                 {
-                    SimpleFile log (
+                    SimpleFile logFile (
                         endianness,
                         logPath,
                         SimpleFile::ReadWrite | SimpleFile::Create | SimpleFile::Truncate);
+                    BufferedSerializer log (logFile, endianness);
                     log << (ui32)0 << (ui32)0 << size <<
                         (TransactedFileAddressSpaceType::SizeType)pageMap->GetPageSize ();
                     std::size_t count = pageMap->Log (log);
                     log.Seek (0, SEEK_SET);
                     log << MAGIC32 << (ui32)count;
+                    // Flush explicitly (instead of relying on the dtor)
+                    // so that errors are not swallowed.
+                    log.Flush ();
                 }
                 pageMap->Flush (*this, clearCache);
                 SetSize (size);
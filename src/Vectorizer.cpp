@@ -26,9 +26,10 @@ namespace thekogans {
 
         Vectorizer::Vectorizer (
                 std::size_t workerCount_,
-                i32 workerPriority) :
+                i32 workerPriority,
+                const TimeSpec &maxSpinTime) :
                 done (false),
-                barrier (workerCount_),
+                barrier (workerCount_, maxSpinTime),
                 job (0),
                 workerCount (0),
                 chunkSize (0) {
@@ -51,22 +52,16 @@ namespace thekogans {
         }
 
         Vectorizer::~Vectorizer () {
-            done = true;
-            struct DoneJob : public Job {
-                std::size_t workerCount;
-                explicit DoneJob (std::size_t workerCount_) :
-                    workerCount (workerCount_) {}
-                virtual void Execute (
-                    std::size_t /*startIndex*/,
-                    std::size_t /*endIndex*/,
-                    std::size_t /*rank*/) noexcept {}
-                virtual std::size_t Size () const noexcept {
-                    return workerCount;
+            if (!workers.empty ()) {
+                // Workers check done right after the first barrier.
+                // We can't get here while they are between the two
+                // barriers of the last Execute, so one crossing is
+                // enough to release them all.
+                done = true;
+                barrier.Wait ();
+                for (std::size_t i = 0, count = workers.size (); i < count; ++i) {
+                    workers[i]->Wait ();
                 }
-            } doneJob (workers.size ());
-            Execute (doneJob, 1);
-            for (std::size_t i = 0, count = workers.size (); i < count; ++i) {
-                workers[i]->Wait ();
             }
         }
 
@@ -142,9 +137,18 @@ namespace thekogans {
             // (and which leaves the job in an incomplete state).
             // It's better to just crash loudly, and let the engineer
             // fix his/her own code.
-            while (!vectorizer.done) {
-                // Wait until Execute releases us.
+            // NOTE: done must be checked right after the first barrier.
+            // Checked at the top of the loop, it can be set by the dtor
+            // while a worker is still on its way out of the second
+            // barrier of the last Execute. That worker would then quit
+            // without crossing the dtor's barrier, and the dtor (along
+            // with everyone else) would wait for it forever.
+            for (;;) {
+                // Wait until Execute (or the dtor) releases us.
                 vectorizer.barrier.Wait ();
+                if (vectorizer.done) {
+                    break;
+                }
                 if (vectorizer.job != nullptr && rank < vectorizer.workerCount) {
                     std::size_t startIndex = rank * vectorizer.chunkSize;
                     std::size_t endIndex = std::min (
@@ -0,0 +1,389 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#include "thekogans/util/Environment.h"
+
+#if defined (TOOLCHAIN_OS_Linux)
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <vector>
+#include "thekogans/util/Exception.h"
+#include "thekogans/util/LockGuard.h"
+#include "thekogans/util/HRTimer.h"
+#include "thekogans/util/os/linux/EpollRunLoop.h"
+
+namespace thekogans {
+    namespace util {
+        namespace os {
+            namespace linux {
+
+                namespace {
+                    ui32 EventsToepoll_events (ui32 events) {
+                        ui32 epollEvents = EPOLLRDHUP;
+                        if ((events & EpollRunLoop::EventReadable) != 0) {
+                            epollEvents |= EPOLLIN;
+                        }
+                        if ((events & EpollRunLoop::EventWritable) != 0) {
+                            epollEvents |= EPOLLOUT;
+                        }
+                        if ((events & EpollRunLoop::EventEdgeTriggered) != 0) {
+                            epollEvents |= EPOLLET;
+                        }
+                        return epollEvents;
+                    }
+
+                    void AddReadHandle (
+                            THEKOGANS_UTIL_HANDLE epollHandle,
+                            THEKOGANS_UTIL_HANDLE handle) {
+                        epoll_event event = {0};
+                        event.events = EPOLLIN;
+                        event.data.fd = handle;
+                        if (epoll_ctl (epollHandle, EPOLL_CTL_ADD, handle, &event) < 0) {
+                            THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                                THEKOGANS_UTIL_OS_ERROR_CODE);
+                        }
+                    }
+                }
+
+                EpollRunLoop::EpollRunLoop (
+                        const std::string &name,
+                        JobExecutionPolicy::SharedPtr jobExecutionPolicy,
+                        std::size_t maxEvents_,
+                        std::size_t maxJobsPerIteration_) :
+                        ThreadRunLoop (name, jobExecutionPolicy),
+                        epollHandle (epoll_create1 (EPOLL_CLOEXEC)),
+                        eventHandle (eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC)),
+                        timerHandle (timerfd_create (CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC)),
+                        maxEvents (maxEvents_),
+                        maxJobsPerIteration (maxJobsPerIteration_) {
+                    if (epollHandle == THEKOGANS_UTIL_INVALID_HANDLE_VALUE ||
+                            eventHandle == THEKOGANS_UTIL_INVALID_HANDLE_VALUE ||
+                            timerHandle == THEKOGANS_UTIL_INVALID_HANDLE_VALUE) {
+                        THEKOGANS_UTIL_ERROR_CODE errorCode = THEKOGANS_UTIL_OS_ERROR_CODE;
+                        if (epollHandle != THEKOGANS_UTIL_INVALID_HANDLE_VALUE) {
+                            close (epollHandle);
+                        }
+                        if (eventHandle != THEKOGANS_UTIL_INVALID_HANDLE_VALUE) {
+                            close (eventHandle);
+                        }
+                        if (timerHandle != THEKOGANS_UTIL_INVALID_HANDLE_VALUE) {
+                            close (timerHandle);
+                        }
+                        THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (errorCode);
+                    }
+                    if (maxEvents == 0 || maxJobsPerIteration == 0) {
+                        close (epollHandle);
+                        close (eventHandle);
+                        close (timerHandle);
+                        THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                            THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+                    }
+                    AddReadHandle (epollHandle, eventHandle);
+                    AddReadHandle (epollHandle, timerHandle);
+                }
+
+                EpollRunLoop::~EpollRunLoop () {
+                    Stop ();
+                    close (timerHandle);
+                    close (eventHandle);
+                    close (epollHandle);
+                }
+
+                void EpollRunLoop::AddHandle (
+                        THEKOGANS_UTIL_HANDLE handle,
+                        ui32 events,
+                        EventSink::SharedPtr eventSink) {
+                    if (handle != THEKOGANS_UTIL_INVALID_HANDLE_VALUE && eventSink != nullptr) {
+                        LockGuard<SpinLock> guard (spinLock);
+                        if (!eventSinks.insert (EventSinkMap::value_type (handle, eventSink)).second) {
+                            THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                                "Handle %d is already registered.", handle);
+                        }
+                        epoll_event event = {0};
+                        event.events = EventsToepoll_events (events);
+                        event.data.fd = handle;
+                        if (epoll_ctl (epollHandle, EPOLL_CTL_ADD, handle, &event) < 0) {
+                            THEKOGANS_UTIL_ERROR_CODE errorCode = THEKOGANS_UTIL_OS_ERROR_CODE;
+                            eventSinks.erase (handle);
+                            THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (errorCode);
+                        }
+                    }
+                    else {
+                        THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                            THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+                    }
+                }
+
+                void EpollRunLoop::ModifyHandle (
+                        THEKOGANS_UTIL_HANDLE handle,
+                        ui32 events) {
+                    LockGuard<SpinLock> guard (spinLock);
+                    if (eventSinks.find (handle) == eventSinks.end ()) {
+                        THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                            "Handle %d is not registered.", handle);
+                    }
+                    epoll_event event = {0};
+                    event.events = EventsToepoll_events (events);
+                    event.data.fd = handle;
+                    if (epoll_ctl (epollHandle, EPOLL_CTL_MOD, handle, &event) < 0) {
+                        THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                            THEKOGANS_UTIL_OS_ERROR_CODE);
+                    }
+                }
+
+                void EpollRunLoop::RemoveHandle (THEKOGANS_UTIL_HANDLE handle) {
+                    LockGuard<SpinLock> guard (spinLock);
+                    EventSinkMap::iterator it = eventSinks.find (handle);
+                    if (it != eventSinks.end ()) {
+                        // The handle might have been closed already (which
+                        // removes it from the epoll set), so ignore errors.
+                        epoll_event event = {0};
+                        epoll_ctl (epollHandle, EPOLL_CTL_DEL, handle, &event);
+                        eventSinks.erase (it);
+                    }
+                }
+
+                RunLoop::Job::Id EpollRunLoop::ScheduleJob (
+                        Job::SharedPtr job,
+                        const TimeSpec &timeSpec) {
+                    if (job != nullptr && timeSpec != TimeSpec::Infinite) {
+                        LockGuard<SpinLock> guard (spinLock);
+                        TimeSpec deadline = GetCurrentTime () + timeSpec;
+                        bool earliest = scheduledJobs.empty () ||
+                            deadline < scheduledJobs.begin ()->first;
+                        scheduledJobs.insert (ScheduledJobs::value_type (deadline, job));
+                        if (earliest) {
+                            ArmTimer ();
+                        }
+                        return job->GetId ();
+                    }
+                    else {
+                        THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                            THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+                    }
+                }
+
+                bool EpollRunLoop::CancelScheduledJob (const Job::Id &jobId) {
+                    LockGuard<SpinLock> guard (spinLock);
+                    for (ScheduledJobs::iterator it = scheduledJobs.begin (),
+                            end = scheduledJobs.end (); it != end; ++it) {
+                        if (it->second->GetId () == jobId) {
+                            bool earliest = it == scheduledJobs.begin ();
+                            scheduledJobs.erase (it);
+                            if (earliest) {
+                                ArmTimer ();
+                            }
+                            return true;
+                        }
+                    }
+                    return false;
+                }
+
+                void EpollRunLoop::Start () {
+                    state->done = false;
+                    std::vector<epoll_event> events (maxEvents);
+                    TimeSpec timeout = ExecuteJobs ();
+                    while (!state->done) {
+                        // If jobs are still waiting, just poll the handles. If they're
+                        // being throttled, wait no longer than it takes to release one.
+                        int count = epoll_wait (
+                            epollHandle,
+                            events.data (),
+                            (int)maxEvents,
+                            timeout == TimeSpec::Infinite ? -1 :
+                                (int)((timeout.ToMicroseconds () + 999) / 1000));
+                        if (count < 0) {
+                            THEKOGANS_UTIL_ERROR_CODE errorCode = THEKOGANS_UTIL_OS_ERROR_CODE;
+                            if (errorCode != EINTR) {
+                                THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (errorCode);
+                            }
+                            continue;
+                        }
+                        for (int i = 0; i < count && !state->done; ++i) {
+                            if (events[i].data.fd == eventHandle) {
+                                eventfd_t value;
+                                eventfd_read (eventHandle, &value);
+                            }
+                            else if (events[i].data.fd == timerHandle) {
+                                ui64 expirations;
+                                if (read (timerHandle, &expirations, sizeof (expirations)) > 0) {
+                                    EnqDueJobs ();
+                                }
+                            }
+                            else {
+                                DispatchEvents (events[i].data.fd, events[i].events);
+                            }
+                        }
+                        timeout = ExecuteJobs ();
+                    }
+                }
+
+                void EpollRunLoop::Stop (
+                        bool cancelRunningJobs,
+                        bool cancelPendingJobs) {
+                    state->done = true;
+                    {
+                        // Scheduled jobs belong to this run. Don't let
+                        // their timers fire after a restart.
+                        LockGuard<SpinLock> guard (spinLock);
+                        scheduledJobs.clear ();
+                        ArmTimer ();
+                    }
+                    if (cancelRunningJobs) {
+                        CancelRunningJobs ();
+                    }
+                    WakeUp ();
+                    if (cancelPendingJobs) {
+                        Job *job;
+                        while ((job = state->jobExecutionPolicy->DeqJob (*state)) != nullptr) {
+                            job->Cancel ();
+                            state->runningJobs.push_back (job);
+                            state->FinishedJob (job, 0, 0);
+                        }
+                    }
+                    state->idle.SignalAll ();
+                }
+
+                void EpollRunLoop::Continue () {
+                    RunLoop::Continue ();
+                    WakeUp ();
+                }
+
+                bool EpollRunLoop::EnqJob (
+                        Job::SharedPtr job,
+                        bool wait,
+                        const TimeSpec &timeSpec) {
+                    bool result = RunLoop::EnqJob (job);
+                    if (result) {
+                        WakeUp ();
+                        result = !wait || WaitForJob (job, timeSpec);
+                    }
+                    return result;
+                }
+
+                bool EpollRunLoop::EnqJobFront (
+                        Job::SharedPtr job,
+                        bool wait,
+                        const TimeSpec &timeSpec) {
+                    bool result = RunLoop::EnqJobFront (job);
+                    if (result) {
+                        WakeUp ();
+                        result = !wait || WaitForJob (job, timeSpec);
+                    }
+                    return result;
+                }
+
+                void EpollRunLoop::WakeUp () {
+                    // The eventfd counter saturates long before it can
+                    // overflow, so a failed (EAGAIN) write still wakes us up.
+                    eventfd_write (eventHandle, 1);
+                }
+
+                TimeSpec EpollRunLoop::ExecuteJobs () {
+                    for (std::size_t i = 0; i < maxJobsPerIteration && !state->done; ++i) {
+                        Job *job = state->DeqJob (false);
+                        if (job == nullptr) {
+                            break;
+                        }
+                        ui64 start = 0;
+                        ui64 end = 0;
+                        // Short circuit cancelled pending jobs.
+                        if (!job->ShouldStop (state->done)) {
+                            start = HRTimer::Click ();
+                            job->SetState (Job::Running);
+                            job->Prologue (state->done);
+                            job->Execute (state->done);
+                            job->Epilogue (state->done);
+                            job->Succeed (state->done);
+                            end = HRTimer::Click ();
+                        }
+                        state->FinishedJob (job, start, end);
+                    }
+                    // DeqJob returns nullptr for an empty queue as well as for one held
+                    // back by the job execution policy (\see{RunLoop::RateLimitedJobExecutionPolicy}).
+                    // GetDeqJobDelay tells them apart.
+                    return state->done || IsPaused () || GetPendingJobCount () == 0 ?
+                        TimeSpec::Infinite : state->GetDeqJobDelay ();
+                }
+
+                void EpollRunLoop::EnqDueJobs () {
+                    std::vector<Job::SharedPtr> dueJobs;
+                    {
+                        LockGuard<SpinLock> guard (spinLock);
+                        TimeSpec now = GetCurrentTime ();
+                        while (!scheduledJobs.empty () && scheduledJobs.begin ()->first <= now) {
+                            dueJobs.push_back (scheduledJobs.begin ()->second);
+                            scheduledJobs.erase (scheduledJobs.begin ());
+                        }
+                        ArmTimer ();
+                    }
+                    // We're on the run loop thread. No need to wake ourselves up.
+                    for (std::size_t i = 0, count = dueJobs.size (); i < count; ++i) {
+                        RunLoop::EnqJob (dueJobs[i]);
+                    }
+                }
+
+                void EpollRunLoop::ArmTimer () {
+                    itimerspec value = {{0, 0}, {0, 0}};
+                    if (!scheduledJobs.empty ()) {
+                        value.it_value = scheduledJobs.begin ()->first.Totimespec ();
+                        // A zero it_value disarms the timer.
+                        if (value.it_value.tv_sec == 0 && value.it_value.tv_nsec == 0) {
+                            value.it_value.tv_nsec = 1;
+                        }
+                    }
+                    if (timerfd_settime (timerHandle, TFD_TIMER_ABSTIME, &value, nullptr) < 0) {
+                        THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                            THEKOGANS_UTIL_OS_ERROR_CODE);
+                    }
+                }
+
+                void EpollRunLoop::DispatchEvents (
+                        THEKOGANS_UTIL_HANDLE handle,
+                        ui32 events) {
+                    EventSink::SharedPtr eventSink;
+                    {
+                        LockGuard<SpinLock> guard (spinLock);
+                        EventSinkMap::iterator it = eventSinks.find (handle);
+                        if (it != eventSinks.end ()) {
+                            eventSink = it->second;
+                        }
+                    }
+                    // The handle might have been removed by a previous
+                    // event sink in this batch.
+                    if (eventSink != nullptr) {
+                        if ((events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) != 0) {
+                            eventSink->HandleError (handle, events);
+                        }
+                        if ((events & EPOLLIN) != 0) {
+                            eventSink->HandleReadable (handle);
+                        }
+                        if ((events & EPOLLOUT) != 0) {
+                            eventSink->HandleWritable (handle);
+                        }
+                    }
+                }
+
+            } // namespace linux
+        } // namespace os
+    } // namespace util
+} // namespace thekogans
+
+#endif // defined (TOOLCHAIN_OS_Linux)
@@ -0,0 +1,224 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#include "thekogans/util/Environment.h"
+
+#if defined (TOOLCHAIN_OS_Linux)
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <errno.h>
+#include <climits>
+#include "thekogans/util/Exception.h"
+#include "thekogans/util/Thread.h"
+#include "thekogans/util/os/linux/Futex.h"
+
+namespace thekogans {
+    namespace util {
+        namespace os {
+            namespace linux {
+
+                namespace {
+                    inline long futex (
+                            volatile ui32 *address,
+                            int op,
+                            ui32 value,
+                            const timespec *timeout,
+                            volatile ui32 *address2,
+                            ui32 value3) {
+                        return syscall (SYS_futex, address, op, value, timeout, address2, value3);
+                    }
+
+                    inline int Op (
+                            int op,
+                            bool shared) {
+                        return shared ? op : op | FUTEX_PRIVATE_FLAG;
+                    }
+
+                    inline volatile ui32 *Word (std::atomic<ui32> &value) {
+                        return (volatile ui32 *)&value;
+                    }
+                }
+
+                _LIB_THEKOGANS_UTIL_DECL bool _LIB_THEKOGANS_UTIL_API FutexWait (
+                        volatile ui32 *address,
+                        ui32 expected,
+                        const TimeSpec &timeSpec,
+                        bool shared) {
+                    timespec timeout;
+                    if (timeSpec != TimeSpec::Infinite) {
+                        timeout = timeSpec.Totimespec ();
+                    }
+                    if (futex (address, Op (FUTEX_WAIT, shared), expected,
+                            timeSpec != TimeSpec::Infinite ? &timeout : nullptr, nullptr, 0) < 0) {
+                        THEKOGANS_UTIL_ERROR_CODE errorCode = THEKOGANS_UTIL_OS_ERROR_CODE;
+                        if (errorCode == ETIMEDOUT) {
+                            return false;
+                        }
+                        // EAGAIN == *address != expected, EINTR == signal.
+                        // Both look like a (spurious) wakeup to the caller.
+                        if (errorCode != EAGAIN && errorCode != EINTR) {
+                            THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (errorCode);
+                        }
+                    }
+                    return true;
+                }
+
+                _LIB_THEKOGANS_UTIL_DECL ui32 _LIB_THEKOGANS_UTIL_API FutexWake (
+                        volatile ui32 *address,
+                        ui32 count,
+                        bool shared) {
+                    long result = futex (address, Op (FUTEX_WAKE, shared),
+                        count > INT_MAX ? INT_MAX : count, nullptr, nullptr, 0);
+                    if (result < 0) {
+                        THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                            THEKOGANS_UTIL_OS_ERROR_CODE);
+                    }
+                    return (ui32)result;
+                }
+
+                _LIB_THEKOGANS_UTIL_DECL bool _LIB_THEKOGANS_UTIL_API FutexRequeue (
+                        volatile ui32 *address,
+                        ui32 expected,
+                        ui32 wakeCount,
+                        volatile ui32 *target,
+                        bool shared) {
+                    // FUTEX_CMP_REQUEUE passes the requeue limit in the timeout slot.
+                    if (futex (address, Op (FUTEX_CMP_REQUEUE, shared),
+                            wakeCount > INT_MAX ? INT_MAX : wakeCount,
+                            (const timespec *)(uintptr_t)INT_MAX, target, expected) < 0) {
+                        THEKOGANS_UTIL_ERROR_CODE errorCode = THEKOGANS_UTIL_OS_ERROR_CODE;
+                        if (errorCode == EAGAIN) {
+                            return false;
+                        }
+                        THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (errorCode);
+                    }
+                    return true;
+                }
+
+                void FutexLock::Acquire () {
+                    ui32 expected = Unlocked;
+                    if (!state.compare_exchange_strong (
+                            expected, Locked, std::memory_order_acquire)) {
+                        // Spin for a while in the hope that the owner is about
+                        // to release the lock. Only try to grab it when it looks
+                        // free so as not to bounce the cache line around.
+                        for (ui32 i = 0; i < maxSpinCount; ++i) {
+                            Thread::Pause ();
+                            if (state.load (std::memory_order_relaxed) == Unlocked) {
+                                expected = Unlocked;
+                                if (state.compare_exchange_weak (
+                                        expected, Locked, std::memory_order_acquire)) {
+                                    return;
+                                }
+                            }
+                        }
+                        AcquireContended ();
+                    }
+                }
+
+                void FutexLock::Release () {
+                    if (state.exchange (Unlocked, std::memory_order_release) == Contended) {
+                        FutexWake (Word (state), 1);
+                    }
+                }
+
+                void FutexLock::AcquireContended () {
+                    // We can't tell if anyone else is parked on the lock so we
+                    // conservatively mark it Contended. Worst case, Release
+                    // will make one unnecessary system call.
+                    while (state.exchange (Contended, std::memory_order_acquire) != Unlocked) {
+                        FutexWait (Word (state), Contended);
+                    }
+                }
+
+                bool FutexCondition::Wait (const TimeSpec &timeSpec) {
+                    ui32 value = sequence.load (std::memory_order_relaxed);
+                    lock.Release ();
+                    // If a signal comes in after we release the lock but
+                    // before we block, sequence will have changed and
+                    // FutexWait will return right away.
+                    bool result = FutexWait (Word (sequence), value, timeSpec);
+                    // We might have been requeued on to the lock's futex word.
+                    lock.AcquireContended ();
+                    return result;
+                }
+
+                void FutexCondition::Signal () {
+                    sequence.fetch_add (1, std::memory_order_release);
+                    FutexWake (Word (sequence), 1);
+                }
+
+                void FutexCondition::SignalAll () {
+                    // Requeued waiters are woken up by FutexLock::Release,
+                    // which only calls in to the kernel if the lock is
+                    // Contended. If we hold the lock, make sure it is.
+                    ui32 expected = FutexLock::Locked;
+                    lock.state.compare_exchange_strong (expected, FutexLock::Contended);
+                    ui32 value;
+                    do {
+                        value = sequence.fetch_add (1, std::memory_order_release) + 1;
+                    } while (!FutexRequeue (Word (sequence), value, 1, Word (lock.state)));
+                }
+
+                void FutexEvent::Signal () {
+                    state.store (1);
+                    if (waiters.load () != 0) {
+                        FutexWake (Word (state), manualReset ? INT_MAX : 1);
+                    }
+                }
+
+                void FutexEvent::SignalAll () {
+                    state.store (1);
+                    if (waiters.load () != 0) {
+                        FutexWake (Word (state), INT_MAX);
+                    }
+                }
+
+                bool FutexEvent::Wait (const TimeSpec &timeSpec) {
+                    TimeSpec deadline = timeSpec == TimeSpec::Infinite ?
+                        TimeSpec::Infinite : GetCurrentTime () + timeSpec;
+                    while (1) {
+                        if (manualReset) {
+                            if (state.load (std::memory_order_acquire) == 1) {
+                                return true;
+                            }
+                        }
+                        else {
+                            ui32 expected = 1;
+                            if (state.compare_exchange_strong (expected, 0)) {
+                                return true;
+                            }
+                        }
+                        TimeSpec remaining = deadline == TimeSpec::Infinite ?
+                            TimeSpec::Infinite : deadline - GetCurrentTime ();
+                        if (remaining == TimeSpec::Zero) {
+                            return false;
+                        }
+                        ++waiters;
+                        FutexWait (Word (state), 0, remaining);
+                        --waiters;
+                    }
+                }
+
+            } // namespace linux
+        } // namespace os
+    } // namespace util
+} // namespace thekogans
+
+#endif // defined (TOOLCHAIN_OS_Linux)
@@ -0,0 +1,384 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#include "thekogans/util/Environment.h"
+
+#if defined (TOOLCHAIN_OS_Linux)
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <errno.h>
+#include <cstring>
+#include "thekogans/util/Exception.h"
+#include "thekogans/util/Thread.h"
+#include "thekogans/util/os/linux/IORing.h"
+// NOTE: linux/io_uring.h drags in linux/fs.h which #defines BLOCK_SIZE.
+// Include it last so that it doesn't clash with our headers.
+#include <linux/io_uring.h>
+
+namespace thekogans {
+    namespace util {
+        namespace os {
+            namespace linux {
+
+                namespace {
+                #if defined (__NR_io_uring_setup)
+                    inline int io_uring_setup (
+                            unsigned entries,
+                            io_uring_params *params) {
+                        return (int)syscall (__NR_io_uring_setup, entries, params);
+                    }
+
+                    inline int io_uring_enter (
+                            int fd,
+                            unsigned toSubmit,
+                            unsigned minComplete,
+                            unsigned flags) {
+                        return (int)syscall (__NR_io_uring_enter,
+                            fd, toSubmit, minComplete, flags, nullptr, 0);
+                    }
+
+                    inline int io_uring_register (
+                            int fd,
+                            unsigned opcode,
+                            const void *arg,
+                            unsigned count) {
+                        return (int)syscall (__NR_io_uring_register, fd, opcode, arg, count);
+                    }
+                #else // defined (__NR_io_uring_setup)
+                    inline int io_uring_setup (
+                            unsigned /*entries*/,
+                            io_uring_params * /*params*/) {
+                        errno = ENOSYS;
+                        return -1;
+                    }
+
+                    inline int io_uring_enter (
+                            int /*fd*/,
+                            unsigned /*toSubmit*/,
+                            unsigned /*minComplete*/,
+                            unsigned /*flags*/) {
+                        errno = ENOSYS;
+                        return -1;
+                    }
+
+                    inline int io_uring_register (
+                            int /*fd*/,
+                            unsigned /*opcode*/,
+                            const void * /*arg*/,
+                            unsigned /*count*/) {
+                        errno = ENOSYS;
+                        return -1;
+                    }
+                #endif // defined (__NR_io_uring_setup)
+
+                    inline ui32 *RingPtr (
+                            void *ring,
+                            ui32 offset) {
+                        return (ui32 *)((ui8 *)ring + offset);
+                    }
+
+                    inline ui32 LoadAcquire (const ui32 *value) {
+                        return __atomic_load_n (value, __ATOMIC_ACQUIRE);
+                    }
+
+                    inline void StoreRelease (
+                            ui32 *value,
+                            ui32 newValue) {
+                        __atomic_store_n (value, newValue, __ATOMIC_RELEASE);
+                    }
+                }
+
+                IORing::IORing (ui32 entries_) :
+                        handle (THEKOGANS_UTIL_INVALID_HANDLE_VALUE),
+                        entries (0),
+                        sqRing (MAP_FAILED),
+                        sqRingLength (0),
+                        cqRing (MAP_FAILED),
+                        cqRingLength (0),
+                        sqes ((io_uring_sqe *)MAP_FAILED),
+                        sqHead (nullptr),
+                        sqTail (nullptr),
+                        sqMask (0),
+                        sqArray (nullptr),
+                        cqHead (nullptr),
+                        cqTail (nullptr),
+                        cqMask (0),
+                        cqes (nullptr),
+                        pending (0),
+                        registeredBufferCount (0) {
+                    if (entries_ == 0) {
+                        THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                            THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+                    }
+                    io_uring_params params;
+                    memset (&params, 0, sizeof (params));
+                    handle = io_uring_setup (entries_, &params);
+                    if (handle == THEKOGANS_UTIL_INVALID_HANDLE_VALUE) {
+                        THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                            THEKOGANS_UTIL_OS_ERROR_CODE);
+                    }
+                    entries = params.sq_entries;
+                    sqRingLength = params.sq_off.array + params.sq_entries * sizeof (ui32);
+                    cqRingLength = params.cq_off.cqes + params.cq_entries * sizeof (io_uring_cqe);
+                    bool singleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+                    if (singleMmap) {
+                        if (cqRingLength > sqRingLength) {
+                            sqRingLength = cqRingLength;
+                        }
+                        cqRingLength = sqRingLength;
+                    }
+                    sqRing = mmap (0, sqRingLength, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, handle, IORING_OFF_SQ_RING);
+                    if (sqRing != MAP_FAILED) {
+                        cqRing = singleMmap ? sqRing :
+                            mmap (0, cqRingLength, PROT_READ | PROT_WRITE,
+                                MAP_SHARED | MAP_POPULATE, handle, IORING_OFF_CQ_RING);
+                        if (cqRing != MAP_FAILED) {
+                            sqes = (io_uring_sqe *)mmap (0,
+                                params.sq_entries * sizeof (io_uring_sqe),
+                                PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                handle, IORING_OFF_SQES);
+                        }
+                    }
+                    if (sqRing == MAP_FAILED || cqRing == MAP_FAILED || sqes == MAP_FAILED) {
+                        THEKOGANS_UTIL_ERROR_CODE errorCode = THEKOGANS_UTIL_OS_ERROR_CODE;
+                        if (cqRing != MAP_FAILED && cqRing != sqRing) {
+                            munmap (cqRing, cqRingLength);
+                        }
+                        if (sqRing != MAP_FAILED) {
+                            munmap (sqRing, sqRingLength);
+                        }
+                        close (handle);
+                        THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (errorCode);
+                    }
+                    sqHead = RingPtr (sqRing, params.sq_off.head);
+                    sqTail = RingPtr (sqRing, params.sq_off.tail);
+                    sqMask = *RingPtr (sqRing, params.sq_off.ring_mask);
+                    sqArray = RingPtr (sqRing, params.sq_off.array);
+                    cqHead = RingPtr (cqRing, params.cq_off.head);
+                    cqTail = RingPtr (cqRing, params.cq_off.tail);
+                    cqMask = *RingPtr (cqRing, params.cq_off.ring_mask);
+                    cqes = (io_uring_cqe *)((ui8 *)cqRing + params.cq_off.cqes);
+                }
+
+                IORing::~IORing () {
+                    munmap (sqes, entries * sizeof (io_uring_sqe));
+                    if (cqRing != sqRing) {
+                        munmap (cqRing, cqRingLength);
+                    }
+                    munmap (sqRing, sqRingLength);
+                    close (handle);
+                }
+
+                bool IORing::IsSupported () {
+                    io_uring_params params;
+                    memset (&params, 0, sizeof (params));
+                    THEKOGANS_UTIL_HANDLE handle = io_uring_setup (1, &params);
+                    if (handle != THEKOGANS_UTIL_INVALID_HANDLE_VALUE) {
+                        close (handle);
+                        // IORING_OP_READ/WRITE appeared along with IORING_FEAT_NODROP (5.5/5.6).
+                        return (params.features & IORING_FEAT_NODROP) != 0;
+                    }
+                    return false;
+                }
+
+                void IORing::RegisterBuffers (
+                        const iovec *buffers,
+                        ui32 count) {
+                    if (buffers != nullptr && count > 0) {
+                        UnregisterBuffers ();
+                        if (io_uring_register (handle,
+                                IORING_REGISTER_BUFFERS, buffers, count) < 0) {
+                            THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                                THEKOGANS_UTIL_OS_ERROR_CODE);
+                        }
+                        registeredBufferCount = count;
+                    }
+                    else {
+                        THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                            THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+                    }
+                }
+
+                void IORing::UnregisterBuffers () {
+                    if (registeredBufferCount > 0) {
+                        if (io_uring_register (handle,
+                                IORING_UNREGISTER_BUFFERS, nullptr, 0) < 0) {
+                            THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                                THEKOGANS_UTIL_OS_ERROR_CODE);
+                        }
+                        registeredBufferCount = 0;
+                    }
+                }
+
+                void IORing::PrepRead (
+                        THEKOGANS_UTIL_HANDLE fd,
+                        void *buffer,
+                        ui32 count,
+                        ui64 offset,
+                        ui32 bufferIndex,
+                        Request *request) {
+                    if (buffer != nullptr && count > 0 && request != nullptr &&
+                            (bufferIndex == NIDX32 || bufferIndex < registeredBufferCount)) {
+                        io_uring_sqe *sqe = GetSqe ();
+                        sqe->opcode = bufferIndex == NIDX32 ? IORING_OP_READ : IORING_OP_READ_FIXED;
+                        sqe->fd = fd;
+                        sqe->addr = (ui64)buffer;
+                        sqe->len = count;
+                        sqe->off = offset;
+                        if (bufferIndex != NIDX32) {
+                            sqe->buf_index = (ui16)bufferIndex;
+                        }
+                        sqe->user_data = (ui64)request;
+                        CommitSqe ();
+                    }
+                    else {
+                        THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                            THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+                    }
+                }
+
+                void IORing::PrepWrite (
+                        THEKOGANS_UTIL_HANDLE fd,
+                        const void *buffer,
+                        ui32 count,
+                        ui64 offset,
+                        ui32 bufferIndex,
+                        Request *request) {
+                    if (buffer != nullptr && count > 0 && request != nullptr &&
+                            (bufferIndex == NIDX32 || bufferIndex < registeredBufferCount)) {
+                        io_uring_sqe *sqe = GetSqe ();
+                        sqe->opcode = bufferIndex == NIDX32 ? IORING_OP_WRITE : IORING_OP_WRITE_FIXED;
+                        sqe->fd = fd;
+                        sqe->addr = (ui64)buffer;
+                        sqe->len = count;
+                        sqe->off = offset;
+                        if (bufferIndex != NIDX32) {
+                            sqe->buf_index = (ui16)bufferIndex;
+                        }
+                        sqe->user_data = (ui64)request;
+                        CommitSqe ();
+                    }
+                    else {
+                        THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                            THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+                    }
+                }
+
+                void IORing::PrepFsync (
+                        THEKOGANS_UTIL_HANDLE fd,
+                        bool dataOnly,
+                        Request *request) {
+                    if (request != nullptr) {
+                        io_uring_sqe *sqe = GetSqe ();
+                        sqe->opcode = IORING_OP_FSYNC;
+                        sqe->fd = fd;
+                        if (dataOnly) {
+                            sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+                        }
+                        sqe->user_data = (ui64)request;
+                        CommitSqe ();
+                    }
+                    else {
+                        THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                            THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+                    }
+                }
+
+                void IORing::PrepNop (Request *request) {
+                    io_uring_sqe *sqe = GetSqe ();
+                    sqe->opcode = IORING_OP_NOP;
+                    sqe->user_data = (ui64)request;
+                    CommitSqe ();
+                }
+
+                ui32 IORing::Submit () {
+                    ui32 submitted = 0;
+                    while (pending > 0) {
+                        int rc = io_uring_enter (handle, pending, 0, 0);
+                        if (rc >= 0) {
+                            submitted += (ui32)rc;
+                            pending -= (ui32)rc;
+                        }
+                        else {
+                            THEKOGANS_UTIL_ERROR_CODE errorCode = THEKOGANS_UTIL_OS_ERROR_CODE;
+                            if (errorCode == EAGAIN || errorCode == EBUSY) {
+                                // The kernel is out of resources (or the completion
+                                // queue is backed up). Let the reaper catch up.
+                                Thread::YieldSlice ();
+                            }
+                            else if (errorCode != EINTR) {
+                                THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (errorCode);
+                            }
+                        }
+                    }
+                    return submitted;
+                }
+
+                std::size_t IORing::ReapCompletions (bool wait) {
+                    if (wait && cqHead[0] == LoadAcquire (cqTail)) {
+                        while (io_uring_enter (handle, 0, 1, IORING_ENTER_GETEVENTS) < 0) {
+                            THEKOGANS_UTIL_ERROR_CODE errorCode = THEKOGANS_UTIL_OS_ERROR_CODE;
+                            if (errorCode != EINTR) {
+                                THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (errorCode);
+                            }
+                        }
+                    }
+                    std::size_t count = 0;
+                    ui32 head = *cqHead;
+                    for (ui32 tail = LoadAcquire (cqTail); head != tail;
+                            tail = LoadAcquire (cqTail)) {
+                        do {
+                            const io_uring_cqe &cqe = cqes[head & cqMask];
+                            Request *request = (Request *)cqe.user_data;
+                            i32 result = cqe.res;
+                            // Release the slot before calling out so
+                            // that the kernel can reuse it right away.
+                            StoreRelease (cqHead, ++head);
+                            if (request != nullptr) {
+                                request->Complete (result);
+                            }
+                            ++count;
+                        } while (head != tail);
+                    }
+                    return count;
+                }
+
+                io_uring_sqe *IORing::GetSqe () {
+                    if (*sqTail - LoadAcquire (sqHead) == entries) {
+                        Submit ();
+                    }
+                    io_uring_sqe *sqe = &sqes[*sqTail & sqMask];
+                    memset (sqe, 0, sizeof (io_uring_sqe));
+                    return sqe;
+                }
+
+                void IORing::CommitSqe () {
+                    ui32 tail = *sqTail;
+                    sqArray[tail & sqMask] = tail & sqMask;
+                    StoreRelease (sqTail, tail + 1);
+                    ++pending;
+                }
+
+            } // namespace linux
+        } // namespace os
+    } // namespace util
+} // namespace thekogans
+
+#endif // defined (TOOLCHAIN_OS_Linux)
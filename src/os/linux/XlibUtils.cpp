@@ -27,6 +27,7 @@
 #include "thekogans/util/Exception.h"
 #include "thekogans/util/LoggerMgr.h"
 #include "thekogans/util/Directory.h"
+#include "thekogans/util/LockGuard.h"
 #include "thekogans/util/StringUtils.h"
 #include "thekogans/util/os/linux/XlibUtils.h"
 
@@ -0,0 +1,250 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <string>
+#include <vector>
+#include <CppUnitXLite/CppUnitXLite.cpp>
+#include "thekogans/util/Types.h"
+#include "thekogans/util/Path.h"
+#include "thekogans/util/File.h"
+#include "thekogans/util/Buffer.h"
+#include "thekogans/util/BufferChain.h"
+
+using namespace thekogans;
+
+namespace {
+    // Small enough to force values across segment boundaries.
+    const std::size_t SEGMENT_SIZE = 7;
+    const util::ui32 VALUE_COUNT = 100;
+
+    std::string GetTestPath () {
+        return util::MakePath (
+            util::Path::GetTempDirectory (), "test_BufferChain.bin");
+    }
+
+    struct TestFile : public util::SimpleFile {
+        TestFile () :
+            util::SimpleFile (
+                util::HostEndian,
+                GetTestPath (),
+                ReadWrite | Create | Truncate) {}
+        ~TestFile () {
+            Close ();
+            Delete (GetTestPath ());
+        }
+    };
+
+    util::Buffer::SharedPtr MakeBuffer (const std::string &value) {
+        return util::Buffer::SharedPtr (
+            new util::Buffer (
+                util::HostEndian,
+                value.data (),
+                value.data () + value.size ()));
+    }
+
+    std::string Drain (util::BufferChain &chain) {
+        std::string value (chain.GetDataAvailableForReading (), '\0');
+        if (!value.empty ()) {
+            chain.Read (&value[0], value.size ());
+        }
+        return value;
+    }
+}
+
+TEST (thekogans, RoundTrip) {
+    util::BufferChain chain (util::NetworkEndian, SEGMENT_SIZE);
+    for (util::ui32 i = 0; i < VALUE_COUNT; ++i) {
+        chain << i << (util::ui64)i * i << std::string (i % 7, 'a' + i % 26);
+    }
+    CHECK (chain.GetSegmentCount () > 1);
+    for (util::ui32 i = 0; i < VALUE_COUNT; ++i) {
+        util::ui32 value32;
+        util::ui64 value64;
+        std::string value;
+        chain >> value32 >> value64 >> value;
+        CHECK_EQUAL (i, value32);
+        CHECK_EQUAL ((util::ui64)i * i, value64);
+        CHECK (value == std::string (i % 7, 'a' + i % 26));
+    }
+    CHECK (chain.IsEmpty ());
+    CHECK_EQUAL ((std::size_t)0, chain.GetSegmentCount ());
+}
+
+TEST (thekogans, SegmentBoundaries) {
+    util::BufferChain chain (util::NetworkEndian, SEGMENT_SIZE);
+    // Exactly one segment's worth.
+    chain << (util::ui32)0x01020304 << (util::ui16)0x0506 << (util::ui8)0x07;
+    CHECK_EQUAL ((std::size_t)1, chain.GetSegmentCount ());
+    // Doesn't fit in what's left (nothing). Gets a segment of its own.
+    chain << (util::ui64)0x08090a0b0c0d0e0f;
+    CHECK_EQUAL ((std::size_t)2, chain.GetSegmentCount ());
+    // Straddles the end of the third segment.
+    chain << (util::ui32)0x10111213 << (util::ui16)0x1415 << (util::ui32)0x16171819;
+    CHECK_EQUAL ((std::size_t)4, chain.GetSegmentCount ());
+    CHECK_EQUAL ((std::size_t)25, chain.GetDataAvailableForReading ());
+    // Splitting on a segment boundary moves whole segments.
+    util::BufferChain::SharedPtr front = chain.Split (SEGMENT_SIZE);
+    CHECK_EQUAL ((std::size_t)1, front->GetSegmentCount ());
+    CHECK_EQUAL ((std::size_t)3, chain.GetSegmentCount ());
+    util::ui32 value32;
+    util::ui16 value16;
+    util::ui8 value8;
+    *front >> value32 >> value16 >> value8;
+    CHECK_EQUAL ((util::ui32)0x01020304, value32);
+    CHECK_EQUAL ((util::ui16)0x0506, value16);
+    CHECK_EQUAL ((util::ui8)0x07, value8);
+    CHECK (front->IsEmpty ());
+    util::ui64 value64;
+    chain >> value64 >> value32 >> value16;
+    CHECK_EQUAL ((util::ui64)0x08090a0b0c0d0e0f, value64);
+    CHECK_EQUAL ((util::ui32)0x10111213, value32);
+    CHECK_EQUAL ((util::ui16)0x1415, value16);
+    // Read across the boundary.
+    chain >> value32;
+    CHECK_EQUAL ((util::ui32)0x16171819, value32);
+    CHECK (chain.IsEmpty ());
+    CHECK_EQUAL ((std::size_t)0, chain.GetSegmentCount ());
+}
+
+TEST (thekogans, AppendPrepend) {
+    util::Buffer::SharedPtr payload = MakeBuffer ("payload");
+    util::Buffer::SharedPtr header = MakeBuffer ("header:");
+    util::BufferChain chain (util::HostEndian, SEGMENT_SIZE);
+    chain.Append (payload);
+    chain.Prepend (header);
+    chain.Write ("!", 1);
+    // The appended segments are linked in, not copied.
+    CHECK (chain.GetSegment (0) == header);
+    CHECK (chain.GetSegment (1) == payload);
+    // Appended segments are never written to.
+    CHECK_EQUAL ((std::size_t)3, chain.GetSegmentCount ());
+    util::BufferChain other (util::HostEndian, SEGMENT_SIZE);
+    other.Write ("<<", 2);
+    chain.Prepend (other);
+    CHECK (other.IsEmpty ());
+    CHECK (Drain (chain) == "<<header:payload!");
+}
+
+TEST (thekogans, SplitCoalesce) {
+    util::Buffer::SharedPtr buffer = MakeBuffer ("0123456789");
+    util::BufferChain chain (util::HostEndian, SEGMENT_SIZE);
+    chain.Append (buffer);
+    chain.Append (MakeBuffer ("abc"));
+    util::BufferChain::SharedPtr front = chain.Split (4);
+    CHECK_EQUAL ((std::size_t)4, front->GetDataAvailableForReading ());
+    CHECK_EQUAL ((std::size_t)9, chain.GetDataAvailableForReading ());
+    // The straddling segment is shared, not copied.
+    std::vector<util::ByteView> views = front->GetViews ();
+    CHECK_EQUAL ((std::size_t)1, views.size ());
+    CHECK (views[0].data == buffer->data);
+    util::BufferChain::SharedPtr middle = chain.Split (6);
+    CHECK (Drain (chain) == "abc");
+    // Pieces of the same buffer coalesce without copying.
+    front->Append (*middle);
+    util::Buffer::SharedPtr coalesced = front->Coalesce ();
+    CHECK (coalesced->GetReadPtr () == buffer->data);
+    CHECK (coalesced->Tostring () == "0123456789");
+    // Pieces of different buffers are copied.
+    util::BufferChain mixed (util::HostEndian, SEGMENT_SIZE);
+    mixed.Append (MakeBuffer ("abc"));
+    mixed.Append (MakeBuffer ("def"));
+    CHECK (mixed.Coalesce ()->Tostring () == "abcdef");
+    CHECK_EQUAL ((std::size_t)1, mixed.GetSegmentCount ());
+}
+
+TEST (thekogans, WriteToReadFrom) {
+    TestFile file;
+    util::BufferChain chain (util::HostEndian, SEGMENT_SIZE);
+    chain.Append (MakeBuffer ("header:"));
+    for (util::ui32 i = 0; i < VALUE_COUNT; ++i) {
+        chain << i;
+    }
+    chain.Append (MakeBuffer (":trailer"));
+    std::size_t size = chain.GetDataAvailableForReading ();
+    CHECK_EQUAL (size, chain.WriteTo (file));
+    CHECK (chain.IsEmpty ());
+    CHECK_EQUAL ((util::ui64)size, file.GetSize ());
+    // Positional write doesn't move the file pointer.
+    chain.Append (MakeBuffer ("HEADER"));
+    CHECK_EQUAL ((std::size_t)6, chain.WriteTo (file, 0));
+    CHECK_EQUAL ((util::i64)size, file.Tell ());
+    file.Seek (0, SEEK_SET);
+    util::BufferChain input (util::HostEndian, SEGMENT_SIZE);
+    std::size_t countRead = 0;
+    for (std::size_t count; (count = input.ReadFrom (file, SEGMENT_SIZE * 2 + 1)) > 0;) {
+        countRead += count;
+    }
+    CHECK_EQUAL (size, countRead);
+    char header[7];
+    input.Read (header, sizeof (header));
+    CHECK (std::string (header, sizeof (header)) == "HEADER:");
+    for (util::ui32 i = 0; i < VALUE_COUNT; ++i) {
+        util::ui32 value;
+        input >> value;
+        CHECK_EQUAL (i, value);
+    }
+    CHECK (Drain (input) == ":trailer");
+}
+
+TEST (thekogans, DeflateInflate) {
+    util::BufferChain chain (util::HostEndian, SEGMENT_SIZE);
+    std::string text;
+    for (util::ui32 i = 0; i < VALUE_COUNT; ++i) {
+        text += "the quick brown fox jumps over the lazy dog ";
+    }
+    chain.Append (MakeBuffer (text.substr (0, 100)));
+    chain.Append (MakeBuffer (text.substr (100)));
+    util::Buffer::SharedPtr deflated = util::Buffer::Deflate (chain);
+    CHECK (deflated->GetDataAvailableForReading () < text.size ());
+    // Feed the compressed bytes back in small segments.
+    util::BufferChain compressed (util::HostEndian, SEGMENT_SIZE);
+    while (deflated->GetDataAvailableForReading () > 0) {
+        compressed.Append (MakeBuffer (std::string (
+            (const char *)deflated->GetReadPtr (),
+            (std::min) ((std::size_t)5, deflated->GetDataAvailableForReading ()))));
+        deflated->AdvanceReadOffset (5);
+    }
+    util::Buffer::SharedPtr inflated = util::Buffer::Inflate (compressed);
+    CHECK (inflated->Tostring () == text);
+}
+
+TEST (thekogans, InflateTruncated) {
+    std::string text;
+    for (util::ui32 i = 0; i < VALUE_COUNT; ++i) {
+        text += "the quick brown fox jumps over the lazy dog ";
+    }
+    util::Buffer::SharedPtr deflated = MakeBuffer (text)->Deflate ();
+    // Everything but the last few bytes of the stream.
+    util::BufferChain truncated (util::HostEndian, SEGMENT_SIZE);
+    truncated.Append (MakeBuffer (std::string (
+        (const char *)deflated->GetReadPtr (),
+        deflated->GetDataAvailableForReading () / 2)));
+    truncated.Append (MakeBuffer (std::string (
+        (const char *)deflated->GetReadPtr () + deflated->GetDataAvailableForReading () / 2,
+        deflated->GetDataAvailableForReading () / 2 - 4)));
+    bool thrown = false;
+    try {
+        util::Buffer::Inflate (truncated);
+    }
+    catch (const util::Exception &) {
+        thrown = true;
+    }
+    CHECK (thrown);
+}
+
+TESTMAIN
@@ -0,0 +1,237 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <memory>
+#include <vector>
+#include <CppUnitXLite/CppUnitXLite.cpp>
+#include "thekogans/util/Types.h"
+#include "thekogans/util/Buffer.h"
+#include "thekogans/util/BufferPool.h"
+#include "thekogans/util/SecureAllocator.h"
+#include "thekogans/util/Thread.h"
+#include "thekogans/util/Event.h"
+
+using namespace thekogans;
+
+namespace {
+    const std::size_t MIN_SIZE = 4096;
+    const std::size_t MAX_SIZE = 65536;
+
+    // Gets and releases buffers of every size class, some of
+    // them handed off to be released by another thread.
+    struct User : public util::Thread {
+        util::Event &start;
+        util::BufferPool &bufferPool;
+        std::vector<util::Buffer::SharedPtr> handoff;
+        bool corrupt;
+
+        User (
+            util::Event &start_,
+            util::BufferPool &bufferPool_) :
+            start (start_),
+            bufferPool (bufferPool_),
+            corrupt (false) {}
+
+        virtual void Run () noexcept override {
+            start.Wait ();
+            for (std::size_t i = 0; i < 10000; ++i) {
+                std::size_t length = MIN_SIZE << (i % 5);
+                util::Buffer::SharedPtr buffer =
+                    bufferPool.GetBuffer (util::HostEndian, length);
+                if (buffer->GetDataAvailableForWriting () < length) {
+                    corrupt = true;
+                }
+                *buffer << (util::ui64)i;
+                util::ui64 value;
+                *buffer >> value;
+                if (value != i) {
+                    corrupt = true;
+                }
+                if (i % 100 == 0) {
+                    handoff.push_back (buffer);
+                }
+            }
+        }
+    };
+
+    // Releases its buffers all at once, racing the other releasers.
+    struct Releaser : public util::Thread {
+        util::Event &start;
+        std::vector<util::Buffer::SharedPtr> buffers;
+
+        explicit Releaser (util::Event &start_) :
+            start (start_) {}
+
+        virtual void Run () noexcept override {
+            start.Wait ();
+            buffers.clear ();
+        }
+    };
+}
+
+TEST (thekogans, Recycle) {
+    util::BufferPool bufferPool (MIN_SIZE, MAX_SIZE);
+    const util::ui8 *data;
+    {
+        util::Buffer::SharedPtr buffer =
+            bufferPool.GetBuffer (util::NetworkEndian, 5000);
+        CHECK_EQUAL ((std::size_t)8192, buffer->GetLength ());
+        CHECK_EQUAL ((std::size_t)0, buffer->GetDataAvailableForReading ());
+        *buffer << (util::ui32)1;
+        data = buffer->GetReadPtr ();
+    }
+    CHECK_EQUAL ((std::size_t)8192, bufferPool.GetStats ().idleBytes);
+    util::Buffer::SharedPtr buffer =
+        bufferPool.GetBuffer (util::LittleEndian, 8192);
+    // Same size class, same buffer, reset for reuse.
+    CHECK (buffer->GetReadPtr () == data);
+    CHECK_EQUAL ((std::size_t)0, buffer->GetDataAvailableForReading ());
+    CHECK (buffer->endianness == util::LittleEndian);
+    CHECK_EQUAL ((util::ui32)1, buffer->GetRefCount ());
+    util::BufferPool::Stats stats = bufferPool.GetStats ();
+    CHECK_EQUAL ((std::size_t)1, stats.hits);
+    CHECK_EQUAL ((std::size_t)1, stats.misses);
+    CHECK_EQUAL ((std::size_t)0, stats.idleBytes);
+    // A different size class gets a different buffer.
+    util::Buffer::SharedPtr small = bufferPool.GetBuffer (util::HostEndian, 1);
+    CHECK_EQUAL (MIN_SIZE, small->GetLength ());
+    CHECK_EQUAL ((std::size_t)2, bufferPool.GetStats ().misses);
+}
+
+TEST (thekogans, SizeClasses) {
+    util::BufferPool bufferPool (MIN_SIZE, MAX_SIZE);
+    CHECK_EQUAL (MIN_SIZE, bufferPool.GetSizeClassLength (0));
+    CHECK_EQUAL (MIN_SIZE, bufferPool.GetSizeClassLength (MIN_SIZE));
+    CHECK_EQUAL (MIN_SIZE * 2, bufferPool.GetSizeClassLength (MIN_SIZE + 1));
+    CHECK_EQUAL (MAX_SIZE, bufferPool.GetSizeClassLength (MAX_SIZE));
+    CHECK_EQUAL ((std::size_t)0, bufferPool.GetSizeClassLength (MAX_SIZE + 1));
+    // Oversized requests are not pooled.
+    {
+        util::Buffer::SharedPtr buffer =
+            bufferPool.GetBuffer (util::HostEndian, MAX_SIZE + 1);
+        CHECK_EQUAL (MAX_SIZE + 1, buffer->GetLength ());
+    }
+    util::BufferPool::Stats stats = bufferPool.GetStats ();
+    CHECK_EQUAL ((std::size_t)1, stats.oversized);
+    CHECK_EQUAL ((std::size_t)0, stats.idleBytes);
+    bool threw = false;
+    try {
+        util::BufferPool invalid (MAX_SIZE, MIN_SIZE);
+    }
+    catch (const util::Exception &) {
+        threw = true;
+    }
+    CHECK (threw);
+}
+
+TEST (thekogans, Capacity) {
+    util::BufferPool bufferPool (MIN_SIZE, MAX_SIZE, MIN_SIZE * 3);
+    {
+        std::vector<util::Buffer::SharedPtr> buffers;
+        for (std::size_t i = 0; i < 5; ++i) {
+            buffers.push_back (bufferPool.GetBuffer (util::HostEndian, MIN_SIZE));
+        }
+    }
+    util::BufferPool::Stats stats = bufferPool.GetStats ();
+    CHECK_EQUAL (MIN_SIZE * 3, stats.idleBytes);
+    CHECK_EQUAL ((std::size_t)2, stats.discarded);
+    // Resized buffers no longer fit their size class.
+    {
+        util::Buffer::SharedPtr buffer = bufferPool.GetBuffer (util::HostEndian, MIN_SIZE);
+        buffer->Resize (MIN_SIZE * 2);
+    }
+    stats = bufferPool.GetStats ();
+    CHECK_EQUAL (MIN_SIZE * 2, stats.idleBytes);
+    CHECK_EQUAL ((std::size_t)3, stats.discarded);
+    bufferPool.Flush ();
+    CHECK_EQUAL ((std::size_t)0, bufferPool.GetStats ().idleBytes);
+}
+
+TEST (thekogans, ConcurrentCapacity) {
+    const std::size_t THREAD_COUNT = 4;
+    const std::size_t BUFFER_COUNT = 16;
+    const std::size_t MAX_IDLE_BUFFERS = 8;
+    util::BufferPool bufferPool (MIN_SIZE, MAX_SIZE, MIN_SIZE * MAX_IDLE_BUFFERS);
+    util::Event start;
+    std::vector<std::unique_ptr<Releaser>> releasers;
+    for (std::size_t i = 0; i < THREAD_COUNT; ++i) {
+        releasers.emplace_back (new Releaser (start));
+        for (std::size_t j = 0; j < BUFFER_COUNT; ++j) {
+            releasers.back ()->buffers.push_back (
+                bufferPool.GetBuffer (util::HostEndian, MIN_SIZE));
+        }
+        releasers.back ()->Create ();
+    }
+    start.Signal ();
+    for (std::size_t i = 0; i < releasers.size (); ++i) {
+        releasers[i]->Wait ();
+    }
+    // Concurrent releases must not take the pool past its limit.
+    util::BufferPool::Stats stats = bufferPool.GetStats ();
+    CHECK_EQUAL (MIN_SIZE * MAX_IDLE_BUFFERS, stats.idleBytes);
+    CHECK_EQUAL (THREAD_COUNT * BUFFER_COUNT - MAX_IDLE_BUFFERS, stats.discarded);
+}
+
+TEST (thekogans, ZeroOnReturn) {
+    util::BufferPool bufferPool (
+        MIN_SIZE,
+        MAX_SIZE,
+        util::BufferPool::DEFAULT_MAX_IDLE_BYTES,
+        true,
+        util::SecureAllocator::Instance ());
+    {
+        util::Buffer::SharedPtr buffer = bufferPool.GetBuffer (util::HostEndian, MIN_SIZE);
+        for (std::size_t i = 0; i < MIN_SIZE; ++i) {
+            *buffer << (util::ui8)0xaa;
+        }
+    }
+    util::Buffer::SharedPtr buffer = bufferPool.GetBuffer (util::HostEndian, MIN_SIZE);
+    CHECK_EQUAL ((std::size_t)1, bufferPool.GetStats ().hits);
+    bool zero = true;
+    for (std::size_t i = 0; i < buffer->GetLength (); ++i) {
+        if (buffer->data[i] != 0) {
+            zero = false;
+            break;
+        }
+    }
+    CHECK (zero);
+}
+
+TEST (thekogans, Threads) {
+    const std::size_t THREAD_COUNT = 4;
+    util::BufferPool bufferPool (MIN_SIZE, MAX_SIZE);
+    {
+        util::Event start;
+        std::vector<std::unique_ptr<User>> users;
+        for (std::size_t i = 0; i < THREAD_COUNT; ++i) {
+            users.emplace_back (new User (start, bufferPool));
+            users.back ()->Create ();
+        }
+        start.Signal ();
+        for (std::size_t i = 0; i < users.size (); ++i) {
+            users[i]->Wait ();
+            CHECK (!users[i]->corrupt);
+        }
+        // Release the handoff buffers on this thread.
+    }
+    util::BufferPool::Stats stats = bufferPool.GetStats ();
+    CHECK_EQUAL (THREAD_COUNT * 10000, stats.hits + stats.misses);
+    CHECK (stats.hits > stats.misses);
+}
+
+TESTMAIN
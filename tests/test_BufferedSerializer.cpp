@@ -0,0 +1,183 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <string>
+#include <vector>
+#include <CppUnitXLite/CppUnitXLite.cpp>
+#include "thekogans/util/Types.h"
+#include "thekogans/util/Path.h"
+#include "thekogans/util/File.h"
+#include "thekogans/util/BufferedSerializer.h"
+
+using namespace thekogans;
+
+namespace {
+    // Small enough to force plenty of refills and flushes.
+    const std::size_t BUFFER_SIZE = 16;
+    const util::ui32 VALUE_COUNT = 100;
+
+    std::string GetTestPath () {
+        return util::MakePath (
+            util::Path::GetTempDirectory (), "test_BufferedSerializer.bin");
+    }
+
+    struct TestFile : public util::SimpleFile {
+        TestFile () :
+            util::SimpleFile (
+                util::HostEndian,
+                GetTestPath (),
+                ReadWrite | Create | Truncate) {}
+        ~TestFile () {
+            Close ();
+            Delete (GetTestPath ());
+        }
+    };
+}
+
+TEST (thekogans, RoundTrip) {
+    TestFile file;
+    {
+        util::BufferedSerializer serializer (file, util::HostEndian, BUFFER_SIZE);
+        for (util::ui32 i = 0; i < VALUE_COUNT; ++i) {
+            serializer << i << (util::ui64)i * i << std::string (i % 7, 'a' + i % 26);
+        }
+        serializer.Flush ();
+    }
+    // Nothing must be lost or reordered by the buffering.
+    file.Seek (0, SEEK_SET);
+    util::BufferedSerializer serializer (file, util::HostEndian, BUFFER_SIZE);
+    for (util::ui32 i = 0; i < VALUE_COUNT; ++i) {
+        util::ui32 value32;
+        util::ui64 value64;
+        std::string value;
+        serializer >> value32 >> value64 >> value;
+        CHECK_EQUAL (i, value32);
+        CHECK_EQUAL ((util::ui64)i * i, value64);
+        CHECK (value == std::string (i % 7, 'a' + i % 26));
+    }
+    util::ui8 byte;
+    CHECK_EQUAL ((std::size_t)0, serializer.Read (&byte, 1));
+}
+
+TEST (thekogans, FlushRefillPoints) {
+    TestFile file;
+    util::BufferedSerializer serializer (file, util::HostEndian, BUFFER_SIZE);
+    // Filling the buffer exactly flushes it.
+    for (util::ui32 i = 0; i < BUFFER_SIZE / 4; ++i) {
+        serializer << i;
+    }
+    CHECK_EQUAL ((util::ui64)BUFFER_SIZE, file.GetSize ());
+    // Pending until the buffer fills up again.
+    serializer << (util::ui16)0x0102 << (util::ui32)3 << (util::ui32)4 << (util::ui32)5;
+    CHECK_EQUAL ((util::ui64)BUFFER_SIZE, file.GetSize ());
+    // Straddles the end of the buffer. The first 2 bytes go out
+    // with the second flush, the rest stay pending.
+    serializer << (util::ui64)0x060708090a0b0c0d;
+    CHECK_EQUAL ((util::ui64)BUFFER_SIZE * 2, file.GetSize ());
+    CHECK_EQUAL ((util::i64)BUFFER_SIZE * 2 + 6, serializer.Tell ());
+    serializer.Flush ();
+    CHECK_EQUAL ((util::ui64)BUFFER_SIZE * 2 + 6, file.GetSize ());
+    // Read back across the same points. Every refill
+    // lands exactly on a BUFFER_SIZE boundary.
+    serializer.Seek (0, SEEK_SET);
+    for (util::ui32 i = 0; i < BUFFER_SIZE / 4; ++i) {
+        util::ui32 value;
+        serializer >> value;
+        CHECK_EQUAL (i, value);
+    }
+    CHECK_EQUAL ((util::i64)BUFFER_SIZE, serializer.Tell ());
+    util::ui16 value16;
+    util::ui32 value32[3];
+    util::ui64 value64;
+    serializer >> value16 >> value32[0] >> value32[1] >> value32[2] >> value64;
+    CHECK_EQUAL ((util::ui16)0x0102, value16);
+    CHECK_EQUAL ((util::ui32)3, value32[0]);
+    CHECK_EQUAL ((util::ui32)4, value32[1]);
+    CHECK_EQUAL ((util::ui32)5, value32[2]);
+    CHECK_EQUAL ((util::ui64)0x060708090a0b0c0d, value64);
+    // Nothing past the end of the file.
+    util::ui8 byte;
+    CHECK_EQUAL ((std::size_t)0, serializer.Read (&byte, 1));
+}
+
+TEST (thekogans, SeekTell) {
+    TestFile file;
+    util::BufferedSerializer serializer (file, util::HostEndian, BUFFER_SIZE);
+    for (util::ui32 i = 0; i < VALUE_COUNT; ++i) {
+        serializer << i;
+        CHECK_EQUAL ((util::i64)(i + 1) * 4, serializer.Tell ());
+    }
+    CHECK_EQUAL ((util::ui64)VALUE_COUNT * 4, serializer.GetSize ());
+    // Patch the header the same way TransactedFile::Commit does.
+    serializer.Seek (0, SEEK_SET);
+    serializer << (util::ui32)0xdeadbeef;
+    CHECK_EQUAL ((util::i64)4, serializer.Tell ());
+    // Read after write.
+    util::ui32 value;
+    serializer >> value;
+    CHECK_EQUAL ((util::ui32)1, value);
+    CHECK_EQUAL ((util::i64)8, serializer.Tell ());
+    // Seek inside the read-ahead (back and forward).
+    serializer.Seek (-8, SEEK_CUR);
+    serializer >> value;
+    CHECK_EQUAL ((util::ui32)0xdeadbeef, value);
+    serializer.Seek (4, SEEK_CUR);
+    serializer >> value;
+    CHECK_EQUAL ((util::ui32)2, value);
+    // Write after read must land at the logical position.
+    serializer << (util::ui32)0xcafebabe;
+    CHECK_EQUAL ((util::i64)16, serializer.Tell ());
+    serializer.Seek (-4, SEEK_END);
+    serializer >> value;
+    CHECK_EQUAL (VALUE_COUNT - 1, value);
+    serializer.Flush ();
+    file.Seek (12, SEEK_SET);
+    file >> value;
+    CHECK_EQUAL ((util::ui32)0xcafebabe, value);
+    CHECK_EQUAL ((util::ui64)VALUE_COUNT * 4, file.GetSize ());
+}
+
+TEST (thekogans, LargeTransfers) {
+    TestFile file;
+    std::vector<util::ui8> block (BUFFER_SIZE * 5 + 3);
+    for (std::size_t i = 0; i < block.size (); ++i) {
+        block[i] = (util::ui8)i;
+    }
+    util::BufferedSerializer serializer (file, util::NetworkEndian, BUFFER_SIZE);
+    serializer << (util::ui16)0x0102;
+    // Bypasses the buffer after flushing what's pending.
+    CHECK_EQUAL (block.size (), serializer.Write (block.data (), block.size ()));
+    serializer << (util::ui16)0x0304;
+    serializer.Seek (0, SEEK_SET);
+    util::ui16 value;
+    serializer >> value;
+    CHECK_EQUAL ((util::ui16)0x0102, value);
+    std::vector<util::ui8> copy (block.size ());
+    CHECK_EQUAL (copy.size (), serializer.Read (copy.data (), copy.size ()));
+    CHECK (copy == block);
+    serializer >> value;
+    CHECK_EQUAL ((util::ui16)0x0304, value);
+    // The wrapped file sees the serializer's endianness, not its own.
+    file.Seek (0, SEEK_SET);
+    util::ui8 bytes[2];
+    file.Read (bytes, 2);
+    CHECK_EQUAL ((util::ui8)0x01, bytes[0]);
+    CHECK_EQUAL ((util::ui8)0x02, bytes[1]);
+}
+
+TESTMAIN
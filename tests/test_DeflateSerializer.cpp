@@ -0,0 +1,248 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <string>
+#include <CppUnitXLite/CppUnitXLite.cpp>
+#include "thekogans/util/Types.h"
+#include "thekogans/util/Buffer.h"
+#include "thekogans/util/BufferChain.h"
+#include "thekogans/util/JobQueue.h"
+#include "thekogans/util/DeflateSerializer.h"
+#include "thekogans/util/InflateSerializer.h"
+
+using namespace thekogans;
+
+namespace {
+    const util::ui32 VALUE_COUNT = 100000;
+
+    std::string GetString (util::ui32 i) {
+        return std::string (i % 7, 'a' + i % 26);
+    }
+
+    void WriteValues (util::Serializer &serializer) {
+        for (util::ui32 i = 0; i < VALUE_COUNT; ++i) {
+            serializer << i << GetString (i);
+        }
+    }
+
+    bool ReadValues (util::InflateSerializer &serializer) {
+        for (util::ui32 i = 0; i < VALUE_COUNT; ++i) {
+            util::ui32 value32;
+            std::string value;
+            serializer >> value32 >> value;
+            if (value32 != i || value != GetString (i)) {
+                return false;
+            }
+        }
+        return serializer.IsEndOfStream ();
+    }
+
+    util::JobQueue::SharedPtr CreateJobQueue () {
+        return util::JobQueue::SharedPtr (
+            new util::JobQueue (
+                "test_DeflateSerializer",
+                new util::RunLoop::FIFOJobExecutionPolicy,
+                4));
+    }
+}
+
+TEST (thekogans, RoundTrip) {
+    util::DeflateSerializer::Format formats[] = {
+        util::DeflateSerializer::Zlib,
+        util::DeflateSerializer::Gzip,
+        util::DeflateSerializer::Raw
+    };
+    util::InflateSerializer::Format inflateFormats[] = {
+        util::InflateSerializer::Zlib,
+        util::InflateSerializer::Gzip,
+        util::InflateSerializer::Raw
+    };
+    for (std::size_t i = 0; i < 3; ++i) {
+        util::BufferChain chain;
+        {
+            util::DeflateSerializer deflate (
+                chain,
+                util::NetworkEndian,
+                1,
+                12,
+                util::DeflateSerializer::Filtered,
+                formats[i],
+                1024);
+            WriteValues (deflate);
+            deflate.Finish ();
+            CHECK (deflate.GetTotalOut () < deflate.GetTotalIn ());
+            CHECK_EQUAL (deflate.GetTotalOut (), (util::ui64)chain.GetDataAvailableForReading ());
+        }
+        // Trailing bytes are left for the caller.
+        chain.Write ("tail", 4);
+        util::InflateSerializer inflate (
+            chain, util::NetworkEndian, inflateFormats[i], 12, 1000);
+        CHECK (ReadValues (inflate));
+        util::ByteView unused = inflate.GetUnusedInput ();
+        std::string tail ((const char *)unused.data, unused.length);
+        while (!chain.IsEmpty ()) {
+            char c;
+            chain.Read (&c, 1);
+            tail += c;
+        }
+        CHECK (tail == "tail");
+    }
+}
+
+TEST (thekogans, OneByteRefills) {
+    util::BufferChain chain;
+    {
+        util::DeflateSerializer deflate (chain);
+        WriteValues (deflate);
+    }
+    // Every compressed byte is a refill, so values (and
+    // zlib's header and trailer) straddle all of them.
+    util::InflateSerializer inflate (
+        chain,
+        util::HostEndian,
+        util::InflateSerializer::Zlib,
+        util::InflateSerializer::DEFAULT_WINDOW_BITS,
+        1);
+    CHECK (ReadValues (inflate));
+    CHECK (chain.IsEmpty ());
+}
+
+TEST (thekogans, BufferCompatibility) {
+    std::string text;
+    for (util::ui32 i = 0; i < 1000; ++i) {
+        text += "the quick brown fox jumps over the lazy dog ";
+    }
+    // DeflateSerializer output inflates with Buffer::Inflate...
+    util::BufferChain chain;
+    {
+        util::DeflateSerializer deflate (chain);
+        deflate.Write (text.data (), text.size ());
+    }
+    CHECK (util::Buffer::Inflate (chain)->Tostring () == text);
+    // ...and Buffer::Deflate output inflates with InflateSerializer.
+    util::Buffer buffer (util::HostEndian, text.data (), text.data () + text.size ());
+    util::Buffer::SharedPtr deflated = buffer.Deflate ();
+    util::InflateSerializer inflate (*deflated);
+    std::string inflated (text.size (), '\0');
+    CHECK_EQUAL (text.size (), inflate.Read (&inflated[0], inflated.size ()));
+    CHECK (inflated == text);
+    CHECK (inflate.IsEndOfStream ());
+}
+
+TEST (thekogans, Flush) {
+    util::BufferChain chain;
+    util::DeflateSerializer deflate (chain);
+    deflate << std::string ("first");
+    deflate.Flush ();
+    // Everything written before Flush can be inflated.
+    util::InflateSerializer inflate (chain);
+    std::string value;
+    inflate >> value;
+    CHECK (value == "first");
+    deflate << std::string ("second");
+    deflate.Finish ();
+    inflate >> value;
+    CHECK (value == "second");
+    CHECK (inflate.IsEndOfStream ());
+    bool threw = false;
+    try {
+        deflate << std::string ("third");
+    }
+    catch (const util::Exception &) {
+        threw = true;
+    }
+    CHECK (threw);
+}
+
+TEST (thekogans, Parallel) {
+    util::JobQueue::SharedPtr jobQueue = CreateJobQueue ();
+    util::DeflateSerializer::Format formats[] = {
+        util::DeflateSerializer::Zlib,
+        util::DeflateSerializer::Gzip,
+        util::DeflateSerializer::Raw
+    };
+    util::InflateSerializer::Format inflateFormats[] = {
+        util::InflateSerializer::Auto,
+        util::InflateSerializer::Auto,
+        util::InflateSerializer::Raw
+    };
+    for (std::size_t i = 0; i < 3; ++i) {
+        util::BufferChain chain;
+        util::ui64 totalIn;
+        {
+            // Small blocks, few in flight, to exercise the pipeline.
+            util::DeflateSerializer deflate (
+                chain,
+                jobQueue,
+                util::LittleEndian,
+                util::DeflateSerializer::DEFAULT_LEVEL,
+                util::DeflateSerializer::DEFAULT_WINDOW_BITS,
+                util::DeflateSerializer::Default,
+                formats[i],
+                4096,
+                4);
+            WriteValues (deflate);
+            deflate.Flush ();
+            deflate << std::string ("flushed");
+            totalIn = deflate.GetTotalIn ();
+        }
+        if (formats[i] == util::DeflateSerializer::Zlib) {
+            // The blocks make up one ordinary zlib stream.
+            CHECK_EQUAL (
+                (std::size_t)totalIn,
+                util::Buffer::Inflate (chain)->GetDataAvailableForReading ());
+        }
+        util::InflateSerializer inflate (
+            chain, util::LittleEndian, inflateFormats[i]);
+        for (util::ui32 j = 0; j < VALUE_COUNT; ++j) {
+            util::ui32 value32;
+            std::string value;
+            inflate >> value32 >> value;
+            if (value32 != j || value != GetString (j)) {
+                CHECK (false);
+                break;
+            }
+        }
+        std::string value;
+        inflate >> value;
+        CHECK (value == "flushed");
+        CHECK (inflate.IsEndOfStream ());
+    }
+}
+
+TEST (thekogans, Corrupt) {
+    util::BufferChain chain;
+    {
+        util::DeflateSerializer deflate (chain);
+        WriteValues (deflate);
+    }
+    // Truncated.
+    util::BufferChain::SharedPtr front =
+        chain.Split (chain.GetDataAvailableForReading () / 2);
+    util::InflateSerializer inflate (*front);
+    bool threw = false;
+    try {
+        ReadValues (inflate);
+    }
+    catch (const util::Exception &) {
+        threw = true;
+    }
+    CHECK (threw);
+}
+
+TESTMAIN
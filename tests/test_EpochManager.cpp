@@ -0,0 +1,182 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <CppUnitXLite/CppUnitXLite.cpp>
+#include "thekogans/util/Types.h"
+#include "thekogans/util/Thread.h"
+#include "thekogans/util/Event.h"
+#include "thekogans/util/EpochManager.h"
+#include "thekogans/util/LockFreeStack.h"
+#include "thekogans/util/LockFreeQueue.h"
+
+using namespace thekogans;
+
+// These tests are meant to be run under ThreadSanitizer
+// (-fsanitize=thread) as well as in regular builds.
+
+namespace {
+    const std::size_t THREAD_COUNT = 8;
+    const std::size_t ITERATIONS = 10000;
+
+    // Counts live instances so that we can tell if
+    // a retired node was leaked or deleted twice.
+    std::atomic<util::i32> liveValues (0);
+
+    struct Value {
+        util::ui32 value;
+
+        Value (util::ui32 value_ = 0) :
+                value (value_) {
+            ++liveValues;
+        }
+        Value (const Value &other) :
+                value (other.value) {
+            ++liveValues;
+        }
+        ~Value () {
+            --liveValues;
+        }
+
+        Value &operator = (const Value &other) {
+            value = other.value;
+            return *this;
+        }
+    };
+
+    inline void Add (
+            util::LockFreeStack<Value> &stack,
+            const Value &value) {
+        stack.Push (value);
+    }
+
+    inline bool Remove (
+            util::LockFreeStack<Value> &stack,
+            Value &value) {
+        return stack.Pop (value);
+    }
+
+    inline void Add (
+            util::LockFreeQueue<Value> &queue,
+            const Value &value) {
+        queue.Enq (value);
+    }
+
+    inline bool Remove (
+            util::LockFreeQueue<Value> &queue,
+            Value &value) {
+        return queue.Deq (value);
+    }
+
+    // Every worker adds ITERATIONS values (0..ITERATIONS - 1)
+    // and removes as many as it can, summing what it got.
+    template<typename Container>
+    struct Worker : public util::Thread {
+        util::Event &start;
+        Container &container;
+        util::ui64 sum;
+        std::size_t count;
+
+        Worker (
+            util::Event &start_,
+            Container &container_) :
+            start (start_),
+            container (container_),
+            sum (0),
+            count (0) {}
+
+        virtual void Run () noexcept override {
+            start.Wait ();
+            for (util::ui32 i = 0; i < ITERATIONS; ++i) {
+                Add (container, Value (i));
+                Value value;
+                if (Remove (container, value)) {
+                    sum += value.value;
+                    ++count;
+                }
+            }
+        }
+    };
+
+    // Returns true if every value added was removed exactly once.
+    template<typename Container>
+    bool Stress () {
+        util::ui64 sum = 0;
+        std::size_t count = 0;
+        {
+            util::Event start;
+            Container container;
+            std::vector<std::unique_ptr<Worker<Container>>> workers;
+            for (std::size_t i = 0; i < THREAD_COUNT; ++i) {
+                workers.emplace_back (new Worker<Container> (start, container));
+                workers.back ()->Create ();
+            }
+            start.Signal ();
+            for (std::size_t i = 0; i < THREAD_COUNT; ++i) {
+                workers[i]->Wait ();
+                sum += workers[i]->sum;
+                count += workers[i]->count;
+            }
+            Value value;
+            while (Remove (container, value)) {
+                sum += value.value;
+                ++count;
+            }
+        }
+        return count == THREAD_COUNT * ITERATIONS &&
+            sum == THREAD_COUNT * (util::ui64)ITERATIONS * (ITERATIONS - 1) / 2;
+    }
+
+    // Every object retired by the (now exited) workers
+    // is safe to delete after two epoch advances.
+    void ReclaimAll () {
+        for (std::size_t i = 0; i < 3; ++i) {
+            util::EpochManager::Instance ()->Reclaim ();
+        }
+    }
+}
+
+TEST (thekogans, LockFreeStack) {
+    CHECK (Stress<util::LockFreeStack<Value>> ());
+    ReclaimAll ();
+    CHECK_EQUAL (0, liveValues.load ());
+}
+
+TEST (thekogans, LockFreeQueue) {
+    CHECK (Stress<util::LockFreeQueue<Value>> ());
+    ReclaimAll ();
+    CHECK_EQUAL (0, liveValues.load ());
+}
+
+TEST (thekogans, EpochManagerNestedGuards) {
+    util::EpochManager &epochManager = *util::EpochManager::Instance ();
+    {
+        util::EpochManager::Guard outer;
+        util::EpochManager::Guard inner;
+        util::ui64 epoch = epochManager.GetEpoch ();
+        // We're in the current epoch, so it can advance once...
+        epochManager.TryAdvance ();
+        // ...but not again until we leave.
+        CHECK (!epochManager.TryAdvance ());
+        CHECK_EQUAL (epoch + 1, epochManager.GetEpoch ());
+    }
+    CHECK (epochManager.TryAdvance ());
+}
+
+TESTMAIN
@@ -0,0 +1,117 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#include <atomic>
+#include <CppUnitXLite/CppUnitXLite.cpp>
+#include "thekogans/util/Types.h"
+#include "thekogans/util/TimeSpec.h"
+#include "thekogans/util/HRTimer.h"
+#include "thekogans/util/Thread.h"
+#include "thekogans/util/os/linux/EpollRunLoop.h"
+
+using namespace thekogans;
+
+namespace {
+    // Serves an EpollRunLoop on its own thread.
+    struct EpollThread : public util::Thread {
+        util::os::linux::EpollRunLoop &runLoop;
+
+        explicit EpollThread (util::os::linux::EpollRunLoop &runLoop_) :
+                Thread ("EpollThread"),
+                runLoop (runLoop_) {
+            Create (THEKOGANS_UTIL_NORMAL_THREAD_PRIORITY);
+        }
+
+        virtual void Run () noexcept override {
+            runLoop.Start ();
+        }
+    };
+
+    util::RunLoop::LambdaJob::Function Count (std::atomic<util::ui32> &count) {
+        return
+            [&count] (const util::RunLoop::LambdaJob & /*job*/,
+                    const std::atomic<bool> & /*done*/) {
+                ++count;
+            };
+    }
+}
+
+TEST (thekogans, PauseContinue) {
+    util::os::linux::EpollRunLoop runLoop ("PauseContinue");
+    EpollThread thread (runLoop);
+    std::atomic<util::ui32> count (0);
+    CHECK (runLoop.EnqJob (Count (count), true).second);
+    CHECK_EQUAL (1u, count.load ());
+    runLoop.Pause ();
+    runLoop.EnqJob (Count (count));
+    util::Sleep (util::TimeSpec::FromMilliseconds (50));
+    CHECK_EQUAL (1u, count.load ());
+    // Continue has to wake up the loop blocked in epoll_wait.
+    runLoop.Continue ();
+    CHECK (runLoop.WaitForIdle (util::TimeSpec::FromSeconds (1)));
+    CHECK_EQUAL (2u, count.load ());
+    runLoop.Stop ();
+    thread.Wait ();
+}
+
+TEST (thekogans, RateLimited) {
+    // 20 jobs per second, one at a time.
+    util::os::linux::EpollRunLoop runLoop (
+        "RateLimited",
+        new util::RunLoop::RateLimitedJobExecutionPolicy (
+            new util::RunLoop::FIFOJobExecutionPolicy, 20.0, 1));
+    EpollThread thread (runLoop);
+    std::atomic<util::ui32> count (0);
+    util::ui64 start = util::HRTimer::Click ();
+    for (std::size_t i = 0; i < 5; ++i) {
+        runLoop.EnqJob (Count (count));
+    }
+    // Throttled jobs have to run without any further wake ups.
+    CHECK (runLoop.WaitForIdle (util::TimeSpec::FromSeconds (2)));
+    util::f64 seconds = util::HRTimer::ToSeconds (
+        util::HRTimer::ComputeElapsedTime (start, util::HRTimer::Click ()));
+    CHECK_EQUAL (5u, count.load ());
+    // The first one goes right away, the remaining 4 take 50ms each.
+    CHECK (seconds >= 0.18);
+    runLoop.Stop ();
+    thread.Wait ();
+}
+
+TEST (thekogans, StopDropsScheduledJobs) {
+    util::os::linux::EpollRunLoop runLoop ("StopDropsScheduledJobs");
+    std::atomic<util::ui32> count (0);
+    std::atomic<util::ui32> started (0);
+    {
+        EpollThread thread (runLoop);
+        // Make sure the loop is running before stopping it.
+        CHECK (runLoop.EnqJob (Count (started), true).second);
+        runLoop.ScheduleJob (Count (count), util::TimeSpec::FromMilliseconds (100));
+        runLoop.Stop ();
+        thread.Wait ();
+    }
+    // A restarted run loop must not run the previous run's timers.
+    EpollThread thread (runLoop);
+    while (!runLoop.IsRunning ()) {
+        util::Sleep (util::TimeSpec::FromMilliseconds (1));
+    }
+    util::Sleep (util::TimeSpec::FromMilliseconds (200));
+    CHECK_EQUAL (0u, count.load ());
+    runLoop.Stop ();
+    thread.Wait ();
+}
+
+TESTMAIN
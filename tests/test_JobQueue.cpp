@@ -0,0 +1,133 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#include <CppUnitXLite/CppUnitXLite.cpp>
+#include "thekogans/util/Types.h"
+#include "thekogans/util/TimeSpec.h"
+#include "thekogans/util/Event.h"
+#include "thekogans/util/HRTimer.h"
+#include "thekogans/util/JobQueue.h"
+#include "thekogans/util/JobQueuePool.h"
+
+using namespace thekogans;
+
+namespace {
+    const std::size_t MAX_WORKERS = 4;
+    const std::size_t JOB_COUNT = 20;
+
+    // Wait for the idle workers to time out and retire.
+    bool WaitForWorkerCount (
+            util::JobQueue &jobQueue,
+            std::size_t workerCount) {
+        for (std::size_t i = 0; i < 100; ++i) {
+            if (jobQueue.GetWorkerStats ().workerCount == workerCount) {
+                return true;
+            }
+            util::Sleep (util::TimeSpec::FromMilliseconds (20));
+        }
+        return false;
+    }
+}
+
+TEST (thekogans, ElasticJobQueue) {
+    util::JobQueue jobQueue (
+        "ElasticJobQueue",
+        new util::RunLoop::FIFOJobExecutionPolicy,
+        1,
+        THEKOGANS_UTIL_NORMAL_THREAD_PRIORITY,
+        THEKOGANS_UTIL_MAX_THREAD_AFFINITY,
+        nullptr,
+        util::JobQueue::ElasticPolicy (
+            1,
+            MAX_WORKERS,
+            2,
+            util::TimeSpec::Infinite,
+            util::TimeSpec::FromMilliseconds (50)));
+    CHECK_EQUAL ((std::size_t)1, jobQueue.GetWorkerStats ().workerCount);
+    // Block the workers so that the queue backs up.
+    util::Event gate;
+    for (std::size_t i = 0; i < JOB_COUNT; ++i) {
+        jobQueue.EnqJob (
+            [&gate] (const util::RunLoop::LambdaJob & /*job*/,
+                    const std::atomic<bool> & /*done*/) {
+                gate.Wait ();
+            }
+        );
+    }
+    util::JobQueue::WorkerStats stats = jobQueue.GetWorkerStats ();
+    CHECK_EQUAL (MAX_WORKERS, stats.workerCount);
+    CHECK_EQUAL (MAX_WORKERS, stats.peakWorkerCount);
+    CHECK_EQUAL (MAX_WORKERS - 1, stats.grownOnDepth);
+    CHECK (stats.capped > 0);
+    gate.Signal ();
+    CHECK (jobQueue.WaitForIdle ());
+    CHECK_EQUAL (JOB_COUNT, (std::size_t)jobQueue.GetStats ().totalJobs);
+    // Never retire below minWorkers.
+    CHECK (WaitForWorkerCount (jobQueue, 1));
+    util::Sleep (util::TimeSpec::FromMilliseconds (200));
+    stats = jobQueue.GetWorkerStats ();
+    CHECK_EQUAL ((std::size_t)1, stats.workerCount);
+    CHECK_EQUAL (MAX_WORKERS - 1, stats.retired);
+    // The queue still works after shrinking.
+    CHECK (jobQueue.EnqJob (
+        [] (const util::RunLoop::LambdaJob & /*job*/,
+            const std::atomic<bool> & /*done*/) {}, true).second);
+}
+
+TEST (thekogans, JobQueuePoolExhausted) {
+    util::JobQueuePool jobQueuePool (1, 2);
+    util::JobQueue::SharedPtr jobQueue1 = jobQueuePool.GetJobQueue (0);
+    util::JobQueue::SharedPtr jobQueue2 = jobQueuePool.GetJobQueue (0);
+    CHECK (jobQueue1 != nullptr);
+    CHECK (jobQueue2 != nullptr);
+    CHECK (jobQueuePool.GetJobQueue (1, util::TimeSpec::FromMilliseconds (10)) == nullptr);
+    util::JobQueuePool::Stats stats = jobQueuePool.GetStats ();
+    CHECK_EQUAL ((std::size_t)2, stats.jobQueueCount);
+    CHECK_EQUAL ((std::size_t)2, stats.created);
+    CHECK_EQUAL ((std::size_t)1, stats.exhausted);
+    jobQueue1.Reset ();
+    jobQueue2.Reset ();
+    CHECK (jobQueuePool.WaitForIdle ());
+    stats = jobQueuePool.GetStats ();
+    CHECK_EQUAL ((std::size_t)1, stats.jobQueueCount);
+    CHECK_EQUAL ((std::size_t)1, stats.retired);
+}
+
+TEST (thekogans, RateLimitedJobQueue) {
+    // 50 jobs per second in bursts of up to 5.
+    util::JobQueue jobQueue (
+        "RateLimitedJobQueue",
+        new util::RunLoop::RateLimitedJobExecutionPolicy (
+            new util::RunLoop::FIFOJobExecutionPolicy, 50.0, 5),
+        2);
+    util::ui64 start = util::HRTimer::Click ();
+    for (std::size_t i = 0; i < JOB_COUNT; ++i) {
+        jobQueue.EnqJob (
+            [] (const util::RunLoop::LambdaJob & /*job*/,
+                const std::atomic<bool> & /*done*/) {}
+        );
+    }
+    CHECK (jobQueue.WaitForIdle ());
+    util::f64 seconds = util::HRTimer::ToSeconds (
+        util::HRTimer::ComputeElapsedTime (start, util::HRTimer::Click ()));
+    CHECK_EQUAL (JOB_COUNT, (std::size_t)jobQueue.GetStats ().totalJobs);
+    // The first 5 go right away, the remaining 15 take 20ms each.
+    CHECK (seconds >= 0.28);
+    CHECK (seconds < 2.0);
+}
+
+TESTMAIN
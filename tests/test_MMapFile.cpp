@@ -0,0 +1,204 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <CppUnitXLite/CppUnitXLite.cpp>
+#include "thekogans/util/Types.h"
+#include "thekogans/util/Path.h"
+#include "thekogans/util/File.h"
+#include "thekogans/util/Buffer.h"
+#include "thekogans/util/MMapFile.h"
+
+using namespace thekogans;
+
+namespace {
+    const util::ui32 VALUE_COUNT = 1000;
+
+    std::string GetTestPath () {
+        return util::MakePath (
+            util::Path::GetTempDirectory (), "test_MMapFile.bin");
+    }
+
+    struct TestPath {
+        ~TestPath () {
+            if (util::Path (GetTestPath ()).Exists ()) {
+                util::File::Delete (GetTestPath ());
+            }
+        }
+    };
+
+    std::string GetString (util::ui32 i) {
+        return std::string (i % 7, 'a' + i % 26);
+    }
+}
+
+TEST (thekogans, RoundTrip) {
+    TestPath testPath;
+    {
+        // Start small to force several remaps.
+        util::MMapFile file (
+            util::NetworkEndian, GetTestPath (), util::MMapFile::ReadWrite, 64);
+        for (util::ui32 i = 0; i < VALUE_COUNT; ++i) {
+            file << i << (util::ui64)i * i << GetString (i);
+        }
+        CHECK (file.GetCapacity () >= file.GetSize ());
+        CHECK_EQUAL ((util::ui64)file.Tell (), file.GetSize ());
+        file.Flush ();
+    }
+    // Close trims the file to its logical size.
+    util::ui64 size;
+    {
+        util::SimpleFile file (util::HostEndian, GetTestPath (), util::SimpleFile::ReadOnly);
+        size = file.GetSize ();
+    }
+    util::MMapFile file (util::NetworkEndian, GetTestPath ());
+    CHECK_EQUAL (size, file.GetSize ());
+    CHECK_EQUAL (size, file.GetCapacity ());
+    file.Advise (util::MMapFile::Sequential);
+    for (util::ui32 i = 0; i < VALUE_COUNT; ++i) {
+        util::ui32 value32;
+        util::ui64 value64;
+        std::string value;
+        file >> value32 >> value64 >> value;
+        CHECK_EQUAL (i, value32);
+        CHECK_EQUAL ((util::ui64)i * i, value64);
+        CHECK (value == GetString (i));
+    }
+    util::ui8 byte;
+    CHECK_EQUAL ((std::size_t)0, file.Read (&byte, 1));
+    // Read only mappings can't be written.
+    bool threw = false;
+    try {
+        file << (util::ui32)0;
+    }
+    catch (const util::Exception &) {
+        threw = true;
+    }
+    CHECK (threw);
+}
+
+TEST (thekogans, Growth) {
+    TestPath testPath;
+    const util::ui64 CAPACITY = 64;
+    util::MMapFile file (
+        util::NetworkEndian, GetTestPath (), util::MMapFile::ReadWrite, CAPACITY);
+    // Filling the mapping exactly doesn't remap.
+    for (util::ui32 i = 0; i < CAPACITY / 4 - 1; ++i) {
+        file << i;
+    }
+    const util::ui8 *data = file.GetView ().data;
+    file << (util::ui32)0xdeadbeef;
+    CHECK_EQUAL (CAPACITY, file.GetSize ());
+    CHECK_EQUAL (CAPACITY, file.GetCapacity ());
+    CHECK (file.GetView ().data == data);
+    // One more byte does (by at least MIN_GROWTH).
+    file << (util::ui8)0x01;
+    CHECK_EQUAL (CAPACITY + 1, file.GetSize ());
+    CHECK (file.GetCapacity () >= util::MMapFile::MIN_GROWTH);
+    // So does a value straddling the end of the mapping (by doubling it).
+    util::ui64 capacity = file.GetCapacity ();
+    file.Seek (capacity - 4, SEEK_SET);
+    file << (util::ui64)0x0203040506070809;
+    CHECK_EQUAL (capacity + 4, file.GetSize ());
+    CHECK (file.GetCapacity () >= capacity * 2);
+    // Everything written before the remaps survived them.
+    file.Seek (0, SEEK_SET);
+    for (util::ui32 i = 0; i < CAPACITY / 4 - 1; ++i) {
+        util::ui32 value;
+        file >> value;
+        CHECK_EQUAL (i, value);
+    }
+    util::ui32 value32;
+    util::ui8 value8;
+    file >> value32 >> value8;
+    CHECK_EQUAL ((util::ui32)0xdeadbeef, value32);
+    CHECK_EQUAL ((util::ui8)0x01, value8);
+    file.Seek (capacity - 4, SEEK_SET);
+    util::ui64 value64;
+    file >> value64;
+    CHECK_EQUAL ((util::ui64)0x0203040506070809, value64);
+}
+
+TEST (thekogans, Borrow) {
+    TestPath testPath;
+    {
+        util::MMapFile file (util::HostEndian, GetTestPath (), util::MMapFile::ReadWrite);
+        file << std::string ("borrowed") << (util::ui32)0x01020304;
+    }
+    util::MMapFile file (util::HostEndian, GetTestPath ());
+    file.borrow = true;
+    CHECK (file.IsBorrowing ());
+    std::string_view value;
+    file >> value;
+    CHECK (value == "borrowed");
+    // The view points straight in to the mapping.
+    util::ByteView view = file.GetView ();
+    CHECK ((const util::ui8 *)value.data () >= view.begin () &&
+        (const util::ui8 *)value.data () + value.size () <= view.end ());
+    // A TenantReadBuffer can wrap (part of) the mapping.
+    util::TenantReadBuffer buffer (util::HostEndian, view, file.Tell ());
+    util::ui32 value32;
+    buffer >> value32;
+    CHECK_EQUAL ((util::ui32)0x01020304, value32);
+    CHECK_EQUAL ((std::size_t)0, buffer.GetDataAvailableForReading ());
+}
+
+TEST (thekogans, SeekTell) {
+    TestPath testPath;
+    util::MMapFile file (util::HostEndian, GetTestPath (), util::MMapFile::ReadWrite);
+    for (util::ui32 i = 0; i < VALUE_COUNT; ++i) {
+        file << i;
+        CHECK_EQUAL ((util::i64)(i + 1) * 4, file.Tell ());
+    }
+    CHECK_EQUAL ((util::ui64)VALUE_COUNT * 4, file.GetSize ());
+    file.Seek (0, SEEK_SET);
+    file << (util::ui32)0xdeadbeef;
+    CHECK_EQUAL ((util::ui64)VALUE_COUNT * 4, file.GetSize ());
+    util::ui32 value;
+    file >> value;
+    CHECK_EQUAL ((util::ui32)1, value);
+    file.Seek (-8, SEEK_CUR);
+    file >> value;
+    CHECK_EQUAL ((util::ui32)0xdeadbeef, value);
+    file.Seek (-4, SEEK_END);
+    file >> value;
+    CHECK_EQUAL (VALUE_COUNT - 1, value);
+    // Seeking past the end leaves a zero filled gap.
+    file.Seek (4, SEEK_END);
+    file << (util::ui32)0xcafebabe;
+    CHECK_EQUAL ((util::ui64)VALUE_COUNT * 4 + 8, file.GetSize ());
+    file.Seek (VALUE_COUNT * 4, SEEK_SET);
+    file >> value;
+    CHECK_EQUAL ((util::ui32)0, value);
+    file >> value;
+    CHECK_EQUAL ((util::ui32)0xcafebabe, value);
+    util::ByteView view = file.GetView (4, 4);
+    CHECK_EQUAL ((util::ui32)1, *(const util::ui32 *)view.data);
+    bool threw = false;
+    try {
+        file.Seek (-1, SEEK_SET);
+    }
+    catch (const util::Exception &) {
+        threw = true;
+    }
+    CHECK (threw);
+}
+
+TESTMAIN
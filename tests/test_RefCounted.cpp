@@ -17,9 +17,15 @@
 
 #include <cstdlib>
 #include <string>
+#include <atomic>
+#include <memory>
+#include <vector>
 #include <CppUnitXLite/CppUnitXLite.cpp>
 #include "thekogans/util/Types.h"
 #include "thekogans/util/RefCounted.h"
+#include "thekogans/util/Thread.h"
+#include "thekogans/util/Event.h"
+#include "thekogans/util/StdAllocator.h"
 
 using namespace thekogans;
 
@@ -59,4 +65,100 @@ TEST (thekogans, test_RefCounted_SharedPtr) {
 TEST (thekogans, test_RefCounted_WeakPtr) {
 }
 
+namespace {
+    struct ShardedTest : public util::RefCounted {
+        THEKOGANS_UTIL_DECLARE_REF_COUNTED_POINTERS (ShardedTest)
+
+        static std::atomic<util::ui32> destroyed;
+
+    protected:
+        virtual void Harakiri () override {
+            ++destroyed;
+            delete this;
+        }
+    };
+
+    std::atomic<util::ui32> ShardedTest::destroyed (0);
+
+    // Copies the shared pointer a lot, and leaves one copy
+    // behind in handoff to be released by another thread.
+    struct Copier : public util::Thread {
+        util::Event &start;
+        ShardedTest::SharedPtr object;
+        ShardedTest::SharedPtr handoff;
+
+        Copier (
+            util::Event &start_,
+            ShardedTest::SharedPtr object_) :
+            start (start_),
+            object (object_) {}
+
+        virtual void Run () noexcept override {
+            start.Wait ();
+            for (std::size_t i = 0; i < 100000; ++i) {
+                ShardedTest::SharedPtr copy (object);
+                ShardedTest::WeakPtr weak (copy);
+                ShardedTest::SharedPtr locked = weak.GetSharedPtr ();
+                if (locked == nullptr) {
+                    return;
+                }
+            }
+            handoff = object;
+            object.Reset ();
+        }
+    };
+}
+
+TEST (thekogans, test_RefCounted_Sharded) {
+    const std::size_t THREAD_COUNT = 4;
+    ShardedTest::WeakPtr weak;
+    {
+        util::Event start;
+        ShardedTest::SharedPtr object (new ShardedTest);
+        weak = object;
+        CHECK (object->EnableShardedRefCount ());
+        CHECK (!object->EnableShardedRefCount ());
+        // The object holds a reference on itself while sharded.
+        CHECK_EQUAL ((util::ui32)2, object->GetRefCount ());
+        std::vector<std::unique_ptr<Copier>> copiers;
+        for (std::size_t i = 0; i < THREAD_COUNT; ++i) {
+            copiers.emplace_back (new Copier (start, object));
+            copiers.back ()->Create ();
+        }
+        start.Signal ();
+        for (std::size_t i = 0; i < copiers.size (); ++i) {
+            copiers[i]->Wait ();
+        }
+        CHECK_EQUAL ((util::ui32)(THREAD_COUNT + 2), object->GetRefCount ());
+        // Release the handoff references on this thread.
+        for (std::size_t i = 0; i < copiers.size (); ++i) {
+            copiers[i]->handoff.Reset ();
+        }
+        CHECK_EQUAL ((util::ui32)2, object->GetRefCount ());
+        object.Reset ();
+        // Still sharded, so still alive.
+        CHECK_EQUAL ((util::ui32)0, ShardedTest::destroyed.load ());
+        CHECK (!weak.IsExpired ());
+        object = weak.GetSharedPtr ();
+        CHECK (object != nullptr);
+        object->DisableShardedRefCount ();
+        CHECK_EQUAL ((util::ui32)1, object->GetRefCount ());
+        CHECK_EQUAL ((util::ui32)0, ShardedTest::destroyed.load ());
+    }
+    CHECK_EQUAL ((util::ui32)1, ShardedTest::destroyed.load ());
+    CHECK (weak.IsExpired ());
+}
+
+TEST (thekogans, test_RefCounted_ShardedSingleton) {
+    // Only the singleton instance is sharded.
+    CHECK (!util::StdAllocator::Instance ()->EnableShardedRefCount ());
+    util::StdAllocator::WeakPtr weak;
+    {
+        util::StdAllocator::SharedPtr allocator (new util::StdAllocator);
+        weak = allocator;
+        CHECK_EQUAL ((util::ui32)1, allocator->GetRefCount ());
+    }
+    CHECK (weak.IsExpired ());
+}
+
 TESTMAIN
@@ -0,0 +1,161 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <CppUnitXLite/CppUnitXLite.cpp>
+#include "thekogans/util/Types.h"
+#include "thekogans/util/RefCounted.h"
+#include "thekogans/util/RefCountedRegistry.h"
+#include "thekogans/util/Thread.h"
+#include "thekogans/util/Event.h"
+
+using namespace thekogans;
+
+namespace {
+    struct Object : public util::RefCounted {
+        THEKOGANS_UTIL_DECLARE_REF_COUNTED_POINTERS (Object)
+    };
+
+    using ObjectRegistry = util::RefCountedRegistry<Object>;
+
+    struct Registered;
+    using RegisteredRegistry = util::RefCountedRegistry<Registered>;
+
+    struct Registered : public util::RefCounted {
+        THEKOGANS_UTIL_DECLARE_REF_COUNTED_POINTERS (Registered)
+
+        const RegisteredRegistry::Token token;
+
+        Registered () :
+            token (this) {}
+    };
+
+    const std::size_t THREAD_COUNT = 4;
+    const std::size_t SLOT_COUNT = 64;
+    const std::size_t ITERATIONS = 20000;
+
+    // Creates (and thereby registers) objects, publishes their tokens
+    // and resolves tokens published by the others. Every object resolved
+    // must be the one its token was minted for.
+    struct Churner : public util::Thread {
+        util::Event &start;
+        std::atomic<util::ui64> *slots;
+        std::size_t thread;
+        bool broken;
+
+        Churner (
+            util::Event &start_,
+            std::atomic<util::ui64> *slots_,
+            std::size_t thread_) :
+            start (start_),
+            slots (slots_),
+            thread (thread_),
+            broken (false) {}
+
+        virtual void Run () noexcept override {
+            start.Wait ();
+            std::vector<Registered::SharedPtr> objects;
+            for (std::size_t i = 0; i < ITERATIONS; ++i) {
+                std::size_t slot = (i * 7 + thread * 13) % SLOT_COUNT;
+                if (i % 4 == 0) {
+                    Registered::SharedPtr object (new Registered);
+                    slots[slot].store (object->token.GetValue ());
+                    objects.push_back (object);
+                    if (objects.size () > 8) {
+                        objects.erase (objects.begin ());
+                    }
+                }
+                else {
+                    util::ui64 value = slots[slot].load ();
+                    Registered::SharedPtr object = RegisteredRegistry::Instance ()->Get (value);
+                    if (object != nullptr && object->token.GetValue () != value) {
+                        broken = true;
+                    }
+                }
+            }
+        }
+    };
+}
+
+TEST (thekogans, RefCountedRegistry) {
+    // Start small to exercise growth.
+    ObjectRegistry registry (2);
+    std::vector<Object::SharedPtr> objects;
+    std::vector<ObjectRegistry::Token::ValueType> tokens;
+    for (std::size_t i = 0; i < 10; ++i) {
+        objects.push_back (Object::SharedPtr (new Object));
+        tokens.push_back (registry.Add (objects.back ().Get ()));
+    }
+    for (std::size_t i = 0; i < objects.size (); ++i) {
+        CHECK_EQUAL (i, (std::size_t)ObjectRegistry::Token::GetIndex (tokens[i]));
+        CHECK (registry.Get (tokens[i]).Get () == objects[i].Get ());
+    }
+    CHECK (registry.Add (nullptr) == ObjectRegistry::INVALID_TOKEN);
+    CHECK (registry.Get (ObjectRegistry::INVALID_TOKEN) == nullptr);
+    registry.Remove (tokens[3]);
+    CHECK (registry.Get (tokens[3]) == nullptr);
+    // Double Remove is harmless.
+    registry.Remove (tokens[3]);
+    // The freed entry is reused with a new counter...
+    Object::SharedPtr object (new Object);
+    ObjectRegistry::Token::ValueType token = registry.Add (object.Get ());
+    CHECK_EQUAL (
+        ObjectRegistry::Token::GetIndex (tokens[3]),
+        ObjectRegistry::Token::GetIndex (token));
+    CHECK (ObjectRegistry::Token::GetCounter (tokens[3]) !=
+        ObjectRegistry::Token::GetCounter (token));
+    CHECK (registry.Get (token).Get () == object.Get ());
+    // ...so the stale token doesn't get the new object.
+    CHECK (registry.Get (tokens[3]) == nullptr);
+    // Only a registered WeakPtr is held, so deleted
+    // objects can't be resurrected.
+    objects[5].Reset ();
+    CHECK (registry.Get (tokens[5]) == nullptr);
+    registry.Remove (tokens[5]);
+    CHECK_EQUAL (
+        ObjectRegistry::Token::GetIndex (tokens[5]),
+        ObjectRegistry::Token::GetIndex (registry.Add (object.Get ())));
+    // Nothing on the free stack, grow.
+    CHECK_EQUAL (10u, (util::ui32)ObjectRegistry::Token::GetIndex (registry.Add (object.Get ())));
+}
+
+TEST (thekogans, RefCountedRegistry_Concurrent) {
+    util::Event start;
+    std::atomic<util::ui64> slots[SLOT_COUNT];
+    for (std::size_t i = 0; i < SLOT_COUNT; ++i) {
+        slots[i].store (RegisteredRegistry::INVALID_TOKEN);
+    }
+    std::vector<std::unique_ptr<Churner>> churners;
+    for (std::size_t i = 0; i < THREAD_COUNT; ++i) {
+        churners.emplace_back (new Churner (start, slots, i));
+        churners.back ()->Create ();
+    }
+    start.Signal ();
+    for (std::size_t i = 0; i < churners.size (); ++i) {
+        churners[i]->Wait ();
+        CHECK (!churners[i]->broken);
+    }
+    // All objects are gone, and so are their registrations.
+    for (std::size_t i = 0; i < SLOT_COUNT; ++i) {
+        CHECK (RegisteredRegistry::Instance ()->Get (slots[i].load ()) == nullptr);
+    }
+}
+
+TESTMAIN
@@ -0,0 +1,219 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+#include <memory>
+#include <vector>
+#include <CppUnitXLite/CppUnitXLite.cpp>
+#include "thekogans/util/Types.h"
+#include "thekogans/util/Thread.h"
+#include "thekogans/util/Event.h"
+#include "thekogans/util/SPSCRingQueue.h"
+#include "thekogans/util/MPSCRingQueue.h"
+#include "thekogans/util/IntrusiveMPSCQueue.h"
+#include "thekogans/util/BlockingRingQueue.h"
+
+using namespace thekogans;
+
+namespace {
+    const std::size_t PRODUCER_COUNT = 4;
+    const std::size_t ITERATIONS = 20000;
+
+    // High 32 bits: producer, low 32 bits: sequence (starting at 1).
+    inline util::ui64 MakeValue (
+            std::size_t producer,
+            std::size_t sequence) {
+        return ((util::ui64)producer << 32) | (util::ui64)sequence;
+    }
+
+    struct Producer : public util::Thread {
+        util::Event &start;
+        util::BlockingRingQueue<util::MPSCRingQueue<util::ui64>> &queue;
+        std::size_t producer;
+
+        Producer (
+            util::Event &start_,
+            util::BlockingRingQueue<util::MPSCRingQueue<util::ui64>> &queue_,
+            std::size_t producer_) :
+            start (start_),
+            queue (queue_),
+            producer (producer_) {}
+
+        virtual void Run () noexcept override {
+            start.Wait ();
+            // Alternate single and batch pushes to exercise both paths.
+            for (std::size_t sequence = 1; sequence <= ITERATIONS;) {
+                if (sequence % 2 == 0) {
+                    util::ui64 values[3];
+                    std::size_t count = 0;
+                    for (; count < 3 && sequence + count <= ITERATIONS; ++count) {
+                        values[count] = MakeValue (producer, sequence + count);
+                    }
+                    for (std::size_t pushed = 0; pushed < count;) {
+                        pushed += queue.PushBatch (values + pushed, count - pushed);
+                    }
+                    sequence += count;
+                }
+                else {
+                    queue.Push (MakeValue (producer, sequence++));
+                }
+            }
+        }
+    };
+
+    struct Node;
+    using NodeQueue = util::IntrusiveMPSCQueue<Node>;
+
+    struct Node : public NodeQueue::Node {
+        std::size_t producer;
+        std::size_t sequence;
+    };
+
+    struct NodeProducer : public util::Thread {
+        util::Event &start;
+        NodeQueue &queue;
+        std::vector<Node> &nodes;
+        std::size_t producer;
+
+        NodeProducer (
+            util::Event &start_,
+            NodeQueue &queue_,
+            std::vector<Node> &nodes_,
+            std::size_t producer_) :
+            start (start_),
+            queue (queue_),
+            nodes (nodes_),
+            producer (producer_) {}
+
+        virtual void Run () noexcept override {
+            start.Wait ();
+            for (std::size_t sequence = 1; sequence <= ITERATIONS; ++sequence) {
+                Node &node = nodes[producer * ITERATIONS + sequence - 1];
+                node.producer = producer;
+                node.sequence = sequence;
+                queue.Push (&node);
+            }
+        }
+    };
+}
+
+TEST (thekogans, SPSCRingQueue) {
+    util::SPSCRingQueue<util::ui32> queue (5);
+    CHECK_EQUAL ((std::size_t)8, queue.GetCapacity ());
+    util::ui32 values[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+    util::ui32 popped[8];
+    // Go around the ring a few times.
+    for (util::ui32 i = 0; i < 4; ++i) {
+        CHECK_EQUAL ((std::size_t)6, queue.PushBatch (values, 6));
+        CHECK (queue.Push (9));
+        CHECK (queue.Push (10));
+        CHECK (!queue.Push (11));
+        CHECK_EQUAL ((std::size_t)0, queue.PushBatch (values, 1));
+        CHECK_EQUAL ((std::size_t)8, queue.GetSize ());
+        CHECK_EQUAL ((std::size_t)5, queue.PopBatch (popped, 5));
+        CHECK_EQUAL ((util::ui32)5, popped[4]);
+        CHECK_EQUAL ((std::size_t)3, queue.PopBatch (popped, 8));
+        CHECK_EQUAL ((util::ui32)6, popped[0]);
+        CHECK_EQUAL ((util::ui32)10, popped[2]);
+        CHECK (queue.IsEmpty ());
+        CHECK (!queue.Pop (popped[0]));
+    }
+}
+
+TEST (thekogans, MPSCRingQueue) {
+    util::MPSCRingQueue<util::ui32> queue (4);
+    util::ui32 values[4] = {1, 2, 3, 4};
+    util::ui32 popped[4];
+    for (util::ui32 i = 0; i < 4; ++i) {
+        CHECK (queue.Push (values[0]));
+        CHECK (queue.Push (values[1]));
+        // Only 2 slots left, so the batch is halved (to 1).
+        CHECK_EQUAL ((std::size_t)1, queue.PushBatch (values + 2, 3));
+        CHECK_EQUAL ((std::size_t)1, queue.PushBatch (values + 3, 1));
+        CHECK (!queue.Push (values[0]));
+        CHECK_EQUAL ((std::size_t)4, queue.PopBatch (popped, 4));
+        CHECK_EQUAL ((util::ui32)4, popped[3]);
+        CHECK (queue.IsEmpty ());
+    }
+}
+
+TEST (thekogans, BlockingMPSCRingQueue) {
+    util::Event start;
+    // Small capacity so that both sides park.
+    util::BlockingRingQueue<util::MPSCRingQueue<util::ui64>> queue (8, 4);
+    std::vector<std::unique_ptr<Producer>> producers;
+    for (std::size_t i = 0; i < PRODUCER_COUNT; ++i) {
+        producers.emplace_back (new Producer (start, queue, i));
+        producers.back ()->Create ();
+    }
+    start.Signal ();
+    std::vector<std::size_t> last (PRODUCER_COUNT, 0);
+    bool ordered = true;
+    for (std::size_t i = 0; i < PRODUCER_COUNT * ITERATIONS; ++i) {
+        util::ui64 value;
+        queue.Pop (value);
+        std::size_t producer = (std::size_t)(value >> 32);
+        std::size_t sequence = (std::size_t)(value & 0xffffffff);
+        // Each producer's values must arrive in order.
+        if (producer >= PRODUCER_COUNT || sequence != last[producer] + 1) {
+            ordered = false;
+            break;
+        }
+        last[producer] = sequence;
+    }
+    for (std::size_t i = 0; i < producers.size (); ++i) {
+        producers[i]->Wait ();
+    }
+    CHECK (ordered);
+    util::ui64 value;
+    CHECK (!queue.Pop (value, util::TimeSpec::FromMilliseconds (1)));
+}
+
+TEST (thekogans, IntrusiveMPSCQueue) {
+    util::Event start;
+    NodeQueue queue;
+    CHECK (queue.IsEmpty ());
+    CHECK (queue.Pop () == nullptr);
+    std::vector<Node> nodes (PRODUCER_COUNT * ITERATIONS);
+    std::vector<std::unique_ptr<NodeProducer>> producers;
+    for (std::size_t i = 0; i < PRODUCER_COUNT; ++i) {
+        producers.emplace_back (new NodeProducer (start, queue, nodes, i));
+        producers.back ()->Create ();
+    }
+    start.Signal ();
+    std::vector<std::size_t> last (PRODUCER_COUNT, 0);
+    bool ordered = true;
+    for (std::size_t i = 0; i < PRODUCER_COUNT * ITERATIONS;) {
+        Node *node = queue.Pop ();
+        if (node == nullptr) {
+            util::Thread::YieldSlice ();
+            continue;
+        }
+        if (node->sequence != last[node->producer] + 1) {
+            ordered = false;
+        }
+        last[node->producer] = node->sequence;
+        ++i;
+    }
+    for (std::size_t i = 0; i < producers.size (); ++i) {
+        producers[i]->Wait ();
+    }
+    CHECK (ordered);
+    CHECK (queue.IsEmpty ());
+    CHECK (queue.Pop () == nullptr);
+}
+
+TESTMAIN
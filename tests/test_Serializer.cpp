@@ -0,0 +1,608 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of libthekogans_util.
+//
+// libthekogans_util is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libthekogans_util is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libthekogans_util. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include <CppUnitXLite/CppUnitXLite.cpp>
+#include "thekogans/util/Types.h"
+#include "thekogans/util/Buffer.h"
+#include "thekogans/util/BufferedSerializer.h"
+#include "thekogans/util/SizeT.h"
+#include "thekogans/util/ByteSwap.h"
+#include "thekogans/util/Fraction.h"
+#include "thekogans/util/TimeSpec.h"
+#include "thekogans/util/Rectangle.h"
+#include "thekogans/util/RunLoop.h"
+#include "thekogans/util/Serializable.h"
+#include "thekogans/util/SerializableHeader.h"
+#include "thekogans/util/SerializableFields.h"
+#include "thekogans/util/XMLUtils.h"
+
+using namespace thekogans;
+
+namespace {
+    template<typename T>
+    bool RoundTrip (T value) {
+        util::Buffer buffer (util::NetworkEndian, 16);
+        buffer.compact = true;
+        buffer << value;
+        T result;
+        buffer >> result;
+        return result == value && buffer.GetDataAvailableForReading () == 0;
+    }
+
+    template<typename T>
+    bool RoundTripLimits () {
+        return
+            RoundTrip<T> (0) &&
+            RoundTrip<T> (1) &&
+            RoundTrip<T> (127) &&
+            RoundTrip<T> (128) &&
+            RoundTrip<T> (std::numeric_limits<T>::min ()) &&
+            RoundTrip<T> (std::numeric_limits<T>::max ()) &&
+            RoundTrip<T> ((T)(std::numeric_limits<T>::max () - 1));
+    }
+
+    template<typename T>
+    std::vector<T> MakeValues (std::size_t count) {
+        std::vector<T> values (count);
+        for (std::size_t i = 0; i < count; ++i) {
+            // Mix small and large magnitudes (and signs) so that
+            // every encoded size is exercised.
+            util::ui64 value = (util::ui64)1 << (i % 64);
+            values[i] = (T)(i % 3 == 0 ? value : ~value + i);
+        }
+        return values;
+    }
+
+    // TenantReadBuffer::Write asserts in debug builds. Keep
+    // the throw (and the read only memory) without the assert.
+    struct ReadOnlyBuffer : public util::TenantReadBuffer {
+        explicit ReadOnlyBuffer (const util::Buffer &buffer) :
+            util::TenantReadBuffer (buffer) {}
+
+        virtual std::size_t Write (
+                const void * /*buffer*/,
+                std::size_t /*count*/) override {
+            THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                "ReadOnlyBuffer can't Write.");
+            return -1;
+        }
+    };
+}
+
+TEST (thekogans, Scalars) {
+    CHECK (RoundTripLimits<util::i16> ());
+    CHECK (RoundTripLimits<util::ui16> ());
+    CHECK (RoundTripLimits<util::i32> ());
+    CHECK (RoundTripLimits<util::ui32> ());
+    CHECK (RoundTripLimits<util::i64> ());
+    CHECK (RoundTripLimits<util::ui64> ());
+    CHECK (RoundTrip<util::i32> (-1));
+    CHECK (RoundTrip<util::i64> (-64));
+}
+
+TEST (thekogans, Size) {
+    util::Buffer buffer (util::NetworkEndian, 64);
+    buffer.compact = true;
+    // Small values take a single byte regardless of their type.
+    buffer << (util::ui64)1 << (util::i32)-1 << (util::ui16)63;
+    CHECK_EQUAL (buffer.GetDataAvailableForReading (), (std::size_t)3);
+    // Full width values take at most SizeT::MAX_SIZE bytes.
+    buffer.Rewind ();
+    buffer << std::numeric_limits<util::ui64>::max ();
+    CHECK_EQUAL (buffer.GetDataAvailableForReading (), util::SizeT::MAX_SIZE);
+    // Fixed mode is unchanged.
+    buffer.Rewind ();
+    buffer.compact = false;
+    buffer << (util::ui64)1 << (util::i32)-1 << (util::ui16)63;
+    CHECK_EQUAL (buffer.GetDataAvailableForReading (), (std::size_t)14);
+}
+
+TEST (thekogans, Overflow) {
+    util::Buffer buffer (util::NetworkEndian, 16);
+    buffer.compact = true;
+    buffer << (util::ui32)70000;
+    util::ui16 value;
+    bool thrown = false;
+    try {
+        buffer >> value;
+    }
+    catch (const util::Exception &) {
+        thrown = true;
+    }
+    CHECK (thrown);
+}
+
+TEST (thekogans, Vectors) {
+    // The odd count makes sure the per element tail gets exercised.
+    const std::size_t COUNT = 1001;
+    std::vector<util::i64> i64s = MakeValues<util::i64> (COUNT);
+    std::vector<util::ui32> ui32s = MakeValues<util::ui32> (COUNT);
+    std::vector<util::i16> i16s = MakeValues<util::i16> (COUNT);
+    util::Buffer buffer (util::LittleEndian, COUNT * 32);
+    buffer.compact = true;
+    buffer << i64s << ui32s << i16s;
+    std::vector<util::i64> i64s_;
+    std::vector<util::ui32> ui32s_;
+    std::vector<util::i16> i16s_;
+    buffer >> i64s_ >> ui32s_ >> i16s_;
+    CHECK (i64s == i64s_);
+    CHECK (ui32s == ui32s_);
+    CHECK (i16s == i16s_);
+    CHECK_EQUAL (buffer.GetDataAvailableForReading (), (std::size_t)0);
+}
+
+TEST (thekogans, VectorsExactFit) {
+    // Size the buffer exactly so the bulk decoder has to
+    // fall back to per element reads near the end.
+    std::vector<util::ui64> values = MakeValues<util::ui64> (100);
+    util::Buffer buffer (util::BigEndian, 100 * util::SizeT::MAX_SIZE + util::SizeT::MAX_SIZE);
+    buffer.compact = true;
+    buffer << values;
+    util::Buffer exact (
+        util::BigEndian,
+        buffer.GetReadPtr (),
+        buffer.GetReadPtrEnd ());
+    exact.compact = true;
+    std::vector<util::ui64> result;
+    exact >> result;
+    CHECK (values == result);
+}
+
+TEST (thekogans, SerializableHeader) {
+    util::Fraction fraction (3, 4, util::Fraction::Negative);
+    for (int compact = 0; compact < 2; ++compact) {
+        util::Buffer buffer (util::NetworkEndian, 256);
+        buffer.compact = compact == 1;
+        buffer << fraction;
+        util::Fraction result;
+        buffer >> result;
+        CHECK (result == fraction);
+        CHECK_EQUAL (buffer.GetDataAvailableForReading (), (std::size_t)0);
+    }
+}
+
+TEST (thekogans, Blob) {
+    util::Fraction fraction (1000000, 3);
+    util::Buffer buffer (util::NetworkEndian, 256);
+    buffer.compact = true;
+    buffer << fraction;
+    std::vector<util::ui8> original (buffer.GetReadPtr (), buffer.GetReadPtrEnd ());
+    // header.size has to describe the compact payload exactly
+    // for a Blob to pick it up without knowing the type.
+    util::SerializableHeader header;
+    buffer >> header;
+    util::Blob blob;
+    blob.Read (header, buffer);
+    CHECK_EQUAL (blob.buffer.GetDataAvailableForReading (), (std::size_t)header.size);
+    CHECK_EQUAL (buffer.GetDataAvailableForReading (), (std::size_t)0);
+    util::Buffer copy (util::NetworkEndian, 256);
+    copy.compact = true;
+    copy << blob;
+    std::vector<util::ui8> copied (copy.GetReadPtr (), copy.GetReadPtrEnd ());
+    CHECK (original == copied);
+}
+
+TEST (thekogans, Views) {
+    std::string string (1000, 'x');
+    std::vector<util::ui8> bytes (1000, 0xaa);
+    util::Buffer buffer (util::NetworkEndian, 4096);
+    buffer << string << bytes;
+    // Views and owners share the wire format.
+    std::string_view stringView;
+    util::ByteView bytesView;
+    buffer >> stringView >> bytesView;
+    CHECK (stringView == string);
+    CHECK (bytesView == util::ByteView (bytes.data (), bytes.size ()));
+    // They point straight in to the buffer.
+    CHECK ((const util::ui8 *)stringView.data () >= buffer.GetDataPtr () &&
+        bytesView.end () <= buffer.GetDataPtr () + buffer.GetLength ());
+    buffer.Rewind ();
+    buffer << stringView << bytesView;
+    std::string string_;
+    std::vector<util::ui8> bytes_;
+    buffer >> string_ >> bytes_;
+    CHECK (string == string_);
+    CHECK (bytes == bytes_);
+}
+
+TEST (thekogans, ViewsNeedMemory) {
+    util::Buffer memory (util::NetworkEndian, 256);
+    memory << std::string ("not memory backed");
+    util::BufferedSerializer serializer (memory);
+    std::string_view view;
+    bool thrown = false;
+    try {
+        serializer >> view;
+    }
+    catch (const util::Exception &) {
+        thrown = true;
+    }
+    CHECK (thrown);
+}
+
+TEST (thekogans, TenantReadBufferIsReadOnly) {
+    // Room to spare past writeOffset, so every insert
+    // would fit in the wrapped memory.
+    util::Buffer buffer (util::NetworkEndian, 64);
+    buffer << (util::ui32)1;
+    ReadOnlyBuffer tenant (buffer);
+    std::size_t thrown = 0;
+    try {
+        tenant << (util::ui32)0xdeadbeef;
+    }
+    catch (const util::Exception &) {
+        ++thrown;
+    }
+    tenant.compact = true;
+    try {
+        tenant << (util::ui32)0xdeadbeef;
+    }
+    catch (const util::Exception &) {
+        ++thrown;
+    }
+    try {
+        tenant << std::vector<util::ui32> (4, 0xdeadbeef);
+    }
+    catch (const util::Exception &) {
+        ++thrown;
+    }
+    tenant.compact = false;
+    try {
+        tenant << std::vector<util::ui32> (4, 0xdeadbeef);
+    }
+    catch (const util::Exception &) {
+        ++thrown;
+    }
+    CHECK_EQUAL ((std::size_t)4, thrown);
+    CHECK_EQUAL ((std::size_t)4, buffer.GetDataAvailableForReading ());
+    CHECK_EQUAL ((std::size_t)4, tenant.GetDataAvailableForReading ());
+    // Reads still come straight out of the wrapped memory.
+    util::ui32 value;
+    tenant >> value;
+    CHECK_EQUAL ((util::ui32)1, value);
+}
+
+TEST (thekogans, BorrowedBlob) {
+    util::Fraction fraction (1, 2);
+    util::Buffer buffer (util::NetworkEndian, 256);
+    buffer << fraction;
+    buffer.borrow = true;
+    util::SerializableHeader header;
+    buffer >> header;
+    util::Blob blob;
+    blob.Read (header, buffer);
+    CHECK (blob.buffer.GetDataPtr () >= buffer.GetDataPtr () &&
+        blob.buffer.GetDataPtr () < buffer.GetDataPtr () + buffer.GetLength ());
+    CHECK_EQUAL (blob.buffer.GetDataAvailableForReading (), (std::size_t)header.size);
+    CHECK_EQUAL (buffer.GetDataAvailableForReading (), (std::size_t)0);
+}
+
+TEST (thekogans, BorrowedBuffer) {
+    util::Buffer payload (util::LittleEndian, 100);
+    for (util::ui8 i = 0; i < 100; ++i) {
+        payload << i;
+    }
+    util::Buffer buffer (util::NetworkEndian, 256);
+    buffer << payload;
+    buffer.borrow = true;
+    util::Buffer result;
+    buffer >> result;
+    CHECK (result.GetDataPtr () >= buffer.GetDataPtr () &&
+        result.GetDataPtr () < buffer.GetDataPtr () + buffer.GetLength ());
+    CHECK (result.GetReadView () == payload.GetReadView ());
+}
+
+TEST (thekogans, BorrowedThenCopied) {
+    util::Buffer first (util::LittleEndian, 100);
+    util::Buffer second (util::LittleEndian, 100);
+    util::Buffer third (util::LittleEndian, 50);
+    for (util::ui8 i = 0; i < 100; ++i) {
+        first << i;
+        second << (util::ui8)(100 + i);
+        if (i < 50) {
+            third << (util::ui8)(200 + i);
+        }
+    }
+    util::Buffer buffer (util::NetworkEndian, 512);
+    buffer << first << second << third;
+    std::vector<util::ui8> original (buffer.GetReadPtr (), buffer.GetReadPtrEnd ());
+    buffer.borrow = true;
+    util::Buffer result;
+    buffer >> result;
+    CHECK (result.GetReadView () == first.GetReadView ());
+    // Same length copy has to go to memory of its own,
+    // not over the bytes it borrowed.
+    buffer.borrow = false;
+    buffer >> result;
+    CHECK (result.GetReadView () == second.GetReadView ());
+    CHECK (result.GetDataPtr () < buffer.GetDataPtr () ||
+        result.GetDataPtr () >= buffer.GetDataPtr () + buffer.GetLength ());
+    // Different length copy must not try to resize the borrowed bytes.
+    buffer.Rewind (true);
+    buffer.borrow = true;
+    buffer >> result;
+    buffer.borrow = false;
+    buffer.AdvanceReadOffset (buffer.GetDataAvailableForReading () -
+        util::Serializer::Size (third));
+    buffer >> result;
+    CHECK (result.GetReadView () == third.GetReadView ());
+    // Same for Blob.
+    util::Fraction fraction1 (1, 2);
+    util::Fraction fraction2 (3, 4);
+    util::Buffer blobs (util::NetworkEndian, 256);
+    blobs << fraction1 << fraction2;
+    std::vector<util::ui8> originalBlobs (blobs.GetReadPtr (), blobs.GetReadPtrEnd ());
+    util::SerializableHeader header;
+    util::Blob blob;
+    blobs.borrow = true;
+    blobs >> header;
+    blob.Read (header, blobs);
+    blobs.borrow = false;
+    blobs >> header;
+    blob.Read (header, blobs);
+    CHECK (blob.buffer.GetDataPtr () < blobs.GetDataPtr () ||
+        blob.buffer.GetDataPtr () >= blobs.GetDataPtr () + blobs.GetLength ());
+    blobs.Rewind (true);
+    CHECK (std::vector<util::ui8> (blobs.GetReadPtr (), blobs.GetReadPtrEnd ()) == originalBlobs);
+    buffer.Rewind (true);
+    CHECK (std::vector<util::ui8> (buffer.GetReadPtr (), buffer.GetReadPtrEnd ()) == original);
+}
+
+TEST (thekogans, ByteSwapArray) {
+    // Odd counts and an unaligned start exercise every
+    // kernel's vector loop as well as its scalar tail.
+    const std::size_t COUNT = 1027;
+    std::vector<util::ui8> bytes (COUNT * util::UI64_SIZE + 1);
+    for (std::size_t i = 0; i < bytes.size (); ++i) {
+        bytes[i] = (util::ui8)(i * 31 + 7);
+    }
+    const util::ui8 *src = bytes.data () + 1;
+    std::vector<util::ui8> dst (bytes.size ());
+    for (std::size_t size = util::UI16_SIZE; size <= util::UI64_SIZE; size <<= 1) {
+        for (std::size_t count = 0; count < COUNT; count += 41) {
+            util::ByteSwapArray (src, dst.data () + 1, size, count);
+            bool swapped = true;
+            for (std::size_t i = 0; i < count * size && swapped; ++i) {
+                std::size_t value = i / size;
+                std::size_t byte = i % size;
+                swapped = dst[1 + i] == src[value * size + size - 1 - byte];
+            }
+            CHECK (swapped);
+        }
+    }
+    // In place.
+    std::vector<util::ui32> values (COUNT);
+    for (std::size_t i = 0; i < COUNT; ++i) {
+        values[i] = (util::ui32)(i * 0x01020304);
+    }
+    std::vector<util::ui32> swapped = values;
+    util::ByteSwap<util::LittleEndian, util::BigEndian> (swapped.data (), swapped.data (), COUNT);
+    bool ok = true;
+    for (std::size_t i = 0; i < COUNT; ++i) {
+        ok = ok && swapped[i] == util::ByteSwap<util::LittleEndian, util::BigEndian> (values[i]);
+    }
+    CHECK (ok);
+}
+
+namespace {
+    template<typename T>
+    bool BulkRoundTrip (
+            util::Endianness endianness,
+            bool memoryBacked) {
+        // Big enough to need several scratch chunks when swapping.
+        const std::size_t COUNT = 3001;
+        std::vector<T> values (COUNT);
+        util::SecureVector<T> secureValues (COUNT);
+        for (std::size_t i = 0; i < COUNT; ++i) {
+            values[i] = secureValues[i] = (T)((util::f64)((i * 2654435761u) & 0x7fff) +
+                (std::is_floating_point<T>::value ? 0.25 : 0.0));
+        }
+        util::Buffer buffer (endianness, 2 * COUNT * sizeof (T) + 32);
+        util::BufferedSerializer buffered (buffer, endianness);
+        util::Serializer &serializer = memoryBacked ?
+            (util::Serializer &)buffer : (util::Serializer &)buffered;
+        serializer << values << secureValues;
+        buffered.Flush ();
+        // Elements must come out in serializer byte order.
+        util::SizeT count;
+        buffer >> count;
+        T first;
+        buffer >> first;
+        buffer.Rewind (true);
+        std::vector<T> values_;
+        util::SecureVector<T> secureValues_;
+        serializer >> values_ >> secureValues_;
+        return count == COUNT && first == values[0] &&
+            values == values_ && secureValues == secureValues_;
+    }
+}
+
+TEST (thekogans, BulkVectors) {
+    for (int memoryBacked = 0; memoryBacked < 2; ++memoryBacked) {
+        for (int big = 0; big < 2; ++big) {
+            util::Endianness endianness = big == 1 ? util::BigEndian : util::LittleEndian;
+            CHECK (BulkRoundTrip<util::ui16> (endianness, memoryBacked == 1));
+            CHECK (BulkRoundTrip<util::i32> (endianness, memoryBacked == 1));
+            CHECK (BulkRoundTrip<util::ui64> (endianness, memoryBacked == 1));
+            CHECK (BulkRoundTrip<util::f32> (endianness, memoryBacked == 1));
+            CHECK (BulkRoundTrip<util::f64> (endianness, memoryBacked == 1));
+        }
+    }
+}
+
+namespace {
+    bool operator == (
+            const util::RunLoop::Stats::Job &job1,
+            const util::RunLoop::Stats::Job &job2) {
+        return
+            job1.id == job2.id &&
+            job1.startTime == job2.startTime &&
+            job1.endTime == job2.endTime &&
+            job1.totalTime == job2.totalTime;
+    }
+
+    bool operator == (
+            const util::RunLoop::Stats &stats1,
+            const util::RunLoop::Stats &stats2) {
+        return
+            stats1.id == stats2.id &&
+            stats1.name == stats2.name &&
+            stats1.totalJobs == stats2.totalJobs &&
+            stats1.totalJobTime == stats2.totalJobTime &&
+            stats1.lastJob == stats2.lastJob &&
+            stats1.minJob == stats2.minJob &&
+            stats1.maxJob == stats2.maxJob;
+    }
+
+    util::RunLoop::Stats MakeStats () {
+        util::RunLoop::Stats stats ("runloop", "Run \"loop\" <1>");
+        stats.totalJobs = 3;
+        stats.totalJobTime = 600;
+        stats.lastJob = util::RunLoop::Stats::Job ("job3", 1000, 1100, 100);
+        stats.minJob = util::RunLoop::Stats::Job ("job3", 1000, 1100, 100);
+        stats.maxJob = util::RunLoop::Stats::Job ("job1", 100, 400, 300);
+        return stats;
+    }
+
+    template<typename T>
+    bool FieldsRoundTrip (const T &value) {
+        // Binary.
+        util::Buffer buffer (util::NetworkEndian, value.GetSize ());
+        buffer << value;
+        if (buffer.GetDataAvailableForReading () != value.GetSize ()) {
+            return false;
+        }
+        T binary;
+        buffer >> binary;
+        // XML.
+        pugi::xml_document document;
+        pugi::xml_node node = document.append_child ("Value");
+        node << value;
+        T xml;
+        node >> xml;
+        // JSON.
+        util::JSON::Object object;
+        object << value;
+        T json;
+        object >> json;
+        return binary == value && xml == value && json == value;
+    }
+}
+
+namespace {
+    // A chain of serializables, each nested in the one before it.
+    struct Nested : public util::Serializable {
+        THEKOGANS_UTIL_DECLARE_SERIALIZABLE (Nested)
+
+        static std::size_t writes;
+
+        util::ui32 value;
+        std::unique_ptr<Nested> child;
+
+        explicit Nested (std::size_t depth = 1) :
+                value ((util::ui32)depth) {
+            if (depth > 1) {
+                child.reset (new Nested (depth - 1));
+            }
+        }
+
+        virtual std::size_t Size () const noexcept override {
+            return util::Serializer::Size (value) + util::BOOL_SIZE +
+                (child != nullptr ? child->GetSize () : 0);
+        }
+        virtual void Read (
+                const util::SerializableHeader & /*header*/,
+                util::Serializer &serializer) override {
+            bool hasChild;
+            serializer >> value >> hasChild;
+            child.reset (hasChild ? new Nested : nullptr);
+            if (hasChild) {
+                serializer >> *child;
+            }
+        }
+        virtual void Write (util::Serializer &serializer) const override {
+            ++writes;
+            serializer << value << (child != nullptr);
+            if (child != nullptr) {
+                serializer << *child;
+            }
+        }
+    };
+
+    THEKOGANS_UTIL_IMPLEMENT_SERIALIZABLE (Nested, 1, 0)
+
+    std::size_t Nested::writes = 0;
+}
+
+TEST (thekogans, CompactNested) {
+    const std::size_t DEPTH = 16;
+    Nested nested (DEPTH);
+    util::Buffer buffer (util::NetworkEndian, nested.GetSize ());
+    buffer.compact = true;
+    Nested::writes = 0;
+    buffer << nested;
+    // Every level measures its body once before writing it. Measuring
+    // the nested levels again for every enclosing one is 2^DEPTH work.
+    CHECK (Nested::writes <= DEPTH * DEPTH);
+    Nested result;
+    buffer >> result;
+    CHECK_EQUAL (buffer.GetDataAvailableForReading (), (std::size_t)0);
+    std::size_t depth = 0;
+    for (const Nested *level = &result; level != nullptr; level = level->child.get ()) {
+        CHECK_EQUAL ((util::ui32)(DEPTH - depth++), level->value);
+    }
+    CHECK_EQUAL (DEPTH, depth);
+}
+
+TEST (thekogans, SerializableFields) {
+    CHECK_EQUAL (util::SerializableFields<util::TimeSpec>::SIZE, util::TimeSpec::SIZE);
+    CHECK_EQUAL (util::SerializableFields<util::Fraction>::SIZE,
+        util::UI32_SIZE + util::UI32_SIZE + util::UI8_SIZE);
+    CHECK_EQUAL (util::SerializableFields<util::Rectangle>::SIZE, util::Rectangle::SIZE);
+    // Variable size types are summed field by field.
+    CHECK_EQUAL (util::SerializableFields<util::RunLoop::Stats>::SIZE, (std::size_t)0);
+    CHECK (FieldsRoundTrip (util::TimeSpec::FromNanoseconds (1234567890123)));
+    CHECK (FieldsRoundTrip (util::Fraction (3, 4, util::Fraction::Negative)));
+    CHECK (FieldsRoundTrip (MakeStats ()));
+    {
+        // Stats names stay URI encoded in XML (Stats version 1 format).
+        util::RunLoop::Stats stats = MakeStats ();
+        pugi::xml_document document;
+        pugi::xml_node node = document.append_child ("Stats");
+        node << stats;
+        CHECK (std::string (node.attribute ("Name").value ()) ==
+            util::Encodestring (stats.name));
+    }
+    {
+        util::Rectangle rectangle (-10, 20, 300, 400);
+        util::Buffer buffer (util::NetworkEndian, util::Rectangle::SIZE);
+        buffer << rectangle;
+        CHECK_EQUAL (buffer.GetDataAvailableForReading (), util::Rectangle::SIZE);
+        util::Rectangle result;
+        buffer >> result;
+        CHECK (result == rectangle);
+    }
+}
+
+TESTMAIN